@@ -211,6 +211,8 @@ typedef struct CnedkBufSurface {
   /** Holds the timestamp for video image, valid only for batch_size == 1 */
   uint64_t pts;
 
+  /** Reserved. Fields kept in it are accessed by functions, see CnedkBufSurfaceGetGeneration() and
+      CnedkBufSurfaceGetCaptureTime(). */
   void * _reserved[CNEDK_PADDING_LENGTH];
 } CnedkBufSurface;
 
@@ -346,6 +348,46 @@ int CnedkBufSurfaceCopy(CnedkBufSurface *src_surf, CnedkBufSurface *dst_surf);
  */
 int CnedkBufSurfaceMemSet(CnedkBufSurface *surf, int index, int plane, uint8_t value);
 
+/**
+ * @brief  Gets the format generation of the stream set by decoder. It increases when resolution or color format
+ * changes, cached states depend on the image size could be invalidated by it. Valid only for batch_size == 1.
+ *
+ * It is kept in the reserved fields of \ref CnedkBufSurface to keep the layout of the structure.
+ *
+ * @param[in] surf  A pointer to the CnedkBufSurface structure.
+ *
+ * @return Returns the generation, 0 if surf is nullptr.
+ */
+uint32_t CnedkBufSurfaceGetGeneration(const CnedkBufSurface *surf);
+
+/**
+ * @brief  Sets the format generation of the stream, see CnedkBufSurfaceGetGeneration().
+ *
+ * @param[in] surf        A pointer to the CnedkBufSurface structure.
+ * @param[in] generation  The generation.
+ */
+void CnedkBufSurfaceSetGeneration(CnedkBufSurface *surf, uint32_t generation);
+
+/**
+ * @brief  Gets the time in microseconds when the image data is captured or received. Valid only for batch_size == 1.
+ * It is based on a monotonic clock, e.g. cnedk::Clock::Default(), end to end latency could be measured by it.
+ *
+ * It is kept in the reserved fields of \ref CnedkBufSurface to keep the layout of the structure.
+ *
+ * @param[in] surf  A pointer to the CnedkBufSurface structure.
+ *
+ * @return Returns the capture time, 0 if it is unknown or surf is nullptr.
+ */
+uint64_t CnedkBufSurfaceGetCaptureTime(const CnedkBufSurface *surf);
+
+/**
+ * @brief  Sets the capture time, see CnedkBufSurfaceGetCaptureTime().
+ *
+ * @param[in] surf          A pointer to the CnedkBufSurface structure.
+ * @param[in] capture_time  The capture time in microseconds.
+ */
+void CnedkBufSurfaceSetCaptureTime(CnedkBufSurface *surf, uint64_t capture_time);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -0,0 +1,108 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+/**
+ * @file cnedk_buf_surface_shm.h
+ * <b>CnedkBufSurface Shared Memory Interface </b>
+ *
+ * This file specifies the API to share \ref CNEDK_BUF_MEM_SYSTEM buffers between processes.
+ *
+ * The buffers are allocated in POSIX shared memory. A \ref CnedkBufSurfaceShmHandle names the shared memory and
+ * could be sent to other processes, which open it to map the same memory without copying.
+ */
+
+#ifndef CNEDK_BUF_SURFACE_SHM_H_
+#define CNEDK_BUF_SURFACE_SHM_H_
+
+#include <stdint.h>
+
+#include "cnedk_buf_surface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Defines the maximum length of the name of shared memory, including the terminating null byte. */
+#define CNEDK_BUF_SHM_NAME_LENGTH  64
+
+/**
+ * Holds the handle of shared batched buffers. It is plain data and could be copied to other processes.
+ */
+typedef struct CnedkBufSurfaceShmHandle {
+  /** Holds the name of the shared memory. */
+  char name[CNEDK_BUF_SHM_NAME_LENGTH];
+} CnedkBufSurfaceShmHandle;
+
+/**
+ * @brief  Allocates a batch of buffers in shared memory.
+ *
+ * Same as CnedkBufSurfaceCreate(), but the memory could be opened by other processes.
+ * The memory type must be \ref CNEDK_BUF_MEM_SYSTEM.
+ *
+ * Call CnedkBufSurfaceDestroy() to free resources allocated by this function.
+ *
+ * @param[out] surf         An indirect pointer to the allocated batched buffers.
+ * @param[in]  params       A pointer to an \ref CnedkBufSurfaceCreateParams structure.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int CnedkBufSurfaceCreateShared(CnedkBufSurface **surf, CnedkBufSurfaceCreateParams *params);
+
+/**
+ * @brief  Gets the handle of batched buffers allocated by CnedkBufSurfaceCreateShared()
+ *         or opened by CnedkBufSurfaceOpenShared().
+ *
+ * @param[in]  surf    A pointer to the shared CnedkBufSurface.
+ * @param[out] handle  A pointer to the handle.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int CnedkBufSurfaceGetShmHandle(CnedkBufSurface *surf, CnedkBufSurfaceShmHandle *handle);
+
+/**
+ * @brief  Opens shared batched buffers by the handle, in this process or in any other process.
+ *
+ * The memory is mapped, not copied. The shared memory is reference-counted across processes, it is removed when
+ * the last CnedkBufSurface referring to it is destroyed. The memory must be referred by at least one CnedkBufSurface
+ * while it is being opened.
+ *
+ * Call CnedkBufSurfaceDestroy() to free resources allocated by this function.
+ *
+ * @param[out] surf    An indirect pointer to the opened batched buffers.
+ * @param[in]  handle  A pointer to the handle.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int CnedkBufSurfaceOpenShared(CnedkBufSurface **surf, const CnedkBufSurfaceShmHandle *handle);
+
+/**
+ * @brief  Removes shared memory leaked by processes which exited without destroying their buffers, e.g. crashed.
+ *
+ * It is called once in each process before the first shared buffers are allocated.
+ *
+ * @return Returns the number of removed shared memory objects.
+ */
+int CnedkBufSurfaceShmCleanup(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // CNEDK_BUF_SURFACE_SHM_H_
@@ -25,11 +25,13 @@
 #include <cstring>  // for memset
 #include <memory>
 #include <mutex>
+#include <string>
 #include <utility>
 
 #include "cnrt.h"
 
 #include "cnedk_buf_surface.h"
+#include "cnedk_memory_budget.hpp"
 
 namespace cnedk {
 
@@ -292,10 +294,12 @@ class BufPool {
    *
    * @param[in] params The parameters for creating CnedkBufSurface.
    * @param[in] block_count The capacity of the pool.
+   * @param[in] category The memory budget category the pool is accounted to.
    *
    * @return Returns 0 if this function has run successfully. Otherwise returns -1.
    */
-  int CreatePool(CnedkBufSurfaceCreateParams *params, uint32_t block_count);
+  int CreatePool(CnedkBufSurfaceCreateParams *params, uint32_t block_count,
+                 const std::string &category = kMemCategoryBufPool);
   /**
    * @brief Destroys pool.
    *
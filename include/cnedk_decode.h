@@ -44,6 +44,36 @@ typedef enum {
   CNEDK_VDEC_TYPE_NUM
 } CnedkVdecType;
 
+/**
+ * Specifies decode modes. Frames are selected by NAL unit types before they are sent to decoder, the dropped ones
+ * cost no decoding. Valid for H264 and H265 codec types.
+ */
+typedef enum {
+  /** Decodes all frames. */
+  CNEDK_VDEC_DECODE_MODE_ALL = 0,
+  /** Decodes key frames (IDR for H264, IRAP for H265) only, one of every decode_interval key frames. */
+  CNEDK_VDEC_DECODE_MODE_KEY_FRAME,
+  /** Decodes reference frames only, non-reference frames are dropped. */
+  CNEDK_VDEC_DECODE_MODE_REFERENCE,
+  /** Specifies the number of decode modes */
+  CNEDK_VDEC_DECODE_MODE_NUM
+} CnedkVdecDecodeMode;
+
+/**
+ * Holds the format of decoded frames, reported when it changes in the middle of a stream.
+ */
+typedef struct CnedkVdecFormatInfo {
+  /** The width of decoded frames. */
+  uint32_t width;
+  /** The height of decoded frames. */
+  uint32_t height;
+  /** The color format of decoded frames. */
+  CnedkBufSurfaceColorFormat color_format;
+  /** The generation of the format, starts from 0 and increases by 1 on every change.
+      It is the same as the generation of the following BufSurfaces. */
+  uint32_t generation;
+} CnedkVdecFormatInfo;
+
 /**
  * Holds the parameters for creating video decoder.
  */
@@ -60,6 +90,10 @@ typedef struct CnedkVdecCreateParams {
   uint32_t frame_buf_num;
   /** The color format of the frame after decoding. */
   CnedkBufSurfaceColorFormat color_format;
+  /** The decode mode, decodes all frames by default. */
+  CnedkVdecDecodeMode decode_mode;
+  /** Decodes one of every decode_interval key frames in CNEDK_VDEC_DECODE_MODE_KEY_FRAME mode. 0 is the same as 1. */
+  uint32_t decode_interval;
 
   // When a decoded picture got, the below steps will be performed
   //  (1)  GetBufSurf
@@ -75,6 +109,11 @@ typedef struct CnedkVdecCreateParams {
   int (*GetBufSurf)(CnedkBufSurface **surf,
                   int width, int height, CnedkBufSurfaceColorFormat fmt,
                   int timeout_ms, void *userdata) = 0;
+  /** The OnFormatChange callback function, optional. It is called when the resolution or color format of decoded
+      frames changes in the middle of a stream, after all frames of the previous format are passed to OnFrame and
+      before GetBufSurf is called for the new format. The buffer pool could be reallocated here. Returns a negative
+      value to report an error. */
+  int (*OnFormatChange)(const CnedkVdecFormatInfo *info, void *userdata);
   /** The timeout in milliseconds. */
   int surf_timeout_ms;
   /** The user data. */
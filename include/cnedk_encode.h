@@ -138,6 +138,27 @@ int CnedkVencDestroy(void *venc);
  * @return Returns 0 if this function has run successfully. Otherwise returns -1.
  */
 int CnedkVencSendFrame(void *venc, CnedkBufSurface *surf, int timeout_ms);
+/**
+ * @brief Retains the video frame passed to the OnFrameBits callback function, so that its data stays valid after the
+ *        callback returns.
+ *
+ * @param[in] framebits The video frame passed to the OnFrameBits callback function.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ *
+ * @note Each successful call must be paired with a call to CnedkVencReleaseFrameBits. The retained video frame
+ *       occupies the bitstream buffer of the encoder, release it as soon as possible. The retained video frame
+ *       stays valid after the encoder is destroyed.
+ */
+int CnedkVencRetainFrameBits(CnedkVEncFrameBits *framebits);
+/**
+ * @brief Releases the video frame retained by CnedkVencRetainFrameBits.
+ *
+ * @param[in] framebits The retained video frame.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int CnedkVencReleaseFrameBits(CnedkVEncFrameBits *framebits);
 
 #ifdef __cplusplus
 };
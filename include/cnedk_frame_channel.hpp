@@ -0,0 +1,334 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_FRAME_CHANNEL_HPP_
+#define CNEDK_FRAME_CHANNEL_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "cnedk_buf_surface.h"
+
+namespace cnedk {
+
+/**
+ * @brief Status of popping from a channel.
+ */
+enum class ChannelStatus {
+  /// An element is popped
+  OK,
+  /// No element is available before timeout
+  TIMEOUT,
+  /// The end of stream sentinel is popped
+  EOS,
+  /// The channel is closed and all elements are popped
+  CLOSED
+};
+
+/**
+ * @class SpscChannel
+ *
+ * @brief SpscChannel is a bounded single-producer single-consumer channel. Push and pop do not take any lock while
+ *        the channel is neither empty nor full. The waiting side is parked on a condition variable otherwise.
+ *
+ * @tparam T Type of elements
+ */
+template <typename T>
+class SpscChannel {
+ public:
+  /**
+   * @brief A constructor to construct a SpscChannel object.
+   *
+   * @param[in] capacity The maximum number of elements in channel, including end of stream sentinels.
+   */
+  explicit SpscChannel(size_t capacity) : capacity_(capacity + 1), slots_(new Slot[capacity + 1]) {}
+  /**
+   * @brief A destructor to destruct a SpscChannel object.
+   */
+  virtual ~SpscChannel() = default;
+  /**
+   * @brief Pushes an element. Blocks if the channel is full.
+   *
+   * @param[in] value The element.
+   *
+   * @return Returns true if the element is pushed, false if the channel is closed.
+   */
+  bool Push(T value) { return DoPush(std::move(value), false); }
+  /**
+   * @brief Pushes an element if the channel is not full.
+   *
+   * @param[in] value The element.
+   *
+   * @return Returns true if the element is pushed, false if the channel is full or closed.
+   */
+  bool TryPush(T value) {
+    if (closed_.load(std::memory_order_acquire)) return false;
+    return TryEnqueue(&value, false);
+  }
+  /**
+   * @brief Pushes an end of stream sentinel. Blocks if the channel is full.
+   *
+   * @return Returns true if the sentinel is pushed, false if the channel is closed.
+   *
+   * @note The channel is still usable after end of stream, e.g. for the next loop of a stream.
+   */
+  bool PushEos() { return DoPush(T(), true); }
+  /**
+   * @brief Pops an element. Blocks until an element is available or the channel is closed.
+   *
+   * @param[out] value The element, it is set only if ChannelStatus::OK is returned.
+   *
+   * @return Returns ChannelStatus::OK, ChannelStatus::EOS or ChannelStatus::CLOSED.
+   */
+  ChannelStatus Pop(T *value) { return DoPop(value, nullptr); }
+  /**
+   * @brief Pops an element. Blocks until an element is available, the channel is closed or timeout.
+   *
+   * @param[out] value The element, it is set only if ChannelStatus::OK is returned.
+   * @param[in] timeout The maximum duration to block.
+   *
+   * @return Returns the status.
+   */
+  template <typename Rep, typename Period>
+  ChannelStatus Pop(T *value, const std::chrono::duration<Rep, Period> &timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    return DoPop(value, &deadline);
+  }
+  /**
+   * @brief Pops an element without blocking.
+   *
+   * @param[out] value The element, it is set only if ChannelStatus::OK is returned.
+   *
+   * @return Returns ChannelStatus::TIMEOUT if the channel is empty and not closed.
+   */
+  ChannelStatus TryPop(T *value) {
+    ChannelStatus status;
+    if (TryDequeue(value, &status)) return status;
+    return closed_.load(std::memory_order_acquire) && Empty() ? ChannelStatus::CLOSED : ChannelStatus::TIMEOUT;
+  }
+  /**
+   * @brief Closes the channel. Pushing fails after close, and elements in channel could still be popped.
+   */
+  void Close() {
+    closed_.store(true, std::memory_order_seq_cst);
+    std::lock_guard<std::mutex> lk(mutex_);
+    cond_.notify_all();
+  }
+  /**
+   * @brief Checks whether the channel is closed.
+   *
+   * @return Returns true if the channel is closed.
+   */
+  bool Closed() const { return closed_.load(std::memory_order_acquire); }
+  /**
+   * @brief Gets the number of elements in channel.
+   *
+   * @return Returns the number of elements.
+   */
+  size_t Size() const {
+    size_t tail = tail_.load(std::memory_order_acquire);
+    size_t head = head_.load(std::memory_order_acquire);
+    return tail >= head ? tail - head : tail + capacity_ - head;
+  }
+  /**
+   * @brief Checks whether the channel is empty.
+   *
+   * @return Returns true if the channel is empty.
+   */
+  bool Empty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+  /**
+   * @brief Gets the capacity of channel.
+   *
+   * @return Returns the capacity.
+   */
+  size_t Capacity() const { return capacity_ - 1; }
+
+ private:
+  struct Slot {
+    T value;
+    bool eos;
+  };
+  // spins for a short while before parking, since the other side usually responds quickly
+  static constexpr int kSpinCount = 64;
+
+  size_t Next(size_t idx) const { return idx + 1 == capacity_ ? 0 : idx + 1; }
+
+  bool TryEnqueue(T *value, bool eos) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t next = Next(tail);
+    if (next == head_.load(std::memory_order_acquire)) return false;
+    slots_[tail].value = std::move(*value);
+    slots_[tail].eos = eos;
+    tail_.store(next, std::memory_order_seq_cst);
+    if (consumer_waiting_.load(std::memory_order_seq_cst)) {
+      std::lock_guard<std::mutex> lk(mutex_);
+      cond_.notify_all();
+    }
+    return true;
+  }
+
+  bool TryDequeue(T *value, ChannelStatus *status) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return false;
+    if (slots_[head].eos) {
+      *status = ChannelStatus::EOS;
+    } else {
+      *value = std::move(slots_[head].value);
+      *status = ChannelStatus::OK;
+    }
+    slots_[head].value = T();
+    head_.store(Next(head), std::memory_order_seq_cst);
+    if (producer_waiting_.load(std::memory_order_seq_cst)) {
+      std::lock_guard<std::mutex> lk(mutex_);
+      cond_.notify_all();
+    }
+    return true;
+  }
+
+  bool DoPush(T value, bool eos) {
+    for (int i = 0; i < kSpinCount; ++i) {
+      if (closed_.load(std::memory_order_acquire)) return false;
+      if (TryEnqueue(&value, eos)) return true;
+      std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (true) {
+      producer_waiting_.store(true, std::memory_order_seq_cst);
+      if (closed_.load(std::memory_order_seq_cst)) break;
+      if (Next(tail_.load(std::memory_order_relaxed)) != head_.load(std::memory_order_seq_cst)) {
+        producer_waiting_.store(false, std::memory_order_relaxed);
+        lk.unlock();
+        if (TryEnqueue(&value, eos)) return true;
+        lk.lock();
+        continue;
+      }
+      cond_.wait(lk);
+    }
+    producer_waiting_.store(false, std::memory_order_relaxed);
+    return false;
+  }
+
+  ChannelStatus DoPop(T *value, const std::chrono::steady_clock::time_point *deadline) {
+    ChannelStatus status;
+    for (int i = 0; i < kSpinCount; ++i) {
+      if (TryDequeue(value, &status)) return status;
+      if (closed_.load(std::memory_order_acquire) && Empty()) return ChannelStatus::CLOSED;
+      std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lk(mutex_);
+    while (true) {
+      consumer_waiting_.store(true, std::memory_order_seq_cst);
+      if (head_.load(std::memory_order_relaxed) != tail_.load(std::memory_order_seq_cst)) {
+        consumer_waiting_.store(false, std::memory_order_relaxed);
+        lk.unlock();
+        if (TryDequeue(value, &status)) return status;
+        lk.lock();
+        continue;
+      }
+      if (closed_.load(std::memory_order_seq_cst)) break;
+      if (!deadline) {
+        cond_.wait(lk);
+      } else if (cond_.wait_until(lk, *deadline) == std::cv_status::timeout) {
+        consumer_waiting_.store(false, std::memory_order_relaxed);
+        lk.unlock();
+        if (TryDequeue(value, &status)) return status;
+        return closed_.load(std::memory_order_acquire) && Empty() ? ChannelStatus::CLOSED : ChannelStatus::TIMEOUT;
+      }
+    }
+    consumer_waiting_.store(false, std::memory_order_relaxed);
+    return ChannelStatus::CLOSED;
+  }
+
+  const size_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+  alignas(64) std::atomic<bool> closed_{false};
+  std::atomic<bool> producer_waiting_{false};
+  std::atomic<bool> consumer_waiting_{false};
+  std::mutex mutex_;
+  std::condition_variable cond_;
+};  // class SpscChannel
+
+/**
+ * @class FrameChannel
+ *
+ * @brief FrameChannel is a SpscChannel of decoded frames. It could be set as the callbacks of decoder directly, and
+ *        frames which are never popped are destroyed with the channel.
+ *
+ * @note Usage:
+ *       CnedkVdecCreateParams params;
+ *       params.OnFrame = cnedk::FrameChannel::OnFrame;
+ *       params.OnEos = cnedk::FrameChannel::OnEos;
+ *       params.userdata = &channel;
+ */
+class FrameChannel : public SpscChannel<CnedkBufSurface *> {
+ public:
+  /**
+   * @brief A constructor to construct a FrameChannel object.
+   *
+   * @param[in] capacity The maximum number of frames in channel. The decoder is blocked while the channel is full.
+   */
+  explicit FrameChannel(size_t capacity) : SpscChannel<CnedkBufSurface *>(capacity) {}
+  /**
+   * @brief A destructor to destruct a FrameChannel object. Frames left in channel are destroyed.
+   */
+  ~FrameChannel() {
+    Close();
+    CnedkBufSurface *surf = nullptr;
+    ChannelStatus status;
+    while ((status = TryPop(&surf)) != ChannelStatus::CLOSED) {
+      if (status == ChannelStatus::OK && surf) CnedkBufSurfaceDestroy(surf);
+    }
+  }
+  /**
+   * @brief The OnFrame callback of decoder. The frame is destroyed if the channel is closed.
+   *
+   * @param[in] surf The decoded frame.
+   * @param[in] userdata The pointer of a FrameChannel object.
+   *
+   * @return Returns 0 if the frame is pushed. Otherwise returns -1.
+   */
+  static int OnFrame(CnedkBufSurface *surf, void *userdata) {
+    if (!static_cast<FrameChannel *>(userdata)->Push(surf)) {
+      if (surf) CnedkBufSurfaceDestroy(surf);
+      return -1;
+    }
+    return 0;
+  }
+  /**
+   * @brief The OnEos callback of decoder, which pushes an end of stream sentinel.
+   *
+   * @param[in] userdata The pointer of a FrameChannel object.
+   *
+   * @return Returns 0 if the sentinel is pushed. Otherwise returns -1.
+   */
+  static int OnEos(void *userdata) { return static_cast<FrameChannel *>(userdata)->PushEos() ? 0 : -1; }
+};  // class FrameChannel
+
+}  // namespace cnedk
+
+#endif  // CNEDK_FRAME_CHANNEL_HPP_
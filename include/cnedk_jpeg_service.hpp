@@ -0,0 +1,128 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_JPEG_SERVICE_HPP_
+#define CNEDK_JPEG_SERVICE_HPP_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "cnedk_buf_surface.h"
+#include "cnedk_transform.h"
+
+namespace cnedk {
+
+/**
+ * @brief Holds a crop to be encoded to JPEG.
+ */
+struct JpegJob {
+  /// The frame in host memory (CNEDK_BUF_MEM_SYSTEM or CNEDK_BUF_MEM_PINNED) of NV12, NV21, BGR or RGB. NV12 and NV21
+  /// are taken as BT.601 in video range and encoded in full range.
+  /// It must be valid until the job is done
+  CnedkBufSurface *surf = nullptr;
+  /// The index of the frame in the batch
+  uint32_t batch_idx = 0;
+  /// The region to encode, the whole frame if width or height is 0
+  CnedkTransformRect roi = {0, 0, 0, 0};
+  /// The size of the JPEG image, the size of roi if 0
+  uint32_t width = 0;
+  uint32_t height = 0;
+  /// The quality from 1 to 100
+  int quality = 85;
+};
+
+/// The JPEG file. The vector is returned to the pool of the service when the last reference is released
+using JpegBuffer = std::shared_ptr<std::vector<uint8_t>>;
+/// Called on a worker thread when a job is done, ret is 0 on success and buffer is nullptr on failure
+using JpegCallback = std::function<void(int ret, JpegBuffer buffer)>;
+
+/**
+ * @brief Holds the parameters of JpegService.
+ */
+struct JpegServiceParams {
+  /// The number of worker threads
+  uint32_t thread_num = 4;
+  /// The maximum number of idle buffers kept for reuse
+  uint32_t max_pooled_buffers = 64;
+};
+
+class JpegServicePrivate;
+
+/**
+ * @class JpegService
+ *
+ * @brief JpegService encodes crops of frames to JPEG on CPU, e.g. thumbnails of detected objects.
+ *
+ * Jobs are cropped and scaled by CnedkTransform in host memory and encoded by a baseline JPEG encoder with SIMD DCT
+ * on a pool of worker threads. Frames in device memory should be copied to host memory before, e.g. by
+ * CnedkBufSurfaceCopy.
+ */
+class JpegService {
+ public:
+  /**
+   * @brief Constructs JpegService and starts the worker threads.
+   *
+   * @param[in] params The parameters.
+   */
+  explicit JpegService(const JpegServiceParams &params = JpegServiceParams());
+  /**
+   * @brief Destructs JpegService. Waits for the pending jobs.
+   */
+  ~JpegService();
+
+  /**
+   * @brief Encodes a job asynchronously.
+   *
+   * @param[in] job The job.
+   * @param[in] callback The callback of the result.
+   *
+   * @return Returns 0 if the job is queued, otherwise returns -1 and callback is not called.
+   */
+  int EncodeAsync(const JpegJob &job, JpegCallback callback);
+
+  /**
+   * @brief Encodes a batch of jobs and waits for all of them.
+   *
+   * @param[in] jobs The jobs.
+   * @param[out] buffers The JPEG files in the order of jobs, nullptr for the failed jobs.
+   *
+   * @return Returns 0 if all jobs succeed, otherwise returns -1.
+   */
+  int Encode(const std::vector<JpegJob> &jobs, std::vector<JpegBuffer> *buffers);
+
+  /**
+   * @brief Gets the number of idle buffers in the pool.
+   *
+   * @return Returns the number of idle buffers.
+   */
+  uint32_t GetPooledBufferNum() const;
+
+ private:
+  JpegService(const JpegService &) = delete;
+  JpegService &operator=(const JpegService &) = delete;
+
+  std::unique_ptr<JpegServicePrivate> priv_;
+};
+
+}  // namespace cnedk
+
+#endif  // CNEDK_JPEG_SERVICE_HPP_
@@ -0,0 +1,223 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_MEMORY_BUDGET_HPP_
+#define CNEDK_MEMORY_BUDGET_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cnedk {
+
+/// The domain of host memory. Device memory is accounted in the domain of device id
+constexpr int kHostMemory = -1;
+
+/// The category of memory pools created by CnedkBufPoolCreate
+constexpr const char *kMemCategoryBufPool = "buf_pool";
+/// The category of output pools of predictors
+constexpr const char *kMemCategoryPredictorOutput = "predictor_output";
+/// The category of frame pools of decoders
+constexpr const char *kMemCategoryDecoderFrames = "decoder_frames";
+/// The category of cached models
+constexpr const char *kMemCategoryModelCache = "model_cache";
+
+/**
+ * @brief Holds the limits of memory in bytes. 0 means no limit.
+ */
+struct MemLimits {
+  MemLimits() = default;
+  MemLimits(size_t soft_limit, size_t hard_limit) : soft(soft_limit), hard(hard_limit) {}
+  /// Memory above this will be reclaimed
+  size_t soft = 0;
+  /// Reservations above this fail
+  size_t hard = 0;
+};
+
+/**
+ * @brief The function to reclaim memory, e.g. to free idle buffers of a pool or to evict cached models.
+ *
+ * @param[in] bytes The number of bytes wanted.
+ *
+ * @return Returns the number of bytes released.
+ *
+ * @note It could be called from any thread which reserves memory. It must not block on locks which are held while
+ *       reserving memory, use try_lock and return 0 if busy.
+ */
+using MemReclaimFunc = std::function<size_t(size_t bytes)>;
+
+class MemoryAccount;
+
+/**
+ * @class MemoryBudget
+ *
+ * @brief MemoryBudget accounts memory of pools and caches, per device and for host memory.
+ *
+ * Limits are hierarchical: a reservation must fit the limits of the account, of its category and of its domain.
+ * If a hard limit would be exceeded, other accounts of the same category or domain are asked to reclaim memory,
+ * then the reserving account trims its own idle memory. The reservation fails if not enough could be released.
+ * Once a soft limit is exceeded, the excess is reclaimed from other accounts.
+ */
+class MemoryBudget {
+ public:
+  /**
+   * @brief Gets the instance of MemoryBudget.
+   *
+   * @return Returns the instance.
+   */
+  static MemoryBudget &Instance();
+  /**
+   * @brief Sets the limits of a domain.
+   *
+   * @param[in] domain The device id, or kHostMemory.
+   * @param[in] limits The limits.
+   */
+  void SetLimits(int domain, const MemLimits &limits);
+  /**
+   * @brief Sets the limits of a category in a domain.
+   *
+   * @param[in] domain The device id, or kHostMemory.
+   * @param[in] category The category.
+   * @param[in] limits The limits.
+   */
+  void SetLimits(int domain, const std::string &category, const MemLimits &limits);
+  /**
+   * @brief Removes all limits of domains and categories. The limits of accounts are not changed.
+   */
+  void ClearLimits();
+  /**
+   * @brief Gets the memory used in a domain.
+   *
+   * @param[in] domain The device id, or kHostMemory.
+   *
+   * @return Returns the number of bytes.
+   */
+  size_t GetUsage(int domain) const;
+  /**
+   * @brief Gets the memory used by a category in a domain.
+   *
+   * @param[in] domain The device id, or kHostMemory.
+   * @param[in] category The category.
+   *
+   * @return Returns the number of bytes.
+   */
+  size_t GetUsage(int domain, const std::string &category) const;
+  /**
+   * @brief Asks accounts of a domain to reclaim memory, the accounts holding more memory are asked first.
+   *
+   * @param[in] domain The device id, or kHostMemory.
+   * @param[in] bytes The number of bytes wanted.
+   *
+   * @return Returns the number of bytes released.
+   */
+  size_t Reclaim(int domain, size_t bytes);
+
+ private:
+  friend class MemoryAccount;
+  struct Entry;
+  struct Usage {
+    MemLimits limits;
+    size_t used = 0;
+  };
+
+  MemoryBudget() = default;
+  MemoryBudget(const MemoryBudget &) = delete;
+  MemoryBudget &operator=(const MemoryBudget &) = delete;
+
+  void Register(const std::shared_ptr<Entry> &entry);
+  void Unregister(const std::shared_ptr<Entry> &entry);
+  bool Reserve(const std::shared_ptr<Entry> &entry, size_t bytes);
+  void Release(const std::shared_ptr<Entry> &entry, size_t bytes);
+  bool OverSoftLimit(const std::shared_ptr<Entry> &entry) const;
+  std::vector<std::shared_ptr<Entry>> Candidates(int domain, const std::string *category, const Entry *exclude);
+  size_t ReclaimFrom(const std::vector<std::shared_ptr<Entry>> &candidates, size_t bytes);
+
+  mutable std::mutex mutex_;
+  std::map<int, Usage> domains_;
+  std::map<std::pair<int, std::string>, Usage> categories_;
+  std::vector<std::shared_ptr<Entry>> entries_;
+};
+
+/**
+ * @class MemoryAccount
+ *
+ * @brief MemoryAccount registers a pool or a cache to MemoryBudget. Memory is accounted until the account is
+ *        destroyed.
+ */
+class MemoryAccount {
+ public:
+  /**
+   * @brief A constructor to construct a MemoryAccount object.
+   *
+   * @param[in] domain The device id, or kHostMemory.
+   * @param[in] category The category, e.g. kMemCategoryBufPool.
+   * @param[in] limits The limits of this account.
+   * @param[in] reclaim The function to reclaim memory of this account. Reservations of this account call it only if
+   *                    a hard limit would be exceeded otherwise.
+   */
+  MemoryAccount(int domain, const std::string &category, const MemLimits &limits = MemLimits(),
+                MemReclaimFunc reclaim = nullptr);
+  /**
+   * @brief A destructor to destruct a MemoryAccount object. Memory still reserved is released, and it waits for
+   *        the running reclaim function to finish.
+   */
+  ~MemoryAccount();
+  /**
+   * @brief Reserves memory before allocating.
+   *
+   * @param[in] bytes The number of bytes.
+   *
+   * @return Returns true if reserved. Returns false if a hard limit would be exceeded.
+   */
+  bool Reserve(size_t bytes);
+  /**
+   * @brief Releases memory after freeing.
+   *
+   * @param[in] bytes The number of bytes.
+   */
+  void Release(size_t bytes);
+  /**
+   * @brief Gets the memory used by this account.
+   *
+   * @return Returns the number of bytes.
+   */
+  size_t GetUsage() const;
+  /**
+   * @brief Checks whether the usage is above a soft limit of this account, its category or its domain. Pools should
+   *        free memory instead of keeping it idle in this case.
+   *
+   * @return Returns true if above a soft limit.
+   */
+  bool OverSoftLimit() const;
+
+ private:
+  MemoryAccount(const MemoryAccount &) = delete;
+  MemoryAccount &operator=(const MemoryAccount &) = delete;
+  std::shared_ptr<MemoryBudget::Entry> entry_;
+};
+
+}  // namespace cnedk
+
+#endif  // CNEDK_MEMORY_BUDGET_HPP_
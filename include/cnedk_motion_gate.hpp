@@ -0,0 +1,162 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_MOTION_GATE_HPP_
+#define CNEDK_MOTION_GATE_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "cnedk_buf_surface.h"
+#include "cnedk_transform.h"
+
+namespace cnedk {
+
+/**
+ * @brief Holds the parameters of motion gating.
+ */
+struct MotionGateParams {
+  /// The factor to downsample luma before differencing, 1, 2, 4 or 8
+  uint32_t scale = 4;
+  /// Downsampled pixels differing from the previous frame or the background more than this are changed
+  uint8_t diff_threshold = 24;
+  /// The background follows frames by 1 / 2^bg_update_shift per frame, 0 to 7
+  uint32_t bg_update_shift = 4;
+  /// The size of cells in downsampled pixels, changed regions are made of cells
+  uint32_t cell_size = 8;
+  /// A cell is changed if the ratio of changed pixels in it is not less than this
+  float cell_ratio = 0.1;
+  /// Gating turns on if the number of changed cells is not less than this
+  uint32_t trigger_cells = 2;
+  /// Gating keeps on while the number of changed cells is not less than this
+  uint32_t release_cells = 1;
+  /// Gating turns off after fewer cells than release_cells change for this number of frames
+  uint32_t hold_frames = 5;
+  /// The whole frame is inferred if the ratio of changed cells is not less than this, e.g. on scene changes
+  float full_frame_ratio = 0.5;
+  /// The padding of regions in frame pixels
+  uint32_t roi_padding = 16;
+  /// The maximum number of regions, the closest regions are merged if more are found
+  uint32_t max_rois = 4;
+};
+
+/**
+ * @brief Holds the result of motion gating of a frame.
+ */
+struct MotionResult {
+  /// Nothing changes, the inference of the frame could be skipped
+  bool skip = false;
+  /// The whole frame should be inferred, e.g. the first frame or a scene change. rois is empty then
+  bool full_frame = false;
+  /// The number of changed cells
+  uint32_t changed_cells = 0;
+  /// The changed regions in frame pixels with even coordinates, to be cropped before inference, e.g. as the
+  /// normalized bbox of infer_server::PreprocInput
+  std::vector<CnedkTransformRect> rois;
+};
+
+/**
+ * @class MotionGate
+ *
+ * @brief MotionGate decides whether a frame of a fixed camera needs inference, on CPU with the luma plane.
+ *
+ * Luma is downsampled and compared with the previous frame and a running background. Changed pixels are counted in
+ * cells, and connected changed cells make the regions of interest. Gating turns on at trigger_cells and turns off
+ * hold_frames after fewer than release_cells change, the last regions are kept meanwhile.
+ *
+ * @note MotionGate is not thread safe, use one per stream.
+ */
+class MotionGate {
+ public:
+  /**
+   * @brief A constructor to construct a MotionGate object.
+   *
+   * @param[in] params The parameters.
+   */
+  explicit MotionGate(const MotionGateParams &params = MotionGateParams()) : params_(params) {}
+  /**
+   * @brief Sets the regions to watch. Changes out of the regions are ignored.
+   *
+   * @param[in] include The regions in frame pixels. The whole frame is watched if it is empty.
+   * @param[in] exclude The regions in frame pixels to be ignored, even if in the included regions.
+   */
+  void SetRegions(const std::vector<CnedkTransformRect> &include,
+                  const std::vector<CnedkTransformRect> &exclude = std::vector<CnedkTransformRect>());
+  /**
+   * @brief Processes a frame.
+   *
+   * @param[in] surf The frame. The color format must be NV12, NV21, YUV420 or GRAY8. Memory must be accessible by
+   *                 CPU, i.e. CNEDK_BUF_MEM_SYSTEM, CNEDK_BUF_MEM_PINNED, or mapped by CnedkBufSurfaceMap.
+   * @param[in] batch_idx The batch index of the frame.
+   * @param[out] result The result.
+   *
+   * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+   */
+  int Process(CnedkBufSurface *surf, uint32_t batch_idx, MotionResult *result);
+  /**
+   * @brief Processes the luma plane of a frame.
+   *
+   * @param[in] luma The luma plane.
+   * @param[in] width The width of the frame.
+   * @param[in] height The height of the frame.
+   * @param[in] stride The stride of the luma plane in bytes.
+   * @param[out] result The result.
+   *
+   * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+   */
+  int Process(const uint8_t *luma, uint32_t width, uint32_t height, uint32_t stride, MotionResult *result);
+  /**
+   * @brief Drops the background. The next frame is treated as the first frame.
+   */
+  void Reset();
+
+ private:
+  void Prepare(uint32_t width, uint32_t height);
+  void BuildRegions();
+  void FindRegions(std::vector<CnedkTransformRect> *rois);
+
+  MotionGateParams params_;
+  std::vector<CnedkTransformRect> include_;
+  std::vector<CnedkTransformRect> exclude_;
+  bool first_frame_ = true;
+  bool active_ = false;
+  uint32_t hold_ = 0;
+  std::vector<CnedkTransformRect> last_rois_;
+
+  uint32_t width_ = 0, height_ = 0;
+  // downsampled size and the grid of cells
+  uint32_t ds_width_ = 0, ds_height_ = 0;
+  uint32_t cell_cols_ = 0, cell_rows_ = 0;
+  uint32_t region_cells_ = 0;
+  std::vector<uint16_t> sum_;
+  std::vector<uint8_t> mask_;
+  std::vector<uint8_t> prev_;
+  // background with 4 fractional bits
+  std::vector<int16_t> background_;
+  std::vector<uint8_t> region_;
+  std::vector<uint32_t> region_count_;
+  // the number of changed pixels of cells, then whether cells are changed
+  std::vector<uint32_t> changed_count_;
+  std::vector<uint8_t> visited_;
+};
+
+}  // namespace cnedk
+
+#endif  // CNEDK_MOTION_GATE_HPP_
@@ -0,0 +1,111 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_MUXER_H_
+#define CNEDK_MUXER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cnedk_encode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/**
+ * Specifies container formats.
+ */
+typedef enum {
+  /** Specifies an invalid container format. */
+  CNEDK_MUXER_FORMAT_INVALID,
+  /** Specifies MPEG transport stream. */
+  CNEDK_MUXER_FORMAT_MPEGTS,
+  /** Specifies fragmented MP4. Each segment file starts with an initialization segment. */
+  CNEDK_MUXER_FORMAT_FMP4,
+  /** Specifies the number of container formats. */
+  CNEDK_MUXER_FORMAT_NUM
+} CnedkMuxerFormat;
+
+/**
+ * Holds the parameters for creating muxer.
+ */
+typedef struct CnedkMuxerCreateParams {
+  /** The container format. */
+  CnedkMuxerFormat format;
+  /** The codec type of the stream. Only H264 and H265 are supported. */
+  CnedkVencType codec_type;
+  /** The width of the video. */
+  uint32_t width;
+  /** The height of the video. */
+  uint32_t height;
+  /** The frame rate, used as duration of the last frame. */
+  double frame_rate;
+  /** The number of pts ticks per second. 90000 is used if it is 0. */
+  uint32_t pts_timescale;
+  /**
+   * The path of output files. If segment rotation is enabled, it must contain exactly one printf-style integer
+   * conversion (e.g. "record_%04d.ts") which is replaced by the segment index, and no other '%'. Otherwise the path
+   * is used as it is.
+   */
+  const char *file_path;
+  /** Starts a new segment at the next key frame once the segment lasts for the duration. 0 means unlimited. */
+  uint32_t segment_duration_ms;
+  /** Starts a new segment at the next key frame once the segment exceeds the size in bytes. 0 means unlimited. */
+  uint64_t segment_size;
+  /**
+   * The maximum size in bytes of data waiting to be written to files. CnedkMuxerWrite blocks if it is exceeded.
+   * 16MB is used if it is 0.
+   */
+  uint32_t max_buffer_size;
+} CnedkMuxerCreateParams;
+
+/**
+ * @brief Creates a muxer with the given parameters.
+ *
+ * @param[out] muxer A pointer points to the pointer of a muxer.
+ * @param[in] params The parameters for creating muxer.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int CnedkMuxerCreate(void **muxer, CnedkMuxerCreateParams *params);
+/**
+ * @brief Destroys a muxer. Data not written yet is flushed to file before return.
+ *
+ * @param[in] muxer A pointer of a muxer.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int CnedkMuxerDestroy(void *muxer);
+/**
+ * @brief Writes one encoded packet to a muxer. Packets before the first key frame are dropped.
+ *
+ * @param[in] muxer A pointer of a muxer.
+ * @param[in] framebits The encoded packet in Annex-B format, e.g. from OnFrameBits callback of encoder.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ *
+ * @note Parameter sets are taken from CNEDK_VENC_PACKAGE_TYPE_SPS_PPS packets or from the key frame itself.
+ */
+int CnedkMuxerWrite(void *muxer, CnedkVEncFrameBits *framebits);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif  // CNEDK_MUXER_H_
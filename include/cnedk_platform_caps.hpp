@@ -0,0 +1,205 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_PLATFORM_CAPS_HPP_
+#define CNEDK_PLATFORM_CAPS_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "cnedk_buf_surface.h"
+#include "cnedk_platform.h"
+
+namespace cnedk {
+
+/**
+ * @brief Holds the limits of a video codec. 0 means the limit is unknown.
+ */
+struct CodecLimits {
+  /// The max width of frames
+  uint32_t max_width = 0;
+  /// The max height of frames
+  uint32_t max_height = 0;
+  /// The max number of codec instances on the device
+  uint32_t max_instances = 0;
+};
+
+/**
+ * @brief Holds the capabilities of a device.
+ */
+struct DeviceCaps {
+  /// The device id
+  int device_id = -1;
+  /// The name of the device, e.g. "MLU370" or "CE3226"
+  std::string name;
+  /// Whether supporting unified address
+  bool support_unified_addr = false;
+  /// Whether supporting map host memory
+  bool can_map_host_memory = false;
+  /// The memory types which could be allocated on the device, CNEDK_BUF_MEM_DEFAULT excluded
+  std::vector<CnedkBufSurfaceMemType> mem_types;
+  /// The limits of the decoder
+  CodecLimits decode;
+  /// The limits of the encoder
+  CodecLimits encode;
+  /// The NUMA node which the device is attached to. -1 if unknown
+  int numa_node = -1;
+
+  /**
+   * @brief Checks whether the memory type could be allocated on the device.
+   *
+   * @param[in] type The memory type.
+   *
+   * @return Returns true if supported. CNEDK_BUF_MEM_DEFAULT is always supported.
+   */
+  bool SupportMemType(CnedkBufSurfaceMemType type) const;
+  /**
+   * @brief Gets the memory type which CNEDK_BUF_MEM_DEFAULT stands for.
+   *
+   * @return Returns CNEDK_BUF_MEM_UNIFIED if supporting unified address, otherwise CNEDK_BUF_MEM_DEVICE.
+   */
+  CnedkBufSurfaceMemType DefaultMemType() const {
+    return support_unified_addr ? CNEDK_BUF_MEM_UNIFIED : CNEDK_BUF_MEM_DEVICE;
+  }
+  /**
+   * @brief Fills the capabilities of a device from its name and the attributes queried from the driver,
+   *        i.e. the memory types and the codec limits.
+   *
+   * @param[in] device_id The device id.
+   * @param[in] name The name of the device.
+   * @param[in] support_unified_addr Whether supporting unified address.
+   * @param[in] can_map_host_memory Whether supporting map host memory.
+   *
+   * @return Returns the capabilities.
+   */
+  static DeviceCaps Make(int device_id, const std::string &name, bool support_unified_addr,
+                         bool can_map_host_memory);
+};
+
+/**
+ * @brief Holds the CPUs of a NUMA node.
+ */
+struct NumaNode {
+  /// The id of the node
+  int id = 0;
+  /// The ids of the online CPUs on the node
+  std::vector<int> cpus;
+};
+
+/**
+ * @brief Holds the CPU topology of the host.
+ */
+struct CpuTopology {
+  /// The number of online logical cores
+  int logical_cores = 0;
+  /// The number of physical cores, hyper-threads counted once
+  int physical_cores = 0;
+  /// The NUMA nodes. There is a single node holding all CPUs if NUMA is not available
+  std::vector<NumaNode> numa_nodes;
+};
+
+/**
+ * @class PlatformCaps
+ *
+ * @brief PlatformCaps is the process-wide cache of the device capabilities and the CPU topology.
+ *
+ * @note Devices are probed once, on first use. After that, queries are lock-free and do not call the driver.
+ *       A failed probe is not cached and will be retried by the next query.
+ */
+class PlatformCaps {
+ public:
+  /**
+   * @brief Gets the instance of PlatformCaps.
+   *
+   * @return Returns the instance.
+   */
+  static PlatformCaps &Instance();
+  /**
+   * @brief Gets the number of devices.
+   *
+   * @return Returns the number of devices, or -1 if probing failed.
+   */
+  int DeviceCount();
+  /**
+   * @brief Gets the capabilities of a device.
+   *
+   * @param[in] device_id The device id.
+   *
+   * @return Returns the capabilities, which stay valid until the process exits. Returns nullptr if the device id is
+   *         invalid or probing failed.
+   */
+  const DeviceCaps *GetDevice(int device_id);
+  /**
+   * @brief Gets the information of a device in the form of CnedkPlatformInfo.
+   *
+   * @param[in] device_id The device id.
+   * @param[out] info The information.
+   *
+   * @return Returns true if this function has run successfully. Otherwise returns false.
+   */
+  bool GetInfo(int device_id, CnedkPlatformInfo *info);
+  /**
+   * @brief Gets the CPU topology of the host.
+   *
+   * @return Returns the topology.
+   */
+  CpuTopology Topology();
+  /**
+   * @brief Gets the CPUs close to a device, i.e. the CPUs on the same NUMA node.
+   *
+   * @param[in] device_id The device id.
+   *
+   * @return Returns the ids of the CPUs. Returns all CPUs if the NUMA node of the device is unknown.
+   */
+  std::vector<int> DeviceCpus(int device_id);
+  /**
+   * @brief Replaces the probed capabilities, e.g. with a fake device table for testing on CPU.
+   *
+   * @param[in] devices The capabilities of devices, indexed by device id.
+   * @param[in] topology The CPU topology.
+   */
+  void Inject(const std::vector<DeviceCaps> &devices, const CpuTopology &topology);
+  /**
+   * @brief Drops the cached capabilities, so that devices will be probed again on next query.
+   */
+  void Reset();
+
+ private:
+  PlatformCaps() = default;
+  ~PlatformCaps();
+  PlatformCaps(const PlatformCaps &) = delete;
+  PlatformCaps &operator=(const PlatformCaps &) = delete;
+  struct Table;
+  const Table *Load();
+  void Publish(std::unique_ptr<Table> table);
+
+  std::atomic<const Table *> table_{nullptr};
+  std::mutex mutex_;
+  // tables are never freed before exit, since readers may still hold pointers to them
+  std::vector<std::unique_ptr<Table>> tables_;
+};
+
+}  // namespace cnedk
+
+#endif  // CNEDK_PLATFORM_CAPS_HPP_
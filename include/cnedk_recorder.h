@@ -0,0 +1,113 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_RECORDER_H_
+#define CNEDK_RECORDER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cnedk_encode.h"
+#include "cnedk_muxer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+/**
+ * Holds the parameters for creating event recorder.
+ */
+typedef struct CnedkRecorderCreateParams {
+  /**
+   * The parameters of clip files. file_path must contain exactly one printf-style integer conversion
+   * (e.g. "event_%04d.mp4") which is replaced by the clip index, and no other '%'. Segment rotation is not supported.
+   */
+  CnedkMuxerCreateParams muxer_params;
+  /** The duration in milliseconds kept before a trigger. The clip starts at the key frame before this duration. */
+  uint32_t pre_record_ms;
+  /** The duration in milliseconds recorded after the last trigger. */
+  uint32_t post_record_ms;
+  /**
+   * The callback function invoked after a clip file is finished. Clips are finished in a background thread of the
+   * recorder and it is called in that thread, recorder functions must not be called in it. It could be nullptr.
+   */
+  void (*OnClipDone)(const char *file_path, void *userdata);
+  /** The user data passed to OnClipDone. */
+  void *userdata;
+} CnedkRecorderCreateParams;
+
+/**
+ * @brief Creates an event recorder. The recorder keeps recent packets in memory, and writes them to a clip file
+ *        when it is triggered.
+ *
+ * @param[out] recorder A pointer points to the pointer of a recorder.
+ * @param[in] params The parameters for creating recorder.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int CnedkRecorderCreate(void **recorder, CnedkRecorderCreateParams *params);
+/**
+ * @brief Destroys an event recorder. The clip being recorded is finished.
+ *
+ * @param[in] recorder A pointer of a recorder.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int CnedkRecorderDestroy(void *recorder);
+/**
+ * @brief Writes one encoded packet to a recorder. Packets must be in presentation order of a single stream.
+ *
+ * @param[in] recorder A pointer of a recorder.
+ * @param[in] framebits The encoded packet in Annex-B format. Data is copied.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int CnedkRecorderWrite(void *recorder, CnedkVEncFrameBits *framebits);
+/**
+ * @brief Triggers an event at the time of the latest packet written. A new clip is started if no clip is being
+ *        recorded, otherwise the current clip is extended.
+ *
+ * @param[in] recorder A pointer of a recorder.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int CnedkRecorderTrigger(void *recorder);
+/**
+ * @brief Sets the limit in bytes of memory used by packets kept in all recorders. The limit is shared evenly by
+ *        recorders, and the oldest GOPs of a recorder are discarded if its share is exceeded. The default limit is
+ *        256MB.
+ *
+ * @param[in] limit The memory limit in bytes.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int CnedkRecorderSetMemoryLimit(uint64_t limit);
+/**
+ * @brief Gets the memory in bytes used by packets kept in all recorders.
+ *
+ * @param[out] usage The memory usage in bytes.
+ *
+ * @return Returns 0 if this function has run successfully. Otherwise returns -1.
+ */
+int CnedkRecorderGetMemoryUsage(uint64_t *usage);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif  // CNEDK_RECORDER_H_
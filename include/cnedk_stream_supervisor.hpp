@@ -0,0 +1,294 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_STREAM_SUPERVISOR_HPP_
+#define CNEDK_STREAM_SUPERVISOR_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace cnedk {
+
+/**
+ * @brief Health state of a supervised stream.
+ */
+enum class StreamHealth {
+  /// The first connection is being made
+  CONNECTING,
+  /// Packets are being received
+  LIVE,
+  /// No packet is received for longer than stall timeout, the connection is still kept
+  STALLED,
+  /// The connection is lost, reconnecting after backoff
+  RECONNECTING,
+  /// Reconnection is given up
+  FAILED
+};
+
+/**
+ * @brief Gets the name of a health state.
+ *
+ * @param[in] health The health state.
+ *
+ * @return Returns the name, e.g. "LIVE".
+ */
+const char *StreamHealthName(StreamHealth health);
+
+/**
+ * @brief A packet read from a stream source.
+ */
+struct StreamPacket {
+  /// The data of the packet
+  const uint8_t *data = nullptr;
+  /// The size of the packet
+  size_t size = 0;
+  /// The presentation timestamp
+  int64_t pts = 0;
+  /// Whether the packet is a key frame
+  bool key_frame = false;
+  /// The packet of the source, e.g. an AVPacket, which is passed through to the sink
+  void *priv = nullptr;
+};
+
+/**
+ * @brief Result of reading a stream source.
+ */
+enum class StreamReadStatus {
+  /// A packet is read
+  OK,
+  /// The end of stream is reached
+  EOS,
+  /// Reading failed or is interrupted
+  ERROR
+};
+
+/**
+ * @class StreamSource
+ *
+ * @brief StreamSource is the interface of a reconnectable stream, e.g. a demuxer of an RTSP stream.
+ *
+ * @note Open, Read and Close are called in the supervisor thread. Interrupt is called in the watchdog thread or the
+ *       thread stopping the supervisor.
+ */
+class StreamSource {
+ public:
+  /**
+   * @brief A destructor to destruct a StreamSource object.
+   */
+  virtual ~StreamSource() = default;
+  /**
+   * @brief Opens the stream. It is called again for every reconnection. Close is called after every Open, even if
+   *        Open fails.
+   *
+   * @return Returns true if the stream is opened, otherwise returns false.
+   */
+  virtual bool Open() = 0;
+  /**
+   * @brief Reads the next packet. Blocks until a packet is read or the source is interrupted.
+   *
+   * @param[out] packet The packet, which is valid until the next Read or Close.
+   *
+   * @return Returns the read status.
+   */
+  virtual StreamReadStatus Read(StreamPacket *packet) = 0;
+  /**
+   * @brief Closes the stream.
+   */
+  virtual void Close() = 0;
+  /**
+   * @brief Makes the pending and following Open and Read fail as soon as possible, until Close is called.
+   */
+  virtual void Interrupt() = 0;
+};
+
+/**
+ * @class StreamSink
+ *
+ * @brief StreamSink is the interface of the consumer of a supervised stream, usually a decoder.
+ *
+ * @note All functions are called in the supervisor thread.
+ */
+class StreamSink {
+ public:
+  /**
+   * @brief A destructor to destruct a StreamSink object.
+   */
+  virtual ~StreamSink() = default;
+  /**
+   * @brief Receives a packet. The first packet after connected is always a key frame.
+   *
+   * @param[in] packet The packet.
+   *
+   * @return Returns false if the packet can not be decoded, otherwise returns true.
+   */
+  virtual bool OnPacket(const StreamPacket &packet) = 0;
+  /**
+   * @brief Resets the decoder after the connection is lost. Frames already sent downstream should be kept, and no
+   *        end of stream should be sent downstream.
+   */
+  virtual void OnReset() = 0;
+  /**
+   * @brief Notifies the end of stream, after the source reaches the end or the stream fails.
+   */
+  virtual void OnEos() = 0;
+};
+
+/**
+ * @brief A health state change of a supervised stream.
+ */
+struct StreamHealthEvent {
+  /// The previous state
+  StreamHealth from;
+  /// The current state
+  StreamHealth to;
+  /// The number of failed connections in a row
+  uint32_t retry_count = 0;
+  /// The delay before the next connection, valid for RECONNECTING
+  uint32_t backoff_ms = 0;
+  /// Why the state is changed
+  std::string reason;
+};
+
+/**
+ * @brief Parameters of a StreamSupervisor.
+ */
+struct StreamSupervisorParams {
+  /// The stream becomes STALLED if no packet is received for this long
+  uint32_t stall_timeout_ms = 3000;
+  /// The connection is dropped and made again if no packet is received for this long
+  uint32_t reconnect_timeout_ms = 10000;
+  /// The connection is dropped if no packet is received for this long after opening
+  uint32_t connect_timeout_ms = 10000;
+  /// The delay before the first reconnection
+  uint32_t initial_backoff_ms = 500;
+  /// The maximum delay before a reconnection
+  uint32_t max_backoff_ms = 30000;
+  /// The delay is multiplied by this for each failed connection in a row
+  uint32_t backoff_multiplier = 2;
+  /// The stream is FAILED after this many failed connections in a row, -1 for no limit
+  int max_retries = -1;
+  /// The connection is dropped if the sink fails to take this many packets in a row
+  uint32_t max_packet_errors = 16;
+  /// Whether to reconnect at the end of stream, true for live streams and false for files
+  bool reconnect_on_eos = true;
+  /// Receives health events, called in the supervisor thread or the watchdog thread, but never concurrently
+  std::function<void(const StreamHealthEvent &)> on_event;
+};
+
+/**
+ * @class StreamSupervisor
+ *
+ * @brief StreamSupervisor reads packets from a StreamSource into a StreamSink, watches the health of the stream and
+ *        reconnects with exponential backoff if the stream is lost, stalled for too long or keeps failing to decode.
+ *        The sink is reset on reconnection, the pipeline downstream of the sink is kept.
+ */
+class StreamSupervisor {
+ public:
+  /**
+   * @brief A constructor to construct a StreamSupervisor object.
+   *
+   * @param[in] source The stream source, which must outlive the supervisor.
+   * @param[in] sink The stream sink, which must outlive the supervisor.
+   * @param[in] params The parameters.
+   */
+  StreamSupervisor(StreamSource *source, StreamSink *sink, const StreamSupervisorParams &params);
+  /**
+   * @brief A destructor to destruct a StreamSupervisor object. The supervisor is stopped.
+   */
+  ~StreamSupervisor();
+  /**
+   * @brief Starts the supervisor thread and the watchdog thread.
+   */
+  void Start();
+  /**
+   * @brief Interrupts the source and stops all threads. OnEos of the sink is not called.
+   */
+  void Stop();
+  /**
+   * @brief Waits for the stream to be done, which is the end of stream or FAILED.
+   *
+   * @param[in] timeout_ms The maximum time to wait.
+   *
+   * @return Returns true if the stream is done, otherwise returns false.
+   */
+  bool Wait(uint32_t timeout_ms);
+  /**
+   * @brief Gets the health state.
+   *
+   * @return Returns the health state.
+   */
+  StreamHealth GetHealth() const;
+  /**
+   * @brief Gets the number of reconnections made.
+   *
+   * @return Returns the number of reconnections.
+   */
+  uint32_t GetReconnectCount() const;
+
+ private:
+  StreamSupervisor(const StreamSupervisor &) = delete;
+  StreamSupervisor &operator=(const StreamSupervisor &) = delete;
+
+  using Clock = std::chrono::steady_clock;
+
+  void Run();
+  void WatchLoop();
+  // returns the reason why the connection ends
+  std::string Serve(bool *eos);
+  // starts watching a connection, returns false if stopped
+  bool Arm(uint32_t timeout_ms);
+  void Disarm();
+  void Finish();
+  bool IsRunning() const;
+  uint32_t Backoff(uint32_t retry_count) const;
+  void Transition(StreamHealth to, const std::string &reason, uint32_t backoff_ms = 0);
+  void OnPacketReceived(bool accepted);
+
+  StreamSource *source_;
+  StreamSink *sink_;
+  StreamSupervisorParams params_;
+
+  // serializes health events, taken before mutex_
+  std::mutex event_mutex_;
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  StreamHealth health_ = StreamHealth::CONNECTING;
+  bool running_ = false;
+  bool done_ = false;
+  bool armed_ = false;
+  bool interrupted_ = false;
+  uint32_t retry_count_ = 0;
+  uint32_t reconnect_count_ = 0;
+  Clock::time_point last_packet_;
+  // the source is interrupted if no packet is received before the deadline
+  Clock::time_point deadline_;
+  std::thread thread_;
+  std::thread watchdog_;
+};  // class StreamSupervisor
+
+}  // namespace cnedk
+
+#endif  // CNEDK_STREAM_SUPERVISOR_HPP_
@@ -0,0 +1,282 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_STREAM_TIMING_HPP_
+#define CNEDK_STREAM_TIMING_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+
+#include "cnedk_buf_surface.h"
+
+namespace cnedk {
+
+/// The rate of media clock, in ticks per second
+constexpr int64_t kMediaClockRate = 90000;
+/// Marks a missing timestamp, the same as AV_NOPTS_VALUE
+constexpr int64_t kNoPts = std::numeric_limits<int64_t>::min();
+
+/**
+ * @class Clock
+ *
+ * @brief Clock is the source of wall clock time, so that timing could be tested with a virtual clock.
+ */
+class Clock {
+ public:
+  /// The function called after the default clock is replaced
+  using DefaultListener = std::function<void()>;
+  /**
+   * @brief A destructor to destruct a Clock object.
+   */
+  virtual ~Clock() = default;
+  /**
+   * @brief Gets the current time.
+   *
+   * @return Returns the monotonic time in microseconds.
+   */
+  virtual int64_t NowUs() = 0;
+  /**
+   * @brief Sleeps until the given time. Returns immediately if the time has passed.
+   *
+   * @param[in] time_us The time in microseconds.
+   */
+  virtual void SleepUntilUs(int64_t time_us) = 0;
+  /**
+   * @brief Gets the default clock, which is based on std::chrono::steady_clock unless it is replaced by SetDefault().
+   *
+   * @return Returns the pointer of the clock.
+   */
+  static Clock *Default();
+  /**
+   * @brief Replaces the default clock, e.g. with a VirtualClock to run deterministically. Timers of InferServer and
+   *        pacers created afterwards use it.
+   *
+   * @param[in] clock The clock, nullptr restores the clock based on std::chrono::steady_clock.
+   *
+   * @note The clock must be alive until the default clock is set again.
+   */
+  static void SetDefault(Clock *clock);
+  /**
+   * @brief Sets the listener of an owner, e.g. timers following the replaced clock. Listeners are called in the thread
+   *        replacing the default clock.
+   *
+   * @param[in] owner The owner of the listener, the listener of the same owner is replaced.
+   * @param[in] listener The listener, nullptr removes the listener of the owner.
+   */
+  static void SetDefaultListener(const void *owner, DefaultListener listener);
+};
+
+/**
+ * @class VirtualClock
+ *
+ * @brief VirtualClock is a clock driven manually. Sleeping moves the time forward immediately.
+ */
+class VirtualClock : public Clock {
+ public:
+  /// The function called with the current time after the time moves forward
+  using Listener = std::function<void(int64_t now_us)>;
+  /**
+   * @brief A constructor to construct a VirtualClock object.
+   *
+   * @param[in] start_us The start time in microseconds.
+   */
+  explicit VirtualClock(int64_t start_us = 0) : now_us_(start_us) {}
+  int64_t NowUs() override { return now_us_.load(); }
+  void SleepUntilUs(int64_t time_us) override;
+  /**
+   * @brief Moves the time forward.
+   *
+   * @param[in] us The duration in microseconds.
+   */
+  void AdvanceUs(int64_t us);
+  /**
+   * @brief Sets the listener of an owner, e.g. timers due by the time. Listeners are called in the thread moving the
+   *        time forward, in the order of owners.
+   *
+   * @param[in] owner The owner of the listener, the listener of the same owner is replaced.
+   * @param[in] listener The listener, nullptr removes the listener of the owner.
+   */
+  void SetListener(const void *owner, Listener listener);
+  /**
+   * @brief Gets the total duration slept.
+   *
+   * @return Returns the duration in microseconds.
+   */
+  int64_t GetSleptUs() const { return slept_us_.load(); }
+
+ private:
+  void Notify();
+
+  std::atomic<int64_t> now_us_;
+  std::atomic<int64_t> slept_us_{0};
+  std::mutex listener_mutex_;
+  std::map<const void *, Listener> listeners_;
+};
+
+/**
+ * @brief Holds the parameters of stream timing.
+ */
+struct StreamTimingParams {
+  /// The numerator of the time base of pts, e.g. 1 for 1/90000
+  int time_base_num = 1;
+  /// The denominator of the time base of pts
+  int time_base_den = 90000;
+  /// The frame rate, used to fill missing pts and to bridge discontinuities
+  double frame_rate = 25;
+  /// The number of bits of pts before it wraps around, e.g. 33 for MPEG-TS. 0 or 64 for no wraparound
+  uint32_t pts_wrap_bits = 0;
+  /// Jumps of pts larger than this, forward or backward, are discontinuities
+  int64_t max_gap_ms = 2000;
+};
+
+/**
+ * @class StreamTiming
+ *
+ * @brief StreamTiming converts timestamps of a stream to a 90 kHz media clock.
+ *
+ * The media clock starts from 0 and keeps going forward: pts wraparound is unwrapped, and on a discontinuity (e.g. the
+ * source is reconnected or looped) the clock continues one frame after the latest media time. Missing pts is filled by
+ * the frame rate. Small backward steps are kept, so that reordered frames (B-frames in decoding order) keep their
+ * order.
+ *
+ * It also records the capture time of packets by media time, decoded frames are stamped with it later, so that end to
+ * end latency could be measured.
+ *
+ * @note ToMediaTime and Rebase are supposed to be called in one thread. RecordCapture and Stamp are thread-safe.
+ */
+class StreamTiming {
+ public:
+  /**
+   * @brief A constructor to construct a StreamTiming object.
+   *
+   * @param[in] params The parameters.
+   */
+  explicit StreamTiming(const StreamTimingParams &params = StreamTimingParams());
+  /**
+   * @brief Converts pts to media time.
+   *
+   * @param[in] pts The pts in time base, or kNoPts if it is missing.
+   *
+   * @return Returns the media time in 90 kHz.
+   */
+  int64_t ToMediaTime(int64_t pts);
+  /**
+   * @brief Switches to a new source, e.g. the stream is reopened. The media clock continues from the latest time.
+   *
+   * @param[in] params The parameters of the new source.
+   */
+  void Rebase(const StreamTimingParams &params);
+  /**
+   * @brief Restarts the media clock from 0 and clears recorded capture time.
+   */
+  void Reset();
+  /**
+   * @brief Records the capture time of a packet.
+   *
+   * @param[in] media_time The media time of the packet.
+   * @param[in] capture_us The capture time in microseconds, e.g. Clock::Default()->NowUs().
+   */
+  void RecordCapture(int64_t media_time, int64_t capture_us);
+  /**
+   * @brief Stamps a decoded frame, whose pts is media time, with the capture time of the packet.
+   *
+   * @param[in] surf The decoded frame.
+   *
+   * @return Returns true if the capture time is found, otherwise returns false and capture_time is set to 0.
+   */
+  bool Stamp(CnedkBufSurface *surf);
+  /**
+   * @brief Gets the number of discontinuities.
+   */
+  uint64_t GetDiscontinuityCount() const { return discontinuity_count_; }
+  /**
+   * @brief Gets the number of pts wraparounds.
+   */
+  uint64_t GetWrapCount() const { return wrap_count_; }
+
+ private:
+  int64_t Unwrap(int64_t pts);
+  int64_t FrameDuration() const;
+
+  StreamTimingParams params_;
+  bool started_ = false;
+  bool unwrap_started_ = false;
+  bool has_media_ = false;
+  int64_t last_unwrapped_ = 0;    // in time base
+  int64_t last_time_ = 0;         // last converted pts in 90 kHz, before offset
+  int64_t offset_ = 0;            // media time - converted pts
+  int64_t max_media_time_ = 0;
+  uint64_t discontinuity_count_ = 0;
+  uint64_t wrap_count_ = 0;
+
+  std::mutex capture_mutex_;
+  std::map<int64_t, int64_t> capture_times_;
+  static constexpr size_t kMaxCaptureRecords = 256;
+};  // class StreamTiming
+
+/**
+ * @class PlaybackPacer
+ *
+ * @brief PlaybackPacer paces a stored stream as if it is a live one, frames are released at the wall clock time of
+ *        their media time.
+ *
+ * The first frame anchors media time to wall clock. If the sender falls behind, or media time jumps, by more than the
+ * max lag, the pacer is anchored again instead of bursting or stalling.
+ */
+class PlaybackPacer {
+ public:
+  /**
+   * @brief A constructor to construct a PlaybackPacer object.
+   *
+   * @param[in] clock The wall clock.
+   * @param[in] max_lag_ms The max lag before anchored again.
+   */
+  explicit PlaybackPacer(Clock *clock = Clock::Default(), int64_t max_lag_ms = 1000)
+      : clock_(clock), max_lag_us_(max_lag_ms * 1000) {}
+  /**
+   * @brief Waits until the wall clock time of a frame.
+   *
+   * @param[in] media_time The media time of the frame in 90 kHz.
+   *
+   * @return Returns how late the frame is in microseconds, 0 if it is on time.
+   */
+  int64_t Pace(int64_t media_time);
+  /**
+   * @brief Anchors again with the next frame.
+   */
+  void Reset() { anchored_ = false; }
+
+ private:
+  void Anchor(int64_t media_time, int64_t now_us);
+
+  Clock *clock_;
+  int64_t max_lag_us_;
+  bool anchored_ = false;
+  int64_t anchor_media_time_ = 0;
+  int64_t anchor_us_ = 0;
+};  // class PlaybackPacer
+
+}  // namespace cnedk
+
+#endif  // CNEDK_STREAM_TIMING_HPP_
@@ -46,6 +46,10 @@ enum class DataType {
   FLOAT16 = 2,
   INT16 = 3,
   INT32 = 4,
+  INT8 = 5,
+  BF16 = 6,
+  INT64 = 7,
+  BOOL = 8,
   INVALID = 0xFFFF,
 };
 
@@ -64,12 +68,26 @@ enum class DimOrder {
   INVALID = 0xFFFF,
 };
 
+/**
+ * @brief Affine quantization parameters, real value = (quantized value - zero point) * scale
+ *
+ * @note Data is not quantized if scales is empty. A single scale applies to the whole tensor,
+ *       otherwise each channel along dim `axis` has its own scale.
+ *       Zero points are zero if empty, otherwise they are as many as scales.
+ */
+struct QuantParams {
+  std::vector<float> scales;         ///< scale of tensor or each channel
+  std::vector<int32_t> zero_points;  ///< zero point of tensor or each channel
+  int axis{1};                       ///< dim of channels in per-channel quantization
+};
+
 /**
  * @brief Describe data layout on MLU or CPU
  */
 struct DataLayout {
-  DataType dtype;  ///< @see DataType
-  DimOrder order;  ///< @see DimOrder
+  DataType dtype;     ///< @see DataType
+  DimOrder order;     ///< @see DimOrder
+  QuantParams quant;  ///< quantization of integer data, @see QuantParams
 };
 
 /**
@@ -80,6 +98,23 @@ struct DataLayout {
  */
 size_t GetTypeSize(DataType type) noexcept;
 
+/**
+ * @brief Cast data on CPU from src layout to dst layout
+ *
+ * @note Integer data with quantization parameters is dequantized when read and quantized when written,
+ *       which rounds to nearest even and saturates. Dim orders of layouts are ignored.
+ *
+ * @param src source data
+ * @param dst destination data, size of which is shape.BatchDataCount() * GetTypeSize(dst_layout.dtype)
+ * @param src_layout layout of source data
+ * @param dst_layout layout of destination data
+ * @param shape shape of data
+ * @retval true Succeeded
+ * @retval false Failed, unsupported data type or mismatched quantization parameters
+ */
+bool CastHostData(const void* src, void* dst, const DataLayout& src_layout, const DataLayout& dst_layout,
+                  const Shape& shape) noexcept;
+
 /**
  * @brief An enum describes InferServer request return values.
  */
@@ -321,6 +356,10 @@ struct InferData {
   RequestControl* ctrl{nullptr};
   /// private member
   uint32_t index{0};
+  /// private member, pre-made model input of the request, this data is the `io_index`-th item in it
+  std::shared_ptr<InferData> predict_io{nullptr};
+  /// private member
+  uint32_t io_index{0};
 };
 
 using InferDataPtr = std::shared_ptr<InferData>;
@@ -408,6 +447,7 @@ class Processor : public BaseObject {
  private:
   Processor() = delete;
   friend class TaskNode;
+  friend class SharedPredictor;
   std::unique_lock<std::mutex> Lock() noexcept { return std::unique_lock<std::mutex>(process_lock_); }
   std::string type_name_;
   std::mutex process_lock_;
@@ -490,6 +530,88 @@ enum class NetworkInputFormat {
   INVALID = 0xFFFF,
 };
 
+/**
+ * @brief Trace of batch boundaries, to reproduce batching of a run
+ *
+ * Batches are recorded as the session cache emits them. Each data in a batch is identified by request id, which is the
+ * sequence number of the request in session, and the index of data in the request.
+ *
+ * A trace constructed with recorded batches replays them: under BatchStrategy::DYNAMIC, a batch is emitted once all of
+ * its data arrives, regardless of batch timeout, so that batching is identical to the recorded run as long as requests
+ * are sent in the same order. Replay ends at the first data which does not match, and the rest is batched by timeout.
+ *
+ * @note Trace is held by the executor, which is shared by sessions with the same model and processors.
+ *       Those sessions should not send requests at the same time while tracing.
+ */
+class BatchTrace {
+ public:
+  /// Data of a batch, in pair of (request id, index of data)
+  using Batch = std::vector<std::pair<int64_t, uint32_t>>;
+
+  /**
+   * @brief Construct a BatchTrace object to record batches
+   */
+  BatchTrace() = default;
+
+  /**
+   * @brief Construct a BatchTrace object to replay batches, batches are recorded as well
+   *
+   * @param replay Batches to be replayed
+   */
+  explicit BatchTrace(std::vector<Batch> replay) noexcept : replay_(std::move(replay)) {}
+
+  /**
+   * @brief Get recorded batches
+   *
+   * @return std::vector<Batch> Recorded batches
+   */
+  std::vector<Batch> GetBatches() const noexcept;
+
+  /**
+   * @brief Serialize recorded batches into text, one batch per line, e.g. "0:0 0:1 1:0"
+   *
+   * @return std::string Serialized text
+   */
+  std::string Serialize() const noexcept;
+
+  /**
+   * @brief Parse batches from text serialized by Serialize()
+   *
+   * @param text Serialized text
+   * @param[out] batches Parsed batches
+   * @retval true Succeed
+   * @retval false Text is malformed
+   */
+  static bool Parse(const std::string& text, std::vector<Batch>* batches) noexcept;
+
+  /**
+   * @brief Check whether there are batches to be replayed
+   */
+  bool IsReplay() const noexcept { return !replay_.empty(); }
+
+  /**
+   * @brief Get a batch to be replayed
+   *
+   * @param index Index of the batch
+   * @return const Batch* The batch, nullptr if index is out of range
+   */
+  const Batch* GetReplayBatch(size_t index) const noexcept {
+    return index < replay_.size() ? &replay_[index] : nullptr;
+  }
+
+  /**
+   * @brief Record a batch, invoked by session cache
+   *
+   * @param batch The batch
+   */
+  void Record(Batch&& batch) noexcept;
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<Batch> batches_;
+  std::vector<Batch> replay_;
+};  // class BatchTrace
+
 /**
  * @brief A struct to describe execution graph
  */
@@ -529,6 +651,13 @@ struct SessionDesc {
   uint32_t engine_num{1};
   /// whether print performance
   bool show_perf{true};
+  /**
+   * @brief trace to record or replay batch boundaries, @see BatchTrace
+   *
+   * @note sessions of the same model, preprocessor and postprocessor share an executor, a trace is only accepted by
+   *       the session which creates the executor, or with the same trace
+   */
+  std::shared_ptr<BatchTrace> batch_trace{nullptr};
 };
 
 /**
@@ -563,6 +692,28 @@ struct ThroughoutStatistic {
   float ups_rt{0};
 };
 
+/**
+ * @brief Resource usage statistics
+ *
+ * @note Time and bytes of a batch are prorated by share of data in the batch
+ */
+struct UsageStatistic {
+  /// total request count
+  uint32_t request_cnt{0};
+  /// total unit count
+  uint32_t unit_cnt{0};
+  /// CPU time consumed by preprocess, in milliseconds
+  double preproc_cpu_time{0};
+  /// CPU time consumed by postprocess, in milliseconds
+  double postproc_cpu_time{0};
+  /// time occupying device by inference, in milliseconds
+  double device_time{0};
+  /// bytes of model input and output
+  double bytes{0};
+  /// time of requests waiting in queue before process, in milliseconds
+  double queue_time{0};
+};
+
 /// A structure describes linked session of server
 class Session;
 /// pointer to Session
@@ -621,6 +772,19 @@ class InferServer {
    */
   bool Request(Session_t session, PackagePtr input, any user_data, int timeout = -1) noexcept;
 
+  /**
+   * @brief send a inference request, and get the id of request to discard it alone, @see DiscardRequest
+   *
+   * @warning async api, can be invoked with async Session only.
+   *
+   * @param session link handle
+   * @param input input package
+   * @param user_data user data
+   * @param request_id id of the request, unique in the session
+   * @param timeout timeout threshold (milliseconds), -1 for endless
+   */
+  bool Request(Session_t session, PackagePtr input, any user_data, int64_t* request_id, int timeout = -1) noexcept;
+
   /**
    * @brief send a inference request and wait for response
    *
@@ -653,6 +817,15 @@ class InferServer {
    */
   void DiscardTask(Session_t session, const std::string& tag) noexcept;
 
+  /**
+   * @brief Discard one request, the other requests with the same tag are not affected
+   *
+   * @note Discarded request is not responded. Nothing is done if the request has been responded
+   * @param session a Session
+   * @param request_id id of the request, @see Request
+   */
+  void DiscardRequest(Session_t session, int64_t request_id) noexcept;
+
   /**
    * @brief Get model from session
    *
@@ -733,6 +906,24 @@ class InferServer {
    */
   ThroughoutStatistic GetThroughout(Session_t session, const std::string& tag) const noexcept;
 
+  /**
+   * @brief Get the resource usage of specified tag
+   *
+   * @note Usage of a tag is accumulated during the lifetime of session, including discarded requests
+   * @param session a session
+   * @param tag tag
+   * @return UsageStatistic usage statistic
+   */
+  UsageStatistic GetUsage(Session_t session, const std::string& tag) const noexcept;
+
+  /**
+   * @brief Get the resource usage of all tags, which is snapshotted periodically (every 2 seconds)
+   *
+   * @param session a session
+   * @return std::map<std::string, UsageStatistic> tag -> usage statistic
+   */
+  std::map<std::string, UsageStatistic> GetUsageSnapshot(Session_t session) const noexcept;
+
  private:
   InferServer() = delete;
   InferServerPrivate* priv_;
@@ -21,7 +21,9 @@
 #ifndef INFER_SERVER_BASE_OBJECT_H_
 #define INFER_SERVER_BASE_OBJECT_H_
 
-#include <map>
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <utility>
@@ -31,6 +33,73 @@
 
 namespace infer_server {
 
+namespace detail {
+/**
+ * @brief Get the id of param name, register the name if it is new
+ *
+ * @note Ids are small integers starting from 0, shared by all objects in the process
+ * @param name Param name
+ * @return size_t Id of param name
+ */
+size_t RegisterParamName(const std::string& name);
+
+/**
+ * @brief Find the id of param name
+ *
+ * @note Lookup takes no lock and allocates nothing, it is safe to call on every param access
+ * @param name Param name
+ * @retval id Id of param name
+ * @retval -1 Param name has not been registered
+ */
+int FindParamId(const std::string& name) noexcept;
+
+/**
+ * @brief Get param name by id
+ *
+ * @param id Id of param name
+ * @return std::string Param name
+ */
+std::string GetParamName(size_t id);
+}  // namespace detail
+
+/**
+ * @brief Typed key of param, name is resolved to id once on construction
+ *
+ * @note Define keys as static objects and reuse them, e.g.
+ *       `static const ParamKey<int> kDeviceId("device_id");`.
+ *       Params set by name could be got by key, and vice versa.
+ * @tparam T Param type
+ */
+template <typename T>
+class ParamKey {
+  static_assert(std::is_same<T, decay_t<T>>::value, "Param type must be a decayed type");
+
+ public:
+  /**
+   * @brief Construct a new ParamKey object
+   *
+   * @param name Unique param name
+   */
+  explicit ParamKey(const std::string& name) : id_(detail::RegisterParamName(name)) {}
+
+  /**
+   * @brief Get id of the key
+   *
+   * @return size_t Id
+   */
+  size_t Id() const noexcept { return id_; }
+
+  /**
+   * @brief Get name of the key
+   *
+   * @return std::string Param name
+   */
+  std::string Name() const { return detail::GetParamName(id_); }
+
+ private:
+  size_t id_;
+};
+
 /**
  * @brief Params object base class
  */
@@ -45,7 +114,7 @@ class BaseObject {
    */
   template <typename T>
   void SetParams(const std::string& param_name, T&& param) {
-    params_[param_name] = std::forward<T>(param);
+    Slot(detail::RegisterParamName(param_name)) = std::forward<T>(param);
   }
 
   /**
@@ -59,7 +128,36 @@ class BaseObject {
    */
   template <typename T, typename... Args>
   void SetParams(const std::string& param_name, T&& param, Args&&... args) {
-    params_[param_name] = std::forward<T>(param);
+    SetParams(param_name, std::forward<T>(param));
+    SetParams(std::forward<Args>(args)...);
+  }
+
+  /**
+   * @brief Set param by typed key
+   *
+   * @tparam T Param type
+   * @tparam U Type of value, which must be convertible to T
+   * @param key Param key
+   * @param param Param value
+   */
+  template <typename T, typename U>
+  void SetParams(const ParamKey<T>& key, U&& param) {
+    Slot(key.Id()).template emplace<T>(std::forward<U>(param));
+  }
+
+  /**
+   * @brief Set params by typed keys
+   *
+   * @tparam T Param type
+   * @tparam U Type of value, which must be convertible to T
+   * @tparam Args Key:param values' type
+   * @param key Param key
+   * @param param Param value
+   * @param args Key:param values
+   */
+  template <typename T, typename U, typename... Args>
+  void SetParams(const ParamKey<T>& key, U&& param, Args&&... args) {
+    SetParams(key, std::forward<U>(param));
     SetParams(std::forward<Args>(args)...);
   }
 
@@ -72,7 +170,37 @@ class BaseObject {
    */
   template <typename T>
   auto GetParam(const std::string& param_name) const -> typename std::remove_reference<T>::type {
-    return any_cast<typename std::remove_reference<T>::type>(params_.at(param_name));
+    return any_cast<typename std::remove_reference<T>::type>(At(param_name));
+  }
+
+  /**
+   * @brief Get param by typed key
+   *
+   * @tparam T Param type
+   * @param key Param key
+   * @return T Specified param
+   */
+  template <typename T>
+  T GetParam(const ParamKey<T>& key) const {
+    const T* param = FindParam(key);
+    if (!param) {
+      if (!HaveParam(key)) throw std::out_of_range("param " + key.Name() + " has not been set");
+      throw bad_any_cast();
+    }
+    return *param;
+  }
+
+  /**
+   * @brief Find param by typed key, without copy
+   *
+   * @tparam T Param type
+   * @param key Param key
+   * @return const T* Pointer to specified param, nullptr if param has not been set or type is mismatched
+   */
+  template <typename T>
+  const T* FindParam(const ParamKey<T>& key) const noexcept {
+    if (key.Id() >= params_.size()) return nullptr;
+    return __any_cast_fast<T>(const_cast<any*>(&params_[key.Id()]));
   }
 
   /**
@@ -84,8 +212,23 @@ class BaseObject {
    */
   template <typename T>
   T PopParam(const std::string& param_name) {
-    T tmp = any_cast<typename std::remove_reference<T>::type>(params_.at(param_name));
-    params_.erase(param_name);
+    any& param = At(param_name);
+    T tmp = any_cast<typename std::remove_reference<T>::type>(param);
+    param.reset();
+    return tmp;
+  }
+
+  /**
+   * @brief Pop param by typed key
+   *
+   * @tparam T Param type
+   * @param key Param key
+   * @return T Specified param
+   */
+  template <typename T>
+  T PopParam(const ParamKey<T>& key) {
+    T tmp = GetParam(key);
+    params_[key.Id()].reset();
     return tmp;
   }
 
@@ -96,7 +239,23 @@ class BaseObject {
    * @retval true Have specified param
    * @retval false Donot have specified param
    */
-  bool HaveParam(const std::string& param_name) noexcept { return params_.find(param_name) != params_.cend(); }
+  bool HaveParam(const std::string& param_name) const noexcept {
+    int id = detail::FindParamId(param_name);
+    return id >= 0 && static_cast<size_t>(id) < params_.size() && params_[id].has_value();
+  }
+
+  /**
+   * @brief Check if object has specified param
+   *
+   * @tparam T Param type
+   * @param key Param key
+   * @retval true Have specified param
+   * @retval false Donot have specified param
+   */
+  template <typename T>
+  bool HaveParam(const ParamKey<T>& key) const noexcept {
+    return key.Id() < params_.size() && params_[key.Id()].has_value();
+  }
 
   /**
    * @brief Get name of stored params
@@ -105,9 +264,10 @@ class BaseObject {
    */
   std::vector<std::string> GetParamNames() noexcept {
     std::vector<std::string> names;
-    for (auto& p : params_) {
-      names.emplace_back(p.first);
+    for (size_t id = 0; id < params_.size(); ++id) {
+      if (params_[id].has_value()) names.emplace_back(detail::GetParamName(id));
     }
+    std::sort(names.begin(), names.end());
     return names;
   }
 
@@ -124,7 +284,26 @@ class BaseObject {
   virtual ~BaseObject() = default;
 
  protected:
-  std::map<std::string, any> params_;
+  /// Params indexed by id of param name
+  std::vector<any> params_;
+
+ private:
+  any& Slot(size_t id) {
+    if (id >= params_.size()) params_.resize(id + 1);
+    return params_[id];
+  }
+
+  const any& At(const std::string& param_name) const {
+    int id = detail::FindParamId(param_name);
+    if (id < 0 || static_cast<size_t>(id) >= params_.size() || !params_[id].has_value()) {
+      throw std::out_of_range("param " + param_name + " has not been set");
+    }
+    return params_[id];
+  }
+
+  any& At(const std::string& param_name) {
+    return const_cast<any&>(static_cast<const BaseObject*>(this)->At(param_name));
+  }
 };
 
 }  // namespace infer_server
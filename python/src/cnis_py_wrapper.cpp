@@ -35,6 +35,7 @@ void DeviceWrapper(py::module *m);
 
 void ShapeWrapper(const py::module &m);
 void SessionDescWrapper(const py::module &m);
+void AsyncSessionWrapper(const py::module &m);
 void ObserverWrapper(const py::module &m);
 void ModelInfoWrapper(const py::module &m);
 void ProcessorWrapper(py::module *m);
@@ -56,6 +57,7 @@ PYBIND11_MODULE(cnis, m) {
 
   ShapeWrapper(m);
   SessionDescWrapper(m);
+  AsyncSessionWrapper(m);
   ObserverWrapper(m);
   ModelInfoWrapper(m);
   ProcessorWrapper(&m);
@@ -141,6 +141,12 @@ py::dtype GetPyDtype(DataType dtype) {
       return py::dtype::of<int16_t>();
     case DataType::INT32:
       return py::dtype::of<int32_t>();
+    case DataType::INT8:
+      return py::dtype::of<int8_t>();
+    case DataType::INT64:
+      return py::dtype::of<int64_t>();
+    case DataType::BOOL:
+      return py::dtype::of<bool>();
     default:
       throw std::invalid_argument("Datatype is not supported.");
       return py::dtype::of<uint8_t>();
@@ -19,6 +19,7 @@
  *************************************************************************/
 
 #include <algorithm>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <utility>
@@ -31,6 +32,7 @@
 #include "pybind11/stl.h"
 
 #include "cnedk_buf_surface.h"
+#include "cnedk_buf_surface_shm.h"
 #include "cnedk_buf_surface_util.hpp"
 #include "cnis/infer_server.h"
 #include "cnis/shape.h"
@@ -348,6 +350,54 @@ void BufferSurfaceWrapper(py::module* m) {
   m->def("cnedk_buf_surface_copy", &CnedkBufSurfaceCopy);
   m->def("cnedk_buf_surface_memset", &CnedkBufSurfaceMemSet);
 
+  py::class_<CnedkBufSurfaceShmHandle>(*m, "CnedkBufSurfaceShmHandle")
+      .def(py::init())
+      .def_property_readonly("name",
+          [](const CnedkBufSurfaceShmHandle& handle) {
+            return std::string(handle.name, strnlen(handle.name, CNEDK_BUF_SHM_NAME_LENGTH));
+          })
+      .def(py::pickle(
+          [](const CnedkBufSurfaceShmHandle& handle) {
+            return py::make_tuple(std::string(handle.name, strnlen(handle.name, CNEDK_BUF_SHM_NAME_LENGTH)));
+          },
+          [](py::tuple state) {
+            if (state.size() != 1) {
+              throw std::invalid_argument("Invalid state of CnedkBufSurfaceShmHandle.");
+            }
+            std::string name = state[0].cast<std::string>();
+            if (name.size() >= CNEDK_BUF_SHM_NAME_LENGTH) {
+              throw std::invalid_argument("Invalid state of CnedkBufSurfaceShmHandle.");
+            }
+            CnedkBufSurfaceShmHandle handle;
+            memset(&handle, 0, sizeof(CnedkBufSurfaceShmHandle));
+            memcpy(handle.name, name.c_str(), name.size());
+            return handle;
+          }));
+
+  m->def("cnedk_buf_surface_create_shared",
+      [](std::shared_ptr<CnedkBufSurfaceCreateParams> params) {
+        CnedkBufSurface* surf = nullptr;
+        CnedkBufSurfaceCreateShared(&surf, params.get());
+        std::shared_ptr<CnedkBufSurface> surf_tmp(surf, [](CnedkBufSurface *p) { });
+        return surf_tmp;
+      });
+  m->def("cnedk_buf_surface_get_shm_handle",
+      [](std::shared_ptr<CnedkBufSurface> surf) {
+        CnedkBufSurfaceShmHandle handle;
+        if (CnedkBufSurfaceGetShmHandle(surf.get(), &handle) != 0) {
+          throw std::invalid_argument("CnedkBufSurface is not allocated in shared memory.");
+        }
+        return handle;
+      });
+  m->def("cnedk_buf_surface_open_shared",
+      [](const CnedkBufSurfaceShmHandle& handle) {
+        CnedkBufSurface* surf = nullptr;
+        CnedkBufSurfaceOpenShared(&surf, &handle);
+        std::shared_ptr<CnedkBufSurface> surf_tmp(surf, [](CnedkBufSurface *p) { });
+        return surf_tmp;
+      });
+  m->def("cnedk_buf_surface_shm_cleanup", &CnedkBufSurfaceShmCleanup);
+
   py::class_<cnedk::BufSurfaceWrapper, std::shared_ptr<cnedk::BufSurfaceWrapper>>(*m, "CnedkBufSurfaceWrapper")
       .def(py::init(
           [](std::shared_ptr<CnedkBufSurface> buf_surf) {
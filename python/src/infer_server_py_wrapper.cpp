@@ -31,6 +31,7 @@
 #include "cnis/processor.h"
 #include "common_wrapper.hpp"
 #include "processor_py_wrapper.hpp"
+#include "session_py_wrapper.hpp"
 
 namespace py = pybind11;
 
@@ -59,6 +60,17 @@ void InferServerWrapper(const py::module& m) {
             }
             return py::capsule(infer_server->CreateSyncSession(desc));
           })
+      .def("create_async_session",
+          [](std::shared_ptr<InferServer> infer_server, SessionDesc desc) -> std::shared_ptr<AsyncSession> {
+            if (!desc.preproc) {
+              VLOG(1) << "[InferServer] [PythonAPI] Default preproc will be used in this asyncio session";
+              desc.preproc = Preprocessor::Create();
+              SetPreprocHandler(desc.model->GetKey(), &default_preproc);
+            }
+            std::shared_ptr<AsyncSession> session = std::make_shared<AsyncSession>(infer_server, desc);
+            if (!session->IsValid()) return nullptr;
+            return session;
+          })
       .def("destroy_session",
           [](std::shared_ptr<InferServer> infer_server, py::capsule session) {
             return infer_server->DestroySession(reinterpret_cast<Session_t>(session.get_pointer()));
@@ -116,7 +128,15 @@ void InferServerWrapper(const py::module& m) {
               return infer_server->GetThroughout(reinterpret_cast<Session_t>(session.get_pointer()));
             }
             return infer_server->GetThroughout(reinterpret_cast<Session_t>(session.get_pointer()), tag);
-          }, py::arg("session"), py::arg("tag") = "");
+          }, py::arg("session"), py::arg("tag") = "")
+      .def("get_usage",
+          [](std::shared_ptr<InferServer> infer_server, py::capsule session, const std::string& tag) {
+            return infer_server->GetUsage(reinterpret_cast<Session_t>(session.get_pointer()), tag);
+          }, py::arg("session"), py::arg("tag"))
+      .def("get_usage_snapshot",
+          [](std::shared_ptr<InferServer> infer_server, py::capsule session) {
+            return infer_server->GetUsageSnapshot(reinterpret_cast<Session_t>(session.get_pointer()));
+          });
 }
 
 void StatusWrapper(const py::module& m) {
@@ -133,6 +153,21 @@ void StatusWrapper(const py::module& m) {
 }
 
 void DataLayoutWrapper(py::module* m) {  // NOLINT
+  py::class_<QuantParams, std::shared_ptr<QuantParams>>(*m, "QuantParams")
+      .def(py::init())
+      .def(py::init(
+          [](const std::vector<float>& scales, const std::vector<int32_t>& zero_points, int axis) {
+            QuantParams quant;
+            quant.scales = scales;
+            quant.zero_points = zero_points;
+            quant.axis = axis;
+            return quant;
+          }),
+          py::arg("scales"), py::arg("zero_points") = std::vector<int32_t>(), py::arg("axis") = 1)
+      .def_readwrite("scales", &QuantParams::scales)
+      .def_readwrite("zero_points", &QuantParams::zero_points)
+      .def_readwrite("axis", &QuantParams::axis);
+
   py::class_<DataLayout, std::shared_ptr<DataLayout>>(*m, "DataLayout")
       .def(py::init())
       .def(py::init(
@@ -142,7 +177,8 @@ void DataLayoutWrapper(py::module* m) {  // NOLINT
           }),
           py::arg("dtype"), py::arg("order"))
       .def_readwrite("dtype", &DataLayout::dtype)
-      .def_readwrite("order", &DataLayout::order);
+      .def_readwrite("order", &DataLayout::order)
+      .def_readwrite("quant", &DataLayout::quant);
 
   m->def("get_type_size", &GetTypeSize);
 
@@ -152,6 +188,10 @@ void DataLayoutWrapper(py::module* m) {  // NOLINT
       .value("FLOAT16", DataType::FLOAT16)
       .value("INT16", DataType::INT16)
       .value("INT32", DataType::INT32)
+      .value("INT8", DataType::INT8)
+      .value("BF16", DataType::BF16)
+      .value("INT64", DataType::INT64)
+      .value("BOOL", DataType::BOOL)
       .value("INVALID", DataType::INVALID);
 
   py::enum_<DimOrder>(*m, "DimOrder")
@@ -205,6 +245,16 @@ void PerfWrapper(py::module* m) {
       .def_readwrite("ups", &ThroughoutStatistic::ups)
       .def_readwrite("rps_rt", &ThroughoutStatistic::rps_rt)
       .def_readwrite("ups_rt", &ThroughoutStatistic::ups_rt);
+
+  py::class_<UsageStatistic>(*m, "UsageStatistic")
+      .def(py::init())
+      .def_readwrite("request_cnt", &UsageStatistic::request_cnt)
+      .def_readwrite("unit_cnt", &UsageStatistic::unit_cnt)
+      .def_readwrite("preproc_cpu_time", &UsageStatistic::preproc_cpu_time)
+      .def_readwrite("postproc_cpu_time", &UsageStatistic::postproc_cpu_time)
+      .def_readwrite("device_time", &UsageStatistic::device_time)
+      .def_readwrite("bytes", &UsageStatistic::bytes)
+      .def_readwrite("queue_time", &UsageStatistic::queue_time);
 }
 
 }  //  namespace infer_server
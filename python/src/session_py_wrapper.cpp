@@ -17,10 +17,17 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
  * THE SOFTWARE.
  *************************************************************************/
+#include "session_py_wrapper.hpp"
+
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "glog/logging.h"
 #include "pybind11/pybind11.h"
+#include "pybind11/stl.h"
 
 #include "cnis/infer_server.h"
 #include "cnis/processor.h"
@@ -29,7 +36,214 @@ namespace py = pybind11;
 
 namespace infer_server {
 
+namespace {
+
+// A response to be delivered to an event loop, callback is called with (status, package) on the loop thread
+struct AsyncResponse {
+  py::object loop;
+  py::object callback;
+};
+
+std::shared_ptr<AsyncResponse> MakeAsyncResponse(py::object loop, py::object callback) {
+  // py::object destruct in c++ thread without gil resource, it is important to get gil
+  return std::shared_ptr<AsyncResponse>(new AsyncResponse{std::move(loop), std::move(callback)},
+                                        [](AsyncResponse* t) {
+                                          py::gil_scoped_acquire gil;
+                                          delete t;
+                                        });
+}
+
+class AsyncObserver : public Observer {
+ public:
+  void Response(Status status, PackagePtr data, any user_data) noexcept override {
+    std::shared_ptr<AsyncResponse> response = any_cast<std::shared_ptr<AsyncResponse>>(user_data);
+    py::gil_scoped_acquire gil;
+    try {
+      response->loop.attr("call_soon_threadsafe")(response->callback, status, data);
+    } catch (py::error_already_set& e) {
+      // the event loop is closed
+      LOG(WARNING) << "[EasyDK InferServer] [PythonAPI] AsyncSession: Drop response, " << e.what();
+    }
+  }
+};  // class AsyncObserver
+
+py::object GetRunningLoop() { return py::module::import("asyncio").attr("get_running_loop")(); }
+
+}  // namespace
+
+AsyncSession::AsyncSession(std::shared_ptr<InferServer> server, const SessionDesc& desc) : server_(server) {
+  session_ = server_->CreateSession(desc, std::make_shared<AsyncObserver>());
+}
+
+AsyncSession::~AsyncSession() {
+  // responses in flight need gil
+  if (PyGILState_Check()) {
+    py::gil_scoped_release release;
+    Close();
+  } else {
+    Close();
+  }
+}
+
+void AsyncSession::Close() {
+  Session_t session;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    session = session_;
+    session_ = nullptr;
+  }
+  if (session) server_->DestroySession(session);
+}
+
+bool AsyncSession::Request(PackagePtr input, any user_data, int timeout, int64_t* request_id) {
+  // do not block the responses of the other requests while waiting for resources
+  py::gil_scoped_release release;
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (!session_) {
+    LOG(ERROR) << "[EasyDK InferServer] [PythonAPI] AsyncSession: Session is closed";
+    return false;
+  }
+  return server_->Request(session_, std::move(input), std::move(user_data), request_id, timeout);
+}
+
+void AsyncSession::DiscardTask(const std::string& tag) {
+  py::gil_scoped_release release;
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (session_) server_->DiscardTask(session_, tag);
+}
+
+void AsyncSession::DiscardRequest(int64_t request_id) {
+  py::gil_scoped_release release;
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (session_) server_->DiscardRequest(session_, request_id);
+}
+
+std::map<std::string, UsageStatistic> AsyncSession::GetUsageSnapshot() {
+  py::gil_scoped_release release;
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (!session_) return {};
+  return server_->GetUsageSnapshot(session_);
+}
+
+py::object AsyncSession::RequestAsync(PackagePtr input, int timeout) {
+  if (!input) throw std::invalid_argument("input is None");
+  py::object loop = GetRunningLoop();
+  py::object future = loop.attr("create_future")();
+  py::object resolve = py::cpp_function([future](Status status, PackagePtr data) {
+    if (!future.attr("done")().cast<bool>()) future.attr("set_result")(py::make_tuple(status, data));
+  });
+  // the id is set before the future could be cancelled, both run on the thread of the event loop
+  auto request_id = std::make_shared<int64_t>(-1);
+  std::weak_ptr<AsyncSession> weak_session = shared_from_this();
+  future.attr("add_done_callback")(py::cpp_function([weak_session, request_id](py::object future) {
+    if (!future.attr("cancelled")().cast<bool>()) return;
+    std::shared_ptr<AsyncSession> session = weak_session.lock();
+    if (session && *request_id >= 0) session->DiscardRequest(*request_id);
+  }));
+  if (!Request(std::move(input), MakeAsyncResponse(loop, resolve), timeout, request_id.get())) {
+    future.attr("set_exception")(py::reinterpret_borrow<py::object>(PyExc_RuntimeError)("Request failed"));
+  }
+  return future;
+}
+
+std::shared_ptr<ResponseStream> AsyncSession::Stream(const std::string& tag, int timeout) {
+  return std::make_shared<ResponseStream>(shared_from_this(), tag, timeout, GetRunningLoop());
+}
+
+ResponseStream::ResponseStream(std::weak_ptr<AsyncSession> session, const std::string& tag, int timeout,
+                               py::object loop)
+    : session_(session), tag_(tag), timeout_(timeout), loop_(std::move(loop)), waiter_(py::none()) {}
+
+bool ResponseStream::Send(PackagePtr input) {
+  std::shared_ptr<AsyncSession> session = session_.lock();
+  if (!input || !session || closed_) return false;
+  input->tag = tag_;
+  std::shared_ptr<ResponseStream> self = shared_from_this();
+  py::object push = py::cpp_function([self](Status status, PackagePtr data) { self->Push(status, data); });
+  ++pending_;
+  if (!session->Request(std::move(input), MakeAsyncResponse(loop_, push), timeout_)) {
+    --pending_;
+    return false;
+  }
+  return true;
+}
+
+void ResponseStream::Close() {
+  closed_ = true;
+  Wake();
+}
+
+void ResponseStream::Cancel() {
+  if (!cancelled_) {
+    std::shared_ptr<AsyncSession> session = session_.lock();
+    if (session) session->DiscardTask(tag_);
+  }
+  cancelled_ = closed_ = true;
+  pending_ = 0;
+  responses_.clear();
+  Wake();
+}
+
+py::object ResponseStream::Next() {
+  waiter_ = loop_.attr("create_future")();
+  py::object future = waiter_;
+  Wake();
+  return future;
+}
+
+void ResponseStream::Push(Status status, PackagePtr data) {
+  // responses already in flight when cancelled
+  if (cancelled_) return;
+  if (pending_) --pending_;
+  responses_.push_back(py::make_tuple(status, data));
+  Wake();
+}
+
+void ResponseStream::Wake() {
+  // the waiter is done if it is cancelled by the consumer, e.g. by asyncio.wait_for
+  if (waiter_.is_none() || waiter_.attr("done")().cast<bool>()) {
+    waiter_ = py::none();
+    return;
+  }
+  if (!responses_.empty()) {
+    waiter_.attr("set_result")(responses_.front());
+    responses_.pop_front();
+  } else if (closed_ && !pending_) {
+    waiter_.attr("set_exception")(py::reinterpret_borrow<py::object>(PyExc_StopAsyncIteration)());
+  } else {
+    return;
+  }
+  waiter_ = py::none();
+}
+
+void AsyncSessionWrapper(const py::module& m) {
+  py::class_<AsyncSession, std::shared_ptr<AsyncSession>>(m, "AsyncSession")
+      .def("request_async", &AsyncSession::RequestAsync, py::arg("input"), py::arg("timeout") = -1)
+      .def("stream", &AsyncSession::Stream, py::arg("tag"), py::arg("timeout") = -1)
+      .def("get_usage_snapshot", &AsyncSession::GetUsageSnapshot)
+      .def("close", &AsyncSession::Close, py::call_guard<py::gil_scoped_release>());
+
+  py::class_<ResponseStream, std::shared_ptr<ResponseStream>>(m, "ResponseStream")
+      .def("send", &ResponseStream::Send, py::arg("input"))
+      .def("close", &ResponseStream::Close)
+      .def("cancel", &ResponseStream::Cancel)
+      .def("__aiter__", [](std::shared_ptr<ResponseStream> stream) { return stream; })
+      .def("__anext__", &ResponseStream::Next);
+}
+
 void SessionDescWrapper(const py::module& m) {
+  py::class_<BatchTrace, std::shared_ptr<BatchTrace>>(m, "BatchTrace")
+      .def(py::init<>())
+      .def(py::init([](const std::string& text) {
+             std::vector<BatchTrace::Batch> batches;
+             if (!BatchTrace::Parse(text, &batches)) throw std::invalid_argument("Malformed batch trace");
+             return std::make_shared<BatchTrace>(std::move(batches));
+           }),
+           py::arg("replay"))
+      .def("get_batches", &BatchTrace::GetBatches)
+      .def("serialize", &BatchTrace::Serialize)
+      .def("is_replay", &BatchTrace::IsReplay);
+
   py::class_<SessionDesc, std::shared_ptr<SessionDesc>>(m, "SessionDesc")
       .def(py::init<>())
       .def_readwrite("name", &SessionDesc::name)
@@ -41,7 +255,8 @@ void SessionDescWrapper(const py::module& m) {
       .def_readwrite("batch_timeout", &SessionDesc::batch_timeout)
       .def_readwrite("priority", &SessionDesc::priority)
       .def_readwrite("engine_num", &SessionDesc::engine_num)
-      .def_readwrite("show_perf", &SessionDesc::show_perf);
+      .def_readwrite("show_perf", &SessionDesc::show_perf)
+      .def_readwrite("batch_trace", &SessionDesc::batch_trace);
 }
 
 }  //  namespace infer_server
@@ -0,0 +1,103 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef SESSION_PY_WRAPPER_HPP
+#define SESSION_PY_WRAPPER_HPP
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "pybind11/pybind11.h"
+
+#include "cnis/infer_server.h"
+
+namespace py = pybind11;
+
+namespace infer_server {
+
+class ResponseStream;
+
+/**
+ * Asynchronous session for asyncio. Responses are handed to the event loop of the caller by
+ * loop.call_soon_threadsafe, so that no thread bridge is needed in asyncio services.
+ */
+class AsyncSession : public std::enable_shared_from_this<AsyncSession> {
+ public:
+  AsyncSession(std::shared_ptr<InferServer> server, const SessionDesc &desc);
+  ~AsyncSession();
+  bool IsValid() const { return session_ != nullptr; }
+
+  // Returns an asyncio.Future of (Status, Package). Cancelling the future discards only this request, whatever the
+  // tag of input is
+  py::object RequestAsync(PackagePtr input, int timeout);
+  // Returns an async iterator over the responses of the requests sent by it, all with the same tag
+  std::shared_ptr<ResponseStream> Stream(const std::string &tag, int timeout);
+  // Waits for the pending requests and destroys the session, called without GIL
+  void Close();
+  // tag -> usage statistic of the session
+  std::map<std::string, UsageStatistic> GetUsageSnapshot();
+
+  // called with GIL
+  bool Request(PackagePtr input, any user_data, int timeout, int64_t *request_id = nullptr);
+  void DiscardTask(const std::string &tag);
+  void DiscardRequest(int64_t request_id);
+
+ private:
+  std::shared_ptr<InferServer> server_;
+  std::mutex mutex_;
+  Session_t session_ = nullptr;
+};
+
+/**
+ * Responses of a tag in the order of requests. Methods must be called on the thread of the event loop.
+ */
+class ResponseStream : public std::enable_shared_from_this<ResponseStream> {
+ public:
+  ResponseStream(std::weak_ptr<AsyncSession> session, const std::string &tag, int timeout, py::object loop);
+  // Sends a request with the tag of the stream
+  bool Send(PackagePtr input);
+  // No more requests, the iteration stops after the responses of the sent requests
+  void Close();
+  // Discards the pending requests and stops the iteration
+  void Cancel();
+  // __anext__, returns an asyncio.Future of (Status, Package)
+  py::object Next();
+  void Push(Status status, PackagePtr data);
+
+ private:
+  void Wake();
+
+  std::weak_ptr<AsyncSession> session_;
+  std::string tag_;
+  int timeout_;
+  py::object loop_;
+  py::object waiter_;
+  std::deque<py::object> responses_;
+  size_t pending_ = 0;
+  bool closed_ = false;
+  bool cancelled_ = false;
+};
+
+}  //  namespace infer_server
+
+#endif  // SESSION_PY_WRAPPER_HPP
@@ -0,0 +1,145 @@
+# ==============================================================================
+# Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+# OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+# ==============================================================================
+
+"""AsyncSession test
+
+This module tests asyncio APIs of InferServer
+
+"""
+
+import asyncio
+import os, sys
+import pytest
+
+sys.path.append(os.path.split(os.path.realpath(__file__))[0] + "/../lib")
+import cnis
+import utils
+
+def create_async_session(infer_server):
+  session_desc = cnis.SessionDesc()
+  session_desc.name = "test_async_session"
+  session_desc.model = infer_server.load_model(utils.get_model_dir())
+  session_desc.model_input_format = cnis.NetworkInputFormat.RGB
+  session_desc.show_perf = False
+  session = infer_server.create_async_session(session_desc)
+  assert session
+  return session, session_desc.model
+
+def prepare_input(model, tag):
+  input_pak = utils.prepare_model_input(model)
+  input_pak.tag = tag
+  return input_pak
+
+class TestAsyncSession(object):
+  """TestAsyncSession class provides several APIs for testing AsyncSession"""
+  @staticmethod
+  @pytest.mark.asyncio
+  async def test_request_async():
+    infer_server = cnis.InferServer(dev_id=0)
+    session, model = create_async_session(infer_server)
+
+    status, output = await session.request_async(prepare_input(model, "request_0"))
+    assert status == cnis.Status.SUCCESS
+    assert output.tag == "request_0"
+    assert len(output.data) == 1 and output.data[0].get_model_io()
+
+    # requests are processed concurrently and each future gets its own response
+    tags = ["request_" + str(i) for i in range(1, 9)]
+    results = await asyncio.gather(*[session.request_async(prepare_input(model, tag)) for tag in tags])
+    assert [output.tag for _, output in results] == tags
+    assert all(status == cnis.Status.SUCCESS for status, _ in results)
+    session.close()
+
+  @staticmethod
+  @pytest.mark.asyncio
+  async def test_cancel():
+    infer_server = cnis.InferServer(dev_id=0)
+    session, model = create_async_session(infer_server)
+
+    # cancelling a request discards only itself, the other requests are not affected
+    futures = [session.request_async(prepare_input(model, "cancel_" + str(i))) for i in range(8)]
+    futures[3].cancel()
+    with pytest.raises(asyncio.CancelledError):
+      await futures[3]
+    for i, future in enumerate(futures):
+      if i != 3:
+        status, output = await future
+        assert status == cnis.Status.SUCCESS
+        assert output.tag == "cancel_" + str(i)
+
+    # wait_for cancels the request on timeout
+    try:
+      await asyncio.wait_for(session.request_async(prepare_input(model, "timeout")), 1e-4)
+    except asyncio.TimeoutError:
+      pass
+    session.close()
+
+  @staticmethod
+  @pytest.mark.asyncio
+  async def test_cancel_untagged():
+    infer_server = cnis.InferServer(dev_id=0)
+    session, model = create_async_session(infer_server)
+
+    # requests with the same default tag are cancelled one by one
+    futures = [session.request_async(prepare_input(model, "")) for _ in range(8)]
+    futures[3].cancel()
+    with pytest.raises(asyncio.CancelledError):
+      await futures[3]
+    results = await asyncio.wait_for(asyncio.gather(*(futures[:3] + futures[4:])), 10)
+    for status, output in results:
+      assert status == cnis.Status.SUCCESS
+      assert output.tag == ""
+
+    # statistics are kept by the tags of callers, not by requests
+    for _ in range(4):
+      await asyncio.gather(*[session.request_async(prepare_input(model, "")) for _ in range(8)])
+    # the snapshot is taken periodically
+    await asyncio.sleep(2.5)
+    assert set(session.get_usage_snapshot().keys()) <= {""}
+    session.close()
+
+  @staticmethod
+  @pytest.mark.asyncio
+  async def test_stream():
+    infer_server = cnis.InferServer(dev_id=0)
+    session, model = create_async_session(infer_server)
+
+    stream = session.stream(utils.tag)
+    for _ in range(10):
+      assert stream.send(utils.prepare_model_input(model))
+    stream.close()
+    assert not stream.send(utils.prepare_model_input(model))
+    count = 0
+    async for status, output in stream:
+      assert status == cnis.Status.SUCCESS
+      assert output.tag == utils.tag
+      count += 1
+    assert count == 10
+
+    # cancel stops the iteration and discards the pending requests
+    stream = session.stream("stream_1")
+    for _ in range(10):
+      assert stream.send(utils.prepare_model_input(model))
+    count = 0
+    async for _ in stream:
+      count += 1
+      stream.cancel()
+    assert count == 1
+    session.close()
@@ -138,6 +138,18 @@ class TestDataLayout(object):
     assert cnis.get_type_size(cnis.DataType.FLOAT16) == 2
     assert cnis.get_type_size(cnis.DataType.INT16) == 2
     assert cnis.get_type_size(cnis.DataType.INT32) == 4
+    assert cnis.get_type_size(cnis.DataType.INT8) == 1
+    assert cnis.get_type_size(cnis.DataType.BF16) == 2
+    assert cnis.get_type_size(cnis.DataType.INT64) == 8
+    assert cnis.get_type_size(cnis.DataType.BOOL) == 1
+
+    # Check quantization parameters
+    assert not model.output_layout(0).quant.scales
+    layout = cnis.DataLayout(cnis.DataType.INT8, cnis.DimOrder.NCHW)
+    layout.quant = cnis.QuantParams([0.5, 0.25], [0, 1], axis=1)
+    assert layout.quant.scales == [0.5, 0.25]
+    assert layout.quant.zero_points == [0, 1]
+    assert layout.quant.axis == 1
 
 
 class TestDevice(object):
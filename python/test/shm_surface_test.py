@@ -0,0 +1,119 @@
+# ==============================================================================
+# Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+#
+#  Licensed under the Apache License, Version 2.0 (the "License");
+#  you may not use this file except in compliance with the License.
+#  You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+# OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+# ==============================================================================
+
+"""Shared memory BufSurface test
+
+This module tests sharing CnedkBufSurface between processes
+
+"""
+
+import os, sys
+import multiprocessing
+import pickle
+import signal
+import numpy as np
+
+cur_file_dir = os.path.split(os.path.realpath(__file__))[0]
+sys.path.append(cur_file_dir + "/../lib")
+
+import cnis
+
+width = 256
+height = 128
+
+def create_shared_surf():
+  params = cnis.CnedkBufSurfaceCreateParams()
+  params.mem_type = cnis.CnedkBufSurfaceMemType.SYSTEM
+  params.device_id = 0
+  params.width = width
+  params.height = height
+  params.color_format = cnis.CnedkBufSurfaceColorFormat.GRAY8
+  params.batch_size = 1
+  surf = cnis.cnedk_buf_surface_create_shared(params)
+  assert surf is not None
+  return surf
+
+def shm_exists(handle):
+  return os.path.exists("/dev/shm" + handle.name)
+
+def write_pixels(handle, value):
+  # runs in the child process
+  surf = cnis.cnedk_buf_surface_open_shared(handle)
+  assert surf is not None
+  wrapper = cnis.CnedkBufSurfaceWrapper(surf)
+  data = wrapper.get_data(0, 0)
+  data[:] = value
+
+def open_and_crash(handle):
+  # runs in the child process, exits without destroying the surface
+  surf = cnis.cnedk_buf_surface_open_shared(handle)
+  assert surf is not None
+  os.kill(os.getpid(), signal.SIGKILL)
+
+class TestShmSurface(object):
+  """TestShmSurface class provides several APIs for testing shared memory BufSurface"""
+  @staticmethod
+  def test_handle_pickle():
+    surf = create_shared_surf()
+    handle = cnis.cnedk_buf_surface_get_shm_handle(surf)
+    assert handle.name
+    assert pickle.loads(pickle.dumps(handle)).name == handle.name
+    cnis.cnedk_buf_surface_destroy(surf)
+
+  @staticmethod
+  def test_child_writes_parent_reads():
+    surf = create_shared_surf()
+    handle = cnis.cnedk_buf_surface_get_shm_handle(surf)
+    wrapper = cnis.CnedkBufSurfaceWrapper(surf)
+    # the array is a view of the shared memory, it is not copied after the child writes
+    data = wrapper.get_data(0, 0)
+    data[:] = 0
+    assert data.size == width * height
+
+    ctx = multiprocessing.get_context("spawn")
+    child = ctx.Process(target=write_pixels, args=(handle, 0x5a))
+    child.start()
+    child.join()
+    assert child.exitcode == 0
+    assert np.all(data == 0x5a)
+
+    # the last holder removes the shared memory
+    assert shm_exists(handle)
+    del data
+    del wrapper
+    assert not shm_exists(handle)
+
+  @staticmethod
+  def test_cleanup_after_crash():
+    surf = create_shared_surf()
+    handle = cnis.cnedk_buf_surface_get_shm_handle(surf)
+    ctx = multiprocessing.get_context("spawn")
+    child = ctx.Process(target=open_and_crash, args=(handle,))
+    child.start()
+    child.join()
+    assert child.exitcode == -signal.SIGKILL
+
+    # the crashed child still holds a reference
+    cnis.cnedk_buf_surface_destroy(surf)
+    assert shm_exists(handle)
+    assert cnis.cnedk_buf_surface_shm_cleanup() >= 1
+    assert not shm_exists(handle)
+    surf = cnis.cnedk_buf_surface_open_shared(handle)
+    assert surf is None
@@ -20,6 +20,7 @@
 
 #include <chrono>
 #include <condition_variable>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <string>
@@ -114,6 +115,7 @@ int SampleDecode::Open() {
   }
   fr_controller_.reset(new FrController(frame_rate_));
 
+  memset(&params_, 0, sizeof(params_));
   params_.color_format = CNEDK_BUF_COLOR_FORMAT_NV21;
   params_.device_id = dev_id_;
   switch (demuxer_->GetVideoCodec()) {
@@ -132,6 +134,8 @@ int SampleDecode::Open() {
     break;
   }
 
+  params_.decode_mode = decode_mode_;
+  params_.decode_interval = decode_interval_;
   params_.userdata = this;
   params_.frame_buf_num = 12;  // for CE3226
   params_.surf_timeout_ms = 5000;
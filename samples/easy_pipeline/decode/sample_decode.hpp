@@ -35,13 +35,16 @@
 class SampleDecode : public EasyModule {
  public:
   SampleDecode(std::string name, int parallelism, int device_id, std::string filename, int stream_id,
-               int frame_rate = 30) : EasyModule(name, parallelism) {
+               int frame_rate = 30, CnedkVdecDecodeMode decode_mode = CNEDK_VDEC_DECODE_MODE_ALL,
+               uint32_t decode_interval = 1) : EasyModule(name, parallelism) {
     filename_ = filename;
     stream_id_ = stream_id;
     dev_id_ = device_id;
     if (frame_rate > 0) {
       frame_rate_ = frame_rate;
     }
+    decode_mode_ = decode_mode;
+    decode_interval_ = decode_interval;
   }
 
   ~SampleDecode();
@@ -93,6 +96,8 @@ class SampleDecode : public EasyModule {
   void* surf_pool_ = nullptr;
   int dev_id_ = 0;
   int frame_rate_ = 30;
+  CnedkVdecDecodeMode decode_mode_ = CNEDK_VDEC_DECODE_MODE_ALL;
+  uint32_t decode_interval_ = 1;
 
   uint8_t* data_buffer_ = nullptr;
 };
@@ -47,6 +47,8 @@ DEFINE_bool(enable_vin, false, "enable_vin");  // not support vin enable
 DEFINE_bool(enable_vout, false, "enable_vout");  // not support vout enable
 DEFINE_int32(codec_id_start, 0, "vdec/venc first id, for CE3226 only");
 DEFINE_int32(frame_rate, 0, "framerate for stream");
+DEFINE_int32(decode_mode, 0, "0: decode all frames, 1: decode key frames only, 2: decode reference frames only");
+DEFINE_int32(decode_interval, 1, "decode one of every decode_interval key frames in key frame only mode");
 
 std::shared_ptr<EasyPipeline> g_easy_pipe;
 
@@ -70,6 +72,9 @@ int main(int argc, char** argv) {
   CHECK(FLAGS_codec_id_start >= 0) "[EasyDK Samples] [Detection] codec start id should be >= 0";
   CHECK(FLAGS_input_number >= 1) "[EasyDK Samples] [Detection] input number should be >= ";
   CHECK(FLAGS_frame_rate >= 1) "[EasyDK Samples] [Detection] input number should be >= ";
+  CHECK(FLAGS_decode_mode >= 0 && FLAGS_decode_mode < CNEDK_VDEC_DECODE_MODE_NUM)
+      << "[EasyDK Samples] [Detection] decode mode should be 0, 1 or 2";
+  CHECK(FLAGS_decode_interval >= 1) << "[EasyDK Samples] [Detection] decode interval should be >= 1";
 
   CnedkSensorParams sensor_params[4];
   memset(sensor_params, 0, sizeof(CnedkSensorParams) * 4);
@@ -110,8 +115,9 @@ int main(int argc, char** argv) {
 
   int ret = 0;
   for (int i = 0; i < FLAGS_input_number; ++i) {
-    std::shared_ptr<EasyModule> source =
-        std::make_shared<SampleDecode>("source", 0, FLAGS_device_id, FLAGS_data_path, i, FLAGS_frame_rate);
+    std::shared_ptr<EasyModule> source = std::make_shared<SampleDecode>(
+        "source", 0, FLAGS_device_id, FLAGS_data_path, i, FLAGS_frame_rate,
+        static_cast<CnedkVdecDecodeMode>(FLAGS_decode_mode), static_cast<uint32_t>(FLAGS_decode_interval));
     ret |= g_easy_pipe->AddSource(source);
   }
 
@@ -0,0 +1,523 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "demux_reactor.h"
+
+#include <fcntl.h>
+#include <glog/logging.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr int kAvioBufferSize = 64 * 1024;
+constexpr size_t kSocketReadSize = 64 * 1024;
+constexpr size_t kSocketBufferSize = 4 << 20;
+// a socket stream is opened once this much data is buffered to probe, then demuxed with whatever data is buffered
+constexpr int64_t kSocketProbeSize = 512 * 1024;
+constexpr int kMaxWaitMs = 100;
+constexpr int kMaxEvents = 64;
+}  // namespace
+
+struct DemuxReactor::Stream {
+  int id = -1;
+  StreamParams params;
+  int fd = -1;
+  bool is_socket = false;
+  // prefetched socket data
+  std::vector<uint8_t> buffer;
+  size_t read_pos = 0;
+  bool eof = false;
+  // socket is still readable but buffer is full
+  bool read_pending = false;
+  // demuxer ran out of buffered data, waits for more data
+  bool starved = false;
+  bool opening = false;
+
+  AVFormatContext* format_ctx = nullptr;
+  AVIOContext* avio = nullptr;
+  AVPacket packet;
+  int32_t video_index = -1;
+  AVRational time_base;
+  VideoInfo info;
+  bool info_sent = false;
+  bool first_frame = true;
+  bool done = false;
+
+  // timestamps in 90kHz relative to the first packet, continued over loops
+  int64_t first_ts = AV_NOPTS_VALUE;
+  int64_t ts_base = 0;
+  int64_t max_ts = 0;
+  uint64_t frame_index = 0;
+  Clock::time_point start;
+  Clock::time_point due;
+
+  size_t Buffered() const { return buffer.size() - read_pos; }
+};
+
+class DemuxReactor::IoThread {
+ public:
+  explicit IoThread(std::atomic<uint64_t>* packet_count) : packet_count_(packet_count) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event_fd_, &event);
+    thread_ = std::thread(&IoThread::Loop, this);
+  }
+
+  ~IoThread() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      stop_ = true;
+    }
+    Wakeup();
+    if (thread_.joinable()) thread_.join();
+    for (auto& stream : streams_) Release(stream.get());
+    for (auto& stream : adding_) Release(stream.get());
+    close(event_fd_);
+    close(epoll_fd_);
+  }
+
+  void Add(std::unique_ptr<Stream> stream) {
+    load_.fetch_add(1);
+    std::lock_guard<std::mutex> lk(mutex_);
+    adding_.emplace_back(std::move(stream));
+    Wakeup();
+  }
+
+  void Remove(int stream_id) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    auto it = std::find_if(adding_.begin(), adding_.end(),
+                           [stream_id](const std::unique_ptr<Stream>& stream) { return stream->id == stream_id; });
+    if (it != adding_.end()) {
+      Release(it->get());
+      adding_.erase(it);
+      load_.fetch_sub(1);
+      return;
+    }
+    removing_.push_back(stream_id);
+    Wakeup();
+    removed_cond_.wait(lk, [this, stream_id] {
+      return std::find(removing_.begin(), removing_.end(), stream_id) == removing_.end();
+    });
+  }
+
+  size_t Load() const { return load_.load(); }
+
+ private:
+  void Wakeup() {
+    uint64_t one = 1;
+    if (write(event_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+      LOG(ERROR) << "[EasyDK Samples] [DemuxReactor] Wakeup(): Write eventfd failed";
+    }
+  }
+
+  // returns false if thread is stopped
+  bool ApplyRequests() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    for (auto& stream : adding_) {
+      if (stream->is_socket) {
+        epoll_event event;
+        event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        event.data.ptr = stream.get();
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stream->fd, &event);
+        // data might arrive before registered
+        stream->read_pending = true;
+      }
+      streams_.emplace_back(std::move(stream));
+    }
+    adding_.clear();
+    if (!removing_.empty()) {
+      for (int id : removing_) {
+        auto it = std::find_if(streams_.begin(), streams_.end(),
+                               [id](const std::unique_ptr<Stream>& stream) { return stream->id == id; });
+        if (it != streams_.end()) {
+          Release(it->get());
+          streams_.erase(it);
+          load_.fetch_sub(1);
+        }
+      }
+      removing_.clear();
+      removed_cond_.notify_all();
+    }
+    return !stop_;
+  }
+
+  void Loop() {
+    epoll_event events[kMaxEvents];
+    while (ApplyRequests()) {
+      Clock::time_point now = Clock::now();
+      Clock::time_point wake = now + std::chrono::milliseconds(kMaxWaitMs);
+      bool busy = false;
+      size_t num = streams_.size();
+      // round-robin, starts from a different stream every round
+      for (size_t i = 0; i < num; ++i) {
+        if (Step(streams_[(cursor_ + i) % num].get(), now, &wake)) busy = true;
+      }
+      if (num) cursor_ = (cursor_ + 1) % num;
+
+      for (auto it = streams_.begin(); it != streams_.end();) {
+        if ((*it)->done) {
+          Release(it->get());
+          it = streams_.erase(it);
+          load_.fetch_sub(1);
+        } else {
+          ++it;
+        }
+      }
+
+      int timeout_ms = 0;
+      if (!busy) {
+        auto wait_us = std::chrono::duration_cast<std::chrono::microseconds>(wake - Clock::now()).count();
+        timeout_ms = wait_us > 0 ? static_cast<int>((wait_us + 999) / 1000) : 0;
+      }
+      int event_num = epoll_wait(epoll_fd_, events, kMaxEvents, timeout_ms);
+      for (int i = 0; i < event_num; ++i) {
+        Stream* stream = static_cast<Stream*>(events[i].data.ptr);
+        if (stream) {
+          FillSocket(stream);
+        } else {
+          uint64_t value;
+          while (read(event_fd_, &value, sizeof(value)) > 0) {}
+        }
+      }
+    }
+  }
+
+  // Sends at most one packet of the stream, returns true if it is sent
+  bool Step(Stream* s, Clock::time_point now, Clock::time_point* wake) {
+    if (s->done) return false;
+    IDemuxEventHandle* handler = s->params.handler;
+    if (!handler->Running()) {
+      s->done = true;
+      return false;
+    }
+    if (s->is_socket) {
+      if (s->read_pending) FillSocket(s);
+      if (s->starved) return false;
+      if (!s->format_ctx && !s->eof && s->Buffered() < static_cast<size_t>(kSocketProbeSize)) return false;
+    }
+
+    if (!s->format_ctx) {
+      if (!Open(s)) {
+        handler->OnEos();
+        s->done = true;
+        return false;
+      }
+      if (!s->info_sent) {
+        s->info_sent = true;
+        if (!handler->OnParseInfo(s->info)) {
+          s->done = true;
+          return false;
+        }
+        s->start = now;
+        s->due = now;
+      }
+    }
+    if (s->params.pacing && now < s->due) {
+      *wake = std::min(*wake, s->due);
+      return false;
+    }
+
+    AVPacket* packet = &s->packet;
+    while (true) {
+      int ret = av_read_frame(s->format_ctx, packet);
+      if (ret < 0) {
+        if (s->is_socket && !s->eof && (ret == AVERROR(EAGAIN) || s->avio->error == AVERROR(EAGAIN))) {
+          // buffered data is used up, demuxing goes on once more data arrives
+          s->avio->eof_reached = 0;
+          s->avio->error = 0;
+          s->starved = true;
+          return false;
+        }
+        if (s->params.loop && !s->is_socket && s->frame_index) {
+          Restart(s);
+          return true;
+        }
+        handler->OnEos();
+        s->done = true;
+        return false;
+      }
+      if (packet->stream_index == s->video_index) break;
+      av_packet_unref(packet);
+    }
+
+    // filter non-key-frame in head
+    if (s->first_frame) {
+      if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+        av_packet_unref(packet);
+        return true;
+      }
+      s->first_frame = false;
+    }
+
+    int64_t frame_duration = s->params.frame_rate > 0 ? std::llround(90000 / s->params.frame_rate) : 0;
+    int64_t ts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+    int64_t rel_ts;
+    if (ts == AV_NOPTS_VALUE) {
+      rel_ts = s->ts_base + s->frame_index * frame_duration;
+      packet->pts = rel_ts;
+    } else {
+      ts = av_rescale_q(ts, s->time_base, {1, 90000});
+      if (s->first_ts == AV_NOPTS_VALUE) s->first_ts = ts;
+      rel_ts = s->ts_base + ts - s->first_ts;
+      if (packet->pts != AV_NOPTS_VALUE) {
+        packet->pts = s->ts_base + av_rescale_q(packet->pts, s->time_base, {1, 90000}) - s->first_ts;
+      } else {
+        packet->pts = rel_ts;
+      }
+    }
+    s->frame_index++;
+    s->max_ts = std::max(s->max_ts, rel_ts + frame_duration);
+
+    bool ret = handler->OnPacket(packet);
+    av_packet_unref(packet);
+    if (!ret) {
+      LOG(ERROR) << "[EasyDK Samples] [DemuxReactor] Step(): Handle packet failed, stream id: " << s->id;
+      s->done = true;
+      return false;
+    }
+    packet_count_->fetch_add(1, std::memory_order_relaxed);
+    if (s->params.pacing) {
+      // decode timestamps could be the same at the beginning, due time never goes back
+      s->due = std::max(s->due, s->start + std::chrono::microseconds(rel_ts * 100 / 9));
+    }
+    return true;
+  }
+
+  bool Open(Stream* s) {
+    s->format_ctx = avformat_alloc_context();
+    uint8_t* buffer = reinterpret_cast<uint8_t*>(av_malloc(kAvioBufferSize));
+    s->avio = avio_alloc_context(buffer, kAvioBufferSize, 0, s, &ReadData, nullptr, s->is_socket ? nullptr : &SeekData);
+    s->format_ctx->pb = s->avio;
+    // probes with buffered data only for sockets
+    AVDictionary* options = nullptr;
+    av_dict_set_int(&options, "probesize", s->is_socket ? kSocketProbeSize : 1 << 20, 0);
+    s->opening = true;
+    int ret = avformat_open_input(&s->format_ctx, nullptr, nullptr, &options);
+    av_dict_free(&options);
+    if (ret != 0) {
+      LOG(ERROR) << "[EasyDK Samples] [DemuxReactor] Open(): Can not open input stream, stream id: " << s->id;
+      Close(s);
+      return false;
+    }
+    if (avformat_find_stream_info(s->format_ctx, nullptr) < 0) {
+      LOG(ERROR) << "[EasyDK Samples] [DemuxReactor] Open(): Can not find stream information, stream id: " << s->id;
+      Close(s);
+      return false;
+    }
+    if (!FindVideoStream(s->format_ctx, &s->video_index, &s->info)) {
+      Close(s);
+      return false;
+    }
+    if (s->info.codec_id != AV_CODEC_ID_H264 && s->info.codec_id != AV_CODEC_ID_HEVC) {
+      LOG(ERROR) << "[EasyDK Samples] [DemuxReactor] Open(): Unsupported codec id: " << s->info.codec_id;
+      Close(s);
+      return false;
+    }
+    s->time_base = s->format_ctx->streams[s->video_index]->time_base;
+    // end of buffered data while probing is not the end of socket stream
+    s->opening = false;
+    s->avio->eof_reached = 0;
+    s->avio->error = 0;
+    av_init_packet(&s->packet);
+    s->packet.data = nullptr;
+    s->packet.size = 0;
+    return true;
+  }
+
+  // Starts the next loop of file, timestamps continue from the last loop
+  void Restart(Stream* s) {
+    Close(s);
+    lseek(s->fd, 0, SEEK_SET);
+    s->ts_base = s->max_ts;
+    s->first_ts = AV_NOPTS_VALUE;
+    s->frame_index = 0;
+    s->first_frame = true;
+  }
+
+  void Close(Stream* s) {
+    s->opening = false;
+    if (s->format_ctx) {
+      avformat_close_input(&s->format_ctx);
+      s->format_ctx = nullptr;
+    }
+    if (s->avio) {
+      av_freep(&s->avio->buffer);
+      av_freep(&s->avio);
+    }
+  }
+
+  void Release(Stream* s) {
+    Close(s);
+    if (s->fd >= 0) {
+      if (s->is_socket) epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, s->fd, nullptr);
+      close(s->fd);
+      s->fd = -1;
+    }
+  }
+
+  void FillSocket(Stream* s) {
+    if (s->eof) return;
+    if (s->read_pos && s->read_pos * 2 >= s->buffer.size()) {
+      s->buffer.erase(s->buffer.begin(), s->buffer.begin() + s->read_pos);
+      s->read_pos = 0;
+    }
+    s->read_pending = false;
+    while (s->Buffered() < kSocketBufferSize) {
+      size_t size = s->buffer.size();
+      s->buffer.resize(size + kSocketReadSize);
+      ssize_t n = read(s->fd, s->buffer.data() + size, kSocketReadSize);
+      s->buffer.resize(size + std::max<ssize_t>(n, 0));
+      if (n > 0) {
+        s->starved = false;
+        continue;
+      }
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+      if (n < 0) LOG(ERROR) << "[EasyDK Samples] [DemuxReactor] FillSocket(): Read failed, stream id: " << s->id;
+      s->eof = true;
+      s->starved = false;
+      return;
+    }
+    // edge is not consumed, reads again after data is demuxed
+    s->read_pending = true;
+  }
+
+  static int ReadData(void* opaque, uint8_t* buf, int size) {
+    Stream* s = reinterpret_cast<Stream*>(opaque);
+    if (!s->is_socket) {
+      // regular files are always ready
+      while (true) {
+        ssize_t n = read(s->fd, buf, size);
+        if (n > 0) return n;
+        if (n == 0) return AVERROR_EOF;
+        if (errno != EINTR) return AVERROR(errno);
+      }
+    }
+    size_t n = std::min(s->Buffered(), static_cast<size_t>(size));
+    // probing stops at the end of buffered data, retrying is not supported while opening
+    if (!n) return s->eof || s->opening ? AVERROR_EOF : AVERROR(EAGAIN);
+    memcpy(buf, s->buffer.data() + s->read_pos, n);
+    s->read_pos += n;
+    return n;
+  }
+
+  static int64_t SeekData(void* opaque, int64_t offset, int whence) {
+    Stream* s = reinterpret_cast<Stream*>(opaque);
+    if (whence & AVSEEK_SIZE) {
+      struct stat st;
+      return fstat(s->fd, &st) == 0 ? st.st_size : -1;
+    }
+    return lseek(s->fd, offset, whence & ~AVSEEK_FORCE);
+  }
+
+  std::atomic<uint64_t>* packet_count_;
+  int epoll_fd_ = -1;
+  int event_fd_ = -1;
+  std::mutex mutex_;
+  std::condition_variable removed_cond_;
+  std::vector<std::unique_ptr<Stream>> adding_;
+  std::vector<int> removing_;
+  bool stop_ = false;
+  // accessed only in the I/O thread
+  std::vector<std::unique_ptr<Stream>> streams_;
+  size_t cursor_ = 0;
+  std::atomic<size_t> load_{0};
+  std::thread thread_;
+};  // class DemuxReactor::IoThread
+
+DemuxReactor::DemuxReactor(uint32_t thread_num) {
+  static struct _InitFFmpeg {
+    _InitFFmpeg() {
+      avcodec_register_all();
+      av_register_all();
+    }
+  } _init_ffmpeg;
+
+  for (uint32_t i = 0; i < std::max(thread_num, 1u); ++i) {
+    threads_.emplace_back(new IoThread(&packet_count_));
+  }
+}
+
+DemuxReactor::~DemuxReactor() { threads_.clear(); }
+
+int DemuxReactor::AddStream(const StreamParams& params) {
+  if (!params.handler) {
+    LOG(ERROR) << "[EasyDK Samples] [DemuxReactor] AddStream(): Handler is null";
+    return -1;
+  }
+  std::unique_ptr<Stream> stream(new Stream);
+  stream->params = params;
+  if (params.fd >= 0) {
+    stream->fd = params.fd;
+    stream->is_socket = true;
+    fcntl(stream->fd, F_SETFL, fcntl(stream->fd, F_GETFL) | O_NONBLOCK);
+  } else {
+    stream->fd = open(params.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (stream->fd < 0) {
+      LOG(ERROR) << "[EasyDK Samples] [DemuxReactor] AddStream(): Open file failed: " << params.path;
+      return -1;
+    }
+  }
+
+  std::lock_guard<std::mutex> lk(mutex_);
+  int stream_id = next_stream_id_++;
+  stream->id = stream_id;
+  auto it = std::min_element(threads_.begin(), threads_.end(),
+                             [](const std::unique_ptr<IoThread>& a, const std::unique_ptr<IoThread>& b) {
+                               return a->Load() < b->Load();
+                             });
+  stream_threads_[stream_id] = it->get();
+  (*it)->Add(std::move(stream));
+  return stream_id;
+}
+
+void DemuxReactor::RemoveStream(int stream_id) {
+  IoThread* thread = nullptr;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = stream_threads_.find(stream_id);
+    if (it == stream_threads_.end()) return;
+    thread = it->second;
+    stream_threads_.erase(it);
+  }
+  thread->Remove(stream_id);
+}
+
+#ifdef __GNUC__
+#pragma GCC diagnostic pop
+#endif
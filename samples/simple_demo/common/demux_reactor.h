@@ -0,0 +1,87 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef EDK_SAMPLES_DEMUX_REACTOR_H_
+#define EDK_SAMPLES_DEMUX_REACTOR_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "video_parser.h"
+
+/**
+ * DemuxReactor demuxes many streams on a small fixed set of I/O threads, instead of one blocking read loop and one
+ * thread per stream as VideoParser does.
+ *
+ * - Streams are assigned to the I/O thread with the fewest streams.
+ * - An I/O thread serves its streams round-robin, one packet per stream per round, so a fast stream can not starve
+ *   the others.
+ * - Each stream is paced by its pts (or by frame rate if there is no pts). The thread sleeps on epoll until the
+ *   earliest packet is due or a socket becomes readable, nothing sleeps per stream.
+ * - Demuxer reads through AVIO callbacks. Socket data is prefetched when epoll reports it readable, and the demuxer
+ *   runs only if enough data is buffered, so an I/O thread is never blocked by a slow socket.
+ *
+ * Callbacks of IDemuxEventHandle are called in I/O threads, they should return quickly.
+ */
+class DemuxReactor {
+ public:
+  struct StreamParams {
+    /// local file path, used if fd is negative
+    std::string path;
+    /// non-blocking socket or pipe of a byte stream (e.g. H.264 elementary stream over TCP), owned by reactor
+    int fd = -1;
+    /// restarts from the beginning at the end of file, packets continue without EOS
+    bool loop = false;
+    /// sends packets at the pace of pts
+    bool pacing = true;
+    /// used for pacing if packets do not have pts
+    double frame_rate = 25;
+    IDemuxEventHandle* handler = nullptr;
+  };
+
+  explicit DemuxReactor(uint32_t thread_num);
+  ~DemuxReactor();
+  // returns stream id, or -1 if failed
+  int AddStream(const StreamParams& params);
+  // blocks until the handler is not used by reactor, must not be called in handler
+  void RemoveStream(int stream_id);
+  uint32_t GetThreadNum() const { return threads_.size(); }
+  // number of packets sent to handlers
+  uint64_t GetPacketCount() const { return packet_count_.load(); }
+
+ private:
+  struct Stream;
+  class IoThread;
+
+  std::vector<std::unique_ptr<IoThread>> threads_;
+  std::map<int, IoThread*> stream_threads_;
+  std::mutex mutex_;
+  int next_stream_id_ = 0;
+  std::atomic<uint64_t> packet_count_{0};
+};  // class DemuxReactor
+
+#endif  // EDK_SAMPLES_DEMUX_REACTOR_H_
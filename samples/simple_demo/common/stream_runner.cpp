@@ -31,10 +31,67 @@
 
 #include "cnrt.h"
 
+namespace {
+// Reads packets for the supervisor. The decoder is initialized when the parser is opened, and is reset by
+// DecoderSink only
+class ParserSource : public cnedk::StreamSource, private IDemuxEventHandle {
+ public:
+  ParserSource(const std::string& url, VideoDecoder* decoder, cnedk::StreamTiming* timing)
+      : url_(url), decoder_(decoder), timing_(timing), parser_(this) {
+    // the supervisor watches timeout
+    parser_.SetReceiveTimeout(0);
+    parser_.SetStreamTiming(timing);
+  }
+  bool Open() override { return parser_.Open(url_.c_str()); }
+  cnedk::StreamReadStatus Read(cnedk::StreamPacket* packet) override {
+    const AVPacket* av_packet = nullptr;
+    int ret = parser_.ReadPacket(&av_packet);
+    if (ret == 1) return cnedk::StreamReadStatus::EOS;
+    if (ret != 0) return cnedk::StreamReadStatus::ERROR;
+    timing_->RecordCapture(av_packet->pts, cnedk::Clock::Default()->NowUs());
+    packet->data = av_packet->data;
+    packet->size = av_packet->size;
+    packet->pts = av_packet->pts;
+    packet->key_frame = av_packet->flags & AV_PKT_FLAG_KEY;
+    packet->priv = const_cast<AVPacket*>(av_packet);
+    return cnedk::StreamReadStatus::OK;
+  }
+  void Close() override { parser_.Close(); }
+  void Interrupt() override { parser_.Interrupt(); }
+
+ private:
+  bool OnParseInfo(const VideoInfo& info) override { return decoder_->OnParseInfo(info); }
+  bool OnPacket(const AVPacket* packet) override { return true; }
+  void OnEos() override {}
+  bool Running() override { return decoder_->Running(); }
+  void Destroy() override {}
+
+  std::string url_;
+  VideoDecoder* decoder_;
+  cnedk::StreamTiming* timing_;
+  VideoParser parser_;
+};  // class ParserSource
+
+class DecoderSink : public cnedk::StreamSink {
+ public:
+  explicit DecoderSink(VideoDecoder* decoder) : decoder_(decoder) {}
+  bool OnPacket(const cnedk::StreamPacket& packet) override {
+    return decoder_->OnPacket(reinterpret_cast<const AVPacket*>(packet.priv));
+  }
+  void OnReset() override { decoder_->Reset(); }
+  void OnEos() override { decoder_->OnEos(); }
+
+ private:
+  VideoDecoder* decoder_;
+};  // class DecoderSink
+}  // namespace
+
 StreamRunner::StreamRunner(const std::string& data_path, const VideoDecoder::DecoderType decode_type, int dev_id)
     : decoder_(new VideoDecoder(this, decode_type, dev_id)), device_id_(dev_id), data_path_(data_path) {
   parser_.reset(new VideoParser(decoder_.get()));
-  if (!parser_->Open(data_path.c_str())) {
+  parser_->SetStreamTiming(&timing_);
+  // rtsp streams are opened by the supervisor in DemuxLoop
+  if (!IsRtsp(data_path) && !parser_->Open(data_path.c_str())) {
     LOG(ERROR) << "[EasyDK Samples] [StreamRunner] Open video source failed";
   }
 
@@ -51,14 +108,19 @@ void StreamRunner::DemuxLoop(const uint32_t repeat_time) {
   // set mlu environment
   cnrtSetDevice(device_id_);
 
-  bool is_rtsp = parser_->IsRtsp();
+  if (IsRtsp(data_path_)) {
+    SuperviseLoop();
+    if (Running()) decoder_->OnEos();
+    Stop();
+    return;
+  }
+
   uint32_t loop_time = 0;
 
   try {
     while (Running()) {
-      // frame rate control, 25 frame per second for local video
-
-      int ret = parser_->ParseLoop(is_rtsp ? 0 : 40);
+      // frame rate control by pts for local video
+      int ret = parser_->ParseLoop(&pacer_);
       if (ret == -1) {
         LOG(ERROR) << "[EasyDK Samples] [StreamRunner] No video source";
       }
@@ -99,34 +161,62 @@ void StreamRunner::DemuxLoop(const uint32_t repeat_time) {
   Stop();
 }
 
+void StreamRunner::SuperviseLoop() {
+  ParserSource source(data_path_, decoder_.get(), &timing_);
+  DecoderSink sink(decoder_.get());
+  cnedk::StreamSupervisorParams params;
+  params.stall_timeout_ms = kStallTimeoutMs;
+  params.reconnect_timeout_ms = kReconnectTimeoutMs;
+  params.connect_timeout_ms = kReconnectTimeoutMs;
+  params.on_event = [this](const cnedk::StreamHealthEvent& event) { OnHealthEvent(event); };
+
+  cnedk::StreamSupervisor supervisor(&source, &sink, params);
+  supervisor.Start();
+  bool done = false;
+  while (Running() && !(done = supervisor.Wait(100))) {}
+  supervisor.Stop();
+  if (done) {
+    // the stream is failed
+    std::unique_lock<std::mutex> lk(eos_mut_);
+    if (!eos_cond_.wait_for(lk, std::chrono::milliseconds(10000), [this] { return receive_eos_.load(); })) {
+      LOG(WARNING) << "[EasyDK Samples] [StreamRunner] Wait Eos timeout in SuperviseLoop";
+    }
+  }
+}
+
+void StreamRunner::OnHealthEvent(const cnedk::StreamHealthEvent& event) {
+  LOG(INFO) << "[EasyDK Samples] [StreamRunner] OnHealthEvent(): " << data_path_ << " is "
+            << cnedk::StreamHealthName(event.to) << ", " << event.reason;
+}
+
 bool StreamRunner::RunLoop() {
   // set mlu environment
   cnrtSetDevice(device_id_);
-  in_loop_.store(true);
+  {
+    std::unique_lock<std::mutex> lk(loop_mut_);
+    in_loop_ = true;
+  }
+  bool ret = true;
 
   try {
-    while (running_.load()) {
+    // frames received before Stop() are all processed
+    while (true) {
       // inference
-      std::unique_lock<std::mutex> lk(mut_);
-
-      if (!cond_.wait_for(lk, std::chrono::milliseconds(100), [this] { return !frames_.empty(); })) {
-        continue;
-      }
-      CnedkBufSurface* surf = frames_.front();
-      frames_.pop();
-      lk.unlock();
-
-      Process(surf);
+      CnedkBufSurface* surf = nullptr;
+      cnedk::ChannelStatus status = frames_.Pop(&surf);
+      if (status == cnedk::ChannelStatus::CLOSED) break;
+      // nullptr notifies the end of stream
+      Process(status == cnedk::ChannelStatus::EOS ? nullptr : surf);
     }
   } catch (...) {
     LOG(ERROR) << "[EasyDK Samples] [StreamRunner] RunLoop failed.";
-    running_.store(false);
-    in_loop_.store(false);
-    return false;
+    ret = false;
   }
 
   // uninitialize
   running_.store(false);
-  in_loop_.store(false);
-  return true;
+  std::unique_lock<std::mutex> lk(loop_mut_);
+  in_loop_ = false;
+  loop_cond_.notify_all();
+  return ret;
 }
@@ -25,12 +25,14 @@
 #include <condition_variable>
 #include <memory>
 #include <mutex>
-#include <queue>
 #include <string>
 #include <iostream>
 
 #include "cnedk_buf_surface.h"
 #include "cnedk_decode.h"
+#include "cnedk_frame_channel.hpp"
+#include "cnedk_stream_supervisor.hpp"
+#include "cnedk_stream_timing.hpp"
 
 #include "video_decoder.h"
 #include "video_parser.h"
@@ -44,7 +46,7 @@ class StreamRunner : public IDecodeEventHandle {
   void Start() { running_.store(true); }
   void Stop() {
     running_.store(false);
-    cond_.notify_one();
+    frames_.Close();
   }
 
   bool RunLoop();
@@ -52,43 +54,56 @@ class StreamRunner : public IDecodeEventHandle {
   void DemuxLoop(const uint32_t repeat_time);
 
   void OnDecodeEos() override {
+    frames_.PushEos();
     std::unique_lock<std::mutex> lk(eos_mut_);
-    frames_.push(nullptr);
-    cond_.notify_one();
     receive_eos_ = true;
     eos_cond_.notify_one();
   }
 
   void OnDecodeFrame(CnedkBufSurface* surf) override {
-    std::unique_lock<std::mutex> lk(mut_);
-    frames_.push(surf);
-    cond_.notify_one();
+    // pts of frames are media time, capture_time is the time the packet is sent to decoder
+    if (surf) timing_.Stamp(surf);
+    // the frame is destroyed if runner is stopped
+    cnedk::FrameChannel::OnFrame(surf, &frames_);
   }
   int GetDeviceId() { return device_id_; }
 
+  // health of rtsp streams, which are reconnected if lost. Called in demux thread or watchdog thread
+  virtual void OnHealthEvent(const cnedk::StreamHealthEvent& event);
+
   bool Running() const { return running_.load(); }
 
  protected:
   void WaitForRunLoopExit() {
-    while (in_loop_.load()) {}
+    std::unique_lock<std::mutex> lk(loop_mut_);
+    loop_cond_.wait(lk, [this] { return !in_loop_; });
   }
 
   std::unique_ptr<VideoDecoder> decoder_;
 
  private:
   StreamRunner() = delete;
+  void SuperviseLoop();
 
   int device_id_ {0};
+  cnedk::StreamTiming timing_;
+  // local videos are played at the speed of live streams
+  cnedk::PlaybackPacer pacer_;
   std::unique_ptr<VideoParser> parser_;
-  std::queue<CnedkBufSurface*> frames_;
-  std::mutex mut_;
-  std::condition_variable cond_;
+  // decoded frames from decoder thread to RunLoop
+  cnedk::FrameChannel frames_{kFrameChannelCapacity};
   std::string data_path_;
   std::mutex eos_mut_;
   std::condition_variable eos_cond_;
   std::atomic<bool> receive_eos_{false};
   std::atomic<bool> running_{false};
-  std::atomic<bool> in_loop_{false};
+  std::mutex loop_mut_;
+  std::condition_variable loop_cond_;
+  bool in_loop_ = false;
+
+  static constexpr size_t kFrameChannelCapacity = 64;
+  static constexpr uint32_t kStallTimeoutMs = 3000;
+  static constexpr uint32_t kReconnectTimeoutMs = 10000;
 };
 
 #endif  // EDK_SAMPLES_RUNNER_H_
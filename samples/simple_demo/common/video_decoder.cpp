@@ -22,8 +22,10 @@
 // #include <libyuv.h>
 
 #include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "cnrt.h"
 
@@ -63,6 +65,7 @@ class EasyDecodeImpl : public VideoDecoderImpl {
     create_params.OnFrame = OnFrame_;
     create_params.OnEos = OnDecodeEos_;
     create_params.OnError = OnError_;
+    create_params.OnFormatChange = OnFormatChange_;
 
     if (AV_CODEC_ID_H264 == info.codec_id) {
       create_params.type = CNEDK_VDEC_TYPE_H264;
@@ -172,6 +175,22 @@ class EasyDecodeImpl : public VideoDecoderImpl {
       CnedkBufPoolDestroy(surf_pool_);
       surf_pool_ = nullptr;
     }
+    for (void* pool : retired_pools_) {
+      CnedkBufPoolDestroy(pool);
+    }
+    retired_pools_.clear();
+  }
+
+  void Reset() override {
+    // the decoder sends eos when it is destroyed
+    resetting_.store(true);
+    Destroy();
+    resetting_.store(false);
+  }
+
+  static int OnFormatChange_(const CnedkVdecFormatInfo *info, void *userdata) {
+    EasyDecodeImpl *thiz = reinterpret_cast<EasyDecodeImpl*>(userdata);
+    return thiz->OnFormatChange(info);
   }
 
   static int GetBufSurface_(CnedkBufSurface **surf,
@@ -220,13 +239,27 @@ class EasyDecodeImpl : public VideoDecoderImpl {
     return 0;
   }
 
+  int OnFormatChange(const CnedkVdecFormatInfo *info) {
+    LOG(INFO) << "[EasyDK Samples] [EasyDecodeImpl] OnFormatChange(): Resolution changed to " << info->width << "x"
+              << info->height << ", generation: " << info->generation;
+    // frames of the previous resolution may still be used by downstream, the old pool is destroyed with decoder
+    void* pool = nullptr;
+    if (CreateSurfacePool(&pool, info->width, info->height) < 0) {
+      LOG(ERROR) << "[EasyDK Samples] [EasyDecodeImpl] OnFormatChange(): Create BufSurface pool failed";
+      return -1;
+    }
+    retired_pools_.push_back(surf_pool_);
+    surf_pool_ = pool;
+    return 0;
+  }
+
   int OnFrame(CnedkBufSurface *surf) {
     handle_->OnDecodeFrame(surf);
     return 0;
   }
 
   int OnDecodeEos() {
-    handle_->OnDecodeEos();
+    if (!resetting_.load()) handle_->OnDecodeEos();
     return 0;
   }
 
@@ -243,6 +276,8 @@ class EasyDecodeImpl : public VideoDecoderImpl {
   AVCodecContext* codec_ctx_ = nullptr;
   void* vdec_{nullptr};
   void* surf_pool_ = nullptr;
+  std::vector<void*> retired_pools_;
+  std::atomic<bool> resetting_{false};
 };
 
 // _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wdeprecated-declarations\"")
@@ -678,3 +713,8 @@ bool VideoDecoder::Running() {
 void VideoDecoder::Destroy() {
   impl_->Destroy();
 }
+
+void VideoDecoder::Reset() {
+  LOG(INFO) << "[EasyDK Samples] [VideoDecoder] Reset(): Reset decoder";
+  impl_->Reset();
+}
@@ -61,6 +61,8 @@ class VideoDecoderImpl {
   virtual void ReleaseFrame(CnedkBufSurface* frsurfame) = 0;
   // virtual bool CopyFrameD2H(void *dst, const CnBufSurface& surf) = 0;
   virtual void Destroy() = 0;
+  // destroys the decoder without sending eos downstream, Init() is called again with the next stream
+  virtual void Reset() { Destroy(); }
 
  protected:
   VideoDecoder* interface_;
@@ -85,6 +87,7 @@ class VideoDecoder final : public IDemuxEventHandle {
   bool CopyFrameD2H(void *dst, CnedkBufSurface* surf) { return true; }
   void ReleaseFrame(CnedkBufSurface* surf) { CnedkBufSurfaceDestroy(surf); }
   void Destroy();
+  void Reset();
   ~VideoDecoder();
 
  private:
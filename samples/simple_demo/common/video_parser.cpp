@@ -52,9 +52,74 @@ static int InterruptCallBack(void* ctx) {
 }
 }  // namespace detail
 
+bool FindVideoStream(AVFormatContext *format_ctx, int32_t *video_index, VideoInfo *info) {
+  *video_index = -1;
+  AVStream *vstream = nullptr;
+  for (uint32_t iloop = 0; iloop < format_ctx->nb_streams; iloop++) {
+    vstream = format_ctx->streams[iloop];
+  #if LIBAVFORMAT_VERSION_INT >= FFMPEG_VERSION_3_1
+    if (vstream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+  #else
+    if (vstream->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
+  #endif
+      *video_index = iloop;
+      break;
+    }
+  }
+  if (*video_index == -1) {
+    LOG(ERROR) << "[EasyDK Samples] FindVideoStream(): Can not find a video stream.";
+    return false;
+  }
+
+  info->width = vstream->codec->width;
+  info->height = vstream->codec->height;
+
+  // Get codec id, check progressive
+#if LIBAVFORMAT_VERSION_INT >= FFMPEG_VERSION_3_1
+  auto codec_id = vstream->codecpar->codec_id;
+  int field_order = vstream->codecpar->field_order;
+#else
+  auto codec_id = vstream->codec->codec_id;
+  int field_order = vstream->codec->field_order;
+#endif
+  info->codec_id = codec_id;
+#if LIBAVFORMAT_VERSION_INT >= FFMPEG_VERSION_3_1
+  info->codecpar = vstream->codecpar;
+#endif
+  info->codec_ctx = vstream->codec;
+  /*
+   * At this moment, if the demuxer does not set this value (avctx->field_order == UNKNOWN),
+   * the input stream will be assumed as progressive one.
+   */
+  switch (field_order) {
+    case AV_FIELD_TT:
+    case AV_FIELD_BB:
+    case AV_FIELD_TB:
+    case AV_FIELD_BT:
+      info->progressive = 0;
+      break;
+    case AV_FIELD_PROGRESSIVE:  // fall through
+    default:
+      info->progressive = 1;
+      break;
+  }
+
+  // get extra data
+#if LIBAVFORMAT_VERSION_INT >= FFMPEG_VERSION_3_1
+  uint8_t* extradata = vstream->codecpar->extradata;
+  int extradata_size = vstream->codecpar->extradata_size;
+#else
+  uint8_t* extradata = vstream->codec->extradata;
+  int extradata_size = vstream->codec->extradata_size;
+#endif
+  info->extra_data = std::vector<uint8_t>(extradata, extradata + extradata_size);
+  return true;
+}
+
 bool VideoParser::CheckTimeout() {
+  if (interrupted_.load()) return true;
   std::chrono::duration<float, std::milli> dura = std::chrono::steady_clock::now() - last_receive_frame_time_;
-  if (dura.count() > max_receive_timeout_) {
+  if (receive_timeout_ms_ && dura.count() > receive_timeout_ms_) {
     return true;
   }
   return false;
@@ -100,66 +165,21 @@ bool VideoParser::Open(const char *url, bool save_file) {
     LOG(ERROR) << "[EasyDK Samples] [VideoParser] Open(): Can not find stream information.";
     return false;
   }
-  video_index_ = -1;
-  AVStream *vstream = nullptr;
-  for (uint32_t iloop = 0; iloop < p_format_ctx_->nb_streams; iloop++) {
-    vstream = p_format_ctx_->streams[iloop];
-  #if LIBAVFORMAT_VERSION_INT >= FFMPEG_VERSION_3_1
-    if (vstream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-  #else
-    if (vstream->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-  #endif
-      video_index_ = iloop;
-      break;
-    }
-  }
-  if (video_index_ == -1) {
-    LOG(ERROR) << "[EasyDK Samples] [VideoParser] Open(): Can not find a video stream.";
+  if (!FindVideoStream(p_format_ctx_, &video_index_, &info_)) {
     return false;
   }
-
-  info_.width = vstream->codec->width;
-  info_.height = vstream->codec->height;
-
-  // Get codec id, check progressive
-#if LIBAVFORMAT_VERSION_INT >= FFMPEG_VERSION_3_1
-  auto codec_id = vstream->codecpar->codec_id;
-  int field_order = vstream->codecpar->field_order;
-#else
-  auto codec_id = vstream->codec->codec_id;
-  int field_order = vstream->codec->field_order;
-#endif
-  info_.codec_id = codec_id;
-#if LIBAVFORMAT_VERSION_INT >= FFMPEG_VERSION_3_1
-  info_.codecpar = p_format_ctx_->streams[video_index_]->codecpar;
-#endif
-  info_.codec_ctx = p_format_ctx_->streams[video_index_]->codec;
-  /*
-   * At this moment, if the demuxer does not set this value (avctx->field_order == UNKNOWN),
-   * the input stream will be assumed as progressive one.
-   */
-  switch (field_order) {
-    case AV_FIELD_TT:
-    case AV_FIELD_BB:
-    case AV_FIELD_TB:
-    case AV_FIELD_BT:
-      info_.progressive = 0;
-      break;
-    case AV_FIELD_PROGRESSIVE:  // fall through
-    default:
-      info_.progressive = 1;
-      break;
+  if (timing_) {
+    auto vstream = p_format_ctx_->streams[video_index_];
+    cnedk::StreamTimingParams timing_params;
+    timing_params.time_base_num = vstream->time_base.num;
+    timing_params.time_base_den = vstream->time_base.den;
+    if (vstream->avg_frame_rate.num && vstream->avg_frame_rate.den) {
+      timing_params.frame_rate = av_q2d(vstream->avg_frame_rate);
+    }
+    timing_params.pts_wrap_bits = vstream->pts_wrap_bits;
+    timing_->Rebase(timing_params);
   }
-
-  // get extra data
-#if LIBAVFORMAT_VERSION_INT >= FFMPEG_VERSION_3_1
-  uint8_t* extradata = vstream->codecpar->extradata;
-  int extradata_size = vstream->codecpar->extradata_size;
-#else
-  uint8_t* extradata = vstream->codec->extradata;
-  int extradata_size = vstream->codec->extradata_size;
-#endif
-  info_.extra_data = std::vector<uint8_t>(extradata, extradata + extradata_size);
+  auto codec_id = info_.codec_id;
 
   LOG(INFO) << "[EasyDK Samples] [VideoParser] Open(): Format name is " << p_format_ctx_->iformat->name;
   if (strstr(p_format_ctx_->iformat->name, "mp4") || strstr(p_format_ctx_->iformat->name, "flv") ||
@@ -187,38 +207,59 @@ bool VideoParser::Open(const char *url, bool save_file) {
 }
 
 void VideoParser::Close() {
-  if (!have_video_source_.load()) return;
-  LOG(INFO) << "[EasyDK Samples] [VideoParser] Close(): Clear FFMpeg resources";
+  interrupted_.store(false);
+  // also released if open failed
   if (p_format_ctx_) {
     avformat_close_input(&p_format_ctx_);
     avformat_free_context(p_format_ctx_);
-    av_dict_free(&options_);
     p_format_ctx_ = nullptr;
-    options_ = nullptr;
   }
+  av_dict_free(&options_);
+  options_ = nullptr;
+  if (!have_video_source_.load()) return;
+  LOG(INFO) << "[EasyDK Samples] [VideoParser] Close(): Clear FFMpeg resources";
+  av_packet_unref(&packet_);
   have_video_source_.store(false);
   frame_index_ = 0;
   saver_.reset();
   handler_->Destroy();
 }
 
-int VideoParser::ParseLoop(uint32_t frame_interval) {
-  auto now_time = std::chrono::steady_clock::now();
-  auto last_time = std::chrono::steady_clock::now();
-  std::chrono::duration<double, std::milli> dura;
-
+int VideoParser::ParseLoop(cnedk::PlaybackPacer* pacer) {
   while (handler_->Running()) {
-    if (!have_video_source_.load()) {
-      LOG(ERROR) << "[EasyDK Samples] [VideoParser] ParseLoop(): Video source has not been init";
-      return -1;
-    }
-
-    if (av_read_frame(p_format_ctx_, &packet_) < 0) {
+    const AVPacket* packet = nullptr;
+    int ret = ReadPacket(&packet);
+    if (ret < 0 && !have_video_source_.load()) return -1;
+    if (ret != 0) {
       // EOS
       handler_->OnEos();
       return 1;
     }
 
+    // frame rate control, packets are sent in decode order
+    if (pacer) pacer->Pace(packet->dts);
+    if (timing_) timing_->RecordCapture(packet->pts, cnedk::Clock::Default()->NowUs());
+
+    if (!handler_->OnPacket(packet)) return -1;
+  }  // while (true)
+
+  return 1;
+}
+
+int VideoParser::ReadPacket(const AVPacket** packet) {
+  if (!have_video_source_.load()) {
+    LOG(ERROR) << "[EasyDK Samples] [VideoParser] ReadPacket(): Video source has not been init";
+    return -1;
+  }
+  // release the last packet
+  av_packet_unref(&packet_);
+
+  while (true) {
+    int ret_code = av_read_frame(p_format_ctx_, &packet_);
+    if (ret_code < 0) {
+      return ret_code == AVERROR_EOF ? 1 : -1;
+    }
+
     // update receive frame time
     last_receive_frame_time_ = std::chrono::steady_clock::now();
 
@@ -230,11 +271,11 @@ int VideoParser::ParseLoop(uint32_t frame_interval) {
 
     // filter non-key-frame in head
     if (first_frame_) {
-      VLOG(1) << "[EasyDK Samples] [VideoParser] ParseLoop(): Check first frame";
+      VLOG(1) << "[EasyDK Samples] [VideoParser] ReadPacket(): Check first frame";
       if (packet_.flags & AV_PKT_FLAG_KEY) {
         first_frame_ = false;
       } else {
-        LOG(WARNING) << "[EasyDK Samples] [VideoParser]ParseLoop():  Skip first not-key-frame";
+        LOG(WARNING) << "[EasyDK Samples] [VideoParser] ReadPacket(): Skip first not-key-frame";
         av_packet_unref(&packet_);
         continue;
       }
@@ -242,33 +283,28 @@ int VideoParser::ParseLoop(uint32_t frame_interval) {
 
     // parse data from packet
     auto vstream = p_format_ctx_->streams[video_index_];
+    // reorder delay of the packet, its decode time is pts minus the delay
+    int64_t reorder = 0;
+    if (AV_NOPTS_VALUE != packet_.pts && AV_NOPTS_VALUE != packet_.dts) {
+      reorder = av_rescale_q(packet_.pts - packet_.dts, vstream->time_base, {1, 90000});
+    }
     // find pts information
-    if (AV_NOPTS_VALUE == packet_.pts) {
-      VLOG(5) << "[EasyDK Samples] [VideoParser] ParseLoop(): Didn't find pts informations,"
+    if (timing_) {
+      packet_.pts = timing_->ToMediaTime(AV_NOPTS_VALUE == packet_.pts ? cnedk::kNoPts : packet_.pts);
+    } else if (AV_NOPTS_VALUE == packet_.pts) {
+      VLOG(5) << "[EasyDK Samples] [VideoParser] ReadPacket(): Didn't find pts informations,"
               << " use ordered numbers instead.";
       packet_.pts = frame_index_++;
     } else {
       packet_.pts = av_rescale_q(packet_.pts, vstream->time_base, {1, 90000});
     }
+    // dts is in the same time base as pts
+    packet_.dts = packet_.pts - reorder;
 
     if (saver_) {
       saver_->Write(reinterpret_cast<char *>(packet_.data), packet_.size);
     }
-
-    if (!handler_->OnPacket(&packet_)) return -1;
-
-    av_packet_unref(&packet_);
-
-    // frame rate control
-    if (frame_interval) {
-      now_time = std::chrono::steady_clock::now();
-      dura = now_time - last_time;
-      if (frame_interval > dura.count()) {
-        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(frame_interval - dura.count()));
-      }
-      last_time = std::chrono::steady_clock::now();
-    }
-  }  // while (true)
-
-  return 1;
+    *packet = &packet_;
+    return 0;
+  }
 }
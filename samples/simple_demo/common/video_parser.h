@@ -28,6 +28,7 @@
 #include <string>
 #include <vector>
 
+#include "cnedk_stream_timing.hpp"
 
 #ifdef __cplusplus
 extern "C" {
@@ -85,6 +86,9 @@ struct VideoInfo {
   int progressive = 0;
 };
 
+// Finds the first video stream of an opened input, and fills video information
+bool FindVideoStream(AVFormatContext* format_ctx, int32_t* video_index, VideoInfo* info);
+
 class IDemuxEventHandle {
  public:
   virtual bool OnParseInfo(const VideoInfo& info) = 0;
@@ -99,16 +103,26 @@ class VideoParser {
   explicit VideoParser(IDemuxEventHandle* handle) : handler_(handle) {}
   ~VideoParser() { Close(); }
   bool Open(const char* url, bool save_file = false);
-  // -1 for error, 1 for eos
-  int ParseLoop(uint32_t frame_interval);
+  // -1 for error, 1 for eos. Packets are paced by pts if pacer is not nullptr
+  int ParseLoop(cnedk::PlaybackPacer* pacer);
+  // 0 for a packet, -1 for error, 1 for eos. The packet is valid until the next call or Close()
+  int ReadPacket(const AVPacket** packet);
   void Close();
   bool CheckTimeout();
+  // 0 for no timeout, reading from rtsp is interrupted if no packet is received for this long
+  void SetReceiveTimeout(uint32_t timeout_ms) { receive_timeout_ms_ = timeout_ms; }
+  // makes blocking reading from rtsp return until closed, could be called in other threads
+  void Interrupt() { interrupted_.store(true); }
   bool IsRtsp() { return is_rtsp_; }
+  // pts of packets are converted to media time by timing, which is rebased every time the source is opened
+  void SetStreamTiming(cnedk::StreamTiming* timing) { timing_ = timing; }
 
   const VideoInfo& GetVideoInfo() const { return info_; }
 
  private:
-  static constexpr uint32_t max_receive_timeout_{3000};
+  uint32_t receive_timeout_ms_{3000};
+  std::atomic<bool> interrupted_{false};
+  cnedk::StreamTiming* timing_{nullptr};
 
   AVFormatContext* p_format_ctx_ = nullptr;
   AVPacket packet_;
@@ -0,0 +1,147 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "demux_reactor.h"
+#include "video_parser.h"
+
+DEFINE_string(data_path, "", "video path");
+DEFINE_int32(stream_num, 256, "number of streams, all streams loop the same file");
+DEFINE_int32(duration, 30, "benchmark duration in seconds");
+DEFINE_string(mode, "reactor", "demux mode, choose from reactor/thread. thread mode uses one VideoParser per stream");
+DEFINE_int32(io_threads, 4, "number of I/O threads in reactor mode");
+
+// Counts packets only, so the benchmark measures demux cost
+class CountingHandler : public IDemuxEventHandle {
+ public:
+  bool OnParseInfo(const VideoInfo& info) override { return true; }
+  bool OnPacket(const AVPacket* packet) override {
+    packet_count_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  void OnEos() override { eos_ = true; }
+  bool Running() override { return running_.load(); }
+  void Destroy() override {}
+
+  void Stop() { running_.store(false); }
+  uint64_t GetPacketCount() const { return packet_count_.load(); }
+  bool Eos() const { return eos_.load(); }
+  void ResetEos() { eos_ = false; }
+
+ private:
+  std::atomic<uint64_t> packet_count_{0};
+  std::atomic<bool> running_{true};
+  std::atomic<bool> eos_{false};
+};  // class CountingHandler
+
+static int GetThreadCount() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 8, "Threads:") == 0) return std::stoi(line.substr(8));
+  }
+  return -1;
+}
+
+static double GetCpuSeconds() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+int main(int argc, char** argv) {
+  google::ParseCommandLineFlags(&argc, &argv, false);
+  google::InitGoogleLogging(argv[0]);
+
+  if (FLAGS_data_path.empty() || FLAGS_stream_num <= 0 || FLAGS_duration <= 0) {
+    LOG(ERROR) << "[EasyDK Samples] [DemuxBench] Invalid parameters";
+    return 1;
+  }
+  if (FLAGS_mode != "reactor" && FLAGS_mode != "thread") {
+    LOG(ERROR) << "[EasyDK Samples] [DemuxBench] Unknown mode: " << FLAGS_mode;
+    return 1;
+  }
+
+  std::vector<std::unique_ptr<CountingHandler>> handlers;
+  for (int i = 0; i < FLAGS_stream_num; ++i) handlers.emplace_back(new CountingHandler);
+
+  double cpu_start = GetCpuSeconds();
+  auto start = std::chrono::steady_clock::now();
+  int thread_count = 0;
+
+  if (FLAGS_mode == "reactor") {
+    DemuxReactor reactor(FLAGS_io_threads);
+    for (auto& handler : handlers) {
+      DemuxReactor::StreamParams params;
+      params.path = FLAGS_data_path;
+      params.loop = true;
+      params.handler = handler.get();
+      if (reactor.AddStream(params) < 0) return 1;
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(FLAGS_duration));
+    thread_count = GetThreadCount();
+    for (auto& handler : handlers) handler->Stop();
+  } else {
+    std::vector<std::thread> threads;
+    for (auto& handler : handlers) {
+      CountingHandler* h = handler.get();
+      threads.emplace_back([h] {
+        // the same as what StreamRunner does with VideoParser, paced at 25fps and reopened for every loop
+        while (h->Running()) {
+          VideoParser parser(h);
+          if (!parser.Open(FLAGS_data_path.c_str())) return;
+          h->ResetEos();
+          while (h->Running() && !h->Eos()) {
+            if (parser.ParseLoop(40) < 0) return;
+          }
+        }
+      });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(FLAGS_duration));
+    thread_count = GetThreadCount();
+    for (auto& handler : handlers) handler->Stop();
+    for (auto& thread : threads) thread.join();
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double cpu = GetCpuSeconds() - cpu_start;
+  uint64_t packets = 0;
+  for (auto& handler : handlers) packets += handler->GetPacketCount();
+
+  std::cout << "mode: " << FLAGS_mode << ", streams: " << FLAGS_stream_num << std::endl;
+  std::cout << "threads: " << thread_count << std::endl;
+  std::cout << "packets: " << packets << ", " << packets / seconds << " packets/s" << std::endl;
+  std::cout << "cpu: " << cpu << " s, " << cpu * 100 / seconds << "%, " << cpu * 1e6 / std::max<uint64_t>(packets, 1)
+            << " us/packet" << std::endl;
+  return 0;
+}
@@ -31,6 +31,7 @@ namespace cnedk {
 // IDecoder
 int DecoderCe3226::Create(CnedkVdecCreateParams *params) {
   create_params_ = *params;
+  format_tracker_.Reset();
   cnEnPayloadType_t type;
   switch (create_params_.type) {
     case CNEDK_VDEC_TYPE_H264:
@@ -112,6 +113,13 @@ void DecoderCe3226::OnFrame(void *handle, const cnVideoFrameInfo_t *info) {
   rectify_info->stVFrame.u32Width += rectify_info->stVFrame.u32Width & 1;
   rectify_info->stVFrame.u32Height -= rectify_info->stVFrame.u32Height & 1;
 
+  if (format_tracker_.Update(create_params_, rectify_info->stVFrame.u32Width, rectify_info->stVFrame.u32Height,
+                             GetSurfFmt(info->stVFrame.enPixelFormat)) < 0) {
+    create_params_.OnError(-1, create_params_.userdata);
+    MpsService::Instance().VDecReleaseFrame(handle, info);
+    return;
+  }
+
   CnedkBufSurface *surf = nullptr;
   if (create_params_.GetBufSurf(&surf, rectify_info->stVFrame.u32Width, rectify_info->stVFrame.u32Height,
                                GetSurfFmt(info->stVFrame.enPixelFormat), create_params_.surf_timeout_ms,
@@ -138,6 +146,7 @@ void DecoderCe3226::OnFrame(void *handle, const cnVideoFrameInfo_t *info) {
   MpsService::Instance().VDecReleaseFrame(handle, info);
 
   surf->pts = rectify_info->stVFrame.u64PTS;
+  format_tracker_.Stamp(surf);
   create_params_.OnFrame(surf, create_params_.userdata);
   return;
 }
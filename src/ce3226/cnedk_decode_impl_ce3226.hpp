@@ -22,6 +22,7 @@
 #define CNEDK_DECODE_IMPL_CE3226_HPP_
 
 #include "../cnedk_decode_impl.hpp"
+#include "../common/vdec_format_tracker.hpp"
 #include "ce3226_helper.hpp"
 #include "mps_service/mps_service.hpp"
 
@@ -43,6 +44,7 @@ class DecoderCe3226 : public IDecoder, public IVDecResult {
 
  private:
   CnedkVdecCreateParams create_params_;
+  VdecFormatTracker format_tracker_;
   void *vdec_ = nullptr;
 };
 
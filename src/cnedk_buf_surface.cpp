@@ -19,6 +19,7 @@
  *************************************************************************/
 
 #include "cnedk_buf_surface.h"
+#include "cnedk_buf_surface_shm.h"
 
 #include <algorithm>
 #include <cstring>  // for memset
@@ -44,7 +45,8 @@ class BufSurfaceService {
     return *instance_;
   }
   ~BufSurfaceService() = default;
-  int BufPoolCreate(void **pool, CnedkBufSurfaceCreateParams *params, uint32_t block_num) {
+  int BufPoolCreate(void **pool, CnedkBufSurfaceCreateParams *params, uint32_t block_num,
+                    const std::string &category = kMemCategoryBufPool) {
     if (pool && params && block_num) {
       MemPool *mempool = new MemPool();
       if (!mempool) {
@@ -52,7 +54,7 @@ class BufSurfaceService {
         return -1;
       }
       *pool = reinterpret_cast<void *>(mempool);
-      if (mempool->Create(params, block_num) == 0) {
+      if (mempool->Create(params, block_num, category) == 0) {
         return 0;
       }
       delete mempool;
@@ -121,6 +123,60 @@ class BufSurfaceService {
     return -1;
   }
 
+  int CreateShared(CnedkBufSurface **surf, CnedkBufSurfaceCreateParams *params) {
+    if (surf && params) {
+      CnedkBufSurface surface;
+      if (CreateSharedSurface(params, &surface) < 0) {
+        LOG(ERROR) << "[EasyDK] [BufSurfaceService] CreateShared(): Create shared BufSurface failed";
+        return -1;
+      }
+      *surf = AllocSurface();
+      if (!(*surf)) {
+        DestroySurface(&surface);
+        LOG(ERROR) << "[EasyDK] [BufSurfaceService] CreateShared(): Alloc BufSurface failed";
+        return -1;
+      }
+      *(*surf) = surface;
+      return 0;
+    }
+    LOG(ERROR) << "[EasyDK] [BufSurfaceService] CreateShared(): surf or params is nullptr";
+    return -1;
+  }
+  int OpenShared(CnedkBufSurface **surf, const CnedkBufSurfaceShmHandle *handle) {
+    if (surf && handle) {
+      std::string name(handle->name, strnlen(handle->name, CNEDK_BUF_SHM_NAME_LENGTH));
+      CnedkBufSurface surface;
+      if (OpenSharedSurface(name, &surface) < 0) {
+        LOG(ERROR) << "[EasyDK] [BufSurfaceService] OpenShared(): Open shared BufSurface failed";
+        return -1;
+      }
+      *surf = AllocSurface();
+      if (!(*surf)) {
+        DestroySurface(&surface);
+        LOG(ERROR) << "[EasyDK] [BufSurfaceService] OpenShared(): Alloc BufSurface failed";
+        return -1;
+      }
+      *(*surf) = surface;
+      return 0;
+    }
+    LOG(ERROR) << "[EasyDK] [BufSurfaceService] OpenShared(): surf or handle is nullptr";
+    return -1;
+  }
+  int GetShmHandle(CnedkBufSurface *surf, CnedkBufSurfaceShmHandle *handle) {
+    if (!surf || !handle) {
+      LOG(ERROR) << "[EasyDK] [BufSurfaceService] GetShmHandle(): surf or handle is nullptr";
+      return -1;
+    }
+    std::string name = GetSharedSurfaceName(surf);
+    if (name.empty() || name.size() >= CNEDK_BUF_SHM_NAME_LENGTH) {
+      LOG(ERROR) << "[EasyDK] [BufSurfaceService] GetShmHandle(): BufSurface is not allocated in shared memory";
+      return -1;
+    }
+    memset(handle, 0, sizeof(CnedkBufSurfaceShmHandle));
+    memcpy(handle->name, name.c_str(), name.size());
+    return 0;
+  }
+
   int Destroy(CnedkBufSurface *surf) {
     if (!surf) {
       LOG(ERROR) << "[EasyDK] [BufSurfaceService] Destroy(): surf is nullptr";
@@ -238,6 +294,8 @@ class BufSurfaceService {
     }
 
     dst_surf->pts = src_surf->pts;
+    CnedkBufSurfaceSetGeneration(dst_surf, CnedkBufSurfaceGetGeneration(src_surf));
+    CnedkBufSurfaceSetCaptureTime(dst_surf, CnedkBufSurfaceGetCaptureTime(src_surf));
     bool src_host = (src_surf->mem_type == CNEDK_BUF_MEM_SYSTEM || src_surf->mem_type == CNEDK_BUF_MEM_PINNED);
 
     bool dst_host = (dst_surf->mem_type == CNEDK_BUF_MEM_SYSTEM || dst_surf->mem_type == CNEDK_BUF_MEM_PINNED);
@@ -248,11 +306,14 @@ class BufSurfaceService {
     }
 
     for (size_t i = 0; i < src_surf->batch_size; ++i) {
-      if (src_surf->surface_list[i].data_size != dst_surf->surface_list[i].data_size) {
+      if (src_surf->surface_list[i].data_size != dst_surf->surface_list[i].data_size && dst_host && src_host) {
+        if (CopyPlanesHost(src_surf->surface_list[i], &dst_surf->surface_list[i]) < 0) {
+          LOG(ERROR) << "[EasyDK] [BufSurfaceService] Copy(): copy planes failed";
+          return -1;
+        }
+      } else if (src_surf->surface_list[i].data_size != dst_surf->surface_list[i].data_size) {
         uint8_t* src_data_ptr = reinterpret_cast<uint8_t*>(src_surf->surface_list[i].data_ptr);
         uint8_t* dst_data_ptr = reinterpret_cast<uint8_t*>(dst_surf->surface_list[i].data_ptr);
-        uint8_t* src = src_data_ptr;
-        uint8_t* dst = dst_data_ptr;
 
         for (uint32_t plane_idx = 0 ; plane_idx < src_surf->surface_list[i].plane_params.num_planes; plane_idx++) {
           uint32_t src_plane_offset = src_surf->surface_list[i].plane_params.offset[plane_idx];
@@ -271,11 +332,10 @@ class BufSurfaceService {
                        << " or bytes_per_pix is wrong";
             return -1;
           }
-          for (uint32_t h_idx = 0; h_idx < src_surf->surface_list[i].plane_params.height[i]; h_idx++) {
-            if (dst_host && src_host) {
-              CNRT_SAFECALL(cnrtMemcpy(dst, src, copy_size, cnrtMemcpyHostToHost),
-                            "[BufSurfaceService] Copy(): failed", -1);
-            } else if (dst_host && !src_host) {
+          uint8_t* src = src_data_ptr + src_plane_offset;
+          uint8_t* dst = dst_data_ptr + dst_plane_offset;
+          for (uint32_t h_idx = 0; h_idx < src_surf->surface_list[i].plane_params.height[plane_idx]; h_idx++) {
+            if (dst_host && !src_host) {
               CNRT_SAFECALL(cnrtMemcpy(dst, src, copy_size, cnrtMemcpyDevToHost),
                             "[BufSurfaceService] Copy(): failed", -1);
             } else if (!dst_host && src_host) {
@@ -288,8 +348,6 @@ class BufSurfaceService {
             src += src_step;
             dst += dst_step;
           }
-          src = src_data_ptr + src_plane_offset;
-          dst = dst_data_ptr + dst_plane_offset;
         }
       } else {
         if (dst_host && src_host) {
@@ -374,6 +432,10 @@ class BufSurfaceService {
 
 std::unique_ptr<BufSurfaceService> BufSurfaceService::instance_;
 
+int BufPoolCreate(void **pool, CnedkBufSurfaceCreateParams *params, uint32_t block_num, const std::string &category) {
+  return BufSurfaceService::Instance().BufPoolCreate(pool, params, block_num, category);
+}
+
 }  // namespace cnedk
 
 extern "C" {
@@ -393,6 +455,20 @@ int CnedkBufSurfaceCreate(CnedkBufSurface **surf, CnedkBufSurfaceCreateParams *p
 
 int CnedkBufSurfaceDestroy(CnedkBufSurface *surf) { return cnedk::BufSurfaceService::Instance().Destroy(surf); }
 
+int CnedkBufSurfaceCreateShared(CnedkBufSurface **surf, CnedkBufSurfaceCreateParams *params) {
+  return cnedk::BufSurfaceService::Instance().CreateShared(surf, params);
+}
+
+int CnedkBufSurfaceGetShmHandle(CnedkBufSurface *surf, CnedkBufSurfaceShmHandle *handle) {
+  return cnedk::BufSurfaceService::Instance().GetShmHandle(surf, handle);
+}
+
+int CnedkBufSurfaceOpenShared(CnedkBufSurface **surf, const CnedkBufSurfaceShmHandle *handle) {
+  return cnedk::BufSurfaceService::Instance().OpenShared(surf, handle);
+}
+
+int CnedkBufSurfaceShmCleanup(void) { return cnedk::CleanupSharedSurfaces(); }
+
 int CnedkBufSurfaceSyncForCpu(CnedkBufSurface *surf, int index, int plane) {
   return cnedk::BufSurfaceService::Instance().SyncForCpu(surf, index, plane);
 }
@@ -409,4 +485,24 @@ int CnedkBufSurfaceCopy(CnedkBufSurface *src_surf, CnedkBufSurface *dst_surf) {
   return cnedk::BufSurfaceService::Instance().Copy(src_surf, dst_surf);
 }
 
+uint32_t CnedkBufSurfaceGetGeneration(const CnedkBufSurface *surf) {
+  uint32_t generation = 0;
+  if (surf) memcpy(&generation, &surf->_reserved[cnedk::kReservedGeneration], sizeof(generation));
+  return generation;
+}
+
+void CnedkBufSurfaceSetGeneration(CnedkBufSurface *surf, uint32_t generation) {
+  if (surf) memcpy(&surf->_reserved[cnedk::kReservedGeneration], &generation, sizeof(generation));
+}
+
+uint64_t CnedkBufSurfaceGetCaptureTime(const CnedkBufSurface *surf) {
+  uint64_t capture_time = 0;
+  if (surf) memcpy(&capture_time, &surf->_reserved[cnedk::kReservedCaptureTime], sizeof(capture_time));
+  return capture_time;
+}
+
+void CnedkBufSurfaceSetCaptureTime(CnedkBufSurface *surf, uint64_t capture_time) {
+  if (surf) memcpy(&surf->_reserved[cnedk::kReservedCaptureTime], &capture_time, sizeof(capture_time));
+}
+
 };  // extern "C"
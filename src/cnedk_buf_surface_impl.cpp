@@ -27,16 +27,20 @@
 #include "cnrt.h"
 
 #include "cnedk_buf_surface_impl_device.h"
+#include "cnedk_buf_surface_impl_shm.h"
 #include "cnedk_buf_surface_impl_system.h"
 #ifdef PLATFORM_CE3226
 #include "cnedk_buf_surface_impl_unified.h"
 #include "cnedk_buf_surface_impl_vb.h"
 #endif
-#include "cnedk_platform.h"
+#include "cnedk_platform_caps.hpp"
 
 namespace cnedk {
 
-int MemPool::Create(CnedkBufSurfaceCreateParams *params, uint32_t block_num) {
+// the pool reserving memory in this thread, its mutex is held so that it must not be trimmed by its own reservation
+static thread_local const MemPool *g_reserving_pool = nullptr;
+
+int MemPool::Create(CnedkBufSurfaceCreateParams *params, uint32_t block_num, const std::string &category) {
   std::unique_lock<std::mutex> lk(mutex_);
   if (created_) {
     LOG(ERROR) << "[EasyDK] [MemPool] Create(): Pool has been created";
@@ -51,17 +55,14 @@ int MemPool::Create(CnedkBufSurfaceCreateParams *params, uint32_t block_num) {
 
   cnrtSetDevice(device_id_);
 
-  CnedkPlatformInfo info;
-  if (CnedkPlatformGetInfo(device_id_, &info) < 0) {
+  const DeviceCaps *caps = PlatformCaps::Instance().GetDevice(device_id_);
+  if (!caps) {
     LOG(ERROR) << "[EasyDK] [MemPool] Create(): Get Platfrom information failed";
     return -1;
   }
 
   if (params->mem_type == CNEDK_BUF_MEM_DEFAULT) {
-    if (info.support_unified_addr)
-      params->mem_type = CNEDK_BUF_MEM_UNIFIED;
-    else
-      params->mem_type = CNEDK_BUF_MEM_DEVICE;
+    params->mem_type = caps->DefaultMemType();
   }
 
   allocator_ = CreateMemAllocator(params->mem_type, block_num);
@@ -77,15 +78,27 @@ int MemPool::Create(CnedkBufSurfaceCreateParams *params, uint32_t block_num) {
 
   is_fake_mapped_ = (params->mem_type == CNEDK_BUF_MEM_DEVICE);
   is_vb_pool_ = (params->mem_type == CNEDK_BUF_MEM_VB || params->mem_type == CNEDK_BUF_MEM_VB_CACHED);
+  block_num_ = block_num;
+  block_count_ = 0;
+  block_size_ = 0;
   if (!is_vb_pool_) {
+    bool host = params->mem_type == CNEDK_BUF_MEM_SYSTEM || params->mem_type == CNEDK_BUF_MEM_PINNED;
+    account_.reset(new MemoryAccount(host ? kHostMemory : device_id_, category, MemLimits(),
+                                     [this](size_t bytes) { return Trim(bytes); }));
     // cache the blocks
     for (uint32_t i = 0; i < block_num; i++) {
       CnedkBufSurface surf;
-      if (allocator_->Alloc(&surf) < 0) {
+      if (AllocBlock(&surf) < 0) {
         LOG(ERROR) << "[EasyDK] [MemPool] Create(): Memory allocator alloc BufSurface failed";
+        while (!cache_.empty()) {
+          FreeBlock(&cache_.front());
+          cache_.pop();
+        }
+        account_.reset();
+        allocator_->Destroy();
+        delete allocator_, allocator_ = nullptr;
         return -1;
       }
-      surf.opaque = reinterpret_cast<void *>(this);
       cache_.push(surf);
     }
   }
@@ -113,8 +126,9 @@ int MemPool::Destroy() {
     while (!cache_.empty()) {
       auto surf = cache_.front();
       cache_.pop();
-      allocator_->Free(&surf);
+      FreeBlock(&surf);
     }
+    account_.reset();
   }
 
   // FIXME
@@ -147,13 +161,16 @@ int MemPool::Alloc(CnedkBufSurface *surf) {
   }
 
   if (cache_.empty()) {
-    VLOG(4) << "[EasyDK] [MemPool] Alloc(): Memory cache is empty";
-    return -1;
+    // allocate the block trimmed before
+    if (block_count_ >= block_num_ || AllocBlock(surf) < 0) {
+      VLOG(4) << "[EasyDK] [MemPool] Alloc(): Memory cache is empty";
+      return -1;
+    }
+  } else {
+    *surf = cache_.front();
+    cache_.pop();
   }
 
-  *surf = cache_.front();
-  cache_.pop();
-
   ++alloc_count_;
   return 0;
 }
@@ -175,11 +192,76 @@ int MemPool::Free(CnedkBufSurface *surf) {
     // reset mapped_data_ptr to zero
     for (size_t i = 0; i < surf->batch_size; i++) surf->surface_list[i].mapped_data_ptr = nullptr;
   }
-  cache_.push(*surf);
+  // stamps of the frame are not inherited by the next user of the block
+  CnedkBufSurfaceSetGeneration(surf, 0);
+  CnedkBufSurfaceSetCaptureTime(surf, 0);
   --alloc_count_;
+  if (account_->OverSoftLimit()) {
+    // do not keep idle blocks under memory pressure
+    FreeBlock(surf);
+    return 0;
+  }
+  cache_.push(*surf);
   return 0;
 }
 
+bool MemPool::Reserve(size_t bytes) {
+  g_reserving_pool = this;
+  bool reserved = account_->Reserve(bytes);
+  g_reserving_pool = nullptr;
+  return reserved;
+}
+
+int MemPool::AllocBlock(CnedkBufSurface *surf) {
+  if (block_size_ && !Reserve(block_size_)) {
+    VLOG(3) << "[EasyDK] [MemPool] AllocBlock(): Out of memory budget, block size: " << block_size_;
+    return -1;
+  }
+  if (allocator_->Alloc(surf) < 0) {
+    if (block_size_) account_->Release(block_size_);
+    return -1;
+  }
+  if (!block_size_) {
+    // the size of blocks is known after the first allocation
+    size_t block_size = 0;
+    for (uint32_t i = 0; i < surf->batch_size; i++) block_size += surf->surface_list[i].data_size;
+    if (!Reserve(block_size)) {
+      VLOG(3) << "[EasyDK] [MemPool] AllocBlock(): Out of memory budget, block size: " << block_size;
+      allocator_->Free(surf);
+      return -1;
+    }
+    block_size_ = block_size;
+  }
+  surf->opaque = reinterpret_cast<void *>(this);
+  ++block_count_;
+  return 0;
+}
+
+void MemPool::FreeBlock(CnedkBufSurface *surf) {
+  allocator_->Free(surf);
+  account_->Release(block_size_);
+  --block_count_;
+}
+
+size_t MemPool::Trim(size_t bytes) {
+  if (g_reserving_pool == this) return 0;
+  std::unique_lock<std::mutex> lk(mutex_, std::try_to_lock);
+  if (!lk.owns_lock() || !created_) return 0;
+  int current_dev = -1;
+  cnrtGetDevice(&current_dev);
+  cnrtSetDevice(device_id_);
+  size_t released = 0;
+  while (released < bytes && !cache_.empty()) {
+    auto surf = cache_.front();
+    cache_.pop();
+    FreeBlock(&surf);
+    released += block_size_;
+  }
+  if (current_dev >= 0) cnrtSetDevice(current_dev);
+  VLOG(3) << "[EasyDK] [MemPool] Trim(): Free idle blocks, " << released << " bytes";
+  return released;
+}
+
 //
 IMemAllcator *CreateMemAllocator(CnedkBufSurfaceMemType mem_type, uint32_t block_num) {
   if (mem_type == CNEDK_BUF_MEM_VB || mem_type == CNEDK_BUF_MEM_VB_CACHED) {
@@ -216,17 +298,14 @@ int CreateSurface(CnedkBufSurfaceCreateParams *params, CnedkBufSurface *surf) {
     return -1;
   }
 
-  CnedkPlatformInfo info;
-  if (CnedkPlatformGetInfo(params->device_id, &info) < 0) {
+  const DeviceCaps *caps = PlatformCaps::Instance().GetDevice(params->device_id);
+  if (!caps) {
     LOG(ERROR) << "[EasyDK] CreateSurface(): Get platform information failed";
     return -1;
   }
 
   if (params->mem_type == CNEDK_BUF_MEM_DEFAULT) {
-    if (info.support_unified_addr)
-      params->mem_type = CNEDK_BUF_MEM_UNIFIED;
-    else
-      params->mem_type = CNEDK_BUF_MEM_DEVICE;
+    params->mem_type = caps->DefaultMemType();
   }
 
   if (params->mem_type == CNEDK_BUF_MEM_UNIFIED || params->mem_type == CNEDK_BUF_MEM_UNIFIED_CACHED) {
@@ -283,6 +362,36 @@ int CreateSurface(CnedkBufSurfaceCreateParams *params, CnedkBufSurface *surf) {
   return -1;
 }
 
+int CreateSharedSurface(CnedkBufSurfaceCreateParams *params, CnedkBufSurface *surf) {
+  if (CheckParams(params) < 0) {
+    LOG(ERROR) << "[EasyDK] CreateSharedSurface(): Parameters are invalid";
+    return -1;
+  }
+  MemAllocatorShm allocator;
+  if (allocator.Create(params) < 0) {
+    LOG(ERROR) << "[EasyDK] CreateSharedSurface(): Memory allocator initialize resources failed. mem_type = "
+               << params->mem_type;
+    return -1;
+  }
+  if (allocator.Alloc(surf) < 0) {
+    LOG(ERROR) << "[EasyDK] CreateSharedSurface(): Memory allocator create BufSurface failed";
+    return -1;
+  }
+  return 0;
+}
+
+int OpenSharedSurface(const std::string &name, CnedkBufSurface *surf) {
+  if (MemAllocatorShm::Open(name, surf) < 0) {
+    LOG(ERROR) << "[EasyDK] OpenSharedSurface(): Open shared BufSurface failed, name = " << name;
+    return -1;
+  }
+  return 0;
+}
+
+std::string GetSharedSurfaceName(const CnedkBufSurface *surf) { return MemAllocatorShm::GetName(surf); }
+
+int CleanupSharedSurfaces() { return MemAllocatorShm::Cleanup(); }
+
 int DestroySurface(CnedkBufSurface *surf) {
   // FIXME, no resource leaks at the moment
   //   the codes will be refined in the future.
@@ -301,6 +410,15 @@ int DestroySurface(CnedkBufSurface *surf) {
     return 0;
   }
 
+  if (MemAllocatorShm::IsShared(surf)) {
+    MemAllocatorShm allocator;
+    if (allocator.Free(surf) < 0) {
+      LOG(ERROR) << "[EasyDK] DestroySurface(): Memory allocator free shared BufSurface failed";
+      return -1;
+    }
+    return 0;
+  }
+
   if (surf->mem_type == CNEDK_BUF_MEM_SYSTEM) {
     MemAllocatorSystem allocator;
     if (allocator.Free(surf) < 0) {
@@ -21,15 +21,22 @@
 #ifndef CNEDK_BUF_SURFACE_IMPL_H_
 #define CNEDK_BUF_SURFACE_IMPL_H_
 
+#include <memory>
 #include <string>
 #include <mutex>
 #include <queue>
 
 #include "cnedk_buf_surface.h"
 #include "cnedk_buf_surface_utils.h"
+#include "cnedk_memory_budget.hpp"
 
 namespace cnedk {
 
+// slots of CnedkBufSurface::_reserved holding public fields, slot 0 refers to the mapping of shared memory surfaces
+constexpr int kReservedGeneration = 1;
+// takes two slots if pointers are 32 bits
+constexpr int kReservedCaptureTime = 2;
+
 class IMemAllcator {
  public:
   virtual ~IMemAllcator() {}
@@ -47,12 +54,21 @@ class MemPool {
   ~MemPool() {
     if (allocator_) delete allocator_, allocator_ = nullptr;
   }
-  int Create(CnedkBufSurfaceCreateParams *params, uint32_t block_num);
+  int Create(CnedkBufSurfaceCreateParams *params, uint32_t block_num,
+             const std::string &category = kMemCategoryBufPool);
   int Destroy();
   int Alloc(CnedkBufSurface *surf);
   int Free(CnedkBufSurface *surf);
 
  private:
+  // reserves memory of blocks, the lock must be held. The pool is not trimmed by its own reservation
+  bool Reserve(size_t bytes);
+  // allocates a block within the memory budget, the lock must be held
+  int AllocBlock(CnedkBufSurface *surf);
+  void FreeBlock(CnedkBufSurface *surf);
+  // frees idle blocks, called by the memory budget
+  size_t Trim(size_t bytes);
+
   std::mutex mutex_;
   std::queue<CnedkBufSurface> cache_;
 
@@ -62,12 +78,26 @@ class MemPool {
   IMemAllcator *allocator_ = nullptr;
   bool is_vb_pool_ = false;
   bool is_fake_mapped_ = false;
+  // blocks are allocated up to block_num_, trimmed blocks are allocated again on demand
+  uint32_t block_num_ = 0;
+  uint32_t block_count_ = 0;
+  size_t block_size_ = 0;
+  std::unique_ptr<MemoryAccount> account_;
 };
 
+int BufPoolCreate(void **pool, CnedkBufSurfaceCreateParams *params, uint32_t block_num, const std::string &category);
+
 //  for non-pool case
 int CreateSurface(CnedkBufSurfaceCreateParams *params, CnedkBufSurface *surf);
 int DestroySurface(CnedkBufSurface *surf);
 
+//  for CNEDK_BUF_MEM_SYSTEM in shared memory, destroyed by DestroySurface()
+int CreateSharedSurface(CnedkBufSurfaceCreateParams *params, CnedkBufSurface *surf);
+int OpenSharedSurface(const std::string &name, CnedkBufSurface *surf);
+// returns an empty string if the surface is not shared
+std::string GetSharedSurfaceName(const CnedkBufSurface *surf);
+int CleanupSharedSurfaces();
+
 }  // namespace cnedk
 
 #endif  // CNEDK_BUF_SURFACE_IMPL_H_
@@ -0,0 +1,354 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnedk_buf_surface_impl_shm.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>  // for malloc/free
+#include <cstring>  // for memset
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include "glog/logging.h"
+
+namespace cnedk {
+
+namespace {
+
+constexpr uint32_t kShmMagic = 0x4d534445;  // "EDSM"
+constexpr int kShmMaxHolders = 64;
+constexpr size_t kShmHeaderSize = 4096;
+constexpr const char *kShmPrefix = "cnedk_shm_";
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "atomics in shared memory must be lock free");
+
+struct ShmHeader {
+  // set at last by the creator, the other fields are valid once it is set
+  std::atomic<uint32_t> magic;
+  // the number of holders, the shared memory is being removed once it drops to 0
+  std::atomic<int32_t> refs;
+  // pids of holders, 0 for free slots
+  std::atomic<int32_t> holders[kShmMaxHolders];
+  uint64_t data_size;
+  uint32_t block_size;
+  uint32_t batch_size;
+  uint32_t device_id;
+  uint32_t width;
+  uint32_t height;
+  uint32_t pitch;
+  CnedkBufSurfaceColorFormat color_format;
+  CnedkBufSurfacePlaneParams plane_params;
+};
+
+static_assert(sizeof(ShmHeader) <= kShmHeaderSize, "ShmHeader is too large");
+
+// the mapping in this process, referred by CnedkBufSurface::_reserved[0]
+struct ShmMapping {
+  std::string name;
+  ShmHeader *header;
+  size_t map_size;
+  // holder slot of this process, -1 if this process is not a holder
+  int slot;
+  // holder slot reserved for the child being forked
+  int fork_slot;
+};
+
+std::atomic<uint32_t> g_shm_index{0};
+
+// mappings in this process, so that surfaces in shared memory are told from the others and are held by forked children
+std::mutex g_mappings_mutex;
+std::unordered_set<const ShmMapping *> g_mappings;
+
+inline bool IsProcessAlive(int32_t pid) { return kill(pid, 0) == 0 || errno != ESRCH; }
+
+// returns true if the last reference is released and the shared memory is removed
+bool ReleaseRef(const std::string &name, ShmHeader *header) {
+  if (header->refs.fetch_sub(1) == 1) {
+    shm_unlink(name.c_str());
+    return true;
+  }
+  return false;
+}
+
+int AttachHolder(const std::string &name, ShmHeader *header) {
+  int32_t refs = header->refs.load();
+  do {
+    if (refs <= 0) {
+      LOG(ERROR) << "[EasyDK] [MemAllocatorShm] AttachHolder(): " << name << " is being removed";
+      return -1;
+    }
+  } while (!header->refs.compare_exchange_weak(refs, refs + 1));
+
+  int32_t pid = static_cast<int32_t>(getpid());
+  for (int i = 0; i < kShmMaxHolders; ++i) {
+    int32_t expected = 0;
+    if (header->holders[i].compare_exchange_strong(expected, pid)) return i;
+  }
+  ReleaseRef(name, header);
+  LOG(ERROR) << "[EasyDK] [MemAllocatorShm] AttachHolder(): Too many holders of " << name
+             << ", the maximum is " << kShmMaxHolders;
+  return -1;
+}
+
+// the child inherits the mappings and becomes a holder of each one. Holders are reserved by the parent before fork,
+// so that the shared memory is not removed before the child runs. The reserved holder of a failed fork is released
+// by Cleanup() once the parent exits
+void PrepareFork() {
+  g_mappings_mutex.lock();
+  for (const ShmMapping *it : g_mappings) {
+    ShmMapping *mapping = const_cast<ShmMapping *>(it);
+    mapping->fork_slot = AttachHolder(mapping->name, mapping->header);
+  }
+}
+
+void ChildAfterFork() {
+  int32_t pid = static_cast<int32_t>(getpid());
+  for (const ShmMapping *it : g_mappings) {
+    ShmMapping *mapping = const_cast<ShmMapping *>(it);
+    if (mapping->fork_slot >= 0) mapping->header->holders[mapping->fork_slot].store(pid);
+    mapping->slot = mapping->fork_slot;
+  }
+  g_mappings_mutex.unlock();
+}
+
+void RegisterMapping(ShmMapping *mapping) {
+  static std::once_flag atfork_flag;
+  std::call_once(atfork_flag, [] { pthread_atfork(PrepareFork, [] { g_mappings_mutex.unlock(); }, ChildAfterFork); });
+  std::lock_guard<std::mutex> lk(g_mappings_mutex);
+  g_mappings.insert(mapping);
+}
+
+void FillSurface(ShmMapping *mapping, CnedkBufSurface *surf) {
+  const ShmHeader *header = mapping->header;
+  memset(surf, 0, sizeof(CnedkBufSurface));
+  surf->mem_type = CNEDK_BUF_MEM_SYSTEM;
+  surf->opaque = nullptr;
+  surf->batch_size = header->batch_size;
+  surf->device_id = header->device_id;
+  surf->is_contiguous = true;
+  surf->surface_list =
+      reinterpret_cast<CnedkBufSurfaceParams *>(malloc(sizeof(CnedkBufSurfaceParams) * surf->batch_size));
+  memset(surf->surface_list, 0, sizeof(CnedkBufSurfaceParams) * surf->batch_size);
+  uint8_t *addr8 = reinterpret_cast<uint8_t *>(mapping->header) + kShmHeaderSize;
+  for (uint32_t i = 0; i < surf->batch_size; i++) {
+    surf->surface_list[i].color_format = header->color_format;
+    surf->surface_list[i].data_ptr = addr8;
+    addr8 += header->block_size;
+    surf->surface_list[i].width = header->width;
+    surf->surface_list[i].height = header->height;
+    surf->surface_list[i].pitch = header->pitch;
+    surf->surface_list[i].data_size = header->block_size;
+    surf->surface_list[i].plane_params = header->plane_params;
+  }
+  surf->_reserved[0] = mapping;
+  RegisterMapping(mapping);
+}
+
+}  // namespace
+
+int MemAllocatorShm::Create(CnedkBufSurfaceCreateParams *params) {
+  if (params->mem_type != CNEDK_BUF_MEM_SYSTEM) {
+    LOG(ERROR) << "[EasyDK] [MemAllocatorShm] Create(): Unsupported memory type: " << params->mem_type;
+    return -1;
+  }
+  return MemAllocatorSystem::Create(params);
+}
+
+int MemAllocatorShm::Alloc(CnedkBufSurface *surf) {
+  static std::once_flag cleanup_flag;
+  std::call_once(cleanup_flag, [] { Cleanup(); });
+
+  size_t map_size = kShmHeaderSize + block_size_ * create_params_.batch_size;
+  std::string name;
+  int fd = -1;
+  // names of shared memory leaked by a dead process with the same pid are skipped
+  for (int retry = 0; retry < 16 && fd < 0; ++retry) {
+    name = "/" + std::string(kShmPrefix) + std::to_string(getpid()) + "_" + std::to_string(g_shm_index++);
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0 && errno != EEXIST) break;
+  }
+  if (fd < 0) {
+    LOG(ERROR) << "[EasyDK] [MemAllocatorShm] Alloc(): shm_open failed, " << strerror(errno);
+    return -1;
+  }
+  if (ftruncate(fd, map_size) < 0) {
+    LOG(ERROR) << "[EasyDK] [MemAllocatorShm] Alloc(): ftruncate failed, " << strerror(errno);
+    close(fd);
+    shm_unlink(name.c_str());
+    return -1;
+  }
+  void *addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    LOG(ERROR) << "[EasyDK] [MemAllocatorShm] Alloc(): mmap failed, " << strerror(errno);
+    shm_unlink(name.c_str());
+    return -1;
+  }
+
+  // the memory is zero filled by ftruncate
+  ShmHeader *header = reinterpret_cast<ShmHeader *>(addr);
+  header->data_size = map_size - kShmHeaderSize;
+  header->block_size = block_size_;
+  header->batch_size = create_params_.batch_size;
+  header->device_id = create_params_.device_id;
+  header->width = create_params_.width;
+  header->height = create_params_.height;
+  header->pitch = plane_params_.pitch[0];
+  header->color_format = create_params_.color_format;
+  header->plane_params = plane_params_;
+  header->refs.store(1);
+  header->holders[0].store(static_cast<int32_t>(getpid()));
+  header->magic.store(kShmMagic, std::memory_order_release);
+
+  FillSurface(new ShmMapping{name, header, map_size, 0, -1}, surf);
+  return 0;
+}
+
+int MemAllocatorShm::Free(CnedkBufSurface *surf) {
+  if (!IsShared(surf)) {
+    LOG(ERROR) << "[EasyDK] [MemAllocatorShm] Free(): BufSurface is not allocated in shared memory";
+    return -1;
+  }
+  ShmMapping *mapping = reinterpret_cast<ShmMapping *>(surf->_reserved[0]);
+  {
+    std::lock_guard<std::mutex> lk(g_mappings_mutex);
+    g_mappings.erase(mapping);
+  }
+  // a forked child may fail to become a holder, it only unmaps the shared memory
+  if (mapping->slot >= 0) {
+    mapping->header->holders[mapping->slot].store(0);
+    ReleaseRef(mapping->name, mapping->header);
+  }
+  munmap(mapping->header, mapping->map_size);
+  delete mapping;
+  surf->_reserved[0] = nullptr;
+  ::free(reinterpret_cast<void *>(surf->surface_list));
+  return 0;
+}
+
+int MemAllocatorShm::Open(const std::string &name, CnedkBufSurface *surf) {
+  if (name.compare(0, 1 + strlen(kShmPrefix), "/" + std::string(kShmPrefix)) != 0) {
+    LOG(ERROR) << "[EasyDK] [MemAllocatorShm] Open(): Invalid name: " << name;
+    return -1;
+  }
+  int fd = shm_open(name.c_str(), O_RDWR, 0600);
+  if (fd < 0) {
+    LOG(ERROR) << "[EasyDK] [MemAllocatorShm] Open(): shm_open " << name << " failed, " << strerror(errno);
+    return -1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < kShmHeaderSize) {
+    LOG(ERROR) << "[EasyDK] [MemAllocatorShm] Open(): Invalid shared memory: " << name;
+    close(fd);
+    return -1;
+  }
+  size_t map_size = static_cast<size_t>(st.st_size);
+  void *addr = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    LOG(ERROR) << "[EasyDK] [MemAllocatorShm] Open(): mmap failed, " << strerror(errno);
+    return -1;
+  }
+  ShmHeader *header = reinterpret_cast<ShmHeader *>(addr);
+  if (header->magic.load(std::memory_order_acquire) != kShmMagic ||
+      header->data_size + kShmHeaderSize != map_size ||
+      static_cast<uint64_t>(header->block_size) * header->batch_size > header->data_size) {
+    LOG(ERROR) << "[EasyDK] [MemAllocatorShm] Open(): Invalid shared memory: " << name;
+    munmap(addr, map_size);
+    return -1;
+  }
+  int slot = AttachHolder(name, header);
+  if (slot < 0) {
+    munmap(addr, map_size);
+    return -1;
+  }
+  FillSurface(new ShmMapping{name, header, map_size, slot, -1}, surf);
+  return 0;
+}
+
+bool MemAllocatorShm::IsShared(const CnedkBufSurface *surf) {
+  if (surf->mem_type != CNEDK_BUF_MEM_SYSTEM || !surf->_reserved[0]) return false;
+  std::lock_guard<std::mutex> lk(g_mappings_mutex);
+  return g_mappings.count(reinterpret_cast<const ShmMapping *>(surf->_reserved[0])) != 0;
+}
+
+std::string MemAllocatorShm::GetName(const CnedkBufSurface *surf) {
+  if (!IsShared(surf)) return std::string();
+  return reinterpret_cast<const ShmMapping *>(surf->_reserved[0])->name;
+}
+
+int MemAllocatorShm::Cleanup() {
+  DIR *dir = opendir("/dev/shm");
+  if (!dir) {
+    VLOG(3) << "[EasyDK] [MemAllocatorShm] Cleanup(): Open /dev/shm failed, " << strerror(errno);
+    return 0;
+  }
+  int removed = 0;
+  const size_t prefix_len = strlen(kShmPrefix);
+  while (struct dirent *entry = readdir(dir)) {
+    if (strncmp(entry->d_name, kShmPrefix, prefix_len) != 0) continue;
+    std::string name = "/" + std::string(entry->d_name);
+    int fd = shm_open(name.c_str(), O_RDWR, 0600);
+    if (fd < 0) continue;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < kShmHeaderSize) {
+      close(fd);
+      continue;
+    }
+    void *addr = mmap(nullptr, kShmHeaderSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) continue;
+
+    ShmHeader *header = reinterpret_cast<ShmHeader *>(addr);
+    if (header->magic.load(std::memory_order_acquire) != kShmMagic) {
+      // the creator died before the shared memory is initialized
+      int32_t creator = static_cast<int32_t>(atoi(entry->d_name + prefix_len));
+      if (creator > 0 && !IsProcessAlive(creator) && shm_unlink(name.c_str()) == 0) ++removed;
+    } else {
+      for (int i = 0; i < kShmMaxHolders; ++i) {
+        int32_t pid = header->holders[i].load();
+        if (!pid || IsProcessAlive(pid)) continue;
+        if (header->holders[i].compare_exchange_strong(pid, 0) && ReleaseRef(name, header)) {
+          ++removed;
+          break;
+        }
+      }
+    }
+    munmap(addr, kShmHeaderSize);
+  }
+  closedir(dir);
+  if (removed) {
+    LOG(WARNING) << "[EasyDK] [MemAllocatorShm] Cleanup(): Removed " << removed
+                 << " shared memory leaked by dead processes";
+  }
+  return removed;
+}
+
+}  // namespace cnedk
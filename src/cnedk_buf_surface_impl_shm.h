@@ -0,0 +1,52 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_BUF_SURFACE_IMPL_SHM_H_
+#define CNEDK_BUF_SURFACE_IMPL_SHM_H_
+
+#include <string>
+
+#include "cnedk_buf_surface_impl_system.h"
+
+namespace cnedk {
+
+// Allocates CNEDK_BUF_MEM_SYSTEM buffers in POSIX shared memory.
+//   The shared memory starts with a header holding the buffer parameters and the pids of holders,
+//   one holder for each CnedkBufSurface referring to it in any process, including the ones inherited by fork.
+//   The last holder removes it.
+class MemAllocatorShm : public MemAllocatorSystem {
+ public:
+  MemAllocatorShm() = default;
+  ~MemAllocatorShm() = default;
+  int Create(CnedkBufSurfaceCreateParams *params) override;
+  int Alloc(CnedkBufSurface *surf) override;
+  int Free(CnedkBufSurface *surf) override;
+
+  // maps the shared memory allocated by Alloc() in any process
+  static int Open(const std::string &name, CnedkBufSurface *surf);
+  static bool IsShared(const CnedkBufSurface *surf);
+  static std::string GetName(const CnedkBufSurface *surf);
+  // removes the shared memory whose holders are all dead, returns the number of removed ones
+  static int Cleanup();
+};
+
+}  // namespace cnedk
+
+#endif  // CNEDK_BUF_SURFACE_IMPL_SHM_H_
@@ -36,7 +36,7 @@ class MemAllocatorSystem : public IMemAllcator {
   int Alloc(CnedkBufSurface *surf) override;
   int Free(CnedkBufSurface *surf) override;
 
- private:
+ protected:
   bool created_ = false;
   CnedkBufSurfaceCreateParams create_params_;
   CnedkBufSurfacePlaneParams plane_params_;
@@ -27,6 +27,7 @@
 
 #include "glog/logging.h"
 #include "cnrt.h"
+#include "cnedk_buf_surface_impl.h"
 #include "common/utils.hpp"
 
 namespace cnedk {
@@ -226,10 +227,10 @@ void BufSurfaceWrapper::SyncHostToDevice(uint32_t plane_idx, uint32_t batch_idx)
 //
 // BufPool
 //
-int BufPool::CreatePool(CnedkBufSurfaceCreateParams *params, uint32_t block_count) {
+int BufPool::CreatePool(CnedkBufSurfaceCreateParams *params, uint32_t block_count, const std::string &category) {
   std::unique_lock<std::mutex> lk(mutex_);
 
-  int ret = CnedkBufPoolCreate(&pool_, params, block_count);
+  int ret = BufPoolCreate(&pool_, params, block_count, category);
   if (ret != 0) {
     LOG(ERROR) << "[EasyDK] [BufPool] CreatePool(): Create BufSurface pool failed";
     return -1;
@@ -21,96 +21,107 @@
 #include "cnedk_buf_surface_utils.h"
 
 #include <cstring>  // for memset
-#include <map>
 #include <mutex>
 #include <string>
 
 #include "glog/logging.h"
 #include "cnrt.h"
 
-#include "cnedk_platform.h"
+#include "cnedk_platform_caps.hpp"
 
 namespace cnedk {
 
+namespace {
+
+inline uint32_t AlignUp(uint32_t value, uint32_t align) { return (value + align - 1) / align * align; }
+
+template <CnedkBufSurfaceColorFormat fmt>
+void FillPlaneParams(uint32_t width, uint32_t height, uint32_t align_size_w, uint32_t align_size_h,
+                     CnedkBufSurfacePlaneParams *params) {
+  using Traits = ColorFormatTraits<fmt>;
+  params->num_planes = Traits::kPlaneNum;
+  uint32_t offset = 0;
+  for (uint32_t i = 0; i < Traits::kPlaneNum; ++i) {
+    params->width[i] = Traits::PlaneWidth(width, i);
+    params->height[i] = Traits::PlaneHeight(height, i);
+    params->bytes_per_pix[i] = Traits::BytesPerPix(i);
+    params->pitch[i] = AlignUp(params->width[i] * Traits::BytesPerPix(i), align_size_w);
+    params->psize[i] = params->pitch[i] * AlignUp(params->height[i], align_size_h);
+    params->offset[i] = offset;
+    offset += params->psize[i];
+  }
+}
+
+using FillPlaneParamsFunc = void (*)(uint32_t, uint32_t, uint32_t, uint32_t, CnedkBufSurfacePlaneParams *);
+
+// indexed by CnedkBufSurfaceColorFormat
+constexpr FillPlaneParamsFunc kFillPlaneParamsFuncs[CNEDK_BUF_COLOR_FORMAT_LAST] = {
+    nullptr,
+    &FillPlaneParams<CNEDK_BUF_COLOR_FORMAT_GRAY8>,
+    &FillPlaneParams<CNEDK_BUF_COLOR_FORMAT_YUV420>,
+    &FillPlaneParams<CNEDK_BUF_COLOR_FORMAT_NV12>,
+    &FillPlaneParams<CNEDK_BUF_COLOR_FORMAT_NV21>,
+    &FillPlaneParams<CNEDK_BUF_COLOR_FORMAT_ARGB>,
+    &FillPlaneParams<CNEDK_BUF_COLOR_FORMAT_ABGR>,
+    &FillPlaneParams<CNEDK_BUF_COLOR_FORMAT_RGB>,
+    &FillPlaneParams<CNEDK_BUF_COLOR_FORMAT_BGR>,
+    &FillPlaneParams<CNEDK_BUF_COLOR_FORMAT_BGRA>,
+    &FillPlaneParams<CNEDK_BUF_COLOR_FORMAT_RGBA>,
+    &FillPlaneParams<CNEDK_BUF_COLOR_FORMAT_ARGB1555>,
+    nullptr,
+};
+
+inline void CopyRows(const uint8_t *src, uint32_t src_pitch, uint8_t *dst, uint32_t dst_pitch, uint32_t row_bytes,
+                     uint32_t rows) {
+  for (uint32_t h = 0; h < rows; ++h) {
+    memcpy(dst, src, row_bytes);
+    src += src_pitch;
+    dst += dst_pitch;
+  }
+}
+
+template <CnedkBufSurfaceColorFormat fmt>
+void CopyPlanes(const CnedkBufSurfaceParams &src, CnedkBufSurfaceParams *dst) {
+  using Traits = ColorFormatTraits<fmt>;
+  const uint8_t *src8 = static_cast<const uint8_t *>(src.data_ptr);
+  uint8_t *dst8 = static_cast<uint8_t *>(dst->data_ptr);
+  for (uint32_t i = 0; i < Traits::kPlaneNum; ++i) {
+    CopyRows(src8 + src.plane_params.offset[i], src.plane_params.pitch[i], dst8 + dst->plane_params.offset[i],
+             dst->plane_params.pitch[i], Traits::PlaneWidth(src.width, i) * Traits::BytesPerPix(i),
+             Traits::PlaneHeight(src.height, i));
+  }
+}
+
+using CopyPlanesFunc = void (*)(const CnedkBufSurfaceParams &, CnedkBufSurfaceParams *);
+
+// indexed by CnedkBufSurfaceColorFormat
+constexpr CopyPlanesFunc kCopyPlanesFuncs[CNEDK_BUF_COLOR_FORMAT_LAST] = {
+    nullptr,
+    &CopyPlanes<CNEDK_BUF_COLOR_FORMAT_GRAY8>,
+    &CopyPlanes<CNEDK_BUF_COLOR_FORMAT_YUV420>,
+    &CopyPlanes<CNEDK_BUF_COLOR_FORMAT_NV12>,
+    &CopyPlanes<CNEDK_BUF_COLOR_FORMAT_NV21>,
+    &CopyPlanes<CNEDK_BUF_COLOR_FORMAT_ARGB>,
+    &CopyPlanes<CNEDK_BUF_COLOR_FORMAT_ABGR>,
+    &CopyPlanes<CNEDK_BUF_COLOR_FORMAT_RGB>,
+    &CopyPlanes<CNEDK_BUF_COLOR_FORMAT_BGR>,
+    &CopyPlanes<CNEDK_BUF_COLOR_FORMAT_BGRA>,
+    &CopyPlanes<CNEDK_BUF_COLOR_FORMAT_RGBA>,
+    &CopyPlanes<CNEDK_BUF_COLOR_FORMAT_ARGB1555>,
+    nullptr,
+};
+
+}  // namespace
+
 int GetColorFormatInfo(CnedkBufSurfaceColorFormat fmt, uint32_t width, uint32_t height, uint32_t align_size_w,
                        uint32_t align_size_h, CnedkBufSurfacePlaneParams *params) {
   memset(params, 0, sizeof(CnedkBufSurfacePlaneParams));
-  switch (fmt) {
-    case CNEDK_BUF_COLOR_FORMAT_GRAY8:
-      params->num_planes = 1;
-      params->width[0] = width;
-      params->height[0] = height;
-      params->bytes_per_pix[0] = 1;
-      params->pitch[0] = (width * params->bytes_per_pix[0] + align_size_w - 1) / align_size_w * align_size_w;
-      params->psize[0] = params->pitch[0] * ((params->height[0] + align_size_h - 1) / align_size_h * align_size_h);
-      params->offset[0] = 0;
-      return 0;
-
-    case CNEDK_BUF_COLOR_FORMAT_YUV420:
-      params->num_planes = 3;
-      for (uint32_t i = 0; i < params->num_planes; i++) {
-        params->width[i] = i == 0 ? width : width / 2;
-        params->height[i] = i == 0 ? height : height / 2;
-        params->bytes_per_pix[i] = 1;
-        params->pitch[i] =
-            (params->width[i] * params->bytes_per_pix[i] + align_size_w - 1) / align_size_w * align_size_w;
-        params->psize[i] = params->pitch[i] * ((params->height[i] + align_size_h - 1) / align_size_h * align_size_h);
-      }
-      params->offset[0] = 0;
-      params->offset[1] = params->psize[0];
-      params->offset[2] = params->psize[0] + params->psize[1];
-      return 0;
-    case CNEDK_BUF_COLOR_FORMAT_NV12:
-    case CNEDK_BUF_COLOR_FORMAT_NV21:
-      params->num_planes = 2;
-      for (uint32_t i = 0; i < params->num_planes; i++) {
-        params->width[i] = width;
-        params->height[i] = (i == 0) ? height : height / 2;
-        params->bytes_per_pix[i] = 1;
-        params->pitch[i] =
-            (params->width[i] * params->bytes_per_pix[i] + align_size_w - 1) / align_size_w * align_size_w;
-        params->psize[i] = params->pitch[i] * ((params->height[i] + align_size_h - 1) / align_size_h * align_size_h);
-      }
-      params->offset[0] = 0;
-      params->offset[1] = params->psize[0];
-      return 0;
-    case CNEDK_BUF_COLOR_FORMAT_ARGB:
-    case CNEDK_BUF_COLOR_FORMAT_ABGR:
-    case CNEDK_BUF_COLOR_FORMAT_BGRA:
-    case CNEDK_BUF_COLOR_FORMAT_RGBA:
-      params->num_planes = 1;
-      params->width[0] = width;
-      params->height[0] = height;
-      params->bytes_per_pix[0] = 4;
-      params->pitch[0] = (width * params->bytes_per_pix[0] + align_size_w - 1) / align_size_w * align_size_w;
-      params->psize[0] = params->pitch[0] * ((params->height[0] + align_size_h - 1) / align_size_h * align_size_h);
-      params->offset[0] = 0;
-      return 0;
-    case CNEDK_BUF_COLOR_FORMAT_RGB:
-    case CNEDK_BUF_COLOR_FORMAT_BGR:
-      params->num_planes = 1;
-      params->width[0] = width;
-      params->height[0] = height;
-      params->bytes_per_pix[0] = 3;
-      params->pitch[0] = (width * params->bytes_per_pix[0] + align_size_w - 1) / align_size_w * align_size_w;
-      params->offset[0] = 0;
-      params->psize[0] = params->pitch[0] * ((params->height[0] + align_size_h - 1) / align_size_h * align_size_h);
-      return 0;
-    case CNEDK_BUF_COLOR_FORMAT_ARGB1555:
-      params->num_planes = 1;
-      params->width[0] = width;
-      params->height[0] = height;
-      params->bytes_per_pix[0] = 2;
-      params->pitch[0] = (width * params->bytes_per_pix[0] + align_size_w - 1) / align_size_w * align_size_w;
-      params->psize[0] = params->pitch[0] * ((params->height[0] + align_size_h - 1) / align_size_h * align_size_h);
-      params->offset[0] = 0;
-      return 0;
-    case CNEDK_BUF_COLOR_FORMAT_INVALID:
-    default: {
-      LOG(ERROR) << "[EasyDK] GetColorFormatInfo(): Unsupported color format: " << fmt;
-      return -1;
-    }
-  }  // switch
+  if (!IsValidColorFormat(fmt)) {
+    LOG(ERROR) << "[EasyDK] GetColorFormatInfo(): Unsupported color format: " << fmt;
+    return -1;
+  }
+  kFillPlaneParamsFuncs[fmt](width, height, align_size_w, align_size_h, params);
+  return 0;
 }
 
 int CheckParams(CnedkBufSurfaceCreateParams *params) {
@@ -124,34 +135,15 @@ int CheckParams(CnedkBufSurfaceCreateParams *params) {
       LOG(ERROR) << "[EasyDK] CheckParams(): Unsupported memory type: " << params->mem_type;
       return -1;
     }
-    CnedkPlatformInfo info;
-    if (CnedkPlatformGetInfo(params->device_id, &info) < 0) {
+    const DeviceCaps *caps = PlatformCaps::Instance().GetDevice(params->device_id);
+    if (!caps) {
       LOG(ERROR) << "[EasyDK] CheckParams(): Get platform information failed";
       return -1;
     }
-    // At this moment, CExxxx == supportUnified, MLUxxx == not supportUnified
-    //   FIXME later.
-    if (info.support_unified_addr) {
-      // CExxxx
-      if (params->mem_type != CNEDK_BUF_MEM_DEFAULT && params->mem_type != CNEDK_BUF_MEM_DEVICE &&
-          params->mem_type != CNEDK_BUF_MEM_UNIFIED && params->mem_type != CNEDK_BUF_MEM_UNIFIED_CACHED &&
-          params->mem_type != CNEDK_BUF_MEM_VB && params->mem_type != CNEDK_BUF_MEM_VB_CACHED) {
-        LOG(ERROR) << "[EasyDK] CheckParams(): For support unified address, unsupported memory type: "
-                   << params->mem_type;
-        return -1;
-      }
-    } else {
-      // MLUxxx
-      if (params->mem_type != CNEDK_BUF_MEM_DEFAULT && params->mem_type != CNEDK_BUF_MEM_DEVICE &&
-          params->mem_type != CNEDK_BUF_MEM_PINNED) {
-        LOG(ERROR) << "[EasyDK] CheckParams(): For not support unified address, unsupported memory type: "
-                   << params->mem_type;
-        return -1;
-      }
-      if (params->mem_type == CNEDK_BUF_MEM_PINNED && info.can_map_host_memory == false) {
-        LOG(ERROR) << "[EasyDK] CheckParams(): For memory type CNEDK_BUF_MEM_PINNED, map host memory must be supported";
-        return -1;
-      }
+    if (!caps->SupportMemType(params->mem_type)) {
+      LOG(ERROR) << "[EasyDK] CheckParams(): Unsupported memory type: " << params->mem_type << " on device "
+                 << caps->name;
+      return -1;
     }
     return 0;
   }
@@ -170,4 +162,24 @@ int CheckParams(CnedkBufSurfaceCreateParams *params) {
   return 0;
 }
 
+int CopyPlanesHost(const CnedkBufSurfaceParams &src, CnedkBufSurfaceParams *dst) {
+  if (src.color_format != dst->color_format || src.width != dst->width || src.height != dst->height) {
+    LOG(ERROR) << "[EasyDK] CopyPlanesHost(): src and dst have different color format or shape";
+    return -1;
+  }
+  if (IsValidColorFormat(src.color_format)) {
+    kCopyPlanesFuncs[src.color_format](src, dst);
+    return 0;
+  }
+  // no fixed layout, follow plane parameters
+  const uint8_t *src8 = static_cast<const uint8_t *>(src.data_ptr);
+  uint8_t *dst8 = static_cast<uint8_t *>(dst->data_ptr);
+  for (uint32_t i = 0; i < src.plane_params.num_planes; ++i) {
+    CopyRows(src8 + src.plane_params.offset[i], src.plane_params.pitch[i], dst8 + dst->plane_params.offset[i],
+             dst->plane_params.pitch[i], src.plane_params.width[i] * src.plane_params.bytes_per_pix[i],
+             src.plane_params.height[i]);
+  }
+  return 0;
+}
+
 }  // namespace cnedk
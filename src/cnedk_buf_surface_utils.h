@@ -21,15 +21,107 @@
 #ifndef CNEDK_BUF_SURFACE_UTILS_H_
 #define CNEDK_BUF_SURFACE_UTILS_H_
 
+#include <cstdint>
+
 #include "cnedk_buf_surface.h"
+#include "cnedk_transform.h"
 
 namespace cnedk {
 
+/**
+ * Plane layout of a color format. Plane i is (width / width_div[i]) x (height / height_div[i]) pixels,
+ * each of bytes_per_pix[i] bytes. channel_num is the channel number of packed formats, -1 for planar formats.
+ */
+struct ColorFormatLayout {
+  uint32_t num_planes;
+  uint32_t bytes_per_pix[CNEDK_BUF_MAX_PLANES];
+  uint32_t width_div[CNEDK_BUF_MAX_PLANES];
+  uint32_t height_div[CNEDK_BUF_MAX_PLANES];
+  int channel_num;
+};
+
+// indexed by CnedkBufSurfaceColorFormat, num_planes is 0 for formats without a fixed layout
+constexpr ColorFormatLayout kColorFormatLayouts[CNEDK_BUF_COLOR_FORMAT_LAST] = {
+    /* INVALID  */ {0, {0, 0, 0}, {1, 1, 1}, {1, 1, 1}, -1},
+    /* GRAY8    */ {1, {1, 0, 0}, {1, 1, 1}, {1, 1, 1}, 1},
+    /* YUV420   */ {3, {1, 1, 1}, {1, 2, 2}, {1, 2, 2}, -1},
+    /* NV12     */ {2, {1, 1, 0}, {1, 1, 1}, {1, 2, 1}, -1},
+    /* NV21     */ {2, {1, 1, 0}, {1, 1, 1}, {1, 2, 1}, -1},
+    /* ARGB     */ {1, {4, 0, 0}, {1, 1, 1}, {1, 1, 1}, 4},
+    /* ABGR     */ {1, {4, 0, 0}, {1, 1, 1}, {1, 1, 1}, 4},
+    /* RGB      */ {1, {3, 0, 0}, {1, 1, 1}, {1, 1, 1}, 3},
+    /* BGR      */ {1, {3, 0, 0}, {1, 1, 1}, {1, 1, 1}, 3},
+    /* BGRA     */ {1, {4, 0, 0}, {1, 1, 1}, {1, 1, 1}, 4},
+    /* RGBA     */ {1, {4, 0, 0}, {1, 1, 1}, {1, 1, 1}, 4},
+    /* ARGB1555 */ {1, {2, 0, 0}, {1, 1, 1}, {1, 1, 1}, -1},
+    /* TENSOR   */ {0, {0, 0, 0}, {1, 1, 1}, {1, 1, 1}, -1},
+};
+
+// indexed by CnedkTransformColorFormat
+constexpr CnedkBufSurfaceColorFormat kTensorColorFormats[CNEDK_TRANSFORM_COLOR_FORMAT_NUM] = {
+    CNEDK_BUF_COLOR_FORMAT_ARGB, CNEDK_BUF_COLOR_FORMAT_ABGR, CNEDK_BUF_COLOR_FORMAT_BGRA,
+    CNEDK_BUF_COLOR_FORMAT_RGBA, CNEDK_BUF_COLOR_FORMAT_RGB,  CNEDK_BUF_COLOR_FORMAT_BGR,
+};
+
+/**
+ * Compile-time traits of a color format
+ */
+template <CnedkBufSurfaceColorFormat fmt>
+struct ColorFormatTraits {
+  static_assert(fmt > CNEDK_BUF_COLOR_FORMAT_INVALID && fmt < CNEDK_BUF_COLOR_FORMAT_TENSOR,
+                "color format has no fixed plane layout");
+  static constexpr uint32_t kPlaneNum = kColorFormatLayouts[fmt].num_planes;
+  static constexpr int kChannelNum = kColorFormatLayouts[fmt].channel_num;
+
+  static constexpr uint32_t BytesPerPix(uint32_t plane) { return kColorFormatLayouts[fmt].bytes_per_pix[plane]; }
+  static constexpr uint32_t PlaneWidth(uint32_t width, uint32_t plane) {
+    return width / kColorFormatLayouts[fmt].width_div[plane];
+  }
+  static constexpr uint32_t PlaneHeight(uint32_t height, uint32_t plane) {
+    return height / kColorFormatLayouts[fmt].height_div[plane];
+  }
+};
+
+constexpr bool IsValidColorFormat(CnedkBufSurfaceColorFormat fmt) {
+  return fmt > CNEDK_BUF_COLOR_FORMAT_INVALID && fmt < CNEDK_BUF_COLOR_FORMAT_TENSOR;
+}
+
+/**
+ * Returns channel number of packed color format, -1 for planar or invalid formats
+ */
+constexpr int GetChannelNum(CnedkBufSurfaceColorFormat fmt) {
+  return IsValidColorFormat(fmt) ? kColorFormatLayouts[fmt].channel_num : -1;
+}
+
+constexpr bool IsYuv420sp(CnedkBufSurfaceColorFormat fmt) {
+  return fmt == CNEDK_BUF_COLOR_FORMAT_NV12 || fmt == CNEDK_BUF_COLOR_FORMAT_NV21;
+}
+
+constexpr bool IsRgbx(CnedkBufSurfaceColorFormat fmt) {
+  return GetChannelNum(fmt) == 3 || GetChannelNum(fmt) == 4;
+}
+
+/**
+ * Returns channel number of RGB, BGR and 4-channel formats with alpha, -1 for others
+ */
+constexpr int GetRgbxChannelNum(CnedkBufSurfaceColorFormat fmt) { return IsRgbx(fmt) ? GetChannelNum(fmt) : -1; }
+
+/**
+ * Returns color format of tensor color format, CNEDK_BUF_COLOR_FORMAT_LAST if it is unknown
+ */
+constexpr CnedkBufSurfaceColorFormat GetColorFormatFromTensor(CnedkTransformColorFormat fmt) {
+  return (static_cast<int>(fmt) >= 0 && fmt < CNEDK_TRANSFORM_COLOR_FORMAT_NUM) ? kTensorColorFormats[fmt]
+                                                               : CNEDK_BUF_COLOR_FORMAT_LAST;
+}
+
 int GetColorFormatInfo(CnedkBufSurfaceColorFormat fmt, uint32_t width, uint32_t height,
                        uint32_t align_size_w, uint32_t align_size_h, CnedkBufSurfacePlaneParams *params);
 
 int CheckParams(CnedkBufSurfaceCreateParams *params);
 
+// Copies planes row by row between host surfaces with different pitches, src and dst must be of the same size
+int CopyPlanesHost(const CnedkBufSurfaceParams &src, CnedkBufSurfaceParams *dst);
+
 }  // namespace cnedk
 
 #endif  // CNEDK_BUF_SURFACE_UTILS_H_
@@ -28,7 +28,7 @@
 #include "cnrt.h"
 
 #include "cnedk_decode_impl.hpp"
-#include "cnedk_platform.h"
+#include "cnedk_platform_caps.hpp"
 #include "common/utils.hpp"
 
 #ifdef PLATFORM_CE3226
@@ -50,8 +50,8 @@ IDecoder *CreateDecoder() {
   int dev_id = -1;
   CNRT_SAFECALL(cnrtGetDevice(&dev_id), "CreateDecoder(): failed", nullptr);
 
-  CnedkPlatformInfo info;
-  if (CnedkPlatformGetInfo(dev_id, &info) < 0) {
+  const DeviceCaps *caps = PlatformCaps::Instance().GetDevice(dev_id);
+  if (!caps) {
     LOG(ERROR) << "[EasyDK] CreateDecoder(): Get platform information failed";
     return nullptr;
   }
@@ -60,7 +60,7 @@ IDecoder *CreateDecoder() {
 //  1. check prop_name ???
 //  2. load so ???
 #ifdef PLATFORM_CE3226
-  if (info.support_unified_addr) {
+  if (caps->support_unified_addr) {
     return new DecoderCe3226();
   }
 #endif
@@ -102,6 +102,7 @@ class DecodeService {
       delete decoder_;
       return -1;
     }
+    decoder_->GetPacketFilter()->Init(params->type, params->decode_mode, params->decode_interval);
     *vdec = decoder_;
     return 0;
   }
@@ -112,6 +113,11 @@ class DecodeService {
       return -1;
     }
     IDecoder *decoder_ = static_cast<IDecoder *>(vdec);
+    VdecPacketFilter::Stats stats = decoder_->GetPacketFilter()->GetStats();
+    if (stats.dropped_frames) {
+      VLOG(1) << "[EasyDK] [DecodeService] Destroy(): " << stats.dropped_frames << " of " << stats.frames
+              << " frames are dropped before decoding";
+    }
     decoder_->Destroy();
     delete decoder_;
     return 0;
@@ -123,6 +129,8 @@ class DecodeService {
       return -1;
     }
     IDecoder *decoder_ = static_cast<IDecoder *>(vdec);
+    stream = decoder_->GetPacketFilter()->Filter(stream);
+    if (!stream) return 0;
     return decoder_->SendStream(stream, timeout_ms);
   }
 
@@ -138,6 +146,11 @@ class DecodeService {
       return -1;
     }
 
+    if (params->decode_mode < CNEDK_VDEC_DECODE_MODE_ALL || params->decode_mode >= CNEDK_VDEC_DECODE_MODE_NUM) {
+      LOG(ERROR) << "[EasyDK] [DecodeService] CheckParams(): Unsupported decode mode: " << params->decode_mode;
+      return -1;
+    }
+
     if (params->OnEos == nullptr || params->OnFrame == nullptr || params->OnError == nullptr ||
         params->GetBufSurf == nullptr) {
       LOG(ERROR) << "[EasyDK] [DecodeService] CheckParams(): OnEos, OnFrame, OnError or GetBufSurf function pointer"
@@ -22,6 +22,7 @@
 #define CNEDK_DECODE_IMPL_HPP_
 
 #include "cnedk_decode.h"
+#include "common/vdec_packet_filter.hpp"
 
 namespace cnedk {
 
@@ -31,6 +32,11 @@ class IDecoder {
   virtual int Create(CnedkVdecCreateParams *params) = 0;
   virtual int Destroy() = 0;
   virtual int SendStream(const CnedkVdecStream *stream, int timeout_ms) = 0;
+  // selects packets by decode mode before SendStream
+  VdecPacketFilter *GetPacketFilter() { return &packet_filter_; }
+
+ private:
+  VdecPacketFilter packet_filter_;
 };
 
 IDecoder *CreateDecoder();
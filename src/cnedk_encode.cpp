@@ -28,7 +28,8 @@
 #include "cnrt.h"
 
 #include "cnedk_encode_impl.hpp"
-#include "cnedk_platform.h"
+#include "cnedk_platform_caps.hpp"
+#include "common/bitstream_ring.hpp"
 #include "common/utils.hpp"
 
 #ifdef PLATFORM_CE3226
@@ -49,8 +50,8 @@ IEncoder *CreateEncoder() {
   int dev_id = -1;
   CNRT_SAFECALL(cnrtGetDevice(&dev_id), "CreateEncoder(): failed", nullptr);
 
-  CnedkPlatformInfo info;
-  if (CnedkPlatformGetInfo(dev_id, &info) < 0) {
+  const DeviceCaps *caps = PlatformCaps::Instance().GetDevice(dev_id);
+  if (!caps) {
     LOG(ERROR) << "[EasyDK] CreateEncoder(): Get platform information failed";
     return nullptr;
   }
@@ -59,7 +60,7 @@ IEncoder *CreateEncoder() {
 //  1. check prop_name ???
 //  2. load so ???
 #ifdef PLATFORM_CE3226
-  if (info.support_unified_addr) {
+  if (caps->support_unified_addr) {
     return new EncoderCe3226();
   }
 #endif
@@ -174,4 +175,23 @@ int CnedkVencDestroy(void *venc) { return cnedk::EncodeService::Instance().Destr
 int CnedkVencSendFrame(void *venc, CnedkBufSurface *surf, int timeout_ms) {
   return cnedk::EncodeService::Instance().SendFrame(venc, surf, timeout_ms);
 }
+int CnedkVencRetainFrameBits(CnedkVEncFrameBits *framebits) {
+  // frame bits are looked up by data, keeps CnedkVEncFrameBits layout unchanged
+  cnedk::BitstreamSlice *slice = framebits ? cnedk::BitstreamRing::Find(framebits->bits) : nullptr;
+  if (!slice) {
+    LOG(ERROR) << "[EasyDK] CnedkVencRetainFrameBits(): Frame bits is invalid or not retainable";
+    return -1;
+  }
+  cnedk::BitstreamRing::Retain(slice);
+  return 0;
+}
+int CnedkVencReleaseFrameBits(CnedkVEncFrameBits *framebits) {
+  cnedk::BitstreamSlice *slice = framebits ? cnedk::BitstreamRing::Find(framebits->bits) : nullptr;
+  if (!slice) {
+    LOG(ERROR) << "[EasyDK] CnedkVencReleaseFrameBits(): Frame bits is invalid or not retainable";
+    return -1;
+  }
+  cnedk::BitstreamRing::Release(slice);
+  return 0;
+}
 };
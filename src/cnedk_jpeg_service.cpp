@@ -0,0 +1,285 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnedk_jpeg_service.hpp"
+
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "glog/logging.h"
+
+#include "cnedk_buf_surface_utils.h"
+#include "common/jpeg_encoder.hpp"
+
+namespace cnedk {
+
+namespace {
+
+// idle buffers, shared with the deleters of JpegBuffer which may outlive the service
+struct JpegBufferPool {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<std::vector<uint8_t>>> idle;
+  uint32_t capacity = 0;
+};
+
+JpegBuffer AcquireBuffer(const std::shared_ptr<JpegBufferPool> &pool) {
+  std::vector<uint8_t> *buffer = nullptr;
+  {
+    std::lock_guard<std::mutex> lk(pool->mutex);
+    if (!pool->idle.empty()) {
+      buffer = pool->idle.back().release();
+      pool->idle.pop_back();
+    }
+  }
+  if (!buffer) buffer = new std::vector<uint8_t>;
+  std::weak_ptr<JpegBufferPool> weak_pool = pool;
+  return JpegBuffer(buffer, [weak_pool](std::vector<uint8_t> *ptr) {
+    std::shared_ptr<JpegBufferPool> pool = weak_pool.lock();
+    if (pool) {
+      std::lock_guard<std::mutex> lk(pool->mutex);
+      if (pool->idle.size() < pool->capacity) {
+        ptr->clear();
+        pool->idle.emplace_back(ptr);
+        return;
+      }
+    }
+    delete ptr;
+  });
+}
+
+bool IsHostMemory(CnedkBufSurfaceMemType mem_type) {
+  return mem_type == CNEDK_BUF_MEM_SYSTEM || mem_type == CNEDK_BUF_MEM_PINNED;
+}
+
+void FillImage(const CnedkBufSurfaceParams &params, const CnedkTransformRect &rect, uint32_t width, uint32_t height,
+               JpegImage *image) {
+  const uint8_t *data = reinterpret_cast<const uint8_t *>(params.data_ptr);
+  const CnedkBufSurfacePlaneParams &planes = params.plane_params;
+  image->format = params.color_format;
+  image->width = width;
+  image->height = height;
+  if (IsYuv420sp(params.color_format)) {
+    image->planes[0] = data + planes.offset[0] + rect.top * planes.pitch[0] + rect.left;
+    image->planes[1] = data + planes.offset[1] + rect.top / 2 * planes.pitch[1] + rect.left;
+  } else {
+    image->planes[0] = data + planes.offset[0] + rect.top * planes.pitch[0] + rect.left * 3;
+    image->planes[1] = nullptr;
+  }
+  image->strides[0] = planes.pitch[0];
+  image->strides[1] = planes.pitch[1];
+}
+
+}  // namespace
+
+class JpegServicePrivate {
+ public:
+  explicit JpegServicePrivate(const JpegServiceParams &params) : pool_(std::make_shared<JpegBufferPool>()) {
+    pool_->capacity = params.max_pooled_buffers;
+    const uint32_t thread_num = params.thread_num ? params.thread_num : 1;
+    for (uint32_t i = 0; i < thread_num; ++i) workers_.emplace_back(&JpegServicePrivate::WorkLoop, this);
+  }
+
+  ~JpegServicePrivate() {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      stop_ = true;
+    }
+    cond_.notify_all();
+    for (auto &worker : workers_) worker.join();
+  }
+
+  int Push(const JpegJob &job, JpegCallback callback) {
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      if (stop_) return -1;
+      jobs_.emplace_back(job, std::move(callback));
+    }
+    cond_.notify_one();
+    return 0;
+  }
+
+  uint32_t GetPooledBufferNum() const {
+    std::lock_guard<std::mutex> lk(pool_->mutex);
+    return pool_->idle.size();
+  }
+
+ private:
+  // scratch of a worker thread for scaled crops
+  struct Scratch {
+    CnedkBufSurface *surf = nullptr;
+    CnedkBufSurfaceCreateParams params;
+    ~Scratch() {
+      if (surf) CnedkBufSurfaceDestroy(surf);
+    }
+  };
+
+  void WorkLoop() {
+    JpegEncoder encoder;
+    Scratch scratch;
+    while (true) {
+      std::pair<JpegJob, JpegCallback> task;
+      {
+        std::unique_lock<std::mutex> lk(mutex_);
+        cond_.wait(lk, [this] { return stop_ || !jobs_.empty(); });
+        // pending jobs are done before exit
+        if (jobs_.empty()) return;
+        task = std::move(jobs_.front());
+        jobs_.pop_front();
+      }
+      JpegBuffer buffer = AcquireBuffer(pool_);
+      int ret = Process(task.first, &encoder, &scratch, buffer.get());
+      if (ret < 0) buffer.reset();
+      if (task.second) task.second(ret, std::move(buffer));
+    }
+  }
+
+  int Process(const JpegJob &job, JpegEncoder *encoder, Scratch *scratch, std::vector<uint8_t> *out) {
+    if (!job.surf || job.batch_idx >= job.surf->batch_size || !IsHostMemory(job.surf->mem_type)) {
+      LOG(ERROR) << "[EasyDK] [JpegService] Process(): The frame must be in host memory";
+      return -1;
+    }
+    const CnedkBufSurfaceParams &params = job.surf->surface_list[job.batch_idx];
+    const bool yuv = IsYuv420sp(params.color_format);
+    if (!yuv && params.color_format != CNEDK_BUF_COLOR_FORMAT_BGR &&
+        params.color_format != CNEDK_BUF_COLOR_FORMAT_RGB) {
+      LOG(ERROR) << "[EasyDK] [JpegService] Process(): Unsupported color format: " << params.color_format;
+      return -1;
+    }
+    CnedkTransformRect roi = job.roi;
+    if (!roi.width || !roi.height) roi = {0, 0, params.width, params.height};
+    if (yuv) {
+      // chroma is shared by 2x2 pixels
+      roi.left &= ~1u;
+      roi.top &= ~1u;
+    }
+    if (roi.left + roi.width > params.width || roi.top + roi.height > params.height) {
+      LOG(ERROR) << "[EasyDK] [JpegService] Process(): The roi is out of the frame";
+      return -1;
+    }
+    const uint32_t width = job.width ? job.width : roi.width, height = job.height ? job.height : roi.height;
+    encoder->SetQuality(job.quality);
+
+    JpegImage image;
+    if (width == roi.width && height == roi.height) {
+      // encode from the frame directly
+      FillImage(params, roi, width, height, &image);
+    } else {
+      if (Scale(job, roi, width, height, scratch) < 0) return -1;
+      FillImage(scratch->surf->surface_list[0], {0, 0, width, height}, width, height, &image);
+    }
+    if (!encoder->Encode(image, out)) {
+      LOG(ERROR) << "[EasyDK] [JpegService] Process(): Encode failed";
+      return -1;
+    }
+    return 0;
+  }
+
+  // crops and scales the roi to the scratch surface in the same color format
+  int Scale(const JpegJob &job, CnedkTransformRect roi, uint32_t width, uint32_t height, Scratch *scratch) {
+    const CnedkBufSurfaceParams &params = job.surf->surface_list[job.batch_idx];
+    // yuv420sp surfaces of odd size are not allowed, the extra row and column are not encoded
+    const bool yuv = IsYuv420sp(params.color_format);
+    const uint32_t surf_width = yuv ? (width + 1) & ~1u : width, surf_height = yuv ? (height + 1) & ~1u : height;
+    if (!scratch->surf || scratch->params.width != surf_width || scratch->params.height != surf_height ||
+        scratch->params.color_format != params.color_format) {
+      if (scratch->surf) CnedkBufSurfaceDestroy(scratch->surf);
+      scratch->surf = nullptr;
+      memset(&scratch->params, 0, sizeof(scratch->params));
+      scratch->params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+      scratch->params.width = surf_width;
+      scratch->params.height = surf_height;
+      scratch->params.color_format = params.color_format;
+      scratch->params.batch_size = 1;
+      if (CnedkBufSurfaceCreate(&scratch->surf, &scratch->params) < 0) {
+        LOG(ERROR) << "[EasyDK] [JpegService] Scale(): Create scratch BufSurface failed";
+        scratch->surf = nullptr;
+        return -1;
+      }
+    }
+    // a view of the frame in the batch
+    CnedkBufSurface src = *job.surf;
+    src.surface_list = &job.surf->surface_list[job.batch_idx];
+    src.batch_size = 1;
+    src.num_filled = 1;
+    CnedkTransformRect dst_rect = {0, 0, width, height};
+    CnedkTransformParams transform_params;
+    memset(&transform_params, 0, sizeof(transform_params));
+    transform_params.transform_flag = CNEDK_TRANSFORM_CROP_SRC | CNEDK_TRANSFORM_CROP_DST;
+    transform_params.src_rect = &roi;
+    transform_params.dst_rect = &dst_rect;
+    if (CnedkTransform(&src, scratch->surf, &transform_params) < 0) {
+      LOG(ERROR) << "[EasyDK] [JpegService] Scale(): Crop and resize failed";
+      return -1;
+    }
+    return 0;
+  }
+
+  std::shared_ptr<JpegBufferPool> pool_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<std::pair<JpegJob, JpegCallback>> jobs_;
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+};
+
+JpegService::JpegService(const JpegServiceParams &params) : priv_(new JpegServicePrivate(params)) {}
+
+JpegService::~JpegService() = default;
+
+int JpegService::EncodeAsync(const JpegJob &job, JpegCallback callback) {
+  return priv_->Push(job, std::move(callback));
+}
+
+int JpegService::Encode(const std::vector<JpegJob> &jobs, std::vector<JpegBuffer> *buffers) {
+  if (!buffers) {
+    LOG(ERROR) << "[EasyDK] [JpegService] Encode(): buffers is nullptr";
+    return -1;
+  }
+  buffers->assign(jobs.size(), nullptr);
+  std::mutex mutex;
+  std::condition_variable cond;
+  size_t remaining = jobs.size();
+  int ret = 0;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    int push_ret = priv_->Push(jobs[i], [&, i](int job_ret, JpegBuffer buffer) {
+      std::lock_guard<std::mutex> lk(mutex);
+      (*buffers)[i] = std::move(buffer);
+      if (job_ret) ret = -1;
+      // notified under the lock, the waiting thread can not leave before
+      if (--remaining == 0) cond.notify_one();
+    });
+    if (push_ret < 0) {
+      std::lock_guard<std::mutex> lk(mutex);
+      ret = -1;
+      --remaining;
+    }
+  }
+  std::unique_lock<std::mutex> lk(mutex);
+  cond.wait(lk, [&] { return remaining == 0; });
+  return ret;
+}
+
+uint32_t JpegService::GetPooledBufferNum() const { return priv_->GetPooledBufferNum(); }
+
+}  // namespace cnedk
@@ -0,0 +1,253 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnedk_memory_budget.hpp"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace cnedk {
+
+struct MemoryBudget::Entry {
+  int domain;
+  std::string category;
+  MemLimits limits;
+  bool reclaimable;
+  // guarded by MemoryBudget::mutex_
+  size_t used = 0;
+  // guarded by reclaim_mutex
+  MemReclaimFunc reclaim;
+  std::mutex reclaim_mutex;
+};
+
+namespace {
+
+size_t HardDeficit(const MemLimits &limits, size_t used, size_t bytes) {
+  return limits.hard && used + bytes > limits.hard ? used + bytes - limits.hard : 0;
+}
+
+size_t SoftExcess(const MemLimits &limits, size_t used) {
+  return limits.soft && used > limits.soft ? used - limits.soft : 0;
+}
+
+}  // namespace
+
+MemoryBudget &MemoryBudget::Instance() {
+  static MemoryBudget instance;
+  return instance;
+}
+
+void MemoryBudget::SetLimits(int domain, const MemLimits &limits) {
+  std::vector<std::shared_ptr<Entry>> candidates;
+  size_t excess;
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    Usage &usage = domains_[domain];
+    usage.limits = limits;
+    excess = SoftExcess(usage.limits, usage.used);
+    if (excess) candidates = Candidates(domain, nullptr, nullptr);
+  }
+  if (excess) ReclaimFrom(candidates, excess);
+}
+
+void MemoryBudget::SetLimits(int domain, const std::string &category, const MemLimits &limits) {
+  std::vector<std::shared_ptr<Entry>> candidates;
+  size_t excess;
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    Usage &usage = categories_[std::make_pair(domain, category)];
+    usage.limits = limits;
+    excess = SoftExcess(usage.limits, usage.used);
+    if (excess) candidates = Candidates(domain, &category, nullptr);
+  }
+  if (excess) ReclaimFrom(candidates, excess);
+}
+
+void MemoryBudget::ClearLimits() {
+  std::unique_lock<std::mutex> lk(mutex_);
+  for (auto &it : domains_) it.second.limits = MemLimits();
+  for (auto &it : categories_) it.second.limits = MemLimits();
+}
+
+size_t MemoryBudget::GetUsage(int domain) const {
+  std::unique_lock<std::mutex> lk(mutex_);
+  auto iter = domains_.find(domain);
+  return iter == domains_.end() ? 0 : iter->second.used;
+}
+
+size_t MemoryBudget::GetUsage(int domain, const std::string &category) const {
+  std::unique_lock<std::mutex> lk(mutex_);
+  auto iter = categories_.find(std::make_pair(domain, category));
+  return iter == categories_.end() ? 0 : iter->second.used;
+}
+
+size_t MemoryBudget::Reclaim(int domain, size_t bytes) {
+  std::vector<std::shared_ptr<Entry>> candidates;
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    candidates = Candidates(domain, nullptr, nullptr);
+  }
+  return ReclaimFrom(candidates, bytes);
+}
+
+void MemoryBudget::Register(const std::shared_ptr<Entry> &entry) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  entries_.push_back(entry);
+}
+
+void MemoryBudget::Unregister(const std::shared_ptr<Entry> &entry) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  domains_[entry->domain].used -= entry->used;
+  categories_[std::make_pair(entry->domain, entry->category)].used -= entry->used;
+  entry->used = 0;
+  entries_.erase(std::remove(entries_.begin(), entries_.end(), entry), entries_.end());
+}
+
+bool MemoryBudget::Reserve(const std::shared_ptr<Entry> &entry, size_t bytes) {
+  if (!bytes) return true;
+  for (int round = 0;; ++round) {
+    std::vector<std::shared_ptr<Entry>> category_candidates, domain_candidates;
+    size_t account_need, category_need, domain_need;
+    bool reserved = false;
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      Usage &domain = domains_[entry->domain];
+      Usage &category = categories_[std::make_pair(entry->domain, entry->category)];
+      account_need = HardDeficit(entry->limits, entry->used, bytes);
+      if (account_need && (round > 0 || !entry->reclaimable)) {
+        VLOG(2) << "[EasyDK] [MemoryBudget] Reserve(): " << bytes << " bytes exceed the hard limit of account, "
+                << "category: " << entry->category << ", used: " << entry->used << ", limit: " << entry->limits.hard;
+        return false;
+      }
+      category_need = HardDeficit(category.limits, category.used, bytes);
+      domain_need = HardDeficit(domain.limits, domain.used, bytes);
+      if (!account_need && !category_need && !domain_need) {
+        entry->used += bytes;
+        category.used += bytes;
+        domain.used += bytes;
+        reserved = true;
+        // reclaim memory above soft limits from the other accounts
+        category_need = SoftExcess(category.limits, category.used);
+        domain_need = SoftExcess(domain.limits, domain.used);
+      } else if (round > 0) {
+        VLOG(2) << "[EasyDK] [MemoryBudget] Reserve(): " << bytes << " bytes exceed the hard limit of domain "
+                << entry->domain << " or category " << entry->category << ", used: " << domain.used << ", "
+                << category.used;
+        return false;
+      }
+      if (category_need) category_candidates = Candidates(entry->domain, &entry->category, entry.get());
+      if (domain_need) domain_candidates = Candidates(entry->domain, nullptr, entry.get());
+    }
+    size_t category_released = ReclaimFrom(category_candidates, category_need);
+    size_t domain_released = category_released;
+    if (domain_need > domain_released) domain_released += ReclaimFrom(domain_candidates, domain_need - domain_released);
+    if (reserved) return true;
+    // the account trims its own idle memory for what the other accounts could not release
+    size_t self_need = std::max(account_need, std::max(category_need - std::min(category_need, category_released),
+                                                       domain_need - std::min(domain_need, domain_released)));
+    if (self_need && entry->reclaimable) ReclaimFrom({entry}, self_need);
+  }
+}
+
+void MemoryBudget::Release(const std::shared_ptr<Entry> &entry, size_t bytes) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (bytes > entry->used) {
+    LOG(WARNING) << "[EasyDK] [MemoryBudget] Release(): Release " << bytes << " bytes, more than reserved "
+                 << entry->used << " bytes";
+    bytes = entry->used;
+  }
+  entry->used -= bytes;
+  domains_[entry->domain].used -= bytes;
+  categories_[std::make_pair(entry->domain, entry->category)].used -= bytes;
+}
+
+bool MemoryBudget::OverSoftLimit(const std::shared_ptr<Entry> &entry) const {
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (SoftExcess(entry->limits, entry->used)) return true;
+  auto category = categories_.find(std::make_pair(entry->domain, entry->category));
+  if (category != categories_.end() && SoftExcess(category->second.limits, category->second.used)) return true;
+  auto domain = domains_.find(entry->domain);
+  return domain != domains_.end() && SoftExcess(domain->second.limits, domain->second.used);
+}
+
+std::vector<std::shared_ptr<MemoryBudget::Entry>> MemoryBudget::Candidates(int domain, const std::string *category,
+                                                                          const Entry *exclude) {
+  std::vector<std::shared_ptr<Entry>> candidates;
+  for (const auto &entry : entries_) {
+    if (entry.get() == exclude || !entry->reclaimable || !entry->used || entry->domain != domain) continue;
+    if (category && entry->category != *category) continue;
+    candidates.push_back(entry);
+  }
+  // the accounts holding more memory are asked first
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const std::shared_ptr<Entry> &lhs, const std::shared_ptr<Entry> &rhs) {
+                     return lhs->used > rhs->used;
+                   });
+  return candidates;
+}
+
+size_t MemoryBudget::ReclaimFrom(const std::vector<std::shared_ptr<Entry>> &candidates, size_t bytes) {
+  size_t released = 0;
+  for (const auto &entry : candidates) {
+    if (released >= bytes) break;
+    std::unique_lock<std::mutex> lk(entry->reclaim_mutex);
+    if (entry->reclaim) released += entry->reclaim(bytes - released);
+  }
+  return released;
+}
+
+MemoryAccount::MemoryAccount(int domain, const std::string &category, const MemLimits &limits,
+                             MemReclaimFunc reclaim)
+    : entry_(std::make_shared<MemoryBudget::Entry>()) {
+  entry_->domain = domain;
+  entry_->category = category;
+  entry_->limits = limits;
+  entry_->reclaimable = static_cast<bool>(reclaim);
+  entry_->reclaim = std::move(reclaim);
+  MemoryBudget::Instance().Register(entry_);
+}
+
+MemoryAccount::~MemoryAccount() {
+  {
+    std::unique_lock<std::mutex> lk(entry_->reclaim_mutex);
+    entry_->reclaim = nullptr;
+  }
+  MemoryBudget::Instance().Unregister(entry_);
+}
+
+bool MemoryAccount::Reserve(size_t bytes) { return MemoryBudget::Instance().Reserve(entry_, bytes); }
+
+void MemoryAccount::Release(size_t bytes) { MemoryBudget::Instance().Release(entry_, bytes); }
+
+size_t MemoryAccount::GetUsage() const {
+  std::unique_lock<std::mutex> lk(MemoryBudget::Instance().mutex_);
+  return entry_->used;
+}
+
+bool MemoryAccount::OverSoftLimit() const { return MemoryBudget::Instance().OverSoftLimit(entry_); }
+
+}  // namespace cnedk
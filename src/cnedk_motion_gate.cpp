@@ -0,0 +1,441 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnedk_motion_gate.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+#include "glog/logging.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define MOTION_GATE_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define MOTION_GATE_NEON
+#endif
+
+namespace cnedk {
+
+namespace {
+
+// acc[i] += src[i]
+void AccumulateRow(const uint8_t *src, uint16_t *acc, uint32_t n) {
+  uint32_t i = 0;
+#if defined(MOTION_GATE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+    __m128i *a = reinterpret_cast<__m128i *>(acc + i);
+    _mm_storeu_si128(a, _mm_add_epi16(_mm_loadu_si128(a), _mm_unpacklo_epi8(v, zero)));
+    _mm_storeu_si128(a + 1, _mm_add_epi16(_mm_loadu_si128(a + 1), _mm_unpackhi_epi8(v, zero)));
+  }
+#elif defined(MOTION_GATE_NEON)
+  for (; i + 16 <= n; i += 16) {
+    uint8x16_t v = vld1q_u8(src + i);
+    vst1q_u16(acc + i, vaddw_u8(vld1q_u16(acc + i), vget_low_u8(v)));
+    vst1q_u16(acc + i + 8, vaddw_u8(vld1q_u16(acc + i + 8), vget_high_u8(v)));
+  }
+#endif
+  for (; i < n; ++i) acc[i] += src[i];
+}
+
+// acc[i] = acc[2 * i] + acc[2 * i + 1] for i in [0, n), in place. Sums never exceed 255 * 64
+void PairwiseAdd(uint16_t *acc, uint32_t n) {
+  uint32_t i = 0;
+#if defined(MOTION_GATE_SSE2)
+  const __m128i ones = _mm_set1_epi16(1);
+  for (; i + 8 <= n; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + 2 * i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc + 2 * i + 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(acc + i),
+                     _mm_packs_epi32(_mm_madd_epi16(a, ones), _mm_madd_epi16(b, ones)));
+  }
+#elif defined(MOTION_GATE_NEON)
+  for (; i + 8 <= n; i += 8) {
+    vst1q_u16(acc + i, vpaddq_u16(vld1q_u16(acc + 2 * i), vld1q_u16(acc + 2 * i + 8)));
+  }
+#endif
+  for (; i < n; ++i) acc[i] = acc[2 * i] + acc[2 * i + 1];
+}
+
+void InitRow(const uint16_t *sum, uint32_t sum_shift, uint8_t *prev, int16_t *bg, uint32_t n) {
+  const uint32_t half = (1u << sum_shift) >> 1;
+  for (uint32_t i = 0; i < n; ++i) {
+    prev[i] = (sum[i] + half) >> sum_shift;
+    bg[i] = prev[i] << 4;
+  }
+}
+
+// Compares the downsampled row with the previous frame and the background, marks changed pixels in region with 1,
+// then updates the previous frame and the background
+void DiffRow(const uint16_t *sum, uint32_t sum_shift, const uint8_t *region, uint8_t threshold, uint32_t bg_shift,
+             uint8_t *prev, int16_t *bg, uint8_t *mask, uint32_t n) {
+  const uint32_t half = (1u << sum_shift) >> 1;
+  uint32_t i = 0;
+#if defined(MOTION_GATE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi8(1);
+  const __m128i round = _mm_set1_epi16(half);
+  const __m128i thr = _mm_set1_epi8(static_cast<char>(threshold));
+  const __m128i sum_count = _mm_cvtsi32_si128(sum_shift);
+  const __m128i bg_count = _mm_cvtsi32_si128(bg_shift);
+  for (; i + 16 <= n; i += 16) {
+    __m128i s0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sum + i));
+    __m128i s1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sum + i + 8));
+    s0 = _mm_srl_epi16(_mm_add_epi16(s0, round), sum_count);
+    s1 = _mm_srl_epi16(_mm_add_epi16(s1, round), sum_count);
+    __m128i cur = _mm_packus_epi16(s0, s1);
+    __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(prev + i));
+    __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bg + i));
+    __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bg + i + 8));
+    __m128i b = _mm_packus_epi16(_mm_srai_epi16(b0, 4), _mm_srai_epi16(b1, 4));
+    __m128i d = _mm_max_epu8(_mm_or_si128(_mm_subs_epu8(cur, p), _mm_subs_epu8(p, cur)),
+                             _mm_or_si128(_mm_subs_epu8(cur, b), _mm_subs_epu8(b, cur)));
+    __m128i changed = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_subs_epu8(d, thr), zero),
+                                       _mm_loadu_si128(reinterpret_cast<const __m128i *>(region + i)));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(mask + i), _mm_and_si128(changed, one));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(prev + i), cur);
+    __m128i c0 = _mm_slli_epi16(_mm_unpacklo_epi8(cur, zero), 4);
+    __m128i c1 = _mm_slli_epi16(_mm_unpackhi_epi8(cur, zero), 4);
+    b0 = _mm_add_epi16(b0, _mm_sra_epi16(_mm_sub_epi16(c0, b0), bg_count));
+    b1 = _mm_add_epi16(b1, _mm_sra_epi16(_mm_sub_epi16(c1, b1), bg_count));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(bg + i), b0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(bg + i + 8), b1);
+  }
+#elif defined(MOTION_GATE_NEON)
+  const uint16x8_t round = vdupq_n_u16(half);
+  const int16x8_t sum_count = vdupq_n_s16(-static_cast<int16_t>(sum_shift));
+  const int16x8_t bg_count = vdupq_n_s16(-static_cast<int16_t>(bg_shift));
+  const uint8x16_t thr = vdupq_n_u8(threshold);
+  const uint8x16_t one = vdupq_n_u8(1);
+  for (; i + 16 <= n; i += 16) {
+    uint16x8_t s0 = vshlq_u16(vaddq_u16(vld1q_u16(sum + i), round), sum_count);
+    uint16x8_t s1 = vshlq_u16(vaddq_u16(vld1q_u16(sum + i + 8), round), sum_count);
+    uint8x16_t cur = vcombine_u8(vqmovn_u16(s0), vqmovn_u16(s1));
+    uint8x16_t p = vld1q_u8(prev + i);
+    int16x8_t b0 = vld1q_s16(bg + i);
+    int16x8_t b1 = vld1q_s16(bg + i + 8);
+    uint8x16_t b = vcombine_u8(vqmovun_s16(vshrq_n_s16(b0, 4)), vqmovun_s16(vshrq_n_s16(b1, 4)));
+    uint8x16_t d = vmaxq_u8(vabdq_u8(cur, p), vabdq_u8(cur, b));
+    uint8x16_t changed = vandq_u8(vcgtq_u8(d, thr), vld1q_u8(region + i));
+    vst1q_u8(mask + i, vandq_u8(changed, one));
+    vst1q_u8(prev + i, cur);
+    int16x8_t c0 = vreinterpretq_s16_u16(vshll_n_u8(vget_low_u8(cur), 4));
+    int16x8_t c1 = vreinterpretq_s16_u16(vshll_n_u8(vget_high_u8(cur), 4));
+    vst1q_s16(bg + i, vaddq_s16(b0, vshlq_s16(vsubq_s16(c0, b0), bg_count)));
+    vst1q_s16(bg + i + 8, vaddq_s16(b1, vshlq_s16(vsubq_s16(c1, b1), bg_count)));
+  }
+#endif
+  for (; i < n; ++i) {
+    int cur = (sum[i] + half) >> sum_shift;
+    int d = std::max(std::abs(cur - prev[i]), std::abs(cur - (bg[i] >> 4)));
+    mask[i] = region[i] && d > threshold;
+    prev[i] = cur;
+    bg[i] += ((cur << 4) - bg[i]) >> bg_shift;
+  }
+}
+
+uint32_t Log2(uint32_t scale) {
+  uint32_t bits = 0;
+  while ((1u << bits) < scale) ++bits;
+  return bits;
+}
+
+// a box in frame pixels, the end is exclusive
+struct Box {
+  uint32_t x0, y0, x1, y1;
+};
+
+inline bool Overlap(const Box &a, const Box &b) { return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1; }
+
+inline Box Union(const Box &a, const Box &b) {
+  return Box{std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1)};
+}
+
+inline uint64_t Area(const Box &b) { return static_cast<uint64_t>(b.x1 - b.x0) * (b.y1 - b.y0); }
+
+void MergeBoxes(std::vector<Box> *boxes, size_t max_num) {
+  while (true) {
+    // merge the overlapped or adjacent boxes
+    for (bool merged = true; merged;) {
+      merged = false;
+      for (size_t i = 0; i < boxes->size() && !merged; ++i) {
+        for (size_t j = i + 1; j < boxes->size(); ++j) {
+          if (Overlap((*boxes)[i], (*boxes)[j])) {
+            (*boxes)[i] = Union((*boxes)[i], (*boxes)[j]);
+            boxes->erase(boxes->begin() + j);
+            merged = true;
+            break;
+          }
+        }
+      }
+    }
+    if (boxes->size() <= max_num) return;
+    // too many boxes, merge the pair adding the least area
+    size_t best_i = 0, best_j = 1;
+    uint64_t best = std::numeric_limits<uint64_t>::max();
+    for (size_t i = 0; i < boxes->size(); ++i) {
+      for (size_t j = i + 1; j < boxes->size(); ++j) {
+        uint64_t grow = Area(Union((*boxes)[i], (*boxes)[j])) - Area((*boxes)[i]) - Area((*boxes)[j]);
+        if (grow < best) {
+          best = grow;
+          best_i = i;
+          best_j = j;
+        }
+      }
+    }
+    (*boxes)[best_i] = Union((*boxes)[best_i], (*boxes)[best_j]);
+    boxes->erase(boxes->begin() + best_j);
+  }
+}
+
+}  // namespace
+
+void MotionGate::SetRegions(const std::vector<CnedkTransformRect> &include,
+                            const std::vector<CnedkTransformRect> &exclude) {
+  include_ = include;
+  exclude_ = exclude;
+  if (width_) BuildRegions();
+}
+
+int MotionGate::Process(CnedkBufSurface *surf, uint32_t batch_idx, MotionResult *result) {
+  if (!surf || batch_idx >= surf->batch_size) {
+    LOG(ERROR) << "[EasyDK] [MotionGate] Process(): surf is nullptr or batch index is out of range";
+    return -1;
+  }
+  const CnedkBufSurfaceParams &params = surf->surface_list[batch_idx];
+  switch (params.color_format) {
+    case CNEDK_BUF_COLOR_FORMAT_GRAY8:
+    case CNEDK_BUF_COLOR_FORMAT_YUV420:
+    case CNEDK_BUF_COLOR_FORMAT_NV12:
+    case CNEDK_BUF_COLOR_FORMAT_NV21:
+      break;
+    default:
+      LOG(ERROR) << "[EasyDK] [MotionGate] Process(): Unsupported color format: " << params.color_format;
+      return -1;
+  }
+  void *addr = params.mapped_data_ptr;
+  if (surf->mem_type == CNEDK_BUF_MEM_SYSTEM || surf->mem_type == CNEDK_BUF_MEM_PINNED) {
+    addr = params.data_ptr;
+  }
+  if (!addr) {
+    LOG(ERROR) << "[EasyDK] [MotionGate] Process(): Memory is not accessible by CPU, memory type: " << surf->mem_type;
+    return -1;
+  }
+  return Process(static_cast<const uint8_t *>(addr) + params.plane_params.offset[0], params.width, params.height,
+                 params.plane_params.pitch[0], result);
+}
+
+int MotionGate::Process(const uint8_t *luma, uint32_t width, uint32_t height, uint32_t stride,
+                        MotionResult *result) {
+  const uint32_t scale = params_.scale;
+  if (scale > 8 || (scale & (scale - 1)) || !params_.cell_size || params_.bg_update_shift > 7) {
+    LOG(ERROR) << "[EasyDK] [MotionGate] Process(): Invalid parameters, scale: " << scale
+               << ", cell size: " << params_.cell_size << ", background update shift: " << params_.bg_update_shift;
+    return -1;
+  }
+  if (!luma || !result || width < scale || height < scale || stride < width) {
+    LOG(ERROR) << "[EasyDK] [MotionGate] Process(): Invalid frame, width: " << width << ", height: " << height
+               << ", stride: " << stride;
+    return -1;
+  }
+  if (width != width_ || height != height_) Prepare(width, height);
+
+  const uint32_t sum_shift = 2 * Log2(scale);
+  const uint32_t cell = params_.cell_size;
+  uint16_t *sum = sum_.data();
+  std::fill(changed_count_.begin(), changed_count_.end(), 0);
+  for (uint32_t y = 0; y < ds_height_; ++y) {
+    // box filter of scale x scale
+    const uint8_t *row = luma + static_cast<size_t>(y) * scale * stride;
+    std::fill(sum_.begin(), sum_.end(), 0);
+    for (uint32_t r = 0; r < scale; ++r) AccumulateRow(row + static_cast<size_t>(r) * stride, sum, ds_width_ * scale);
+    for (uint32_t n = ds_width_ * scale / 2; n >= ds_width_; n /= 2) PairwiseAdd(sum, n);
+
+    const size_t offset = static_cast<size_t>(y) * ds_width_;
+    if (first_frame_) {
+      InitRow(sum, sum_shift, &prev_[offset], &background_[offset], ds_width_);
+      continue;
+    }
+    DiffRow(sum, sum_shift, &region_[offset], params_.diff_threshold, params_.bg_update_shift, &prev_[offset],
+            &background_[offset], mask_.data(), ds_width_);
+    uint32_t *count = &changed_count_[(y / cell) * cell_cols_];
+    for (uint32_t x = 0; x < ds_width_; x += cell) {
+      const uint32_t end = std::min(x + cell, ds_width_);
+      uint32_t n = 0;
+      for (uint32_t i = x; i < end; ++i) n += mask_[i];
+      count[x / cell] += n;
+    }
+  }
+
+  result->skip = false;
+  result->full_frame = false;
+  result->changed_cells = 0;
+  result->rois.clear();
+  if (first_frame_) {
+    first_frame_ = false;
+    result->full_frame = true;
+    return 0;
+  }
+
+  uint32_t changed = 0;
+  for (size_t c = 0; c < changed_count_.size(); ++c) {
+    changed_count_[c] = changed_count_[c] && changed_count_[c] >= params_.cell_ratio * region_count_[c];
+    changed += changed_count_[c];
+  }
+  result->changed_cells = changed;
+
+  if (params_.full_frame_ratio > 0 && region_cells_ && changed >= params_.full_frame_ratio * region_cells_) {
+    // scene changes or the camera moves, follow the current frame at once
+    for (size_t i = 0; i < prev_.size(); ++i) background_[i] = prev_[i] << 4;
+    active_ = false;
+    hold_ = 0;
+    last_rois_.clear();
+    result->full_frame = true;
+    return 0;
+  }
+
+  if (changed && changed >= (active_ ? params_.release_cells : params_.trigger_cells)) {
+    active_ = true;
+    hold_ = params_.hold_frames;
+    FindRegions(&result->rois);
+    last_rois_ = result->rois;
+  } else if (active_ && hold_) {
+    --hold_;
+    result->rois = last_rois_;
+  } else {
+    active_ = false;
+    result->skip = true;
+  }
+  return 0;
+}
+
+void MotionGate::Reset() {
+  first_frame_ = true;
+  active_ = false;
+  hold_ = 0;
+  last_rois_.clear();
+}
+
+void MotionGate::Prepare(uint32_t width, uint32_t height) {
+  const uint32_t scale = params_.scale;
+  const uint32_t cell = params_.cell_size;
+  width_ = width;
+  height_ = height;
+  ds_width_ = width / scale;
+  ds_height_ = height / scale;
+  cell_cols_ = (ds_width_ + cell - 1) / cell;
+  cell_rows_ = (ds_height_ + cell - 1) / cell;
+  const size_t ds_size = static_cast<size_t>(ds_width_) * ds_height_;
+  sum_.assign(ds_width_ * scale, 0);
+  mask_.assign(ds_width_, 0);
+  prev_.assign(ds_size, 0);
+  background_.assign(ds_size, 0);
+  changed_count_.assign(cell_cols_ * cell_rows_, 0);
+  visited_.assign(cell_cols_ * cell_rows_, 0);
+  BuildRegions();
+  Reset();
+}
+
+void MotionGate::BuildRegions() {
+  const uint32_t scale = params_.scale;
+  region_.assign(static_cast<size_t>(ds_width_) * ds_height_, include_.empty() ? 0xff : 0);
+  auto fill = [&](const CnedkTransformRect &rect, uint8_t value) {
+    const uint32_t x0 = std::min(rect.left / scale, ds_width_);
+    const uint32_t y0 = std::min(rect.top / scale, ds_height_);
+    const uint32_t x1 = std::min((rect.left + rect.width + scale - 1) / scale, ds_width_);
+    const uint32_t y1 = std::min((rect.top + rect.height + scale - 1) / scale, ds_height_);
+    for (uint32_t y = y0; y < y1 && x0 < x1; ++y) {
+      std::fill(region_.begin() + static_cast<size_t>(y) * ds_width_ + x0,
+                region_.begin() + static_cast<size_t>(y) * ds_width_ + x1, value);
+    }
+  };
+  for (const auto &rect : include_) fill(rect, 0xff);
+  for (const auto &rect : exclude_) fill(rect, 0);
+
+  const uint32_t cell = params_.cell_size;
+  region_count_.assign(cell_cols_ * cell_rows_, 0);
+  for (uint32_t y = 0; y < ds_height_; ++y) {
+    for (uint32_t x = 0; x < ds_width_; ++x) {
+      if (region_[static_cast<size_t>(y) * ds_width_ + x]) ++region_count_[(y / cell) * cell_cols_ + x / cell];
+    }
+  }
+  region_cells_ = std::count_if(region_count_.begin(), region_count_.end(), [](uint32_t n) { return n > 0; });
+}
+
+void MotionGate::FindRegions(std::vector<CnedkTransformRect> *rois) {
+  const uint32_t cell_pixels = params_.cell_size * params_.scale;
+  const uint32_t padding = params_.roi_padding;
+  std::vector<Box> boxes;
+  std::vector<uint32_t> stack;
+  std::fill(visited_.begin(), visited_.end(), 0);
+  // 8-connected changed cells make a region
+  for (uint32_t c = 0; c < changed_count_.size(); ++c) {
+    if (!changed_count_[c] || visited_[c]) continue;
+    uint32_t cx0 = cell_cols_, cy0 = cell_rows_, cx1 = 0, cy1 = 0;
+    visited_[c] = 1;
+    stack.push_back(c);
+    while (!stack.empty()) {
+      const uint32_t cur = stack.back();
+      stack.pop_back();
+      const uint32_t cx = cur % cell_cols_, cy = cur / cell_cols_;
+      cx0 = std::min(cx0, cx);
+      cy0 = std::min(cy0, cy);
+      cx1 = std::max(cx1, cx);
+      cy1 = std::max(cy1, cy);
+      for (uint32_t ny = cy ? cy - 1 : 0; ny <= std::min(cy + 1, cell_rows_ - 1); ++ny) {
+        for (uint32_t nx = cx ? cx - 1 : 0; nx <= std::min(cx + 1, cell_cols_ - 1); ++nx) {
+          const uint32_t n = ny * cell_cols_ + nx;
+          if (changed_count_[n] && !visited_[n]) {
+            visited_[n] = 1;
+            stack.push_back(n);
+          }
+        }
+      }
+    }
+    Box box;
+    box.x0 = cx0 * cell_pixels > padding ? cx0 * cell_pixels - padding : 0;
+    box.y0 = cy0 * cell_pixels > padding ? cy0 * cell_pixels - padding : 0;
+    box.x1 = std::min((cx1 + 1) * cell_pixels + padding, width_);
+    box.y1 = std::min((cy1 + 1) * cell_pixels + padding, height_);
+    boxes.push_back(box);
+  }
+  MergeBoxes(&boxes, std::max(params_.max_rois, 1u));
+
+  // crop of yuv420sp needs even coordinates
+  rois->clear();
+  for (const Box &box : boxes) {
+    CnedkTransformRect rect;
+    rect.left = box.x0 & ~1u;
+    rect.top = box.y0 & ~1u;
+    const uint32_t right = std::min(box.x1 + (box.x1 & 1), width_ & ~1u);
+    const uint32_t bottom = std::min(box.y1 + (box.y1 & 1), height_ & ~1u);
+    if (right <= rect.left || bottom <= rect.top) continue;
+    rect.width = right - rect.left;
+    rect.height = bottom - rect.top;
+    rois->push_back(rect);
+  }
+}
+
+}  // namespace cnedk
@@ -0,0 +1,129 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnedk_muxer.h"
+
+#include <memory>   // for unique_ptr
+#include <mutex>    // for call_once
+
+#include "glog/logging.h"
+
+#include "cnedk_muxer_impl.hpp"
+
+namespace cnedk {
+
+class MuxerService {
+ public:
+  static MuxerService &Instance() {
+    static std::once_flag s_flag;
+    std::call_once(s_flag, [&] { instance_.reset(new MuxerService); });
+    return *instance_;
+  }
+
+  int Create(void **muxer, CnedkMuxerCreateParams *params) {
+    if (!muxer || !params) {
+      LOG(ERROR) << "[EasyDK] [MuxerService] Create(): muxer or params pointer is invalid";
+      return -1;
+    }
+    if (CheckParams(params) < 0) {
+      LOG(ERROR) << "[EasyDK] [MuxerService] Create(): Parameters are invalid";
+      return -1;
+    }
+    std::unique_ptr<Muxer> muxer_(new Muxer(*params));
+    if (muxer_->Init() < 0) {
+      LOG(ERROR) << "[EasyDK] [MuxerService] Create(): Init muxer failed";
+      return -1;
+    }
+    *muxer = muxer_.release();
+    return 0;
+  }
+
+  int Destroy(void *muxer) {
+    if (!muxer) {
+      LOG(ERROR) << "[EasyDK] [MuxerService] Destroy(): Muxer pointer is invalid";
+      return -1;
+    }
+    Muxer *muxer_ = static_cast<Muxer *>(muxer);
+    int ret = muxer_->Finish();
+    delete muxer_;
+    return ret;
+  }
+
+  int Write(void *muxer, CnedkVEncFrameBits *framebits) {
+    if (!muxer || !framebits) {
+      LOG(ERROR) << "[EasyDK] [MuxerService] Write(): Muxer or framebits pointer is invalid";
+      return -1;
+    }
+    Muxer *muxer_ = static_cast<Muxer *>(muxer);
+    return muxer_->Write(*framebits);
+  }
+
+ private:
+  int CheckParams(CnedkMuxerCreateParams *params) {
+    if (params->format <= CNEDK_MUXER_FORMAT_INVALID || params->format >= CNEDK_MUXER_FORMAT_NUM) {
+      LOG(ERROR) << "[EasyDK] [MuxerService] CheckParams(): Unsupported format: " << params->format;
+      return -1;
+    }
+    if (params->codec_type != CNEDK_VENC_TYPE_H264 && params->codec_type != CNEDK_VENC_TYPE_H265) {
+      LOG(ERROR) << "[EasyDK] [MuxerService] CheckParams(): Unsupported codec type: " << params->codec_type;
+      return -1;
+    }
+    if (params->width == 0 || params->height == 0 || params->width > 0xFFFF || params->height > 0xFFFF) {
+      LOG(ERROR) << "[EasyDK] [MuxerService] CheckParams(): Invalid resolution: " << params->width << "x"
+                 << params->height;
+      return -1;
+    }
+    if (!params->file_path || !params->file_path[0]) {
+      LOG(ERROR) << "[EasyDK] [MuxerService] CheckParams(): File path is invalid";
+      return -1;
+    }
+    if ((params->segment_duration_ms || params->segment_size) && !IsIndexedPath(params->file_path)) {
+      LOG(ERROR) << "[EasyDK] [MuxerService] CheckParams(): File path must contain exactly one segment index"
+                 << " conversion and no other '%' when segment rotation is enabled";
+      return -1;
+    }
+    return 0;
+  }
+
+ private:
+  MuxerService(const MuxerService &) = delete;
+  MuxerService(MuxerService &&) = delete;
+  MuxerService &operator=(const MuxerService &) = delete;
+  MuxerService &operator=(MuxerService &&) = delete;
+  MuxerService() = default;
+
+ private:
+  static std::unique_ptr<MuxerService> instance_;
+};
+
+std::unique_ptr<MuxerService> MuxerService::instance_;
+
+}  // namespace cnedk
+
+extern "C" {
+
+int CnedkMuxerCreate(void **muxer, CnedkMuxerCreateParams *params) {
+  return cnedk::MuxerService::Instance().Create(muxer, params);
+}
+int CnedkMuxerDestroy(void *muxer) { return cnedk::MuxerService::Instance().Destroy(muxer); }
+int CnedkMuxerWrite(void *muxer, CnedkVEncFrameBits *framebits) {
+  return cnedk::MuxerService::Instance().Write(muxer, framebits);
+}
+};
@@ -0,0 +1,733 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnedk_muxer_impl.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace cnedk {
+
+// ------------------------------------------------------------------------------------------------------------------
+// AsyncFileWriter
+
+AsyncFileWriter::AsyncFileWriter(size_t max_buffer_size) : max_buffer_size_(max_buffer_size) {
+  thread_ = std::thread(&AsyncFileWriter::Loop, this);
+}
+
+AsyncFileWriter::~AsyncFileWriter() { Stop(); }
+
+void AsyncFileWriter::Push(Task &&task) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  size_t size = task.data.size();
+  // a single piece larger than buffer is allowed once the buffer drains
+  not_full_.wait(lk, [this, size]() { return buffered_size_ == 0 || buffered_size_ + size <= max_buffer_size_; });
+  buffered_size_ += size;
+  tasks_.emplace_back(std::move(task));
+  not_empty_.notify_one();
+}
+
+void AsyncFileWriter::Open(const std::string &path) {
+  Task task;
+  task.type = Task::OPEN;
+  task.path = path;
+  Push(std::move(task));
+}
+
+void AsyncFileWriter::Write(std::vector<uint8_t> &&data) {
+  if (data.empty()) return;
+  Task task;
+  task.type = Task::DATA;
+  task.data = std::move(data);
+  Push(std::move(task));
+}
+
+void AsyncFileWriter::Close() {
+  Task task;
+  task.type = Task::CLOSE;
+  Push(std::move(task));
+}
+
+void AsyncFileWriter::Stop() {
+  {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (stop_) return;
+    stop_ = true;
+    not_empty_.notify_one();
+  }
+  if (thread_.joinable()) thread_.join();
+  if (file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+void AsyncFileWriter::Loop() {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lk(mutex_);
+      not_empty_.wait(lk, [this]() { return stop_ || !tasks_.empty(); });
+      if (tasks_.empty()) return;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+
+    switch (task.type) {
+      case Task::OPEN:
+        if (file_) fclose(file_);
+        file_ = fopen(task.path.c_str(), "wb");
+        if (!file_) {
+          LOG(ERROR) << "[EasyDK] [AsyncFileWriter] Loop(): Open file failed: " << task.path;
+          failed_.store(true);
+        }
+        break;
+      case Task::DATA:
+        if (file_ && fwrite(task.data.data(), 1, task.data.size(), file_) != task.data.size()) {
+          LOG(ERROR) << "[EasyDK] [AsyncFileWriter] Loop(): Write file failed";
+          failed_.store(true);
+        }
+        break;
+      case Task::CLOSE:
+        if (file_) {
+          fclose(file_);
+          file_ = nullptr;
+        }
+        break;
+    }
+
+    std::unique_lock<std::mutex> lk(mutex_);
+    buffered_size_ -= task.data.size();
+    not_full_.notify_all();
+  }
+}
+
+// ------------------------------------------------------------------------------------------------------------------
+// MPEG-TS
+
+namespace {
+
+constexpr uint16_t kPmtPid = 0x1000;
+constexpr uint16_t kVideoPid = 0x100;
+constexpr size_t kTsPacketSize = 188;
+// pts is ahead of pcr for decoder buffering
+constexpr int64_t kTsPtsDelay = 9000;
+constexpr int64_t kTsTimestampMask = (int64_t(1) << 33) - 1;
+
+uint32_t Crc32Mpeg(const uint8_t *data, size_t size) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < size; ++i) {
+    crc ^= static_cast<uint32_t>(data[i]) << 24;
+    for (int bit = 0; bit < 8; ++bit) {
+      crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04C11DB7 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+// Writes one TS packet, returns size of payload consumed
+size_t WriteTsPacket(uint16_t pid, bool unit_start, uint8_t *cc, bool random_access, const int64_t *pcr,
+                     const uint8_t *payload, size_t size, std::vector<uint8_t> *out) {
+  size_t af_min = (random_access || pcr) ? 2 + (pcr ? 6 : 0) : 0;
+  size_t n = std::min(size, kTsPacketSize - 4 - af_min);
+  size_t af_size = kTsPacketSize - 4 - n;  // including the length byte
+
+  out->push_back(0x47);
+  out->push_back((unit_start ? 0x40 : 0x00) | ((pid >> 8) & 0x1F));
+  out->push_back(pid & 0xFF);
+  out->push_back((af_size ? 0x30 : 0x10) | (*cc & 0x0F));
+  *cc = (*cc + 1) & 0x0F;
+  if (af_size) {
+    out->push_back(static_cast<uint8_t>(af_size - 1));
+    if (af_size > 1) {
+      out->push_back((random_access ? 0x40 : 0x00) | (pcr ? 0x10 : 0x00));
+      size_t written = 2;
+      if (pcr) {
+        uint64_t base = static_cast<uint64_t>(*pcr) & kTsTimestampMask;
+        out->push_back(static_cast<uint8_t>(base >> 25));
+        out->push_back(static_cast<uint8_t>(base >> 17));
+        out->push_back(static_cast<uint8_t>(base >> 9));
+        out->push_back(static_cast<uint8_t>(base >> 1));
+        out->push_back(static_cast<uint8_t>(((base & 1) << 7) | 0x7E));
+        out->push_back(0x00);
+        written += 6;
+      }
+      out->insert(out->end(), af_size - written, 0xFF);
+    }
+  }
+  out->insert(out->end(), payload, payload + n);
+  return n;
+}
+
+void PutTimestamp(uint8_t prefix, int64_t ts, std::vector<uint8_t> *out) {
+  uint64_t v = static_cast<uint64_t>(ts) & kTsTimestampMask;
+  out->push_back(static_cast<uint8_t>((prefix << 4) | ((v >> 29) & 0x0E) | 0x01));
+  out->push_back(static_cast<uint8_t>(v >> 22));
+  out->push_back(static_cast<uint8_t>(((v >> 14) & 0xFE) | 0x01));
+  out->push_back(static_cast<uint8_t>(v >> 7));
+  out->push_back(static_cast<uint8_t>(((v << 1) & 0xFE) | 0x01));
+}
+
+}  // namespace
+
+void TsFormat::WriteSection(uint16_t pid, const std::vector<uint8_t> &section, std::vector<uint8_t> *out) {
+  std::vector<uint8_t> payload;
+  payload.reserve(section.size() + 5);
+  payload.push_back(0x00);  // pointer field
+  payload.insert(payload.end(), section.begin(), section.end());
+  uint32_t crc = Crc32Mpeg(section.data(), section.size());
+  for (int shift = 24; shift >= 0; shift -= 8) payload.push_back(static_cast<uint8_t>(crc >> shift));
+  // sections are small enough for one packet, stuffed with 0xFF
+  payload.resize(kTsPacketSize - 4, 0xFF);
+  uint8_t *cc = pid == 0 ? &pat_cc_ : &pmt_cc_;
+  WriteTsPacket(pid, true, cc, false, nullptr, payload.data(), payload.size(), out);
+}
+
+void TsFormat::WriteTables(std::vector<uint8_t> *out) {
+  // PAT, program 1
+  std::vector<uint8_t> pat = {0x00, 0xB0, 0x0D, 0x00, 0x01, 0xC1, 0x00, 0x00, 0x00, 0x01,
+                              static_cast<uint8_t>(0xE0 | (kPmtPid >> 8)), static_cast<uint8_t>(kPmtPid & 0xFF)};
+  WriteSection(0, pat, out);
+  // PMT with one video stream
+  uint8_t stream_type = hevc_ ? 0x24 : 0x1B;
+  std::vector<uint8_t> pmt = {0x02, 0xB0, 0x12, 0x00, 0x01, 0xC1, 0x00, 0x00,
+                              static_cast<uint8_t>(0xE0 | (kVideoPid >> 8)), static_cast<uint8_t>(kVideoPid & 0xFF),
+                              0xF0, 0x00, stream_type,
+                              static_cast<uint8_t>(0xE0 | (kVideoPid >> 8)), static_cast<uint8_t>(kVideoPid & 0xFF),
+                              0xF0, 0x00};
+  WriteSection(kPmtPid, pmt, out);
+}
+
+void TsFormat::WriteHeader(const ParamSets &param_sets, std::vector<uint8_t> *out) { WriteTables(out); }
+
+void TsFormat::WritePacket(const MuxPacket &packet, std::vector<uint8_t> *out) {
+  if (packet.key) WriteTables(out);
+
+  std::vector<uint8_t> pes;
+  pes.reserve(64);
+  int64_t pts = packet.dts + kTsPtsDelay;
+  uint8_t pes_header[] = {0x00, 0x00, 0x01, 0xE0, 0x00, 0x00, 0x80, 0x80, 0x05};
+  pes.insert(pes.end(), pes_header, pes_header + sizeof(pes_header));
+  PutTimestamp(0x2, pts, &pes);
+  // access unit delimiter is required by H.264/H.265 in TS
+  static const uint8_t h264_aud[] = {0x00, 0x00, 0x00, 0x01, 0x09, 0xF0};
+  static const uint8_t h265_aud[] = {0x00, 0x00, 0x00, 0x01, 0x46, 0x01, 0x50};
+  if (hevc_) {
+    pes.insert(pes.end(), h265_aud, h265_aud + sizeof(h265_aud));
+  } else {
+    pes.insert(pes.end(), h264_aud, h264_aud + sizeof(h264_aud));
+  }
+  for (const auto &nalu : packet.nalus) {
+    static const uint8_t start_code[] = {0x00, 0x00, 0x00, 0x01};
+    pes.insert(pes.end(), start_code, start_code + sizeof(start_code));
+    pes.insert(pes.end(), nalu.data, nalu.data + nalu.size);
+  }
+
+  int64_t pcr = packet.dts;
+  size_t offset = 0;
+  bool first = true;
+  while (offset < pes.size()) {
+    offset += WriteTsPacket(kVideoPid, first, &video_cc_, first && packet.key, first ? &pcr : nullptr,
+                            pes.data() + offset, pes.size() - offset, out);
+    first = false;
+  }
+}
+
+// ------------------------------------------------------------------------------------------------------------------
+// Fragmented MP4
+
+namespace {
+
+class BoxWriter {
+ public:
+  explicit BoxWriter(std::vector<uint8_t> *out) : out_(out) {}
+  void U8(uint8_t v) { out_->push_back(v); }
+  void U16(uint16_t v) {
+    U8(v >> 8);
+    U8(v & 0xFF);
+  }
+  void U24(uint32_t v) {
+    U8((v >> 16) & 0xFF);
+    U16(v & 0xFFFF);
+  }
+  void U32(uint32_t v) {
+    U16(v >> 16);
+    U16(v & 0xFFFF);
+  }
+  void U64(uint64_t v) {
+    U32(static_cast<uint32_t>(v >> 32));
+    U32(static_cast<uint32_t>(v));
+  }
+  void Zeros(size_t n) { out_->insert(out_->end(), n, 0); }
+  void Bytes(const uint8_t *data, size_t n) { out_->insert(out_->end(), data, data + n); }
+  void Tag(const char *tag) { Bytes(reinterpret_cast<const uint8_t *>(tag), 4); }
+  size_t Begin(const char *type) {
+    size_t pos = out_->size();
+    U32(0);
+    Tag(type);
+    return pos;
+  }
+  size_t BeginFull(const char *type, uint8_t version, uint32_t flags) {
+    size_t pos = Begin(type);
+    U8(version);
+    U24(flags);
+    return pos;
+  }
+  void End(size_t pos) { Patch32(pos, static_cast<uint32_t>(out_->size() - pos)); }
+  void Patch32(size_t pos, uint32_t v) {
+    (*out_)[pos] = v >> 24;
+    (*out_)[pos + 1] = (v >> 16) & 0xFF;
+    (*out_)[pos + 2] = (v >> 8) & 0xFF;
+    (*out_)[pos + 3] = v & 0xFF;
+  }
+  size_t Size() const { return out_->size(); }
+  void Matrix() {
+    const uint32_t matrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+    for (auto v : matrix) U32(v);
+  }
+
+ private:
+  std::vector<uint8_t> *out_;
+};
+
+}  // namespace
+
+void Fmp4Format::WriteSampleEntry(const ParamSets &param_sets, std::vector<uint8_t> *out) {
+  BoxWriter w(out);
+  // parameter sets may also be carried in band
+  size_t entry = w.Begin(hevc_ ? "hev1" : "avc3");
+  w.Zeros(6);
+  w.U16(1);  // data reference index
+  w.Zeros(16);
+  w.U16(width_);
+  w.U16(height_);
+  w.U32(0x00480000);
+  w.U32(0x00480000);
+  w.U32(0);
+  w.U16(1);  // frame count
+  w.Zeros(32);
+  w.U16(0x0018);
+  w.U16(0xFFFF);
+
+  if (!hevc_) {
+    const std::vector<uint8_t> &sps = param_sets.sps.front();
+    size_t avcc = w.Begin("avcC");
+    w.U8(1);
+    w.U8(sps.size() > 1 ? sps[1] : 0);  // profile
+    w.U8(sps.size() > 2 ? sps[2] : 0);  // compatibility
+    w.U8(sps.size() > 3 ? sps[3] : 0);  // level
+    w.U8(0xFF);                          // 4 bytes NAL length
+    w.U8(0xE0 | static_cast<uint8_t>(param_sets.sps.size()));
+    for (const auto &it : param_sets.sps) {
+      w.U16(it.size());
+      w.Bytes(it.data(), it.size());
+    }
+    w.U8(static_cast<uint8_t>(param_sets.pps.size()));
+    for (const auto &it : param_sets.pps) {
+      w.U16(it.size());
+      w.Bytes(it.data(), it.size());
+    }
+    w.End(avcc);
+  } else {
+    // general profile, tier and level are at a fixed position of SPS
+    std::vector<uint8_t> sps = ToRbsp(param_sets.sps.front().data(), param_sets.sps.front().size());
+    uint8_t ptl[12] = {0};
+    if (sps.size() >= 15) memcpy(ptl, sps.data() + 3, sizeof(ptl));
+    size_t hvcc = w.Begin("hvcC");
+    w.U8(1);
+    w.Bytes(ptl, 1);       // profile space, tier, profile idc
+    w.Bytes(ptl + 1, 4);   // profile compatibility flags
+    w.Bytes(ptl + 5, 6);   // constraint indicator flags
+    w.U8(ptl[11]);         // level idc
+    w.U16(0xF000);         // min spatial segmentation
+    w.U8(0xFC);            // parallelism type
+    w.U8(0xFD);            // chroma format 4:2:0
+    w.U8(0xF8);            // luma bit depth 8
+    w.U8(0xF8);            // chroma bit depth 8
+    w.U16(0);              // average frame rate
+    w.U8(0x0F);            // 4 bytes NAL length
+    w.U8(3);
+    const std::vector<std::vector<uint8_t>> *arrays[] = {&param_sets.vps, &param_sets.sps, &param_sets.pps};
+    const uint8_t types[] = {32, 33, 34};
+    for (int i = 0; i < 3; ++i) {
+      w.U8(0x80 | types[i]);
+      w.U16(arrays[i]->size());
+      for (const auto &it : *arrays[i]) {
+        w.U16(it.size());
+        w.Bytes(it.data(), it.size());
+      }
+    }
+    w.End(hvcc);
+  }
+  w.End(entry);
+}
+
+void Fmp4Format::WriteHeader(const ParamSets &param_sets, std::vector<uint8_t> *out) {
+  BoxWriter w(out);
+  size_t ftyp = w.Begin("ftyp");
+  w.Tag("isom");
+  w.U32(0x200);
+  w.Tag("isom");
+  w.Tag("iso6");
+  w.Tag("mp41");
+  w.End(ftyp);
+
+  size_t moov = w.Begin("moov");
+  size_t mvhd = w.BeginFull("mvhd", 0, 0);
+  w.U32(0);
+  w.U32(0);
+  w.U32(1000);  // timescale
+  w.U32(0);     // duration
+  w.U32(0x00010000);
+  w.U16(0x0100);
+  w.Zeros(10);
+  w.Matrix();
+  w.Zeros(24);
+  w.U32(2);  // next track id
+  w.End(mvhd);
+
+  size_t trak = w.Begin("trak");
+  size_t tkhd = w.BeginFull("tkhd", 0, 3);
+  w.U32(0);
+  w.U32(0);
+  w.U32(1);  // track id
+  w.U32(0);
+  w.U32(0);  // duration
+  w.Zeros(8);
+  w.U16(0);  // layer
+  w.U16(0);  // alternate group
+  w.U16(0);  // volume
+  w.U16(0);
+  w.Matrix();
+  w.U32(width_ << 16);
+  w.U32(height_ << 16);
+  w.End(tkhd);
+
+  size_t mdia = w.Begin("mdia");
+  size_t mdhd = w.BeginFull("mdhd", 0, 0);
+  w.U32(0);
+  w.U32(0);
+  w.U32(90000);  // timescale
+  w.U32(0);
+  w.U16(0x55C4);  // und
+  w.U16(0);
+  w.End(mdhd);
+  size_t hdlr = w.BeginFull("hdlr", 0, 0);
+  w.U32(0);
+  w.Tag("vide");
+  w.Zeros(12);
+  const char name[] = "VideoHandler";
+  w.Bytes(reinterpret_cast<const uint8_t *>(name), sizeof(name));
+  w.End(hdlr);
+
+  size_t minf = w.Begin("minf");
+  size_t vmhd = w.BeginFull("vmhd", 0, 1);
+  w.Zeros(8);
+  w.End(vmhd);
+  size_t dinf = w.Begin("dinf");
+  size_t dref = w.BeginFull("dref", 0, 0);
+  w.U32(1);
+  w.End(w.BeginFull("url ", 0, 1));
+  w.End(dref);
+  w.End(dinf);
+
+  size_t stbl = w.Begin("stbl");
+  size_t stsd = w.BeginFull("stsd", 0, 0);
+  w.U32(1);
+  WriteSampleEntry(param_sets, out);
+  w.End(stsd);
+  size_t stts = w.BeginFull("stts", 0, 0);
+  w.U32(0);
+  w.End(stts);
+  size_t stsc = w.BeginFull("stsc", 0, 0);
+  w.U32(0);
+  w.End(stsc);
+  size_t stsz = w.BeginFull("stsz", 0, 0);
+  w.U32(0);
+  w.U32(0);
+  w.End(stsz);
+  size_t stco = w.BeginFull("stco", 0, 0);
+  w.U32(0);
+  w.End(stco);
+  w.End(stbl);
+  w.End(minf);
+  w.End(mdia);
+  w.End(trak);
+
+  size_t mvex = w.Begin("mvex");
+  size_t trex = w.BeginFull("trex", 0, 0);
+  w.U32(1);  // track id
+  w.U32(1);  // sample description index
+  w.U32(0);
+  w.U32(0);
+  w.U32(0);
+  w.End(trex);
+  w.End(mvex);
+  w.End(moov);
+}
+
+void Fmp4Format::WritePacket(const MuxPacket &packet, std::vector<uint8_t> *out) {
+  // one fragment per GOP, bounded in size
+  constexpr size_t kMaxFragmentSize = 8 << 20;
+  if (!samples_.empty() && (packet.key || sample_data_.size() > kMaxFragmentSize)) {
+    Flush(packet.dts, out);
+  }
+  Sample sample;
+  sample.dts = packet.dts;
+  sample.key = packet.key;
+  sample.offset = sample_data_.size();
+  BoxWriter w(&sample_data_);
+  for (const auto &nalu : packet.nalus) {
+    w.U32(static_cast<uint32_t>(nalu.size));
+    w.Bytes(nalu.data, nalu.size);
+  }
+  sample.size = sample_data_.size() - sample.offset;
+  samples_.push_back(sample);
+}
+
+void Fmp4Format::Flush(int64_t next_dts, std::vector<uint8_t> *out) {
+  if (samples_.empty()) return;
+  BoxWriter w(out);
+  size_t moof = w.Begin("moof");
+  size_t mfhd = w.BeginFull("mfhd", 0, 0);
+  w.U32(++sequence_);
+  w.End(mfhd);
+  size_t traf = w.Begin("traf");
+  size_t tfhd = w.BeginFull("tfhd", 0, 0x020000);  // default base is moof
+  w.U32(1);
+  w.End(tfhd);
+  size_t tfdt = w.BeginFull("tfdt", 1, 0);
+  w.U64(static_cast<uint64_t>(samples_.front().dts));
+  w.End(tfdt);
+  // data offset, sample duration, size and flags present
+  size_t trun = w.BeginFull("trun", 0, 0x000701);
+  w.U32(static_cast<uint32_t>(samples_.size()));
+  size_t data_offset_pos = w.Size();
+  w.U32(0);
+  for (size_t i = 0; i < samples_.size(); ++i) {
+    int64_t end = i + 1 < samples_.size() ? samples_[i + 1].dts : next_dts;
+    int64_t duration = end > samples_[i].dts ? end - samples_[i].dts : default_duration_;
+    w.U32(static_cast<uint32_t>(duration));
+    w.U32(static_cast<uint32_t>(samples_[i].size));
+    w.U32(samples_[i].key ? 0x02000000 : 0x01010000);
+  }
+  w.End(trun);
+  w.End(traf);
+  w.End(moof);
+  w.Patch32(data_offset_pos, static_cast<uint32_t>(w.Size() - moof + 8));
+
+  size_t mdat = w.Begin("mdat");
+  w.Bytes(sample_data_.data(), sample_data_.size());
+  w.End(mdat);
+  samples_.clear();
+  sample_data_.clear();
+}
+
+// ------------------------------------------------------------------------------------------------------------------
+// Muxer
+
+namespace {
+
+// Finds the integer conversion in path, returns false if it is not the only '%' in path
+bool FindIndexConversion(const std::string &path, size_t *begin, size_t *end, char *conversion) {
+  size_t pos = path.find('%');
+  if (pos == std::string::npos) return false;
+  size_t i = pos + 1;
+  while (i < path.size() && strchr("-+ #0", path[i])) ++i;
+  while (i < path.size() && isdigit(static_cast<unsigned char>(path[i]))) ++i;
+  if (i < path.size() && path[i] == '.') {
+    ++i;
+    while (i < path.size() && isdigit(static_cast<unsigned char>(path[i]))) ++i;
+  }
+  if (i >= path.size() || !strchr("diuoxX", path[i])) return false;
+  if (path.find('%', i + 1) != std::string::npos) return false;
+  *begin = pos;
+  *end = i + 1;
+  *conversion = path[i];
+  return true;
+}
+
+}  // namespace
+
+bool IsIndexedPath(const std::string &path) {
+  size_t begin, end;
+  char conversion;
+  return FindIndexConversion(path, &begin, &end, &conversion);
+}
+
+std::string IndexedPath(const std::string &path, uint32_t index) {
+  size_t begin, end;
+  char conversion;
+  if (!FindIndexConversion(path, &begin, &end, &conversion)) return path;
+  // only the validated conversion is used as format
+  std::string spec = path.substr(begin, end - begin);
+  char buf[64];
+  if (conversion == 'd' || conversion == 'i') {
+    snprintf(buf, sizeof(buf), spec.c_str(), static_cast<int>(index));
+  } else {
+    snprintf(buf, sizeof(buf), spec.c_str(), index);
+  }
+  return path.substr(0, begin) + buf + path.substr(end);
+}
+
+Muxer::Muxer(const CnedkMuxerCreateParams &params) : params_(params) {
+  if (params.file_path) file_path_ = params.file_path;
+  hevc_ = params.codec_type == CNEDK_VENC_TYPE_H265;
+  if (params.pts_timescale) timescale_ = params.pts_timescale;
+}
+
+Muxer::~Muxer() { Finish(); }
+
+int Muxer::Init() {
+  rotate_ = params_.segment_duration_ms || params_.segment_size;
+  if (rotate_ && !IsIndexedPath(file_path_)) {
+    LOG(ERROR) << "[EasyDK] [Muxer] Init(): File path must contain exactly one integer conversion and no other '%'"
+               << " when segment rotation is enabled: " << file_path_;
+    return -1;
+  }
+  int64_t default_duration = params_.frame_rate > 0 ? static_cast<int64_t>(90000 / params_.frame_rate) : 3600;
+  if (params_.format == CNEDK_MUXER_FORMAT_MPEGTS) {
+    format_.reset(new TsFormat(hevc_));
+  } else {
+    format_.reset(new Fmp4Format(hevc_, params_.width, params_.height, default_duration));
+  }
+  writer_.reset(new AsyncFileWriter(params_.max_buffer_size ? params_.max_buffer_size : 16 << 20));
+  return 0;
+}
+
+void Muxer::UpdateParamSets(const std::vector<NalUnit> &nalus) {
+  ParamSets param_sets;
+  for (const auto &nalu : nalus) {
+    if (!IsParamSetNal(nalu, hevc_)) continue;
+    int type = GetNalType(nalu, hevc_);
+    std::vector<uint8_t> data(nalu.data, nalu.data + nalu.size);
+    if (type == 32) {
+      param_sets.vps.emplace_back(std::move(data));
+    } else if (type == 7 || type == 33) {
+      param_sets.sps.emplace_back(std::move(data));
+    } else {
+      param_sets.pps.emplace_back(std::move(data));
+    }
+  }
+  if (!param_sets.sps.empty()) param_sets_.sps = std::move(param_sets.sps);
+  if (!param_sets.pps.empty()) param_sets_.pps = std::move(param_sets.pps);
+  if (!param_sets.vps.empty()) param_sets_.vps = std::move(param_sets.vps);
+}
+
+void Muxer::Output(std::vector<uint8_t> *data) {
+  segment_bytes_ += data->size();
+  writer_->Write(std::move(*data));
+  data->clear();
+}
+
+void Muxer::StartSegment() {
+  // path is used as it is if segments are not rotated
+  writer_->Open(rotate_ ? IndexedPath(file_path_, segment_index_++) : file_path_);
+  segment_bytes_ = 0;
+  format_->WriteHeader(param_sets_, &out_);
+  Output(&out_);
+}
+
+void Muxer::EndSegment(int64_t next_dts) {
+  format_->Flush(next_dts, &out_);
+  Output(&out_);
+  writer_->Close();
+}
+
+int Muxer::Write(const CnedkVEncFrameBits &frame_bits) {
+  if (finished_) {
+    LOG(ERROR) << "[EasyDK] [Muxer] Write(): Muxer is finished";
+    return -1;
+  }
+  if (writer_->Failed()) {
+    LOG(ERROR) << "[EasyDK] [Muxer] Write(): Write file failed";
+    return -1;
+  }
+  if (!frame_bits.bits || frame_bits.len <= 0) return 0;
+
+  std::vector<NalUnit> nalus;
+  SplitAnnexB(frame_bits.bits, frame_bits.len, &nalus);
+  UpdateParamSets(nalus);
+  if (frame_bits.pkt_type == CNEDK_VENC_PACKAGE_TYPE_SPS_PPS || frame_bits.pkt_type == CNEDK_VENC_PACKAGE_TYPE_SPS ||
+      frame_bits.pkt_type == CNEDK_VENC_PACKAGE_TYPE_PPS) {
+    return 0;
+  }
+
+  MuxPacket packet;
+  packet.key = frame_bits.pkt_type == CNEDK_VENC_PACKAGE_TYPE_KEY_FRAME;
+  bool has_param_sets = false;
+  for (const auto &nalu : nalus) {
+    if (IsKeyNal(nalu, hevc_)) packet.key = true;
+    if (IsParamSetNal(nalu, hevc_)) has_param_sets = true;
+  }
+  if (!started_) {
+    if (!packet.key) return 0;
+    if (!param_sets_.Ready(hevc_)) {
+      LOG(WARNING) << "[EasyDK] [Muxer] Write(): Parameter sets are not received, drop key frame";
+      return 0;
+    }
+  }
+  // key frames always carry parameter sets, so that each segment is decodable on its own
+  if (packet.key && !has_param_sets) {
+    for (const auto *sets : {&param_sets_.vps, &param_sets_.sps, &param_sets_.pps}) {
+      for (const auto &it : *sets) packet.nalus.push_back({it.data(), it.size()});
+    }
+  }
+  for (const auto &nalu : nalus) {
+    if (!IsAudNal(nalu, hevc_)) packet.nalus.push_back(nalu);
+  }
+
+  uint64_t pts = frame_bits.pts;
+  packet.dts = static_cast<int64_t>(pts / timescale_ * 90000 + pts % timescale_ * 90000 / timescale_);
+
+  if (!started_) {
+    started_ = true;
+    segment_start_dts_ = packet.dts;
+    StartSegment();
+  } else if (packet.key) {
+    bool rotate = (params_.segment_duration_ms &&
+                   packet.dts - segment_start_dts_ >= static_cast<int64_t>(params_.segment_duration_ms) * 90) ||
+                  (params_.segment_size && segment_bytes_ >= params_.segment_size);
+    if (rotate) {
+      EndSegment(packet.dts);
+      segment_start_dts_ = packet.dts;
+      StartSegment();
+    }
+  }
+
+  format_->WritePacket(packet, &out_);
+  Output(&out_);
+  return 0;
+}
+
+int Muxer::Finish() {
+  if (finished_) return 0;
+  finished_ = true;
+  if (!writer_) return 0;
+  if (started_) EndSegment(-1);
+  writer_->Stop();
+  return writer_->Failed() ? -1 : 0;
+}
+
+}  // namespace cnedk
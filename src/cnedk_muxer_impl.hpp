@@ -0,0 +1,176 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_MUXER_IMPL_HPP_
+#define CNEDK_MUXER_IMPL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnedk_muxer.h"
+#include "common/bitstream_parser.hpp"
+
+namespace cnedk {
+
+// Parameter sets of stream, each one includes NAL header
+struct ParamSets {
+  std::vector<std::vector<uint8_t>> vps;
+  std::vector<std::vector<uint8_t>> sps;
+  std::vector<std::vector<uint8_t>> pps;
+  bool Ready(bool hevc) const { return !sps.empty() && !pps.empty() && (!hevc || !vps.empty()); }
+};
+
+// Returns true if the path contains exactly one printf-style integer conversion (e.g. "%04d") and no other '%'
+bool IsIndexedPath(const std::string &path);
+// Replaces the integer conversion of a path accepted by IsIndexedPath with the index
+std::string IndexedPath(const std::string &path, uint32_t index);
+
+struct MuxPacket {
+  std::vector<NalUnit> nalus;  // access unit without AUD
+  int64_t dts;                 // 90kHz, equals to pts since there are no B-frames from encoder
+  bool key;
+};
+
+/**
+ * Writes data to files in a background thread. The size of data waiting to be written is bounded.
+ */
+class AsyncFileWriter {
+ public:
+  explicit AsyncFileWriter(size_t max_buffer_size);
+  ~AsyncFileWriter();
+  void Open(const std::string &path);
+  // blocks if the buffer is full
+  void Write(std::vector<uint8_t> &&data);
+  void Close();
+  // writes all data and stops the thread
+  void Stop();
+  bool Failed() const { return failed_.load(); }
+
+ private:
+  struct Task {
+    enum Type { OPEN, DATA, CLOSE } type;
+    std::string path;
+    std::vector<uint8_t> data;
+  };
+  void Push(Task &&task);
+  void Loop();
+
+  size_t max_buffer_size_;
+  size_t buffered_size_ = 0;
+  std::deque<Task> tasks_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  bool stop_ = false;
+  std::atomic<bool> failed_{false};
+  FILE *file_ = nullptr;
+  std::thread thread_;
+};  // class AsyncFileWriter
+
+class MuxFormat {
+ public:
+  virtual ~MuxFormat() = default;
+  // Writes header at the beginning of a segment
+  virtual void WriteHeader(const ParamSets &param_sets, std::vector<uint8_t> *out) = 0;
+  virtual void WritePacket(const MuxPacket &packet, std::vector<uint8_t> *out) = 0;
+  // Writes buffered packets, `next_dts` is dts of the next packet, or -1 at the end of stream
+  virtual void Flush(int64_t next_dts, std::vector<uint8_t> *out) {}
+};
+
+class TsFormat : public MuxFormat {
+ public:
+  explicit TsFormat(bool hevc) : hevc_(hevc) {}
+  void WriteHeader(const ParamSets &param_sets, std::vector<uint8_t> *out) override;
+  void WritePacket(const MuxPacket &packet, std::vector<uint8_t> *out) override;
+
+ private:
+  void WriteTables(std::vector<uint8_t> *out);
+  void WriteSection(uint16_t pid, const std::vector<uint8_t> &section, std::vector<uint8_t> *out);
+  bool hevc_;
+  uint8_t pat_cc_ = 0;
+  uint8_t pmt_cc_ = 0;
+  uint8_t video_cc_ = 0;
+};  // class TsFormat
+
+class Fmp4Format : public MuxFormat {
+ public:
+  Fmp4Format(bool hevc, uint32_t width, uint32_t height, int64_t default_duration)
+      : hevc_(hevc), width_(width), height_(height), default_duration_(default_duration) {}
+  void WriteHeader(const ParamSets &param_sets, std::vector<uint8_t> *out) override;
+  void WritePacket(const MuxPacket &packet, std::vector<uint8_t> *out) override;
+  void Flush(int64_t next_dts, std::vector<uint8_t> *out) override;
+
+ private:
+  struct Sample {
+    int64_t dts;
+    bool key;
+    size_t offset;
+    size_t size;
+  };
+  void WriteSampleEntry(const ParamSets &param_sets, std::vector<uint8_t> *out);
+  bool hevc_;
+  uint32_t width_;
+  uint32_t height_;
+  int64_t default_duration_;
+  uint32_t sequence_ = 0;
+  std::vector<Sample> samples_;
+  std::vector<uint8_t> sample_data_;
+};  // class Fmp4Format
+
+class Muxer {
+ public:
+  explicit Muxer(const CnedkMuxerCreateParams &params);
+  ~Muxer();
+  int Init();
+  int Write(const CnedkVEncFrameBits &frame_bits);
+  int Finish();
+
+ private:
+  void StartSegment();
+  void EndSegment(int64_t next_dts);
+  void Output(std::vector<uint8_t> *data);
+  void UpdateParamSets(const std::vector<NalUnit> &nalus);
+
+  CnedkMuxerCreateParams params_;
+  std::string file_path_;
+  bool hevc_ = false;
+  uint32_t timescale_ = 90000;
+  std::unique_ptr<MuxFormat> format_;
+  std::unique_ptr<AsyncFileWriter> writer_;
+  ParamSets param_sets_;
+  std::vector<uint8_t> out_;
+  bool started_ = false;
+  bool finished_ = false;
+  bool rotate_ = false;
+  uint32_t segment_index_ = 0;
+  int64_t segment_start_dts_ = 0;
+  uint64_t segment_bytes_ = 0;
+};  // class Muxer
+
+}  // namespace cnedk
+
+#endif  // CNEDK_MUXER_IMPL_HPP_
@@ -20,10 +20,19 @@
 
 #include "cnedk_platform.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 #include <cstring>  // for memset
-#include <map>
+#include <fstream>
+#include <iterator>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "glog/logging.h"
 #include "cnrt.h"
@@ -31,69 +40,263 @@
 #ifdef PLATFORM_CE3226
 #include "ce3226/mps_service/mps_service.hpp"
 #endif
+#include "cnedk_platform_caps.hpp"
 #include "common/utils.hpp"
 
 namespace cnedk {
 
-struct DeviceInfo {
-  std::string prop_name;
-  bool support_unified_addr;
-  bool can_map_host_memory;
-};
+bool DeviceCaps::SupportMemType(CnedkBufSurfaceMemType type) const {
+  if (type == CNEDK_BUF_MEM_DEFAULT) return true;
+  return std::find(mem_types.begin(), mem_types.end(), type) != mem_types.end();
+}
 
-static std::mutex gDeviceInfoMutex;
-static std::map<int, DeviceInfo> gDeviceInfoMap;
+DeviceCaps DeviceCaps::Make(int device_id, const std::string &name, bool support_unified_addr,
+                            bool can_map_host_memory) {
+  DeviceCaps caps;
+  caps.device_id = device_id;
+  caps.name = name;
+  caps.support_unified_addr = support_unified_addr;
+  caps.can_map_host_memory = can_map_host_memory;
+  // At this moment, CExxxx == supportUnified, MLUxxx == not supportUnified
+  if (support_unified_addr) {
+    caps.mem_types = {CNEDK_BUF_MEM_DEVICE, CNEDK_BUF_MEM_UNIFIED, CNEDK_BUF_MEM_UNIFIED_CACHED,
+                      CNEDK_BUF_MEM_VB, CNEDK_BUF_MEM_VB_CACHED};
+  } else {
+    caps.mem_types = {CNEDK_BUF_MEM_DEVICE};
+    if (can_map_host_memory) caps.mem_types.push_back(CNEDK_BUF_MEM_PINNED);
+  }
+  caps.mem_types.push_back(CNEDK_BUF_MEM_SYSTEM);
 
-static int GetDeviceInfo(int device_id, DeviceInfo *info) {
-  std::unique_lock<std::mutex> lk(gDeviceInfoMutex);
-  if (gDeviceInfoMap.count(device_id)) {
-    *info = gDeviceInfoMap[device_id];
-    return 0;
+  if (IsEdgePlatform(name)) {
+    // the number of vdec and venc channels of mps service
+    caps.decode.max_instances = 16;
+    caps.encode.max_instances = 16;
+  } else if (IsCloudPlatform(name)) {
+    caps.decode.max_width = 7680;
+    caps.decode.max_height = 4320;
   }
-  unsigned int count;
-  CNRT_SAFECALL(cnrtGetDeviceCount(&count), "GetDeviceInfo(): failed", -1);
+  return caps;
+}
 
-  if (device_id >= static_cast<int>(count) || device_id < 0) {
-    LOG(ERROR) << "[EasyDK] GetDeviceInfo(): device id is invalid, device_id: " << device_id << ", total count: "
-               << count;
-    return -1;
+namespace {
+
+std::string ReadLine(const std::string &path) {
+  std::ifstream ifs(path);
+  std::string line;
+  if (ifs) std::getline(ifs, line);
+  return line;
+}
+
+// parses the cpu list format of sysfs, e.g. "0-3,8-11"
+std::vector<int> ParseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  size_t pos = 0;
+  while (pos < list.size()) {
+    size_t comma = list.find(',', pos);
+    if (comma == std::string::npos) comma = list.size();
+    std::string range = list.substr(pos, comma - pos);
+    pos = comma + 1;
+    if (range.empty() || !std::isdigit(static_cast<unsigned char>(range[0]))) continue;
+    size_t dash = range.find('-');
+    int first = std::atoi(range.c_str());
+    int last = dash == std::string::npos ? first : std::atoi(range.c_str() + dash + 1);
+    for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
   }
-  cnrtSetDevice(device_id);
+  return cpus;
+}
 
-  DeviceInfo dev_info;
-  cnrtDeviceProp_t prop;
-  CNRT_SAFECALL(cnrtGetDeviceProperties(&prop, device_id), "GetDeviceInfo(): failed", -1);
+CpuTopology ReadCpuTopology() {
+  CpuTopology topology;
+  std::vector<int> online = ParseCpuList(ReadLine("/sys/devices/system/cpu/online"));
+  if (online.empty()) {
+    int count = std::max(1u, std::thread::hardware_concurrency());
+    for (int cpu = 0; cpu < count; ++cpu) online.push_back(cpu);
+  }
+  topology.logical_cores = online.size();
 
-  VLOG(2) << "[EasyDK] GetDeviceInfo(): device id: " << device_id << ", device name: " << prop.name;
-  dev_info.prop_name = prop.name;
+  std::set<std::pair<std::string, std::string>> cores;
+  for (int cpu : online) {
+    std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+    std::string core_id = ReadLine(dir + "core_id");
+    if (core_id.empty()) break;
+    cores.emplace(ReadLine(dir + "physical_package_id"), core_id);
+  }
+  topology.physical_cores = cores.empty() ? topology.logical_cores : cores.size();
+
+  std::vector<int> nodes = ParseCpuList(ReadLine("/sys/devices/system/node/online"));
+  for (int id : nodes) {
+    NumaNode node;
+    node.id = id;
+    std::vector<int> cpus = ParseCpuList(ReadLine("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist"));
+    std::set_intersection(cpus.begin(), cpus.end(), online.begin(), online.end(), std::back_inserter(node.cpus));
+    topology.numa_nodes.push_back(std::move(node));
+  }
+  if (topology.numa_nodes.empty()) {
+    NumaNode node;
+    node.cpus = online;
+    topology.numa_nodes.push_back(std::move(node));
+  }
+  return topology;
+}
+
+int ReadDeviceNumaNode(int device_id) {
+#if defined(PLATFORM_MLU370) || defined(PLATFORM_MLU590)
+  char bus_id[64] = {0};
+  if (cnrtDeviceGetPCIBusId(bus_id, sizeof(bus_id), device_id) != cnrtSuccess) return -1;
+  std::string path(bus_id);
+  std::transform(path.begin(), path.end(), path.begin(), [](unsigned char c) { return std::tolower(c); });
+  std::string node = ReadLine("/sys/bus/pci/devices/" + path + "/numa_node");
+  if (node.empty()) return -1;
+  return std::max(-1, std::atoi(node.c_str()));
+#else
+  return -1;
+#endif
+}
+
+int ProbeDevice(int device_id, DeviceCaps *caps) {
+  cnrtDeviceProp_t prop;
+  CNRT_SAFECALL(cnrtGetDeviceProperties(&prop, device_id), "ProbeDevice(): failed", -1);
+  VLOG(2) << "[EasyDK] ProbeDevice(): device id: " << device_id << ", device name: " << prop.name;
+  std::string name = prop.name;
+  bool support_unified_addr = false;
+  bool can_map_host_memory = false;
 
 #ifdef PLATFORM_CE3226
 #if LIBMPS_VERSION_INT < MPS_VERSION_1_1_0
+  CNRT_SAFECALL(cnrtSetDevice(device_id), "ProbeDevice(): failed", -1);
   int value;
-  CNRT_SAFECALL(cnrtDeviceGetAttribute(&value, cnrtAttrSupportUnifiedAddr, device_id),
-                "GetDeviceInfo(): failed", -1);
-
-  dev_info.support_unified_addr = (value != 0);
+  CNRT_SAFECALL(cnrtDeviceGetAttribute(&value, cnrtAttrSupportUnifiedAddr, device_id), "ProbeDevice(): failed", -1);
+  support_unified_addr = (value != 0);
 
-  CNRT_SAFECALL(cnrtDeviceGetAttribute(&value, cnrtAttrCanMapHostMemory, device_id),
-                "GetDeviceInfo(): failed", -1);
-  dev_info.can_map_host_memory = (value != 0);
+  CNRT_SAFECALL(cnrtDeviceGetAttribute(&value, cnrtAttrCanMapHostMemory, device_id), "ProbeDevice(): failed", -1);
+  can_map_host_memory = (value != 0);
 #else
-  dev_info.can_map_host_memory = true;
+  can_map_host_memory = true;
 #endif
-#else
-  dev_info.support_unified_addr = false;
-  dev_info.can_map_host_memory = false;
 #endif
 
   // FIXME, cnrtDeviceGetAttribute(cnrtAttrSupportUnifiedAddr) does not work
-  if (dev_info.prop_name == "CE3226") dev_info.support_unified_addr = 1;
+  if (name == "CE3226") support_unified_addr = true;
 
-  *info = dev_info;
-  gDeviceInfoMap[device_id] = dev_info;
+  *caps = DeviceCaps::Make(device_id, name, support_unified_addr, can_map_host_memory);
+  caps->numa_node = ReadDeviceNumaNode(device_id);
   return 0;
 }
 
+}  // namespace
+
+struct PlatformCaps::Table {
+  std::vector<DeviceCaps> devices;
+  std::vector<CnedkPlatformInfo> infos;
+  CpuTopology topology;
+
+  Table(const std::vector<DeviceCaps> &_devices, const CpuTopology &_topology)
+      : devices(_devices), topology(_topology) {
+    for (const DeviceCaps &caps : devices) {
+      CnedkPlatformInfo info;
+      memset(&info, 0, sizeof(info));
+      snprintf(info.name, sizeof(info.name), "%s", caps.name.c_str());
+      info.support_unified_addr = caps.support_unified_addr;
+      info.can_map_host_memory = caps.can_map_host_memory;
+      infos.push_back(info);
+    }
+  }
+};
+
+PlatformCaps::~PlatformCaps() = default;
+
+PlatformCaps &PlatformCaps::Instance() {
+  static PlatformCaps instance;
+  return instance;
+}
+
+void PlatformCaps::Publish(std::unique_ptr<Table> table) {
+  table_.store(table.get(), std::memory_order_release);
+  tables_.push_back(std::move(table));
+}
+
+const PlatformCaps::Table *PlatformCaps::Load() {
+  const Table *table = table_.load(std::memory_order_acquire);
+  if (table) return table;
+
+  std::unique_lock<std::mutex> lk(mutex_);
+  table = table_.load(std::memory_order_acquire);
+  if (table) return table;
+
+  unsigned int count;
+  CNRT_SAFECALL(cnrtGetDeviceCount(&count), "[PlatformCaps] Load(): failed", nullptr);
+  int current_dev = -1;
+  if (cnrtGetDevice(&current_dev) != cnrtSuccess) current_dev = -1;
+  std::vector<DeviceCaps> devices(count);
+  int ret = 0;
+  for (unsigned int i = 0; i < count && ret == 0; ++i) {
+    ret = ProbeDevice(i, &devices[i]);
+  }
+  if (current_dev >= 0) cnrtSetDevice(current_dev);
+  if (ret < 0) {
+    LOG(ERROR) << "[EasyDK] [PlatformCaps] Load(): Probe devices failed";
+    return nullptr;
+  }
+
+  Publish(std::unique_ptr<Table>(new Table(devices, ReadCpuTopology())));
+  return table_.load(std::memory_order_relaxed);
+}
+
+int PlatformCaps::DeviceCount() {
+  const Table *table = Load();
+  return table ? static_cast<int>(table->devices.size()) : -1;
+}
+
+static bool CheckDeviceId(const std::vector<DeviceCaps> &devices, int device_id) {
+  if (device_id < 0 || device_id >= static_cast<int>(devices.size())) {
+    LOG(ERROR) << "[EasyDK] [PlatformCaps] device id is invalid, device_id: " << device_id
+               << ", total count: " << devices.size();
+    return false;
+  }
+  return true;
+}
+
+const DeviceCaps *PlatformCaps::GetDevice(int device_id) {
+  const Table *table = Load();
+  if (!table || !CheckDeviceId(table->devices, device_id)) return nullptr;
+  return &table->devices[device_id];
+}
+
+bool PlatformCaps::GetInfo(int device_id, CnedkPlatformInfo *info) {
+  const Table *table = Load();
+  if (!table || !CheckDeviceId(table->devices, device_id)) return false;
+  *info = table->infos[device_id];
+  return true;
+}
+
+CpuTopology PlatformCaps::Topology() {
+  const Table *table = Load();
+  return table ? table->topology : ReadCpuTopology();
+}
+
+std::vector<int> PlatformCaps::DeviceCpus(int device_id) {
+  const Table *table = Load();
+  CpuTopology topology = table ? table->topology : ReadCpuTopology();
+  int numa_node = table && CheckDeviceId(table->devices, device_id) ? table->devices[device_id].numa_node : -1;
+  std::vector<int> cpus;
+  for (const NumaNode &node : topology.numa_nodes) {
+    if (numa_node >= 0 && node.id == numa_node) return node.cpus;
+    cpus.insert(cpus.end(), node.cpus.begin(), node.cpus.end());
+  }
+  std::sort(cpus.begin(), cpus.end());
+  return cpus;
+}
+
+void PlatformCaps::Inject(const std::vector<DeviceCaps> &devices, const CpuTopology &topology) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  Publish(std::unique_ptr<Table>(new Table(devices, topology)));
+}
+
+void PlatformCaps::Reset() {
+  std::unique_lock<std::mutex> lk(mutex_);
+  table_.store(nullptr, std::memory_order_release);
+}
+
 #ifdef PLATFORM_CE3226
 int PlatformInitCe3226(CnedkPlatformConfig *config) {
   MpsServiceConfig mps_config;
@@ -136,26 +339,16 @@ extern "C" {
 
 int CnedkPlatformInit(CnedkPlatformConfig *config) {
   // TODO(gaoyujia)
-  unsigned int count;
-  CNRT_SAFECALL(cnrtGetDeviceCount(&count), "CnedkPlatformInit(): failed", -1);
-
-  for (int i = 0; i < static_cast<int>(count); i++) {
-    cnedk::DeviceInfo dev_info;
-    if (cnedk::GetDeviceInfo(i, &dev_info) < 0) {
-      LOG(ERROR) << "[EasyDK] CnedkPlatformInit(): Get device information failed";
-      return -1;
-    }
+  int count = cnedk::PlatformCaps::Instance().DeviceCount();
+  if (count < 0) {
+    LOG(ERROR) << "[EasyDK] CnedkPlatformInit(): Get device information failed";
+    return -1;
   }
 
 #ifdef PLATFORM_CE3226
   // FIXME
-  if (count == 1) {
-    cnedk::DeviceInfo dev_info;
-    cnedk::GetDeviceInfo(0, &dev_info);
-
-    if (dev_info.prop_name == "CE3226") {
-      return cnedk::PlatformInitCe3226(config);
-    }
+  if (count == 1 && cnedk::PlatformCaps::Instance().GetDevice(0)->name == "CE3226") {
+    return cnedk::PlatformInitCe3226(config);
   }
 #endif
 
@@ -173,15 +366,7 @@ int CnedkPlatformUninit() {
 }
 
 int CnedkPlatformGetInfo(int device_id, CnedkPlatformInfo *info) {
-  cnedk::DeviceInfo dev_info;
-  if (cnedk::GetDeviceInfo(device_id, &dev_info) < 0) {
-    return -1;
-  }
-  memset(info, 0, sizeof(CnedkPlatformInfo));
-  snprintf(info->name, sizeof(info->name), "%s", dev_info.prop_name.c_str());
-  info->can_map_host_memory = (dev_info.can_map_host_memory == true);
-  info->support_unified_addr = (dev_info.support_unified_addr == true);
-  return 0;
+  return cnedk::PlatformCaps::Instance().GetInfo(device_id, info) ? 0 : -1;
 }
 
 #ifdef __cplusplus
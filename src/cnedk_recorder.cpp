@@ -0,0 +1,141 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnedk_recorder.h"
+
+#include <memory>   // for unique_ptr
+#include <mutex>    // for call_once
+
+#include "glog/logging.h"
+
+#include "cnedk_recorder_impl.hpp"
+
+namespace cnedk {
+
+class RecorderService {
+ public:
+  static RecorderService &Instance() {
+    static std::once_flag s_flag;
+    std::call_once(s_flag, [&] { instance_.reset(new RecorderService); });
+    return *instance_;
+  }
+
+  int Create(void **recorder, CnedkRecorderCreateParams *params) {
+    if (!recorder || !params) {
+      LOG(ERROR) << "[EasyDK] [RecorderService] Create(): recorder or params pointer is invalid";
+      return -1;
+    }
+    if (CheckParams(params) < 0) {
+      LOG(ERROR) << "[EasyDK] [RecorderService] Create(): Parameters are invalid";
+      return -1;
+    }
+    *recorder = new Recorder(*params);
+    return 0;
+  }
+
+  int Destroy(void *recorder) {
+    if (!recorder) {
+      LOG(ERROR) << "[EasyDK] [RecorderService] Destroy(): Recorder pointer is invalid";
+      return -1;
+    }
+    Recorder *recorder_ = static_cast<Recorder *>(recorder);
+    int ret = recorder_->Finish();
+    delete recorder_;
+    return ret;
+  }
+
+  int Write(void *recorder, CnedkVEncFrameBits *framebits) {
+    if (!recorder || !framebits) {
+      LOG(ERROR) << "[EasyDK] [RecorderService] Write(): Recorder or framebits pointer is invalid";
+      return -1;
+    }
+    return static_cast<Recorder *>(recorder)->Write(*framebits);
+  }
+
+  int Trigger(void *recorder) {
+    if (!recorder) {
+      LOG(ERROR) << "[EasyDK] [RecorderService] Trigger(): Recorder pointer is invalid";
+      return -1;
+    }
+    return static_cast<Recorder *>(recorder)->Trigger();
+  }
+
+ private:
+  int CheckParams(CnedkRecorderCreateParams *params) {
+    CnedkMuxerCreateParams *muxer_params = &params->muxer_params;
+    if (muxer_params->format <= CNEDK_MUXER_FORMAT_INVALID || muxer_params->format >= CNEDK_MUXER_FORMAT_NUM) {
+      LOG(ERROR) << "[EasyDK] [RecorderService] CheckParams(): Unsupported format: " << muxer_params->format;
+      return -1;
+    }
+    if (muxer_params->codec_type != CNEDK_VENC_TYPE_H264 && muxer_params->codec_type != CNEDK_VENC_TYPE_H265) {
+      LOG(ERROR) << "[EasyDK] [RecorderService] CheckParams(): Unsupported codec type: " << muxer_params->codec_type;
+      return -1;
+    }
+    if (muxer_params->width == 0 || muxer_params->height == 0) {
+      LOG(ERROR) << "[EasyDK] [RecorderService] CheckParams(): Invalid resolution: " << muxer_params->width << "x"
+                 << muxer_params->height;
+      return -1;
+    }
+    if (!muxer_params->file_path || !IsIndexedPath(muxer_params->file_path)) {
+      LOG(ERROR) << "[EasyDK] [RecorderService] CheckParams(): File path must contain exactly one clip index"
+                 << " conversion and no other '%'";
+      return -1;
+    }
+    return 0;
+  }
+
+ private:
+  RecorderService(const RecorderService &) = delete;
+  RecorderService(RecorderService &&) = delete;
+  RecorderService &operator=(const RecorderService &) = delete;
+  RecorderService &operator=(RecorderService &&) = delete;
+  RecorderService() = default;
+
+ private:
+  static std::unique_ptr<RecorderService> instance_;
+};
+
+std::unique_ptr<RecorderService> RecorderService::instance_;
+
+}  // namespace cnedk
+
+extern "C" {
+
+int CnedkRecorderCreate(void **recorder, CnedkRecorderCreateParams *params) {
+  return cnedk::RecorderService::Instance().Create(recorder, params);
+}
+int CnedkRecorderDestroy(void *recorder) { return cnedk::RecorderService::Instance().Destroy(recorder); }
+int CnedkRecorderWrite(void *recorder, CnedkVEncFrameBits *framebits) {
+  return cnedk::RecorderService::Instance().Write(recorder, framebits);
+}
+int CnedkRecorderTrigger(void *recorder) { return cnedk::RecorderService::Instance().Trigger(recorder); }
+int CnedkRecorderSetMemoryLimit(uint64_t limit) {
+  cnedk::RecorderBudget::Instance().SetLimit(limit);
+  return 0;
+}
+int CnedkRecorderGetMemoryUsage(uint64_t *usage) {
+  if (!usage) {
+    LOG(ERROR) << "[EasyDK] CnedkRecorderGetMemoryUsage(): usage pointer is invalid";
+    return -1;
+  }
+  *usage = cnedk::RecorderBudget::Instance().Usage();
+  return 0;
+}
+};
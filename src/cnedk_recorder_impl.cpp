@@ -0,0 +1,232 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnedk_recorder_impl.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace cnedk {
+
+bool RecorderBudget::TryCharge(uint64_t size) {
+  uint64_t used = used_.load();
+  do {
+    if (used + size > limit_.load()) return false;
+  } while (!used_.compare_exchange_weak(used, used + size));
+  return true;
+}
+
+Recorder::Recorder(const CnedkRecorderCreateParams &params) : params_(params) {
+  file_path_ = params.muxer_params.file_path;
+  hevc_ = params.muxer_params.codec_type == CNEDK_VENC_TYPE_H265;
+  if (params.muxer_params.pts_timescale) timescale_ = params.muxer_params.pts_timescale;
+  // clips are not rotated, the path of each clip is decided by recorder
+  params_.muxer_params.segment_duration_ms = 0;
+  params_.muxer_params.segment_size = 0;
+  RecorderBudget::Instance().Register();
+  closer_ = std::thread(&Recorder::CloseLoop, this);
+}
+
+Recorder::~Recorder() {
+  Finish();
+  RecorderBudget::Instance().Unregister();
+}
+
+bool Recorder::Charge(uint64_t size) {
+  RecorderBudget &budget = RecorderBudget::Instance();
+  if (used_ + size > budget.Share() || !budget.TryCharge(size)) return false;
+  used_ += size;
+  return true;
+}
+
+void Recorder::DropOldestGop() {
+  RecorderBudget::Instance().Uncharge(gops_.front().size);
+  used_ -= gops_.front().size;
+  gops_.pop_front();
+}
+
+int Recorder::WriteClip(const Packet &packet) {
+  CnedkVEncFrameBits frame_bits;
+  frame_bits.bits = const_cast<uint8_t *>(packet.data.data());
+  frame_bits.len = static_cast<int>(packet.data.size());
+  frame_bits.pts = packet.pts;
+  frame_bits.pkt_type = packet.type;
+  return clip_->Write(frame_bits);
+}
+
+int Recorder::StartClip() {
+  clip_path_ = IndexedPath(file_path_, clip_index_++);
+  CnedkMuxerCreateParams muxer_params = params_.muxer_params;
+  muxer_params.file_path = clip_path_.c_str();
+  clip_.reset(new Muxer(muxer_params));
+  if (clip_->Init() < 0) {
+    LOG(ERROR) << "[EasyDK] [Recorder] StartClip(): Create muxer failed";
+    clip_.reset();
+    return -1;
+  }
+  for (const auto &packet : param_sets_) WriteClip(packet);
+  // pre-roll, starts from a key frame
+  for (const auto &gop : gops_) {
+    for (const auto &packet : gop.packets) {
+      if (WriteClip(packet) < 0) {
+        LOG(ERROR) << "[EasyDK] [Recorder] StartClip(): Write clip failed";
+        FinishClip();
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+void Recorder::FinishClip() {
+  if (!clip_) return;
+  std::unique_lock<std::mutex> lk(close_mutex_);
+  closing_.emplace_back(std::move(clip_), clip_path_);
+  lk.unlock();
+  close_cond_.notify_one();
+}
+
+void Recorder::CloseLoop() {
+  std::unique_lock<std::mutex> lk(close_mutex_);
+  while (true) {
+    close_cond_.wait(lk, [this] { return close_stop_ || !closing_.empty(); });
+    if (closing_.empty()) break;
+    std::pair<std::unique_ptr<Muxer>, std::string> clip = std::move(closing_.front());
+    closing_.pop_front();
+    lk.unlock();
+    if (clip.first->Finish() < 0) {
+      LOG(ERROR) << "[EasyDK] [Recorder] CloseLoop(): Write clip failed: " << clip.second;
+    }
+    clip.first.reset();
+    if (params_.OnClipDone) params_.OnClipDone(clip.second.c_str(), params_.userdata);
+    lk.lock();
+  }
+}
+
+int Recorder::Write(const CnedkVEncFrameBits &frame_bits) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (finished_) {
+    LOG(ERROR) << "[EasyDK] [Recorder] Write(): Recorder is finished";
+    return -1;
+  }
+  if (!frame_bits.bits || frame_bits.len <= 0) return 0;
+
+  Packet packet;
+  packet.data.assign(frame_bits.bits, frame_bits.bits + frame_bits.len);
+  packet.pts = frame_bits.pts;
+  packet.type = frame_bits.pkt_type;
+
+  if (packet.type == CNEDK_VENC_PACKAGE_TYPE_SPS || packet.type == CNEDK_VENC_PACKAGE_TYPE_PPS ||
+      packet.type == CNEDK_VENC_PACKAGE_TYPE_SPS_PPS) {
+    if (packet.type != CNEDK_VENC_PACKAGE_TYPE_PPS) param_sets_.clear();
+    if (clip_) WriteClip(packet);
+    param_sets_.emplace_back(std::move(packet));
+    return 0;
+  }
+
+  bool key = packet.type == CNEDK_VENC_PACKAGE_TYPE_KEY_FRAME;
+  if (!key) {
+    std::vector<NalUnit> nalus;
+    SplitAnnexB(packet.data.data(), packet.data.size(), &nalus);
+    key = std::any_of(nalus.begin(), nalus.end(), [this](const NalUnit &nalu) { return IsKeyNal(nalu, hevc_); });
+  }
+  int64_t now = ToMs(packet.pts);
+  last_ms_ = now;
+
+  if (clip_ && now > clip_end_ms_) FinishClip();
+  if (clip_ && WriteClip(packet) < 0) {
+    LOG(ERROR) << "[EasyDK] [Recorder] Write(): Write clip failed";
+    FinishClip();
+  }
+
+  // keep packets in ring
+  if (key) {
+    wait_key_frame_ = false;
+    Gop gop;
+    gop.start_ms = now;
+    gop.size = 0;
+    gops_.emplace_back(std::move(gop));
+  }
+  if (!gops_.empty() && !wait_key_frame_) {
+    uint64_t size = packet.data.size();
+    while (!Charge(size)) {
+      if (gops_.size() > 1) {
+        DropOldestGop();
+        continue;
+      }
+      // a single GOP exceeds the budget, the rest of it is useless without this packet
+      LOG(WARNING) << "[EasyDK] [Recorder] Write(): Memory limit is exceeded, drop GOP";
+      DropOldestGop();
+      wait_key_frame_ = true;
+      break;
+    }
+    if (!wait_key_frame_) {
+      gops_.back().size += size;
+      gops_.back().packets.emplace_back(std::move(packet));
+    }
+  }
+  // the first GOP kept is the last one starting before the pre-roll window
+  while (gops_.size() > 1 && now - gops_[1].start_ms >= static_cast<int64_t>(params_.pre_record_ms)) {
+    DropOldestGop();
+  }
+
+  if (trigger_pending_ && key && !wait_key_frame_) {
+    trigger_pending_ = false;
+    clip_end_ms_ = std::max(clip_end_ms_, now);
+    return StartClip();
+  }
+  return 0;
+}
+
+int Recorder::Trigger() {
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (finished_) {
+    LOG(ERROR) << "[EasyDK] [Recorder] Trigger(): Recorder is finished";
+    return -1;
+  }
+  clip_end_ms_ = last_ms_ + params_.post_record_ms;
+  if (clip_) return 0;
+  if (gops_.empty()) {
+    // starts at the next key frame
+    trigger_pending_ = true;
+    return 0;
+  }
+  return StartClip();
+}
+
+int Recorder::Finish() {
+  std::unique_lock<std::mutex> lk(mutex_);
+  if (finished_) return 0;
+  finished_ = true;
+  FinishClip();
+  while (!gops_.empty()) DropOldestGop();
+  lk.unlock();
+  // all clips are closed when finished
+  std::unique_lock<std::mutex> close_lk(close_mutex_);
+  close_stop_ = true;
+  close_lk.unlock();
+  close_cond_.notify_one();
+  closer_.join();
+  return 0;
+}
+
+}  // namespace cnedk
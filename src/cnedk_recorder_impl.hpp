@@ -0,0 +1,126 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef CNEDK_RECORDER_IMPL_HPP_
+#define CNEDK_RECORDER_IMPL_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cnedk_recorder.h"
+#include "cnedk_muxer_impl.hpp"
+
+namespace cnedk {
+
+/**
+ * Memory budget shared by all recorders. Each recorder is allowed an even share of the limit, so that a stream with
+ * high bitrate does not starve the others.
+ */
+class RecorderBudget {
+ public:
+  static RecorderBudget &Instance() {
+    static RecorderBudget budget;
+    return budget;
+  }
+  void SetLimit(uint64_t limit) { limit_.store(limit); }
+  uint64_t Usage() const { return used_.load(); }
+  void Register() { recorder_num_.fetch_add(1); }
+  void Unregister() { recorder_num_.fetch_sub(1); }
+  uint64_t Share() const { return limit_.load() / std::max<uint32_t>(recorder_num_.load(), 1); }
+  // Returns false if the limit would be exceeded
+  bool TryCharge(uint64_t size);
+  void Uncharge(uint64_t size) { used_.fetch_sub(size); }
+
+ private:
+  RecorderBudget() = default;
+  std::atomic<uint64_t> limit_{256ull << 20};
+  std::atomic<uint64_t> used_{0};
+  std::atomic<uint32_t> recorder_num_{0};
+};  // class RecorderBudget
+
+class Recorder {
+ public:
+  explicit Recorder(const CnedkRecorderCreateParams &params);
+  ~Recorder();
+  int Write(const CnedkVEncFrameBits &frame_bits);
+  int Trigger();
+  int Finish();
+
+ private:
+  struct Packet {
+    std::vector<uint8_t> data;
+    uint64_t pts;
+    CnedkVencPakageType type;
+  };
+  // packets from one key frame to the next
+  struct Gop {
+    std::vector<Packet> packets;
+    int64_t start_ms;
+    uint64_t size;
+  };
+
+  int64_t ToMs(uint64_t pts) const { return pts / timescale_ * 1000 + pts % timescale_ * 1000 / timescale_; }
+  bool Charge(uint64_t size);
+  void DropOldestGop();
+  int StartClip();
+  // hands the clip to closer, so that writing is not blocked by flushing the clip
+  void FinishClip();
+  void CloseLoop();
+  int WriteClip(const Packet &packet);
+
+  CnedkRecorderCreateParams params_;
+  std::string file_path_;
+  bool hevc_;
+  uint32_t timescale_ = 90000;
+
+  std::mutex mutex_;
+  std::vector<Packet> param_sets_;
+  std::deque<Gop> gops_;
+  // the current GOP is dropped since memory limit is exceeded, waits for the next key frame
+  bool wait_key_frame_ = false;
+  uint64_t used_ = 0;
+  int64_t last_ms_ = 0;
+
+  std::unique_ptr<Muxer> clip_;
+  std::string clip_path_;
+  uint32_t clip_index_ = 0;
+  int64_t clip_end_ms_ = 0;
+  bool trigger_pending_ = false;
+  bool finished_ = false;
+
+  // finished clips waiting to be flushed and closed
+  std::mutex close_mutex_;
+  std::condition_variable close_cond_;
+  std::deque<std::pair<std::unique_ptr<Muxer>, std::string>> closing_;
+  bool close_stop_ = false;
+  std::thread closer_;
+};  // class Recorder
+
+}  // namespace cnedk
+
+#endif  // CNEDK_RECORDER_IMPL_HPP_
@@ -0,0 +1,277 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnedk_stream_supervisor.hpp"
+
+#include <algorithm>
+#include <string>
+
+#include "glog/logging.h"
+
+namespace cnedk {
+
+namespace {
+// the watchdog checks at least this often
+constexpr uint32_t kMaxWatchIntervalMs = 1000;
+}  // namespace
+
+const char *StreamHealthName(StreamHealth health) {
+  switch (health) {
+    case StreamHealth::CONNECTING:
+      return "CONNECTING";
+    case StreamHealth::LIVE:
+      return "LIVE";
+    case StreamHealth::STALLED:
+      return "STALLED";
+    case StreamHealth::RECONNECTING:
+      return "RECONNECTING";
+    case StreamHealth::FAILED:
+      return "FAILED";
+  }
+  return "UNKNOWN";
+}
+
+StreamSupervisor::StreamSupervisor(StreamSource *source, StreamSink *sink, const StreamSupervisorParams &params)
+    : source_(source), sink_(sink), params_(params) {
+  params_.backoff_multiplier = std::max(params_.backoff_multiplier, 1u);
+  params_.max_packet_errors = std::max(params_.max_packet_errors, 1u);
+}
+
+StreamSupervisor::~StreamSupervisor() { Stop(); }
+
+void StreamSupervisor::Start() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (thread_.joinable()) {
+    LOG(WARNING) << "[EasyDK] [StreamSupervisor] Start(): Supervisor has been started";
+    return;
+  }
+  running_ = true;
+  thread_ = std::thread(&StreamSupervisor::Run, this);
+  watchdog_ = std::thread(&StreamSupervisor::WatchLoop, this);
+}
+
+void StreamSupervisor::Stop() {
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (running_) {
+      running_ = false;
+      source_->Interrupt();
+    }
+    cond_.notify_all();
+  }
+  if (thread_.joinable()) thread_.join();
+  if (watchdog_.joinable()) watchdog_.join();
+}
+
+bool StreamSupervisor::Wait(uint32_t timeout_ms) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  return cond_.wait_for(lk, std::chrono::milliseconds(timeout_ms), [this] { return done_; });
+}
+
+StreamHealth StreamSupervisor::GetHealth() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return health_;
+}
+
+uint32_t StreamSupervisor::GetReconnectCount() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return reconnect_count_;
+}
+
+bool StreamSupervisor::IsRunning() const {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return running_;
+}
+
+void StreamSupervisor::Run() {
+  while (Arm(params_.connect_timeout_ms)) {
+    bool opened = source_->Open();
+    bool eos = false;
+    std::string reason = opened ? Serve(&eos) : "open failed";
+    Disarm();
+    source_->Close();
+    if (!IsRunning()) break;
+
+    if (eos && !params_.reconnect_on_eos) {
+      sink_->OnEos();
+      Finish();
+      break;
+    }
+    // frames decoded before are kept, the decoder starts over with the new connection
+    if (opened) sink_->OnReset();
+
+    uint32_t retry_count;
+    {
+      std::lock_guard<std::mutex> lk(mutex_);
+      retry_count = ++retry_count_;
+    }
+    if (params_.max_retries >= 0 && retry_count > static_cast<uint32_t>(params_.max_retries)) {
+      Transition(StreamHealth::FAILED, reason);
+      sink_->OnEos();
+      Finish();
+      break;
+    }
+    uint32_t backoff_ms = Backoff(retry_count);
+    Transition(StreamHealth::RECONNECTING, reason, backoff_ms);
+
+    std::unique_lock<std::mutex> lk(mutex_);
+    bool stopped = cond_.wait_for(lk, std::chrono::milliseconds(backoff_ms), [this] { return !running_; });
+    if (stopped) break;
+    reconnect_count_++;
+  }
+}
+
+std::string StreamSupervisor::Serve(bool *eos) {
+  uint32_t error_count = 0;
+  // the decoder is started over with every connection
+  bool wait_key_frame = true;
+  StreamPacket packet;
+  while (IsRunning()) {
+    StreamReadStatus status = source_->Read(&packet);
+    if (status == StreamReadStatus::EOS) {
+      *eos = true;
+      return "end of stream";
+    }
+    if (status == StreamReadStatus::ERROR) {
+      std::lock_guard<std::mutex> lk(mutex_);
+      return interrupted_ ? "no packet received before timeout" : "read failed";
+    }
+    if (wait_key_frame) {
+      if (!packet.key_frame) {
+        OnPacketReceived(false);
+        continue;
+      }
+      wait_key_frame = false;
+    }
+    if (sink_->OnPacket(packet)) {
+      error_count = 0;
+      OnPacketReceived(true);
+    } else {
+      OnPacketReceived(false);
+      if (++error_count >= params_.max_packet_errors) {
+        return std::to_string(error_count) + " packets failed in a row";
+      }
+    }
+  }
+  return "stopped";
+}
+
+bool StreamSupervisor::Arm(uint32_t timeout_ms) {
+  std::lock_guard<std::mutex> lk(mutex_);
+  if (!running_) return false;
+  armed_ = true;
+  interrupted_ = false;
+  deadline_ = Clock::now() + std::chrono::milliseconds(timeout_ms);
+  cond_.notify_all();
+  return true;
+}
+
+void StreamSupervisor::Disarm() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  armed_ = false;
+}
+
+void StreamSupervisor::Finish() {
+  std::lock_guard<std::mutex> lk(mutex_);
+  running_ = false;
+  done_ = true;
+  cond_.notify_all();
+}
+
+uint32_t StreamSupervisor::Backoff(uint32_t retry_count) const {
+  uint64_t backoff_ms = params_.initial_backoff_ms;
+  for (uint32_t i = 1; i < retry_count && backoff_ms < params_.max_backoff_ms; ++i) {
+    backoff_ms *= params_.backoff_multiplier;
+  }
+  return std::min<uint64_t>(backoff_ms, params_.max_backoff_ms);
+}
+
+void StreamSupervisor::OnPacketReceived(bool accepted) {
+  std::string reason;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    last_packet_ = Clock::now();
+    deadline_ = last_packet_ + std::chrono::milliseconds(params_.reconnect_timeout_ms);
+    if (!accepted || health_ == StreamHealth::LIVE) return;
+    reason = health_ == StreamHealth::STALLED ? "packets resumed" : "packets received";
+    retry_count_ = 0;
+  }
+  Transition(StreamHealth::LIVE, reason);
+}
+
+void StreamSupervisor::Transition(StreamHealth to, const std::string &reason, uint32_t backoff_ms) {
+  std::lock_guard<std::mutex> event_lk(event_mutex_);
+  StreamHealthEvent event;
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    // the watchdog might be late, a packet could have been received meanwhile
+    if (to == StreamHealth::STALLED &&
+        (health_ != StreamHealth::LIVE ||
+         Clock::now() - last_packet_ < std::chrono::milliseconds(params_.stall_timeout_ms))) {
+      return;
+    }
+    event.from = health_;
+    event.to = to;
+    event.retry_count = retry_count_;
+    event.backoff_ms = backoff_ms;
+    event.reason = reason;
+    health_ = to;
+    // the watchdog starts watching stalls
+    cond_.notify_all();
+  }
+  if (to == StreamHealth::LIVE) {
+    LOG(INFO) << "[EasyDK] [StreamSupervisor] Transition(): " << StreamHealthName(event.from) << " -> LIVE, "
+              << reason;
+  } else {
+    LOG(WARNING) << "[EasyDK] [StreamSupervisor] Transition(): " << StreamHealthName(event.from) << " -> "
+                 << StreamHealthName(to) << ", " << reason
+                 << (to == StreamHealth::RECONNECTING ? ", retry in " + std::to_string(backoff_ms) + " ms" : "");
+  }
+  if (params_.on_event) params_.on_event(event);
+}
+
+void StreamSupervisor::WatchLoop() {
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (running_) {
+    Clock::time_point now = Clock::now();
+    Clock::time_point next = now + std::chrono::milliseconds(kMaxWatchIntervalMs);
+    if (armed_ && !interrupted_) {
+      if (now >= deadline_) {
+        interrupted_ = true;
+        source_->Interrupt();
+        continue;
+      }
+      next = std::min(next, deadline_);
+    }
+    if (armed_ && health_ == StreamHealth::LIVE) {
+      Clock::time_point stall = last_packet_ + std::chrono::milliseconds(params_.stall_timeout_ms);
+      if (now >= stall) {
+        lk.unlock();
+        Transition(StreamHealth::STALLED, "no packet for " + std::to_string(params_.stall_timeout_ms) + " ms");
+        lk.lock();
+        continue;
+      }
+      next = std::min(next, stall);
+    }
+    cond_.wait_until(lk, next);
+  }
+}
+
+}  // namespace cnedk
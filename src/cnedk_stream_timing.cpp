@@ -0,0 +1,245 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnedk_stream_timing.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace cnedk {
+
+namespace {
+class SteadyClock : public Clock {
+ public:
+  int64_t NowUs() override {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+  void SleepUntilUs(int64_t time_us) override {
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::microseconds(time_us)));
+  }
+};  // class SteadyClock
+
+std::atomic<Clock *> g_default_clock{nullptr};
+
+struct DefaultListeners {
+  std::mutex mutex;
+  std::map<const void *, Clock::DefaultListener> listeners;
+};
+
+// constructed on first use, so that it outlives the static owners of listeners
+DefaultListeners &GetDefaultListeners() {
+  static DefaultListeners registry;
+  return registry;
+}
+}  // namespace
+
+Clock *Clock::Default() {
+  static SteadyClock clock;
+  Clock *replaced = g_default_clock.load();
+  return replaced ? replaced : &clock;
+}
+
+void Clock::SetDefault(Clock *clock) {
+  if (g_default_clock.exchange(clock) == clock) return;
+  DefaultListeners &registry = GetDefaultListeners();
+  std::unique_lock<std::mutex> lk(registry.mutex);
+  if (registry.listeners.empty()) return;
+  // listeners may set listeners, call them without lock
+  std::vector<DefaultListener> listeners;
+  listeners.reserve(registry.listeners.size());
+  for (auto &it : registry.listeners) listeners.push_back(it.second);
+  lk.unlock();
+  for (auto &listener : listeners) listener();
+}
+
+void Clock::SetDefaultListener(const void *owner, DefaultListener listener) {
+  DefaultListeners &registry = GetDefaultListeners();
+  std::lock_guard<std::mutex> lk(registry.mutex);
+  if (listener) {
+    registry.listeners[owner] = std::move(listener);
+  } else {
+    registry.listeners.erase(owner);
+  }
+}
+
+void VirtualClock::SleepUntilUs(int64_t time_us) {
+  int64_t now = now_us_.load();
+  if (time_us <= now) return;
+  slept_us_ += time_us - now;
+  now_us_.store(time_us);
+  Notify();
+}
+
+void VirtualClock::AdvanceUs(int64_t us) {
+  now_us_ += us;
+  Notify();
+}
+
+void VirtualClock::SetListener(const void *owner, Listener listener) {
+  std::lock_guard<std::mutex> lk(listener_mutex_);
+  if (listener) {
+    listeners_[owner] = std::move(listener);
+  } else {
+    listeners_.erase(owner);
+  }
+}
+
+void VirtualClock::Notify() {
+  std::unique_lock<std::mutex> lk(listener_mutex_);
+  if (listeners_.empty()) return;
+  // listeners may set listeners, call them without lock
+  std::vector<Listener> listeners;
+  listeners.reserve(listeners_.size());
+  for (auto &it : listeners_) listeners.push_back(it.second);
+  lk.unlock();
+  int64_t now = now_us_.load();
+  for (auto &listener : listeners) listener(now);
+}
+
+StreamTiming::StreamTiming(const StreamTimingParams &params) : params_(params) {}
+
+int64_t StreamTiming::FrameDuration() const {
+  return params_.frame_rate > 0 ? std::llround(kMediaClockRate / params_.frame_rate) : kMediaClockRate / 25;
+}
+
+int64_t StreamTiming::Unwrap(int64_t pts) {
+  if (params_.pts_wrap_bits == 0 || params_.pts_wrap_bits >= 63) return pts;
+  const int64_t range = int64_t(1) << params_.pts_wrap_bits;
+  pts &= range - 1;
+  if (!unwrap_started_) {
+    unwrap_started_ = true;
+    last_unwrapped_ = pts;
+    return pts;
+  }
+  // takes the value closest to the last one
+  int64_t unwrapped = (last_unwrapped_ & ~(range - 1)) + pts;
+  if (unwrapped - last_unwrapped_ > range / 2) {
+    unwrapped -= range;
+  } else if (last_unwrapped_ - unwrapped > range / 2) {
+    unwrapped += range;
+  }
+  uint64_t wraps = static_cast<uint64_t>(std::max<int64_t>(unwrapped >> params_.pts_wrap_bits, 0));
+  wrap_count_ = std::max(wrap_count_, wraps);
+  last_unwrapped_ = unwrapped;
+  return unwrapped;
+}
+
+int64_t StreamTiming::ToMediaTime(int64_t pts) {
+  int64_t next = has_media_ ? max_media_time_ + FrameDuration() : 0;
+  if (pts == kNoPts) {
+    max_media_time_ = next;
+    has_media_ = true;
+    return next;
+  }
+
+  int64_t time = std::llround(static_cast<long double>(Unwrap(pts)) * params_.time_base_num * kMediaClockRate /
+                              params_.time_base_den);
+  if (!started_) {
+    offset_ = next - time;
+    started_ = true;
+  } else {
+    int64_t delta = time - last_time_;
+    int64_t max_gap = params_.max_gap_ms * kMediaClockRate / 1000;
+    if (delta > max_gap || delta < -max_gap) {
+      offset_ = next - time;
+      discontinuity_count_++;
+    }
+  }
+  last_time_ = time;
+
+  // reordered frames right after the start are kept at 0
+  int64_t media_time = std::max<int64_t>(time + offset_, 0);
+  max_media_time_ = has_media_ ? std::max(max_media_time_, media_time) : media_time;
+  has_media_ = true;
+  return media_time;
+}
+
+void StreamTiming::Rebase(const StreamTimingParams &params) {
+  params_ = params;
+  started_ = false;
+  unwrap_started_ = false;
+}
+
+void StreamTiming::Reset() {
+  started_ = false;
+  unwrap_started_ = false;
+  has_media_ = false;
+  max_media_time_ = 0;
+  discontinuity_count_ = 0;
+  wrap_count_ = 0;
+  std::lock_guard<std::mutex> lk(capture_mutex_);
+  capture_times_.clear();
+}
+
+void StreamTiming::RecordCapture(int64_t media_time, int64_t capture_us) {
+  std::lock_guard<std::mutex> lk(capture_mutex_);
+  capture_times_[media_time] = capture_us;
+  // records of frames never decoded
+  while (capture_times_.size() > kMaxCaptureRecords) capture_times_.erase(capture_times_.begin());
+}
+
+bool StreamTiming::Stamp(CnedkBufSurface *surf) {
+  std::lock_guard<std::mutex> lk(capture_mutex_);
+  auto it = capture_times_.find(static_cast<int64_t>(surf->pts));
+  if (it == capture_times_.end()) {
+    CnedkBufSurfaceSetCaptureTime(surf, 0);
+    return false;
+  }
+  CnedkBufSurfaceSetCaptureTime(surf, it->second);
+  // frames are output in presentation order, the earlier records are done or dropped
+  capture_times_.erase(capture_times_.begin(), ++it);
+  return true;
+}
+
+void PlaybackPacer::Anchor(int64_t media_time, int64_t now_us) {
+  anchored_ = true;
+  anchor_media_time_ = media_time;
+  anchor_us_ = now_us;
+}
+
+int64_t PlaybackPacer::Pace(int64_t media_time) {
+  int64_t now = clock_->NowUs();
+  if (!anchored_) {
+    Anchor(media_time, now);
+    return 0;
+  }
+  int64_t target = anchor_us_ + (media_time - anchor_media_time_) * 1000000 / kMediaClockRate;
+  if (target - now > max_lag_us_) {
+    // media time jumps forward
+    Anchor(media_time, now);
+    return 0;
+  }
+  if (now - target > max_lag_us_) {
+    // falls behind, starts over instead of sending the backlog at once
+    Anchor(media_time, now);
+    return now - target;
+  }
+  if (target > now) {
+    clock_->SleepUntilUs(target);
+    return 0;
+  }
+  return now - target;
+}
+
+}  // namespace cnedk
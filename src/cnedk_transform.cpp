@@ -29,6 +29,7 @@
 
 #include "cnedk_platform.h"
 #include "cnedk_transform_impl.hpp"
+#include "cnedk_transform_impl_host.hpp"
 
 #ifdef PLATFORM_CE3226
 #include "ce3226/cnedk_transform_impl_ce3226.hpp"
@@ -92,6 +93,10 @@ class TransformService {
       LOG(ERROR) << "[EasyDK] [TransformService] SetSessionParams(): Parameters pointer is invalid";
       return -1;
     }
+    if (!transformer_) {
+      LOG(ERROR) << "[EasyDK] [TransformService] SetSessionParams(): No transformer for this platform";
+      return -1;
+    }
     return transformer_->SetSessionParams(config_params);
   }
 
@@ -100,6 +105,10 @@ class TransformService {
       LOG(ERROR) << "[EasyDK] [TransformService] GetSessionParams(): Parameters pointer is invalid";
       return -1;
     }
+    if (!transformer_) {
+      LOG(ERROR) << "[EasyDK] [TransformService] GetSessionParams(): No transformer for this platform";
+      return -1;
+    }
     return transformer_->GetSessionParams(config_params);
   }
 
@@ -108,6 +117,13 @@ class TransformService {
       LOG(ERROR) << "[EasyDK] [TransformService] Transform(): src, dst BufSurface or parameters pointer is invalid";
       return -1;
     }
+    if (IsHostMemory(src->mem_type) && IsHostMemory(dst->mem_type)) {
+      return host_transformer_.Transform(src, dst, transform_params);
+    }
+    if (!transformer_) {
+      LOG(ERROR) << "[EasyDK] [TransformService] Transform(): No transformer for this platform";
+      return -1;
+    }
     return transformer_->Transform(src, dst, transform_params);
   }
 
@@ -118,8 +134,13 @@ class TransformService {
   TransformService &operator=(TransformService &&) = delete;
   TransformService() { transformer_.reset(CreateTransformer()); }
 
+  static bool IsHostMemory(CnedkBufSurfaceMemType mem_type) {
+    return mem_type == CNEDK_BUF_MEM_SYSTEM || mem_type == CNEDK_BUF_MEM_PINNED;
+  }
+
  private:
   std::unique_ptr<ITransformer> transformer_ = nullptr;
+  TransformerHost host_transformer_;
   static std::unique_ptr<TransformService> instance_;
 };
 
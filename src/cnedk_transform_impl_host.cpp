@@ -0,0 +1,221 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnedk_transform_impl_host.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "cnedk_buf_surface_utils.h"
+
+namespace cnedk {
+
+namespace {
+
+constexpr uint32_t kWeightBits = 11;
+constexpr uint32_t kWeightOne = 1 << kWeightBits;
+
+inline uint8_t Saturate(int value) { return static_cast<uint8_t>(std::min(std::max(value, 0), 255)); }
+
+inline uint8_t *PlanePtr(const CnedkBufSurfaceParams &params, uint32_t plane) {
+  return reinterpret_cast<uint8_t *>(params.data_ptr) + params.plane_params.offset[plane];
+}
+
+// Bilinear resize of rect of a plane with ch interleaved channels, pixel centers are aligned as OpenCV does
+void ResizePlane(const uint8_t *src, uint32_t src_stride, const CnedkTransformRect &rect, uint32_t ch, uint8_t *dst,
+                 uint32_t dst_stride, uint32_t dst_w, uint32_t dst_h) {
+  src += rect.top * src_stride + rect.left * ch;
+  if (rect.width == dst_w && rect.height == dst_h) {
+    for (uint32_t y = 0; y < dst_h; ++y) memcpy(dst + y * dst_stride, src + y * src_stride, dst_w * ch);
+    return;
+  }
+  thread_local std::vector<uint32_t> x_offsets;
+  thread_local std::vector<uint32_t> x_weights;
+  x_offsets.resize(dst_w * 2);
+  x_weights.resize(dst_w);
+  const float scale_x = static_cast<float>(rect.width) / dst_w, scale_y = static_cast<float>(rect.height) / dst_h;
+  for (uint32_t x = 0; x < dst_w; ++x) {
+    const float fx = std::max((x + 0.5f) * scale_x - 0.5f, 0.0f);
+    const uint32_t x0 = std::min(static_cast<uint32_t>(fx), rect.width - 1);
+    x_offsets[2 * x] = x0 * ch;
+    x_offsets[2 * x + 1] = std::min(x0 + 1, rect.width - 1) * ch;
+    x_weights[x] = std::min(static_cast<uint32_t>((fx - x0) * kWeightOne + 0.5f), kWeightOne);
+  }
+  for (uint32_t y = 0; y < dst_h; ++y) {
+    const float fy = std::max((y + 0.5f) * scale_y - 0.5f, 0.0f);
+    const uint32_t y0 = std::min(static_cast<uint32_t>(fy), rect.height - 1);
+    const uint32_t wy = std::min(static_cast<uint32_t>((fy - y0) * kWeightOne + 0.5f), kWeightOne);
+    const uint8_t *row0 = src + y0 * src_stride;
+    const uint8_t *row1 = src + std::min(y0 + 1, rect.height - 1) * src_stride;
+    uint8_t *out = dst + y * dst_stride;
+    for (uint32_t x = 0; x < dst_w; ++x) {
+      const uint32_t o0 = x_offsets[2 * x], o1 = x_offsets[2 * x + 1], wx = x_weights[x];
+      for (uint32_t c = 0; c < ch; ++c) {
+        const uint32_t top = row0[o0 + c] * (kWeightOne - wx) + row0[o1 + c] * wx;
+        const uint32_t bottom = row1[o0 + c] * (kWeightOne - wx) + row1[o1 + c] * wx;
+        *out++ = (top * (kWeightOne - wy) + bottom * wy + (1u << (2 * kWeightBits - 1))) >> (2 * kWeightBits);
+      }
+    }
+  }
+}
+
+// BT.601 video range, u is the offset of U in the chroma pairs and r is the offset of R in packed pixels
+void Yuv420spToRgb(const uint8_t *y_plane, uint32_t y_stride, const uint8_t *uv_plane, uint32_t uv_stride, uint32_t u,
+                   uint8_t *dst, uint32_t dst_stride, uint32_t r, uint32_t width, uint32_t height) {
+  for (uint32_t y = 0; y < height; ++y) {
+    const uint8_t *luma = y_plane + y * y_stride;
+    const uint8_t *uv = uv_plane + (y / 2) * uv_stride;
+    uint8_t *out = dst + y * dst_stride;
+    for (uint32_t x = 0; x < width; ++x, out += 3) {
+      const int c = (luma[x] - 16) * 1192;
+      const int d = uv[(x & ~1u) + u] - 128, e = uv[(x & ~1u) + 1 - u] - 128;
+      out[r] = Saturate((c + 1634 * e + 512) >> 10);
+      out[1] = Saturate((c - 401 * d - 832 * e + 512) >> 10);
+      out[2 - r] = Saturate((c + 2066 * d + 512) >> 10);
+    }
+  }
+}
+
+void RgbToYuv420sp(const uint8_t *src, uint32_t src_stride, uint32_t r, uint8_t *y_plane, uint32_t y_stride,
+                   uint8_t *uv_plane, uint32_t uv_stride, uint32_t u, uint32_t width, uint32_t height) {
+  for (uint32_t y = 0; y < height; y += 2) {
+    const uint8_t *rows[2] = {src + y * src_stride, src + std::min(y + 1, height - 1) * src_stride};
+    uint8_t *uv = uv_plane + (y / 2) * uv_stride;
+    for (uint32_t x = 0; x < width; x += 2) {
+      int sum_r = 0, sum_g = 0, sum_b = 0;
+      for (uint32_t i = 0; i < 4; ++i) {
+        const uint32_t px = std::min(x + (i & 1), width - 1), py = y + (i >> 1);
+        const uint8_t *pix = rows[i >> 1] + px * 3;
+        const int red = pix[r], green = pix[1], blue = pix[2 - r];
+        if (py < height) y_plane[py * y_stride + px] = Saturate(((66 * red + 129 * green + 25 * blue + 128) >> 8) + 16);
+        sum_r += red;
+        sum_g += green;
+        sum_b += blue;
+      }
+      uv[x + u] = Saturate(((-38 * sum_r - 74 * sum_g + 112 * sum_b + 512) >> 10) + 128);
+      uv[x + 1 - u] = Saturate(((112 * sum_r - 94 * sum_g - 18 * sum_b + 512) >> 10) + 128);
+    }
+  }
+}
+
+// the same defaults of rects as the MLU implementations, returns false if the rect is out of the frame
+bool GetRect(bool crop, const CnedkTransformRect *rect, const CnedkBufSurfaceParams &params, CnedkTransformRect *out) {
+  if (!crop || !rect) {
+    *out = {0, 0, params.width, params.height};
+    return true;
+  }
+  out->left = rect->left >= params.width ? 0 : rect->left;
+  out->top = rect->top >= params.height ? 0 : rect->top;
+  out->width = rect->width ? rect->width : params.width - out->left;
+  out->height = rect->height ? rect->height : params.height - out->top;
+  if (IsYuv420sp(params.color_format)) {
+    out->left &= ~1u;
+    out->top &= ~1u;
+  }
+  return out->width && out->height && out->left + out->width <= params.width &&
+         out->top + out->height <= params.height;
+}
+
+}  // namespace
+
+int TransformerHost::Transform(CnedkBufSurface *src, CnedkBufSurface *dst, CnedkTransformParams *transform_params) {
+  if (transform_params->transform_flag & CNEDK_TRANSFORM_MEAN_STD) {
+    LOG(ERROR) << "[EasyDK] [TransformerHost] Transform(): Normalization is not supported on host";
+    return -1;
+  }
+  if (src->num_filled > dst->batch_size) {
+    LOG(ERROR) << "[EasyDK] [TransformerHost] Transform(): The number of inputs exceeds batch size: "
+               << src->num_filled << " v.s. " << dst->batch_size;
+    return -1;
+  }
+
+  thread_local std::vector<uint8_t> scratch;
+  for (uint32_t i = 0; i < src->num_filled; ++i) {
+    const CnedkBufSurfaceParams &s = src->surface_list[i];
+    const CnedkBufSurfaceParams &d = dst->surface_list[i];
+    const bool src_yuv = IsYuv420sp(s.color_format), dst_yuv = IsYuv420sp(d.color_format);
+    if ((!src_yuv && GetChannelNum(s.color_format) != 3) || (!dst_yuv && GetChannelNum(d.color_format) != 3)) {
+      LOG(ERROR) << "[EasyDK] [TransformerHost] Transform(): Unsupported color format, src: " << s.color_format
+                 << ", dst: " << d.color_format;
+      return -1;
+    }
+    CnedkTransformRect src_rect, dst_rect;
+    if (!GetRect(transform_params->transform_flag & CNEDK_TRANSFORM_CROP_SRC,
+                 transform_params->src_rect ? &transform_params->src_rect[i] : nullptr, s, &src_rect) ||
+        !GetRect(transform_params->transform_flag & CNEDK_TRANSFORM_CROP_DST,
+                 transform_params->dst_rect ? &transform_params->dst_rect[i] : nullptr, d, &dst_rect)) {
+      LOG(ERROR) << "[EasyDK] [TransformerHost] Transform(): Rect is out of the frame, batch index: " << i;
+      return -1;
+    }
+    const uint32_t w = dst_rect.width, h = dst_rect.height;
+    const uint32_t chroma_w = (w + 1) / 2, chroma_h = (h + 1) / 2;
+    const CnedkTransformRect src_chroma = {src_rect.top / 2, src_rect.left / 2, (src_rect.width + 1) / 2,
+                                           (src_rect.height + 1) / 2};
+    const uint32_t src_u = s.color_format == CNEDK_BUF_COLOR_FORMAT_NV21 ? 1 : 0;
+    const uint32_t dst_u = d.color_format == CNEDK_BUF_COLOR_FORMAT_NV21 ? 1 : 0;
+    const uint32_t src_r = s.color_format == CNEDK_BUF_COLOR_FORMAT_BGR ? 2 : 0;
+    const uint32_t dst_r = d.color_format == CNEDK_BUF_COLOR_FORMAT_BGR ? 2 : 0;
+
+    uint8_t *dst0 = PlanePtr(d, 0) + dst_rect.top * d.plane_params.pitch[0];
+    if (src_yuv && dst_yuv) {
+      uint8_t *dst_uv = PlanePtr(d, 1) + dst_rect.top / 2 * d.plane_params.pitch[1] + (dst_rect.left & ~1u);
+      ResizePlane(PlanePtr(s, 0), s.plane_params.pitch[0], src_rect, 1, dst0 + dst_rect.left,
+                  d.plane_params.pitch[0], w, h);
+      ResizePlane(PlanePtr(s, 1), s.plane_params.pitch[1], src_chroma, 2, dst_uv, d.plane_params.pitch[1],
+                  chroma_w, chroma_h);
+      if (src_u != dst_u) {
+        for (uint32_t y = 0; y < chroma_h; ++y) {
+          uint8_t *uv = dst_uv + y * d.plane_params.pitch[1];
+          for (uint32_t x = 0; x < chroma_w; ++x) std::swap(uv[2 * x], uv[2 * x + 1]);
+        }
+      }
+    } else if (!src_yuv && !dst_yuv) {
+      uint8_t *out = dst0 + dst_rect.left * 3;
+      ResizePlane(PlanePtr(s, 0), s.plane_params.pitch[0], src_rect, 3, out, d.plane_params.pitch[0], w, h);
+      if (src_r != dst_r) {
+        for (uint32_t y = 0; y < h; ++y) {
+          uint8_t *pix = out + y * d.plane_params.pitch[0];
+          for (uint32_t x = 0; x < w; ++x) std::swap(pix[3 * x], pix[3 * x + 2]);
+        }
+      }
+    } else if (src_yuv) {
+      // resize in yuv then convert, the chroma plane is resized to full height rows of pairs
+      scratch.resize(w * h + chroma_w * 2 * chroma_h);
+      uint8_t *luma = scratch.data(), *uv = luma + w * h;
+      ResizePlane(PlanePtr(s, 0), s.plane_params.pitch[0], src_rect, 1, luma, w, w, h);
+      ResizePlane(PlanePtr(s, 1), s.plane_params.pitch[1], src_chroma, 2, uv, chroma_w * 2, chroma_w, chroma_h);
+      Yuv420spToRgb(luma, w, uv, chroma_w * 2, src_u, dst0 + dst_rect.left * 3, d.plane_params.pitch[0], dst_r, w,
+                    h);
+    } else {
+      scratch.resize(w * h * 3);
+      ResizePlane(PlanePtr(s, 0), s.plane_params.pitch[0], src_rect, 3, scratch.data(), w * 3, w, h);
+      uint8_t *dst_uv = PlanePtr(d, 1) + dst_rect.top / 2 * d.plane_params.pitch[1] + dst_rect.left;
+      RgbToYuv420sp(scratch.data(), w * 3, src_r, dst0 + dst_rect.left, d.plane_params.pitch[0], dst_uv,
+                    d.plane_params.pitch[1], dst_u, w, h);
+    }
+  }
+  dst->num_filled = src->num_filled;
+  return 0;
+}
+
+}  // namespace cnedk
@@ -0,0 +1,583 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "bitstream_parser.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace cnedk {
+
+void SplitAnnexB(const uint8_t *data, size_t size, std::vector<NalUnit> *nalus) {
+  nalus->clear();
+  size_t i = 0;
+  size_t start = size;
+  while (i + 2 < size) {
+    if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+      if (start < size) {
+        // trailing zero belongs to the next 4-byte start code
+        size_t end = i;
+        while (end > start && data[end - 1] == 0) --end;
+        if (end > start) nalus->push_back({data + start, end - start});
+      }
+      i += 3;
+      start = i;
+    } else {
+      ++i;
+    }
+  }
+  if (start < size) nalus->push_back({data + start, size - start});
+}
+
+int GetNalType(const NalUnit &nalu, bool hevc) { return hevc ? (nalu.data[0] >> 1) & 0x3F : nalu.data[0] & 0x1F; }
+
+bool IsParamSetNal(const NalUnit &nalu, bool hevc) {
+  int type = GetNalType(nalu, hevc);
+  return hevc ? type >= 32 && type <= 34 : type == 7 || type == 8;
+}
+
+bool IsKeyNal(const NalUnit &nalu, bool hevc) {
+  int type = GetNalType(nalu, hevc);
+  return hevc ? type >= 16 && type <= 21 : type == 5;
+}
+
+bool IsAudNal(const NalUnit &nalu, bool hevc) { return GetNalType(nalu, hevc) == (hevc ? 35 : 9); }
+
+bool IsSliceNal(const NalUnit &nalu, bool hevc) {
+  int type = GetNalType(nalu, hevc);
+  return hevc ? type <= 9 || (type >= 16 && type <= 21) : type >= 1 && type <= 5;
+}
+
+bool IsReferenceNal(const NalUnit &nalu, bool hevc) {
+  if (!hevc) return (nalu.data[0] >> 5) & 0x3;
+  int type = GetNalType(nalu, hevc);
+  return type > 14 || type % 2 == 1;
+}
+
+std::vector<uint8_t> ToRbsp(const uint8_t *data, size_t size) {
+  std::vector<uint8_t> rbsp;
+  rbsp.reserve(size);
+  int zeros = 0;
+  for (size_t i = 0; i < size; ++i) {
+    uint8_t b = data[i];
+    if (zeros >= 2 && b == 0x03) {
+      zeros = 0;
+      continue;
+    }
+    zeros = b == 0 ? zeros + 1 : 0;
+    rbsp.push_back(b);
+  }
+  return rbsp;
+}
+
+// ------------------------------------------------------------------------------------------------------------------
+// BitReader
+
+uint32_t BitReader::ReadBits(int n) {
+  uint32_t value = 0;
+  for (int i = 0; i < n; ++i) {
+    uint32_t bit = 0;
+    if (pos_ < size_ * 8) {
+      bit = (data_[pos_ >> 3] >> (7 - (pos_ & 7))) & 1;
+    } else {
+      error_ = true;
+    }
+    value = (value << 1) | bit;
+    ++pos_;
+  }
+  return value;
+}
+
+void BitReader::SkipBits(size_t n) {
+  pos_ += n;
+  if (pos_ > size_ * 8) error_ = true;
+}
+
+uint32_t BitReader::ReadUe() {
+  int leading_zeros = 0;
+  while (!ReadFlag()) {
+    // ue(v) is at most 32 bits in a conforming stream
+    if (error_ || ++leading_zeros > 31) {
+      error_ = true;
+      return 0;
+    }
+  }
+  if (!leading_zeros) return 0;
+  return static_cast<uint32_t>((1ull << leading_zeros) - 1 + ReadBits(leading_zeros));
+}
+
+int32_t BitReader::ReadSe() {
+  uint32_t code = ReadUe();
+  return code & 1 ? static_cast<int32_t>((code + 1) / 2) : -static_cast<int32_t>(code / 2);
+}
+
+namespace {
+
+// only parameter sets and the beginning of slices are parsed
+constexpr size_t kMaxSliceHeaderSize = 64;
+
+// high profiles signal chroma format and bit depth in SPS
+bool HasH264ChromaInfo(int profile_idc) {
+  static const int kProfiles[] = {100, 110, 122, 244, 44, 83, 86, 118, 128, 138, 139, 134, 135};
+  return std::find(std::begin(kProfiles), std::end(kProfiles), profile_idc) != std::end(kProfiles);
+}
+
+void SkipH264ScalingList(BitReader *br, int size) {
+  int last_scale = 8;
+  int next_scale = 8;
+  for (int j = 0; j < size; ++j) {
+    if (next_scale != 0) {
+      int delta_scale = br->ReadSe();
+      next_scale = (last_scale + delta_scale + 256) % 256;
+    }
+    last_scale = next_scale == 0 ? last_scale : next_scale;
+  }
+}
+
+// aspect ratio, overscan, video signal type and chroma location, common to H.264 and H.265
+void SkipVuiHead(BitReader *br) {
+  if (br->ReadFlag()) {  // aspect_ratio_info_present_flag
+    if (br->ReadBits(8) == 255) br->SkipBits(32);  // Extended_SAR
+  }
+  if (br->ReadFlag()) br->SkipBits(1);  // overscan
+  if (br->ReadFlag()) {                 // video_signal_type_present_flag
+    br->SkipBits(4);
+    if (br->ReadFlag()) br->SkipBits(24);  // colour description
+  }
+  if (br->ReadFlag()) {  // chroma_loc_info_present_flag
+    br->ReadUe();
+    br->ReadUe();
+  }
+}
+
+void ParseHevcProfileTierLevel(BitReader *br, int max_sub_layers_minus1, int *profile_idc, int *level_idc,
+                               bool *progressive) {
+  br->SkipBits(3);  // general_profile_space, general_tier_flag
+  *profile_idc = br->ReadBits(5);
+  br->SkipBits(32);  // general_profile_compatibility_flags
+  bool progressive_source = br->ReadFlag();
+  bool interlaced_source = br->ReadFlag();
+  if (progressive) *progressive = progressive_source || !interlaced_source;
+  br->SkipBits(2 + 44);  // non_packed, frame_only and reserved bits
+  *level_idc = br->ReadBits(8);
+  std::vector<bool> profile_present(max_sub_layers_minus1), level_present(max_sub_layers_minus1);
+  for (int i = 0; i < max_sub_layers_minus1; ++i) {
+    profile_present[i] = br->ReadFlag();
+    level_present[i] = br->ReadFlag();
+  }
+  if (max_sub_layers_minus1 > 0) br->SkipBits(2 * (8 - max_sub_layers_minus1));
+  for (int i = 0; i < max_sub_layers_minus1; ++i) {
+    if (profile_present[i]) br->SkipBits(88);
+    if (level_present[i]) br->SkipBits(8);
+  }
+}
+
+void SkipHevcScalingListData(BitReader *br) {
+  for (int size_id = 0; size_id < 4; ++size_id) {
+    for (int matrix_id = 0; matrix_id < 6; matrix_id += size_id == 3 ? 3 : 1) {
+      if (!br->ReadFlag()) {  // scaling_list_pred_mode_flag
+        br->ReadUe();         // scaling_list_pred_matrix_id_delta
+      } else {
+        int coef_num = std::min(64, 1 << (4 + (size_id << 1)));
+        if (size_id > 1) br->ReadSe();  // scaling_list_dc_coef_minus8
+        for (int i = 0; i < coef_num; ++i) br->ReadSe();
+      }
+    }
+  }
+}
+
+// returns false if malformed, num_delta_pocs keeps NumDeltaPocs of previous sets
+bool SkipHevcShortTermRefPicSet(BitReader *br, int idx, std::vector<int> *num_delta_pocs) {
+  bool inter_ref_pic_set_prediction = idx != 0 && br->ReadFlag();
+  if (inter_ref_pic_set_prediction) {
+    // delta_idx_minus1 is only present in slice header
+    br->SkipBits(1);  // delta_rps_sign
+    br->ReadUe();     // abs_delta_rps_minus1
+    int ref_num = (*num_delta_pocs)[idx - 1];
+    int num = 0;
+    for (int j = 0; j <= ref_num; ++j) {
+      bool used_by_curr_pic = br->ReadFlag();
+      bool use_delta = used_by_curr_pic || br->ReadFlag();
+      if (use_delta) ++num;
+    }
+    (*num_delta_pocs)[idx] = num;
+  } else {
+    uint32_t num_negative = br->ReadUe();
+    uint32_t num_positive = br->ReadUe();
+    if (num_negative > 16 || num_positive > 16) return false;
+    for (uint32_t i = 0; i < num_negative + num_positive; ++i) {
+      br->ReadUe();     // delta_poc_minus1
+      br->SkipBits(1);  // used_by_curr_pic_flag
+    }
+    (*num_delta_pocs)[idx] = num_negative + num_positive;
+  }
+  return !br->Error();
+}
+
+// SubWidthC and SubHeightC
+void GetChromaSubsampling(int chroma_format_idc, int *sub_width, int *sub_height) {
+  *sub_width = chroma_format_idc == 1 || chroma_format_idc == 2 ? 2 : 1;
+  *sub_height = chroma_format_idc == 1 ? 2 : 1;
+}
+
+}  // namespace
+
+// ------------------------------------------------------------------------------------------------------------------
+// H.264
+
+bool ParseH264Sps(const NalUnit &nalu, SpsInfo *sps) {
+  if (nalu.size < 4) return false;
+  std::vector<uint8_t> rbsp = ToRbsp(nalu.data + 1, nalu.size - 1);
+  BitReader br(rbsp.data(), rbsp.size());
+  SpsInfo info;
+  info.profile_idc = br.ReadBits(8);
+  br.SkipBits(8);  // constraint flags
+  info.level_idc = br.ReadBits(8);
+  info.id = br.ReadUe();
+  if (info.id > 31) return false;
+
+  int chroma_array_type = 1;
+  if (HasH264ChromaInfo(info.profile_idc)) {
+    info.chroma_format_idc = br.ReadUe();
+    if (info.chroma_format_idc > 3) return false;
+    chroma_array_type = info.chroma_format_idc;
+    if (info.chroma_format_idc == 3 && br.ReadFlag()) chroma_array_type = 0;  // separate_colour_plane_flag
+    info.bit_depth_luma = br.ReadUe() + 8;
+    info.bit_depth_chroma = br.ReadUe() + 8;
+    br.SkipBits(1);       // qpprime_y_zero_transform_bypass_flag
+    if (br.ReadFlag()) {  // seq_scaling_matrix_present_flag
+      for (int i = 0; i < (info.chroma_format_idc != 3 ? 8 : 12); ++i) {
+        if (br.ReadFlag()) SkipH264ScalingList(&br, i < 6 ? 16 : 64);
+      }
+    }
+  }
+
+  br.ReadUe();  // log2_max_frame_num_minus4
+  uint32_t pic_order_cnt_type = br.ReadUe();
+  if (pic_order_cnt_type == 0) {
+    br.ReadUe();  // log2_max_pic_order_cnt_lsb_minus4
+  } else if (pic_order_cnt_type == 1) {
+    br.SkipBits(1);  // delta_pic_order_always_zero_flag
+    br.ReadSe();     // offset_for_non_ref_pic
+    br.ReadSe();     // offset_for_top_to_bottom_field
+    uint32_t num_ref_frames_in_pic_order_cnt_cycle = br.ReadUe();
+    if (num_ref_frames_in_pic_order_cnt_cycle > 255) return false;
+    for (uint32_t i = 0; i < num_ref_frames_in_pic_order_cnt_cycle; ++i) br.ReadSe();
+  }
+  br.ReadUe();     // max_num_ref_frames
+  br.SkipBits(1);  // gaps_in_frame_num_value_allowed_flag
+  uint32_t width_in_mbs = br.ReadUe() + 1;
+  uint32_t height_in_map_units = br.ReadUe() + 1;
+  bool frame_mbs_only = br.ReadFlag();
+  if (!frame_mbs_only) br.SkipBits(1);  // mb_adaptive_frame_field_flag
+  br.SkipBits(1);                         // direct_8x8_inference_flag
+  if (width_in_mbs > 1024 || height_in_map_units > 1024) return false;
+  info.progressive = frame_mbs_only;
+  info.coded_width = width_in_mbs * 16;
+  info.coded_height = (2 - frame_mbs_only) * height_in_map_units * 16;
+
+  if (br.ReadFlag()) {  // frame_cropping_flag
+    int crop_unit_x = 1, crop_unit_y = 2 - frame_mbs_only;
+    if (chroma_array_type != 0) {
+      int sub_width, sub_height;
+      GetChromaSubsampling(info.chroma_format_idc, &sub_width, &sub_height);
+      crop_unit_x = sub_width;
+      crop_unit_y *= sub_height;
+    }
+    info.crop_left = br.ReadUe() * crop_unit_x;
+    info.crop_right = br.ReadUe() * crop_unit_x;
+    info.crop_top = br.ReadUe() * crop_unit_y;
+    info.crop_bottom = br.ReadUe() * crop_unit_y;
+  }
+  info.width = info.coded_width - info.crop_left - info.crop_right;
+  info.height = info.coded_height - info.crop_top - info.crop_bottom;
+  if (info.width <= 0 || info.height <= 0) return false;
+
+  if (br.ReadFlag()) {  // vui_parameters_present_flag
+    SkipVuiHead(&br);
+    if (br.ReadFlag()) {  // timing_info_present_flag
+      info.num_units_in_tick = br.ReadBits(32);
+      info.time_scale = br.ReadBits(32);
+      info.timing_info_present = info.num_units_in_tick && info.time_scale;
+      if (info.timing_info_present) info.frame_rate = info.time_scale / (2.0 * info.num_units_in_tick);
+    }
+  }
+  if (br.Error()) return false;
+  *sps = info;
+  return true;
+}
+
+bool ParseH264Pps(const NalUnit &nalu, PpsInfo *pps) {
+  std::vector<uint8_t> rbsp = ToRbsp(nalu.data + 1, std::min(nalu.size - 1, kMaxSliceHeaderSize));
+  BitReader br(rbsp.data(), rbsp.size());
+  PpsInfo info;
+  info.id = br.ReadUe();
+  info.sps_id = br.ReadUe();
+  if (br.Error() || info.id > 255 || info.sps_id > 31) return false;
+  *pps = info;
+  return true;
+}
+
+bool ParseH264Slice(const NalUnit &nalu, SliceInfo *slice) {
+  std::vector<uint8_t> rbsp = ToRbsp(nalu.data + 1, std::min(nalu.size - 1, kMaxSliceHeaderSize));
+  BitReader br(rbsp.data(), rbsp.size());
+  SliceInfo info;
+  info.first_slice = br.ReadUe() == 0;  // first_mb_in_slice
+  uint32_t slice_type = br.ReadUe();
+  info.pps_id = br.ReadUe();
+  if (br.Error() || slice_type > 9 || info.pps_id > 255) return false;
+  static const SliceType kTypes[] = {SliceType::P, SliceType::B, SliceType::I, SliceType::SP, SliceType::SI};
+  info.type = kTypes[slice_type % 5];
+  *slice = info;
+  return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------
+// H.265
+
+bool ParseHevcVps(const NalUnit &nalu, VpsInfo *vps) {
+  if (nalu.size < 3) return false;
+  std::vector<uint8_t> rbsp = ToRbsp(nalu.data + 2, nalu.size - 2);
+  BitReader br(rbsp.data(), rbsp.size());
+  VpsInfo info;
+  info.id = br.ReadBits(4);
+  br.SkipBits(2 + 6);  // base layer flags, vps_max_layers_minus1
+  int max_sub_layers_minus1 = br.ReadBits(3);
+  br.SkipBits(1 + 16);  // vps_temporal_id_nesting_flag, vps_reserved_0xffff_16bits
+  if (max_sub_layers_minus1 > 6) return false;
+  info.max_sub_layers = max_sub_layers_minus1 + 1;
+  ParseHevcProfileTierLevel(&br, max_sub_layers_minus1, &info.profile_idc, &info.level_idc, nullptr);
+  if (br.Error()) return false;
+  *vps = info;
+  return true;
+}
+
+bool ParseHevcSps(const NalUnit &nalu, SpsInfo *sps) {
+  if (nalu.size < 3) return false;
+  std::vector<uint8_t> rbsp = ToRbsp(nalu.data + 2, nalu.size - 2);
+  BitReader br(rbsp.data(), rbsp.size());
+  SpsInfo info;
+  info.vps_id = br.ReadBits(4);
+  int max_sub_layers_minus1 = br.ReadBits(3);
+  br.SkipBits(1);  // sps_temporal_id_nesting_flag
+  if (max_sub_layers_minus1 > 6) return false;
+  ParseHevcProfileTierLevel(&br, max_sub_layers_minus1, &info.profile_idc, &info.level_idc, &info.progressive);
+  info.id = br.ReadUe();
+  if (info.id > 15) return false;
+  info.chroma_format_idc = br.ReadUe();
+  if (info.chroma_format_idc > 3) return false;
+  int chroma_array_type = info.chroma_format_idc;
+  if (info.chroma_format_idc == 3 && br.ReadFlag()) chroma_array_type = 0;  // separate_colour_plane_flag
+  info.coded_width = br.ReadUe();
+  info.coded_height = br.ReadUe();
+  if (info.coded_width <= 0 || info.coded_height <= 0 || info.coded_width > 16888 || info.coded_height > 16888) {
+    return false;
+  }
+  if (br.ReadFlag()) {  // conformance_window_flag
+    int sub_width = 1, sub_height = 1;
+    if (chroma_array_type != 0) GetChromaSubsampling(info.chroma_format_idc, &sub_width, &sub_height);
+    info.crop_left = br.ReadUe() * sub_width;
+    info.crop_right = br.ReadUe() * sub_width;
+    info.crop_top = br.ReadUe() * sub_height;
+    info.crop_bottom = br.ReadUe() * sub_height;
+  }
+  info.width = info.coded_width - info.crop_left - info.crop_right;
+  info.height = info.coded_height - info.crop_top - info.crop_bottom;
+  if (info.width <= 0 || info.height <= 0) return false;
+  info.bit_depth_luma = br.ReadUe() + 8;
+  info.bit_depth_chroma = br.ReadUe() + 8;
+  uint32_t log2_max_pic_order_cnt_lsb = br.ReadUe() + 4;
+  if (log2_max_pic_order_cnt_lsb > 16) return false;
+  bool sub_layer_ordering_info_present = br.ReadFlag();
+  for (int i = sub_layer_ordering_info_present ? 0 : max_sub_layers_minus1; i <= max_sub_layers_minus1; ++i) {
+    br.ReadUe();  // sps_max_dec_pic_buffering_minus1
+    br.ReadUe();  // sps_max_num_reorder_pics
+    br.ReadUe();  // sps_max_latency_increase_plus1
+  }
+  uint32_t log2_min_cb_size = br.ReadUe() + 3;
+  uint32_t log2_diff_max_min_cb_size = br.ReadUe();
+  info.log2_ctb_size = log2_min_cb_size + log2_diff_max_min_cb_size;
+  if (info.log2_ctb_size < 4 || info.log2_ctb_size > 6) return false;
+  br.ReadUe();  // log2_min_luma_transform_block_size_minus2
+  br.ReadUe();  // log2_diff_max_min_luma_transform_block_size
+  br.ReadUe();  // max_transform_hierarchy_depth_inter
+  br.ReadUe();  // max_transform_hierarchy_depth_intra
+  if (br.ReadFlag() && br.ReadFlag()) {  // scaling_list_enabled_flag, sps_scaling_list_data_present_flag
+    SkipHevcScalingListData(&br);
+  }
+  br.SkipBits(2);       // amp_enabled_flag, sample_adaptive_offset_enabled_flag
+  if (br.ReadFlag()) {  // pcm_enabled_flag
+    br.SkipBits(8);     // pcm sample bit depths
+    br.ReadUe();        // log2_min_pcm_luma_coding_block_size_minus3
+    br.ReadUe();        // log2_diff_max_min_pcm_luma_coding_block_size
+    br.SkipBits(1);     // pcm_loop_filter_disabled_flag
+  }
+  uint32_t num_short_term_ref_pic_sets = br.ReadUe();
+  if (num_short_term_ref_pic_sets > 64) return false;
+  std::vector<int> num_delta_pocs(num_short_term_ref_pic_sets);
+  for (uint32_t i = 0; i < num_short_term_ref_pic_sets; ++i) {
+    if (!SkipHevcShortTermRefPicSet(&br, i, &num_delta_pocs)) return false;
+  }
+  if (br.ReadFlag()) {  // long_term_ref_pics_present_flag
+    uint32_t num_long_term_ref_pics = br.ReadUe();
+    if (num_long_term_ref_pics > 32) return false;
+    for (uint32_t i = 0; i < num_long_term_ref_pics; ++i) br.SkipBits(log2_max_pic_order_cnt_lsb + 1);
+  }
+  br.SkipBits(2);  // sps_temporal_mvp_enabled_flag, strong_intra_smoothing_enabled_flag
+
+  if (br.ReadFlag()) {  // vui_parameters_present_flag
+    SkipVuiHead(&br);
+    br.SkipBits(1);  // neutral_chroma_indication_flag
+    if (br.ReadFlag()) info.progressive = false;  // field_seq_flag
+    br.SkipBits(1);       // frame_field_info_present_flag
+    if (br.ReadFlag()) {  // default_display_window_flag
+      for (int i = 0; i < 4; ++i) br.ReadUe();
+    }
+    if (br.ReadFlag()) {  // vui_timing_info_present_flag
+      info.num_units_in_tick = br.ReadBits(32);
+      info.time_scale = br.ReadBits(32);
+      info.timing_info_present = info.num_units_in_tick && info.time_scale;
+      if (info.timing_info_present) info.frame_rate = static_cast<double>(info.time_scale) / info.num_units_in_tick;
+    }
+  }
+  if (br.Error()) return false;
+  *sps = info;
+  return true;
+}
+
+bool ParseHevcPps(const NalUnit &nalu, PpsInfo *pps) {
+  if (nalu.size < 3) return false;
+  std::vector<uint8_t> rbsp = ToRbsp(nalu.data + 2, std::min(nalu.size - 2, kMaxSliceHeaderSize));
+  BitReader br(rbsp.data(), rbsp.size());
+  PpsInfo info;
+  info.id = br.ReadUe();
+  info.sps_id = br.ReadUe();
+  info.dependent_slice_segments_enabled = br.ReadFlag();
+  br.SkipBits(1);  // output_flag_present_flag
+  info.num_extra_slice_header_bits = br.ReadBits(3);
+  if (br.Error() || info.id > 63 || info.sps_id > 15) return false;
+  *pps = info;
+  return true;
+}
+
+bool ParseHevcSlice(const NalUnit &nalu, const std::map<int, PpsInfo> &pps, const std::map<int, SpsInfo> &sps,
+                    SliceInfo *slice) {
+  if (nalu.size < 3) return false;
+  std::vector<uint8_t> rbsp = ToRbsp(nalu.data + 2, std::min(nalu.size - 2, kMaxSliceHeaderSize));
+  BitReader br(rbsp.data(), rbsp.size());
+  SliceInfo info;
+  info.first_slice = br.ReadFlag();
+  int nal_type = GetNalType(nalu, true);
+  if (nal_type >= 16 && nal_type <= 23) br.SkipBits(1);  // no_output_of_prior_pics_flag
+  info.pps_id = br.ReadUe();
+  auto pps_it = pps.find(info.pps_id);
+  if (br.Error() || pps_it == pps.end()) return false;
+  auto sps_it = sps.find(pps_it->second.sps_id);
+  if (sps_it == sps.end()) return false;
+
+  if (!info.first_slice) {
+    bool dependent_slice_segment = pps_it->second.dependent_slice_segments_enabled && br.ReadFlag();
+    int ctb_size = 1 << sps_it->second.log2_ctb_size;
+    uint32_t pic_size_in_ctbs = ((sps_it->second.coded_width + ctb_size - 1) / ctb_size) *
+                                ((sps_it->second.coded_height + ctb_size - 1) / ctb_size);
+    int address_bits = 0;
+    while ((1u << address_bits) < pic_size_in_ctbs) ++address_bits;
+    br.SkipBits(address_bits);  // slice_segment_address
+    // the type is inherited from the independent slice segment
+    if (dependent_slice_segment) {
+      *slice = info;
+      return !br.Error();
+    }
+  }
+  br.SkipBits(pps_it->second.num_extra_slice_header_bits);
+  uint32_t slice_type = br.ReadUe();
+  if (br.Error() || slice_type > 2) return false;
+  static const SliceType kTypes[] = {SliceType::B, SliceType::P, SliceType::I};
+  info.type = kTypes[slice_type];
+  *slice = info;
+  return true;
+}
+
+// ------------------------------------------------------------------------------------------------------------------
+// BitstreamParser
+
+bool BitstreamParser::Parse(const uint8_t *data, size_t size, AccessUnitInfo *info) {
+  *info = AccessUnitInfo();
+  std::vector<NalUnit> nalus;
+  SplitAnnexB(data, size, &nalus);
+  bool ret = true;
+  bool slice_found = false;
+  for (const auto &nalu : nalus) {
+    if (IsKeyNal(nalu, hevc_)) info->key_frame = true;
+    int type = GetNalType(nalu, hevc_);
+    if (IsParamSetNal(nalu, hevc_)) {
+      info->has_param_sets = true;
+      bool parsed = false;
+      if (hevc_ && type == 32) {
+        VpsInfo vps;
+        if ((parsed = ParseHevcVps(nalu, &vps))) vps_[vps.id] = vps;
+      } else if (hevc_ ? type == 33 : type == 7) {
+        SpsInfo sps;
+        if ((parsed = hevc_ ? ParseHevcSps(nalu, &sps) : ParseH264Sps(nalu, &sps))) {
+          sps_[sps.id] = sps;
+          last_sps_id_ = sps.id;
+        }
+      } else {
+        PpsInfo pps;
+        if ((parsed = hevc_ ? ParseHevcPps(nalu, &pps) : ParseH264Pps(nalu, &pps))) pps_[pps.id] = pps;
+      }
+      ret = ret && parsed;
+      continue;
+    }
+    if (slice_found || !IsSliceNal(nalu, hevc_)) continue;
+
+    // the first slice activates parameter sets of the picture
+    slice_found = true;
+    SliceInfo slice;
+    if (!(hevc_ ? ParseHevcSlice(nalu, pps_, sps_, &slice) : ParseH264Slice(nalu, &slice))) {
+      ret = false;
+      continue;
+    }
+    info->slice_type = slice.type;
+    auto pps_it = pps_.find(slice.pps_id);
+    if (pps_it == pps_.end()) {
+      ret = false;
+      continue;
+    }
+    auto sps_it = sps_.find(pps_it->second.sps_id);
+    if (sps_it == sps_.end()) {
+      ret = false;
+      continue;
+    }
+    if (has_active_sps_ && !active_sps_.SameFormat(sps_it->second)) info->format_changed = true;
+    active_sps_ = sps_it->second;
+    has_active_sps_ = true;
+  }
+  return ret;
+}
+
+const SpsInfo *BitstreamParser::GetSps() const {
+  if (has_active_sps_) return &active_sps_;
+  auto it = sps_.find(last_sps_id_);
+  return it == sps_.end() ? nullptr : &it->second;
+}
+
+}  // namespace cnedk
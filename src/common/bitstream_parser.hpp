@@ -0,0 +1,188 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef EASYDK_COMMON_BITSTREAM_PARSER_HPP_
+#define EASYDK_COMMON_BITSTREAM_PARSER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+namespace cnedk {
+
+// NAL unit without start code
+struct NalUnit {
+  const uint8_t *data;
+  size_t size;
+};
+
+// Splits Annex-B byte stream into NAL units
+void SplitAnnexB(const uint8_t *data, size_t size, std::vector<NalUnit> *nalus);
+
+int GetNalType(const NalUnit &nalu, bool hevc);
+// VPS, SPS or PPS
+bool IsParamSetNal(const NalUnit &nalu, bool hevc);
+// IDR for H.264, IRAP for H.265
+bool IsKeyNal(const NalUnit &nalu, bool hevc);
+bool IsAudNal(const NalUnit &nalu, bool hevc);
+// coded slice of a picture
+bool IsSliceNal(const NalUnit &nalu, bool hevc);
+// slice of a picture which may be referenced by others, nal_ref_idc is not 0 for H.264, not a sub-layer
+// non-reference picture for H.265
+bool IsReferenceNal(const NalUnit &nalu, bool hevc);
+
+// Removes emulation prevention bytes
+std::vector<uint8_t> ToRbsp(const uint8_t *data, size_t size);
+
+/**
+ * Reads bits of RBSP, including exp-Golomb codes. Reading past the end returns zeros and sets the error flag.
+ */
+class BitReader {
+ public:
+  BitReader(const uint8_t *data, size_t size) : data_(data), size_(size) {}
+
+  uint32_t ReadBits(int n);
+  bool ReadFlag() { return ReadBits(1) != 0; }
+  void SkipBits(size_t n);
+  // ue(v)
+  uint32_t ReadUe();
+  // se(v)
+  int32_t ReadSe();
+  bool Error() const { return error_; }
+  size_t BitsLeft() const { return size_ * 8 > pos_ ? size_ * 8 - pos_ : 0; }
+
+ private:
+  const uint8_t *data_;
+  size_t size_;
+  size_t pos_ = 0;
+  bool error_ = false;
+};
+
+enum class SliceType { P, B, I, SP, SI, UNKNOWN };
+
+struct VpsInfo {
+  int id = 0;
+  int max_sub_layers = 1;
+  int profile_idc = 0;
+  int level_idc = 0;
+};
+
+struct SpsInfo {
+  int id = 0;
+  int vps_id = 0;  // H.265 only
+  int profile_idc = 0;
+  int level_idc = 0;  // level * 10 for H.264, level * 30 for H.265
+  int chroma_format_idc = 1;
+  int bit_depth_luma = 8;
+  int bit_depth_chroma = 8;
+  // decoded size before cropping
+  int coded_width = 0;
+  int coded_height = 0;
+  // cropped by conformance window
+  int crop_left = 0;
+  int crop_right = 0;
+  int crop_top = 0;
+  int crop_bottom = 0;
+  int width = 0;
+  int height = 0;
+  bool progressive = true;
+  // VUI timing, frame rate is time_scale / num_units_in_tick / 2 for H.264, time_scale / num_units_in_tick for H.265
+  bool timing_info_present = false;
+  uint32_t num_units_in_tick = 0;
+  uint32_t time_scale = 0;
+  double frame_rate = 0;
+  // used by slice header of H.265
+  int log2_ctb_size = 4;
+
+  // whether decoder has to be reconfigured, resolution or format is different
+  bool SameFormat(const SpsInfo &other) const {
+    return coded_width == other.coded_width && coded_height == other.coded_height && width == other.width &&
+           height == other.height && chroma_format_idc == other.chroma_format_idc &&
+           bit_depth_luma == other.bit_depth_luma && bit_depth_chroma == other.bit_depth_chroma &&
+           progressive == other.progressive;
+  }
+};
+
+struct PpsInfo {
+  int id = 0;
+  int sps_id = 0;
+  // H.265 only
+  bool dependent_slice_segments_enabled = false;
+  int num_extra_slice_header_bits = 0;
+};
+
+struct SliceInfo {
+  SliceType type = SliceType::UNKNOWN;
+  int pps_id = 0;
+  // starts a new picture
+  bool first_slice = false;
+};
+
+// parameter sets and slice header parsers, nalu includes NAL header
+bool ParseH264Sps(const NalUnit &nalu, SpsInfo *sps);
+bool ParseH264Pps(const NalUnit &nalu, PpsInfo *pps);
+bool ParseH264Slice(const NalUnit &nalu, SliceInfo *slice);
+bool ParseHevcVps(const NalUnit &nalu, VpsInfo *vps);
+bool ParseHevcSps(const NalUnit &nalu, SpsInfo *sps);
+bool ParseHevcPps(const NalUnit &nalu, PpsInfo *pps);
+// parameter sets are required to locate slice type
+bool ParseHevcSlice(const NalUnit &nalu, const std::map<int, PpsInfo> &pps, const std::map<int, SpsInfo> &sps,
+                    SliceInfo *slice);
+
+struct AccessUnitInfo {
+  bool key_frame = false;
+  bool has_param_sets = false;
+  // type of the first slice
+  SliceType slice_type = SliceType::UNKNOWN;
+  // the SPS activated by this access unit has different resolution or format from the last active one
+  bool format_changed = false;
+};
+
+/**
+ * Parses Annex-B H.264 or H.265 stream without libavformat. Parameter sets are kept, so that the stream can be probed,
+ * key frames can be found, and resolution changes can be detected.
+ */
+class BitstreamParser {
+ public:
+  explicit BitstreamParser(bool hevc) : hevc_(hevc) {}
+
+  /**
+   * Parses an access unit, or any part of stream split at NAL boundaries.
+   * Returns false if any parameter set or slice header is malformed, the rest of data is still parsed.
+   */
+  bool Parse(const uint8_t *data, size_t size, AccessUnitInfo *info);
+  // the active SPS, or the last parsed one before any slice. Returns nullptr if there is no SPS
+  const SpsInfo *GetSps() const;
+  bool IsHevc() const { return hevc_; }
+
+ private:
+  bool hevc_;
+  std::map<int, VpsInfo> vps_;
+  std::map<int, SpsInfo> sps_;
+  std::map<int, PpsInfo> pps_;
+  SpsInfo active_sps_;
+  bool has_active_sps_ = false;
+  int last_sps_id_ = -1;
+};  // class BitstreamParser
+
+}  // namespace cnedk
+
+#endif  // EASYDK_COMMON_BITSTREAM_PARSER_HPP_
@@ -0,0 +1,201 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "bitstream_ring.hpp"
+
+#include <algorithm>
+#include <new>
+#include <unordered_map>
+
+#include "glog/logging.h"
+
+namespace cnedk {
+
+constexpr size_t BitstreamRing::kAlignment;
+
+static inline size_t AlignUp(size_t value, size_t align) { return (value + align - 1) / align * align; }
+
+// slices taken from all rings by data, so that frame bits of the encoder are retained by their data
+struct SliceRegistry {
+  std::mutex mutex;
+  std::unordered_map<const void *, BitstreamSlice *> slices;
+};
+
+static SliceRegistry &GetSliceRegistry() {
+  // never destructed, slices may be released during static destruction
+  static SliceRegistry *registry = new SliceRegistry;
+  return *registry;
+}
+
+std::shared_ptr<BitstreamRing> BitstreamRing::Create(size_t capacity) {
+  std::shared_ptr<BitstreamRing> ring;
+  try {
+    ring.reset(new BitstreamRing(capacity));
+  } catch (std::bad_alloc &exception) {
+    LOG(ERROR) << "[EasyDK] [BitstreamRing] Create(): bad_alloc " << exception.what() << "; capacity " << capacity;
+    return nullptr;
+  }
+  return ring;
+}
+
+BitstreamRing::BitstreamRing(size_t capacity) : capacity_(AlignUp(capacity, kAlignment)) {
+  // over-allocate to align the start address
+  buffer_.reset(new uint8_t[capacity_ + kAlignment]);
+  base_ = reinterpret_cast<uint8_t *>(AlignUp(reinterpret_cast<uintptr_t>(buffer_.get()), kAlignment));
+}
+
+BitstreamRing::~BitstreamRing() {
+  if (!in_flight_.empty()) {
+    LOG(WARNING) << "[EasyDK] [BitstreamRing] ~BitstreamRing(): " << in_flight_.size() << " slices are not released";
+  }
+}
+
+BitstreamSlice *BitstreamRing::GetSlice() {
+  if (free_slices_.empty()) {
+    slices_.emplace_back(new BitstreamSlice);
+    return slices_.back().get();
+  }
+  BitstreamSlice *slice = free_slices_.back();
+  free_slices_.pop_back();
+  return slice;
+}
+
+BitstreamSlice *BitstreamRing::Alloc(size_t size) {
+  size_t reserved = AlignUp(std::max<size_t>(size, 1), kAlignment);
+  std::unique_lock<std::mutex> lk(mutex_);
+  BitstreamSlice *slice = nullptr;
+  try {
+    slice = GetSlice();
+  } catch (std::bad_alloc &exception) {
+    LOG(ERROR) << "[EasyDK] [BitstreamRing] Alloc(): bad_alloc " << exception.what();
+    return nullptr;
+  }
+
+  if (in_flight_.empty()) {
+    head_ = tail_ = 0;
+  }
+  bool fit = false;
+  size_t skipped = 0;
+  if (used_ == 0 || tail_ > head_) {
+    // free space is [tail, capacity) and [0, head)
+    if (capacity_ - tail_ >= reserved) {
+      fit = true;
+    } else if (head_ >= reserved) {
+      skipped = capacity_ - tail_;
+      tail_ = 0;
+      fit = true;
+      ++wrap_count_;
+    }
+  } else if (tail_ < head_) {
+    // free space is [tail, head)
+    fit = head_ - tail_ >= reserved;
+  }
+
+  if (fit) {
+    slice->offset = tail_;
+    slice->reserved = reserved + skipped;
+    slice->data = base_ + tail_;
+    tail_ = (tail_ + reserved) % capacity_;
+    used_ += slice->reserved;
+  } else {
+    try {
+      slice->heap.reset(new uint8_t[size]);
+    } catch (std::bad_alloc &exception) {
+      LOG(ERROR) << "[EasyDK] [BitstreamRing] Alloc(): bad_alloc " << exception.what() << "; size " << size;
+      free_slices_.push_back(slice);
+      return nullptr;
+    }
+    slice->offset = 0;
+    slice->reserved = 0;
+    slice->data = slice->heap.get();
+    ++fallback_count_;
+    VLOG(4) << "[EasyDK] [BitstreamRing] Alloc(): Ring is full, fall back to heap memory, size " << size;
+  }
+  slice->size = size;
+  slice->released = false;
+  slice->ref.store(1);
+  slice->ring = shared_from_this();
+  if (fit) in_flight_.push_back(slice);
+  SliceRegistry &registry = GetSliceRegistry();
+  std::lock_guard<std::mutex> registry_lk(registry.mutex);
+  registry.slices[slice->data] = slice;
+  return slice;
+}
+
+void BitstreamRing::Retain(BitstreamSlice *slice) {
+  if (slice) slice->ref.fetch_add(1);
+}
+
+void BitstreamRing::Release(BitstreamSlice *slice) {
+  if (!slice || slice->ref.fetch_sub(1) != 1) return;
+  // the ring may be destroyed along with the last slice, destruct it after Recycle returns
+  std::shared_ptr<BitstreamRing> ring = std::move(slice->ring);
+  ring->Recycle(slice);
+}
+
+BitstreamSlice *BitstreamRing::Find(const void *data) {
+  if (!data) return nullptr;
+  SliceRegistry &registry = GetSliceRegistry();
+  std::lock_guard<std::mutex> lk(registry.mutex);
+  auto it = registry.slices.find(data);
+  return it == registry.slices.end() ? nullptr : it->second;
+}
+
+void BitstreamRing::Recycle(BitstreamSlice *slice) {
+  std::unique_lock<std::mutex> lk(mutex_);
+  {
+    SliceRegistry &registry = GetSliceRegistry();
+    std::lock_guard<std::mutex> registry_lk(registry.mutex);
+    registry.slices.erase(slice->data);
+  }
+  slice->data = nullptr;
+  slice->size = 0;
+  if (slice->heap) {
+    slice->heap.reset();
+    free_slices_.push_back(slice);
+    return;
+  }
+  slice->released = true;
+  // reclaim space of released slices at the head of ring
+  while (!in_flight_.empty() && in_flight_.front()->released) {
+    BitstreamSlice *front = in_flight_.front();
+    in_flight_.pop_front();
+    used_ -= front->reserved;
+    free_slices_.push_back(front);
+  }
+  if (in_flight_.empty()) {
+    head_ = tail_ = 0;
+  } else {
+    head_ = in_flight_.front()->offset;
+  }
+}
+
+BitstreamRing::Stats BitstreamRing::GetStats() const {
+  std::unique_lock<std::mutex> lk(mutex_);
+  Stats stats;
+  stats.capacity = capacity_;
+  stats.used = used_;
+  stats.in_flight = in_flight_.size();
+  stats.wrap_count = wrap_count_;
+  stats.fallback_count = fallback_count_;
+  return stats;
+}
+
+}  // namespace cnedk
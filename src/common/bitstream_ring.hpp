@@ -0,0 +1,108 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef EASYDK_COMMON_BITSTREAM_RING_HPP_
+#define EASYDK_COMMON_BITSTREAM_RING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace cnedk {
+
+class BitstreamRing;
+
+// A packet in BitstreamRing. It is reference counted and stays valid until the last reference is released.
+struct BitstreamSlice {
+  uint8_t *data = nullptr;
+  size_t size = 0;
+
+ private:
+  friend class BitstreamRing;
+  std::shared_ptr<BitstreamRing> ring;  // keeps ring alive while slice is in use
+  std::atomic<int> ref{0};
+  size_t offset = 0;
+  size_t reserved = 0;                  // bytes taken in ring, including the skipped tail before wraparound
+  bool released = false;
+  std::unique_ptr<uint8_t[]> heap;      // used when ring has no room
+};
+
+/**
+ * Reusable ring buffer for encoded packets.
+ *
+ * Packets are taken from the ring in order and may be released in any order, the space is reclaimed once all older
+ * packets are released. A packet which does not fit in the contiguous free space is put at the beginning of the ring,
+ * the skipped tail is reclaimed along with the packet. If the ring is full, the packet falls back to heap memory.
+ */
+class BitstreamRing : public std::enable_shared_from_this<BitstreamRing> {
+ public:
+  struct Stats {
+    size_t capacity;
+    size_t used;           // bytes taken, including skipped tail
+    size_t in_flight;      // number of slices not released
+    uint64_t wrap_count;   // times of wraparound
+    uint64_t fallback_count;  // times of falling back to heap memory
+  };
+
+  static std::shared_ptr<BitstreamRing> Create(size_t capacity);
+  ~BitstreamRing();
+
+  /**
+   * Takes a slice of `size` bytes with one reference, returns nullptr if out of memory
+   */
+  BitstreamSlice *Alloc(size_t size);
+
+  static void Retain(BitstreamSlice *slice);
+  static void Release(BitstreamSlice *slice);
+  /**
+   * Finds the slice of any ring by its data, returns nullptr if the slice is not taken
+   */
+  static BitstreamSlice *Find(const void *data);
+
+  Stats GetStats() const;
+
+ private:
+  explicit BitstreamRing(size_t capacity);
+  BitstreamSlice *GetSlice();
+  void Recycle(BitstreamSlice *slice);
+
+  static constexpr size_t kAlignment = 64;
+
+  mutable std::mutex mutex_;
+  std::unique_ptr<uint8_t[]> buffer_;
+  uint8_t *base_ = nullptr;
+  size_t capacity_ = 0;
+  size_t head_ = 0;
+  size_t tail_ = 0;
+  size_t used_ = 0;
+  std::deque<BitstreamSlice *> in_flight_;
+  std::vector<std::unique_ptr<BitstreamSlice>> slices_;
+  std::vector<BitstreamSlice *> free_slices_;
+  uint64_t wrap_count_ = 0;
+  uint64_t fallback_count_ = 0;
+};  // class BitstreamRing
+
+}  // namespace cnedk
+
+#endif  // EASYDK_COMMON_BITSTREAM_RING_HPP_
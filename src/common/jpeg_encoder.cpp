@@ -0,0 +1,390 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "jpeg_encoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define JPEG_ENCODER_SSE2
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define JPEG_ENCODER_NEON
+#endif
+
+namespace cnedk {
+
+namespace {
+
+// natural order of coefficients in zigzag order
+const uint8_t kZigzag[64] = {0,  1,  8,  16, 9,  2,  3,  10, 17, 24, 32, 25, 18, 11, 4,  5,  12, 19, 26, 33, 40, 48,
+                             41, 34, 27, 20, 13, 6,  7,  14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23,
+                             30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63};
+
+// quantization tables of ITU-T T.81 Annex K, in natural order
+const uint8_t kLumaQuant[64] = {16, 11, 10, 16, 24,  40,  51,  61,  12, 12, 14, 19, 26,  58,  60,  55,
+                                14, 13, 16, 24, 40,  57,  69,  56,  14, 17, 22, 29, 51,  87,  80,  62,
+                                18, 22, 37, 56, 68,  109, 103, 77,  24, 35, 55, 64, 81,  104, 113, 92,
+                                49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99};
+const uint8_t kChromaQuant[64] = {17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+                                  24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+                                  99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+                                  99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99};
+
+// Huffman tables of ITU-T T.81 Annex K, the number of codes of each length and the symbols
+const uint8_t kLumaDcBits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+const uint8_t kChromaDcBits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+const uint8_t kDcValues[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+const uint8_t kLumaAcBits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+const uint8_t kLumaAcValues[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07, 0x22, 0x71,
+    0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72,
+    0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x34, 0x35, 0x36, 0x37,
+    0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+    0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83,
+    0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3,
+    0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+const uint8_t kChromaAcBits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+const uint8_t kChromaAcValues[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71, 0x13, 0x22,
+    0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1,
+    0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x35, 0x36,
+    0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+    0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a,
+    0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a,
+    0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba,
+    0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa};
+
+const uint8_t *const kHuffmanBits[4] = {kLumaDcBits, kLumaAcBits, kChromaDcBits, kChromaAcBits};
+const uint8_t *const kHuffmanValues[4] = {kDcValues, kLumaAcValues, kDcValues, kChromaAcValues};
+
+// table class and id in DHT
+const uint8_t kHuffmanIds[4] = {0x00, 0x10, 0x01, 0x11};
+
+// expansion of BT.601 video range, luma 16-235 and chroma 16-240, to full range
+const float kLumaScale = 255.0f / 219.0f;
+const float kChromaScale = 255.0f / 224.0f;
+
+// scale factors of AAN DCT
+const float kAanScale[8] = {1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+                            1.0f, 0.785694958f, 0.541196100f, 0.275899379f};
+
+#if defined(JPEG_ENCODER_SSE2)
+typedef __m128 Vec;
+inline Vec VLoad(const float *p) { return _mm_loadu_ps(p); }
+inline void VStore(float *p, Vec v) { _mm_storeu_ps(p, v); }
+inline Vec VAdd(Vec a, Vec b) { return _mm_add_ps(a, b); }
+inline Vec VSub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+inline Vec VMul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+inline Vec VSet(float f) { return _mm_set1_ps(f); }
+inline void VRound(Vec v, int32_t *p) { _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_cvtps_epi32(v)); }
+#elif defined(JPEG_ENCODER_NEON)
+typedef float32x4_t Vec;
+inline Vec VLoad(const float *p) { return vld1q_f32(p); }
+inline void VStore(float *p, Vec v) { vst1q_f32(p, v); }
+inline Vec VAdd(Vec a, Vec b) { return vaddq_f32(a, b); }
+inline Vec VSub(Vec a, Vec b) { return vsubq_f32(a, b); }
+inline Vec VMul(Vec a, Vec b) { return vmulq_f32(a, b); }
+inline Vec VSet(float f) { return vdupq_n_f32(f); }
+inline void VRound(Vec v, int32_t *p) { vst1q_s32(p, vcvtnq_s32_f32(v)); }
+#else
+struct Vec {
+  float v[4];
+};
+inline Vec VLoad(const float *p) { return Vec{{p[0], p[1], p[2], p[3]}}; }
+inline void VStore(float *p, Vec v) { memcpy(p, v.v, sizeof(v.v)); }
+inline Vec VAdd(Vec a, Vec b) { return Vec{{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+inline Vec VSub(Vec a, Vec b) { return Vec{{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+inline Vec VMul(Vec a, Vec b) { return Vec{{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+inline Vec VSet(float f) { return Vec{{f, f, f, f}}; }
+inline void VRound(Vec v, int32_t *p) {
+  for (int i = 0; i < 4; ++i) p[i] = static_cast<int32_t>(std::lrint(v.v[i]));
+}
+#endif
+
+// AAN DCT of the 8 rows of 4 columns, along the columns. Outputs are scaled by kAanScale
+inline void Dct8(float *data) {
+  Vec d0 = VLoad(data), d1 = VLoad(data + 8), d2 = VLoad(data + 16), d3 = VLoad(data + 24);
+  Vec d4 = VLoad(data + 32), d5 = VLoad(data + 40), d6 = VLoad(data + 48), d7 = VLoad(data + 56);
+  Vec tmp0 = VAdd(d0, d7), tmp7 = VSub(d0, d7);
+  Vec tmp1 = VAdd(d1, d6), tmp6 = VSub(d1, d6);
+  Vec tmp2 = VAdd(d2, d5), tmp5 = VSub(d2, d5);
+  Vec tmp3 = VAdd(d3, d4), tmp4 = VSub(d3, d4);
+  // even part
+  Vec tmp10 = VAdd(tmp0, tmp3), tmp13 = VSub(tmp0, tmp3);
+  Vec tmp11 = VAdd(tmp1, tmp2), tmp12 = VSub(tmp1, tmp2);
+  VStore(data, VAdd(tmp10, tmp11));
+  VStore(data + 32, VSub(tmp10, tmp11));
+  Vec z1 = VMul(VAdd(tmp12, tmp13), VSet(0.707106781f));
+  VStore(data + 16, VAdd(tmp13, z1));
+  VStore(data + 48, VSub(tmp13, z1));
+  // odd part
+  tmp10 = VAdd(tmp4, tmp5);
+  tmp11 = VAdd(tmp5, tmp6);
+  tmp12 = VAdd(tmp6, tmp7);
+  Vec z5 = VMul(VSub(tmp10, tmp12), VSet(0.382683433f));
+  Vec z2 = VAdd(VMul(tmp10, VSet(0.541196100f)), z5);
+  Vec z4 = VAdd(VMul(tmp12, VSet(1.306562965f)), z5);
+  Vec z3 = VMul(tmp11, VSet(0.707106781f));
+  Vec z11 = VAdd(tmp7, z3), z13 = VSub(tmp7, z3);
+  VStore(data + 40, VAdd(z13, z2));
+  VStore(data + 24, VSub(z13, z2));
+  VStore(data + 8, VAdd(z11, z4));
+  VStore(data + 56, VSub(z11, z4));
+}
+
+inline void Transpose8x8(float *data) {
+  for (int i = 0; i < 8; ++i) {
+    for (int j = i + 1; j < 8; ++j) std::swap(data[i * 8 + j], data[j * 8 + i]);
+  }
+}
+
+// the number of bits to represent the magnitude of value
+inline uint32_t BitLength(int32_t value) {
+  uint32_t magnitude = value < 0 ? -value : value;
+  return magnitude ? 32 - __builtin_clz(magnitude) : 0;
+}
+
+inline void PutMarker(std::vector<uint8_t> *out, uint8_t marker, uint16_t length) {
+  out->push_back(0xff);
+  out->push_back(marker);
+  out->push_back(length >> 8);
+  out->push_back(length & 0xff);
+}
+
+inline void Put16(std::vector<uint8_t> *out, uint16_t value) {
+  out->push_back(value >> 8);
+  out->push_back(value & 0xff);
+}
+
+}  // namespace
+
+JpegEncoder::JpegEncoder() {
+  for (int t = 0; t < 4; ++t) {
+    Huffman &table = huffman_[t];
+    memset(&table, 0, sizeof(table));
+    uint32_t code = 0, k = 0;
+    for (uint32_t len = 1; len <= 16; ++len) {
+      for (uint32_t i = 0; i < kHuffmanBits[t][len - 1]; ++i, ++k, ++code) {
+        table.code[kHuffmanValues[t][k]] = code;
+        table.size[kHuffmanValues[t][k]] = len;
+      }
+      code <<= 1;
+    }
+  }
+  SetQuality(85);
+}
+
+void JpegEncoder::SetQuality(int quality) {
+  quality = std::min(std::max(quality, 1), 100);
+  if (quality == quality_) return;
+  quality_ = quality;
+  const int scale = quality < 50 ? 5000 / quality : 200 - quality * 2;
+  const uint8_t *bases[2] = {kLumaQuant, kChromaQuant};
+  for (int t = 0; t < 2; ++t) {
+    for (int i = 0; i < 64; ++i) {
+      qtables_[t][i] = std::min(std::max((bases[t][i] * scale + 50) / 100, 1), 255);
+      divisors_[t][i] = 1.0f / (qtables_[t][i] * kAanScale[i / 8] * kAanScale[i % 8] * 8.0f);
+    }
+  }
+}
+
+void JpegEncoder::WriteHeaders(uint32_t width, uint32_t height, std::vector<uint8_t> *out) const {
+  static const uint8_t kJfif[] = {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+  out->push_back(0xff);
+  out->push_back(0xd8);  // SOI
+  PutMarker(out, 0xe0, 2 + sizeof(kJfif));
+  out->insert(out->end(), kJfif, kJfif + sizeof(kJfif));
+
+  PutMarker(out, 0xdb, 2 + 2 * 65);
+  for (int t = 0; t < 2; ++t) {
+    out->push_back(t);
+    for (int k = 0; k < 64; ++k) out->push_back(qtables_[t][kZigzag[k]]);
+  }
+
+  // baseline, Y with 2x2 sampling factors, Cb and Cr with 1x1
+  PutMarker(out, 0xc0, 8 + 3 * 3);
+  out->push_back(8);
+  Put16(out, height);
+  Put16(out, width);
+  static const uint8_t kComponents[] = {3, 1, 0x22, 0, 2, 0x11, 1, 3, 0x11, 1};
+  out->insert(out->end(), kComponents, kComponents + sizeof(kComponents));
+
+  uint16_t dht_length = 2;
+  for (int t = 0; t < 4; ++t) {
+    dht_length += 17;
+    for (int i = 0; i < 16; ++i) dht_length += kHuffmanBits[t][i];
+  }
+  PutMarker(out, 0xc4, dht_length);
+  for (int t = 0; t < 4; ++t) {
+    out->push_back(kHuffmanIds[t]);
+    uint32_t count = 0;
+    for (int i = 0; i < 16; ++i) {
+      out->push_back(kHuffmanBits[t][i]);
+      count += kHuffmanBits[t][i];
+    }
+    out->insert(out->end(), kHuffmanValues[t], kHuffmanValues[t] + count);
+  }
+
+  PutMarker(out, 0xda, 6 + 2 * 3);
+  static const uint8_t kScan[] = {3, 1, 0x00, 2, 0x11, 3, 0x11, 0, 63, 0};
+  out->insert(out->end(), kScan, kScan + sizeof(kScan));
+}
+
+void JpegEncoder::PutBits(uint32_t code, uint32_t size) {
+  bit_buffer_ = (bit_buffer_ << size) | code;
+  bit_count_ += size;
+  while (bit_count_ >= 8) {
+    bit_count_ -= 8;
+    uint8_t byte = static_cast<uint8_t>(bit_buffer_ >> bit_count_);
+    out_->push_back(byte);
+    if (byte == 0xff) out_->push_back(0);  // byte stuffing
+  }
+}
+
+void JpegEncoder::FlushBits() {
+  // pad with 1 bits
+  if (bit_count_) PutBits((1u << (8 - bit_count_)) - 1, 8 - bit_count_);
+  bit_buffer_ = 0;
+}
+
+void JpegEncoder::EncodeBlock(float *block, const float *divisors, const Huffman &dc, const Huffman &ac,
+                              int *last_dc) {
+  // the block is filled transposed, the first pass transforms rows
+  Dct8(block);
+  Dct8(block + 4);
+  Transpose8x8(block);
+  Dct8(block);
+  Dct8(block + 4);
+  int32_t coefs[64];
+  for (int i = 0; i < 64; i += 4) VRound(VMul(VLoad(block + i), VLoad(divisors + i)), coefs + i);
+
+  int32_t diff = coefs[0] - *last_dc;
+  *last_dc = coefs[0];
+  uint32_t nbits = BitLength(diff);
+  PutBits(dc.code[nbits], dc.size[nbits]);
+  if (nbits) PutBits((diff < 0 ? diff - 1 : diff) & ((1u << nbits) - 1), nbits);
+
+  uint32_t run = 0;
+  for (int k = 1; k < 64; ++k) {
+    int32_t value = coefs[kZigzag[k]];
+    if (!value) {
+      ++run;
+      continue;
+    }
+    for (; run > 15; run -= 16) PutBits(ac.code[0xf0], ac.size[0xf0]);
+    nbits = BitLength(value);
+    const uint32_t symbol = (run << 4) | nbits;
+    PutBits(ac.code[symbol], ac.size[symbol]);
+    PutBits((value < 0 ? value - 1 : value) & ((1u << nbits) - 1), nbits);
+    run = 0;
+  }
+  if (run) PutBits(ac.code[0], ac.size[0]);  // end of block
+}
+
+bool JpegEncoder::Encode(const JpegImage &image, std::vector<uint8_t> *out) {
+  const uint32_t width = image.width, height = image.height;
+  const bool yuv = image.format == CNEDK_BUF_COLOR_FORMAT_NV12 || image.format == CNEDK_BUF_COLOR_FORMAT_NV21;
+  const bool rgb = image.format == CNEDK_BUF_COLOR_FORMAT_BGR || image.format == CNEDK_BUF_COLOR_FORMAT_RGB;
+  if (!out || (!yuv && !rgb) || !width || !height || width > 65535 || height > 65535 || !image.planes[0] ||
+      (yuv && !image.planes[1])) {
+    return false;
+  }
+  out->clear();
+  // a rough guess to avoid reallocation in most cases
+  out->reserve(1024 + width * height / 2);
+  WriteHeaders(width, height, out);
+  out_ = out;
+  bit_buffer_ = 0;
+  bit_count_ = 0;
+
+  float y_blocks[4][64], cb_block[64], cr_block[64];
+  int dc[3] = {0, 0, 0};
+  const uint32_t chroma_width = (width + 1) / 2, chroma_height = (height + 1) / 2;
+  // chroma offsets of yuv420sp, red and blue offsets of packed pixels
+  const uint32_t u = image.format == CNEDK_BUF_COLOR_FORMAT_NV21 ? 1 : 0;
+  const uint32_t r = image.format == CNEDK_BUF_COLOR_FORMAT_BGR ? 2 : 0;
+  for (uint32_t y0 = 0; y0 < height; y0 += 16) {
+    for (uint32_t x0 = 0; x0 < width; x0 += 16) {
+      // edges are padded by repeating the last row and column
+      uint32_t xs[16];
+      for (uint32_t c = 0; c < 16; ++c) xs[c] = std::min(x0 + c, width - 1);
+      if (yuv) {
+        // yuv420sp is BT.601 in video range as in the transforms, expanded to the full range of JFIF
+        for (uint32_t row = 0; row < 16; ++row) {
+          const uint8_t *src = image.planes[0] + std::min(y0 + row, height - 1) * image.strides[0];
+          float *block = y_blocks[(row / 8) * 2] + row % 8;
+          for (uint32_t c = 0; c < 8; ++c) block[c * 8] = (src[xs[c]] - 16) * kLumaScale - 128.0f;
+          block = y_blocks[(row / 8) * 2 + 1] + row % 8;
+          for (uint32_t c = 0; c < 8; ++c) block[c * 8] = (src[xs[c + 8]] - 16) * kLumaScale - 128.0f;
+        }
+        for (uint32_t row = 0; row < 8; ++row) {
+          const uint8_t *src = image.planes[1] + std::min(y0 / 2 + row, chroma_height - 1) * image.strides[1];
+          for (uint32_t c = 0; c < 8; ++c) {
+            const uint8_t *uv = src + 2 * std::min(x0 / 2 + c, chroma_width - 1);
+            cb_block[c * 8 + row] = (uv[u] - 128) * kChromaScale;
+            cr_block[c * 8 + row] = (uv[1 - u] - 128) * kChromaScale;
+          }
+        }
+      } else {
+        // JFIF YCbCr in full range, chroma is taken from the average of 2x2 pixels
+        float sums[8][8][3];
+        memset(sums, 0, sizeof(sums));
+        for (uint32_t row = 0; row < 16; ++row) {
+          const uint8_t *src = image.planes[0] + std::min(y0 + row, height - 1) * image.strides[0];
+          for (uint32_t c = 0; c < 16; ++c) {
+            const uint8_t *pix = src + 3 * xs[c];
+            const float red = pix[r], green = pix[1], blue = pix[2 - r];
+            y_blocks[(row / 8) * 2 + c / 8][(c % 8) * 8 + row % 8] =
+                0.299f * red + 0.587f * green + 0.114f * blue - 128.0f;
+            float *sum = sums[row / 2][c / 2];
+            sum[0] += red;
+            sum[1] += green;
+            sum[2] += blue;
+          }
+        }
+        for (uint32_t row = 0; row < 8; ++row) {
+          for (uint32_t c = 0; c < 8; ++c) {
+            const float *sum = sums[row][c];
+            cb_block[c * 8 + row] = (-0.168736f * sum[0] - 0.331264f * sum[1] + 0.5f * sum[2]) * 0.25f;
+            cr_block[c * 8 + row] = (0.5f * sum[0] - 0.418688f * sum[1] - 0.081312f * sum[2]) * 0.25f;
+          }
+        }
+      }
+      for (int b = 0; b < 4; ++b) EncodeBlock(y_blocks[b], divisors_[0], huffman_[0], huffman_[1], &dc[0]);
+      EncodeBlock(cb_block, divisors_[1], huffman_[2], huffman_[3], &dc[1]);
+      EncodeBlock(cr_block, divisors_[1], huffman_[2], huffman_[3], &dc[2]);
+    }
+  }
+  FlushBits();
+  out->push_back(0xff);
+  out->push_back(0xd9);  // EOI
+  out_ = nullptr;
+  return true;
+}
+
+}  // namespace cnedk
@@ -0,0 +1,77 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef EASYDK_COMMON_JPEG_ENCODER_HPP_
+#define EASYDK_COMMON_JPEG_ENCODER_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "cnedk_buf_surface.h"
+
+namespace cnedk {
+
+// An image in host memory to be encoded.
+struct JpegImage {
+  CnedkBufSurfaceColorFormat format;  // NV12 or NV21 in BT.601 video range, BGR or RGB
+  uint32_t width;
+  uint32_t height;
+  const uint8_t *planes[2];  // luma and interleaved chroma for yuv420sp, packed pixels for rgb
+  uint32_t strides[2];
+};
+
+/**
+ * Baseline JPEG encoder, YCbCr 4:2:0 with the standard Huffman tables.
+ *
+ * The forward DCT is the AAN algorithm in float, vectorized with SSE2 or NEON when available. Quantization is fused
+ * with the scaling of AAN. Not thread safe, use one per thread.
+ */
+class JpegEncoder {
+ public:
+  JpegEncoder();
+  // quality is from 1 to 100, the same scaling of quantization tables as libjpeg
+  void SetQuality(int quality);
+  int GetQuality() const { return quality_; }
+  // Replaces the content of out with the JPEG file. Returns false if the image is not supported.
+  bool Encode(const JpegImage &image, std::vector<uint8_t> *out);
+
+ private:
+  struct Huffman {
+    uint16_t code[256];
+    uint8_t size[256];
+  };
+  void WriteHeaders(uint32_t width, uint32_t height, std::vector<uint8_t> *out) const;
+  void EncodeBlock(float *block, const float *divisors, const Huffman &dc, const Huffman &ac, int *last_dc);
+  void PutBits(uint32_t code, uint32_t size);
+  void FlushBits();
+
+  int quality_ = 0;
+  uint8_t qtables_[2][64];   // in natural order
+  float divisors_[2][64];    // reciprocal of quantization steps, scaled for AAN
+  Huffman huffman_[4];       // luma dc, luma ac, chroma dc, chroma ac
+  // bit writer
+  std::vector<uint8_t> *out_ = nullptr;
+  uint64_t bit_buffer_ = 0;
+  uint32_t bit_count_ = 0;
+};
+
+}  // namespace cnedk
+
+#endif  // EASYDK_COMMON_JPEG_ENCODER_HPP_
@@ -24,22 +24,17 @@
 
 #include "glog/logging.h"
 
-#include "cnedk_platform.h"
+#include "cnedk_platform_caps.hpp"
 
 namespace cnedk {
 
 bool IsEdgePlatform(int device_id) {
-  CnedkPlatformInfo platform_info;
-  if (CnedkPlatformGetInfo(device_id, &platform_info) != 0) {
-    LOG(ERROR) << "[EasyDK] IsEdgePlatform(): CnedkPlatformGetInfo failed";
+  const DeviceCaps *caps = PlatformCaps::Instance().GetDevice(device_id);
+  if (!caps) {
+    LOG(ERROR) << "[EasyDK] IsEdgePlatform(): Get platform information failed";
     return false;
   }
-
-  std::string platform_name(platform_info.name);
-  if (platform_name.rfind("CE", 0) == 0) {
-    return true;
-  }
-  return false;
+  return IsEdgePlatform(caps->name);
 }
 
 bool IsEdgePlatform(const std::string& platform_name) {
@@ -50,17 +45,12 @@ bool IsEdgePlatform(const std::string& platform_name) {
 }
 
 bool IsCloudPlatform(int device_id) {
-  CnedkPlatformInfo platform_info;
-  if (CnedkPlatformGetInfo(device_id, &platform_info) != 0) {
-    LOG(ERROR) << "[EasyDK] IsCloudPlatform(): CnedkPlatformGetInfo failed";
+  const DeviceCaps *caps = PlatformCaps::Instance().GetDevice(device_id);
+  if (!caps) {
+    LOG(ERROR) << "[EasyDK] IsCloudPlatform(): Get platform information failed";
     return false;
   }
-
-  std::string platform_name(platform_info.name);
-  if (platform_name.rfind("MLU", 0) == 0) {
-    return true;
-  }
-  return false;
+  return IsCloudPlatform(caps->name);
 }
 
 bool IsCloudPlatform(const std::string& platform_name) {
@@ -0,0 +1,57 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "vdec_format_tracker.hpp"
+
+#include "glog/logging.h"
+
+namespace cnedk {
+
+void VdecFormatTracker::Reset() {
+  info_ = CnedkVdecFormatInfo{0, 0, CNEDK_BUF_COLOR_FORMAT_INVALID, 0};
+  initialized_ = false;
+}
+
+int VdecFormatTracker::Update(const CnedkVdecCreateParams &params, uint32_t width, uint32_t height,
+                              CnedkBufSurfaceColorFormat fmt) {
+  if (!initialized_) {
+    // the first format is generation 0, it is not a change
+    info_.width = width;
+    info_.height = height;
+    info_.color_format = fmt;
+    initialized_ = true;
+    return 0;
+  }
+  if (info_.width == width && info_.height == height && info_.color_format == fmt) return 0;
+
+  VLOG(1) << "[EasyDK] [VdecFormatTracker] Update(): Format changed from " << info_.width << "x" << info_.height
+          << " (" << info_.color_format << ") to " << width << "x" << height << " (" << fmt << "), generation: "
+          << info_.generation + 1;
+  CnedkVdecFormatInfo info{width, height, fmt, info_.generation + 1};
+  // the new format is committed only if it is accepted, otherwise it is reported again with the next frame
+  if (params.OnFormatChange && params.OnFormatChange(&info, params.userdata) < 0) {
+    LOG(ERROR) << "[EasyDK] [VdecFormatTracker] Update(): OnFormatChange failed, generation: " << info.generation;
+    return -1;
+  }
+  info_ = info;
+  return 1;
+}
+
+}  // namespace cnedk
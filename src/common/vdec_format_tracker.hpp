@@ -0,0 +1,57 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef EASYDK_COMMON_VDEC_FORMAT_TRACKER_HPP_
+#define EASYDK_COMMON_VDEC_FORMAT_TRACKER_HPP_
+
+#include <cstdint>
+
+#include "cnedk_buf_surface.h"
+#include "cnedk_decode.h"
+
+namespace cnedk {
+
+/**
+ * Tracks the format of frames coming out of a decoder. Decoders output frames in order, so when the format of a frame
+ * differs from the previous one, all frames of the old format have been delivered. The tracker notifies
+ * OnFormatChange at that point and stamps every surface with the current generation.
+ *
+ * Not thread-safe, it is used by the thread outputting frames.
+ */
+class VdecFormatTracker {
+ public:
+  void Reset();
+  /**
+   * Updates the format with a decoded frame, must be called before GetBufSurf.
+   * Returns 1 if the format changed, 0 if not, -1 if OnFormatChange reported an error. The format is not changed on
+   * error, the frame should be dropped.
+   */
+  int Update(const CnedkVdecCreateParams &params, uint32_t width, uint32_t height, CnedkBufSurfaceColorFormat fmt);
+  void Stamp(CnedkBufSurface *surf) const { CnedkBufSurfaceSetGeneration(surf, info_.generation); }
+  uint32_t Generation() const { return info_.generation; }
+
+ private:
+  CnedkVdecFormatInfo info_{0, 0, CNEDK_BUF_COLOR_FORMAT_INVALID, 0};
+  bool initialized_ = false;
+};  // class VdecFormatTracker
+
+}  // namespace cnedk
+
+#endif  // EASYDK_COMMON_VDEC_FORMAT_TRACKER_HPP_
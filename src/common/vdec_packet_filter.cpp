@@ -0,0 +1,95 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "vdec_packet_filter.hpp"
+
+#include <vector>
+
+#include "bitstream_parser.hpp"
+
+namespace cnedk {
+
+static const uint8_t kStartCode[] = {0, 0, 0, 1};
+
+void VdecPacketFilter::Init(CnedkVdecType type, CnedkVdecDecodeMode mode, uint32_t interval) {
+  mode_ = mode;
+  hevc_ = type == CNEDK_VDEC_TYPE_H265;
+  enabled_ = mode != CNEDK_VDEC_DECODE_MODE_ALL && (type == CNEDK_VDEC_TYPE_H264 || type == CNEDK_VDEC_TYPE_H265);
+  interval_ = interval ? interval : 1;
+  key_frame_count_ = 0;
+  key_frame_found_ = false;
+  param_sets_.clear();
+  stats_ = Stats{0, 0};
+}
+
+bool VdecPacketFilter::Accept(bool key_frame, bool reference) {
+  if (key_frame) {
+    key_frame_found_ = true;
+    return key_frame_count_++ % interval_ == 0;
+  }
+  // frames before the first key frame can not be decoded correctly
+  return mode_ == CNEDK_VDEC_DECODE_MODE_REFERENCE && key_frame_found_ && reference;
+}
+
+const CnedkVdecStream *VdecPacketFilter::Filter(const CnedkVdecStream *stream) {
+  if (!enabled_ || !stream->bits || !stream->len) return stream;
+
+  std::vector<NalUnit> nalus;
+  SplitAnnexB(stream->bits, stream->len, &nalus);
+  bool has_slice = false, key_frame = false, reference = false, has_param_sets = false;
+  for (const auto &nalu : nalus) {
+    if (IsParamSetNal(nalu, hevc_)) {
+      has_param_sets = true;
+    } else if (IsSliceNal(nalu, hevc_)) {
+      has_slice = true;
+      key_frame = key_frame || IsKeyNal(nalu, hevc_);
+      reference = reference || IsReferenceNal(nalu, hevc_);
+    }
+  }
+  if (!has_slice) return stream;
+
+  stats_.frames++;
+  if (!Accept(key_frame, reference)) {
+    stats_.dropped_frames++;
+    if (has_param_sets) {
+      param_sets_.clear();
+      for (const auto &nalu : nalus) {
+        if (!IsParamSetNal(nalu, hevc_)) continue;
+        param_sets_.insert(param_sets_.end(), kStartCode, kStartCode + sizeof(kStartCode));
+        param_sets_.insert(param_sets_.end(), nalu.data, nalu.data + nalu.size);
+      }
+    }
+    return nullptr;
+  }
+  if (param_sets_.empty() || has_param_sets) {
+    param_sets_.clear();
+    return stream;
+  }
+
+  buffer_ = param_sets_;
+  buffer_.insert(buffer_.end(), stream->bits, stream->bits + stream->len);
+  param_sets_.clear();
+  stream_ = *stream;
+  stream_.bits = buffer_.data();
+  stream_.len = buffer_.size();
+  return &stream_;
+}
+
+}  // namespace cnedk
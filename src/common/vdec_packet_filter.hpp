@@ -0,0 +1,70 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef EASYDK_COMMON_VDEC_PACKET_FILTER_HPP_
+#define EASYDK_COMMON_VDEC_PACKET_FILTER_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "cnedk_decode.h"
+
+namespace cnedk {
+
+/**
+ * Selects packets to be decoded by NAL unit types according to the decode mode. Each packet is supposed to hold one
+ * access unit.
+ *
+ * Packets without slices are always sent. Parameter sets of a dropped packet are kept and sent along with the next
+ * accepted one, so that the decoder does not miss them.
+ */
+class VdecPacketFilter {
+ public:
+  struct Stats {
+    uint64_t frames;          // packets holding slices
+    uint64_t dropped_frames;
+  };
+
+  void Init(CnedkVdecType type, CnedkVdecDecodeMode mode, uint32_t interval);
+  /**
+   * Returns the packet to be sent to decoder, or nullptr if it is dropped.
+   * The returned packet is valid until the next call.
+   */
+  const CnedkVdecStream *Filter(const CnedkVdecStream *stream);
+  Stats GetStats() const { return stats_; }
+
+ private:
+  bool Accept(bool key_frame, bool reference);
+
+  CnedkVdecDecodeMode mode_ = CNEDK_VDEC_DECODE_MODE_ALL;
+  bool hevc_ = false;
+  bool enabled_ = false;
+  uint32_t interval_ = 1;
+  uint64_t key_frame_count_ = 0;
+  bool key_frame_found_ = false;
+  std::vector<uint8_t> param_sets_;  // parameter sets of dropped packets
+  std::vector<uint8_t> buffer_;
+  CnedkVdecStream stream_;
+  Stats stats_{0, 0};
+};  // class VdecPacketFilter
+
+}  // namespace cnedk
+
+#endif  // EASYDK_COMMON_VDEC_PACKET_FILTER_HPP_
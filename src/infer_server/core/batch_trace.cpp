@@ -0,0 +1,82 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnis/infer_server.h"
+
+namespace infer_server {
+
+std::vector<BatchTrace::Batch> BatchTrace::GetBatches() const noexcept {
+  std::lock_guard<std::mutex> lk(mutex_);
+  return batches_;
+}
+
+void BatchTrace::Record(Batch&& batch) noexcept {
+  std::lock_guard<std::mutex> lk(mutex_);
+  batches_.emplace_back(std::move(batch));
+}
+
+std::string BatchTrace::Serialize() const noexcept {
+  std::ostringstream ss;
+  std::lock_guard<std::mutex> lk(mutex_);
+  for (auto& batch : batches_) {
+    for (size_t idx = 0; idx < batch.size(); ++idx) {
+      if (idx) ss << " ";
+      ss << batch[idx].first << ":" << batch[idx].second;
+    }
+    ss << "\n";
+  }
+  return ss.str();
+}
+
+bool BatchTrace::Parse(const std::string& text, std::vector<Batch>* batches) noexcept {
+  if (!batches) return false;
+  std::vector<Batch> parsed;
+  std::istringstream lines(text);
+  std::string line;
+  while (std::getline(lines, line)) {
+    std::istringstream items(line);
+    std::string item;
+    Batch batch;
+    while (items >> item) {
+      size_t pos = item.find(':');
+      if (pos == std::string::npos || pos == 0 || pos + 1 == item.size()) return false;
+      try {
+        size_t end;
+        int64_t request_id = std::stoll(item.substr(0, pos), &end);
+        if (end != pos) return false;
+        uint32_t index = std::stoul(item.substr(pos + 1), &end);
+        if (end != item.size() - pos - 1) return false;
+        batch.emplace_back(request_id, index);
+      } catch (std::exception&) {
+        return false;
+      }
+    }
+    if (!batch.empty()) parsed.emplace_back(std::move(batch));
+  }
+  *batches = std::move(parsed);
+  return true;
+}
+
+}  // namespace infer_server
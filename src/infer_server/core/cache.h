@@ -90,14 +90,28 @@ class CacheBase {
 
   virtual void Flush() noexcept {}
 
+  // set before Start
+  void SetBatchTrace(std::shared_ptr<BatchTrace> trace) noexcept { trace_ = std::move(trace); }
+
  protected:
   virtual void Enqueue(PackagePtr&& pack) noexcept = 0;
   virtual void ClearDiscard(PackagePtr pack) noexcept = 0;
 
+  void RecordBatch(const BatchData& data) noexcept {
+    if (!trace_) return;
+    BatchTrace::Batch batch;
+    batch.reserve(data.size());
+    for (auto& it : data) {
+      batch.emplace_back(it->ctrl->RequestId(), it->index);
+    }
+    trace_->Record(std::move(batch));
+  }
+
  protected:
   std::list<PackagePtr> cache_;
   std::mutex cache_mutex_;
   std::condition_variable cache_cond_;
+  std::shared_ptr<BatchTrace> trace_{nullptr};
 
  private:
   uint32_t batch_size_;
@@ -109,17 +123,8 @@ class CacheDynamic : public CacheBase {
  public:
   CacheDynamic(uint32_t batch_size, const Priority& priority, uint32_t batch_timeout)
       : CacheBase(batch_size, priority) {
-    batcher_.reset(new Batcher<InferDataPtr>(
-        [this](BatchData&& data) {
-          auto pack = std::make_shared<Package>();
-          pack->priority = GetPriority().Get(-data.at(0)->ctrl->RequestId());
-          pack->data = std::move(data);
-          std::unique_lock<std::mutex> lk(cache_mutex_);
-          cache_.emplace_back(std::move(pack));
-          lk.unlock();
-          cache_cond_.notify_all();
-        },
-        batch_timeout, BatchSize()));
+    batcher_.reset(new Batcher<InferDataPtr>([this](BatchData&& data) { EmitBatch(std::move(data)); },
+                                             batch_timeout, BatchSize()));
   }
 
   ~CacheDynamic() {
@@ -129,11 +134,13 @@ class CacheDynamic : public CacheBase {
   }
 
   void Flush() noexcept override {
+    EmitReplaying();
     batcher_->Emit();
   }
 
   void Stop() noexcept override {
     CacheBase::Stop();
+    EmitReplaying();
     batcher_->Emit();
     cache_cond_.notify_all();
   }
@@ -146,6 +153,8 @@ class CacheDynamic : public CacheBase {
     do {
       cache_.pop_front();
       for (auto& it : pack->data) {
+        // data will be rebatched, take back the reference to continuous data
+        if (pack->predict_io) it->predict_io = pack->predict_io;
         RequestControl* ctrl = it->ctrl;
         if (!ctrl->IsDiscarded()) {
           cache.emplace_back(std::move(it));
@@ -169,12 +178,81 @@ class CacheDynamic : public CacheBase {
   void Enqueue(PackagePtr&& pack) noexcept override {
     for (auto& it : pack->data) {
       CHECK(it->ctrl) << "[EasyDK InferServer] [CacheDynamic] Enqueue pack. It should not be empty";
+      if (trace_ && trace_->IsReplay() && Replay(&it)) continue;
       batcher_->AddItem(std::move(it));
     }
   }
 
  private:
+  void EmitBatch(BatchData&& data) noexcept {
+    RecordBatch(data);
+    auto pack = std::make_shared<Package>();
+    pack->priority = GetPriority().Get(-data.at(0)->ctrl->RequestId());
+    pack->data = std::move(data);
+    UseContinuousDataIfWhole(pack.get());
+    std::unique_lock<std::mutex> lk(cache_mutex_);
+    cache_.emplace_back(std::move(pack));
+    lk.unlock();
+    cache_cond_.notify_all();
+  }
+
+  // batch data as the trace, returns false if replay has ended
+  bool Replay(InferDataPtr* data) noexcept {
+    std::lock_guard<std::mutex> lk(replay_mutex_);
+    if (replay_end_) return false;
+    const BatchTrace::Batch* batch = trace_->GetReplayBatch(replay_index_);
+    const std::pair<int64_t, uint32_t> id((*data)->ctrl->RequestId(), (*data)->index);
+    if (!batch || batch->empty() || (*batch)[replaying_.size()] != id) {
+      if (batch) {
+        LOG(WARNING) << "[EasyDK InferServer] [CacheDynamic] Data (" << id.first << ", " << id.second
+                     << ") does not match batch trace, replay ends at batch " << replay_index_;
+      }
+      replay_end_ = true;
+      for (auto& it : replaying_) batcher_->AddItem(std::move(it));
+      replaying_.clear();
+      return false;
+    }
+    replaying_.emplace_back(std::move(*data));
+    if (replaying_.size() == batch->size()) {
+      EmitBatch(std::move(replaying_));
+      replaying_.clear();
+      ++replay_index_;
+    }
+    return true;
+  }
+
+  // emit incomplete batch being replayed, to not wait for data that never comes
+  void EmitReplaying() noexcept {
+    std::lock_guard<std::mutex> lk(replay_mutex_);
+    if (replaying_.empty()) return;
+    EmitBatch(std::move(replaying_));
+    replaying_.clear();
+    ++replay_index_;
+  }
+
+  // If the batch is exactly one whole request with continuous data of full batch size, pass the continuous data
+  // through to avoid copy. Otherwise each data keeps a reference to its slice and Predictor gathers them into one
+  // batch.
+  void UseContinuousDataIfWhole(Package* pack) noexcept {
+    const InferDataPtr& source = pack->data[0]->predict_io;
+    if (!source || pack->data.size() != BatchSize()) return;
+    RequestControl* ctrl = pack->data[0]->ctrl;
+    if (ctrl->DataNum() != pack->data.size()) return;
+    for (size_t idx = 0; idx < pack->data.size(); ++idx) {
+      const InferDataPtr& it = pack->data[idx];
+      if (it->ctrl != ctrl || it->predict_io != source || it->io_index != idx) return;
+    }
+    pack->predict_io = source;
+    for (auto& it : pack->data) {
+      it->predict_io.reset();
+    }
+  }
+
   std::unique_ptr<Batcher<InferDataPtr>> batcher_;
+  std::mutex replay_mutex_;
+  BatchData replaying_;
+  size_t replay_index_{0};
+  bool replay_end_{false};
 };
 
 class CacheStatic : public CacheBase {
@@ -204,6 +282,7 @@ class CacheStatic : public CacheBase {
   }
 
   inline void ThreadsafePush(PackagePtr&& in) noexcept {
+    RecordBatch(in->data);
     std::unique_lock<std::mutex> lk(cache_mutex_);
     cache_.emplace_back(std::forward<PackagePtr>(in));
     lk.unlock();
@@ -21,9 +21,13 @@
 #include "data_type.h"
 
 #include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 #include "cnis/processor.h"
+#include "host_tensor.h"
 
 namespace infer_server {
 namespace detail {
@@ -36,9 +40,15 @@ namespace detail {
     }                                                  \
   } while (0)
 
-inline std::vector<int> GetTransOrderAxis(DimOrder src, DimOrder dst, size_t n_dims) {
+std::vector<int> GetTransOrderAxis(DimOrder src, DimOrder dst, size_t n_dims) {
   std::vector<int> axis;
-  if (src == DimOrder::NCHW && dst == DimOrder::NHWC) {
+  const std::string src_str = DimOrderStr(src);
+  const std::string dst_str = DimOrderStr(dst);
+  if (src == dst) {
+    VLOG(3) << "[EasyDK InferServer] GetTransOrderAxis(): Do not transform order";
+    axis.resize(n_dims);
+    std::iota(axis.begin(), axis.end(), 0);
+  } else if (src == DimOrder::NCHW && dst == DimOrder::NHWC) {
     axis.resize(n_dims, 0);
     VLOG(5) << "[EasyDK InferServer] GetTransOrderAxis(): Transform NCHW to NHWC";
     for (size_t i = 1; i < n_dims - 1; ++i) {
@@ -52,19 +62,26 @@ inline std::vector<int> GetTransOrderAxis(DimOrder src, DimOrder dst, size_t n_d
     for (size_t i = 2; i < n_dims; ++i) {
       axis[i] = i - 1;
     }
-  } else if (src == dst) {
-    VLOG(3) << "[EasyDK InferServer] GetTransOrderAxis(): Do not transform order";
+  } else if (src_str.size() == n_dims && dst_str.size() == n_dims &&
+             std::is_permutation(src_str.begin(), src_str.end(), dst_str.begin())) {
+    // orders named by their dims, such as HWCN and TNC
+    VLOG(5) << "[EasyDK InferServer] GetTransOrderAxis(): Transform " << src_str << " to " << dst_str;
+    for (char dim : dst_str) {
+      axis.push_back(src_str.find(dim));
+    }
   } else {
-    std::string msg = "Unsupported data order: (src) " + DimOrderStr(src) + ", (dst) " + DimOrderStr(dst);
+    std::string msg = "Unsupported data order: (src) " + src_str + ", (dst) " + dst_str;
     LOG(ERROR) << "[EasyDK InferServer] GetTransOrderAxis(): " << msg;
     throw std::runtime_error(msg);
   }
   return axis;
 }
 
-bool CastDataType(void *src_data, void *dst_data, DataType src_dtype, DataType dst_dtype, const Shape &shape) {
+bool CastDataType(void *src_data, void *dst_data, DataType src_dtype, DataType dst_dtype, const Shape &shape,
+                  bool on_host) {
   if (src_dtype != dst_dtype) {
     int size = shape.BatchDataCount();
+    if (on_host) return HostCastDataType(src_data, dst_data, src_dtype, dst_dtype, size);
     cnrtRet_t error_code = cnrtSuccess;
     error_code = cnrtCastDataType(src_data, detail::CastDataType(src_dtype), dst_data, detail::CastDataType(dst_dtype),
                                   size, nullptr);
@@ -73,6 +90,22 @@ bool CastDataType(void *src_data, void *dst_data, DataType src_dtype, DataType d
   return true;
 }
 
+bool TransLayout(void *src_data, void *dst_data, DataLayout src_layout, DataLayout dst_layout, const Shape &shape) {
+  std::vector<int> axis;
+  try {
+    axis = GetTransOrderAxis(src_layout.order, dst_layout.order, shape.Size());
+  } catch (std::runtime_error &) {
+    return false;
+  }
+  if (src_layout.quant.scales.empty() && dst_layout.quant.scales.empty()) {
+    return HostCastTranspose(src_data, dst_data, src_layout.dtype, dst_layout.dtype, shape.Vectorize(), axis);
+  }
+  // quantization parameters follow src dims, cast before transpose
+  std::vector<uint8_t> casted(shape.BatchDataCount() * GetTypeSize(dst_layout.dtype));
+  return HostCastDataType(src_data, casted.data(), src_layout, dst_layout, shape.Vectorize()) &&
+         HostTranspose(casted.data(), dst_data, dst_layout.dtype, shape.Vectorize(), axis);
+}
+
 }  // namespace detail
 
 size_t GetTypeSize(DataType type) noexcept {
@@ -87,10 +120,23 @@ size_t GetTypeSize(DataType type) noexcept {
       return sizeof(int32_t);
     case DataType::INT16:
       return sizeof(int16_t);
+    case DataType::INT8:
+      return sizeof(int8_t);
+    case DataType::BF16:
+      return sizeof(uint16_t);
+    case DataType::INT64:
+      return sizeof(int64_t);
+    case DataType::BOOL:
+      return sizeof(uint8_t);
     default:
       LOG(ERROR) << "[EasyDK InferServer] GetTypeSize(): Unsupported data type";
       return 0;
   }
 }
 
+bool CastHostData(const void* src, void* dst, const DataLayout& src_layout, const DataLayout& dst_layout,
+                  const Shape& shape) noexcept {
+  return detail::HostCastDataType(src, dst, src_layout, dst_layout, shape.Vectorize());
+}
+
 }  // namespace infer_server
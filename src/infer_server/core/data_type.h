@@ -50,6 +50,10 @@ inline std::string DataTypeStr(DataType type) noexcept {
     DATATYPE2STR(FLOAT32)
     DATATYPE2STR(INT32)
     DATATYPE2STR(INT16)
+    DATATYPE2STR(INT8)
+    DATATYPE2STR(BF16)
+    DATATYPE2STR(INT64)
+    DATATYPE2STR(BOOL)
 #undef DATATYPE2STR
     default:
       LOG(ERROR) << "[EasyDK InferServer] DataTypeStr(): Unsupported data type";
@@ -86,6 +90,9 @@ inline cnrtDataType CastDataType(DataType type) noexcept {
     RETURN_DATA_TYPE(FLOAT32)
     RETURN_DATA_TYPE(INT32)
     RETURN_DATA_TYPE(INT16)
+    RETURN_DATA_TYPE(INT8)
+    RETURN_DATA_TYPE(INT64)
+    RETURN_DATA_TYPE(BOOL)
 #undef RETURN_DATA_TYPE
     default:
       LOG(ERROR) << "[EasyDK InferServer] CastDataType(): Unsupported data type";
@@ -103,7 +110,12 @@ inline DataType CastDataType(magicmind::DataType type) noexcept {
     RETURN_DATA_TYPE(FLOAT32)
     RETURN_DATA_TYPE(INT32)
     RETURN_DATA_TYPE(INT16)
+    RETURN_DATA_TYPE(INT8)
+    RETURN_DATA_TYPE(INT64)
+    RETURN_DATA_TYPE(BOOL)
 #undef RETURN_DATA_TYPE
+    case magicmind::DataType::BFLOAT16:
+      return DataType::BF16;
     default:
       LOG(ERROR) << "[EasyDK InferServer] CastDataType(): Unsupported MagicMind data type";
       return DataType::INVALID;
@@ -120,6 +132,9 @@ inline DataType CastDataType(cnrtDataType type) noexcept {
     RETURN_DATA_TYPE(FLOAT32)
     RETURN_DATA_TYPE(INT32)
     RETURN_DATA_TYPE(INT16)
+    RETURN_DATA_TYPE(INT8)
+    RETURN_DATA_TYPE(INT64)
+    RETURN_DATA_TYPE(BOOL)
 #undef RETURN_DATA_TYPE
     default:
       LOG(ERROR) << "[EasyDK InferServer] CastDataType(): Unsupported CNRT data type";
@@ -149,8 +164,15 @@ inline DimOrder CastDimOrder(magicmind::Layout order) noexcept {
   }
 }
 
-// shape corresponding to src_data
-bool CastDataType(void *src_data, void *dst_data, DataType src_dtype, DataType dst_dtype, const Shape &shape);
+// shape corresponding to src_data, cast on host if both buffers are host-resident
+bool CastDataType(void *src_data, void *dst_data, DataType src_dtype, DataType dst_dtype, const Shape &shape,
+                  bool on_host = false);
+
+// axis for transpose from src order to dst order, dim i of dst is dim axis[i] of src
+std::vector<int> GetTransOrderAxis(DimOrder src, DimOrder dst, size_t n_dims);
+
+// transpose and cast host-resident src_data into dst_data in a single pass, shape corresponding to src_data
+bool TransLayout(void *src_data, void *dst_data, DataLayout src_layout, DataLayout dst_layout, const Shape &shape);
 
 }  // namespace detail
 
@@ -27,6 +27,7 @@
 #include <utility>
 #include <vector>
 
+#include "cnis/processor.h"
 #include "profile.h"
 #include "request_ctrl.h"
 #include "session.h"
@@ -34,6 +35,11 @@
 namespace infer_server {
 
 void TaskNode::Execute(PackagePtr pack) {
+  if (shared_) {
+    // inferred by predictors shared with other executors, maybe merged with their packs
+    shared_->Submit(shared_idx_, std::move(pack), [this](PackagePtr p, Status s) { Finish(std::move(p), s); });
+    return;
+  }
   Status s;
 #if defined(CNIS_RECORD_PERF) && (!defined(NDEBUG))
   auto before_lock = Clock::Now();
@@ -41,25 +47,53 @@ void TaskNode::Execute(PackagePtr pack) {
   std::unique_lock<std::mutex> lk = processor_->Lock();
 #ifdef CNIS_RECORD_PERF
   auto start = Clock::Now();
+  double cpu_start = Clock::ThreadCpuTime();
+  size_t in_bytes = stage_ == Stage::INFER ? ModelIOBytes(pack->predict_io) : 0;
 #endif
   s = processor_->Process(pack);
   lk.unlock();
-  const std::string& type_name = processor_->TypeName();
 #ifdef CNIS_RECORD_PERF
   auto end = Clock::Now();
+  const std::string& type_name = processor_->TypeName();
   pack->perf[type_name] = Clock::Duration(start, end);
 #ifndef NDEBUG
   pack->perf["-WaitLock-" + type_name] = Clock::Duration(before_lock, start);
 #endif
+  if (!pack->data.empty()) {
+    // usage of batch is prorated by share of each data
+    double share = 1.0 / pack->data.size();
+    UsageStatistic usage;
+    switch (stage_) {
+      case Stage::PREPROC:
+        usage.preproc_cpu_time = (Clock::ThreadCpuTime() - cpu_start) * share;
+        break;
+      case Stage::POSTPROC:
+        usage.postproc_cpu_time = (Clock::ThreadCpuTime() - cpu_start) * share;
+        break;
+      case Stage::INFER:
+        usage.device_time = Clock::Duration(start, end) * share;
+        usage.bytes = (in_bytes + ModelIOBytes(pack->predict_io)) * share;
+        break;
+    }
+    for (auto& it : pack->data) {
+      if (stage_ == Stage::PREPROC) it->ctrl->ProcessStart(start);
+      it->ctrl->AddUsage(usage);
+    }
+  }
 #endif
+  Finish(std::move(pack), s);
+}
+
+void TaskNode::Finish(PackagePtr&& pack, Status s) noexcept {
   if (s != Status::SUCCESS) {
-    LOG(ERROR) << "[EasyDK InferServer] [TaskNode] Execute(): processor [" << type_name << "] execute failed";
+    LOG(ERROR) << "[EasyDK InferServer] [TaskNode] Execute(): processor [" << processor_->TypeName()
+               << "] execute failed";
     for (auto& it : pack->data) {
       it->ctrl->ProcessFailed(s);
     }
     done_notifier_();
   } else {
-    VLOG(4) << "[EasyDK InferServer] [TaskNode] Execute(): Transmit data for " << type_name;
+    VLOG(4) << "[EasyDK InferServer] [TaskNode] Execute(): Transmit data for " << processor_->TypeName();
     Transmit(std::move(pack));
   }
 }
@@ -86,16 +120,24 @@ void TaskNode::Transmit(PackagePtr&& pack) noexcept {
   }
 }
 
-Engine::Engine(std::vector<std::shared_ptr<Processor>> processors, NotifyDoneFunc&& done_func, PriorityThreadPool* tp)
+Engine::Engine(std::vector<std::shared_ptr<Processor>> processors, NotifyDoneFunc&& done_func, PriorityThreadPool* tp,
+               SharedPredictor* shared, size_t shared_idx)
     : done_notifier_(std::move(done_func)), tp_(tp) {
   nodes_.reserve(processors.size());
   for (size_t idx = 0; idx < processors.size(); ++idx) {
+    TaskNode::Stage stage = TaskNode::Stage::INFER;
+    if (idx == 0) {
+      stage = TaskNode::Stage::PREPROC;
+    } else if (idx == processors.size() - 1) {
+      stage = TaskNode::Stage::POSTPROC;
+    }
     nodes_.emplace_back(processors[idx],
                         [this]() {
                           --task_num_;
                           done_notifier_(this);
                         },
-                        tp_);
+                        tp_, stage);
+    if (stage == TaskNode::Stage::INFER && shared) nodes_.back().SetShared(shared, shared_idx);
   }
   for (size_t idx = 0; idx < nodes_.size() - 1; ++idx) {
     nodes_[idx].Link(&nodes_[idx + 1]);
@@ -30,6 +30,7 @@
 #include <vector>
 
 #include "cnis/infer_server.h"
+#include "shared_predictor.h"
 #include "util/thread_pool.h"
 
 namespace infer_server {
@@ -38,17 +39,30 @@ class Engine;
 class TaskNode {
  public:
   using Notifier = std::function<void()>;
-  TaskNode(std::shared_ptr<Processor> processor, Notifier&& done_notifier, PriorityThreadPool* tp) noexcept
-      : processor_(processor), done_notifier_(std::forward<Notifier>(done_notifier)), tp_(tp) {}
+  // stage of processor in engine, used in usage accounting
+  enum class Stage { PREPROC, INFER, POSTPROC };
+  TaskNode(std::shared_ptr<Processor> processor, Notifier&& done_notifier, PriorityThreadPool* tp,
+           Stage stage = Stage::INFER) noexcept
+      : processor_(processor), done_notifier_(std::forward<Notifier>(done_notifier)), tp_(tp), stage_(stage) {}
 
   TaskNode Fork(Notifier&& done_notifier) {
     auto fork_proc = processor_->Fork();
     if (!fork_proc) throw std::runtime_error("Fork processor failed: " + processor_->TypeName());
-    return TaskNode(std::move(fork_proc), std::forward<Notifier>(done_notifier), tp_);
+    TaskNode node(std::move(fork_proc), std::forward<Notifier>(done_notifier), tp_, stage_);
+    node.SetShared(shared_, shared_idx_);
+    return node;
+  }
+
+  // infer by shared predictors instead of processor
+  void SetShared(SharedPredictor* shared, size_t idx) noexcept {
+    shared_ = shared;
+    shared_idx_ = idx;
   }
 
   void Execute(PackagePtr pack);
 
+  void Finish(PackagePtr&& pack, Status s) noexcept;
+
   void Transmit(PackagePtr&& data) noexcept;
 
   void Link(TaskNode* node) noexcept { downnode_ = node; }
@@ -59,13 +73,17 @@ class TaskNode {
   Notifier done_notifier_;
   PriorityThreadPool* tp_;
   TaskNode* downnode_{nullptr};
+  Stage stage_;
+  SharedPredictor* shared_{nullptr};
+  size_t shared_idx_{0};
 };  // struct TaskNode
 
 class Engine {
  public:
   using NotifyDoneFunc = std::function<void(Engine*)>;
   Engine() = default;
-  Engine(std::vector<std::shared_ptr<Processor>> processors, NotifyDoneFunc&& done_func, PriorityThreadPool* tp);
+  Engine(std::vector<std::shared_ptr<Processor>> processors, NotifyDoneFunc&& done_func, PriorityThreadPool* tp,
+         SharedPredictor* shared = nullptr, size_t shared_idx = 0);
   ~Engine() {
     while (task_num_.load()) {
       // wait for all task done
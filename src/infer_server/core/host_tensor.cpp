@@ -0,0 +1,814 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "host_tensor.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define HOST_TENSOR_F16C
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HOST_TENSOR_NEON
+#endif
+
+namespace infer_server {
+namespace detail {
+
+uint16_t FloatToHalf(float value) noexcept {
+  uint32_t x;
+  memcpy(&x, &value, sizeof(x));
+  const uint16_t sign = (x >> 16) & 0x8000;
+  const uint32_t abs = x & 0x7fffffff;
+  if (abs >= 0x7f800000) {
+    // inf keeps no mantissa, nan is quieted and keeps the high payload bits
+    return sign | 0x7c00 | (abs > 0x7f800000 ? (0x200 | ((abs >> 13) & 0x3ff)) : 0);
+  }
+  // values not less than 65520 round to inf
+  if (abs >= 0x477ff000) return sign | 0x7c00;
+  if (abs < 0x38800000) {
+    // subnormal half, values less than 2^-25 round to zero
+    if (abs < 0x33000000) return sign;
+    const uint32_t mantissa = (abs & 0x7fffff) | 0x800000;
+    const uint32_t shift = 126 - (abs >> 23);
+    uint32_t h = mantissa >> shift;
+    const uint32_t rem = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (rem > halfway || (rem == halfway && (h & 1))) ++h;
+    return sign | h;
+  }
+  // rebias exponent from 127 to 15, carry of rounding may move to the next exponent correctly
+  uint32_t h = (abs - 0x38000000) >> 13;
+  const uint32_t rem = abs & 0x1fff;
+  if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) ++h;
+  return sign | h;
+}
+
+float HalfToFloat(uint16_t value) noexcept {
+  const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+  uint32_t exponent = (value >> 10) & 0x1f;
+  uint32_t mantissa = value & 0x3ff;
+  uint32_t x;
+  if (exponent == 0) {
+    if (mantissa == 0) {
+      x = sign;
+    } else {
+      // normalize subnormal half
+      exponent = 113;
+      while (!(mantissa & 0x400)) {
+        mantissa <<= 1;
+        --exponent;
+      }
+      x = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+    }
+  } else if (exponent == 0x1f) {
+    x = sign | 0x7f800000 | (mantissa << 13);
+  } else {
+    x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+uint16_t FloatToBFloat16(float value) noexcept {
+  uint32_t x;
+  memcpy(&x, &value, sizeof(x));
+  // keep nan from rounding into inf
+  if ((x & 0x7fffffff) > 0x7f800000) return (x >> 16) | 0x40;
+  x += 0x7fff + ((x >> 16) & 1);
+  return x >> 16;
+}
+
+float BFloat16ToFloat(uint16_t value) noexcept {
+  uint32_t x = static_cast<uint32_t>(value) << 16;
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+namespace {
+
+// storage of FLOAT16 and BF16, distinguished from INT16
+struct Half {
+  uint16_t bits;
+};
+struct BFloat16 {
+  uint16_t bits;
+};
+// storage of BOOL, any nonzero byte is true
+struct Bool {
+  uint8_t value;
+};
+
+// elements staged in FLOAT32 per chunk while casting between two non-FLOAT32 types
+constexpr size_t kChunkSize = 1024;
+// edge of square tiles in transpose, a tile of FLOAT32 takes 4KB and stays in L1 on both sides
+constexpr int64_t kTileSize = 32;
+
+#ifdef HOST_TENSOR_F16C
+bool CpuHasF16c() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+  if (!(ecx & bit_F16C) || !(ecx & bit_AVX) || !(ecx & bit_OSXSAVE)) return false;
+  // VEX encoded instructions also need the OS to save the AVX state
+  unsigned int xcr0_lo, xcr0_hi;
+  __asm__ volatile("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  return (xcr0_lo & 0x6) == 0x6;
+}
+
+const bool g_has_f16c = CpuHasF16c();
+
+__attribute__((target("f16c"))) size_t HalfToFloatF16c(const Half* src, float* dst, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_ps(dst + i, _mm_cvtph_ps(h));
+    _mm_storeu_ps(dst + i + 4, _mm_cvtph_ps(_mm_srli_si128(h, 8)));
+  }
+  return i;
+}
+
+__attribute__((target("f16c"))) size_t FloatToHalfF16c(const float* src, Half* dst, size_t n) {
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i lo = _mm_cvtps_ph(_mm_loadu_ps(src + i), 0);
+    __m128i hi = _mm_cvtps_ph(_mm_loadu_ps(src + i + 4), 0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi64(lo, hi));
+  }
+  return i;
+}
+#endif
+
+template <typename T>
+T FloatToInt(float v) {
+  if (std::isnan(v)) return 0;
+  if (v <= static_cast<float>(std::numeric_limits<T>::min())) return std::numeric_limits<T>::min();
+  if (v >= static_cast<float>(std::numeric_limits<T>::max())) return std::numeric_limits<T>::max();
+  return static_cast<T>(std::nearbyint(v));
+}
+
+/* ----------------------------- to FLOAT32 ----------------------------- */
+
+void ToFloat(const float* src, float* dst, size_t n) { memcpy(dst, src, n * sizeof(float)); }
+
+void ToFloat(const uint8_t* src, float* dst, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i lo = _mm_unpacklo_epi8(v, zero);
+    __m128i hi = _mm_unpackhi_epi8(v, zero);
+    _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)));
+    _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)));
+    _mm_storeu_ps(dst + i + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)));
+    _mm_storeu_ps(dst + i + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)));
+  }
+#elif defined(HOST_TENSOR_NEON)
+  for (; i + 8 <= n; i += 8) {
+    uint16x8_t v = vmovl_u8(vld1_u8(src + i));
+    vst1q_f32(dst + i, vcvtq_f32_u32(vmovl_u16(vget_low_u16(v))));
+    vst1q_f32(dst + i + 4, vcvtq_f32_u32(vmovl_u16(vget_high_u16(v))));
+  }
+#endif
+  for (; i < n; ++i) dst[i] = src[i];
+}
+
+void ToFloat(const int16_t* src, float* dst, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)));
+    _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)));
+  }
+#elif defined(HOST_TENSOR_NEON)
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t v = vld1q_s16(src + i);
+    vst1q_f32(dst + i, vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))));
+    vst1q_f32(dst + i + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))));
+  }
+#endif
+  for (; i < n; ++i) dst[i] = src[i];
+}
+
+void ToFloat(const int8_t* src, float* dst, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+    __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+    _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16)));
+    _mm_storeu_ps(dst + i + 4, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16)));
+    _mm_storeu_ps(dst + i + 8, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16)));
+    _mm_storeu_ps(dst + i + 12, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16)));
+  }
+#elif defined(HOST_TENSOR_NEON)
+  for (; i + 8 <= n; i += 8) {
+    int16x8_t v = vmovl_s8(vld1_s8(src + i));
+    vst1q_f32(dst + i, vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))));
+    vst1q_f32(dst + i + 4, vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))));
+  }
+#endif
+  for (; i < n; ++i) dst[i] = src[i];
+}
+
+void ToFloat(const int32_t* src, float* dst, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(dst + i, _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))));
+  }
+#elif defined(HOST_TENSOR_NEON)
+  for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, vcvtq_f32_s32(vld1q_s32(src + i)));
+#endif
+  for (; i < n; ++i) dst[i] = static_cast<float>(src[i]);
+}
+
+void ToFloat(const int64_t* src, float* dst, size_t n) {
+  for (size_t i = 0; i < n; ++i) dst[i] = static_cast<float>(src[i]);
+}
+
+void ToFloat(const BFloat16* src, float* dst, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 8 <= n; i += 8) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_ps(dst + i, _mm_castsi128_ps(_mm_unpacklo_epi16(zero, v)));
+    _mm_storeu_ps(dst + i + 4, _mm_castsi128_ps(_mm_unpackhi_epi16(zero, v)));
+  }
+#elif defined(HOST_TENSOR_NEON)
+  for (; i + 4 <= n; i += 4) {
+    uint32x4_t v = vshll_n_u16(vld1_u16(reinterpret_cast<const uint16_t*>(src + i)), 16);
+    vst1q_f32(dst + i, vreinterpretq_f32_u32(v));
+  }
+#endif
+  for (; i < n; ++i) dst[i] = BFloat16ToFloat(src[i].bits);
+}
+
+void ToFloat(const Bool* src, float* dst, size_t n) {
+  for (size_t i = 0; i < n; ++i) dst[i] = src[i].value ? 1.f : 0.f;
+}
+
+void ToFloat(const Half* src, float* dst, size_t n) {
+  size_t i = 0;
+#if defined(HOST_TENSOR_F16C)
+  if (g_has_f16c) i = HalfToFloatF16c(src, dst, n);
+#elif defined(HOST_TENSOR_NEON)
+  for (; i + 4 <= n; i += 4) {
+    vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(reinterpret_cast<const uint16_t*>(src + i)))));
+  }
+#endif
+  for (; i < n; ++i) dst[i] = HalfToFloat(src[i].bits);
+}
+
+/* ---------------------------- from FLOAT32 ---------------------------- */
+
+void FromFloat(const float* src, float* dst, size_t n) { memcpy(dst, src, n * sizeof(float)); }
+
+void FromFloat(const float* src, uint8_t* dst, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  // max with zero as the second operand also maps nan to zero
+  const __m128 lo = _mm_setzero_ps();
+  const __m128 hi = _mm_set1_ps(255.f);
+  for (; i + 16 <= n; i += 16) {
+    __m128i a = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), lo), hi));
+    __m128i b = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 4), lo), hi));
+    __m128i c = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 8), lo), hi));
+    __m128i d = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i + 12), lo), hi));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+  }
+#elif defined(HOST_TENSOR_NEON)
+  for (; i + 8 <= n; i += 8) {
+    int32x4_t a = vcvtnq_s32_f32(vld1q_f32(src + i));
+    int32x4_t b = vcvtnq_s32_f32(vld1q_f32(src + i + 4));
+    vst1_u8(dst + i, vqmovn_u16(vcombine_u16(vqmovun_s32(a), vqmovun_s32(b))));
+  }
+#endif
+  for (; i < n; ++i) dst[i] = FloatToInt<uint8_t>(src[i]);
+}
+
+void FromFloat(const float* src, int16_t* dst, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128 lo = _mm_set1_ps(-32768.f);
+  const __m128 hi = _mm_set1_ps(32767.f);
+  for (; i + 8 <= n; i += 8) {
+    __m128 a = _mm_loadu_ps(src + i);
+    __m128 b = _mm_loadu_ps(src + i + 4);
+    a = _mm_min_ps(_mm_max_ps(_mm_and_ps(a, _mm_cmpord_ps(a, a)), lo), hi);
+    b = _mm_min_ps(_mm_max_ps(_mm_and_ps(b, _mm_cmpord_ps(b, b)), lo), hi);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+  }
+#elif defined(HOST_TENSOR_NEON)
+  for (; i + 8 <= n; i += 8) {
+    int32x4_t a = vcvtnq_s32_f32(vld1q_f32(src + i));
+    int32x4_t b = vcvtnq_s32_f32(vld1q_f32(src + i + 4));
+    vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+  }
+#endif
+  for (; i < n; ++i) dst[i] = FloatToInt<int16_t>(src[i]);
+}
+
+void FromFloat(const float* src, int8_t* dst, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128 lo = _mm_set1_ps(-128.f);
+  const __m128 hi = _mm_set1_ps(127.f);
+  for (; i + 16 <= n; i += 16) {
+    __m128i r[4];
+    for (int k = 0; k < 4; ++k) {
+      __m128 v = _mm_loadu_ps(src + i + 4 * k);
+      r[k] = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_and_ps(v, _mm_cmpord_ps(v, v)), lo), hi));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+                     _mm_packs_epi16(_mm_packs_epi32(r[0], r[1]), _mm_packs_epi32(r[2], r[3])));
+  }
+#elif defined(HOST_TENSOR_NEON)
+  for (; i + 8 <= n; i += 8) {
+    int32x4_t a = vcvtnq_s32_f32(vld1q_f32(src + i));
+    int32x4_t b = vcvtnq_s32_f32(vld1q_f32(src + i + 4));
+    vst1_s8(dst + i, vqmovn_s16(vcombine_s16(vqmovn_s32(a), vqmovn_s32(b))));
+  }
+#endif
+  for (; i < n; ++i) dst[i] = FloatToInt<int8_t>(src[i]);
+}
+
+void FromFloat(const float* src, int32_t* dst, size_t n) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  // cvtps2dq returns 0x80000000 on overflow, flip it to INT32_MAX for positive overflow
+  const __m128 limit = _mm_set1_ps(2147483648.f);
+  for (; i + 4 <= n; i += 4) {
+    __m128 v = _mm_loadu_ps(src + i);
+    v = _mm_and_ps(v, _mm_cmpord_ps(v, v));
+    __m128i r = _mm_cvtps_epi32(v);
+    r = _mm_xor_si128(r, _mm_castps_si128(_mm_cmpge_ps(v, limit)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), r);
+  }
+#elif defined(HOST_TENSOR_NEON)
+  for (; i + 4 <= n; i += 4) vst1q_s32(dst + i, vcvtnq_s32_f32(vld1q_f32(src + i)));
+#endif
+  for (; i < n; ++i) dst[i] = FloatToInt<int32_t>(src[i]);
+}
+
+void FromFloat(const float* src, int64_t* dst, size_t n) {
+  for (size_t i = 0; i < n; ++i) dst[i] = FloatToInt<int64_t>(src[i]);
+}
+
+void FromFloat(const float* src, BFloat16* dst, size_t n) {
+  for (size_t i = 0; i < n; ++i) dst[i].bits = FloatToBFloat16(src[i]);
+}
+
+void FromFloat(const float* src, Bool* dst, size_t n) {
+  for (size_t i = 0; i < n; ++i) dst[i].value = src[i] != 0.f;
+}
+
+void FromFloat(const float* src, Half* dst, size_t n) {
+  size_t i = 0;
+#if defined(HOST_TENSOR_F16C)
+  if (g_has_f16c) i = FloatToHalfF16c(src, dst, n);
+#elif defined(HOST_TENSOR_NEON)
+  for (; i + 4 <= n; i += 4) {
+    vst1_u16(reinterpret_cast<uint16_t*>(dst + i), vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+  }
+#endif
+  for (; i < n; ++i) dst[i].bits = FloatToHalf(src[i]);
+}
+
+/* ------------------------------- casting ------------------------------ */
+
+template <typename T>
+struct IsInteger : std::is_integral<T> {};
+template <>
+struct IsInteger<Bool> : std::true_type {};
+
+// INT64 does not fit in FLOAT32, so it is cast to and from other integers directly
+template <typename S, typename D>
+struct ThroughInt64
+    : std::integral_constant<bool, IsInteger<S>::value && IsInteger<D>::value &&
+                                       (std::is_same<S, int64_t>::value || std::is_same<D, int64_t>::value)> {};
+
+template <typename T>
+int64_t LoadInt(T v) {
+  return v;
+}
+int64_t LoadInt(Bool v) { return v.value != 0; }
+
+template <typename T>
+void StoreInt(T* dst, int64_t v) {
+  v = std::max<int64_t>(v, std::numeric_limits<T>::min());
+  *dst = static_cast<T>(std::min<int64_t>(v, std::numeric_limits<T>::max()));
+}
+void StoreInt(Bool* dst, int64_t v) { dst->value = v != 0; }
+
+template <typename S, typename D>
+void CastStaged(const S* src, D* dst, size_t n, std::true_type) {
+  for (size_t i = 0; i < n; ++i) StoreInt(dst + i, LoadInt(src[i]));
+}
+
+// other pairs are exact through FLOAT32, integers beyond 2^24 saturate anyway
+template <typename S, typename D>
+void CastStaged(const S* src, D* dst, size_t n, std::false_type) {
+  float buffer[kChunkSize];
+  for (size_t offset = 0; offset < n; offset += kChunkSize) {
+    size_t len = std::min(kChunkSize, n - offset);
+    ToFloat(src + offset, buffer, len);
+    FromFloat(buffer, dst + offset, len);
+  }
+}
+
+template <typename S, typename D>
+void CastElements(const S* src, D* dst, size_t n) {
+  if (std::is_same<S, D>::value) {
+    memcpy(dst, src, n * sizeof(S));
+  } else if (std::is_same<S, float>::value) {
+    FromFloat(reinterpret_cast<const float*>(src), dst, n);
+  } else if (std::is_same<D, float>::value) {
+    ToFloat(src, reinterpret_cast<float*>(dst), n);
+  } else {
+    CastStaged(src, dst, n, ThroughInt64<S, D>());
+  }
+}
+
+/* ------------------------------ transpose ----------------------------- */
+
+// Drop unit dims and merge src dims which stay adjacent in dst. An identity permutation collapses into one dim.
+bool SimplifyPermutation(const std::vector<int64_t>& src_dims, const std::vector<int>& axis, std::vector<int64_t>* dims,
+                         std::vector<int>* perm) {
+  const int n = src_dims.size();
+  if (axis.size() != src_dims.size()) return false;
+  std::vector<bool> seen(n, false);
+  for (int a : axis) {
+    if (a < 0 || a >= n || seen[a]) return false;
+    seen[a] = true;
+  }
+
+  std::vector<int> index(n, -1);
+  std::vector<int64_t> kept_dims;
+  for (int i = 0; i < n; ++i) {
+    if (src_dims[i] != 1) {
+      index[i] = kept_dims.size();
+      kept_dims.push_back(src_dims[i]);
+    }
+  }
+  std::vector<int> kept_axis;
+  for (int a : axis) {
+    if (index[a] >= 0) kept_axis.push_back(index[a]);
+  }
+
+  // groups in dst order, each group is a run of consecutive src dims
+  std::vector<int> group_first;
+  std::vector<int64_t> group_dim;
+  for (size_t i = 0; i < kept_axis.size(); ++i) {
+    if (i > 0 && kept_axis[i] == kept_axis[i - 1] + 1) {
+      group_dim.back() *= kept_dims[kept_axis[i]];
+    } else {
+      group_first.push_back(kept_axis[i]);
+      group_dim.push_back(kept_dims[kept_axis[i]]);
+    }
+  }
+
+  const int group_num = group_first.size();
+  std::vector<int> order(group_num);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&group_first](int l, int r) { return group_first[l] < group_first[r]; });
+  std::vector<int> rank(group_num);
+  dims->resize(group_num);
+  for (int k = 0; k < group_num; ++k) {
+    (*dims)[k] = group_dim[order[k]];
+    rank[order[k]] = k;
+  }
+  perm->assign(rank.begin(), rank.end());
+  return true;
+}
+
+// dims and perm are simplified, so dst is contiguous along src dim perm[n - 1]
+template <typename S, typename D>
+void CastTransposeImpl(const S* src, D* dst, const std::vector<int64_t>& dims, const std::vector<int>& perm) {
+  const int n = dims.size();
+  if (n <= 1) {
+    CastElements(src, dst, n ? dims[0] : 1);
+    return;
+  }
+
+  std::vector<int64_t> src_stride(n, 1), dst_stride(n, 1);
+  for (int i = n - 2; i >= 0; --i) {
+    src_stride[i] = src_stride[i + 1] * dims[i + 1];
+  }
+  // dst stride indexed by src dim
+  int64_t stride = 1;
+  for (int i = n - 1; i >= 0; --i) {
+    dst_stride[perm[i]] = stride;
+    stride *= dims[perm[i]];
+  }
+
+  const int a = perm[n - 1];
+  const int b = n - 1;
+  // iterate the other dims in dst order to keep writes sequential
+  std::vector<int> outer;
+  int64_t outer_count = 1;
+  for (int i = 0; i < n; ++i) {
+    if (perm[i] != a && perm[i] != b) {
+      outer.push_back(perm[i]);
+      outer_count *= dims[perm[i]];
+    }
+  }
+
+  std::vector<int64_t> idx(outer.size(), 0);
+  int64_t src_offset = 0, dst_offset = 0;
+  for (int64_t o = 0; o < outer_count; ++o) {
+    const S* s = src + src_offset;
+    D* d = dst + dst_offset;
+    if (a == b) {
+      // rows stay contiguous on both sides
+      CastElements(s, d, dims[b]);
+    } else {
+      const int64_t sa = src_stride[a];
+      const int64_t db = dst_stride[b];
+      for (int64_t j0 = 0; j0 < dims[b]; j0 += kTileSize) {
+        const int64_t jn = std::min(kTileSize, dims[b] - j0);
+        for (int64_t i0 = 0; i0 < dims[a]; i0 += kTileSize) {
+          const int64_t in = std::min(kTileSize, dims[a] - i0);
+          const S* st = s + i0 * sa + j0;
+          D* dt = d + j0 * db + i0;
+          if (std::is_same<S, D>::value) {
+            for (int64_t j = 0; j < jn; ++j) {
+              S* row = reinterpret_cast<S*>(dt + j * db);
+              for (int64_t i = 0; i < in; ++i) row[i] = st[i * sa + j];
+            }
+          } else {
+            // transpose the tile in its source type, then cast each row with the vector kernels
+            S tile[kTileSize * kTileSize];
+            for (int64_t j = 0; j < jn; ++j) {
+              for (int64_t i = 0; i < in; ++i) tile[j * kTileSize + i] = st[i * sa + j];
+            }
+            for (int64_t j = 0; j < jn; ++j) CastElements(tile + j * kTileSize, dt + j * db, in);
+          }
+        }
+      }
+    }
+
+    for (int k = static_cast<int>(outer.size()) - 1; k >= 0; --k) {
+      const int dim = outer[k];
+      src_offset += src_stride[dim];
+      dst_offset += dst_stride[dim];
+      if (++idx[k] < dims[dim]) break;
+      src_offset -= src_stride[dim] * dims[dim];
+      dst_offset -= dst_stride[dim] * dims[dim];
+      idx[k] = 0;
+    }
+  }
+}
+
+template <typename S, typename D>
+struct CastOp {
+  static void Run(const void* src, void* dst, size_t count) {
+    CastElements(static_cast<const S*>(src), static_cast<D*>(dst), count);
+  }
+};
+
+template <typename S, typename D>
+struct CastTransposeOp {
+  static void Run(const void* src, void* dst, const std::vector<int64_t>& dims, const std::vector<int>& perm) {
+    CastTransposeImpl(static_cast<const S*>(src), static_cast<D*>(dst), dims, perm);
+  }
+};
+
+template <template <typename, typename> class Op, typename S, typename... Args>
+bool DispatchDst(DataType dst_dtype, Args&&... args) {
+  switch (dst_dtype) {
+#define DISPATCH_DST(type, storage)                   \
+  case DataType::type:                                \
+    Op<S, storage>::Run(std::forward<Args>(args)...); \
+    return true;
+    DISPATCH_DST(UINT8, uint8_t)
+    DISPATCH_DST(FLOAT16, Half)
+    DISPATCH_DST(FLOAT32, float)
+    DISPATCH_DST(INT16, int16_t)
+    DISPATCH_DST(INT32, int32_t)
+    DISPATCH_DST(INT8, int8_t)
+    DISPATCH_DST(BF16, BFloat16)
+    DISPATCH_DST(INT64, int64_t)
+    DISPATCH_DST(BOOL, Bool)
+#undef DISPATCH_DST
+    default:
+      return false;
+  }
+}
+
+template <template <typename, typename> class Op, typename... Args>
+bool Dispatch(DataType src_dtype, DataType dst_dtype, Args&&... args) {
+  switch (src_dtype) {
+#define DISPATCH_SRC(type, storage) \
+  case DataType::type:              \
+    return DispatchDst<Op, storage>(dst_dtype, std::forward<Args>(args)...);
+    DISPATCH_SRC(UINT8, uint8_t)
+    DISPATCH_SRC(FLOAT16, Half)
+    DISPATCH_SRC(FLOAT32, float)
+    DISPATCH_SRC(INT16, int16_t)
+    DISPATCH_SRC(INT32, int32_t)
+    DISPATCH_SRC(INT8, int8_t)
+    DISPATCH_SRC(BF16, BFloat16)
+    DISPATCH_SRC(INT64, int64_t)
+    DISPATCH_SRC(BOOL, Bool)
+#undef DISPATCH_SRC
+    default:
+      return false;
+  }
+}
+
+bool IsQuantized(const DataLayout& layout) {
+  switch (layout.dtype) {
+    case DataType::UINT8:
+    case DataType::INT8:
+    case DataType::INT16:
+    case DataType::INT32:
+    case DataType::INT64:
+      return !layout.quant.scales.empty();
+    default:
+      return false;
+  }
+}
+
+// real = (quantized - zero_point) * scale
+struct Affine {
+  float scale;
+  float zero_point;
+};
+
+// affine of each channel, and number of elements sharing one channel
+bool GetAffines(const QuantParams& quant, const std::vector<int64_t>& dims, std::vector<Affine>* affines,
+                int64_t* inner) {
+  const size_t num = quant.scales.size();
+  if (!quant.zero_points.empty() && quant.zero_points.size() != num) {
+    LOG(ERROR) << "[EasyDK InferServer] HostCastDataType(): Number of zero points and scales are mismatched";
+    return false;
+  }
+  for (size_t i = 0; i < num; ++i) {
+    if (!(quant.scales[i] > 0) || std::isinf(quant.scales[i])) {
+      LOG(ERROR) << "[EasyDK InferServer] HostCastDataType(): Invalid scale " << quant.scales[i];
+      return false;
+    }
+    affines->push_back({quant.scales[i], quant.zero_points.empty() ? 0.f : static_cast<float>(quant.zero_points[i])});
+  }
+  *inner = std::accumulate(dims.begin(), dims.end(), int64_t(1), std::multiplies<int64_t>());
+  if (num > 1) {
+    const int axis = quant.axis;
+    if (axis < 0 || axis >= static_cast<int>(dims.size()) || dims[axis] != static_cast<int64_t>(num)) {
+      LOG(ERROR) << "[EasyDK InferServer] HostCastDataType(): " << num << " channels of quantization do not match dim "
+                 << axis;
+      return false;
+    }
+    *inner = std::accumulate(dims.begin() + axis + 1, dims.end(), int64_t(1), std::multiplies<int64_t>());
+  }
+  return true;
+}
+
+}  // namespace
+
+bool HostCastDataType(const void* src, void* dst, DataType src_dtype, DataType dst_dtype, size_t count) noexcept {
+  if (!count) return true;
+  if (!src || !dst) {
+    LOG(ERROR) << "[EasyDK InferServer] HostCastDataType(): src or dst is nullptr";
+    return false;
+  }
+  if (!Dispatch<CastOp>(src_dtype, dst_dtype, src, dst, count)) {
+    LOG(ERROR) << "[EasyDK InferServer] HostCastDataType(): Unsupported data type, (src) "
+               << static_cast<int>(src_dtype) << ", (dst) " << static_cast<int>(dst_dtype);
+    return false;
+  }
+  return true;
+}
+
+bool HostCastDataType(const void* src, void* dst, const DataLayout& src_layout, const DataLayout& dst_layout,
+                      const std::vector<int64_t>& src_dims) noexcept {
+  for (int64_t dim : src_dims) {
+    if (dim < 0) {
+      LOG(ERROR) << "[EasyDK InferServer] HostCastDataType(): Negative dim";
+      return false;
+    }
+  }
+  const int64_t count = std::accumulate(src_dims.begin(), src_dims.end(), int64_t(1), std::multiplies<int64_t>());
+  const bool src_quantized = IsQuantized(src_layout);
+  const bool dst_quantized = IsQuantized(dst_layout);
+  if (!src_quantized && !dst_quantized) {
+    return HostCastDataType(src, dst, src_layout.dtype, dst_layout.dtype, count);
+  }
+
+  std::vector<Affine> src_affines, dst_affines;
+  int64_t src_inner = count, dst_inner = count;
+  if (src_quantized && !GetAffines(src_layout.quant, src_dims, &src_affines, &src_inner)) return false;
+  if (dst_quantized && !GetAffines(dst_layout.quant, src_dims, &dst_affines, &dst_inner)) return false;
+  if (src_affines.size() > 1 && dst_affines.size() > 1 && src_inner != dst_inner) {
+    LOG(ERROR) << "[EasyDK InferServer] HostCastDataType(): Channels of src and dst quantization are mismatched";
+    return false;
+  }
+  if (!count) return true;
+  if (!src || !dst) {
+    LOG(ERROR) << "[EasyDK InferServer] HostCastDataType(): src or dst is nullptr";
+    return false;
+  }
+
+  // staged through FLOAT32, quantized INT32 and INT64 beyond 2^24 lose precision
+  // elements in a run share the same affine
+  const int64_t run = src_affines.size() > 1 ? src_inner : dst_inner;
+  const size_t src_size = GetTypeSize(src_layout.dtype);
+  const size_t dst_size = GetTypeSize(dst_layout.dtype);
+  if (!src_size || !dst_size) return false;
+  const uint8_t* src_ptr = static_cast<const uint8_t*>(src);
+  uint8_t* dst_ptr = static_cast<uint8_t*>(dst);
+  float buffer[kChunkSize];
+  size_t channel = 0;
+  for (int64_t offset = 0; offset < count; offset += run) {
+    const Affine* src_affine = src_affines.empty() ? nullptr : &src_affines[src_affines.size() > 1 ? channel : 0];
+    const Affine* dst_affine = dst_affines.empty() ? nullptr : &dst_affines[dst_affines.size() > 1 ? channel : 0];
+    for (int64_t pos = offset; pos < offset + run; pos += kChunkSize) {
+      const size_t len = std::min<int64_t>(kChunkSize, offset + run - pos);
+      Dispatch<CastOp>(src_layout.dtype, DataType::FLOAT32, src_ptr + pos * src_size, buffer, len);
+      if (src_affine) {
+        for (size_t i = 0; i < len; ++i) buffer[i] = (buffer[i] - src_affine->zero_point) * src_affine->scale;
+      }
+      if (dst_affine) {
+        for (size_t i = 0; i < len; ++i) buffer[i] = buffer[i] / dst_affine->scale + dst_affine->zero_point;
+      }
+      Dispatch<CastOp>(DataType::FLOAT32, dst_layout.dtype, buffer, dst_ptr + pos * dst_size, len);
+    }
+    if (++channel == std::max(src_affines.size(), dst_affines.size())) channel = 0;
+  }
+  return true;
+}
+
+bool HostTranspose(const void* src, void* dst, DataType dtype, const std::vector<int64_t>& src_dims,
+                   const std::vector<int>& axis) noexcept {
+  return HostCastTranspose(src, dst, dtype, dtype, src_dims, axis);
+}
+
+bool HostCastTranspose(const void* src, void* dst, DataType src_dtype, DataType dst_dtype,
+                       const std::vector<int64_t>& src_dims, const std::vector<int>& axis) noexcept {
+  for (int64_t dim : src_dims) {
+    if (dim < 0) {
+      LOG(ERROR) << "[EasyDK InferServer] HostCastTranspose(): Negative dim";
+      return false;
+    }
+    if (dim == 0) return true;
+  }
+  if (!src || !dst) {
+    LOG(ERROR) << "[EasyDK InferServer] HostCastTranspose(): src or dst is nullptr";
+    return false;
+  }
+  std::vector<int64_t> dims;
+  std::vector<int> perm;
+  if (!SimplifyPermutation(src_dims, axis, &dims, &perm)) {
+    LOG(ERROR) << "[EasyDK InferServer] HostCastTranspose(): Axis is not a permutation of " << src_dims.size()
+               << " dims";
+    return false;
+  }
+  if (!Dispatch<CastTransposeOp>(src_dtype, dst_dtype, src, dst, dims, perm)) {
+    LOG(ERROR) << "[EasyDK InferServer] HostCastTranspose(): Unsupported data type, (src) "
+               << static_cast<int>(src_dtype) << ", (dst) " << static_cast<int>(dst_dtype);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace detail
+}  // namespace infer_server
@@ -0,0 +1,67 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_CORE_HOST_TENSOR_H_
+#define INFER_SERVER_CORE_HOST_TENSOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cnis/infer_server.h"
+
+namespace infer_server {
+namespace detail {
+
+// IEEE 754 binary16 <-> binary32, round to nearest even
+uint16_t FloatToHalf(float value) noexcept;
+float HalfToFloat(uint16_t value) noexcept;
+// bfloat16 <-> binary32, round to nearest even
+uint16_t FloatToBFloat16(float value) noexcept;
+float BFloat16ToFloat(uint16_t value) noexcept;
+
+/*
+ * Conversion engine for tensors resident in host memory.
+ *
+ * Float to integer casts round to nearest even and saturate, NaN becomes zero.
+ * Integer to integer casts saturate, BOOL is true for any nonzero value.
+ * Casts from and to FLOAT16 and BF16 go through FLOAT32.
+ * Transpose follows the convention of cnrtTransDataOrder: dim i of dst is dim axis[i] of src.
+ */
+
+// cast count elements from src into dst
+bool HostCastDataType(const void* src, void* dst, DataType src_dtype, DataType dst_dtype, size_t count) noexcept;
+
+// cast with quantization parameters of layouts, dims of src are needed by per-channel quantization
+bool HostCastDataType(const void* src, void* dst, const DataLayout& src_layout, const DataLayout& dst_layout,
+                      const std::vector<int64_t>& src_dims) noexcept;
+
+// permute src of shape src_dims into dst
+bool HostTranspose(const void* src, void* dst, DataType dtype, const std::vector<int64_t>& src_dims,
+                   const std::vector<int>& axis) noexcept;
+
+// permute and cast in a single pass over src
+bool HostCastTranspose(const void* src, void* dst, DataType src_dtype, DataType dst_dtype,
+                       const std::vector<int64_t>& src_dims, const std::vector<int>& axis) noexcept;
+
+}  // namespace detail
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_CORE_HOST_TENSOR_H_
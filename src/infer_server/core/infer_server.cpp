@@ -34,6 +34,7 @@
 #include "cnis/util/any.h"
 #include "model/model.h"
 #include "session.h"
+#include "shared_predictor.h"
 #include "util/env.h"
 #include "util/thread_pool.h"
 
@@ -71,13 +72,22 @@ class InferServerPrivate {
     std::unique_lock<std::mutex> lk(executor_map_mutex_);
     if (executor_map_.count(executor_name)) {
       VLOG(1) << "[EasyDK InferServer] CreateExecutor(): Executor already exist: " << executor_name;
-      return executor_map_[executor_name].get();
+      Executor_t executor = executor_map_[executor_name].get();
+      // batches are traced by the executor, which is set up by the first session
+      if (desc.batch_trace && desc.batch_trace != executor->GetDesc().batch_trace) {
+        LOG(ERROR) << "[EasyDK InferServer] CreateExecutor(): Batch trace is not supported by the executor in use: "
+                   << executor_name;
+        return nullptr;
+      }
+      return executor;
     }
     VLOG(1) << "[EasyDK InferServer] CreateExecutor(): Create executor: " << executor_name;
     try {
       SessionDesc executor_desc = desc;
       executor_desc.name = executor_name;
-      std::unique_ptr<Executor> executor_up{new Executor(std::move(executor_desc), tp_.get(), device_id_)};
+      SharedPredictorPtr predictor = GetSharedPredictor(desc.model);
+      std::unique_ptr<Executor> executor_up{
+          new Executor(std::move(executor_desc), tp_.get(), device_id_, std::move(predictor))};
       Executor_t executor = executor_up.get();
       /* executor_map_.insert({executor_name, std::move(executor_up)}); */
       executor_map_[executor_name].swap(executor_up);
@@ -128,13 +138,42 @@ class InferServerPrivate {
   int GetDeviceId() const noexcept { return device_id_; }
 
  private:
+  // must be called with executor_map_mutex_ locked
+  SharedPredictorPtr GetSharedPredictor(const ModelPtr& model) noexcept {
+    // predictors are owned by executors, drop the ones whose executors are all destroyed
+    for (auto iter = predictor_map_.begin(); iter != predictor_map_.end();) {
+      if (iter->second.expired()) {
+        iter = predictor_map_.erase(iter);
+      } else {
+        ++iter;
+      }
+    }
+    SharedPredictorPtr predictor = predictor_map_[model->GetKey()].lock();
+    if (!predictor) {
+      VLOG(1) << "[EasyDK InferServer] GetSharedPredictor(): Create shared predictor for model: " << model->GetKey();
+      predictor = std::make_shared<SharedPredictor>(model, device_id_);
+      predictor_map_[model->GetKey()] = predictor;
+    }
+    return predictor;
+  }
+
   explicit InferServerPrivate(int device_id) noexcept : device_id_(device_id) {
     tp_.reset(new PriorityThreadPool([device_id]() -> bool { return SetCurrentDevice(device_id); }));
+    // use environment CNIS_SCHEDULE_SEED to reproduce the order of tasks with the same priority
+    if (std::getenv("CNIS_SCHEDULE_SEED")) {
+      try {
+        tp_->SetSchedulingSeed(GetUlongFromEnv("CNIS_SCHEDULE_SEED"));
+      } catch (std::exception& e) {
+        LOG(WARNING) << "[EasyDK InferServer] Invalid CNIS_SCHEDULE_SEED: " << e.what();
+      }
+    }
   }
   InferServerPrivate(const InferServerPrivate&) = delete;
   InferServerPrivate& operator=(const InferServerPrivate&) = delete;
 
   std::map<std::string, std::unique_ptr<Executor>> executor_map_;
+  // model key -> predictors shared by executors of that model
+  std::map<std::string, std::weak_ptr<SharedPredictor>> predictor_map_;
   std::mutex executor_map_mutex_;
   std::mutex tp_mutex_;
   std::unique_ptr<PriorityThreadPool> tp_{nullptr};
@@ -194,6 +233,11 @@ bool InferServer::DestroySession(Session_t session) noexcept {
 }
 
 bool InferServer::Request(Session_t session, PackagePtr input, any user_data, int timeout) noexcept {
+  return Request(session, std::move(input), std::move(user_data), nullptr, timeout);
+}
+
+bool InferServer::Request(Session_t session, PackagePtr input, any user_data, int64_t* request_id,
+                          int timeout) noexcept {
   CHECK(session) << "[EasyDK InferServer] Request(): Session is null!";
   CHECK(input) << "[EasyDK InferServer] Request(): Input is null!";
   if (session->IsSyncLink()) {
@@ -206,7 +250,8 @@ bool InferServer::Request(Session_t session, PackagePtr input, any user_data, in
   }
 
   return session->Send(std::move(input), std::bind(&Observer::Response, session->GetRawObserver(),
-                                                   std::placeholders::_1, std::placeholders::_2, std::move(user_data)));
+                                                   std::placeholders::_1, std::placeholders::_2, std::move(user_data)),
+                       request_id);
 }
 
 bool InferServer::RequestSync(Session_t session, PackagePtr input, Status* status, PackagePtr output,
@@ -283,6 +328,11 @@ void InferServer::DiscardTask(Session_t session, const std::string& tag) noexcep
   session->DiscardTask(tag);
 }
 
+void InferServer::DiscardRequest(Session_t session, int64_t request_id) noexcept {
+  CHECK(session) << "[EasyDK InferServer] DiscardRequest(): Session is null!";
+  session->DiscardRequest(request_id);
+}
+
 bool InferServer::SetModelDir(const std::string& model_dir) noexcept {
   // check whether model dir exist
   if (access(model_dir.c_str(), F_OK) == 0) {
@@ -314,10 +364,20 @@ ThroughoutStatistic InferServer::GetThroughout(Session_t session) const noexcept
 ThroughoutStatistic InferServer::GetThroughout(Session_t session, const std::string& tag) const noexcept {
   return session->GetThroughout(tag);
 }
+
+UsageStatistic InferServer::GetUsage(Session_t session, const std::string& tag) const noexcept {
+  return session->GetUsage(tag);
+}
+
+std::map<std::string, UsageStatistic> InferServer::GetUsageSnapshot(Session_t session) const noexcept {
+  return session->GetUsageSnapshot();
+}
 #else
 std::map<std::string, LatencyStatistic> InferServer::GetLatency(Session_t session) const noexcept { return {}; }
 ThroughoutStatistic InferServer::GetThroughout(Session_t session) const noexcept { return {}; }
 ThroughoutStatistic InferServer::GetThroughout(Session_t session, const std::string& tag) const noexcept { return {}; }
+UsageStatistic InferServer::GetUsage(Session_t session, const std::string& tag) const noexcept { return {}; }
+std::map<std::string, UsageStatistic> InferServer::GetUsageSnapshot(Session_t session) const noexcept { return {}; }
 #endif
 
 }  // namespace infer_server
@@ -0,0 +1,37 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_CORE_PARAM_KEYS_H_
+#define INFER_SERVER_CORE_PARAM_KEYS_H_
+
+#include "cnis/infer_server.h"
+
+namespace infer_server {
+namespace detail {
+
+// params set to processors by session
+static const ParamKey<ModelPtr> kModelInfoKey("model_info");
+static const ParamKey<int> kDeviceIdKey("device_id");
+static const ParamKey<NetworkInputFormat> kModelInputFormatKey("model_input_format");
+
+}  // namespace detail
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_CORE_PARAM_KEYS_H_
@@ -21,6 +21,8 @@
 #ifndef INFER_SERVER_CORE_PROFILE_H_
 #define INFER_SERVER_CORE_PROFILE_H_
 
+#include <time.h>
+
 #include <chrono>
 #include <limits>
 #include <map>
@@ -28,6 +30,8 @@
 #include <string>
 #include <unordered_map>
 
+#include "cnis/infer_server.h"
+#include "cnis/processor.h"
 #include "util/timer.h"
 
 namespace infer_server {
@@ -57,6 +61,77 @@ class Clock {
   static inline float DurationSince(const time_point& before) {
     return std::chrono::duration<float, Ratio>(Now() - before).count();
   }
+
+  // CPU time consumed by calling thread, in milliseconds
+  static inline double ThreadCpuTime() {
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+  }
+};
+
+// bytes of model input or output held by continuous data
+inline size_t ModelIOBytes(const InferDataPtr& io) noexcept {
+  if (!io || !io->HasValue()) return 0;
+  size_t bytes = 0;
+  try {
+    const ModelIO& model_io = io->GetLref<ModelIO>();
+    for (auto& surf : model_io.surfs) {
+      if (!surf) continue;
+      CnedkBufSurface* buf = surf->GetBufSurface();
+      for (uint32_t b_idx = 0; b_idx < buf->batch_size; ++b_idx) {
+        bytes += buf->surface_list[b_idx].data_size;
+      }
+    }
+  } catch (bad_any_cast&) {
+    return 0;
+  }
+  return bytes;
+}
+
+inline void AccumulateUsage(UsageStatistic* dst, const UsageStatistic& src) noexcept {
+  dst->request_cnt += src.request_cnt;
+  dst->unit_cnt += src.unit_cnt;
+  dst->preproc_cpu_time += src.preproc_cpu_time;
+  dst->postproc_cpu_time += src.postproc_cpu_time;
+  dst->device_time += src.device_time;
+  dst->bytes += src.bytes;
+  dst->queue_time += src.queue_time;
+}
+
+// resource usage accounting of each tag
+class UsageRecorder {
+ public:
+  void Record(const std::string& tag, const UsageStatistic& usage) noexcept {
+    std::lock_guard<std::mutex> lk(mutex_);
+    AccumulateUsage(&usage_[tag], usage);
+  }
+
+  UsageStatistic Get(const std::string& tag) noexcept {
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto iter = usage_.find(tag);
+    if (iter != usage_.end()) return iter->second;
+    LOG(WARNING) << "[EasyDK InferServer] [Profile] GetUsage(): Tag [" << tag << "] not exist";
+    return {};
+  }
+
+  void Snapshot() noexcept {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::map<std::string, UsageStatistic> snapshot(usage_.begin(), usage_.end());
+    std::lock_guard<std::mutex> snapshot_lk(snapshot_mutex_);
+    snapshot_.swap(snapshot);
+  }
+
+  std::map<std::string, UsageStatistic> GetSnapshot() noexcept {
+    std::lock_guard<std::mutex> lk(snapshot_mutex_);
+    return snapshot_;
+  }
+
+ private:
+  std::unordered_map<std::string, UsageStatistic> usage_;
+  std::mutex mutex_;
+  std::map<std::string, UsageStatistic> snapshot_;
+  std::mutex snapshot_mutex_;
 };
 
 class LatencyRecorder {
@@ -85,6 +85,30 @@ class RequestControl {
 
   // invoked only before response
   const std::map<std::string, float>& Performance() const noexcept { return output_->perf; }
+
+  // record time waiting in queue when the first data of request starts processing
+  void ProcessStart(const std::chrono::time_point<std::chrono::steady_clock>& start) noexcept {
+    std::lock_guard<std::mutex> lk(done_mutex_);
+    if (process_started_) return;
+    process_started_ = true;
+    usage_.queue_time = std::chrono::duration<double, std::milli>(start - start_time_).count();
+  }
+
+  void AddUsage(const UsageStatistic& usage) noexcept {
+    std::lock_guard<std::mutex> lk(done_mutex_);
+    usage_.preproc_cpu_time += usage.preproc_cpu_time;
+    usage_.postproc_cpu_time += usage.postproc_cpu_time;
+    usage_.device_time += usage.device_time;
+    usage_.bytes += usage.bytes;
+  }
+
+  // invoked only before response
+  UsageStatistic Usage() const noexcept {
+    UsageStatistic usage = usage_;
+    usage.request_cnt = 1;
+    usage.unit_cnt = data_num_;
+    return usage;
+  }
 #endif
 
   void Response() noexcept {
@@ -118,6 +142,8 @@ class RequestControl {
   std::atomic<bool> process_finished_{false};
 #ifdef CNIS_RECORD_PERF
   std::chrono::time_point<std::chrono::steady_clock> start_time_;
+  UsageStatistic usage_;
+  bool process_started_{false};
 #endif
 };
 
@@ -20,7 +20,9 @@
 
 #include "session.h"
 
+#include <algorithm>
 #include <list>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -28,12 +30,13 @@
 #include "cnis/infer_server.h"
 #include "cnis/processor.h"
 #include "engine.h"
+#include "param_keys.h"
 #include "profile.h"
 
 namespace infer_server {
 
-Executor::Executor(const SessionDesc& desc, PriorityThreadPool* tp, int device_id)
-    : desc_(desc), tp_(tp), device_id_(device_id) {
+Executor::Executor(const SessionDesc& desc, PriorityThreadPool* tp, int device_id, SharedPredictorPtr predictor)
+    : desc_(desc), tp_(tp), predictor_(std::move(predictor)), device_id_(device_id) {
   CHECK(tp) << "[EasyDK InferServer] [Executor] Thread pool is null";
   CHECK_GE(device_id, 0) << "[EasyDK InferServer] [Executor] Device id is less than 0. device id: " << device_id;
   CHECK_GT(desc_.engine_num, 0u) << "[EasyDK InferServer] [Executor] Engine number cannot be 0";
@@ -42,17 +45,18 @@ Executor::Executor(const SessionDesc& desc, PriorityThreadPool* tp, int device_i
       << "[EasyDK InferServer] [Executor] model input pixel format cannot be INVALID";
 
   // init processors
-  auto predictor = Predictor::Create();
-  desc_.preproc->SetParams("model_info", desc_.model, "device_id", device_id_,
-                           "model_input_format", desc_.model_input_format);
+  if (!predictor_) {
+    // executor is not created by InferServer, use a predictor group of its own
+    predictor_ = std::make_shared<SharedPredictor>(desc_.model, device_id_);
+  }
+  CHECK(predictor_->GetModel()->GetKey() == desc_.model->GetKey() && predictor_->GetDeviceId() == device_id_)
+      << "[EasyDK InferServer] [Executor] Shared predictor does not match model or device";
+  desc_.preproc->SetParams(detail::kModelInfoKey, desc_.model, detail::kDeviceIdKey, device_id_,
+                           detail::kModelInputFormatKey, desc_.model_input_format);
   if (desc_.preproc->Init() != Status::SUCCESS)
     throw std::runtime_error(desc_.preproc->TypeName() + "] Init processors failed");
 
-  predictor->SetParams("model_info", desc_.model, "device_id", device_id_);
-  if (predictor->Init() != Status::SUCCESS)
-    throw std::runtime_error(predictor->TypeName() + "] Init processors failed");
-
-  desc_.postproc->SetParams("model_info", desc_.model, "device_id", device_id_);
+  desc_.postproc->SetParams(detail::kModelInfoKey, desc_.model, detail::kDeviceIdKey, device_id_);
   if (desc_.postproc->Init() != Status::SUCCESS)
     throw std::runtime_error(desc_.postproc->TypeName() + "] Init processors failed");
 
@@ -63,11 +67,19 @@ Executor::Executor(const SessionDesc& desc, PriorityThreadPool* tp, int device_i
     // std::unique_lock<std::mutex> lk(idle_queue_mutex_);
     // idle_queue_.push(idle);
   };
+  // pre/postprocessors are forked for each engine, predictors are shared with other executors of the same model
   engines_.reserve(desc_.engine_num);
-  engines_.emplace_back(new Engine({desc_.preproc, predictor, desc_.postproc}, std::move(notify_done_func), tp_));
-  for (size_t e_idx = 1; e_idx < desc_.engine_num; ++e_idx) {
-    engines_.emplace_back(engines_[0]->Fork());
+  for (size_t e_idx = 0; e_idx < desc_.engine_num; ++e_idx) {
+    std::shared_ptr<Processor> preproc = e_idx ? desc_.preproc->Fork() : desc_.preproc;
+    if (!preproc) throw std::runtime_error("Fork processor failed: " + desc_.preproc->TypeName());
+    std::shared_ptr<Processor> predictor = predictor_->Get(e_idx);
+    if (!predictor) throw std::runtime_error("Predictor] Init processors failed");
+    std::shared_ptr<Processor> postproc = e_idx ? desc_.postproc->Fork() : desc_.postproc;
+    if (!postproc) throw std::runtime_error("Fork processor failed: " + desc_.postproc->TypeName());
+    engines_.emplace_back(new Engine({preproc, predictor, postproc}, Engine::NotifyDoneFunc(notify_done_func), tp_,
+                                     predictor_.get(), e_idx));
   }
+  predictor_->Link(tp_);
   idle_.store(engines_[0].get());
 
   // for(auto &it:engines_) {
@@ -86,6 +98,7 @@ Executor::Executor(const SessionDesc& desc, PriorityThreadPool* tp, int device_i
   } else {
     CHECK(false) << "[EasyDK InferServer] [Executor] Unsupported BatchStrategy";
   }
+  cache_->SetBatchTrace(desc_.batch_trace);
   cache_->Start();
 
   dispatch_thread_ = std::thread(&Executor::DispatchLoop, this);
@@ -108,6 +121,7 @@ Executor::~Executor() {
   CHECK(link_set_.empty()) << "[EasyDK InferServer] [Executor] Should not have any session in destructor";
   idle_.store(nullptr);
   engines_.clear();
+  predictor_->Unlink();
 }
 
 void Executor::DispatchLoop() noexcept {
@@ -215,23 +229,28 @@ void Session::DiscardTask(const std::string& tag) noexcept {
 #endif
 }
 
-RequestControl* Session::Send(PackagePtr&& pack, std::function<void(Status, PackagePtr)>&& response) noexcept {
+void Session::DiscardRequest(int64_t request_id) noexcept {
+  VLOG(1) << "[EasyDK InferServer] [Session] session " << name_ << " discard request " << request_id;
+  if (!executor_->GetDesc().batch_timeout) executor_->FlushCache();
+  std::unique_lock<std::mutex> lk(request_mutex_);
+  auto iter = std::find_if(request_list_.begin(), request_list_.end(),
+                           [request_id](RequestControl* it) { return it->RequestId() == request_id; });
+  if (iter != request_list_.end()) (*iter)->Discard();
+}
+
+RequestControl* Session::Send(PackagePtr&& pack, std::function<void(Status, PackagePtr)>&& response,
+                              int64_t* request_id) noexcept {
   if (!running_.load()) {
     LOG(ERROR) << "[EasyDK InferServer] [Session] This session is not running [" << name_ << "]";
     return nullptr;
   }
 
-  if (pack->predict_io && pack->predict_io->HasValue()) {
-    if (executor_->GetDesc().strategy != BatchStrategy::STATIC) {
-      LOG(ERROR) << "[EasyDK InferServer] [Session] Input continuous data to skip preprocess is only supported under"
-                 << " BatchStrategy::STATIC";
-      return nullptr;
-    }
-    if (pack->data.size() > executor_->GetModel()->BatchSize()) {
-      LOG(ERROR) << "[EasyDK InferServer] [Session] Input continuous data to skip preprocess is only supported when"
-                 << " data number <= model batch size";
-      return nullptr;
-    }
+  bool premade_input = pack->predict_io && pack->predict_io->HasValue();
+  if (premade_input && executor_->GetDesc().strategy == BatchStrategy::STATIC &&
+      pack->data.size() > executor_->GetModel()->BatchSize()) {
+    LOG(ERROR) << "[EasyDK InferServer] [Session] Input continuous data to skip preprocess is only supported when"
+               << " data number <= model batch size under BatchStrategy::STATIC";
+    return nullptr;
   }
   // since cannot classify data size from continuous data,
   // we use batch_size set in package instead of size of pack->data
@@ -243,7 +262,9 @@ RequestControl* Session::Send(PackagePtr&& pack, std::function<void(Status, Pack
   std::unique_lock<std::mutex> lk(request_mutex_);
   RequestControl* ctrl =
       new RequestControl(std::move(response), std::bind(&Session::CheckAndResponse, this, std::placeholders::_1),
-                         pack->tag, request_id_++, data_size);
+                         pack->tag, request_id_, data_size);
+  if (request_id) *request_id = request_id_;
+  ++request_id_;
 #ifdef CNIS_RECORD_PERF
   ctrl->BeginRecord();
 #endif
@@ -254,6 +275,15 @@ RequestControl* Session::Send(PackagePtr&& pack, std::function<void(Status, Pack
   request_list_.push_back(ctrl);
   lk.unlock();
 
+  if (premade_input && executor_->GetDesc().strategy == BatchStrategy::DYNAMIC) {
+    // each data refers to its slice of continuous data, so that it could be rebatched with data of other requests
+    for (auto& it : pack->data) {
+      it->predict_io = pack->predict_io;
+      it->io_index = it->index;
+    }
+    pack->predict_io.reset();
+  }
+
   if (data_size) {
     CHECK(executor_->Upload(std::move(pack), ctrl)) << "[EasyDK InferServer] [Session] Cache should be running";
   } else {
@@ -293,6 +323,8 @@ void Session::CheckAndResponse(const RequestControl* caller) noexcept {
     do {
 #ifdef CNIS_RECORD_PERF
       profiler_.RequestEnd(next->Tag(), next->DataNum());
+      // resources are consumed even if request is discarded
+      usage_recorder_.Record(next->Tag(), next->Usage());
 #endif
       if (!next->IsDiscarded()) {
 #ifdef CNIS_RECORD_PERF
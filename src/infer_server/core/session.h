@@ -42,6 +42,7 @@
 #include "priority.h"
 #include "profile.h"
 #include "request_ctrl.h"
+#include "shared_predictor.h"
 #include "util/thread_pool.h"
 
 namespace infer_server {
@@ -58,6 +59,7 @@ class Session {
     // update and print performance information every 2 second
     perf_timer_.NotifyEvery(2000, [this, show_perf]() {
       profiler_.Update();
+      usage_recorder_.Snapshot();
       if (show_perf) {
         LOG(INFO) << "[EasyDK InferServer] [" << name_ << "] Session rps (total): " << profiler_.RequestPerSecond();
         LOG(INFO) << "[EasyDK InferServer] [" << name_ << "] Session ups (total): " << profiler_.UnitPerSecond();
@@ -100,7 +102,8 @@ class Session {
 
   void SetObserver(std::shared_ptr<Observer> observer) noexcept { observer_ = std::move(observer); }
 
-  RequestControl* Send(PackagePtr&& data, std::function<void(Status, PackagePtr)>&& notifier) noexcept;
+  RequestControl* Send(PackagePtr&& data, std::function<void(Status, PackagePtr)>&& notifier,
+                       int64_t* request_id = nullptr) noexcept;
 
   void CheckAndResponse(const RequestControl* caller) noexcept;
 
@@ -108,10 +111,14 @@ class Session {
 
   void DiscardTask(const std::string& tag) noexcept;
 
+  void DiscardRequest(int64_t request_id) noexcept;
+
 #ifdef CNIS_RECORD_PERF
   const std::map<std::string, LatencyStatistic>& GetPerformance() const noexcept { return recorder_.GetPerformance(); }
   ThroughoutStatistic GetThroughout(const std::string& tag) noexcept { return profiler_.Summary(tag); }
   ThroughoutStatistic GetThroughout() noexcept { return profiler_.Summary(); }
+  UsageStatistic GetUsage(const std::string& tag) noexcept { return usage_recorder_.Get(tag); }
+  std::map<std::string, UsageStatistic> GetUsageSnapshot() noexcept { return usage_recorder_.GetSnapshot(); }
 #endif
 
  private:
@@ -127,6 +134,7 @@ class Session {
   LatencyRecorder recorder_;
   Timer perf_timer_;
   TagSetProfiler profiler_;
+  UsageRecorder usage_recorder_;
 #endif
 
   int64_t request_id_{0};
@@ -139,7 +147,7 @@ class Session {
 class Engine;
 class Executor {
  public:
-  Executor(const SessionDesc& desc, PriorityThreadPool* tp, int device_id);
+  Executor(const SessionDesc& desc, PriorityThreadPool* tp, int device_id, SharedPredictorPtr predictor = nullptr);
 
   ~Executor();
 
@@ -191,6 +199,7 @@ class Executor {
   std::string GetName() const noexcept { return desc_.name; }
   uint32_t GetEngineNum() const noexcept { return desc_.engine_num; }
   PriorityThreadPool* GetThreadPool() const noexcept { return tp_; }
+  const SharedPredictorPtr& GetSharedPredictor() const noexcept { return predictor_; }
   /* ----------------- Observer END ------------------- */
 
   void ReleaseCount(uint32_t data_num) {
@@ -211,6 +220,7 @@ class Executor {
  private:
   SessionDesc desc_;
   PriorityThreadPool* tp_;
+  SharedPredictorPtr predictor_;
   std::unique_ptr<CacheBase> cache_;
 
   // manage link
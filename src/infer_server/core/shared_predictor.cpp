@@ -0,0 +1,241 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "shared_predictor.h"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "cnis/processor.h"
+#include "param_keys.h"
+#include "priority.h"
+#include "profile.h"
+#include "request_ctrl.h"
+
+namespace infer_server {
+
+namespace {
+
+// A view of buffers [offset, offset + num) of batched buffers, which keeps the batched buffers alive
+cnedk::BufSurfWrapperPtr SliceBatch(const cnedk::BufSurfWrapperPtr& buf, uint32_t offset, uint32_t num) {
+  CnedkBufSurface* src = buf->GetBufSurface();
+  CnedkBufSurface* view = new CnedkBufSurface(*src);
+  view->batch_size = num;
+  view->num_filled = num;
+  view->opaque = nullptr;
+  view->surface_list = new CnedkBufSurfaceParams[num];
+  memcpy(view->surface_list, src->surface_list + offset, num * sizeof(CnedkBufSurfaceParams));
+  return cnedk::BufSurfWrapperPtr(new cnedk::BufSurfaceWrapper(view, false), [buf, view](cnedk::BufSurfaceWrapper* w) {
+    delete w;
+    delete[] view->surface_list;
+    delete view;
+  });
+}
+
+}  // namespace
+
+SharedPredictor::SharedPredictor(ModelPtr model, int device_id) noexcept
+    : model_(std::move(model)), device_id_(device_id) {}
+
+SharedPredictor::~SharedPredictor() {
+  std::unique_lock<std::mutex> lk(merge_mutex_);
+  // flush may be left in thread pool after the pending batch is full
+  flush_cond_.wait(lk, [this]() { return flush_num_ == 0; });
+  // executors have been unlinked, nothing should be pending
+  CHECK(pending_.empty()) << "[EasyDK InferServer] [SharedPredictor] Pending packs are not inferred";
+}
+
+std::shared_ptr<Processor> SharedPredictor::Get(size_t idx) noexcept {
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (predictors_.size() <= idx) {
+    std::shared_ptr<Processor> predictor;
+    if (predictors_.empty()) {
+      predictor = Predictor::Create();
+      predictor->SetParams(detail::kModelInfoKey, model_, detail::kDeviceIdKey, device_id_);
+      if (predictor->Init() != Status::SUCCESS) predictor.reset();
+    } else {
+      predictor = predictors_[0]->Fork();
+    }
+    if (!predictor) {
+      LOG(ERROR) << "[EasyDK InferServer] [SharedPredictor] Get(): Init predictor failed, model: " << model_->GetKey();
+      return nullptr;
+    }
+    VLOG(1) << "[EasyDK InferServer] [SharedPredictor] Create predictor " << predictors_.size()
+            << " for model: " << model_->GetKey() << ", device: " << device_id_;
+    predictors_.emplace_back(std::move(predictor));
+  }
+  return predictors_[idx];
+}
+
+void SharedPredictor::Link(PriorityThreadPool* tp) noexcept {
+  std::unique_lock<std::mutex> lk(merge_mutex_);
+  ++source_num_;
+  tp_ = tp;
+}
+
+void SharedPredictor::Unlink() noexcept {
+  std::unique_lock<std::mutex> lk(merge_mutex_);
+  --source_num_;
+}
+
+std::vector<SharedPredictor::Pending> SharedPredictor::TakePending() noexcept {
+  std::vector<Pending> group;
+  group.swap(pending_);
+  pending_num_ = 0;
+  return group;
+}
+
+void SharedPredictor::Submit(size_t idx, PackagePtr pack, Done&& done) noexcept {
+  const uint32_t batch_size = model_->BatchSize();
+  const uint32_t num = pack->data.size();
+  std::vector<Pending> flush, full;
+  std::unique_lock<std::mutex> lk(merge_mutex_);
+  // partial batches are merged with packs from other executors, outputs are sliced by batch so must be batched
+  bool mergeable = source_num_ > 1 && tp_ && num < batch_size && model_->FixedOutputShape();
+  if (!mergeable) {
+    lk.unlock();
+    Run({Pending{idx, std::move(pack), std::move(done)}});
+    return;
+  }
+  if (pending_num_ + num > batch_size) flush = TakePending();
+  // queue flush behind preprocessed packs of the same priority, which are merged once inferred
+  if (!flush_scheduled_) {
+    flush_scheduled_ = true;
+    ++flush_num_;
+    tp_->VoidPush(Priority::Offset(pack->priority, -1), &SharedPredictor::Flush, this);
+  }
+  pending_.emplace_back(Pending{idx, std::move(pack), std::move(done)});
+  pending_num_ += num;
+  if (pending_num_ == batch_size) full = TakePending();
+  lk.unlock();
+  if (!flush.empty()) Run(std::move(flush));
+  if (!full.empty()) Run(std::move(full));
+}
+
+void SharedPredictor::Flush() noexcept {
+  std::unique_lock<std::mutex> lk(merge_mutex_);
+  // no more packs queued to merge, infer the partial batch
+  std::vector<Pending> group = TakePending();
+  flush_scheduled_ = false;
+  lk.unlock();
+  if (!group.empty()) Run(std::move(group));
+  // notify under lock, predictor may be destructed once flush_num_ is zero
+  lk.lock();
+  --flush_num_;
+  flush_cond_.notify_all();
+}
+
+Status SharedPredictor::Infer(const std::shared_ptr<Processor>& predictor, const std::vector<Pending>& group) noexcept {
+  if (group.size() == 1) return predictor->Process(group[0].pack);
+
+  // each data of the merged pack refers to its slice of the preprocessed input, predictor gathers them into a batch
+  auto merged = std::make_shared<Package>();
+  for (auto& it : group) {
+    merged->priority = std::max(merged->priority, it.pack->priority);
+    for (size_t pos = 0; pos < it.pack->data.size(); ++pos) {
+      const InferDataPtr& data = it.pack->data[pos];
+      auto slice = std::make_shared<InferData>();
+      slice->ctrl = data->ctrl;
+      if (it.pack->predict_io && it.pack->predict_io->HasValue()) {
+        slice->predict_io = it.pack->predict_io;
+        slice->io_index = pos;
+      } else {
+        slice->predict_io = data->predict_io;
+        slice->io_index = data->io_index;
+      }
+      merged->data.emplace_back(std::move(slice));
+    }
+  }
+  Status s = predictor->Process(merged);
+  if (s != Status::SUCCESS) return s;
+
+  // give each pack its slice of outputs
+  const ModelIO& outputs = merged->predict_io->GetLref<ModelIO>();
+  uint32_t offset = 0;
+  for (auto& it : group) {
+    uint32_t num = it.pack->data.size();
+    ModelIO sliced;
+    for (size_t o_idx = 0; o_idx < outputs.surfs.size(); ++o_idx) {
+      sliced.surfs.emplace_back(SliceBatch(outputs.surfs[o_idx], offset, num));
+      Shape shape = outputs.shapes[o_idx];
+      shape[0] = num;
+      sliced.shapes.emplace_back(std::move(shape));
+    }
+    for (auto& data : it.pack->data) data->predict_io.reset();
+    it.pack->predict_io.reset(new InferData);
+    it.pack->predict_io->Set(std::move(sliced));
+    offset += num;
+  }
+  return Status::SUCCESS;
+}
+
+void SharedPredictor::Run(std::vector<Pending>&& group) noexcept {
+  std::shared_ptr<Processor> predictor = Get(group[0].idx);
+  if (group.size() > 1) {
+    ++merged_batch_num_;
+    VLOG(3) << "[EasyDK InferServer] [SharedPredictor] Merge " << group.size() << " packs into one batch";
+  }
+  Status s = Status::ERROR_BACKEND;
+  if (predictor) {
+#if defined(CNIS_RECORD_PERF) && (!defined(NDEBUG))
+    auto before_lock = Clock::Now();
+#endif
+    std::unique_lock<std::mutex> lk = predictor->Lock();
+#ifdef CNIS_RECORD_PERF
+    auto start = Clock::Now();
+    size_t in_bytes = 0;
+    size_t total = 0;
+    for (auto& it : group) {
+      in_bytes += ModelIOBytes(it.pack->predict_io);
+      total += it.pack->data.size();
+    }
+#endif
+    s = Infer(predictor, group);
+    lk.unlock();
+#ifdef CNIS_RECORD_PERF
+    auto end = Clock::Now();
+    // usage of the merged batch is prorated by share of each data
+    double share = total ? 1.0 / total : 0;
+    size_t out_bytes = 0;
+    for (auto& it : group) out_bytes += ModelIOBytes(it.pack->predict_io);
+    UsageStatistic usage;
+    usage.device_time = Clock::Duration(start, end) * share;
+    usage.bytes = (in_bytes + out_bytes) * share;
+    const std::string& type_name = predictor->TypeName();
+    for (auto& it : group) {
+      it.pack->perf[type_name] = Clock::Duration(start, end);
+#ifndef NDEBUG
+      it.pack->perf["-WaitLock-" + type_name] = Clock::Duration(before_lock, start);
+#endif
+      for (auto& data : it.pack->data) data->ctrl->AddUsage(usage);
+    }
+#endif
+  }
+  for (auto& it : group) {
+    it.done(std::move(it.pack), s);
+  }
+}
+
+}  // namespace infer_server
@@ -0,0 +1,127 @@
+/*************************************************************************
+ * Copyright (C) [2020] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#ifndef INFER_SERVER_CORE_SHARED_PREDICTOR_H_
+#define INFER_SERVER_CORE_SHARED_PREDICTOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnis/infer_server.h"
+#include "util/thread_pool.h"
+
+namespace infer_server {
+
+/**
+ * @brief Predictors of a model on a device, shared by all executors of the model
+ *
+ * Preprocessed packs from executors are submitted to a merging stage in front of the predictors. Partial batches from
+ * different executors (i.e. sessions with different pre/postprocessors) are merged into one inference, and each pack
+ * gets its own slice of the outputs back, to be postprocessed by its executor. Partial batches are merged only with
+ * packs already queued in the thread pool, they never wait for packs to come since batch timeout has been waited by
+ * the executor.
+ */
+class SharedPredictor {
+ public:
+  /// Invoked after the pack is inferred, pack->predict_io holds outputs of the pack on success
+  using Done = std::function<void(PackagePtr pack, Status status)>;
+
+  SharedPredictor(ModelPtr model, int device_id) noexcept;
+  ~SharedPredictor();
+
+  /**
+   * @brief Get predictor for engine `idx`, create it if not exist
+   *
+   * @param idx index of engine in executor
+   * @return std::shared_ptr<Processor> predictor, nullptr if init predictor failed
+   */
+  std::shared_ptr<Processor> Get(size_t idx) noexcept;
+
+  /**
+   * @brief Link an executor which submits packs
+   *
+   * @param tp thread pool to run merged batches, partial batches are merged with packs queued in it ahead of them
+   */
+  void Link(PriorityThreadPool* tp) noexcept;
+  void Unlink() noexcept;
+
+  /**
+   * @brief Infer a preprocessed pack, it is merged with packs from other executors if it is a partial batch
+   *
+   * @param idx index of engine in executor, the predictor of which infers the pack if it is not merged
+   * @param pack preprocessed pack
+   * @param done invoked after the pack is inferred
+   */
+  void Submit(size_t idx, PackagePtr pack, Done&& done) noexcept;
+
+  /* ---------------- Observer -------------------*/
+  size_t Size() noexcept {
+    std::unique_lock<std::mutex> lk(mutex_);
+    return predictors_.size();
+  }
+  const ModelPtr& GetModel() const noexcept { return model_; }
+  int GetDeviceId() const noexcept { return device_id_; }
+  // number of inferences which merged more than one pack
+  uint64_t MergedBatchNum() const noexcept { return merged_batch_num_.load(); }
+  /* -------------- Observer END -----------------*/
+
+ private:
+  struct Pending {
+    size_t idx;
+    PackagePtr pack;
+    Done done;
+  };
+
+  // must be called with merge_mutex_ locked
+  std::vector<Pending> TakePending() noexcept;
+  // infer the partial batch pending, in the thread pool after packs queued ahead
+  void Flush() noexcept;
+  void Run(std::vector<Pending>&& group) noexcept;
+  Status Infer(const std::shared_ptr<Processor>& predictor, const std::vector<Pending>& group) noexcept;
+
+  ModelPtr model_;
+  int device_id_;
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<Processor>> predictors_;
+
+  // merging stage
+  std::mutex merge_mutex_;
+  std::condition_variable flush_cond_;
+  std::vector<Pending> pending_;
+  uint32_t pending_num_{0};
+  size_t source_num_{0};
+  PriorityThreadPool* tp_{nullptr};
+  bool flush_scheduled_{false};
+  // number of flushes scheduled or running
+  uint32_t flush_num_{0};
+  std::atomic<uint64_t> merged_batch_num_{0};
+};  // class SharedPredictor
+
+using SharedPredictorPtr = std::shared_ptr<SharedPredictor>;
+
+}  // namespace infer_server
+
+#endif  // INFER_SERVER_CORE_SHARED_PREDICTOR_H_
@@ -31,6 +31,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "cnedk_memory_budget.hpp"
 #include "cnis/infer_server.h"
 #include "cnis/processor.h"
 #include "cnis/shape.h"
@@ -197,12 +198,20 @@ class ModelManager {
   std::shared_ptr<Model> GetModel(const std::string& name) noexcept;
 
  private:
+  ModelManager();
   std::string DownloadModel(const std::string& url) noexcept;
   void CheckAndCleanCache() noexcept;
+  using CacheIter = std::unordered_map<std::string, std::shared_ptr<Model>>::iterator;
+  CacheIter EraseModel(CacheIter iter) noexcept;
+  // reclaim function of model cache, evicts models not in use
+  size_t Evict(size_t bytes) noexcept;
 
   std::string model_dir_{"."};
+  // host memory taken by cached models, approximated by the size of serialized models
+  std::unique_ptr<cnedk::MemoryAccount> account_;
 
   static std::unordered_map<std::string, std::shared_ptr<Model>> model_cache_;
+  static std::unordered_map<std::string, size_t> model_bytes_;
   static std::mutex model_cache_mutex_;
 };  // class ModelManager
 
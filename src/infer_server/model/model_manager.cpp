@@ -34,6 +34,7 @@
 namespace infer_server {
 
 std::unordered_map<std::string, std::shared_ptr<Model>> ModelManager::model_cache_;
+std::unordered_map<std::string, size_t> ModelManager::model_bytes_;
 std::mutex ModelManager::model_cache_mutex_;
 
 #define RETURN_VAL_IF_FAIL(cond, msg, ret_val) \
@@ -44,6 +45,9 @@ std::mutex ModelManager::model_cache_mutex_;
     }                                          \
   } while (0)
 
+// set while Load() of this thread holds the cache lock and reserves memory, which may evict models of the cache
+static thread_local bool g_cache_locked = false;
+
 namespace detail {
 struct BeginWith {
   explicit BeginWith(const std::string& str) noexcept : s(str) {}
@@ -60,6 +64,10 @@ inline bool IsNetFile(const std::string& url) {
 }
 }  // namespace detail
 
+ModelManager::ModelManager()
+    : account_(new cnedk::MemoryAccount(cnedk::kHostMemory, cnedk::kMemCategoryModelCache, cnedk::MemLimits(),
+                                        [this](size_t bytes) { return Evict(bytes); })) {}
+
 ModelManager* ModelManager::Instance() noexcept {
   static ModelManager m;
   return &m;
@@ -77,15 +85,41 @@ static inline std::string GetModelKey(const void* mem_ptr) noexcept {
 
 void ModelManager::CheckAndCleanCache() noexcept {
   if (model_cache_.size() >= GetUlongFromEnv("CNIS_MODEL_CACHE_LIMIT", 10)) {
-    for (auto& p : model_cache_) {
-      if (p.second.use_count() == 1) {
-        model_cache_.erase(p.first);
+    for (auto iter = model_cache_.begin(); iter != model_cache_.end(); ++iter) {
+      if (iter->second.use_count() == 1) {
+        EraseModel(iter);
         break;
       }
     }
   }
 }
 
+ModelManager::CacheIter ModelManager::EraseModel(CacheIter iter) noexcept {
+  auto bytes = model_bytes_.find(iter->first);
+  if (bytes != model_bytes_.end()) {
+    account_->Release(bytes->second);
+    model_bytes_.erase(bytes);
+  }
+  return model_cache_.erase(iter);
+}
+
+size_t ModelManager::Evict(size_t bytes) noexcept {
+  std::unique_lock<std::mutex> lk(model_cache_mutex_, std::defer_lock);
+  if (!g_cache_locked && !lk.try_lock()) return 0;
+  size_t released = 0;
+  for (auto iter = model_cache_.begin(); iter != model_cache_.end() && released < bytes;) {
+    if (iter->second.use_count() == 1) {
+      auto model_bytes = model_bytes_.find(iter->first);
+      if (model_bytes != model_bytes_.end()) released += model_bytes->second;
+      LOG(INFO) << "[EasyDK InferServer] [ModelManager] Evict model from cache: " << iter->first;
+      iter = EraseModel(iter);
+    } else {
+      ++iter;
+    }
+  }
+  return released;
+}
+
 ModelPtr ModelManager::Load(const std::string& model_file, const std::vector<Shape>& in_shape) noexcept {
   std::string model_path;
   // check if model file exist
@@ -95,12 +129,12 @@ ModelPtr ModelManager::Load(const std::string& model_file, const std::vector<Sha
         "[EasyDK InferServer] [ModelManager] Download model graph file failed: " + model_file, nullptr);
   } else {
     model_path = model_file;
-    std::ifstream f;
-    f.open(model_path);
-    RETURN_VAL_IF_FAIL(f.is_open(),
-        "[EasyDK InferServer] [ModelManager] Model file not exist. Please check model path: " + model_path, nullptr);
-    f.close();
   }
+  std::ifstream f(model_path, std::ios::binary | std::ios::ate);
+  RETURN_VAL_IF_FAIL(f.is_open(),
+      "[EasyDK InferServer] [ModelManager] Model file not exist. Please check model path: " + model_path, nullptr);
+  size_t model_size = f.tellg();
+  f.close();
 
   std::string model_key = model_path;
 
@@ -108,12 +142,19 @@ ModelPtr ModelManager::Load(const std::string& model_file, const std::vector<Sha
   if (model_cache_.find(model_key) == model_cache_.cend()) {
     // cache not hit
     LOG(INFO) << "[EasyDK InferServer] [ModelManager] Load model from model file: " << model_path;
+    g_cache_locked = true;
+    bool reserved = account_->Reserve(model_size);
+    g_cache_locked = false;
+    RETURN_VAL_IF_FAIL(reserved,
+        "[EasyDK InferServer] [ModelManager] Out of memory budget of model cache, model: " + model_path, nullptr);
     auto model = std::make_shared<Model>();
     if (!model->Init(model_path, in_shape)) {
+      account_->Release(model_size);
       return nullptr;
     }
     CheckAndCleanCache();
     model_cache_[model_key] = model;
+    model_bytes_[model_key] = model_size;
     return model;
   } else {
     // cache hit
@@ -133,12 +174,19 @@ ModelPtr ModelManager::Load(void* mem_ptr, size_t size, const std::vector<Shape>
   if (model_cache_.find(model_key) == model_cache_.cend()) {
     // cache not hit
     LOG(INFO) << "[EasyDK InferServer] [ModelManager] Load model from memory: " << mem_ptr << ", size: " << size;
+    g_cache_locked = true;
+    bool reserved = account_->Reserve(size);
+    g_cache_locked = false;
+    RETURN_VAL_IF_FAIL(reserved,
+        "[EasyDK InferServer] [ModelManager] Out of memory budget of model cache, model: " + model_key, nullptr);
     auto model = std::make_shared<Model>();
     if (!model->Init(mem_ptr, size, in_shape)) {
+      account_->Release(size);
       return nullptr;
     }
     CheckAndCleanCache();
     model_cache_[model_key] = model;
+    model_bytes_[model_key] = size;
     return model;
   } else {
     // cache hit
@@ -161,17 +209,20 @@ bool ModelManager::Unload(ModelPtr model) noexcept {
   RETURN_VAL_IF_FAIL(model, "[EasyDK InferServer] [ModelManager] Model is nullptr!", false);
   const std::string& model_key = model->GetKey();
   std::lock_guard<std::mutex> lk(model_cache_mutex_);
-  if (model_cache_.find(model_key) == model_cache_.cend()) {
+  auto iter = model_cache_.find(model_key);
+  if (iter == model_cache_.end()) {
     LOG(WARNING) << "[EasyDK InferServer] [ModelManager] Model is not in cache";
     return false;
   } else {
-    model_cache_.erase(model_key);
+    EraseModel(iter);
     return true;
   }
 }
 
 void ModelManager::ClearCache() noexcept {
   std::lock_guard<std::mutex> lk(model_cache_mutex_);
+  for (auto& p : model_bytes_) account_->Release(p.second);
+  model_bytes_.clear();
   model_cache_.clear();
 }
 
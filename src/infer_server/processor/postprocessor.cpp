@@ -30,6 +30,7 @@
 #include "cnis/processor.h"
 #include "cnrt.h"
 #include "core/data_type.h"
+#include "core/param_keys.h"
 #include "model/model.h"
 #include "util/env.h"
 #include "util/thread_pool.h"
@@ -85,13 +86,13 @@ Status Postprocessor::Init() noexcept {
   }
 
   try {
-    priv_->model = GetParam<ModelPtr>("model_info");
+    priv_->model = GetParam(detail::kModelInfoKey);
     priv_->handler = GetPostprocHandler(priv_->model->GetKey());
     if (!priv_->handler) {
       LOG(WARNING) << "[EasyDK InferServer] [Postprocessor] The IPostproc handler has not been set,"
                    << " postprocessor will output ModelIO directly";
     }
-    int device_id = GetParam<int>("device_id");
+    int device_id = GetParam(detail::kDeviceIdKey);
 
     if (!SetCurrentDevice(device_id)) return Status::ERROR_BACKEND;
   } catch (bad_any_cast&) {
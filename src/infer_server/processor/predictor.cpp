@@ -31,6 +31,7 @@
 #include "cnedk_buf_surface_util.hpp"
 #include "cnis/processor.h"
 #include "core/data_type.h"
+#include "core/param_keys.h"
 #include "model/model.h"
 #include "../common/utils.hpp"
 
@@ -45,12 +46,131 @@ struct PredictorPrivate {
   std::shared_ptr<ModelRunner> runner;
   // output layouts of model output on device
   vector<DataLayout> layouts;
+  // buffers to gather continuous data from different requests, created on first use
+  vector<std::shared_ptr<cnedk::BufPool>> gather_pools;
+  // queue to copy slices of continuous data, all slices of a batch are synchronized once
+  cnrtQueue_t gather_queue{nullptr};
+  int device_id{0};
+  bool edge_platform{false};
+
+  Status CreateGatherPools() noexcept;
+  Status GatherInput(Package* pack) noexcept;
 };
 
+Status PredictorPrivate::CreateGatherPools() noexcept {
+  if (!gather_queue) {
+    CNRT_SAFECALL(cnrtQueueCreate(&gather_queue), "[InferServer] [Predictor] Create gather queue failed",
+                  Status::ERROR_BACKEND);
+  }
+  for (size_t i = 0; i < model->InputNum(); ++i) {
+    std::shared_ptr<cnedk::BufPool> pool = std::make_shared<cnedk::BufPool>();
+    CnedkBufSurfaceCreateParams create_params;
+    memset(&create_params, 0, sizeof(create_params));
+    create_params.mem_type = edge_platform ? CNEDK_BUF_MEM_UNIFIED_CACHED : CNEDK_BUF_MEM_DEVICE;
+    create_params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+    create_params.device_id = device_id;
+    create_params.batch_size = 1;
+    create_params.force_align_1 = 1;
+    create_params.size = model->InputShape(i).BatchDataCount() * GetTypeSize(model->InputLayout(i).dtype);
+    if (pool->CreatePool(&create_params, 3, cnedk::kMemCategoryPredictorOutput) < 0) {
+      LOG(ERROR) << "[EasyDK InferServer] [Predictor] Create gather buffer pool failed";
+      gather_pools.clear();
+      return Status::ERROR_BACKEND;
+    }
+    gather_pools.emplace_back(pool);
+  }
+  return Status::SUCCESS;
+}
+
+// Copy slices of continuous data owned by each data into one batch. Adjacent slices from the same request are
+// copied by one memcpy. Copies are issued asynchronously to the gather queue and synchronized once per batch.
+Status PredictorPrivate::GatherInput(Package* pack) noexcept {
+  const size_t batch_num = pack->data.size();
+  if (batch_num > model->BatchSize()) {
+    LOG(ERROR) << "[EasyDK InferServer] [Predictor] Too many data to gather, " << batch_num << " > "
+               << model->BatchSize();
+    return Status::INVALID_PARAM;
+  }
+  for (auto& it : pack->data) {
+    if (!it->predict_io || !it->predict_io->HasValue()) {
+      LOG(ERROR) << "[EasyDK InferServer] [Predictor] Can not batch continuous data with data to be preprocessed";
+      return Status::INVALID_PARAM;
+    }
+  }
+  if (gather_pools.empty() && CreateGatherPools() != Status::SUCCESS) return Status::ERROR_BACKEND;
+
+  ModelIO gathered;
+  Status ret = Status::SUCCESS;
+  try {
+    for (size_t i_idx = 0; i_idx < model->InputNum(); ++i_idx) {
+      cnedk::BufSurfWrapperPtr dst = gather_pools[i_idx]->GetBufSurfaceWrapper(1000);
+      if (!dst) {
+        LOG(ERROR) << "[EasyDK InferServer] [Predictor] Get gather buffer timeout";
+        ret = Status::TIMEOUT;
+        break;
+      }
+      // hold the buffer out of the loop, copies to it may be pending until the queue is synchronized
+      gathered.surfs.emplace_back(dst);
+      gathered.shapes.emplace_back(model->InputShape(i_idx));
+      uint8_t* dst_ptr = static_cast<uint8_t*>(dst->GetData(0));
+      size_t type_size = GetTypeSize(model->InputLayout(i_idx).dtype);
+
+      size_t b_idx = 0;
+      while (ret == Status::SUCCESS && b_idx < batch_num) {
+        const ModelIO& src = pack->data[b_idx]->predict_io->GetLref<ModelIO>();
+        if (src.surfs.size() != model->InputNum()) {
+          LOG(ERROR) << "[EasyDK InferServer] [Predictor] Input number of continuous data is mismatched";
+          ret = Status::INVALID_PARAM;
+          break;
+        }
+        Shape item_shape = src.shapes.size() > i_idx ? src.shapes[i_idx] : model->InputShape(i_idx);
+        size_t item_size = item_shape.DataCount() * type_size;
+        // merge following slices which are continuous in the same source
+        size_t run = 1;
+        while (b_idx + run < batch_num && pack->data[b_idx + run]->predict_io == pack->data[b_idx]->predict_io &&
+               pack->data[b_idx + run]->io_index == pack->data[b_idx]->io_index + run) {
+          ++run;
+        }
+        const uint8_t* src_ptr = static_cast<const uint8_t*>(src.surfs[i_idx]->GetData(0)) +
+                                 pack->data[b_idx]->io_index * item_size;
+        bool src_host = src.surfs[i_idx]->GetMemType() == CNEDK_BUF_MEM_SYSTEM ||
+                        src.surfs[i_idx]->GetMemType() == CNEDK_BUF_MEM_PINNED;
+        if (cnrtMemcpyAsync(dst_ptr + b_idx * item_size, const_cast<uint8_t*>(src_ptr), run * item_size,
+                            gather_queue, src_host ? cnrtMemcpyHostToDev : cnrtMemcpyDevToDev) != cnrtSuccess) {
+          LOG(ERROR) << "[EasyDK InferServer] [Predictor] GatherInput(): copy continuous data failed";
+          ret = Status::ERROR_BACKEND;
+          break;
+        }
+        b_idx += run;
+      }
+      if (ret != Status::SUCCESS) break;
+    }
+  } catch (bad_any_cast&) {
+    LOG(ERROR) << "[EasyDK InferServer] [Predictor] Continuous data should be ModelIO";
+    ret = Status::WRONG_TYPE;
+  }
+  // copies issued must be done before buffers are used or returned to pool
+  if (cnrtQueueSync(gather_queue) != cnrtSuccess) {
+    LOG(ERROR) << "[EasyDK InferServer] [Predictor] GatherInput(): sync gather queue failed";
+    if (ret == Status::SUCCESS) ret = Status::ERROR_BACKEND;
+  }
+  if (ret != Status::SUCCESS) return ret;
+
+  // slices have been copied, release requests' continuous data as soon as possible
+  for (auto& it : pack->data) {
+    it->predict_io.reset();
+  }
+  pack->predict_io.reset(new InferData);
+  pack->predict_io->Set(std::move(gathered));
+  return Status::SUCCESS;
+}
+
 Predictor::Predictor() noexcept : ProcessorForkable("Predictor"), priv_(new PredictorPrivate) {}
 
 Predictor::~Predictor() {
   priv_->output_pools.clear();
+  priv_->gather_pools.clear();
+  if (priv_->gather_queue) cnrtQueueDestroy(priv_->gather_queue);
 
   delete priv_;
 }
@@ -66,8 +186,8 @@ Status Predictor::Init() noexcept {
 
   int device_id = 0;
   try {
-    priv_->model = GetParam<ModelPtr>("model_info");
-    device_id = GetParam<int>("device_id");
+    priv_->model = GetParam(detail::kModelInfoKey);
+    device_id = GetParam(detail::kDeviceIdKey);
 
     if (cnrtSetDevice(device_id) != cnrtSuccess) return Status::ERROR_BACKEND;
   } catch (bad_any_cast&) {
@@ -75,6 +195,7 @@ Status Predictor::Init() noexcept {
     return Status::WRONG_TYPE;
   }
 
+  priv_->device_id = device_id;
   priv_->runner = ModelManager::Instance()->GetModel(priv_->model->GetKey())->GetRunner(device_id);
   if (!priv_->runner) {
     return Status::INVALID_PARAM;
@@ -85,6 +206,7 @@ Status Predictor::Init() noexcept {
     return Status::INVALID_PARAM;
   }
   std::string platform_name(platform_info.name);
+  priv_->edge_platform = cnedk::IsEdgePlatform(platform_name);
 
   size_t o_num = priv_->model->OutputNum();
   priv_->layouts.reserve(o_num);
@@ -108,7 +230,7 @@ Status Predictor::Init() noexcept {
       create_params.force_align_1 = 1;  // to meet mm's requirement
       create_params.size = priv_->model->OutputShape(i).BatchDataCount() * GetTypeSize(priv_->layouts[i].dtype);
       create_params.size /= create_params.batch_size;
-      pool->CreatePool(&create_params, 3);
+      pool->CreatePool(&create_params, 3, cnedk::kMemCategoryPredictorOutput);
       priv_->output_pools.emplace_back(pool);
     }
   }
@@ -118,8 +240,13 @@ Status Predictor::Init() noexcept {
 Status Predictor::Process(PackagePtr pack) noexcept {
   CHECK(pack) << "[EasyDK InferServer] [Predictor] Process pack. It should not be empty";
   if (!pack->predict_io || !pack->predict_io->HasValue()) {
-    LOG(ERROR) << "[EasyDK InferServer] [Predictor] Can process continuous data only";
-    return Status::INVALID_PARAM;
+    if (pack->data.empty() || !pack->data[0]->predict_io) {
+      LOG(ERROR) << "[EasyDK InferServer] [Predictor] Can process continuous data only";
+      return Status::INVALID_PARAM;
+    }
+    // continuous data of several requests are batched together
+    Status s = priv_->GatherInput(pack.get());
+    if (s != Status::SUCCESS) return s;
   }
 
   // previous processor must provide continuous_data to avoid copy
@@ -34,6 +34,7 @@
 #include "cnedk_transform.h"
 #include "cnedk_buf_surface_util.hpp"
 #include "core/data_type.h"
+#include "core/param_keys.h"
 #include "../common/utils.hpp"
 
 namespace infer_server {
@@ -357,9 +358,9 @@ Status Preprocessor::Init() noexcept {
   }
 
   try {
-    impl_->model = GetParam<ModelPtr>("model_info");
-    impl_->dev_id = GetParam<int>("device_id");
-    impl_->model_input_format = GetParam<NetworkInputFormat>("model_input_format");
+    impl_->model = GetParam(detail::kModelInfoKey);
+    impl_->dev_id = GetParam(detail::kDeviceIdKey);
+    impl_->model_input_format = GetParam(detail::kModelInputFormatKey);
     if (CnedkPlatformGetInfo(impl_->dev_id, &impl_->platform_info) < 0) {
       return Status::INVALID_PARAM;
     }
@@ -380,6 +381,20 @@ Status Preprocessor::Process(PackagePtr pack) noexcept {
     LOG(ERROR) << "[EasyDK InferServer] [Preprocessor] Process(): No data in package";
     return Status::INVALID_PARAM;
   }
+  if (pack->predict_io && pack->predict_io->HasValue()) {
+    VLOG(5) << "[EasyDK InferServer] [Preprocessor] Process(): Input continuous data, skip preprocess";
+    return Status::SUCCESS;
+  }
+  // a batch may mix continuous data with data to be preprocessed, preprocess the latter only
+  Package to_preproc;
+  for (auto &it : pack->data) {
+    if (!it->predict_io) to_preproc.data.emplace_back(it);
+  }
+  if (to_preproc.data.empty()) {
+    VLOG(5) << "[EasyDK InferServer] [Preprocessor] Process(): Input continuous data, skip preprocess";
+    return Status::SUCCESS;
+  }
+  const bool mixed = to_preproc.data.size() != pack->data.size();
   cnrtSetDevice(impl_->dev_id);
   if (impl_->executor->CheckAllocResource(impl_->tensor_params) < 0) {
     return Status::ERROR_BACKEND;
@@ -387,13 +402,13 @@ Status Preprocessor::Process(PackagePtr pack) noexcept {
   cnedk::BufSurfWrapperPtr preproc_output = nullptr;
   int ret = 0;
   try {
-    ret = impl_->executor->Execute(pack.get(), &preproc_output);
+    ret = impl_->executor->Execute(mixed ? &to_preproc : pack.get(), &preproc_output);
   } catch (infer_server::bad_any_cast &) {
     LOG(ERROR) << "[EasyDK InferServer] [Preprocessor] Process(): Preprocess error thrown";
     return Status::WRONG_TYPE;
   }
   // release input data
-  for (auto &it : pack->data) {
+  for (auto &it : to_preproc.data) {
     it->data.reset();
   }
   if (ret < 0) {
@@ -404,6 +419,16 @@ Status Preprocessor::Process(PackagePtr pack) noexcept {
   ModelIO model_input;
   model_input.surfs.emplace_back(preproc_output);
   model_input.shapes.emplace_back(impl_->model->InputShape(0));
+  if (mixed) {
+    // each preprocessed data refers to its slice of output, predictor gathers all slices into one batch
+    InferDataPtr output = std::make_shared<InferData>();
+    output->Set(std::move(model_input));
+    for (size_t idx = 0; idx < to_preproc.data.size(); ++idx) {
+      to_preproc.data[idx]->predict_io = output;
+      to_preproc.data[idx]->io_index = idx;
+    }
+    return Status::SUCCESS;
+  }
   pack->predict_io.reset(new InferData);
   pack->predict_io->Set(std::move(model_input));
   return Status::SUCCESS;
@@ -0,0 +1,99 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include "cnis/util/base_object.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace infer_server {
+namespace detail {
+
+namespace {
+
+// Names are looked up on every param access by name and registered rarely, so lookups read an immutable snapshot
+// without lock, and registering swaps in a new snapshot. Old snapshots are kept since readers may still refer to them,
+// there are only as many as param names.
+class ParamRegistry {
+ public:
+  static ParamRegistry& Instance() {
+    static ParamRegistry registry;
+    return registry;
+  }
+
+  size_t Register(const std::string& name) {
+    int found = Find(name);
+    if (found >= 0) return found;
+    std::unique_lock<std::mutex> lk(mutex_);
+    const Snapshot* current = snapshot_.load(std::memory_order_acquire);
+    // registered by another thread before lock
+    auto iter = current->ids.find(name);
+    if (iter != current->ids.end()) return iter->second;
+    std::unique_ptr<Snapshot> next(new Snapshot(*current));
+    size_t id = next->names.size();
+    next->names.push_back(name);
+    next->ids.emplace(name, id);
+    snapshot_.store(next.get(), std::memory_order_release);
+    snapshots_.emplace_back(std::move(next));
+    return id;
+  }
+
+  int Find(const std::string& name) const noexcept {
+    const Snapshot* current = snapshot_.load(std::memory_order_acquire);
+    auto iter = current->ids.find(name);
+    return iter == current->ids.end() ? -1 : static_cast<int>(iter->second);
+  }
+
+  std::string Name(size_t id) const {
+    const Snapshot* current = snapshot_.load(std::memory_order_acquire);
+    return id < current->names.size() ? current->names[id] : std::string();
+  }
+
+ private:
+  struct Snapshot {
+    std::unordered_map<std::string, size_t> ids;
+    std::vector<std::string> names;
+  };
+
+  ParamRegistry() {
+    snapshots_.emplace_back(new Snapshot);
+    snapshot_.store(snapshots_.back().get());
+  }
+
+  std::mutex mutex_;
+  std::atomic<const Snapshot*> snapshot_{nullptr};
+  std::vector<std::unique_ptr<Snapshot>> snapshots_;
+};
+
+}  // namespace
+
+size_t RegisterParamName(const std::string& name) { return ParamRegistry::Instance().Register(name); }
+
+int FindParamId(const std::string& name) noexcept { return ParamRegistry::Instance().Find(name); }
+
+std::string GetParamName(size_t id) { return ParamRegistry::Instance().Name(id); }
+
+}  // namespace detail
+}  // namespace infer_server
@@ -160,5 +160,6 @@ void ThreadPool<Q, T>::SetThread(int i) noexcept {
 // instantiate thread pool
 template class ThreadPool<TSQueue<Task>>;
 template class ThreadPool<ThreadSafeQueue<Task, std::priority_queue<Task, std::vector<Task>, Task::Compare>>>;
+template class ThreadPool<PriorityBandQueue<Task, Task::Band>>;
 
 }  // namespace infer_server
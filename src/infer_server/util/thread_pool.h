@@ -50,6 +50,8 @@ struct Task {
   std::function<void()> func = nullptr;
   /// Task priority
   int64_t priority = 0;
+  /// Order among tasks of the same priority, the smaller runs first
+  uint64_t order = 0;
   /**
    * @brief Construct a new Task object
    */
@@ -59,22 +61,42 @@ struct Task {
    *
    * @param f Function to be invoked
    * @param p Task priority
+   * @param o Order among tasks of the same priority
    */
-  Task(std::function<void()>&& f, int64_t p) : func(std::forward<std::function<void()>>(f)), priority(p) {}
+  Task(std::function<void()>&& f, int64_t p, uint64_t o = 0)
+      : func(std::forward<std::function<void()>>(f)), priority(p), order(o) {}
 
   /**
    * @brief Function object for performing comparisons between tasks
    */
   struct Compare {
     /**
-     * @brief Checks whether priority of the first task is less than the second
+     * @brief Checks whether the first task runs after the second
      *
      * @param lhs One task
      * @param rhs Another task
-     * @retval true If lhs.priority < rhs.priority
+     * @retval true If lhs.priority < rhs.priority, or priorities are equal and lhs.order > rhs.order
      * @retval false Otherwise
      */
-    bool operator()(const Task &lhs, const Task &rhs) { return lhs.priority < rhs.priority; }
+    bool operator()(const Task &lhs, const Task &rhs) {
+      return lhs.priority < rhs.priority || (lhs.priority == rhs.priority && lhs.order > rhs.order);
+    }
+  };
+
+  /**
+   * @brief Function object to map task to band of PriorityBandQueue by major priority (the highest byte)
+   */
+  struct Band {
+    /**
+     * @brief Get band of task, higher priority is mapped to higher or the same band
+     *
+     * @param t A task
+     * @return size_t Band in [0, 127]
+     */
+    size_t operator()(const Task &t) const noexcept {
+      int64_t major = t.priority >> 56;
+      return major < 0 ? 0 : (major > 127 ? 127 : static_cast<size_t>(major));
+    }
   };
 };
 
@@ -186,7 +208,7 @@ class ThreadPool {
     VLOG(4) << "[EasyDK InferServer] [ThreadPool] Thread pool (idle/total): " << IdleNumber() << " / " << Size();
     auto pck = std::make_shared<std::packaged_task<typename std::result_of<callable(arguments...)>::type()>>(
         std::bind(std::forward<callable>(f), std::forward<arguments>(args)...));
-    task_q_.Emplace([pck]() { (*pck)(); }, priority);
+    task_q_.Emplace([pck]() { (*pck)(); }, priority, NextOrder());
     cv_.notify_one();
     return pck->get_future();
   }
@@ -206,11 +228,34 @@ class ThreadPool {
   void VoidPush(int64_t priority, callable &&f, arguments &&... args) {
     VLOG(4) << "[EasyDK InferServer] [ThreadPool] Sumbit one task to threadpool, priority: " << priority;
     VLOG(4) << "[EasyDK InferServer] [ThreadPool] Thread pool (idle/total): " << IdleNumber() << " / " << Size();
-    task_q_.Emplace(std::bind(std::forward<callable>(f), std::forward<arguments>(args)...), priority);
+    task_q_.Emplace(std::bind(std::forward<callable>(f), std::forward<arguments>(args)...), priority, NextOrder());
     cv_.notify_one();
   }
 
+  /**
+   * @brief Set seed of scheduling. Tasks of the same priority run in submission order by default. Once seed is set,
+   *        they run in a pseudo-random order determined by the seed and the submission sequence, so that a schedule
+   *        could be reproduced or explored by seed.
+   *
+   * @note Only takes effect on queues ordered by Task::Compare, i.e. PriorityThreadPool
+   * @param seed Seed of scheduling
+   */
+  void SetSchedulingSeed(uint64_t seed) noexcept {
+    seed_.store(seed);
+    seeded_.store(true);
+  }
+
  private:
+  uint64_t NextOrder() noexcept {
+    uint64_t seq = sequence_.fetch_add(1);
+    if (!seeded_.load()) return seq;
+    // splitmix64
+    uint64_t z = seed_.load() + (seq + 1) * 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
   ThreadPool(const ThreadPool &) = delete;
   ThreadPool(ThreadPool &&) = delete;
   ThreadPool &operator=(const ThreadPool &) = delete;
@@ -225,6 +270,10 @@ class ThreadPool {
   std::atomic<bool> is_stop_{false};
   // how many threads are waiting (idle)
   std::atomic<uint32_t> n_waiting_{0};
+  // submission sequence and seed, to order tasks of the same priority
+  std::atomic<uint64_t> sequence_{0};
+  std::atomic<uint64_t> seed_{0};
+  std::atomic<bool> seeded_{false};
 
   std::mutex mutex_;
   std::condition_variable cv_;
@@ -237,6 +286,8 @@ using EqualityThreadPool = ThreadPool<TSQueue<Task>>;
 /// Alias of ThreadPool<ThreadSafeQueue<Task, std::priority_queue<Task, std::vector<Task>, Task::Compare>>>
 using PriorityThreadPool =
     ThreadPool<ThreadSafeQueue<Task, std::priority_queue<Task, std::vector<Task>, Task::Compare>>>;
+/// Alias of ThreadPool<PriorityBandQueue<Task, Task::Band>>, tasks are queued without lock
+using BandPriorityThreadPool = ThreadPool<PriorityBandQueue<Task, Task::Band>>;
 
 }  // namespace infer_server
 
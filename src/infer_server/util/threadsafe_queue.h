@@ -21,10 +21,22 @@
 #ifndef INFER_SERVER_UTIL_THREADSAFE_QUEUE_H_
 #define INFER_SERVER_UTIL_THREADSAFE_QUEUE_H_
 
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
 #include <condition_variable>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <queue>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -186,6 +198,419 @@ bool ThreadSafeQueue<T, Q>::WaitAndTryPop(T& value, const std::chrono::microseco
   }
 }
 
+namespace detail {
+/**
+ * @brief Event count built on futex, which makes lock-free queues able to block without a mutex
+ *
+ * Waiter: `key = PrepareWait()`, check the condition again, then `CancelWait()` or `Wait(key)`.
+ * Notifier: make the condition true, then `Notify()`.
+ */
+class EventCount {
+ public:
+  uint32_t PrepareWait() noexcept {
+    waiters_.fetch_add(1);
+    return epoch_.load();
+  }
+
+  void CancelWait() noexcept { waiters_.fetch_sub(1); }
+
+  /**
+   * @brief Block until notified or timeout, return immediately if notified after PrepareWait
+   *
+   * @retval true Notified (or spurious wake up)
+   * @retval false Timeout
+   */
+  bool Wait(uint32_t key, const std::chrono::microseconds* rel_time = nullptr) noexcept {
+    timespec ts;
+    if (rel_time) {
+      ts.tv_sec = rel_time->count() / 1000000;
+      ts.tv_nsec = (rel_time->count() % 1000000) * 1000;
+    }
+    long ret = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAIT_PRIVATE, key,  // NOLINT
+                       rel_time ? &ts : nullptr, nullptr, 0);
+    waiters_.fetch_sub(1);
+    return !(ret == -1 && errno == ETIMEDOUT);
+  }
+
+  void Notify(bool all = false) noexcept {
+    epoch_.fetch_add(1);
+    if (waiters_.load()) {
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1, nullptr,
+              nullptr, 0);
+    }
+  }
+
+ private:
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex requires 32-bit word");
+  std::atomic<uint32_t> epoch_{0};
+  std::atomic<uint32_t> waiters_{0};
+};  // class EventCount
+
+// Wait on `ec` until `try_func` succeeds or timeout
+template <typename Func>
+bool WaitFor(EventCount* ec, Func&& try_func, const std::chrono::microseconds rel_time) {
+  if (try_func()) return true;
+  auto deadline = std::chrono::steady_clock::now() + rel_time;
+  while (true) {
+    uint32_t key = ec->PrepareWait();
+    if (try_func()) {
+      ec->CancelWait();
+      return true;
+    }
+    auto remain = std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now());
+    if (remain.count() <= 0) {
+      ec->CancelWait();
+      return false;
+    }
+    ec->Wait(key, &remain);
+  }
+}
+
+// Wait on `ec` until `try_func` succeeds
+template <typename Func>
+void WaitUntil(EventCount* ec, Func&& try_func) {
+  while (!try_func()) {
+    uint32_t key = ec->PrepareWait();
+    if (try_func()) {
+      ec->CancelWait();
+      return;
+    }
+    ec->Wait(key);
+  }
+}
+}  // namespace detail
+
+/**
+ * @brief Bounded lock-free multi-producer multi-consumer queue (D. Vyukov's ring buffer)
+ *
+ * Each cell carries a sequence number, producers and consumers claim cells by CAS on their own position counter,
+ * so there is no lock on the fast path. Blocking operations sleep on futex based event counts.
+ *
+ * @tparam T Type of stored elements, should be move constructible
+ */
+template <typename T>
+class MpmcRingQueue {
+ public:
+  /// type of elements
+  using value_type = T;
+  /// type of size
+  using size_type = size_t;
+
+  /**
+   * @brief Construct a new Mpmc Ring Queue object
+   *
+   * @param capacity Maximum number of elements, rounded up to power of 2
+   */
+  explicit MpmcRingQueue(size_type capacity = 1024) {
+    size_type cap = 2;
+    while (cap < capacity) cap <<= 1;
+    mask_ = cap - 1;
+    cells_.reset(new Cell[cap]);
+    for (size_type i = 0; i < cap; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~MpmcRingQueue() {
+    T tmp;
+    while (TryPop(tmp)) {
+    }
+  }
+
+  /**
+   * @brief Try to push an element constructed in-place
+   *
+   * @retval true Succeed
+   * @retval false Fail, queue is full
+   */
+  template <typename... Arguments>
+  bool TryEmplace(Arguments&&... args) {
+    Cell* cell;
+    size_type pos = enqueue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_type seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    new (&cell->storage) T(std::forward<Arguments>(args)...);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    not_empty_.Notify();
+    return true;
+  }
+
+  /**
+   * @brief Try to push an element
+   *
+   * @retval true Succeed
+   * @retval false Fail, queue is full
+   */
+  bool TryPush(const T& new_value) { return TryEmplace(new_value); }
+  bool TryPush(T&& new_value) { return TryEmplace(std::move(new_value)); }
+
+  /**
+   * @brief Pushes a new element constructed in-place, block while queue is full
+   */
+  template <typename... Arguments>
+  void Emplace(Arguments&&... args) {
+    // construct once to avoid forwarding args multiple times
+    T value(std::forward<Arguments>(args)...);
+    detail::WaitUntil(&not_full_, [this, &value]() { return TryEmplace(std::move(value)); });
+  }
+
+  /**
+   * @brief Pushes the given element value to the end of the queue, block while queue is full
+   */
+  void Push(const T& new_value) {
+    detail::WaitUntil(&not_full_, [this, &new_value]() { return TryEmplace(new_value); });
+  }
+  void Push(T&& new_value) {
+    detail::WaitUntil(&not_full_, [this, &new_value]() { return TryEmplace(std::move(new_value)); });
+  }
+
+  /**
+   * @brief Try to pop an element from queue
+   *
+   * @param value An element
+   * @retval true Succeed
+   * @retval false Fail, no element stored in queue
+   */
+  bool TryPop(T& value) {  // NOLINT
+    Cell* cell;
+    size_type pos = dequeue_pos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_type seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    T* elem = reinterpret_cast<T*>(&cell->storage);
+    value = std::move(*elem);
+    elem->~T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    not_full_.Notify();
+    return true;
+  }
+
+  /**
+   * @brief Try to pop an element from queue, wait for `rel_time` if queue is empty
+   *
+   * @param value An element
+   * @param rel_time Maximum duration to block for
+   * @retval true Succeed
+   * @retval false Timeout
+   */
+  bool WaitAndTryPop(T& value, const std::chrono::microseconds rel_time) {  // NOLINT
+    return detail::WaitFor(&not_empty_, [this, &value]() { return TryPop(value); }, rel_time);
+  }
+
+  /**
+   * @brief Checks if the queue has no elements, the result may be outdated under contention
+   */
+  bool Empty() const noexcept { return Size() == 0; }
+
+  /**
+   * @brief Returns the number of elements, the result may be outdated under contention
+   */
+  size_type Size() const noexcept {
+    size_type deq = dequeue_pos_.load(std::memory_order_relaxed);
+    size_type enq = enqueue_pos_.load(std::memory_order_relaxed);
+    return enq > deq ? enq - deq : 0;
+  }
+
+  /**
+   * @brief Returns the maximum number of elements
+   */
+  size_type Capacity() const noexcept { return mask_ + 1; }
+
+ private:
+  MpmcRingQueue(const MpmcRingQueue&) = delete;
+  MpmcRingQueue& operator=(const MpmcRingQueue&) = delete;
+
+  struct Cell {
+    std::atomic<size_type> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+  static constexpr size_t kCacheLine = 64;
+
+  std::unique_ptr<Cell[]> cells_;
+  size_type mask_;
+  // keep producer and consumer positions on different cache lines
+  char pad0_[kCacheLine];
+  std::atomic<size_type> enqueue_pos_{0};
+  char pad1_[kCacheLine - sizeof(std::atomic<size_type>)];
+  std::atomic<size_type> dequeue_pos_{0};
+  char pad2_[kCacheLine - sizeof(std::atomic<size_type>)];
+  detail::EventCount not_empty_;
+  detail::EventCount not_full_;
+};  // class MpmcRingQueue
+
+/**
+ * @brief Lock-free multi-band priority queue
+ *
+ * Elements are put into bands by `BandOf`, elements in higher band are popped first, and elements in the same band are
+ * popped in FIFO order. Each band is a MpmcRingQueue, a bitmap marks bands which are not empty. Once a band is full,
+ * the band spills over to a locked deque until it drains, so Push never blocks.
+ *
+ * @tparam T Type of stored elements, should be default constructible and move assignable
+ * @tparam BandOf Function object maps an element to its band, result must be less than BandNum
+ * @tparam BandNum Number of bands, no more than 128
+ */
+template <typename T, typename BandOf, size_t BandNum = 128>
+class PriorityBandQueue {
+  static_assert(BandNum > 0 && BandNum <= 128, "PriorityBandQueue supports 1 ~ 128 bands");
+
+ public:
+  /// type of elements
+  using value_type = T;
+  /// type of size
+  using size_type = size_t;
+
+  /**
+   * @brief Construct a new Priority Band Queue object
+   *
+   * @param band_capacity Capacity of lock-free ring of each band
+   */
+  explicit PriorityBandQueue(size_type band_capacity = 256) {
+    bands_.reserve(BandNum);
+    for (size_t i = 0; i < BandNum; ++i) {
+      bands_.emplace_back(new Band(band_capacity));
+    }
+  }
+
+  /**
+   * @brief Pushes the given element value to its band
+   */
+  void Push(const T& new_value) { PushImpl(T(new_value)); }
+  void Push(T&& new_value) { PushImpl(std::move(new_value)); }
+
+  /**
+   * @brief Pushes a new element to its band. The element is constructed in-place.
+   */
+  template <typename... Arguments>
+  void Emplace(Arguments&&... args) {
+    PushImpl(T(std::forward<Arguments>(args)...));
+  }
+
+  /**
+   * @brief Try to pop an element from the highest band which is not empty
+   *
+   * @param value An element
+   * @retval true Succeed
+   * @retval false Fail, no element stored in queue
+   */
+  bool TryPop(T& value) {  // NOLINT
+    for (int w = kWordNum - 1; w >= 0; --w) {
+      uint64_t bits = masks_[w].load();
+      while (bits) {
+        int bit = 63 - __builtin_clzll(bits);
+        if (PopBand(w * 64 + bit, &value)) return true;
+        bits &= ~(uint64_t(1) << bit);
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Try to pop an element from queue, wait for `rel_time` if queue is empty
+   *
+   * @param value An element
+   * @param rel_time Maximum duration to block for
+   * @retval true Succeed
+   * @retval false Timeout
+   */
+  bool WaitAndTryPop(T& value, const std::chrono::microseconds rel_time) {  // NOLINT
+    return detail::WaitFor(&not_empty_, [this, &value]() { return TryPop(value); }, rel_time);
+  }
+
+  /**
+   * @brief Checks if the queue has no elements, the result may be outdated under contention
+   */
+  bool Empty() const noexcept {
+    for (size_t w = 0; w < kWordNum; ++w) {
+      if (masks_[w].load()) return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Returns the number of elements, the result may be outdated under contention
+   */
+  size_type Size() const noexcept {
+    int64_t total = 0;
+    for (auto& band : bands_) total += band->count.load(std::memory_order_relaxed);
+    return total > 0 ? total : 0;
+  }
+
+ private:
+  PriorityBandQueue(const PriorityBandQueue&) = delete;
+  PriorityBandQueue& operator=(const PriorityBandQueue&) = delete;
+
+  struct Band {
+    explicit Band(size_type capacity) : ring(capacity) {}
+    MpmcRingQueue<T> ring;
+    std::atomic<int64_t> count{0};
+    // used only while ring is full
+    std::mutex overflow_mutex;
+    std::deque<T> overflow;
+    std::atomic<size_type> overflow_size{0};
+  };
+
+  void PushImpl(T&& value) {
+    size_t idx = BandOf()(value);
+    if (idx >= BandNum) idx = BandNum - 1;
+    Band& band = *bands_[idx];
+    // keep FIFO order, stay on overflow until it drains
+    if (band.overflow_size.load() || !band.ring.TryPush(std::move(value))) {
+      std::lock_guard<std::mutex> lk(band.overflow_mutex);
+      band.overflow.emplace_back(std::move(value));
+      band.overflow_size.fetch_add(1);
+    }
+    band.count.fetch_add(1);
+    uint64_t bit = uint64_t(1) << (idx % 64);
+    std::atomic<uint64_t>& mask = masks_[idx / 64];
+    if (!(mask.load() & bit)) mask.fetch_or(bit);
+    not_empty_.Notify();
+  }
+
+  bool PopBand(size_t idx, T* value) {
+    Band& band = *bands_[idx];
+    if (!band.ring.TryPop(*value)) {
+      if (!band.overflow_size.load()) return false;
+      std::lock_guard<std::mutex> lk(band.overflow_mutex);
+      if (band.overflow.empty()) return false;
+      *value = std::move(band.overflow.front());
+      band.overflow.pop_front();
+      band.overflow_size.fetch_sub(1);
+    }
+    if (band.count.fetch_sub(1) == 1) {
+      // band may be empty, clear the bit and set it back if someone pushed in the meantime
+      uint64_t bit = uint64_t(1) << (idx % 64);
+      std::atomic<uint64_t>& mask = masks_[idx / 64];
+      mask.fetch_and(~bit);
+      if (band.count.load() > 0) mask.fetch_or(bit);
+    }
+    return true;
+  }
+
+  static constexpr size_t kWordNum = (BandNum + 63) / 64;
+  std::vector<std::unique_ptr<Band>> bands_;
+  std::atomic<uint64_t> masks_[kWordNum] = {};
+  detail::EventCount not_empty_;
+};  // class PriorityBandQueue
+
 /**
  * @brief Alias of ThreadSafeQueue<T, std::queue<T>>
  *
@@ -30,6 +30,8 @@
 #include <thread>
 #include <utility>
 
+#include "cnedk_stream_timing.hpp"
+
 namespace infer_server {
 
 namespace detail {
@@ -40,6 +42,8 @@ using Duration = std::chrono::duration<uint32_t, std::milli>;
 
 struct TimeEvent {
   TimePoint alarm_time;
+  // alarm time on virtual clock, in microseconds
+  int64_t alarm_us;
   Timer::Notifier notifier;
   Duration d;
   bool loop;
@@ -50,6 +54,10 @@ struct EventCompare {
   bool operator()(const TimeEvent* lhs, const TimeEvent* rhs) { return lhs->alarm_time < rhs->alarm_time; }
 };
 
+struct VirtualEventCompare {
+  bool operator()(const TimeEvent* lhs, const TimeEvent* rhs) { return lhs->alarm_us < rhs->alarm_us; }
+};
+
 class TimeCounter {
  public:
   static inline TimeCounter* Instance() {
@@ -68,7 +76,9 @@ class TimeCounter {
       TimeEvent* e = *events_.begin();
       if (Clock::now() < e->alarm_time) {
         VLOG(5) << "[EasyDK InferServer] [TimeCounter] Wait for next time event";
-        cond_.wait_until(lk, e->alarm_time);
+        // wait on a copy, the event may be removed while waiting
+        const TimePoint alarm_time = e->alarm_time;
+        cond_.wait_until(lk, alarm_time);
         continue;
       }
 
@@ -95,16 +105,54 @@ class TimeCounter {
     }
   }
 
+  // fire events due on virtual clock, in the thread moving the clock
+  void FireVirtual(cnedk::VirtualClock* vclock, int64_t now_us) {
+    std::unique_lock<std::mutex> lk(mutex_);
+    // events have been moved away from the replaced clock
+    if (vclock != vclock_) return;
+    while (!virtual_events_.empty()) {
+      TimeEvent* e = *virtual_events_.begin();
+      if (e->alarm_us > now_us) break;
+      virtual_events_.erase(virtual_events_.begin());
+      if (e->loop) {
+        // a loop event of zero interval fires once per move of the clock
+        e->alarm_us = e->d.count() ? e->alarm_us + static_cast<int64_t>(e->d.count()) * 1000 : now_us + 1;
+        virtual_events_.insert(e);
+        e->notifying.store(true);
+        lk.unlock();
+        e->notifier();
+        e->notifying.store(false);
+      } else {
+        e->notifying.store(true);
+        lk.unlock();
+        e->notifier();
+        e->notifying.store(false);
+        delete e;
+      }
+      lk.lock();
+    }
+  }
+
   int64_t Add(uint32_t t_ms, Timer::Notifier&& notifier, bool loop) {
     VLOG(4) << "[EasyDK InferServer] [TimeCounter] Add time event, timeout: " << t_ms;
     Duration d(t_ms);
     std::unique_lock<std::mutex> lk(mutex_);
+    // time events follow the virtual clock set as default, to run deterministically.
+    // read under lock, so that events are not left on a clock being replaced
+    auto vclock = dynamic_cast<cnedk::VirtualClock*>(cnedk::Clock::Default());
     auto te = new TimeEvent;
     te->alarm_time = Clock::now() + d;
+    te->alarm_us = vclock ? vclock->NowUs() + static_cast<int64_t>(t_ms) * 1000 : 0;
     te->notifier = std::forward<Timer::Notifier>(notifier);
     te->d = std::move(d);
     te->loop = loop;
     te->notifying.store(false);
+    if (vclock) {
+      virtual_events_.insert(te);
+      vclock_ = vclock;
+      vclock->SetListener(this, [this, vclock](int64_t now_us) { FireVirtual(vclock, now_us); });
+      return reinterpret_cast<int64_t>(te);
+    }
     events_.insert(te);
     lk.unlock();
     cond_.notify_one();
@@ -113,8 +161,8 @@ class TimeCounter {
 
   void Remove(int64_t handle) {
     std::unique_lock<std::mutex> lk(mutex_);
-    auto e = std::find_if(events_.begin(), events_.end(),
-                          [handle](const TimeEvent* t) { return reinterpret_cast<int64_t>(t) == handle; });
+    auto is_handle = [handle](const TimeEvent* t) { return reinterpret_cast<int64_t>(t) == handle; };
+    auto e = std::find_if(events_.begin(), events_.end(), is_handle);
     if (e != events_.end()) {
       VLOG(4) << "[EasyDK InferServer] [TimeCounter] Remove time event";
       // wait until event is not in notifying
@@ -123,11 +171,39 @@ class TimeCounter {
       delete *e;
       events_.erase(e);
     }
+    auto ve = std::find_if(virtual_events_.begin(), virtual_events_.end(), is_handle);
+    if (ve != virtual_events_.end()) {
+      VLOG(4) << "[EasyDK InferServer] [TimeCounter] Remove virtual time event";
+      while ((*ve)->notifying.load()) {
+      }
+      delete *ve;
+      virtual_events_.erase(ve);
+    }
+    lk.unlock();
+    cond_.notify_one();
+  }
+
+  // events on the replaced virtual clock are moved to wall clock with the time left, and fired by the loop thread
+  void OnDefaultClockReplaced() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (!vclock_ || vclock_ == cnedk::Clock::Default()) return;
+    vclock_->SetListener(this, nullptr);
+    const int64_t now_us = vclock_->NowUs();
+    const TimePoint now = Clock::now();
+    for (auto& e : virtual_events_) {
+      e->alarm_time = now + std::chrono::microseconds(std::max<int64_t>(e->alarm_us - now_us, 0));
+      events_.insert(e);
+    }
+    VLOG(4) << "[EasyDK InferServer] [TimeCounter] Move " << virtual_events_.size()
+            << " virtual time events to wall clock";
+    virtual_events_.clear();
+    vclock_ = nullptr;
     lk.unlock();
     cond_.notify_one();
   }
 
   ~TimeCounter() {
+    cnedk::Clock::SetDefaultListener(this, nullptr);
     running_.store(false);
     cond_.notify_one();
     if (th_.joinable()) th_.join();
@@ -136,14 +212,23 @@ class TimeCounter {
       delete e;
     }
     events_.clear();
+    for (auto& e : virtual_events_) {
+      delete e;
+    }
+    virtual_events_.clear();
   }
 
  private:
   TimeCounter() {
     running_.store(true);
     th_ = std::thread(&TimeCounter::Loop, this);
+    cnedk::Clock::SetDefaultListener(this, [this]() { OnDefaultClockReplaced(); });
   }
   std::multiset<TimeEvent*, EventCompare> events_;
+  // events on virtual clock are fired by the thread moving the clock, instead of the loop thread
+  std::multiset<TimeEvent*, VirtualEventCompare> virtual_events_;
+  // the virtual clock followed by virtual events
+  cnedk::VirtualClock* vclock_ = nullptr;
   std::mutex mutex_;
   std::condition_variable cond_;
   std::thread th_;
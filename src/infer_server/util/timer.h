@@ -32,6 +32,9 @@ namespace infer_server {
  * @brief A timer
  *
  * @note An instance only holds one task at a time.
+ * @note If default clock is a cnedk::VirtualClock when a task is started, the task is notified by the thread moving the
+ *       virtual clock once it is due, instead of by wall clock. Pending tasks are moved to wall clock with the time
+ *       left once the virtual clock is no longer the default.
  */
 class Timer {
  public:
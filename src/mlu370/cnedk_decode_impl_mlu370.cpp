@@ -98,6 +98,7 @@ int DecoderMlu370::Create(CnedkVdecCreateParams *params) {
   create_info_.user_context = this;
 
   ResetFlags();
+  format_tracker_.Reset();
 
   int codec_ret = cncodecDecCreate(&instance_, &DecoderEventCallback, &create_info_);
   if (CNCODEC_SUCCESS != codec_ret) {
@@ -235,6 +236,12 @@ void DecoderMlu370::OnFrame(cncodecFrame_t *codec_frame) {
   codec_frame->width += codec_frame->width & 1;
   codec_frame->height -= codec_frame->height & 1;
 
+  if (format_tracker_.Update(create_params_, codec_frame->width, codec_frame->height,
+                             GetSurfFmt(codec_frame->pixel_format)) < 0) {
+    OnError(-1);
+    return;
+  }
+
   CnedkBufSurface *surf = nullptr;
   if (create_params_.GetBufSurf(&surf, codec_frame->width, codec_frame->height, GetSurfFmt(codec_frame->pixel_format),
                                 create_params_.surf_timeout_ms, create_params_.userdata) < 0) {
@@ -316,6 +323,7 @@ void DecoderMlu370::OnFrame(cncodecFrame_t *codec_frame) {
   }
 
   surf->pts = codec_frame->pts;
+  format_tracker_.Stamp(surf);
 
   create_params_.OnFrame(surf, create_params_.userdata);
 }
@@ -335,20 +343,28 @@ void DecoderMlu370::ReceiveSequence(cncodecDecSequenceInfo_t *seq_info) {
   receive_seq_time_++;
 
   if (1 < receive_seq_time_) {
-    // variable geometry stream. check output buffer number, width, height and reset codec params
+    // variable geometry stream. Frames of the previous sequence have been output, reallocate the output buffers if
+    // the preset parameters do not meet requirements
     if (codec_params_.output_buf_num < seq_info->min_output_buf_num + 1 ||
         codec_params_.max_width < seq_info->coded_width || codec_params_.max_height < seq_info->coded_height) {
-      LOG(ERROR) << "[EasyDK] [DecoderMlu370] ReceiveSequence(): "
-                 << "Variable video resolutions, the preset parameters do not meet requirements."
-                 << "max width[" << codec_params_.max_width << "], "
-                 << "max height[" << codec_params_.max_height << "], "
-                 << "output buffer number[" << codec_params_.output_buf_num << "]. "
-                 << "But required: "
-                 << "coded width[" << seq_info->coded_width << "], "
-                 << "coded height[" << seq_info->coded_height << "], "
-                 << "min output buffer number[" << seq_info->min_output_buf_num << "].";
-      error_flag_ = true;
-      OnError(-1);
+      LOG(INFO) << "[EasyDK] [DecoderMlu370] ReceiveSequence(): "
+                << "Variable video resolutions, the preset parameters do not meet requirements, reallocate buffers. "
+                << "max width[" << codec_params_.max_width << "], "
+                << "max height[" << codec_params_.max_height << "], "
+                << "output buffer number[" << codec_params_.output_buf_num << "]. "
+                << "But required: "
+                << "coded width[" << seq_info->coded_width << "], "
+                << "coded height[" << seq_info->coded_height << "], "
+                << "min output buffer number[" << seq_info->min_output_buf_num << "].";
+      codec_params_.max_width = std::max<uint32_t>(codec_params_.max_width, seq_info->coded_width);
+      codec_params_.max_height = std::max<uint32_t>(codec_params_.max_height, seq_info->coded_height);
+      codec_params_.output_buf_num =
+          std::max<uint32_t>(codec_params_.output_buf_num, seq_info->min_output_buf_num + 1);
+      if (!SetDecParams()) {
+        LOG(ERROR) << "[EasyDK] [DecoderMlu370] ReceiveSequence(): Reset decoder params failed";
+        error_flag_ = true;
+        OnError(-1);
+      }
     }
   } else {
     if (codec_params_.max_width && codec_params_.max_height) {
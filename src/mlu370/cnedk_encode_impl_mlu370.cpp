@@ -41,6 +41,8 @@
 
 namespace cnedk {
 
+static constexpr size_t kMinBitstreamRingSize = 4 << 20;
+
 static inline int64_t CurrentTick() {
   return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
       .count();
@@ -199,6 +201,14 @@ int EncoderMlu370::Create(CnedkVencCreateParams *params) {
 #endif
   }
 
+  // enough for a few packets at a low compression ratio
+  size_t ring_capacity = std::max<size_t>(static_cast<size_t>(width_) * height_ * 2, kMinBitstreamRingSize);
+  bitstream_ring_ = BitstreamRing::Create(ring_capacity);
+  if (!bitstream_ring_) {
+    LOG(ERROR) << "[EasyDK] [EncoderMlu370] Create(): Create bitstream ring buffer failed";
+    return -1;
+  }
+
   PrintCreateAttr(&cn_param);
 
   i32_t ret = cncodecEncCreate(&instance_, EncoderEventCallback, &cn_param);
@@ -235,6 +245,14 @@ int EncoderMlu370::Destroy() {
 
   instance_ = 0;
 
+  if (head_slice_) {
+    BitstreamRing::Release(head_slice_);
+    head_slice_ = nullptr;
+    memset(&head_pkg_, 0, sizeof(CnedkVEncFrameBits));
+  }
+  // slices retained by user keep the ring alive
+  bitstream_ring_.reset();
+
   if (src_bgr_mlu_) {
     cnrtFree(src_bgr_mlu_);
     src_bgr_mlu_ = nullptr;
@@ -587,31 +605,30 @@ void EncoderMlu370::OnFrameBits(void *_packet) {
       cnFrameBits.pkt_type = CNEDK_VENC_PACKAGE_TYPE_FRAME;
     }
 
-    // std::unique_ptr<uint8_t> packet_data {new (std::nothrow) uint8_t[stream->data_len]};
-    uint8_t *packet_data = nullptr;
-    try {
-      packet_data = new uint8_t[stream->data_len];
-    } catch (std::bad_alloc & exception) {
-      LOG(ERROR) << "[EasyDK] [EncoderMlu370] OnFrameBits(): bad_alloc " << exception.what()
-                 << "; data_len " << stream->data_len;
+    BitstreamSlice *slice = bitstream_ring_->Alloc(stream->data_len);
+    if (!slice) {
+      LOG(ERROR) << "[EasyDK] [EncoderMlu370] OnFrameBits(): Alloc bitstream failed; data_len " << stream->data_len;
       return;
     }
 
-    auto ret = cnrtMemcpy(packet_data, reinterpret_cast<void *>(stream->mem_addr + stream->data_offset),
+    auto ret = cnrtMemcpy(slice->data, reinterpret_cast<void *>(stream->mem_addr + stream->data_offset),
                           stream->data_len, CNRT_MEM_TRANS_DIR_DEV2HOST);
 
     if (ret != cnrtSuccess) {
-      delete[] packet_data;
+      BitstreamRing::Release(slice);
       LOG(ERROR) << "[EasyDK] [EncoderMlu370] OnFrameBits(): Copy bitstream failed, D2H";
       return;
     }
 
-    cnFrameBits.bits = packet_data;
+    cnFrameBits.bits = slice->data;
     cnFrameBits.len = stream->data_len;
     cnFrameBits.pts = stream->pts;
 
     if (first_frame_ && cnFrameBits.pkt_type == CNEDK_VENC_PACKAGE_TYPE_SPS_PPS) {
+      // keep the slice until the first frame comes
+      if (head_slice_) BitstreamRing::Release(head_slice_);
       head_pkg_ = cnFrameBits;
+      head_slice_ = slice;
       return;
     }
 
@@ -621,13 +638,15 @@ void EncoderMlu370::OnFrameBits(void *_packet) {
 
       if (head_pkg_.bits) {
         create_params_.OnFrameBits(&head_pkg_, create_params_.userdata);
-        delete[] head_pkg_.bits;
+        BitstreamRing::Release(head_slice_);
+        head_slice_ = nullptr;
+        memset(&head_pkg_, 0, sizeof(CnedkVEncFrameBits));
       }
     }
 
     create_params_.OnFrameBits(&cnFrameBits, create_params_.userdata);
 
-    delete[] packet_data;
+    BitstreamRing::Release(slice);
   }
 }
 
@@ -33,6 +33,7 @@
 #include "cncodec_v3_enc.h"
 
 #include "../cnedk_encode_impl.hpp"
+#include "../common/bitstream_ring.hpp"
 
 namespace cnedk {
 
@@ -88,7 +89,10 @@ class EncoderMlu370 : public IEncoder {
   std::atomic<bool> yuv_mlu_alloc_{false};
 
   bool first_frame_{true};
-  CnedkVEncFrameBits head_pkg_;
+  CnedkVEncFrameBits head_pkg_{};
+  BitstreamSlice* head_slice_ = nullptr;
+
+  std::shared_ptr<BitstreamRing> bitstream_ring_ = nullptr;
 };
 
 }  // namespace cnedk
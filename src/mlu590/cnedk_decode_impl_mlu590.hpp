@@ -30,6 +30,7 @@
 #include "cncodec_v3_dec.h"
 
 #include "../cnedk_decode_impl.hpp"
+#include "../common/vdec_format_tracker.hpp"
 
 namespace cnedk {
 
@@ -78,6 +79,7 @@ class DecoderMlu590 : public IDecoder {
   cncodecDecParams_t codec_params_;
   cncodecHandle_t instance_ = 0;
   int receive_seq_time_ = 0;
+  VdecFormatTracker format_tracker_;
   void *vdec_ = nullptr;
 };
 
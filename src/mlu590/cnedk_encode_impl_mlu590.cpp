@@ -41,6 +41,8 @@
 
 namespace cnedk {
 
+static constexpr size_t kMinBitstreamRingSize = 4 << 20;
+
 static inline int64_t CurrentTick() {
   return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
       .count();
@@ -147,6 +149,14 @@ int EncoderMlu590::Create(CnedkVencCreateParams *params) {
   cn_param.stream_buf_size = 0;
   cn_param.user_context = reinterpret_cast<void *>(this);
 
+  // enough for a few packets at a low compression ratio
+  size_t ring_capacity = std::max<size_t>(static_cast<size_t>(width_) * height_ * 2, kMinBitstreamRingSize);
+  bitstream_ring_ = BitstreamRing::Create(ring_capacity);
+  if (!bitstream_ring_) {
+    LOG(ERROR) << "[EasyDK] [EncoderMlu590] Create(): Create bitstream ring buffer failed";
+    return -1;
+  }
+
   PrintCreateAttr(&cn_param);
 
   i32_t ret = cncodecEncCreate(&instance_, EncoderEventCallback, &cn_param);
@@ -182,6 +192,8 @@ int EncoderMlu590::Destroy() {
   }
 
   instance_ = 0;
+  // slices retained by user keep the ring alive
+  bitstream_ring_.reset();
 
   if (src_bgr_mlu_) {
     cnrtFree(src_bgr_mlu_);
@@ -522,32 +534,28 @@ void EncoderMlu590::OnFrameBits(void *_packet) {
 
     cnFrameBits.pkt_type = CNEDK_VENC_PACKAGE_TYPE_KEY_FRAME;
 
-    // std::unique_ptr<uint8_t> packet_data {new (std::nothrow) uint8_t[stream->data_len]};
-    uint8_t *packet_data = nullptr;
-    try {
-      packet_data = new uint8_t[stream->data_len];
-    } catch (std::bad_alloc & exception) {
-      LOG(ERROR) << "[EasyDK] [EncoderMlu590] OnFrameBits(): bad_alloc " << exception.what()
-                 << "; data_len " << stream->data_len;
+    BitstreamSlice *slice = bitstream_ring_->Alloc(stream->data_len);
+    if (!slice) {
+      LOG(ERROR) << "[EasyDK] [EncoderMlu590] OnFrameBits(): Alloc bitstream failed; data_len " << stream->data_len;
       return;
     }
 
-    auto ret = cnrtMemcpy(packet_data, reinterpret_cast<void *>(stream->mem_addr + stream->data_offset),
+    auto ret = cnrtMemcpy(slice->data, reinterpret_cast<void *>(stream->mem_addr + stream->data_offset),
                           stream->data_len, CNRT_MEM_TRANS_DIR_DEV2HOST);
 
     if (ret != cnrtSuccess) {
-      delete[] packet_data;
+      BitstreamRing::Release(slice);
       LOG(ERROR) << "[EasyDK] [EncoderMlu590] OnFrameBits(): Copy bitstream failed, D2H";
       return;
     }
 
-    cnFrameBits.bits = packet_data;
+    cnFrameBits.bits = slice->data;
     cnFrameBits.len = stream->data_len;
     cnFrameBits.pts = stream->pts;
 
     create_params_.OnFrameBits(&cnFrameBits, create_params_.userdata);
 
-    delete[] packet_data;
+    BitstreamRing::Release(slice);
   }
 }
 
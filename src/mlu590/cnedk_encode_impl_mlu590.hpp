@@ -33,6 +33,7 @@
 #include "cncodec_v3_enc.h"
 
 #include "../cnedk_encode_impl.hpp"
+#include "../common/bitstream_ring.hpp"
 
 namespace cnedk {
 
@@ -87,6 +88,8 @@ class EncoderMlu590 : public IEncoder {
 
   std::atomic<bool> bgr_mlu_alloc_{false};
   std::atomic<bool> yuv_mlu_alloc_{false};
+
+  std::shared_ptr<BitstreamRing> bitstream_ring_ = nullptr;
 };
 
 }  // namespace cnedk
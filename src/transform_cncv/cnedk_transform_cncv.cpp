@@ -22,7 +22,6 @@
 
 #include <atomic>
 #include <cstring>
-#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -30,32 +29,10 @@
 #include "glog/logging.h"
 #include "cncv.h"
 #include "../common/utils.hpp"
+#include "../cnedk_buf_surface_utils.h"
 
 namespace cnedk {
 
-static CnedkBufSurfaceColorFormat GetColorFormatFromTensor(CnedkTransformColorFormat format) {
-  static std::map<CnedkTransformColorFormat, CnedkBufSurfaceColorFormat> color_map{
-      {CNEDK_TRANSFORM_COLOR_FORMAT_BGR, CNEDK_BUF_COLOR_FORMAT_BGR},
-      {CNEDK_TRANSFORM_COLOR_FORMAT_RGB, CNEDK_BUF_COLOR_FORMAT_RGB},
-      {CNEDK_TRANSFORM_COLOR_FORMAT_BGRA, CNEDK_BUF_COLOR_FORMAT_BGRA},
-      {CNEDK_TRANSFORM_COLOR_FORMAT_RGBA, CNEDK_BUF_COLOR_FORMAT_RGBA},
-      {CNEDK_TRANSFORM_COLOR_FORMAT_ABGR, CNEDK_BUF_COLOR_FORMAT_ABGR},
-      {CNEDK_TRANSFORM_COLOR_FORMAT_ARGB, CNEDK_BUF_COLOR_FORMAT_ARGB},
-  };
-  if (color_map.find(format) != color_map.end()) return color_map[format];
-  return CNEDK_BUF_COLOR_FORMAT_LAST;
-}
-
-static int GetChannelNumFromColor(const CnedkBufSurfaceColorFormat &corlor_format) {
-  if (corlor_format == CNEDK_BUF_COLOR_FORMAT_RGB || corlor_format == CNEDK_BUF_COLOR_FORMAT_BGR) {
-    return 3;
-  } else if (corlor_format == CNEDK_BUF_COLOR_FORMAT_BGRA || corlor_format == CNEDK_BUF_COLOR_FORMAT_RGBA ||
-             corlor_format == CNEDK_BUF_COLOR_FORMAT_ABGR || corlor_format == CNEDK_BUF_COLOR_FORMAT_ARGB) {
-    return 4;
-  }
-  return -1;
-}
-
 int YuvResizeCncvCtx::Process(const CnedkBufSurface &src, CnedkBufSurface *dst,
                                CnedkTransformParams *transform_params) {
   size_t batch_size = src.batch_size;
@@ -341,7 +318,7 @@ int MeanStdCncvCtx::Process(const CnedkBufSurface &src, CnedkBufSurface *dst, Cn
     return -1;
   }
 
-  int channel_num = GetChannelNumFromColor(src.surface_list[0].color_format);
+  int channel_num = GetRgbxChannelNum(src.surface_list[0].color_format);
   if (channel_num < 0) {
     LOG(ERROR) << "[EasyDK] [MeanStdCncvCtx] Process(): Unsupported color format";
     return -1;
@@ -442,7 +419,7 @@ int Yuv2RgbxResizeWithMeanStdCncv::Process(const CnedkBufSurface &src, CnedkBufS
 
   CnedkBufSurfaceColorFormat color_format = GetColorFormatFromTensor(transform_params->dst_desc->color_format);
 
-  int channel_num = GetChannelNumFromColor(color_format);
+  int channel_num = GetRgbxChannelNum(color_format);
   if (channel_num < 0) {
     LOG(ERROR) << "[EasyDK] [Yuv2RgbxResizeWithMeanStdCncv] Process(): Unsupported color format";
     return -1;
@@ -454,6 +431,8 @@ int Yuv2RgbxResizeWithMeanStdCncv::Process(const CnedkBufSurface &src, CnedkBufS
   transform_dst.mem_type = dst->mem_type;
   transform_dst.num_filled = dst->num_filled;
   transform_dst.pts = dst->pts;
+  CnedkBufSurfaceSetGeneration(&transform_dst, CnedkBufSurfaceGetGeneration(dst));
+  CnedkBufSurfaceSetCaptureTime(&transform_dst, CnedkBufSurfaceGetCaptureTime(dst));
 
   size_t data_size = 0;
   for (size_t i = 0; i < dst->batch_size; ++i) {
@@ -502,7 +481,7 @@ int Rgbx2YuvResizeAndConvert::Process(const CnedkBufSurface& src,
     return -1;
   }
 
-  int channel_num = GetChannelNumFromColor(src.surface_list[0].color_format);
+  int channel_num = GetRgbxChannelNum(src.surface_list[0].color_format);
   if (channel_num < 0) {
     LOG(ERROR) << "[EasyDK] [Rgbx2YuvResizeAndConvert] Process(): Unsupported color format";
     return -1;
@@ -570,6 +549,8 @@ int GetBufSurfaceFromTensor(CnedkBufSurface *src, CnedkBufSurface *dst, CnedkTra
   dst->num_filled = src->num_filled;
   dst->batch_size = src->batch_size;  // tensor_desc->shape.n;
   dst->pts = src->pts;
+  CnedkBufSurfaceSetGeneration(dst, CnedkBufSurfaceGetGeneration(src));
+  CnedkBufSurfaceSetCaptureTime(dst, CnedkBufSurfaceGetCaptureTime(src));
   dst->device_id = src->device_id;
   dst->mem_type = src->mem_type;
 
@@ -585,22 +566,6 @@ int GetBufSurfaceFromTensor(CnedkBufSurface *src, CnedkBufSurface *dst, CnedkTra
   return 0;
 }
 
-bool IsYuv420sp(CnedkBufSurfaceColorFormat fmt) {
-  if (fmt == CNEDK_BUF_COLOR_FORMAT_NV12 || fmt == CNEDK_BUF_COLOR_FORMAT_NV21) {
-    return true;
-  }
-  return false;
-}
-
-bool IsRgbx(CnedkBufSurfaceColorFormat fmt) {
-  if (fmt == CNEDK_BUF_COLOR_FORMAT_RGB || fmt == CNEDK_BUF_COLOR_FORMAT_BGR ||
-      fmt == CNEDK_BUF_COLOR_FORMAT_RGBA || fmt == CNEDK_BUF_COLOR_FORMAT_BGRA ||
-      fmt == CNEDK_BUF_COLOR_FORMAT_ABGR || fmt == CNEDK_BUF_COLOR_FORMAT_ARGB) {
-    return true;
-  }
-  return false;
-}
-
 int DoCncvTransform(CnedkBufSurface *src, CnedkBufSurface *dst, CnedkTransformParams *transform_params) {
   if (src->surface_list[0].color_format == CNEDK_BUF_COLOR_FORMAT_TENSOR) {
     LOG(ERROR) << "[EasyDK] DoCncvTransform(): The type of src is not supported as tensor";
@@ -21,7 +21,6 @@
 #ifndef CNEDK_TRANSFORM_CNCV_HPP_
 #define CNEDK_TRANSFORM_CNCV_HPP_
 
-#include <map>
 #include <memory>
 #include <vector>
 
@@ -63,14 +62,14 @@ class CncvContext {
   }
 
   static cncvPixelFormat GetPixFormat(CnedkBufSurfaceColorFormat format) {
-    static std::map<CnedkBufSurfaceColorFormat, cncvPixelFormat> color_map{
-        {CNEDK_BUF_COLOR_FORMAT_YUV420, CNCV_PIX_FMT_I420}, {CNEDK_BUF_COLOR_FORMAT_NV12, CNCV_PIX_FMT_NV12},
-        {CNEDK_BUF_COLOR_FORMAT_NV21, CNCV_PIX_FMT_NV21},   {CNEDK_BUF_COLOR_FORMAT_BGR, CNCV_PIX_FMT_BGR},
-        {CNEDK_BUF_COLOR_FORMAT_RGB, CNCV_PIX_FMT_RGB},     {CNEDK_BUF_COLOR_FORMAT_BGRA, CNCV_PIX_FMT_BGRA},
-        {CNEDK_BUF_COLOR_FORMAT_RGBA, CNCV_PIX_FMT_RGBA},   {CNEDK_BUF_COLOR_FORMAT_ABGR, CNCV_PIX_FMT_ABGR},
-        {CNEDK_BUF_COLOR_FORMAT_ARGB, CNCV_PIX_FMT_ARGB},
+    // indexed by CnedkBufSurfaceColorFormat
+    static constexpr cncvPixelFormat kPixFormats[CNEDK_BUF_COLOR_FORMAT_LAST] = {
+        cncvPixelFormat(), cncvPixelFormat(), CNCV_PIX_FMT_I420, CNCV_PIX_FMT_NV12, CNCV_PIX_FMT_NV21,
+        CNCV_PIX_FMT_ARGB, CNCV_PIX_FMT_ABGR, CNCV_PIX_FMT_RGB,  CNCV_PIX_FMT_BGR,  CNCV_PIX_FMT_BGRA,
+        CNCV_PIX_FMT_RGBA, cncvPixelFormat(), cncvPixelFormat(),
     };
-    return color_map[format];
+    return (static_cast<int>(format) >= 0 && format < CNEDK_BUF_COLOR_FORMAT_LAST) ? kPixFormats[format]
+                                                                                   : cncvPixelFormat();
   }
 
  protected:
@@ -0,0 +1,161 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cnedk_stream_timing.hpp"
+#include "core/cache.h"
+#include "core/request_ctrl.h"
+
+namespace infer_server {
+namespace {
+
+constexpr uint32_t kBatchSize = 4;
+constexpr uint32_t kBatchTimeout = 10;
+constexpr int kRequestNum = 32;
+
+// Sends a synthetic workload on virtual clock, returns result of each request, which depends on the batch.
+// Sizes of requests are decided by data_seed, arrival time by time_seed.
+std::map<int64_t, std::string> RunWorkload(uint32_t data_seed, uint32_t time_seed,
+                                           std::shared_ptr<BatchTrace> trace) {
+  cnedk::VirtualClock clock;
+  cnedk::Clock::SetDefault(&clock);
+  std::mt19937 data_gen(data_seed);
+  std::mt19937 time_gen(time_seed);
+  std::vector<std::unique_ptr<RequestControl>> ctrls;
+  CacheDynamic cache(kBatchSize, Priority(0), kBatchTimeout);
+  cache.SetBatchTrace(std::move(trace));
+  cache.Start();
+  for (int64_t request_id = 0; request_id < kRequestNum; ++request_id) {
+    uint32_t data_num = data_gen() % 5 + 1;
+    ctrls.emplace_back(new RequestControl([](Status, PackagePtr) {}, [](const RequestControl*) {}, "", request_id,
+                                          data_num));
+    auto pack = std::make_shared<Package>();
+    for (uint32_t idx = 0; idx < data_num; ++idx) {
+      auto data = std::make_shared<InferData>();
+      data->Set(static_cast<int>(request_id * 10 + idx));
+      data->ctrl = ctrls.back().get();
+      data->index = idx;
+      pack->data.emplace_back(std::move(data));
+    }
+    EXPECT_TRUE(cache.Push(std::move(pack)));
+    // batch timeout is notified by the thread moving the clock, i.e. this thread
+    clock.AdvanceUs(time_gen() % (2 * kBatchTimeout * 1000));
+  }
+  cache.Stop();
+
+  std::map<int64_t, std::string> results;
+  int batch_idx = 0;
+  while (PackagePtr pack = cache.Pop()) {
+    EXPECT_LE(pack->data.size(), kBatchSize);
+    // output of a batch sensitive model, e.g. normalized by the batch
+    int sum = 0;
+    for (auto& it : pack->data) sum += it->GetLref<int>();
+    for (size_t pos = 0; pos < pack->data.size(); ++pos) {
+      const InferDataPtr& it = pack->data[pos];
+      std::ostringstream ss;
+      ss << "[" << it->index << "] batch " << batch_idx << " pos " << pos << " value " << it->GetLref<int>() << "/"
+         << sum << "; ";
+      results[it->ctrl->RequestId()] += ss.str();
+    }
+    ++batch_idx;
+  }
+  cnedk::Clock::SetDefault(nullptr);
+  return results;
+}
+
+TEST(InferServerCore, BatchTraceDeterministic) {
+  auto trace1 = std::make_shared<BatchTrace>();
+  auto trace2 = std::make_shared<BatchTrace>();
+  auto results1 = RunWorkload(1, 1, trace1);
+  auto results2 = RunWorkload(1, 1, trace2);
+  ASSERT_EQ(static_cast<size_t>(kRequestNum), results1.size());
+  EXPECT_EQ(results1, results2);
+  EXPECT_FALSE(trace1->Serialize().empty());
+  EXPECT_EQ(trace1->Serialize(), trace2->Serialize());
+
+  // batches are cut by timeout as well as by size
+  auto batches = trace1->GetBatches();
+  bool has_partial = false;
+  size_t data_num = 0;
+  for (auto& batch : batches) {
+    has_partial |= batch.size() < kBatchSize;
+    data_num += batch.size();
+  }
+  EXPECT_TRUE(has_partial);
+  EXPECT_GT(data_num, batches.size());
+}
+
+TEST(InferServerCore, BatchTraceReplay) {
+  auto record = std::make_shared<BatchTrace>();
+  auto recorded = RunWorkload(2, 1, record);
+  std::string text = record->Serialize();
+
+  std::vector<BatchTrace::Batch> batches;
+  ASSERT_TRUE(BatchTrace::Parse(text, &batches));
+  EXPECT_EQ(record->GetBatches(), batches);
+
+  // different arrival time batches differently without trace
+  auto retimed = RunWorkload(2, 2, std::make_shared<BatchTrace>());
+  EXPECT_NE(recorded, retimed);
+
+  // replay reproduces batches regardless of arrival time
+  auto replay = std::make_shared<BatchTrace>(std::move(batches));
+  EXPECT_TRUE(replay->IsReplay());
+  EXPECT_EQ(recorded, RunWorkload(2, 2, replay));
+  EXPECT_EQ(text, replay->Serialize());
+
+  // replay ends at mismatched data, the rest falls back to batch timeout
+  std::vector<BatchTrace::Batch> partial;
+  ASSERT_TRUE(BatchTrace::Parse(text, &partial));
+  partial.resize(2);
+  partial.push_back({{kRequestNum, 0}});
+  auto mismatch = std::make_shared<BatchTrace>(std::move(partial));
+  auto fallback = RunWorkload(2, 2, mismatch);
+  ASSERT_EQ(static_cast<size_t>(kRequestNum), fallback.size());
+  auto fallback_batches = mismatch->GetBatches();
+  auto recorded_batches = record->GetBatches();
+  ASSERT_GE(fallback_batches.size(), 2u);
+  EXPECT_EQ(recorded_batches[0], fallback_batches[0]);
+  EXPECT_EQ(recorded_batches[1], fallback_batches[1]);
+}
+
+TEST(InferServerCore, BatchTraceParse) {
+  std::vector<BatchTrace::Batch> batches;
+  EXPECT_TRUE(BatchTrace::Parse("0:0 0:1\n\n1:0\n", &batches));
+  ASSERT_EQ(2u, batches.size());
+  EXPECT_EQ(BatchTrace::Batch({{0, 0}, {0, 1}}), batches[0]);
+  EXPECT_EQ(BatchTrace::Batch({{1, 0}}), batches[1]);
+  EXPECT_FALSE(BatchTrace::Parse("0:0 1\n", &batches));
+  EXPECT_FALSE(BatchTrace::Parse("0:a\n", &batches));
+  EXPECT_FALSE(BatchTrace::Parse(":1\n", &batches));
+  EXPECT_FALSE(BatchTrace::Parse("0:0", nullptr));
+}
+
+}  // namespace
+}  // namespace infer_server
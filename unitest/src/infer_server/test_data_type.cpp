@@ -21,13 +21,19 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <numeric>
 #include <random>
 #include <vector>
 
 #include "cnis/infer_server.h"
 #include "cnrt.h"
 #include "core/data_type.h"
+#include "core/host_tensor.h"
 #include "half.h"
 
 using infer_server::DataLayout;
@@ -51,6 +57,9 @@ TEST(InferServerCore, CastDataType) {
   TEST_CAST_DATATYPE(FLOAT32);
   TEST_CAST_DATATYPE(INT16);
   TEST_CAST_DATATYPE(INT32);
+  TEST_CAST_DATATYPE(INT8);
+  TEST_CAST_DATATYPE(INT64);
+  TEST_CAST_DATATYPE(BOOL);
 #undef TEST_CAST_DATATYPE
 }
 
@@ -62,33 +71,37 @@ TEST(InferServerCore, DataTypeStr) {
   TEST_DATATYPE_STR(FLOAT32);
   TEST_DATATYPE_STR(INT16);
   TEST_DATATYPE_STR(INT32);
+  TEST_DATATYPE_STR(INT8);
+  TEST_DATATYPE_STR(BF16);
+  TEST_DATATYPE_STR(INT64);
+  TEST_DATATYPE_STR(BOOL);
 #undef TEST_DATATYPE_STR
 }
 
 template <typename dtype>
 void Transpose(dtype* input_data, dtype* output_data, const std::vector<Shape::value_type>& input_shape,
                const std::vector<int>& axis) {
-  int old_index = -1;
-  int new_index = -1;
   const std::vector<Shape::value_type>& s = input_shape;
-
-  if (input_shape.size() != 4 || axis.size() != 4) {
-    LOG(ERROR) << "[EasyDK Tests] [InferServer] Only support 4 dimension";
+  const size_t n = s.size();
+  if (axis.size() != n) {
+    LOG(ERROR) << "[EasyDK Tests] [InferServer] Axis and shape are mismatched";
     std::terminate();
   }
 
-  int dim[4] = {0};
-  for (dim[0] = 0; dim[0] < s[0]; dim[0]++) {
-    for (dim[1] = 0; dim[1] < s[1]; dim[1]++) {
-      for (dim[2] = 0; dim[2] < s[2]; dim[2]++) {
-        for (dim[3] = 0; dim[3] < s[3]; dim[3]++) {
-          old_index = dim[0] * s[1] * s[2] * s[3] + dim[1] * s[2] * s[3] + dim[2] * s[3] + dim[3];
-          new_index = dim[axis[0]] * s[axis[1]] * s[axis[2]] * s[axis[3]] + dim[axis[1]] * s[axis[2]] * s[axis[3]] +
-                      dim[axis[2]] * s[axis[3]] + dim[axis[3]];
-          output_data[new_index] = input_data[old_index];
-        }
-      }
+  size_t count = 1;
+  for (auto v : s) count *= v;
+  std::vector<Shape::value_type> dim(n, 0);
+  for (size_t old_index = 0; old_index < count; ++old_index) {
+    size_t rest = old_index;
+    for (size_t i = n; i > 0; --i) {
+      dim[i - 1] = rest % s[i - 1];
+      rest /= s[i - 1];
     }
+    size_t new_index = 0;
+    for (size_t i = 0; i < n; ++i) {
+      new_index = new_index * s[axis[i]] + dim[axis[i]];
+    }
+    output_data[new_index] = input_data[old_index];
   }
 }
 
@@ -129,12 +142,12 @@ std::uniform_real_distribution<float> data_dis(-128, 128);
 std::uniform_real_distribution<float> u8_data_dis(0, 255);
 const std::vector<int> nhwc2nchw_axis = {0, 3, 1, 2};
 const std::vector<int> nchw2nhwc_axis = {0, 2, 3, 1};
-constexpr DataLayout nchw_u8{DataType::UINT8, DimOrder::NCHW};
-constexpr DataLayout nchw_f32{DataType::FLOAT32, DimOrder::NCHW};
-constexpr DataLayout nchw_f16{DataType::FLOAT16, DimOrder::NCHW};
-constexpr DataLayout nhwc_u8{DataType::UINT8, DimOrder::NHWC};
-constexpr DataLayout nhwc_f32{DataType::FLOAT32, DimOrder::NHWC};
-constexpr DataLayout nhwc_f16{DataType::FLOAT16, DimOrder::NHWC};
+const DataLayout nchw_u8{DataType::UINT8, DimOrder::NCHW};
+const DataLayout nchw_f32{DataType::FLOAT32, DimOrder::NCHW};
+const DataLayout nchw_f16{DataType::FLOAT16, DimOrder::NCHW};
+const DataLayout nhwc_u8{DataType::UINT8, DimOrder::NHWC};
+const DataLayout nhwc_f32{DataType::FLOAT32, DimOrder::NHWC};
+const DataLayout nhwc_f16{DataType::FLOAT16, DimOrder::NHWC};
 
 constexpr size_t repeat_times = 3;
 
@@ -144,4 +157,500 @@ inline Shape GenShape() {
   return s;
 }
 
+using infer_server::CastHostData;
+using infer_server::detail::BFloat16ToFloat;
+using infer_server::detail::FloatToBFloat16;
+using infer_server::detail::FloatToHalf;
+using infer_server::detail::GetTransOrderAxis;
+using infer_server::detail::HalfToFloat;
+using infer_server::detail::HostCastDataType;
+using infer_server::detail::HostCastTranspose;
+using infer_server::detail::HostTranspose;
+using infer_server::detail::TransLayout;
+
+const DataType host_dtypes[] = {DataType::UINT8, DataType::FLOAT16, DataType::FLOAT32, DataType::INT16,
+                                DataType::INT32, DataType::INT8,    DataType::BF16,    DataType::INT64,
+                                DataType::BOOL};
+
+// long double holds INT64 exactly
+template <typename T>
+T SaturateRef(long double v) {
+  if (std::isnan(v)) return 0;
+  v = std::nearbyint(v);
+  if (v <= std::numeric_limits<T>::min()) return std::numeric_limits<T>::min();
+  if (v >= std::numeric_limits<T>::max()) return std::numeric_limits<T>::max();
+  return static_cast<T>(v);
+}
+
+long double LoadRef(const std::vector<uint8_t>& data, DataType dtype, size_t i) {
+  switch (dtype) {
+    case DataType::UINT8:
+      return data[i];
+    case DataType::FLOAT16:
+      return HalfToFloat(reinterpret_cast<const uint16_t*>(data.data())[i]);
+    case DataType::FLOAT32:
+      return reinterpret_cast<const float*>(data.data())[i];
+    case DataType::INT16:
+      return reinterpret_cast<const int16_t*>(data.data())[i];
+    case DataType::INT32:
+      return reinterpret_cast<const int32_t*>(data.data())[i];
+    case DataType::INT8:
+      return reinterpret_cast<const int8_t*>(data.data())[i];
+    case DataType::BF16:
+      return BFloat16ToFloat(reinterpret_cast<const uint16_t*>(data.data())[i]);
+    case DataType::INT64:
+      return reinterpret_cast<const int64_t*>(data.data())[i];
+    case DataType::BOOL:
+      return data[i] != 0;
+    default:
+      return 0;
+  }
+}
+
+void StoreRef(std::vector<uint8_t>* data, DataType dtype, size_t i, long double v) {
+  switch (dtype) {
+    case DataType::UINT8:
+      (*data)[i] = SaturateRef<uint8_t>(v);
+      break;
+    case DataType::FLOAT16:
+      reinterpret_cast<uint16_t*>(data->data())[i] = FloatToHalf(static_cast<float>(v));
+      break;
+    case DataType::FLOAT32:
+      reinterpret_cast<float*>(data->data())[i] = static_cast<float>(v);
+      break;
+    case DataType::INT16:
+      reinterpret_cast<int16_t*>(data->data())[i] = SaturateRef<int16_t>(v);
+      break;
+    case DataType::INT32:
+      reinterpret_cast<int32_t*>(data->data())[i] = SaturateRef<int32_t>(v);
+      break;
+    case DataType::INT8:
+      reinterpret_cast<int8_t*>(data->data())[i] = SaturateRef<int8_t>(v);
+      break;
+    case DataType::BF16:
+      reinterpret_cast<uint16_t*>(data->data())[i] = FloatToBFloat16(static_cast<float>(v));
+      break;
+    case DataType::INT64:
+      reinterpret_cast<int64_t*>(data->data())[i] = SaturateRef<int64_t>(v);
+      break;
+    case DataType::BOOL:
+      (*data)[i] = v != 0;
+      break;
+    default:
+      break;
+  }
+}
+
+// element by element scalar cast, the reference of host tensor engine
+std::vector<uint8_t> CastRef(const std::vector<uint8_t>& src, DataType src_dtype, DataType dst_dtype) {
+  size_t count = src.size() / infer_server::GetTypeSize(src_dtype);
+  std::vector<uint8_t> dst(count * infer_server::GetTypeSize(dst_dtype));
+  for (size_t i = 0; i < count; ++i) StoreRef(&dst, dst_dtype, i, LoadRef(src, src_dtype, i));
+  return dst;
+}
+
+std::vector<uint8_t> TransposeRef(const std::vector<uint8_t>& src, DataType dtype,
+                                  const std::vector<Shape::value_type>& dims, const std::vector<int>& axis) {
+  std::vector<uint8_t> dst(src.size());
+  uint8_t* in = const_cast<uint8_t*>(src.data());
+  switch (infer_server::GetTypeSize(dtype)) {
+    case 1:
+      Transpose(in, dst.data(), dims, axis);
+      break;
+    case 2:
+      Transpose(reinterpret_cast<uint16_t*>(in), reinterpret_cast<uint16_t*>(dst.data()), dims, axis);
+      break;
+    case 4:
+      Transpose(reinterpret_cast<uint32_t*>(in), reinterpret_cast<uint32_t*>(dst.data()), dims, axis);
+      break;
+    default:
+      Transpose(reinterpret_cast<uint64_t*>(in), reinterpret_cast<uint64_t*>(dst.data()), dims, axis);
+      break;
+  }
+  return dst;
+}
+
+// covers saturation, rounding ties, nan and inf
+std::vector<uint8_t> GenHostData(DataType dtype, size_t count) {
+  std::vector<uint8_t> data(count * infer_server::GetTypeSize(dtype));
+  std::uniform_int_distribution<int> u8_dis(0, 255);
+  std::uniform_int_distribution<int> i16_dis(std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max());
+  std::uniform_int_distribution<int32_t> i32_dis(std::numeric_limits<int32_t>::min(),
+                                                 std::numeric_limits<int32_t>::max());
+  std::uniform_int_distribution<int> narrow_dis(-70000, 70000);
+  std::uniform_int_distribution<int64_t> i64_dis(std::numeric_limits<int64_t>::min(),
+                                                 std::numeric_limits<int64_t>::max());
+  std::uniform_real_distribution<float> f32_dis(-70000, 70000);
+  const float specials[] = {std::numeric_limits<float>::quiet_NaN(),
+                            std::numeric_limits<float>::infinity(),
+                            -std::numeric_limits<float>::infinity(),
+                            0.5f, 1.5f, 2.5f, -0.5f, -2.5f, 254.5f, 255.5f, 256.f, -32768.5f, 32767.5f,
+                            2147483520.f, 2147483648.f, -2147483648.f, 3e9f, 1e-8f};
+  for (size_t i = 0; i < count; ++i) {
+    switch (dtype) {
+      case DataType::UINT8:
+        data[i] = u8_dis(gen);
+        break;
+      case DataType::FLOAT16:
+        reinterpret_cast<uint16_t*>(data.data())[i] = u8_dis(gen) | (u8_dis(gen) << 8);
+        break;
+      case DataType::FLOAT32: {
+        float v;
+        switch (i % 4) {
+          case 0:
+            v = specials[(i / 4) % (sizeof(specials) / sizeof(specials[0]))];
+            break;
+          case 1:
+            v = data_dis(gen) * 2;
+            break;
+          case 2:
+            v = f32_dis(gen);
+            break;
+          default:
+            v = f32_dis(gen) * 1e-3f;
+            break;
+        }
+        reinterpret_cast<float*>(data.data())[i] = v;
+        break;
+      }
+      case DataType::INT16:
+        reinterpret_cast<int16_t*>(data.data())[i] = i16_dis(gen);
+        break;
+      case DataType::INT32:
+        reinterpret_cast<int32_t*>(data.data())[i] = (i % 2) ? i32_dis(gen) : narrow_dis(gen);
+        break;
+      case DataType::INT8:
+        reinterpret_cast<int8_t*>(data.data())[i] = u8_dis(gen) - 128;
+        break;
+      case DataType::BF16:
+        reinterpret_cast<uint16_t*>(data.data())[i] = u8_dis(gen) | (u8_dis(gen) << 8);
+        break;
+      case DataType::INT64:
+        reinterpret_cast<int64_t*>(data.data())[i] = (i % 3) ? i64_dis(gen) >> (i % 64) : narrow_dis(gen);
+        break;
+      case DataType::BOOL:
+        data[i] = u8_dis(gen) % 2;
+        break;
+      default:
+        break;
+    }
+  }
+  return data;
+}
+
+std::string AxisStr(const std::vector<int>& axis) {
+  std::string str;
+  for (int a : axis) str += std::to_string(a);
+  return str;
+}
+
+// bitwise equal, except that any nan matches any nan
+bool SameHostData(const std::vector<uint8_t>& expected, const std::vector<uint8_t>& actual, DataType dtype) {
+  if (expected.size() != actual.size()) return false;
+  size_t count = expected.size() / infer_server::GetTypeSize(dtype);
+  for (size_t i = 0; i < count; ++i) {
+    long double e = LoadRef(expected, dtype, i);
+    long double a = LoadRef(actual, dtype, i);
+    if (std::isnan(e) && std::isnan(a)) continue;
+    if (e != a || std::signbit(e) != std::signbit(a)) {
+      LOG(ERROR) << "[EasyDK Tests] [InferServer] Mismatch at " << i << " of " << DataTypeStr(dtype)
+                 << ", expected: " << e << ", actual: " << a;
+      return false;
+    }
+  }
+  return true;
+}
+
+TEST(InferServerCore, HalfConversion) {
+  EXPECT_EQ(FloatToHalf(0.f), 0x0000);
+  EXPECT_EQ(FloatToHalf(-0.f), 0x8000);
+  EXPECT_EQ(FloatToHalf(1.f), 0x3c00);
+  EXPECT_EQ(FloatToHalf(-2.f), 0xc000);
+  EXPECT_EQ(FloatToHalf(65504.f), 0x7bff);
+  // ties round to even
+  EXPECT_EQ(FloatToHalf(1.f + 1.f / 2048), 0x3c00);
+  EXPECT_EQ(FloatToHalf(1.f + 3.f / 2048), 0x3c02);
+  EXPECT_EQ(FloatToHalf(65519.f), 0x7bff);
+  EXPECT_EQ(FloatToHalf(65520.f), 0x7c00);
+  EXPECT_EQ(FloatToHalf(-1e10f), 0xfc00);
+  // subnormal
+  EXPECT_EQ(FloatToHalf(std::ldexp(1.f, -24)), 0x0001);
+  EXPECT_EQ(FloatToHalf(std::ldexp(1.f, -25)), 0x0000);
+  EXPECT_EQ(FloatToHalf(std::ldexp(3.f, -26)), 0x0001);
+  EXPECT_EQ(FloatToHalf(std::ldexp(1023.f, -24)), 0x03ff);
+  EXPECT_EQ(FloatToHalf(std::numeric_limits<float>::infinity()), 0x7c00);
+  EXPECT_EQ(FloatToHalf(std::numeric_limits<float>::quiet_NaN()) & 0x7e00, 0x7e00);
+
+  EXPECT_EQ(HalfToFloat(0x0001), std::ldexp(1.f, -24));
+  EXPECT_EQ(HalfToFloat(0x7bff), 65504.f);
+  EXPECT_TRUE(std::isinf(HalfToFloat(0xfc00)));
+  EXPECT_TRUE(std::isnan(HalfToFloat(0x7e00)));
+  for (uint32_t h = 0; h < 0x10000; ++h) {
+    float f = HalfToFloat(h);
+    if (!std::isnan(f)) {
+      ASSERT_EQ(FloatToHalf(f), h);
+    }
+  }
+}
+
+TEST(InferServerCore, BFloat16Conversion) {
+  EXPECT_EQ(FloatToBFloat16(1.f), 0x3f80);
+  EXPECT_EQ(FloatToBFloat16(-2.f), 0xc000);
+  // ties round to even
+  EXPECT_EQ(FloatToBFloat16(1.f + 1.f / 256), 0x3f80);
+  EXPECT_EQ(FloatToBFloat16(1.f + 3.f / 256), 0x3f82);
+  EXPECT_EQ(FloatToBFloat16(std::numeric_limits<float>::max()), 0x7f80);
+  EXPECT_EQ(FloatToBFloat16(-std::numeric_limits<float>::infinity()), 0xff80);
+  EXPECT_TRUE(std::isnan(BFloat16ToFloat(FloatToBFloat16(std::numeric_limits<float>::quiet_NaN()))));
+  EXPECT_EQ(BFloat16ToFloat(0x4049), 3.140625f);
+  for (uint32_t h = 0; h < 0x10000; ++h) {
+    float f = BFloat16ToFloat(h);
+    if (!std::isnan(f)) {
+      ASSERT_EQ(FloatToBFloat16(f), h);
+    }
+  }
+}
+
+TEST(InferServerCore, HostCastDataType) {
+  // odd count to run both vector and scalar tail
+  constexpr size_t count = 4099;
+  for (DataType src_dtype : host_dtypes) {
+    std::vector<uint8_t> src = GenHostData(src_dtype, count);
+    for (DataType dst_dtype : host_dtypes) {
+      std::vector<uint8_t> dst(count * infer_server::GetTypeSize(dst_dtype));
+      ASSERT_TRUE(HostCastDataType(src.data(), dst.data(), src_dtype, dst_dtype, count));
+      EXPECT_TRUE(SameHostData(CastRef(src, src_dtype, dst_dtype), dst, dst_dtype))
+          << DataTypeStr(src_dtype) << " to " << DataTypeStr(dst_dtype);
+    }
+  }
+  EXPECT_TRUE(HostCastDataType(nullptr, nullptr, DataType::UINT8, DataType::FLOAT32, 0));
+  EXPECT_FALSE(HostCastDataType(nullptr, nullptr, DataType::UINT8, DataType::FLOAT32, 1));
+  uint8_t in = 0;
+  float out = 0;
+  EXPECT_FALSE(HostCastDataType(&in, &out, DataType::INVALID, DataType::FLOAT32, 1));
+}
+
+TEST(InferServerCore, HostCastTranspose) {
+  std::vector<std::vector<Shape::value_type>> shapes = {
+      {7}, {32, 1000}, {33, 65}, {1, 3, 64, 70}, {2, 5, 1, 37, 3}, {3, 4, 5, 6, 7, 2}};
+  std::uniform_int_distribution<int> rank_dis(1, 5);
+  std::uniform_int_distribution<int> dim_dis(1, 12);
+  for (int i = 0; i < 12; ++i) {
+    std::vector<Shape::value_type> dims(rank_dis(gen));
+    for (auto& dim : dims) dim = dim_dis(gen) % 3 == 0 ? 1 : dim_dis(gen);
+    shapes.push_back(dims);
+  }
+
+  for (const auto& dims : shapes) {
+    size_t count = std::accumulate(dims.begin(), dims.end(), size_t(1), std::multiplies<size_t>());
+    std::vector<std::vector<int>> axes;
+    std::vector<int> axis(dims.size());
+    std::iota(axis.begin(), axis.end(), 0);
+    axes.push_back(axis);
+    std::reverse(axis.begin(), axis.end());
+    axes.push_back(axis);
+    std::shuffle(axis.begin(), axis.end(), gen);
+    axes.push_back(axis);
+
+    for (const auto& ax : axes) {
+      for (DataType src_dtype : host_dtypes) {
+        std::vector<uint8_t> src = GenHostData(src_dtype, count);
+        std::vector<uint8_t> transposed = TransposeRef(src, src_dtype, dims, ax);
+        std::vector<uint8_t> dst(src.size());
+        ASSERT_TRUE(HostTranspose(src.data(), dst.data(), src_dtype, dims, ax));
+        EXPECT_TRUE(SameHostData(transposed, dst, src_dtype)) << "Transpose " << Shape(dims) << " by " << AxisStr(ax);
+        for (DataType dst_dtype : host_dtypes) {
+          dst.assign(count * infer_server::GetTypeSize(dst_dtype), 0);
+          ASSERT_TRUE(HostCastTranspose(src.data(), dst.data(), src_dtype, dst_dtype, dims, ax));
+          EXPECT_TRUE(SameHostData(CastRef(transposed, src_dtype, dst_dtype), dst, dst_dtype))
+              << DataTypeStr(src_dtype) << " to " << DataTypeStr(dst_dtype) << ", " << Shape(dims) << " by "
+              << AxisStr(ax);
+        }
+      }
+    }
+  }
+
+  float in[6] = {0};
+  float out[6] = {0};
+  EXPECT_FALSE(HostTranspose(in, out, DataType::FLOAT32, {2, 3}, {0}));
+  EXPECT_FALSE(HostTranspose(in, out, DataType::FLOAT32, {2, 3}, {1, 1}));
+  EXPECT_FALSE(HostTranspose(in, out, DataType::FLOAT32, {2, 3}, {0, 2}));
+  EXPECT_FALSE(HostTranspose(in, out, DataType::FLOAT32, {2, -3}, {1, 0}));
+  EXPECT_TRUE(HostTranspose(nullptr, nullptr, DataType::FLOAT32, {2, 0}, {1, 0}));
+}
+
+TEST(InferServerCore, GetTransOrderAxis) {
+  EXPECT_EQ(GetTransOrderAxis(DimOrder::NCHW, DimOrder::NHWC, 4), nchw2nhwc_axis);
+  EXPECT_EQ(GetTransOrderAxis(DimOrder::NHWC, DimOrder::NCHW, 4), nhwc2nchw_axis);
+  EXPECT_EQ(GetTransOrderAxis(DimOrder::NCHW, DimOrder::NHWC, 5), std::vector<int>({0, 2, 3, 4, 1}));
+  EXPECT_EQ(GetTransOrderAxis(DimOrder::NCHW, DimOrder::HWCN, 4), std::vector<int>({2, 3, 1, 0}));
+  EXPECT_EQ(GetTransOrderAxis(DimOrder::HWCN, DimOrder::NHWC, 4), std::vector<int>({3, 0, 1, 2}));
+  EXPECT_EQ(GetTransOrderAxis(DimOrder::TNC, DimOrder::NTC, 3), std::vector<int>({1, 0, 2}));
+  EXPECT_EQ(GetTransOrderAxis(DimOrder::NHWC, DimOrder::NHWC, 3), std::vector<int>({0, 1, 2}));
+  EXPECT_THROW(GetTransOrderAxis(DimOrder::NCHW, DimOrder::TNC, 4), std::runtime_error);
+}
+
+TEST(InferServerCore, TransLayout) {
+  std::vector<Shape::value_type> dims = {2, 37, 45, 3};
+  size_t count = 2 * 37 * 45 * 3;
+  std::vector<uint8_t> src = GenHostData(DataType::UINT8, count);
+  std::vector<uint8_t> dst(count * sizeof(float));
+  ASSERT_TRUE(TransLayout(src.data(), dst.data(), nhwc_u8, nchw_f32, Shape(dims)));
+  std::vector<uint8_t> expected = CastRef(TransposeRef(src, DataType::UINT8, dims, nhwc2nchw_axis), DataType::UINT8,
+                                          DataType::FLOAT32);
+  EXPECT_TRUE(SameHostData(expected, dst, DataType::FLOAT32));
+
+  EXPECT_FALSE(TransLayout(src.data(), dst.data(), nhwc_u8, DataLayout{DataType::FLOAT32, DimOrder::TNC},
+                           Shape(dims)));
+}
+
+template <typename T>
+std::vector<T> QuantizeRef(const std::vector<float>& data, const std::vector<float>& scales,
+                           const std::vector<int32_t>& zero_points, size_t inner) {
+  std::vector<T> quantized(data.size());
+  for (size_t i = 0; i < data.size(); ++i) {
+    size_t c = scales.size() > 1 ? (i / inner) % scales.size() : 0;
+    float zero_point = zero_points.empty() ? 0.f : static_cast<float>(zero_points[c]);
+    quantized[i] = SaturateRef<T>(data[i] / scales[c] + zero_point);
+  }
+  return quantized;
+}
+
+TEST(InferServerCore, QuantizeRoundTrip) {
+  std::uniform_real_distribution<float> unit_dis(-1, 1);
+  // per-tensor
+  {
+    std::vector<float> data(1031);
+    for (auto& v : data) v = unit_dis(gen) * 6.3f;
+    DataLayout f32_layout{DataType::FLOAT32, DimOrder::NONE};
+    DataLayout s8_layout{DataType::INT8, DimOrder::NONE};
+    s8_layout.quant.scales = {0.05f};
+    DataLayout u8_layout{DataType::UINT8, DimOrder::NONE};
+    u8_layout.quant.scales = {0.05f};
+    u8_layout.quant.zero_points = {128};
+    DataLayout s16_layout{DataType::INT16, DimOrder::NONE};
+    s16_layout.quant.scales = {1.f / 256};
+    Shape shape({static_cast<Shape::value_type>(data.size())});
+
+    std::vector<int8_t> s8(data.size());
+    ASSERT_TRUE(CastHostData(data.data(), s8.data(), f32_layout, s8_layout, shape));
+    EXPECT_EQ(s8, QuantizeRef<int8_t>(data, s8_layout.quant.scales, {}, data.size()));
+    std::vector<uint8_t> u8(data.size());
+    ASSERT_TRUE(CastHostData(data.data(), u8.data(), f32_layout, u8_layout, shape));
+    EXPECT_EQ(u8, QuantizeRef<uint8_t>(data, u8_layout.quant.scales, u8_layout.quant.zero_points, data.size()));
+    std::vector<int16_t> s16(data.size());
+    ASSERT_TRUE(CastHostData(data.data(), s16.data(), f32_layout, s16_layout, shape));
+
+    std::vector<float> s8_back(data.size()), u8_back(data.size()), s16_back(data.size());
+    ASSERT_TRUE(CastHostData(s8.data(), s8_back.data(), s8_layout, f32_layout, shape));
+    ASSERT_TRUE(CastHostData(u8.data(), u8_back.data(), u8_layout, f32_layout, shape));
+    ASSERT_TRUE(CastHostData(s16.data(), s16_back.data(), s16_layout, f32_layout, shape));
+    for (size_t i = 0; i < data.size(); ++i) {
+      ASSERT_NEAR(s8_back[i], data[i], 0.025f + 1e-6f);
+      ASSERT_NEAR(u8_back[i], data[i], 0.025f + 1e-6f);
+      ASSERT_NEAR(s16_back[i], data[i], 1.f / 512 + 1e-6f);
+      ASSERT_EQ(s8_back[i], s8[i] * 0.05f);
+      ASSERT_EQ(u8_back[i], (u8[i] - 128) * 0.05f);
+    }
+
+    // requantize without going through user code
+    std::vector<uint8_t> requantized(data.size());
+    ASSERT_TRUE(CastHostData(s8.data(), requantized.data(), s8_layout, u8_layout, shape));
+    EXPECT_EQ(requantized, QuantizeRef<uint8_t>(s8_back, u8_layout.quant.scales, u8_layout.quant.zero_points,
+                                                data.size()));
+  }
+
+  // per-channel along dim 1
+  {
+    std::vector<Shape::value_type> dims = {2, 3, 4, 5};
+    DataLayout f32_layout{DataType::FLOAT32, DimOrder::NCHW};
+    DataLayout s8_layout{DataType::INT8, DimOrder::NCHW};
+    s8_layout.quant.scales = {0.01f, 0.1f, 1.f};
+    s8_layout.quant.zero_points = {0, -5, 3};
+    std::vector<float> data(2 * 3 * 4 * 5);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = unit_dis(gen) * 120 * s8_layout.quant.scales[(i / 20) % 3];
+
+    std::vector<int8_t> s8(data.size());
+    ASSERT_TRUE(CastHostData(data.data(), s8.data(), f32_layout, s8_layout, Shape(dims)));
+    EXPECT_EQ(s8, QuantizeRef<int8_t>(data, s8_layout.quant.scales, s8_layout.quant.zero_points, 20));
+    std::vector<float> back(data.size());
+    ASSERT_TRUE(CastHostData(s8.data(), back.data(), s8_layout, f32_layout, Shape(dims)));
+    for (size_t i = 0; i < data.size(); ++i) {
+      float scale = s8_layout.quant.scales[(i / 20) % 3];
+      ASSERT_NEAR(back[i], data[i], scale / 2 + 1e-6f) << i;
+    }
+
+    // quantized NHWC into float NCHW
+    std::vector<Shape::value_type> nhwc_dims = {2, 4, 5, 3};
+    DataLayout s8_nhwc{DataType::INT8, DimOrder::NHWC};
+    s8_nhwc.quant = s8_layout.quant;
+    s8_nhwc.quant.axis = 3;
+    std::vector<float> nchw(s8.size());
+    ASSERT_TRUE(TransLayout(s8.data(), nchw.data(), s8_nhwc, nchw_f32, Shape(nhwc_dims)));
+    std::vector<uint8_t> raw(s8.begin(), s8.end());
+    std::vector<uint8_t> expected = TransposeRef(raw, DataType::INT8, nhwc_dims, nhwc2nchw_axis);
+    for (size_t i = 0; i < expected.size(); ++i) {
+      size_t c = (i / 20) % 3;
+      float v = (static_cast<int8_t>(expected[i]) - s8_layout.quant.zero_points[c]) * s8_layout.quant.scales[c];
+      ASSERT_EQ(nchw[i], v) << i;
+    }
+
+    DataLayout invalid = s8_layout;
+    invalid.quant.zero_points = {0, 0};
+    EXPECT_FALSE(CastHostData(data.data(), s8.data(), f32_layout, invalid, Shape(dims)));
+    invalid = s8_layout;
+    invalid.quant.axis = 2;
+    EXPECT_FALSE(CastHostData(data.data(), s8.data(), f32_layout, invalid, Shape(dims)));
+    invalid = s8_layout;
+    invalid.quant.scales[1] = 0;
+    EXPECT_FALSE(CastHostData(data.data(), s8.data(), f32_layout, invalid, Shape(dims)));
+  }
+}
+
+double HostThroughput(const std::function<void()>& func, size_t bytes) {
+  constexpr int loop = 10;
+  func();
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < loop; ++i) func();
+  std::chrono::duration<double> dura = std::chrono::steady_clock::now() - start;
+  return bytes * loop / dura.count() / (1 << 20);
+}
+
+// benchmark, run with --gtest_also_run_disabled_tests
+TEST(InferServerCore, DISABLED_HostTensorBenchmark) {
+  struct Case {
+    const char* name;
+    std::vector<Shape::value_type> dims;
+    std::vector<int> axis;
+    DataType src_dtype;
+    DataType dst_dtype;
+  };
+  const std::vector<Case> cases = {
+      {"cast 1x3x640x640 UINT8 to FLOAT32", {1, 3, 640, 640}, {0, 1, 2, 3}, DataType::UINT8, DataType::FLOAT32},
+      {"cast 1x3x640x640 FLOAT32 to FLOAT16", {1, 3, 640, 640}, {0, 1, 2, 3}, DataType::FLOAT32, DataType::FLOAT16},
+      {"NHWC UINT8 to NCHW FLOAT32 1x640x640x3", {1, 640, 640, 3}, nhwc2nchw_axis, DataType::UINT8,
+       DataType::FLOAT32},
+      {"NCHW FLOAT32 to NHWC FLOAT32 1x3x640x640", {1, 3, 640, 640}, nchw2nhwc_axis, DataType::FLOAT32,
+       DataType::FLOAT32},
+      {"cast 32x1000 FLOAT16 to FLOAT32", {32, 1000}, {0, 1}, DataType::FLOAT16, DataType::FLOAT32},
+      {"transpose 32x1000 FLOAT32", {32, 1000}, {1, 0}, DataType::FLOAT32, DataType::FLOAT32},
+  };
+  for (const auto& c : cases) {
+    size_t count = std::accumulate(c.dims.begin(), c.dims.end(), size_t(1), std::multiplies<size_t>());
+    std::vector<uint8_t> src = GenHostData(c.src_dtype, count);
+    std::vector<uint8_t> dst(count * infer_server::GetTypeSize(c.dst_dtype));
+    size_t bytes = src.size() + dst.size();
+    double engine = HostThroughput([&]() {
+      HostCastTranspose(src.data(), dst.data(), c.src_dtype, c.dst_dtype, c.dims, c.axis);
+    }, bytes);
+    std::vector<uint8_t> expected;
+    double scalar = HostThroughput([&]() {
+      expected = CastRef(TransposeRef(src, c.src_dtype, c.dims, c.axis), c.src_dtype, c.dst_dtype);
+    }, bytes);
+    EXPECT_TRUE(SameHostData(expected, dst, c.dst_dtype)) << c.name;
+    LOG(INFO) << "[EasyDK Tests] [InferServer] " << c.name << ": engine " << engine << " MB/s, scalar reference "
+              << scalar << " MB/s";
+  }
+}
+
 }  // namespace
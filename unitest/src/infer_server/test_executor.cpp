@@ -20,8 +20,11 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <future>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -178,4 +181,71 @@ TEST(InferServerCore, Executor) {
   ASSERT_EQ(get_session_number, 0u);
 }
 
+TEST(InferServerCore, ExecutorSharePredictor) {
+  int device_id = 0;
+  PriorityThreadPool tp([device_id]() -> bool { return SetCurrentDevice(device_id); }, 3);
+  std::shared_ptr<PreprocHandleTest> handler = std::make_shared<PreprocHandleTest>();
+  SessionDesc desc1 = ReturnSessionDesc("test executor 1", handler.get(), 200, BatchStrategy::STATIC, 1);
+  SessionDesc desc2 = ReturnSessionDesc("test executor 2", handler.get(), 200, BatchStrategy::DYNAMIC, 2);
+
+  SharedPredictorPtr predictor = std::make_shared<SharedPredictor>(desc1.model, device_id);
+  std::unique_ptr<Executor> executor1(new Executor(desc1, &tp, device_id, predictor));
+  ASSERT_EQ(predictor->Size(), 1u);
+  // the second executor reuses the first predictor and only creates one more for its second engine
+  std::unique_ptr<Executor> executor2(new Executor(desc2, &tp, device_id, predictor));
+  ASSERT_EQ(predictor->Size(), 2u);
+  EXPECT_EQ(executor1->GetSharedPredictor(), executor2->GetSharedPredictor());
+
+  std::weak_ptr<SharedPredictor> weak_predictor = predictor;
+  predictor.reset();
+  executor1.reset();
+  EXPECT_FALSE(weak_predictor.expired());
+  executor2.reset();
+  EXPECT_TRUE(weak_predictor.expired());
+}
+
+TEST(InferServerCore, ExecutorMergeBatch) {
+  int device_id = 0;
+  // no thread until both requests are queued
+  PriorityThreadPool tp([device_id]() -> bool { return SetCurrentDevice(device_id); }, 0);
+  std::shared_ptr<PreprocHandleTest> handler = std::make_shared<PreprocHandleTest>();
+  // executors of different sessions share the model, partial batches are merged with packs queued ahead
+  SessionDesc desc1 = ReturnSessionDesc("test merge 1", handler.get(), 200, BatchStrategy::STATIC, 1);
+  SessionDesc desc2 = ReturnSessionDesc("test merge 2", handler.get(), 200, BatchStrategy::STATIC, 1);
+  SharedPredictorPtr predictor = std::make_shared<SharedPredictor>(desc1.model, device_id);
+  std::unique_ptr<Executor> executor1(new Executor(desc1, &tp, device_id, predictor));
+  std::unique_ptr<Executor> executor2(new Executor(desc2, &tp, device_id, predictor));
+  ASSERT_GT(desc1.model->BatchSize(), 1u);
+
+  CnedkBufSurfaceCreateParams create_params;
+  CreateBufSurfaceParams(device_id, &create_params);
+  std::promise<void> flag1, flag2;
+  auto upload = [&](Executor* executor, std::promise<void>* flag) {
+    auto response = [](Status, PackagePtr) {};
+    auto notifier = [flag](const RequestControl*) { flag->set_value(); };
+    RequestControl* ctrl = new RequestControl(response, notifier, "", 0, 1);
+    auto input = Package::Create(1);
+    PreprocInput preproc_input;
+    PrepareInput(&create_params, &preproc_input);
+    input->data[0]->Set(std::move(preproc_input));
+    input->data[0]->ctrl = ctrl;
+    input->data[0]->index = 0;
+    EXPECT_TRUE(executor->Upload(std::move(input), ctrl));
+    return std::unique_ptr<RequestControl>(ctrl);
+  };
+  auto ctrl1 = upload(executor1.get(), &flag1);
+  auto ctrl2 = upload(executor2.get(), &flag2);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  // the first partial batch is flushed after the second one is preprocessed and inferred
+  tp.Resize(1);
+  EXPECT_EQ(std::future_status::ready, flag1.get_future().wait_for(std::chrono::seconds(2)));
+  EXPECT_EQ(std::future_status::ready, flag2.get_future().wait_for(std::chrono::seconds(2)));
+  // requests of the two sessions are inferred in one batch, and routed back to their own postprocessors
+  EXPECT_EQ(predictor->MergedBatchNum(), 1u);
+  EXPECT_TRUE(ctrl1->IsSuccess());
+  EXPECT_TRUE(ctrl2->IsSuccess());
+  executor1.reset();
+  executor2.reset();
+}
+
 }  // namespace infer_server
@@ -18,9 +18,17 @@
  * THE SOFTWARE.
  *************************************************************************/
 
+#include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "cnis/infer_server.h"
 #include "cnis/processor.h"
@@ -33,8 +41,126 @@ TEST(InferServer, DataTypeSize) {
   EXPECT_EQ(GetTypeSize(DataType::FLOAT32), 4u);
   EXPECT_EQ(GetTypeSize(DataType::INT32), 4u);
   EXPECT_EQ(GetTypeSize(DataType::INT16), 2u);
+  EXPECT_EQ(GetTypeSize(DataType::INT8), 1u);
+  EXPECT_EQ(GetTypeSize(DataType::BF16), 2u);
+  EXPECT_EQ(GetTypeSize(DataType::INT64), 8u);
+  EXPECT_EQ(GetTypeSize(DataType::BOOL), 1u);
 }
 
 TEST(InferServer, PredictorBackend) { EXPECT_EQ(Predictor::Backend(), std::string("magicmind")); }
 
+TEST(InferServer, ParamKey) {
+  static const ParamKey<int> kNumber("test_param_number");
+  static const ParamKey<std::shared_ptr<int>> kPointer("test_param_pointer");
+  static const ParamKey<std::string> kString("test_param_string");
+  EXPECT_EQ(ParamKey<int>("test_param_number").Id(), kNumber.Id());
+  EXPECT_NE(kNumber.Id(), kPointer.Id());
+  EXPECT_EQ(kString.Name(), "test_param_string");
+
+  BaseObject obj;
+  EXPECT_FALSE(obj.HaveParam(kNumber));
+  EXPECT_EQ(obj.FindParam(kNumber), nullptr);
+  EXPECT_THROW(obj.GetParam(kNumber), std::out_of_range);
+  EXPECT_THROW(obj.GetParam<int>("test_param_number"), std::out_of_range);
+
+  // keys and names are interchangeable
+  obj.SetParams(kNumber, 1, "test_param_pointer", std::make_shared<int>(2));
+  obj.SetParams("test_param_string", std::string("three"));
+  EXPECT_TRUE(obj.HaveParam("test_param_number"));
+  EXPECT_EQ(obj.GetParam<int>("test_param_number"), 1);
+  EXPECT_EQ(*obj.GetParam(kPointer), 2);
+  EXPECT_EQ(obj.GetParam(kString), "three");
+  ASSERT_NE(obj.FindParam(kString), nullptr);
+  EXPECT_EQ(*obj.FindParam(kString), "three");
+  EXPECT_EQ(obj.GetParamNames(),
+            std::vector<std::string>({"test_param_number", "test_param_pointer", "test_param_string"}));
+
+  // value is converted to the type of key
+  obj.SetParams(kNumber, 4.0);
+  EXPECT_EQ(obj.GetParam(kNumber), 4);
+  // type mismatch
+  obj.SetParams("test_param_number", 5u);
+  EXPECT_EQ(obj.FindParam(kNumber), nullptr);
+  EXPECT_THROW(obj.GetParam(kNumber), bad_any_cast);
+  EXPECT_EQ(obj.GetParam<unsigned>("test_param_number"), 5u);
+
+  BaseObject copy;
+  copy.CopyParamsFrom(obj);
+  EXPECT_EQ(*obj.PopParam(kPointer), 2);
+  EXPECT_FALSE(obj.HaveParam(kPointer));
+  EXPECT_TRUE(copy.HaveParam(kPointer));
+  EXPECT_EQ(copy.PopParam<std::string>("test_param_string"), "three");
+  EXPECT_FALSE(copy.HaveParam("test_param_string"));
+  EXPECT_TRUE(obj.HaveParam("test_param_string"));
+}
+
+TEST(InferServer, ParamNameConcurrent) {
+  // names are looked up without lock while other threads register new ones
+  constexpr int kThreadNum = 4;
+  constexpr int kNameNum = 200;
+  std::vector<std::thread> threads;
+  std::vector<std::vector<size_t>> ids(kThreadNum, std::vector<size_t>(kNameNum));
+  for (int t = 0; t < kThreadNum; ++t) {
+    threads.emplace_back([t, &ids]() {
+      for (int i = 0; i < kNameNum; ++i) {
+        std::string name = "test_concurrent_param_" + std::to_string((i + t * 50) % kNameNum);
+        ids[t][(i + t * 50) % kNameNum] = detail::RegisterParamName(name);
+        EXPECT_EQ(detail::FindParamId(name), static_cast<int>(ids[t][(i + t * 50) % kNameNum]));
+      }
+    });
+  }
+  for (auto& it : threads) it.join();
+  for (int i = 0; i < kNameNum; ++i) {
+    for (int t = 1; t < kThreadNum; ++t) EXPECT_EQ(ids[t][i], ids[0][i]);
+    EXPECT_EQ(detail::GetParamName(ids[0][i]), "test_concurrent_param_" + std::to_string(i));
+  }
+  EXPECT_EQ(detail::FindParamId("test_concurrent_param_unknown"), -1);
+}
+
+TEST(InferServer, GetParamBenchmark) {
+  constexpr int kLoop = 1000000;
+  static const ParamKey<int> kDeviceId("device_id");
+  static const ParamKey<std::shared_ptr<int>> kModel("test_param_model");
+  auto model = std::make_shared<int>(0);
+  auto ns_per_call = [](const std::function<int64_t()>& func) {
+    auto start = std::chrono::steady_clock::now();
+    int64_t sum = func();
+    std::chrono::duration<double, std::nano> dura = std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(sum, 2 * kLoop);
+    return dura.count() / kLoop;
+  };
+
+  // the former storage of BaseObject
+  std::map<std::string, any> legacy{{"device_id", 1}, {"test_param_model", model}};
+  double legacy_ns = ns_per_call([&]() {
+    int64_t sum = 0;
+    for (int i = 0; i < kLoop; ++i) {
+      sum += any_cast<int>(legacy.at("device_id"));
+      sum += any_cast<std::shared_ptr<int>>(legacy.at("test_param_model")).use_count() > 1;
+    }
+    return sum;
+  });
+
+  BaseObject obj;
+  obj.SetParams(kDeviceId, 1, kModel, model);
+  double name_ns = ns_per_call([&]() {
+    int64_t sum = 0;
+    for (int i = 0; i < kLoop; ++i) {
+      sum += obj.GetParam<int>("device_id");
+      sum += obj.GetParam<std::shared_ptr<int>>("test_param_model").use_count() > 1;
+    }
+    return sum;
+  });
+  double key_ns = ns_per_call([&]() {
+    int64_t sum = 0;
+    for (int i = 0; i < kLoop; ++i) {
+      sum += obj.GetParam(kDeviceId);
+      sum += obj.GetParam(kModel).use_count() > 1;
+    }
+    return sum;
+  });
+  LOG(INFO) << "[EasyDK Tests] [InferServer] GetParam of int and shared_ptr: string keyed map " << legacy_ns
+            << " ns, by name " << name_ns << " ns, by ParamKey " << key_ns << " ns";
+}
+
 }  // namespace infer_server
@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 #include <stdlib.h>
 
+#include <algorithm>
 #include <chrono>
 #include <fstream>
 #include <iostream>
@@ -29,6 +30,7 @@
 #include <string>
 #include <thread>
 
+#include "cnedk_memory_budget.hpp"
 #include "cnis/infer_server.h"
 #include "cnrt.h"
 #include "fixture.h"
@@ -60,5 +62,38 @@ TEST_F(InferServerTestAPI, ModelManager) {
   EXPECT_EQ(ModelManager::Instance()->CacheSize(), 0);
 }
 
+TEST_F(InferServerTestAPI, ModelCacheHardLimit) {
+  cnedk::MemoryBudget& budget = cnedk::MemoryBudget::Instance();
+  InferServer::ClearModelCache();
+  auto m = server_->LoadModel(GetModelInfoStr("resnet50", "url"));
+  ASSERT_TRUE(m);
+  size_t resnet_size = budget.GetUsage(cnedk::kHostMemory, cnedk::kMemCategoryModelCache);
+  InferServer::ClearModelCache();
+  auto l = server_->LoadModel(GetModelInfoStr("yolov3", "url"));
+  ASSERT_TRUE(l);
+  size_t yolo_size = budget.GetUsage(cnedk::kHostMemory, cnedk::kMemCategoryModelCache);
+  InferServer::ClearModelCache();
+  m.reset();
+  l.reset();
+
+  // only one of the models fits the limit
+  budget.SetLimits(cnedk::kHostMemory, cnedk::kMemCategoryModelCache,
+                   cnedk::MemLimits(0, std::max(resnet_size, yolo_size)));
+  m = server_->LoadModel(GetModelInfoStr("resnet50", "url"));
+  ASSERT_TRUE(m);
+  m.reset();
+  // the idle model is evicted by the model cache itself
+  l = server_->LoadModel(GetModelInfoStr("yolov3", "url"));
+  ASSERT_TRUE(l);
+  EXPECT_EQ(ModelManager::Instance()->CacheSize(), 1);
+  EXPECT_EQ(budget.GetUsage(cnedk::kHostMemory, cnedk::kMemCategoryModelCache), yolo_size);
+  // models in use are not evicted
+  EXPECT_FALSE(server_->LoadModel(GetModelInfoStr("resnet50", "url")));
+  EXPECT_EQ(ModelManager::Instance()->CacheSize(), 1);
+
+  budget.ClearLimits();
+  InferServer::ClearModelCache();
+}
+
 }  // namespace
 }  // namespace infer_server
@@ -300,6 +300,53 @@ TEST_F(InferServerRequestTest, DynamicBatch) {
   server_->DestroySession(session);
 }
 
+#ifdef CNIS_RECORD_PERF
+TEST_F(InferServerRequestTest, UsagePerTag) {
+  SetPostprocHandler(model_->GetKey(), postproc_handler_.get());
+  Session_t session = PrepareSession("usage per tag", preproc_, postproc_, 5, BatchStrategy::DYNAMIC, observer_);
+  ASSERT_NE(session, nullptr);
+
+  constexpr const char* tag1 = "usage tag 1";
+  constexpr const char* tag2 = "usage tag 2";
+  auto in = PrepareInput(image_path, 3);
+  in->tag = tag1;
+  ASSERT_TRUE(server_->Request(session, std::move(in), nullptr));
+  in = PrepareInput(image_path, 1);
+  in->tag = tag2;
+  ASSERT_TRUE(server_->Request(session, std::move(in), nullptr));
+  in = PrepareInput(image_path, 2);
+  in->tag = tag1;
+  ASSERT_TRUE(server_->Request(session, std::move(in), nullptr));
+  server_->WaitTaskDone(session, tag1);
+  server_->WaitTaskDone(session, tag2);
+
+  UsageStatistic usage1 = server_->GetUsage(session, tag1);
+  UsageStatistic usage2 = server_->GetUsage(session, tag2);
+  EXPECT_EQ(usage1.request_cnt, 2u);
+  EXPECT_EQ(usage1.unit_cnt, 5u);
+  EXPECT_EQ(usage2.request_cnt, 1u);
+  EXPECT_EQ(usage2.unit_cnt, 1u);
+  for (const auto& usage : {usage1, usage2}) {
+    EXPECT_GT(usage.device_time, 0);
+    EXPECT_GT(usage.bytes, 0);
+    EXPECT_GE(usage.preproc_cpu_time, 0);
+    EXPECT_GE(usage.postproc_cpu_time, 0);
+    EXPECT_GE(usage.queue_time, 0);
+  }
+  // usage of a tag is prorated by data number
+  EXPECT_GT(usage1.bytes, usage2.bytes);
+  EXPECT_EQ(server_->GetUsage(session, "not exist tag").request_cnt, 0u);
+
+  // snapshot is updated every 2 seconds
+  std::this_thread::sleep_for(std::chrono::milliseconds(2100));
+  auto snapshot = server_->GetUsageSnapshot(session);
+  ASSERT_EQ(snapshot.size(), 2u);
+  EXPECT_EQ(snapshot[tag1].unit_cnt, usage1.unit_cnt);
+  EXPECT_EQ(snapshot[tag2].unit_cnt, usage2.unit_cnt);
+  server_->DestroySession(session);
+}
+#endif
+
 TEST_F(InferServerRequestTest, SkipPostproc) {
   // no process_function param
   SetPostprocHandler(model_->GetKey(), nullptr);
@@ -451,6 +498,66 @@ TEST_F(InferServerRequestTest, ParallelInfer) {
   server_->DestroySession(session2);
 }
 
+TEST_F(InferServerRequestTest, DynamicBatchContinuousData) {
+  SetPreprocHandler(model_->GetKey(), preproc_handler_.get());
+  SetPostprocHandler(model_->GetKey(), nullptr);
+  Session_t session =
+      PrepareSession("dynamic batch continuous data", preproc_, nullptr, 5, BatchStrategy::DYNAMIC, observer_);
+  ASSERT_NE(session, nullptr);
+
+  auto prepare_continuous_input = [this](size_t data_num, const std::string& tag) {
+    auto in = Package::Create(data_num, tag);
+    ModelIO model_input;
+    for (size_t i_idx = 0; i_idx < model_->InputNum(); ++i_idx) {
+      size_t item_len = model_->InputShape(i_idx).DataCount() * GetTypeSize(model_->InputLayout(i_idx).dtype);
+      CnedkBufSurfaceCreateParams create_params;
+      memset(&create_params, 0, sizeof(create_params));
+      create_params.device_id = device_id_;
+      create_params.batch_size = 1;
+      // only data_num items, smaller than a batch
+      create_params.size = item_len * data_num;
+      create_params.color_format = CNEDK_BUF_COLOR_FORMAT_TENSOR;
+      create_params.mem_type = CNEDK_BUF_MEM_DEFAULT;
+      CnedkBufSurface* surf;
+      EXPECT_EQ(CnedkBufSurfaceCreate(&surf, &create_params), 0);
+      model_input.surfs.emplace_back(std::make_shared<cnedk::BufSurfaceWrapper>(surf));
+      model_input.shapes.emplace_back(model_->InputShape(i_idx));
+    }
+    in->predict_io.reset(new InferData);
+    in->predict_io->Set(std::move(model_input));
+    return in;
+  };
+
+  constexpr const char* tag = "DynamicBatchContinuousData";
+  // partial batches of several requests are batched together, and a request larger than batch is sliced
+  const size_t request_num = model_->BatchSize() + 1;
+  for (size_t idx = 0; idx < request_num; ++idx) {
+    size_t num = idx == request_num - 1 ? model_->BatchSize() + 1 : 1;
+    ASSERT_TRUE(server_->Request(session, prepare_continuous_input(num, tag), nullptr));
+  }
+  server_->WaitTaskDone(session, tag);
+  WaitAsyncDone();
+  ASSERT_EQ(observer_->ResponseNum(), request_num);
+  for (size_t idx = 0; idx < request_num; ++idx) {
+    auto response = observer_->GetPackage();
+    ASSERT_TRUE(response);
+    EXPECT_EQ(response->data.size(), idx == request_num - 1 ? model_->BatchSize() + 1 : 1u);
+    for (auto& it : response->data) {
+      EXPECT_NO_THROW(it->Get<ModelIO>());
+      EXPECT_FALSE(it->predict_io);
+    }
+  }
+  server_->DestroySession(session);
+
+  // continuous data larger than batch size is still unsupported under STATIC strategy
+  session = PrepareSession("static batch continuous data", preproc_, nullptr, 5, BatchStrategy::STATIC, nullptr);
+  ASSERT_NE(session, nullptr);
+  Status status;
+  auto out = std::make_shared<Package>();
+  EXPECT_FALSE(server_->RequestSync(session, prepare_continuous_input(model_->BatchSize() + 1, tag), &status, out));
+  server_->DestroySession(session);
+}
+
 TEST_F(InferServerRequestTest, ResponseOrder) {
   Session_t session = PrepareSession("response order", preproc_, nullptr, 200, BatchStrategy::DYNAMIC, observer_);
   ASSERT_NE(session, nullptr);
@@ -21,6 +21,7 @@
 #include <gtest/gtest.h>
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
@@ -243,4 +244,56 @@ TEST(InferServerCore, SessionDiscardTask) {
   executor->Unlink(session.get());
 }
 
+class DiscardTestObserver : public Observer {
+ public:
+  void Response(Status status, PackagePtr data, any user_data) noexcept override {
+    std::unique_lock<std::mutex> lk(mutex_);
+    responded_.push_back(any_cast<int>(user_data));
+  }
+  std::vector<int> Responded() {
+    std::unique_lock<std::mutex> lk(mutex_);
+    return responded_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<int> responded_;
+};
+
+TEST(InferServerCore, SessionDiscardRequest) {
+  PriorityThreadPool tp([]() -> bool { return SetCurrentDevice(device_id); }, 3);
+  auto handler = std::make_shared<PreprocHandleTest>();
+  SessionDesc desc = ReturnSessionDesc("test session", handler.get(), 5, BatchStrategy::DYNAMIC, 1);
+  std::unique_ptr<Executor> executor(new Executor(desc, &tp, 0));
+  std::unique_ptr<Session> session(new Session("init session", executor.get(), false, true));
+  executor->Link(session.get());
+  auto observer = std::make_shared<DiscardTestObserver>();
+  session->SetObserver(observer);
+
+  CnedkBufSurfaceCreateParams create_params;
+  CreateBufSurfaceParams(device_id, &create_params);
+
+  // requests with the same tag, only the discarded one is not responded
+  std::string tag = "test tag";
+  std::vector<int64_t> ids(3, -1);
+  for (int i = 0; i < 3; ++i) {
+    auto input = Package::Create(20, tag);
+    for (auto it : input->data) {
+      PreprocInput preproc_input;
+      PrepareInput(&create_params, &preproc_input);
+      it->Set<PreprocInput>(std::move(preproc_input));
+    }
+    ASSERT_TRUE(session->Send(std::move(input), std::bind(&Observer::Response, session->GetRawObserver(),
+                                                          std::placeholders::_1, std::placeholders::_2, i),
+                              &ids[i]));
+  }
+  EXPECT_EQ(ids[1], ids[0] + 1);
+  EXPECT_EQ(ids[2], ids[1] + 1);
+  session->DiscardRequest(ids[2]);
+  session->WaitTaskDone(tag);
+  EXPECT_EQ(observer->Responded(), std::vector<int>({0, 1}));
+
+  executor->Unlink(session.get());
+}
+
 }  // namespace infer_server
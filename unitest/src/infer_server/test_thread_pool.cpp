@@ -20,6 +20,7 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <chrono>
 #include <iostream>
 #include <memory>
@@ -109,3 +110,33 @@ TEST(InferServerUtil, ThreadPoolStable) {
     main_pool->Resize(0);
   }
 }
+
+namespace {
+std::vector<int> RunEqualPriorityTasks(bool seeded, uint64_t seed) {
+  // no thread in pool until all tasks are pushed, so that order is decided by the queue only
+  infer_server::PriorityThreadPool tp(nullptr);
+  if (seeded) tp.SetSchedulingSeed(seed);
+  std::vector<int> order;
+  std::vector<std::future<void>> ret;
+  for (int i = 0; i < 16; ++i) {
+    ret.emplace_back(tp.Push(0, [&order, i]() { order.push_back(i); }));
+  }
+  tp.Resize(1);
+  for (auto& it : ret) it.get();
+  tp.Stop();
+  return order;
+}
+}  // namespace
+
+TEST(InferServerUtil, PriorityThreadPoolSchedulingSeed) {
+  std::vector<int> fifo = RunEqualPriorityTasks(false, 0);
+  for (int i = 0; i < 16; ++i) {
+    EXPECT_EQ(i, fifo[i]);
+  }
+  std::vector<int> seeded = RunEqualPriorityTasks(true, 42);
+  EXPECT_EQ(seeded, RunEqualPriorityTasks(true, 42));
+  EXPECT_NE(seeded, fifo);
+  EXPECT_NE(seeded, RunEqualPriorityTasks(true, 43));
+  std::sort(seeded.begin(), seeded.end());
+  EXPECT_EQ(seeded, fifo);
+}
@@ -22,11 +22,14 @@
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <functional>
+#include <future>
 #include <thread>
 #include <vector>
 
+#include "util/thread_pool.h"
 #include "util/threadsafe_queue.h"
 
 TEST(InferServerUtil, ThreadSafeQueue) {
@@ -53,3 +56,141 @@ TEST(InferServerUtil, ThreadSafeQueue) {
     EXPECT_EQ(vec[i], res[i]);
   }
 }
+
+TEST(InferServerUtil, MpmcRingQueue) {
+  infer_server::MpmcRingQueue<int> q(5);
+  // capacity is rounded up to power of 2
+  EXPECT_EQ(q.Capacity(), 8u);
+  EXPECT_TRUE(q.Empty());
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_TRUE(q.TryPush(i));
+  }
+  EXPECT_FALSE(q.TryPush(8));
+  EXPECT_EQ(q.Size(), 8u);
+  int tmp;
+  for (int i = 0; i < 8; ++i) {
+    ASSERT_TRUE(q.TryPop(tmp));
+    EXPECT_EQ(tmp, i);
+  }
+  EXPECT_FALSE(q.TryPop(tmp));
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(q.WaitAndTryPop(tmp, std::chrono::microseconds(20000)));
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::microseconds(20000));
+
+  std::thread producer([&q]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    q.Push(100);
+  });
+  EXPECT_TRUE(q.WaitAndTryPop(tmp, std::chrono::microseconds(1000000)));
+  EXPECT_EQ(tmp, 100);
+  producer.join();
+
+  // Push blocks while queue is full
+  for (int i = 0; i < 8; ++i) q.Push(i);
+  std::atomic<bool> pushed{false};
+  producer = std::thread([&q, &pushed]() {
+    q.Emplace(8);
+    pushed.store(true);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_FALSE(pushed.load());
+  ASSERT_TRUE(q.TryPop(tmp));
+  producer.join();
+  EXPECT_TRUE(pushed.load());
+  EXPECT_EQ(q.Size(), 8u);
+}
+
+TEST(InferServerUtil, PriorityBandQueue) {
+  struct BandOf {
+    size_t operator()(int v) const { return v / 10; }
+  };
+  // small band capacity to test overflow
+  infer_server::PriorityBandQueue<int, BandOf, 16> q(2);
+  std::vector<int> vec = {3, 1, 15, 2, 4, 38, 36, 39, 11, 0, 250};
+  for (auto v : vec) q.Push(v);
+  EXPECT_EQ(q.Size(), vec.size());
+  std::vector<int> res;
+  int tmp;
+  while (q.TryPop(tmp)) res.push_back(tmp);
+  EXPECT_TRUE(q.Empty());
+  // higher band first, FIFO in the same band, band out of range is put into the highest band
+  std::vector<int> expect = {250, 38, 36, 39, 15, 11, 3, 1, 2, 4, 0};
+  EXPECT_EQ(res, expect);
+
+  // tasks are put into bands by major priority
+  infer_server::PriorityBandQueue<infer_server::Task, infer_server::Task::Band> task_q;
+  std::vector<int64_t> priorities = {0, -5, int64_t(10) << 56, (int64_t(20) << 56) - 3, int64_t(90) << 56};
+  for (auto p : priorities) task_q.Emplace([]() {}, p);
+  std::vector<int64_t> popped;
+  infer_server::Task t;
+  while (task_q.TryPop(t)) popped.push_back(t.priority);
+  std::vector<int64_t> expect_prio = {int64_t(90) << 56, (int64_t(20) << 56) - 3, int64_t(10) << 56, 0, -5};
+  EXPECT_EQ(popped, expect_prio);
+}
+
+TEST(InferServerUtil, BandPriorityThreadPool) {
+  infer_server::BandPriorityThreadPool tp(nullptr, 4);
+  std::atomic<int> sum{0};
+  std::vector<std::future<void>> ret;
+  for (int i = 0; i < 1000; ++i) {
+    ret.emplace_back(tp.Push(int64_t(i % 10) << 56, [&sum](int n) { sum += n; }, i));
+  }
+  for (auto& it : ret) it.get();
+  EXPECT_EQ(sum.load(), 999 * 1000 / 2);
+}
+
+namespace {
+
+// push `total` elements by `producer_num` threads and pop by `consumer_num` threads, return million ops per second
+template <typename Q>
+double QueueContention(Q* q, int producer_num, int consumer_num, int total) {
+  std::atomic<int> popped{0};
+  std::atomic<int64_t> sum{0};
+  std::vector<std::thread> threads;
+  auto start = std::chrono::steady_clock::now();
+  for (int p = 0; p < producer_num; ++p) {
+    threads.emplace_back([q, p, producer_num, total]() {
+      for (int i = p; i < total; i += producer_num) q->Push(i);
+    });
+  }
+  for (int c = 0; c < consumer_num; ++c) {
+    threads.emplace_back([q, &popped, &sum, total]() {
+      int v;
+      while (popped.load(std::memory_order_relaxed) < total) {
+        if (q->WaitAndTryPop(v, std::chrono::microseconds(1000))) {
+          sum += v;
+          ++popped;
+        }
+      }
+    });
+  }
+  for (auto& th : threads) th.join();
+  std::chrono::duration<double, std::micro> dura = std::chrono::steady_clock::now() - start;
+  EXPECT_EQ(sum.load(), int64_t(total) * (total - 1) / 2);
+  return total / dura.count();
+}
+
+struct IntBand {
+  size_t operator()(int v) const { return v % 8; }
+};
+
+}  // namespace
+
+// benchmark, run with --gtest_also_run_disabled_tests
+TEST(InferServerUtil, DISABLED_QueueContentionBenchmark) {
+  constexpr int total = 200000;
+  for (int n : {2, 4, 8, 16, 32, 64}) {
+    infer_server::TSQueue<int> ts_q;
+    infer_server::MpmcRingQueue<int> ring_q(1024);
+    infer_server::TSPriorityQueue<int> ts_pq;
+    infer_server::PriorityBandQueue<int, IntBand, 8> band_q;
+    double ts = QueueContention(&ts_q, n, n, total);
+    double ring = QueueContention(&ring_q, n, n, total);
+    double ts_prio = QueueContention(&ts_pq, n, n, total);
+    double band = QueueContention(&band_q, n, n, total);
+    LOG(INFO) << "[EasyDK Tests] [InferServer] " << n << " producers / " << n << " consumers (Mops/s):"
+              << " TSQueue " << ts << ", MpmcRingQueue " << ring << ", TSPriorityQueue " << ts_prio
+              << ", PriorityBandQueue " << band;
+  }
+}
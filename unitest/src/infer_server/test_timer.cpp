@@ -21,11 +21,13 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <chrono>
 #include <future>
 #include <string>
 #include <thread>
 
+#include "cnedk_stream_timing.hpp"
 #include "util/timer.h"
 
 TEST(InferServerUtil, Timer) {
@@ -84,3 +86,50 @@ TEST(InferServerUtil, Timer) {
   EXPECT_GE(dura.count(), wait_time);
   EXPECT_NEAR(dura.count(), wait_time, 1);
 }
+
+TEST(InferServerUtil, TimerVirtualClock) {
+  cnedk::VirtualClock clock;
+  cnedk::Clock::SetDefault(&clock);
+  int once = 0, every = 0;
+  infer_server::Timer t1, t2;
+  EXPECT_TRUE(t1.NotifyAfter(10, [&once]() { ++once; }));
+  EXPECT_TRUE(t2.NotifyEvery(4, [&every]() { ++every; }));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_EQ(0, once);
+  EXPECT_EQ(0, every);
+  // notified synchronously by the thread moving the clock
+  clock.AdvanceUs(9999);
+  EXPECT_EQ(0, once);
+  EXPECT_EQ(2, every);
+  clock.AdvanceUs(1);
+  EXPECT_EQ(1, once);
+  EXPECT_TRUE(t1.Idle());
+  clock.SleepUntilUs(20000);
+  EXPECT_EQ(1, once);
+  EXPECT_EQ(5, every);
+  t2.Cancel();
+  clock.AdvanceUs(10000);
+  EXPECT_EQ(5, every);
+  cnedk::Clock::SetDefault(nullptr);
+}
+
+TEST(InferServerUtil, TimerVirtualClockReplaced) {
+  cnedk::VirtualClock clock;
+  cnedk::Clock::SetDefault(&clock);
+  std::atomic<int> once{0}, every{0};
+  infer_server::Timer t1, t2;
+  EXPECT_TRUE(t1.NotifyAfter(30, [&once]() { ++once; }));
+  EXPECT_TRUE(t2.NotifyEvery(10, [&every]() { ++every; }));
+  clock.AdvanceUs(20000);
+  EXPECT_EQ(0, once.load());
+  EXPECT_EQ(2, every.load());
+  // pending events are fired by wall clock with the time left, instead of hanging on the replaced clock
+  cnedk::Clock::SetDefault(nullptr);
+  clock.AdvanceUs(100000);
+  EXPECT_EQ(0, once.load());
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_EQ(1, once.load());
+  EXPECT_TRUE(t1.Idle());
+  EXPECT_GE(every.load(), 4);
+  t2.Cancel();
+}
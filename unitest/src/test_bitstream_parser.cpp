@@ -0,0 +1,225 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "bitstream_parser.hpp"
+
+namespace {
+
+using cnedk::AccessUnitInfo;
+using cnedk::BitstreamParser;
+using cnedk::NalUnit;
+using cnedk::SliceType;
+using cnedk::SpsInfo;
+
+std::vector<uint8_t> ReadFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+// Groups NAL units into access units, each one starts with parameter sets or the first slice of a picture
+std::vector<std::vector<uint8_t>> SplitAccessUnits(const std::vector<uint8_t> &stream, bool hevc) {
+  std::vector<NalUnit> nalus;
+  cnedk::SplitAnnexB(stream.data(), stream.size(), &nalus);
+  std::vector<std::vector<uint8_t>> units;
+  bool has_slice = false;
+  for (const auto &nalu : nalus) {
+    bool slice = cnedk::IsSliceNal(nalu, hevc);
+    // first_mb_in_slice is 0 or first_slice_segment_in_pic_flag is set
+    bool first_slice = slice && (nalu.data[hevc ? 2 : 1] & 0x80);
+    if (units.empty() || (has_slice && (!slice || first_slice))) {
+      units.emplace_back();
+      has_slice = false;
+    }
+    static const uint8_t kStartCode[] = {0, 0, 0, 1};
+    units.back().insert(units.back().end(), kStartCode, kStartCode + 4);
+    units.back().insert(units.back().end(), nalu.data, nalu.data + nalu.size);
+    has_slice = has_slice || slice;
+  }
+  return units;
+}
+
+struct StreamSummary {
+  std::vector<SliceType> slice_types;
+  std::vector<bool> key_frames;
+  std::vector<bool> format_changes;
+};
+
+StreamSummary ParseStream(BitstreamParser *parser, const std::vector<std::vector<uint8_t>> &units) {
+  StreamSummary summary;
+  for (const auto &unit : units) {
+    AccessUnitInfo info;
+    EXPECT_TRUE(parser->Parse(unit.data(), unit.size(), &info));
+    summary.slice_types.push_back(info.slice_type);
+    summary.key_frames.push_back(info.key_frame);
+    summary.format_changes.push_back(info.format_changed);
+  }
+  return summary;
+}
+
+}  // namespace
+
+TEST(BitstreamParser, SplitAnnexB) {
+  // 4-byte and 3-byte start codes, trailing zeros belong to the next start code
+  const uint8_t stream[] = {0, 0, 0, 1, 0x67, 0x42, 0, 0, 1, 0x68, 0xce, 0, 0, 0, 0, 1, 0x65, 0x88};
+  std::vector<NalUnit> nalus;
+  cnedk::SplitAnnexB(stream, sizeof(stream), &nalus);
+  ASSERT_EQ(nalus.size(), 3u);
+  EXPECT_EQ(nalus[0].size, 2u);
+  EXPECT_EQ(nalus[1].size, 2u);
+  EXPECT_EQ(nalus[2].size, 2u);
+  EXPECT_EQ(cnedk::GetNalType(nalus[0], false), 7);
+  EXPECT_TRUE(cnedk::IsParamSetNal(nalus[1], false));
+  EXPECT_TRUE(cnedk::IsKeyNal(nalus[2], false));
+  EXPECT_TRUE(cnedk::IsSliceNal(nalus[2], false));
+
+  // emulation prevention bytes are removed
+  const uint8_t nal[] = {0x00, 0x00, 0x03, 0x01, 0x00, 0x00, 0x03};
+  std::vector<uint8_t> expected = {0x00, 0x00, 0x01, 0x00, 0x00};
+  EXPECT_EQ(cnedk::ToRbsp(nal, sizeof(nal)), expected);
+}
+
+TEST(BitstreamParser, ExpGolomb) {
+  // 1 | 010 | 011 | 00100 | 00101 | 000010000 | 111 | 010
+  const uint8_t data[] = {0xa6, 0x42, 0x84, 0x3a};
+  cnedk::BitReader br(data, sizeof(data));
+  EXPECT_EQ(br.ReadUe(), 0u);
+  EXPECT_EQ(br.ReadUe(), 1u);
+  EXPECT_EQ(br.ReadSe(), -1);
+  EXPECT_EQ(br.ReadSe(), 2);
+  EXPECT_EQ(br.ReadSe(), -2);
+  EXPECT_EQ(br.ReadUe(), 15u);
+  EXPECT_EQ(br.ReadBits(3), 7u);
+  EXPECT_EQ(br.ReadUe(), 1u);
+  EXPECT_FALSE(br.Error());
+  EXPECT_EQ(br.BitsLeft(), 0u);
+  br.ReadFlag();
+  EXPECT_TRUE(br.Error());
+}
+
+TEST(BitstreamParser, H264) {
+  auto units = SplitAccessUnits(ReadFile("../../unitest/data/img.h264"), false);
+  ASSERT_EQ(units.size(), 5u);
+  BitstreamParser parser(false);
+  StreamSummary summary = ParseStream(&parser, units);
+  std::vector<SliceType> types = {SliceType::I, SliceType::P, SliceType::P, SliceType::P, SliceType::P};
+  EXPECT_EQ(summary.slice_types, types);
+  EXPECT_EQ(summary.key_frames, std::vector<bool>({true, false, false, false, false}));
+
+  const SpsInfo *sps = parser.GetSps();
+  ASSERT_NE(sps, nullptr);
+  EXPECT_EQ(sps->profile_idc, 100);
+  EXPECT_EQ(sps->level_idc, 13);
+  EXPECT_EQ(sps->width, 256);
+  EXPECT_EQ(sps->height, 256);
+  EXPECT_EQ(sps->chroma_format_idc, 1);
+  EXPECT_EQ(sps->bit_depth_luma, 8);
+  EXPECT_TRUE(sps->progressive);
+  EXPECT_TRUE(sps->timing_info_present);
+  EXPECT_DOUBLE_EQ(sps->frame_rate, 25);
+}
+
+TEST(BitstreamParser, H264Cropping) {
+  auto units = SplitAccessUnits(ReadFile("../../unitest/data/1080p.h264"), false);
+  ASSERT_EQ(units.size(), 5u);
+  BitstreamParser parser(false);
+  AccessUnitInfo info;
+  ASSERT_TRUE(parser.Parse(units[0].data(), units[0].size(), &info));
+  EXPECT_TRUE(info.key_frame);
+  EXPECT_TRUE(info.has_param_sets);
+  EXPECT_EQ(info.slice_type, SliceType::I);
+
+  const SpsInfo *sps = parser.GetSps();
+  ASSERT_NE(sps, nullptr);
+  EXPECT_EQ(sps->profile_idc, 77);
+  EXPECT_EQ(sps->level_idc, 41);
+  EXPECT_EQ(sps->coded_width, 1920);
+  EXPECT_EQ(sps->coded_height, 1088);
+  EXPECT_EQ(sps->crop_bottom, 8);
+  EXPECT_EQ(sps->width, 1920);
+  EXPECT_EQ(sps->height, 1080);
+  EXPECT_DOUBLE_EQ(sps->frame_rate, 30);
+}
+
+TEST(BitstreamParser, Hevc) {
+  auto units = SplitAccessUnits(ReadFile("../../unitest/data/img.hevc"), true);
+  ASSERT_EQ(units.size(), 5u);
+  BitstreamParser parser(true);
+  StreamSummary summary = ParseStream(&parser, units);
+  // in decoding order, the B-frame is displayed before the P-frame in front of it
+  std::vector<SliceType> types = {SliceType::I, SliceType::I, SliceType::P, SliceType::B, SliceType::P};
+  EXPECT_EQ(summary.slice_types, types);
+  EXPECT_EQ(summary.key_frames, std::vector<bool>({true, false, false, false, false}));
+
+  const SpsInfo *sps = parser.GetSps();
+  ASSERT_NE(sps, nullptr);
+  EXPECT_EQ(sps->profile_idc, 1);
+  EXPECT_EQ(sps->level_idc, 60);
+  EXPECT_EQ(sps->width, 256);
+  EXPECT_EQ(sps->height, 256);
+  EXPECT_EQ(sps->chroma_format_idc, 1);
+  EXPECT_TRUE(sps->progressive);
+
+  cnedk::VpsInfo vps;
+  std::vector<NalUnit> nalus;
+  cnedk::SplitAnnexB(units[0].data(), units[0].size(), &nalus);
+  ASSERT_EQ(cnedk::GetNalType(nalus[0], true), 32);
+  ASSERT_TRUE(cnedk::ParseHevcVps(nalus[0], &vps));
+  EXPECT_EQ(vps.id, sps->vps_id);
+  EXPECT_EQ(vps.profile_idc, 1);
+}
+
+TEST(BitstreamParser, FormatChange) {
+  auto units = SplitAccessUnits(ReadFile("../../unitest/data/img.h264"), false);
+  auto units_1080p = SplitAccessUnits(ReadFile("../../unitest/data/1080p.h264"), false);
+  units.insert(units.end(), units_1080p.begin(), units_1080p.end());
+  units.insert(units.end(), units_1080p.begin(), units_1080p.end());
+  BitstreamParser parser(false);
+  StreamSummary summary = ParseStream(&parser, units);
+  std::vector<bool> expected(units.size(), false);
+  expected[5] = true;
+  EXPECT_EQ(summary.format_changes, expected);
+  ASSERT_NE(parser.GetSps(), nullptr);
+  EXPECT_EQ(parser.GetSps()->height, 1080);
+}
+
+TEST(BitstreamParser, Malformed) {
+  auto units = SplitAccessUnits(ReadFile("../../unitest/data/img.h264"), false);
+  ASSERT_FALSE(units.empty());
+  std::vector<NalUnit> nalus;
+  cnedk::SplitAnnexB(units[0].data(), units[0].size(), &nalus);
+  ASSERT_EQ(cnedk::GetNalType(nalus[0], false), 7);
+  // SPS is cut before the resolution
+  NalUnit truncated = {nalus[0].data, 6};
+  SpsInfo sps;
+  EXPECT_FALSE(cnedk::ParseH264Sps(truncated, &sps));
+
+  // a slice without parameter sets can not be activated
+  BitstreamParser parser(false);
+  AccessUnitInfo info;
+  EXPECT_FALSE(parser.Parse(units[1].data(), units[1].size(), &info));
+  EXPECT_EQ(parser.GetSps(), nullptr);
+}
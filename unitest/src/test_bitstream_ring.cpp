@@ -0,0 +1,172 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "cnedk_encode.h"
+
+#include "bitstream_ring.hpp"
+
+namespace {
+
+void FillSlice(cnedk::BitstreamSlice* slice, uint8_t seed) {
+  for (size_t i = 0; i < slice->size; ++i) slice->data[i] = static_cast<uint8_t>(seed + i);
+}
+
+bool CheckSlice(const cnedk::BitstreamSlice* slice, uint8_t seed) {
+  for (size_t i = 0; i < slice->size; ++i) {
+    if (slice->data[i] != static_cast<uint8_t>(seed + i)) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+TEST(BitstreamRing, Wraparound) {
+  auto ring = cnedk::BitstreamRing::Create(1024);
+  ASSERT_TRUE(ring);
+  EXPECT_EQ(ring->GetStats().capacity, 1024u);
+
+  cnedk::BitstreamSlice* a = ring->Alloc(400);
+  cnedk::BitstreamSlice* b = ring->Alloc(400);
+  ASSERT_TRUE(a && b);
+  FillSlice(a, 1);
+  FillSlice(b, 2);
+  EXPECT_EQ(ring->GetStats().fallback_count, 0u);
+  // free space at tail is not enough, and head is still in use
+  cnedk::BitstreamSlice* c = ring->Alloc(300);
+  ASSERT_TRUE(c);
+  EXPECT_EQ(ring->GetStats().fallback_count, 1u);
+  cnedk::BitstreamRing::Release(c);
+
+  // head is free now, next slice wraps to the beginning
+  cnedk::BitstreamRing::Release(a);
+  c = ring->Alloc(300);
+  ASSERT_TRUE(c);
+  EXPECT_EQ(ring->GetStats().wrap_count, 1u);
+  EXPECT_EQ(ring->GetStats().fallback_count, 1u);
+  FillSlice(c, 3);
+  EXPECT_TRUE(CheckSlice(b, 2));
+  EXPECT_TRUE(CheckSlice(c, 3));
+  EXPECT_EQ(ring->GetStats().in_flight, 2u);
+
+  cnedk::BitstreamRing::Release(b);
+  cnedk::BitstreamRing::Release(c);
+  auto stats = ring->GetStats();
+  EXPECT_EQ(stats.in_flight, 0u);
+  EXPECT_EQ(stats.used, 0u);
+
+  // packet larger than ring
+  cnedk::BitstreamSlice* large = ring->Alloc(4096);
+  ASSERT_TRUE(large);
+  FillSlice(large, 4);
+  EXPECT_TRUE(CheckSlice(large, 4));
+  EXPECT_EQ(ring->GetStats().fallback_count, 2u);
+  cnedk::BitstreamRing::Release(large);
+}
+
+TEST(BitstreamRing, Retention) {
+  auto ring = cnedk::BitstreamRing::Create(4096);
+  ASSERT_TRUE(ring);
+  std::weak_ptr<cnedk::BitstreamRing> weak_ring = ring;
+
+  cnedk::BitstreamSlice* slice = ring->Alloc(1000);
+  ASSERT_TRUE(slice);
+  FillSlice(slice, 10);
+  CnedkVEncFrameBits frame_bits;
+  memset(&frame_bits, 0, sizeof(frame_bits));
+  frame_bits.bits = slice->data;
+  frame_bits.len = slice->size;
+
+  // retained by user, then released by encoder
+  ASSERT_EQ(CnedkVencRetainFrameBits(&frame_bits), 0);
+  cnedk::BitstreamRing::Release(slice);
+  EXPECT_EQ(ring->GetStats().in_flight, 1u);
+
+  // retained slice keeps ring and data alive after owner is gone
+  ring.reset();
+  EXPECT_FALSE(weak_ring.expired());
+  EXPECT_TRUE(CheckSlice(slice, 10));
+  ASSERT_EQ(CnedkVencReleaseFrameBits(&frame_bits), 0);
+  EXPECT_TRUE(weak_ring.expired());
+
+  // released frame bits are not found any more
+  EXPECT_NE(CnedkVencRetainFrameBits(&frame_bits), 0);
+  CnedkVEncFrameBits invalid;
+  memset(&invalid, 0, sizeof(invalid));
+  EXPECT_NE(CnedkVencRetainFrameBits(&invalid), 0);
+  EXPECT_NE(CnedkVencReleaseFrameBits(&invalid), 0);
+  EXPECT_NE(CnedkVencRetainFrameBits(nullptr), 0);
+}
+
+TEST(BitstreamRing, Fragmentation) {
+  constexpr size_t kMaxPacketSize = 32 * 1024;
+  constexpr int kMaxHoldCount = 8;
+  // enough for packets held at a time and the skipped tail on wraparound
+  auto ring = cnedk::BitstreamRing::Create(kMaxPacketSize * (kMaxHoldCount + 2));
+  ASSERT_TRUE(ring);
+
+  std::mt19937 gen(1234);
+  std::uniform_int_distribution<size_t> size_dist(1, kMaxPacketSize);
+  std::uniform_int_distribution<int> hold_dist(0, kMaxHoldCount - 1);
+  struct Held {
+    cnedk::BitstreamSlice* slice;
+    uint8_t seed;
+    int deadline;
+  };
+  std::vector<Held> held;
+
+  for (int i = 0; i < 20000; ++i) {
+    cnedk::BitstreamSlice* slice = ring->Alloc(size_dist(gen));
+    ASSERT_TRUE(slice);
+    uint8_t seed = static_cast<uint8_t>(i);
+    FillSlice(slice, seed);
+    held.push_back({slice, seed, i + hold_dist(gen)});
+    // each slice is kept for a few packets, and released out of order
+    std::shuffle(held.begin(), held.end(), gen);
+    for (auto it = held.begin(); it != held.end();) {
+      if (it->deadline > i) {
+        ++it;
+        continue;
+      }
+      ASSERT_TRUE(CheckSlice(it->slice, it->seed)) << "slice data is overwritten";
+      cnedk::BitstreamRing::Release(it->slice);
+      it = held.erase(it);
+    }
+  }
+  for (auto& it : held) {
+    ASSERT_TRUE(CheckSlice(it.slice, it.seed));
+    cnedk::BitstreamRing::Release(it.slice);
+  }
+
+  auto stats = ring->GetStats();
+  EXPECT_EQ(stats.in_flight, 0u);
+  EXPECT_EQ(stats.used, 0u);
+  EXPECT_GT(stats.wrap_count, 0u);
+  // space of out of order released slices is reclaimed, the ring never runs out
+  EXPECT_EQ(stats.fallback_count, 0u);
+}
@@ -20,6 +20,9 @@
 
 #include <gtest/gtest.h>
 
+#include <sys/wait.h>
+#include <unistd.h>
+
 #include <algorithm>
 #include <memory>
 #include <numeric>
@@ -29,6 +32,7 @@
 #include "cnrt.h"
 
 #include "cnedk_buf_surface.h"
+#include "cnedk_buf_surface_shm.h"
 #include "cnedk_platform.h"
 
 #include "test_base.h"
@@ -374,6 +378,49 @@ TEST(BufSurface, Copy) {
   ASSERT_EQ(CnedkBufSurfaceDestroy(dst_surf), 0);
 }
 
+TEST(BufSurface, CopyDifferentPitch) {
+  for (auto& fmt : g_fmts) {
+    CnedkBufSurfaceCreateParams create_params;
+    memset(&create_params, 0, sizeof(create_params));
+    create_params.device_id = device_id;
+    create_params.batch_size = 1;
+    create_params.width = 1918;
+    create_params.height = 1078;
+    create_params.color_format = fmt;
+    create_params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+
+    CnedkBufSurface* src_surf;
+    ASSERT_EQ(CnedkBufSurfaceCreate(&src_surf, &create_params), 0);
+    create_params.force_align_1 = true;
+    CnedkBufSurface* dst_surf;
+    ASSERT_EQ(CnedkBufSurfaceCreate(&dst_surf, &create_params), 0);
+
+    CnedkBufSurfaceParams& src = src_surf->surface_list[0];
+    CnedkBufSurfaceParams& dst = dst_surf->surface_list[0];
+    ASSERT_EQ(src.plane_params.num_planes, dst.plane_params.num_planes);
+    for (uint32_t i = 0; i < src.plane_params.num_planes; ++i) {
+      uint8_t* plane = static_cast<uint8_t*>(src.data_ptr) + src.plane_params.offset[i];
+      for (uint32_t h = 0; h < src.plane_params.height[i]; ++h) {
+        memset(plane + h * src.plane_params.pitch[i], (h + i) % 256, src.plane_params.pitch[i]);
+      }
+    }
+    ASSERT_EQ(CnedkBufSurfaceCopy(src_surf, dst_surf), 0);
+
+    for (uint32_t i = 0; i < dst.plane_params.num_planes; ++i) {
+      uint32_t row_bytes = dst.plane_params.width[i] * dst.plane_params.bytes_per_pix[i];
+      EXPECT_EQ(dst.plane_params.pitch[i], row_bytes);
+      uint8_t* plane = static_cast<uint8_t*>(dst.data_ptr) + dst.plane_params.offset[i];
+      for (uint32_t h = 0; h < dst.plane_params.height[i]; ++h) {
+        uint8_t* row = plane + h * dst.plane_params.pitch[i];
+        ASSERT_TRUE(std::all_of(row, row + row_bytes, [h, i](uint8_t v) { return v == (h + i) % 256; }))
+            << "format: " << fmt << ", plane: " << i << ", row: " << h;
+      }
+    }
+    ASSERT_EQ(CnedkBufSurfaceDestroy(src_surf), 0);
+    ASSERT_EQ(CnedkBufSurfaceDestroy(dst_surf), 0);
+  }
+}
+
 TEST(BufSurface, Memset) {
   {
     CnedkBufSurface temp_surf;
@@ -460,3 +507,108 @@ TEST(BufSurface, Memset) {
     delete[] cpu_data;
   }
 }
+
+TEST(BufSurface, PoolRecycleStamps) {
+  CnedkBufSurfaceCreateParams create_params;
+  memset(&create_params, 0, sizeof(create_params));
+  create_params.device_id = device_id;
+  create_params.batch_size = 1;
+  create_params.width = 320;
+  create_params.height = 240;
+  create_params.color_format = CNEDK_BUF_COLOR_FORMAT_NV12;
+  create_params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  void* pool = nullptr;
+  ASSERT_EQ(CnedkBufPoolCreate(&pool, &create_params, 1), 0);
+  CnedkBufSurface* surf = nullptr;
+  ASSERT_EQ(CnedkBufSurfaceCreateFromPool(&surf, pool), 0);
+  CnedkBufSurfaceSetGeneration(surf, 3);
+  CnedkBufSurfaceSetCaptureTime(surf, 1000);
+  ASSERT_EQ(CnedkBufSurfaceDestroy(surf), 0);
+
+  // the only block of the pool is allocated again without the stamps of the previous frame
+  ASSERT_EQ(CnedkBufSurfaceCreateFromPool(&surf, pool), 0);
+  EXPECT_EQ(CnedkBufSurfaceGetGeneration(surf), 0u);
+  EXPECT_EQ(CnedkBufSurfaceGetCaptureTime(surf), 0u);
+  ASSERT_EQ(CnedkBufSurfaceDestroy(surf), 0);
+  ASSERT_EQ(CnedkBufPoolDestroy(pool), 0);
+}
+
+TEST(BufSurface, Shared) {
+  CnedkBufSurfaceCreateParams create_params;
+  memset(&create_params, 0, sizeof(create_params));
+  create_params.device_id = device_id;
+  create_params.batch_size = 2;
+  create_params.width = 1920;
+  create_params.height = 1080;
+  create_params.color_format = CNEDK_BUF_COLOR_FORMAT_NV12;
+  create_params.mem_type = CNEDK_BUF_MEM_DEVICE;
+  CnedkBufSurface* surf = nullptr;
+  EXPECT_NE(CnedkBufSurfaceCreateShared(&surf, &create_params), 0);
+
+  create_params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  ASSERT_EQ(CnedkBufSurfaceCreateShared(&surf, &create_params), 0);
+  CnedkBufSurfaceShmHandle handle;
+  ASSERT_EQ(CnedkBufSurfaceGetShmHandle(surf, &handle), 0);
+  std::string shm_path = std::string("/dev/shm") + handle.name;
+
+  CnedkBufSurface* opened = nullptr;
+  ASSERT_EQ(CnedkBufSurfaceOpenShared(&opened, &handle), 0);
+  ASSERT_EQ(opened->batch_size, surf->batch_size);
+  EXPECT_EQ(opened->surface_list[1].data_size, surf->surface_list[1].data_size);
+  EXPECT_EQ(opened->surface_list[1].plane_params.num_planes, 2u);
+  ASSERT_EQ(CnedkBufSurfaceMemSet(opened, 1, 1, 0x5a), 0);
+  uint8_t* uv = reinterpret_cast<uint8_t*>(surf->surface_list[1].data_ptr) +
+                surf->surface_list[1].plane_params.offset[1];
+  EXPECT_EQ(uv[0], 0x5a);
+  EXPECT_EQ(uv[surf->surface_list[1].plane_params.psize[1] - 1], 0x5a);
+
+  // the last holder removes the shared memory
+  ASSERT_EQ(CnedkBufSurfaceDestroy(surf), 0);
+  EXPECT_EQ(access(shm_path.c_str(), F_OK), 0);
+  ASSERT_EQ(CnedkBufSurfaceDestroy(opened), 0);
+  EXPECT_NE(access(shm_path.c_str(), F_OK), 0);
+  EXPECT_NE(CnedkBufSurfaceOpenShared(&opened, &handle), 0);
+
+  CnedkBufSurface* not_shared = nullptr;
+  ASSERT_EQ(CnedkBufSurfaceCreate(&not_shared, &create_params), 0);
+  EXPECT_NE(CnedkBufSurfaceGetShmHandle(not_shared, &handle), 0);
+  ASSERT_EQ(CnedkBufSurfaceDestroy(not_shared), 0);
+}
+
+TEST(BufSurface, SharedFork) {
+  CnedkBufSurfaceCreateParams create_params;
+  memset(&create_params, 0, sizeof(create_params));
+  create_params.device_id = device_id;
+  create_params.batch_size = 1;
+  create_params.width = 64;
+  create_params.height = 64;
+  create_params.color_format = CNEDK_BUF_COLOR_FORMAT_GRAY8;
+  create_params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  CnedkBufSurface* surf = nullptr;
+  ASSERT_EQ(CnedkBufSurfaceCreateShared(&surf, &create_params), 0);
+  CnedkBufSurfaceShmHandle handle;
+  ASSERT_EQ(CnedkBufSurfaceGetShmHandle(surf, &handle), 0);
+  std::string shm_path = std::string("/dev/shm") + handle.name;
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    // the inherited surface is held by the child, after the parent destroys its own
+    char c;
+    close(fds[1]);
+    int ret = read(fds[0], &c, 1) == 1 && access(shm_path.c_str(), F_OK) == 0 &&
+              CnedkBufSurfaceDestroy(surf) == 0 && access(shm_path.c_str(), F_OK) != 0 ? 0 : 1;
+    _exit(ret);
+  }
+  close(fds[0]);
+  ASSERT_EQ(CnedkBufSurfaceDestroy(surf), 0);
+  ASSERT_EQ(write(fds[1], "x", 1), 1);
+  close(fds[1]);
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  EXPECT_EQ(WEXITSTATUS(status), 0);
+  EXPECT_NE(access(shm_path.c_str(), F_OK), 0);
+}
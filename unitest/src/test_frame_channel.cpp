@@ -0,0 +1,185 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "glog/logging.h"
+
+#include "cnedk_frame_channel.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Sleeps for `us` microseconds, busy waits for short durations to emulate high rates
+void Pace(int64_t us) {
+  if (us <= 0) return;
+  if (us >= 1000) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+    return;
+  }
+  auto end = Clock::now() + std::chrono::microseconds(us);
+  while (Clock::now() < end) {}
+}
+
+// Produces `count` increasing numbers with an EOS after every `eos_interval` numbers, checks the order in consumer
+void RunStress(size_t capacity, int count, int eos_interval, int64_t produce_us, int64_t consume_us) {
+  cnedk::SpscChannel<uint64_t> channel(capacity);
+  std::thread producer([&]() {
+    for (int i = 0; i < count; ++i) {
+      ASSERT_TRUE(channel.Push(i));
+      if ((i + 1) % eos_interval == 0) {
+        ASSERT_TRUE(channel.PushEos());
+      }
+      Pace(produce_us);
+    }
+    channel.Close();
+  });
+
+  uint64_t expected = 0;
+  int eos_count = 0;
+  while (true) {
+    uint64_t value = 0;
+    cnedk::ChannelStatus status = channel.Pop(&value, std::chrono::milliseconds(100));
+    if (status == cnedk::ChannelStatus::CLOSED) break;
+    if (status == cnedk::ChannelStatus::TIMEOUT) continue;
+    if (status == cnedk::ChannelStatus::EOS) {
+      // EOS is in order with elements
+      EXPECT_EQ(expected % eos_interval, 0u);
+      ++eos_count;
+      continue;
+    }
+    ASSERT_EQ(value, expected);
+    ++expected;
+    Pace(consume_us);
+  }
+  producer.join();
+  EXPECT_EQ(expected, static_cast<uint64_t>(count));
+  EXPECT_EQ(eos_count, count / eos_interval);
+  EXPECT_TRUE(channel.Empty());
+}
+
+}  // namespace
+
+TEST(SpscChannel, Basic) {
+  cnedk::SpscChannel<int> channel(2);
+  EXPECT_EQ(channel.Capacity(), 2u);
+  int value = 0;
+  EXPECT_EQ(channel.TryPop(&value), cnedk::ChannelStatus::TIMEOUT);
+  EXPECT_TRUE(channel.TryPush(1));
+  EXPECT_TRUE(channel.PushEos());
+  EXPECT_FALSE(channel.TryPush(2));
+  EXPECT_EQ(channel.Size(), 2u);
+
+  EXPECT_EQ(channel.Pop(&value), cnedk::ChannelStatus::OK);
+  EXPECT_EQ(value, 1);
+  EXPECT_EQ(channel.Pop(&value), cnedk::ChannelStatus::EOS);
+
+  auto start = Clock::now();
+  EXPECT_EQ(channel.Pop(&value, std::chrono::milliseconds(20)), cnedk::ChannelStatus::TIMEOUT);
+  EXPECT_GE(Clock::now() - start, std::chrono::milliseconds(20));
+
+  // still usable after EOS, elements are drained after close
+  EXPECT_TRUE(channel.Push(3));
+  channel.Close();
+  EXPECT_TRUE(channel.Closed());
+  EXPECT_FALSE(channel.Push(4));
+  EXPECT_FALSE(channel.PushEos());
+  EXPECT_EQ(channel.Pop(&value), cnedk::ChannelStatus::OK);
+  EXPECT_EQ(value, 3);
+  EXPECT_EQ(channel.Pop(&value), cnedk::ChannelStatus::CLOSED);
+  EXPECT_EQ(channel.TryPop(&value), cnedk::ChannelStatus::CLOSED);
+}
+
+TEST(SpscChannel, CloseWakesWaiters) {
+  cnedk::SpscChannel<int> channel(1);
+  std::thread consumer([&]() {
+    int value = 0;
+    EXPECT_EQ(channel.Pop(&value), cnedk::ChannelStatus::CLOSED);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  channel.Close();
+  consumer.join();
+
+  cnedk::SpscChannel<int> full(1);
+  ASSERT_TRUE(full.Push(0));
+  std::thread producer([&]() { EXPECT_FALSE(full.Push(1)); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  full.Close();
+  producer.join();
+}
+
+TEST(SpscChannel, StressRates) {
+  // fast producer and slow consumer, the producer is blocked while channel is full
+  RunStress(4, 2000, 100, 0, 50);
+  // slow producer and fast consumer, the consumer is parked while channel is empty
+  RunStress(4, 500, 50, 1000, 0);
+  // comparable rates
+  RunStress(16, 20000, 1000, 5, 5);
+  // no pacing, capacity of one element
+  RunStress(1, 100000, 10000, 0, 0);
+}
+
+TEST(FrameChannel, DecoderCallbacks) {
+  cnedk::FrameChannel channel(4);
+  EXPECT_EQ(cnedk::FrameChannel::OnEos(&channel), 0);
+  CnedkBufSurface *surf = nullptr;
+  EXPECT_EQ(channel.Pop(&surf), cnedk::ChannelStatus::EOS);
+  channel.Close();
+  EXPECT_EQ(cnedk::FrameChannel::OnEos(&channel), -1);
+  EXPECT_EQ(cnedk::FrameChannel::OnFrame(nullptr, &channel), -1);
+}
+
+TEST(SpscChannel, HandoffLatency) {
+  constexpr int kCount = 2000;
+  // bound is far above the expected latency, it only catches consumers left parked after a push
+  constexpr int64_t kMaxP99Ns = 50 * 1000 * 1000;
+  for (int64_t interval_us : {0, 100}) {
+    cnedk::SpscChannel<Clock::time_point> channel(64);
+    std::vector<int64_t> latencies;
+    latencies.reserve(kCount);
+    std::thread producer([&]() {
+      for (int i = 0; i < kCount; ++i) {
+        channel.Push(Clock::now());
+        Pace(interval_us);
+      }
+      channel.Close();
+    });
+    Clock::time_point sent, last;
+    while (channel.Pop(&sent) == cnedk::ChannelStatus::OK) {
+      EXPECT_FALSE(sent < last);
+      last = sent;
+      latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - sent).count());
+    }
+    producer.join();
+    ASSERT_EQ(latencies.size(), static_cast<size_t>(kCount));
+    std::sort(latencies.begin(), latencies.end());
+    EXPECT_LT(latencies[kCount * 99 / 100], kMaxP99Ns);
+    VLOG(1) << "[EasyDK Tests] [SpscChannel] Handoff latency with " << interval_us << "us producer interval: p50 "
+            << latencies[kCount / 2] << "ns, p99 " << latencies[kCount * 99 / 100] << "ns";
+  }
+}
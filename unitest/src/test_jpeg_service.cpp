@@ -0,0 +1,295 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include "opencv2/opencv.hpp"
+
+#include "cnedk_buf_surface.h"
+#include "cnedk_jpeg_service.hpp"
+#include "cnedk_transform.h"
+
+namespace {
+
+// smooth content, JPEG and bilinear scaling are both close to lossless on it
+double Pattern(double x, double y, int channel) {
+  return 128 + 80 * std::sin(x / 37 + channel) * std::cos(y / 29 - channel);
+}
+
+uint8_t ToPixel(double value) { return static_cast<uint8_t>(std::min(std::max(value + 0.5, 0.0), 255.0)); }
+
+CnedkBufSurface *CreateHostSurface(CnedkBufSurfaceColorFormat format, uint32_t width, uint32_t height) {
+  CnedkBufSurfaceCreateParams params;
+  memset(&params, 0, sizeof(params));
+  params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  params.width = width;
+  params.height = height;
+  params.color_format = format;
+  params.batch_size = 1;
+  CnedkBufSurface *surf = nullptr;
+  if (CnedkBufSurfaceCreate(&surf, &params) < 0) return nullptr;
+  CnedkBufSurfaceParams &p = surf->surface_list[0];
+  uint8_t *data = reinterpret_cast<uint8_t *>(p.data_ptr);
+  if (format == CNEDK_BUF_COLOR_FORMAT_NV12) {
+    for (uint32_t y = 0; y < height; ++y) {
+      uint8_t *luma = data + p.plane_params.offset[0] + y * p.plane_params.pitch[0];
+      for (uint32_t x = 0; x < width; ++x) luma[x] = ToPixel(Pattern(x, y, 0));
+    }
+    for (uint32_t y = 0; y < height / 2; ++y) {
+      uint8_t *uv = data + p.plane_params.offset[1] + y * p.plane_params.pitch[1];
+      for (uint32_t x = 0; x < width / 2; ++x) {
+        uv[2 * x] = ToPixel(128 + (Pattern(2 * x, 2 * y, 1) - 128) / 4);
+        uv[2 * x + 1] = ToPixel(128 + (Pattern(2 * x, 2 * y, 2) - 128) / 4);
+      }
+    }
+  } else {
+    for (uint32_t y = 0; y < height; ++y) {
+      uint8_t *pix = data + p.plane_params.offset[0] + y * p.plane_params.pitch[0];
+      for (uint32_t x = 0; x < width * 3; ++x) pix[x] = ToPixel(Pattern(x / 3, y, x % 3));
+    }
+  }
+  surf->num_filled = 1;
+  return surf;
+}
+
+// PSNR of the decoded image against the pattern sampled at the centers of the destination pixels
+double Psnr(const cv::Mat &image, const cnedk::JpegJob &job, int channels) {
+  CnedkTransformRect roi = job.roi;
+  if (!roi.width || !roi.height) roi = {0, 0, static_cast<uint32_t>(image.cols), static_cast<uint32_t>(image.rows)};
+  const double scale_x = static_cast<double>(roi.width) / image.cols;
+  const double scale_y = static_cast<double>(roi.height) / image.rows;
+  double mse = 0;
+  for (int y = 0; y < image.rows; ++y) {
+    const uint8_t *row = image.ptr<uint8_t>(y);
+    const double src_y = roi.top + std::max((y + 0.5) * scale_y - 0.5, 0.0);
+    for (int x = 0; x < image.cols; ++x) {
+      const double src_x = roi.left + std::max((x + 0.5) * scale_x - 0.5, 0.0);
+      for (int c = 0; c < channels; ++c) {
+        const double diff = row[x * channels + c] - ToPixel(Pattern(src_x, src_y, c));
+        mse += diff * diff;
+      }
+    }
+  }
+  mse /= image.rows * image.cols * channels;
+  return mse ? 10 * std::log10(255.0 * 255.0 / mse) : 100;
+}
+
+// the expected colors of a job, converted by the host transform from BT.601 video range
+cv::Mat Reference(const cnedk::JpegJob &job, uint32_t width, uint32_t height) {
+  CnedkBufSurfaceCreateParams params;
+  memset(&params, 0, sizeof(params));
+  params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  params.width = width;
+  params.height = height;
+  params.color_format = CNEDK_BUF_COLOR_FORMAT_BGR;
+  params.batch_size = 1;
+  CnedkBufSurface *dst = nullptr;
+  if (CnedkBufSurfaceCreate(&dst, &params) < 0) return cv::Mat();
+  dst->num_filled = 1;
+  CnedkTransformRect roi = job.roi;
+  CnedkTransformParams transform_params;
+  memset(&transform_params, 0, sizeof(transform_params));
+  transform_params.transform_flag = CNEDK_TRANSFORM_CROP_SRC;
+  transform_params.src_rect = &roi;
+  cv::Mat reference;
+  if (CnedkTransform(job.surf, dst, &transform_params) == 0) {
+    const CnedkBufSurfaceParams &p = dst->surface_list[0];
+    reference = cv::Mat(height, width, CV_8UC3, p.data_ptr, p.plane_params.pitch[0]).clone();
+  }
+  CnedkBufSurfaceDestroy(dst);
+  return reference;
+}
+
+cnedk::JpegJob MakeJob(CnedkBufSurface *surf, CnedkTransformRect roi, uint32_t width = 0, uint32_t height = 0) {
+  cnedk::JpegJob job;
+  job.surf = surf;
+  job.roi = roi;
+  job.width = width;
+  job.height = height;
+  job.quality = 90;
+  return job;
+}
+
+}  // namespace
+
+TEST(JpegService, Nv12Crops) {
+  CnedkBufSurface *surf = CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_NV12, 1280, 720);
+  ASSERT_TRUE(surf);
+  std::vector<cnedk::JpegJob> jobs;
+  jobs.push_back(MakeJob(surf, {0, 0, 1280, 720}));
+  jobs.push_back(MakeJob(surf, {200, 100, 320, 240}));
+  jobs.push_back(MakeJob(surf, {200, 100, 320, 240}, 160, 120));
+  jobs.push_back(MakeJob(surf, {50, 600, 99, 77}, 200, 150));
+
+  cnedk::JpegService service;
+  std::vector<cnedk::JpegBuffer> buffers;
+  ASSERT_EQ(service.Encode(jobs, &buffers), 0);
+  ASSERT_EQ(buffers.size(), jobs.size());
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    ASSERT_TRUE(buffers[i]);
+    cv::Mat image = cv::imdecode(*buffers[i], cv::IMREAD_COLOR);
+    ASSERT_FALSE(image.empty());
+    const uint32_t width = jobs[i].width ? jobs[i].width : jobs[i].roi.width;
+    const uint32_t height = jobs[i].height ? jobs[i].height : jobs[i].roi.height;
+    ASSERT_EQ(image.cols, static_cast<int>(width));
+    ASSERT_EQ(image.rows, static_cast<int>(height));
+    // colors match the BT.601 conversion of the transforms
+    cv::Mat reference = Reference(jobs[i], width, height);
+    ASSERT_FALSE(reference.empty());
+    double psnr = cv::PSNR(image, reference);
+    LOG(INFO) << "[EasyDK Tests] [JpegService] NV12 " << width << "x" << height << ", " << buffers[i]->size()
+              << " bytes, PSNR " << psnr << " dB";
+    EXPECT_GT(psnr, 36);
+  }
+  CnedkBufSurfaceDestroy(surf);
+}
+
+TEST(JpegService, BgrCrops) {
+  CnedkBufSurface *surf = CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_BGR, 640, 480);
+  ASSERT_TRUE(surf);
+  std::vector<cnedk::JpegJob> jobs;
+  jobs.push_back(MakeJob(surf, {0, 0, 0, 0}));
+  jobs.push_back(MakeJob(surf, {33, 17, 201, 143}));
+  jobs.push_back(MakeJob(surf, {33, 17, 201, 143}, 64, 48));
+
+  cnedk::JpegService service;
+  std::vector<cnedk::JpegBuffer> buffers;
+  ASSERT_EQ(service.Encode(jobs, &buffers), 0);
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    ASSERT_TRUE(buffers[i]);
+    cv::Mat image = cv::imdecode(*buffers[i], cv::IMREAD_COLOR);
+    ASSERT_FALSE(image.empty());
+    ASSERT_EQ(image.channels(), 3);
+    double psnr = Psnr(image, jobs[i], 3);
+    LOG(INFO) << "[EasyDK Tests] [JpegService] BGR " << image.cols << "x" << image.rows << ", " << buffers[i]->size()
+              << " bytes, PSNR " << psnr << " dB";
+    EXPECT_GT(psnr, 38);
+  }
+  CnedkBufSurfaceDestroy(surf);
+}
+
+TEST(JpegService, InvalidJobs) {
+  CnedkBufSurface *surf = CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_NV12, 320, 240);
+  ASSERT_TRUE(surf);
+  std::vector<cnedk::JpegJob> jobs;
+  jobs.push_back(MakeJob(nullptr, {0, 0, 0, 0}));
+  jobs.push_back(MakeJob(surf, {300, 0, 64, 64}));
+  jobs.push_back(MakeJob(surf, {0, 0, 64, 64}));
+  jobs.back().batch_idx = 1;
+  jobs.push_back(MakeJob(surf, {0, 0, 64, 64}));
+
+  cnedk::JpegService service;
+  std::vector<cnedk::JpegBuffer> buffers;
+  EXPECT_NE(service.Encode(jobs, &buffers), 0);
+  ASSERT_EQ(buffers.size(), jobs.size());
+  EXPECT_FALSE(buffers[0]);
+  EXPECT_FALSE(buffers[1]);
+  EXPECT_FALSE(buffers[2]);
+  EXPECT_TRUE(buffers[3]);
+  EXPECT_NE(service.Encode(jobs, nullptr), 0);
+  CnedkBufSurfaceDestroy(surf);
+}
+
+TEST(JpegService, BufferPool) {
+  CnedkBufSurface *surf = CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_NV12, 320, 240);
+  ASSERT_TRUE(surf);
+  cnedk::JpegServiceParams params;
+  params.thread_num = 2;
+  params.max_pooled_buffers = 4;
+  cnedk::JpegBuffer kept;
+  {
+    cnedk::JpegService service(params);
+    std::vector<cnedk::JpegJob> jobs(8, MakeJob(surf, {16, 16, 128, 96}));
+    std::vector<cnedk::JpegBuffer> buffers;
+    ASSERT_EQ(service.Encode(jobs, &buffers), 0);
+    EXPECT_EQ(service.GetPooledBufferNum(), 0u);
+    kept = buffers[0];
+    buffers.clear();
+    EXPECT_EQ(service.GetPooledBufferNum(), 4u);
+
+    // buffers are taken from the pool
+    jobs.resize(3);
+    ASSERT_EQ(service.Encode(jobs, &buffers), 0);
+    EXPECT_EQ(service.GetPooledBufferNum(), 1u);
+    for (auto &buffer : buffers) EXPECT_EQ(*buffer, *kept);
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done = false;
+    int ret = -1;
+    auto callback = [&](int job_ret, cnedk::JpegBuffer buffer) {
+      std::lock_guard<std::mutex> lk(mutex);
+      ret = job_ret;
+      done = true;
+      cond.notify_one();
+    };
+    ASSERT_EQ(service.EncodeAsync(jobs[0], callback), 0);
+    std::unique_lock<std::mutex> lk(mutex);
+    cond.wait(lk, [&] { return done; });
+    EXPECT_EQ(ret, 0);
+  }
+  // buffers are valid after the service is destroyed
+  ASSERT_TRUE(kept);
+  EXPECT_FALSE(cv::imdecode(*kept, cv::IMREAD_GRAYSCALE).empty());
+  kept.reset();
+  CnedkBufSurfaceDestroy(surf);
+}
+
+TEST(JpegService, Benchmark) {
+  CnedkBufSurface *surf = CreateHostSurface(CNEDK_BUF_COLOR_FORMAT_NV12, 1920, 1080);
+  ASSERT_TRUE(surf);
+  // object thumbnails, e.g. persons scaled to 64x128 and the others encoded in their own size
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<uint32_t> x_dist(0, 1920 - 256), y_dist(0, 1080 - 256), size_dist(48, 256);
+  std::vector<cnedk::JpegJob> jobs;
+  for (int i = 0; i < 256; ++i) {
+    CnedkTransformRect roi = {y_dist(rng), x_dist(rng), size_dist(rng), size_dist(rng)};
+    jobs.push_back(i % 2 ? MakeJob(surf, roi, 64, 128) : MakeJob(surf, roi));
+    jobs.back().quality = 85;
+  }
+
+  for (uint32_t thread_num : {1u, 4u}) {
+    cnedk::JpegServiceParams params;
+    params.thread_num = thread_num;
+    cnedk::JpegService service(params);
+    std::vector<cnedk::JpegBuffer> buffers;
+    ASSERT_EQ(service.Encode(jobs, &buffers), 0);  // warm up
+    const int rounds = 4;
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+      ASSERT_EQ(service.Encode(jobs, &buffers), 0);
+      for (auto &buffer : buffers) bytes += buffer->size();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG(INFO) << "[EasyDK Tests] [JpegService] " << thread_num << " threads: " << jobs.size() * rounds / seconds
+              << " crops/s, " << bytes / (jobs.size() * rounds) << " bytes per crop";
+  }
+  CnedkBufSurfaceDestroy(surf);
+}
@@ -0,0 +1,325 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cnedk_buf_surface.h"
+#include "cnedk_buf_surface_util.hpp"
+#include "cnedk_memory_budget.hpp"
+#include "cnedk_platform_caps.hpp"
+
+// domains not used by pools, so tests of accounts do not disturb each other
+static constexpr int kTestDomain = 1000;
+
+TEST(MemoryBudget, AccountLimits) {
+  cnedk::MemoryBudget &budget = cnedk::MemoryBudget::Instance();
+  {
+    cnedk::MemLimits limits;
+    limits.soft = 50;
+    limits.hard = 100;
+    cnedk::MemoryAccount account(kTestDomain, "test", limits);
+    EXPECT_TRUE(account.Reserve(60));
+    EXPECT_TRUE(account.OverSoftLimit());
+    EXPECT_FALSE(account.Reserve(50));
+    EXPECT_EQ(account.GetUsage(), 60u);
+    EXPECT_TRUE(account.Reserve(40));
+    EXPECT_EQ(budget.GetUsage(kTestDomain), 100u);
+    EXPECT_EQ(budget.GetUsage(kTestDomain, "test"), 100u);
+    account.Release(60);
+    EXPECT_FALSE(account.OverSoftLimit());
+    EXPECT_EQ(budget.GetUsage(kTestDomain), 40u);
+  }
+  // released by destructor
+  EXPECT_EQ(budget.GetUsage(kTestDomain), 0u);
+  EXPECT_EQ(budget.GetUsage(kTestDomain, "test"), 0u);
+}
+
+TEST(MemoryBudget, HardLimitReclaim) {
+  cnedk::MemoryBudget &budget = cnedk::MemoryBudget::Instance();
+  budget.SetLimits(kTestDomain, cnedk::MemLimits(0, 100));
+
+  size_t asked = 0;
+  std::unique_ptr<cnedk::MemoryAccount> cache;
+  cache.reset(new cnedk::MemoryAccount(kTestDomain, "cache", cnedk::MemLimits(), [&](size_t bytes) {
+    asked += bytes;
+    size_t released = std::min(bytes, cache->GetUsage());
+    cache->Release(released);
+    return released;
+  }));
+  cnedk::MemoryAccount pinned(kTestDomain, "pinned");
+  cnedk::MemoryAccount pool(kTestDomain, "pool");
+
+  ASSERT_TRUE(cache->Reserve(80));
+  // the account trims itself if nothing else could be reclaimed
+  ASSERT_TRUE(cache->Reserve(30));
+  EXPECT_EQ(asked, 10u);
+  EXPECT_EQ(cache->GetUsage(), 100u);
+
+  ASSERT_TRUE(pool.Reserve(50));
+  EXPECT_EQ(asked, 60u);
+  EXPECT_EQ(cache->GetUsage(), 50u);
+  EXPECT_EQ(budget.GetUsage(kTestDomain), 100u);
+  // accounts without reclaim function keep their memory
+  ASSERT_TRUE(cache->Reserve(20));
+  EXPECT_EQ(asked, 80u);
+  EXPECT_EQ(cache->GetUsage(), 50u);
+  EXPECT_EQ(pool.GetUsage(), 50u);
+
+  // nothing could be reclaimed from accounts without reclaim function
+  ASSERT_TRUE(pinned.Reserve(50));
+  EXPECT_EQ(cache->GetUsage(), 0u);
+  EXPECT_FALSE(pinned.Reserve(1));
+  EXPECT_EQ(budget.GetUsage(kTestDomain), 100u);
+
+  cache.reset();
+  budget.ClearLimits();
+}
+
+TEST(MemoryBudget, AccountLimitReclaim) {
+  size_t idle = 0;
+  std::unique_ptr<cnedk::MemoryAccount> cache;
+  cache.reset(new cnedk::MemoryAccount(kTestDomain, "cache", cnedk::MemLimits(0, 100), [&](size_t bytes) {
+    size_t released = std::min(bytes, idle);
+    idle -= released;
+    cache->Release(released);
+    return released;
+  }));
+  ASSERT_TRUE(cache->Reserve(80));
+  idle = 20;
+  // idle memory of the account is reclaimed to fit its own hard limit
+  ASSERT_TRUE(cache->Reserve(40));
+  EXPECT_EQ(idle, 0u);
+  EXPECT_EQ(cache->GetUsage(), 100u);
+  EXPECT_FALSE(cache->Reserve(1));
+  EXPECT_EQ(cache->GetUsage(), 100u);
+  cache.reset();
+}
+
+TEST(MemoryBudget, SoftLimitReclaim) {
+  cnedk::MemoryBudget &budget = cnedk::MemoryBudget::Instance();
+
+  size_t used = 0;
+  std::unique_ptr<cnedk::MemoryAccount> cache;
+  cache.reset(new cnedk::MemoryAccount(kTestDomain, "cache", cnedk::MemLimits(), [&](size_t bytes) {
+    size_t released = std::min(bytes, used);
+    used -= released;
+    cache->Release(released);
+    return released;
+  }));
+  cnedk::MemoryAccount pool(kTestDomain, "pool");
+  ASSERT_TRUE(cache->Reserve(80));
+  used = 80;
+
+  // excess is reclaimed when limits are set
+  budget.SetLimits(kTestDomain, cnedk::MemLimits(60, 0));
+  EXPECT_EQ(used, 60u);
+  // and after reservations of other accounts
+  ASSERT_TRUE(pool.Reserve(30));
+  EXPECT_EQ(used, 30u);
+  EXPECT_EQ(budget.GetUsage(kTestDomain), 60u);
+  EXPECT_FALSE(pool.OverSoftLimit());
+
+  // category limits apply to accounts of the category only
+  budget.SetLimits(kTestDomain, "pool", cnedk::MemLimits(10, 0));
+  EXPECT_EQ(used, 30u);
+  EXPECT_TRUE(pool.OverSoftLimit());
+  EXPECT_EQ(budget.Reclaim(kTestDomain, 20), 20u);
+  EXPECT_EQ(used, 10u);
+
+  cache.reset();
+  budget.ClearLimits();
+}
+
+static void InjectDevice() {
+  cnedk::CpuTopology topology;
+  topology.logical_cores = 1;
+  topology.physical_cores = 1;
+  topology.numa_nodes.resize(1);
+  topology.numa_nodes[0].cpus = {0};
+  cnedk::PlatformCaps::Instance().Inject({cnedk::DeviceCaps::Make(0, "MLU370", false, false)}, topology);
+}
+
+static CnedkBufSurfaceCreateParams SystemParams() {
+  CnedkBufSurfaceCreateParams params;
+  memset(&params, 0, sizeof(params));
+  params.device_id = 0;
+  params.width = 64;
+  params.height = 64;
+  params.batch_size = 2;
+  params.color_format = CNEDK_BUF_COLOR_FORMAT_NV12;
+  params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  return params;
+}
+
+TEST(MemoryBudget, SystemPool) {
+  InjectDevice();
+  cnedk::MemoryBudget &budget = cnedk::MemoryBudget::Instance();
+  const std::string category = cnedk::kMemCategoryBufPool;
+  CnedkBufSurfaceCreateParams params = SystemParams();
+
+  size_t block_size;
+  {
+    cnedk::BufPool pool;
+    ASSERT_EQ(pool.CreatePool(&params, 1), 0);
+    block_size = budget.GetUsage(cnedk::kHostMemory, category);
+    ASSERT_GT(block_size, 0u);
+  }
+  EXPECT_EQ(budget.GetUsage(cnedk::kHostMemory, category), 0u);
+
+  // creating fails predictably above hard limit
+  budget.SetLimits(cnedk::kHostMemory, category, cnedk::MemLimits(0, 3 * block_size));
+  void *c_pool = nullptr;
+  params = SystemParams();
+  EXPECT_EQ(CnedkBufPoolCreate(&c_pool, &params, 4), -1);
+  EXPECT_EQ(budget.GetUsage(cnedk::kHostMemory, category), 0u);
+
+  cnedk::BufPool pool;
+  budget.ClearLimits();
+  params = SystemParams();
+  ASSERT_EQ(pool.CreatePool(&params, 4), 0);
+  EXPECT_EQ(budget.GetUsage(cnedk::kHostMemory, category), 4 * block_size);
+
+  // idle blocks are trimmed
+  budget.SetLimits(cnedk::kHostMemory, category, cnedk::MemLimits(2 * block_size, 3 * block_size));
+  EXPECT_EQ(budget.GetUsage(cnedk::kHostMemory, category), 2 * block_size);
+
+  // and allocated again on demand, up to hard limit
+  std::vector<cnedk::BufSurfWrapperPtr> bufs;
+  for (int i = 0; i < 3; ++i) {
+    bufs.push_back(pool.GetBufSurfaceWrapper(0));
+    ASSERT_NE(bufs.back(), nullptr);
+  }
+  EXPECT_EQ(budget.GetUsage(cnedk::kHostMemory, category), 3 * block_size);
+  EXPECT_EQ(pool.GetBufSurfaceWrapper(0), nullptr);
+
+  // blocks are not cached above soft limit
+  bufs.clear();
+  EXPECT_EQ(budget.GetUsage(cnedk::kHostMemory, category), 2 * block_size);
+
+  pool.DestroyPool();
+  EXPECT_EQ(budget.GetUsage(cnedk::kHostMemory, category), 0u);
+  budget.ClearLimits();
+  cnedk::PlatformCaps::Instance().Reset();
+}
+
+TEST(MemoryBudget, PoolAtHardLimit) {
+  InjectDevice();
+  cnedk::MemoryBudget &budget = cnedk::MemoryBudget::Instance();
+  const std::string category = cnedk::kMemCategoryBufPool;
+
+  size_t block_size;
+  {
+    cnedk::BufPool pool;
+    CnedkBufSurfaceCreateParams params = SystemParams();
+    ASSERT_EQ(pool.CreatePool(&params, 1), 0);
+    block_size = budget.GetUsage(cnedk::kHostMemory, category);
+  }
+  budget.SetLimits(cnedk::kHostMemory, category, cnedk::MemLimits(0, 3 * block_size));
+
+  cnedk::BufPool busy;
+  CnedkBufSurfaceCreateParams params = SystemParams();
+  ASSERT_EQ(busy.CreatePool(&params, 2), 0);
+  std::vector<cnedk::BufSurfWrapperPtr> bufs;
+  for (int i = 0; i < 2; ++i) {
+    bufs.push_back(busy.GetBufSurfaceWrapper(0));
+    ASSERT_NE(bufs.back(), nullptr);
+  }
+  // nothing is idle in the other pool, and the creating pool holding its lock is not trimmed by itself
+  cnedk::BufPool pool;
+  params = SystemParams();
+  EXPECT_NE(pool.CreatePool(&params, 2), 0);
+  EXPECT_EQ(budget.GetUsage(cnedk::kHostMemory, category), 2 * block_size);
+
+  // blocks released by the other pool are taken
+  bufs.clear();
+  params = SystemParams();
+  ASSERT_EQ(pool.CreatePool(&params, 2), 0);
+  EXPECT_LE(budget.GetUsage(cnedk::kHostMemory, category), 3 * block_size);
+
+  pool.DestroyPool();
+  busy.DestroyPool();
+  budget.ClearLimits();
+  cnedk::PlatformCaps::Instance().Reset();
+}
+
+TEST(MemoryBudget, AllocationStorm) {
+  InjectDevice();
+  cnedk::MemoryBudget &budget = cnedk::MemoryBudget::Instance();
+  const std::string category = cnedk::kMemCategoryBufPool;
+
+  size_t block_size;
+  {
+    cnedk::BufPool pool;
+    CnedkBufSurfaceCreateParams params = SystemParams();
+    ASSERT_EQ(pool.CreatePool(&params, 1), 0);
+    block_size = budget.GetUsage(cnedk::kHostMemory, category);
+  }
+  const size_t hard = 6 * block_size;
+  budget.SetLimits(cnedk::kHostMemory, category, cnedk::MemLimits(4 * block_size, hard));
+
+  // the latter pools take blocks trimmed from the former ones
+  constexpr int kPoolNum = 3;
+  std::vector<std::unique_ptr<cnedk::BufPool>> pools;
+  for (int i = 0; i < kPoolNum; ++i) {
+    CnedkBufSurfaceCreateParams params = SystemParams();
+    pools.emplace_back(new cnedk::BufPool);
+    ASSERT_EQ(pools.back()->CreatePool(&params, 4), 0);
+    EXPECT_LE(budget.GetUsage(cnedk::kHostMemory, category), hard);
+  }
+
+  std::atomic<bool> running{true};
+  std::atomic<int> exceeded{0};
+  std::atomic<int> got{0};
+  std::thread monitor([&] {
+    while (running.load()) {
+      if (budget.GetUsage(cnedk::kHostMemory, category) > hard) ++exceeded;
+      std::this_thread::yield();
+    }
+  });
+  std::vector<std::thread> workers;
+  for (int t = 0; t < 4; ++t) {
+    workers.emplace_back([&, t] {
+      for (int i = 0; i < 500; ++i) {
+        cnedk::BufSurfWrapperPtr buf = pools[(t + i) % kPoolNum]->GetBufSurfaceWrapper(0);
+        if (buf) ++got;
+        std::this_thread::yield();
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  running = false;
+  monitor.join();
+  EXPECT_EQ(exceeded.load(), 0);
+  EXPECT_GT(got.load(), 0);
+  EXPECT_LE(budget.GetUsage(cnedk::kHostMemory, category), hard);
+
+  pools.clear();
+  EXPECT_EQ(budget.GetUsage(cnedk::kHostMemory, category), 0u);
+  budget.ClearLimits();
+  cnedk::PlatformCaps::Instance().Reset();
+}
@@ -0,0 +1,292 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <glog/logging.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "cnedk_buf_surface.h"
+#include "cnedk_motion_gate.hpp"
+
+namespace {
+
+constexpr uint32_t kWidth = 1920;
+constexpr uint32_t kHeight = 1080;
+constexpr uint32_t kStride = 2048;
+
+// A textured static scene with sensor noise and a moving bright rectangle
+class SyntheticScene {
+ public:
+  SyntheticScene() : background_(kStride * kHeight), frame_(kStride * kHeight * 3 / 2, 128), rng_(7) {
+    for (uint32_t y = 0; y < kHeight; ++y) {
+      for (uint32_t x = 0; x < kWidth; ++x) background_[y * kStride + x] = 40 + ((x / 24 + y / 24) % 2) * 60 + (x % 7);
+    }
+  }
+  const uint8_t *Render(int rect_x, int rect_y, int rect_w = 96, int rect_h = 80, int brightness = 0) {
+    std::uniform_int_distribution<int> noise(-2, 2);
+    for (uint32_t y = 0; y < kHeight; ++y) {
+      for (uint32_t x = 0; x < kWidth; ++x) {
+        int v = background_[y * kStride + x] + noise(rng_) + brightness;
+        if (static_cast<int>(x) >= rect_x && static_cast<int>(x) < rect_x + rect_w && static_cast<int>(y) >= rect_y &&
+            static_cast<int>(y) < rect_y + rect_h) {
+          v = 230;
+        }
+        frame_[y * kStride + x] = std::min(255, std::max(0, v));
+      }
+    }
+    return frame_.data();
+  }
+  const uint8_t *Static() { return Render(-1000, -1000); }
+
+ private:
+  std::vector<uint8_t> background_;
+  std::vector<uint8_t> frame_;
+  std::mt19937 rng_;
+};
+
+bool Covers(const std::vector<CnedkTransformRect> &rois, int x, int y, int w, int h) {
+  for (const auto &roi : rois) {
+    if (static_cast<int>(roi.left) <= x && static_cast<int>(roi.top) <= y &&
+        static_cast<int>(roi.left + roi.width) >= x + w && static_cast<int>(roi.top + roi.height) >= y + h) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+TEST(MotionGate, MovingRectangle) {
+  SyntheticScene scene;
+  cnedk::MotionGate gate;
+  cnedk::MotionResult result;
+  ASSERT_EQ(gate.Process(scene.Static(), kWidth, kHeight, kStride, &result), 0);
+  EXPECT_TRUE(result.full_frame);
+  EXPECT_FALSE(result.skip);
+
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_EQ(gate.Process(scene.Static(), kWidth, kHeight, kStride, &result), 0);
+    EXPECT_TRUE(result.skip) << "frame " << i << ", changed cells " << result.changed_cells;
+  }
+
+  for (int i = 0; i < 30; ++i) {
+    int x = 200 + i * 12, y = 300 + i * 4;
+    ASSERT_EQ(gate.Process(scene.Render(x, y), kWidth, kHeight, kStride, &result), 0);
+    ASSERT_FALSE(result.skip) << "frame " << i;
+    ASSERT_FALSE(result.full_frame) << "frame " << i;
+    ASSERT_FALSE(result.rois.empty());
+    EXPECT_TRUE(Covers(result.rois, x, y, 96, 80)) << "frame " << i;
+    for (const auto &roi : result.rois) {
+      EXPECT_EQ(roi.left % 2, 0u);
+      EXPECT_EQ(roi.top % 2, 0u);
+      EXPECT_EQ(roi.width % 2, 0u);
+      EXPECT_EQ(roi.height % 2, 0u);
+      EXPECT_LE(roi.left + roi.width, kWidth);
+      EXPECT_LE(roi.top + roi.height, kHeight);
+      // only the area around the rectangle and its trail
+      EXPECT_LT(roi.width * roi.height, kWidth * kHeight / 8);
+    }
+  }
+
+  // the rectangle leaves, the trail fades out of the background after a while
+  int skipped_at = -1;
+  for (int i = 0; i < 100 && skipped_at < 0; ++i) {
+    ASSERT_EQ(gate.Process(scene.Static(), kWidth, kHeight, kStride, &result), 0);
+    if (result.skip) skipped_at = i;
+  }
+  EXPECT_GE(skipped_at, 5);  // hold frames
+  EXPECT_LT(skipped_at, 100);
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_EQ(gate.Process(scene.Static(), kWidth, kHeight, kStride, &result), 0);
+    EXPECT_TRUE(result.skip);
+  }
+}
+
+TEST(MotionGate, Hysteresis) {
+  SyntheticScene scene;
+  cnedk::MotionGateParams params;
+  params.trigger_cells = 4;
+  params.release_cells = 1;
+  params.hold_frames = 3;
+  params.bg_update_shift = 0;  // background is the previous frame
+  cnedk::MotionGate gate(params);
+  cnedk::MotionResult result;
+  ASSERT_EQ(gate.Process(scene.Static(), kWidth, kHeight, kStride, &result), 0);
+
+  // a blink of one cell does not trigger
+  ASSERT_EQ(gate.Process(scene.Render(512, 512, 32, 32), kWidth, kHeight, kStride, &result), 0);
+  EXPECT_GE(result.changed_cells, 1u);
+  EXPECT_TRUE(result.skip);
+  ASSERT_EQ(gate.Process(scene.Static(), kWidth, kHeight, kStride, &result), 0);
+  EXPECT_TRUE(result.skip);
+
+  // a large change triggers, then one cell keeps it on
+  ASSERT_EQ(gate.Process(scene.Render(512, 512, 256, 128), kWidth, kHeight, kStride, &result), 0);
+  EXPECT_FALSE(result.skip);
+  ASSERT_EQ(gate.Process(scene.Render(512, 512, 32, 32), kWidth, kHeight, kStride, &result), 0);
+  EXPECT_FALSE(result.skip);
+  ASSERT_EQ(gate.Process(scene.Render(512, 512, 32, 32), kWidth, kHeight, kStride, &result), 0);
+  EXPECT_EQ(result.changed_cells, 0u);
+  std::vector<CnedkTransformRect> last = result.rois;
+  EXPECT_FALSE(last.empty());
+  // held for 3 frames with the last regions
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(gate.Process(scene.Render(512, 512, 32, 32), kWidth, kHeight, kStride, &result), 0);
+    EXPECT_FALSE(result.skip);
+    ASSERT_EQ(result.rois.size(), last.size());
+    EXPECT_EQ(result.rois[0].left, last[0].left);
+  }
+  ASSERT_EQ(gate.Process(scene.Render(512, 512, 32, 32), kWidth, kHeight, kStride, &result), 0);
+  EXPECT_TRUE(result.skip);
+}
+
+TEST(MotionGate, RegionMask) {
+  SyntheticScene scene;
+  cnedk::MotionGate gate;
+  CnedkTransformRect door{0, 0, kWidth / 2, kHeight};
+  CnedkTransformRect tree{200, 200, 400, 400};
+  gate.SetRegions({door}, {tree});
+  cnedk::MotionResult result;
+  ASSERT_EQ(gate.Process(scene.Static(), kWidth, kHeight, kStride, &result), 0);
+
+  // motion in the excluded region and out of the included region are ignored
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_EQ(gate.Process(scene.Render(300 + i * 8, 300), kWidth, kHeight, kStride, &result), 0);
+    EXPECT_TRUE(result.skip);
+    EXPECT_EQ(result.changed_cells, 0u);
+  }
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_EQ(gate.Process(scene.Render(1400 + i * 8, 300), kWidth, kHeight, kStride, &result), 0);
+    EXPECT_TRUE(result.skip);
+  }
+  // and watched after regions are cleared
+  gate.SetRegions({});
+  ASSERT_EQ(gate.Process(scene.Render(1400 + 80, 300), kWidth, kHeight, kStride, &result), 0);
+  EXPECT_FALSE(result.skip);
+  EXPECT_TRUE(Covers(result.rois, 1480, 300, 96, 80));
+}
+
+TEST(MotionGate, SceneChange) {
+  SyntheticScene scene;
+  cnedk::MotionGateParams params;
+  params.max_rois = 2;
+  cnedk::MotionGate gate(params);
+  cnedk::MotionResult result;
+  ASSERT_EQ(gate.Process(scene.Static(), kWidth, kHeight, kStride, &result), 0);
+
+  // lights on
+  ASSERT_EQ(gate.Process(scene.Render(-1000, -1000, 0, 0, 80), kWidth, kHeight, kStride, &result), 0);
+  EXPECT_TRUE(result.full_frame);
+  EXPECT_TRUE(result.rois.empty());
+  ASSERT_EQ(gate.Process(scene.Render(-1000, -1000, 0, 0, 80), kWidth, kHeight, kStride, &result), 0);
+  EXPECT_TRUE(result.skip);
+
+  // regions are merged to the maximum number
+  const uint8_t *base = scene.Render(100, 100, 64, 64, 80);
+  std::vector<uint8_t> frame(base, base + kStride * kHeight);
+  for (int i = 0; i < 3; ++i) {
+    for (uint32_t y = 600; y < 664; ++y) memset(&frame[y * kStride + 600 + i * 400], 230, 64);
+  }
+  ASSERT_EQ(gate.Process(frame.data(), kWidth, kHeight, kStride, &result), 0);
+  EXPECT_FALSE(result.skip);
+  EXPECT_EQ(result.rois.size(), 2u);
+  EXPECT_TRUE(Covers(result.rois, 100, 100, 64, 64));
+  for (int i = 0; i < 3; ++i) EXPECT_TRUE(Covers(result.rois, 600 + i * 400, 600, 64, 64));
+
+  // a new size restarts
+  ASSERT_EQ(gate.Process(frame.data(), kWidth / 2, kHeight / 2, kStride, &result), 0);
+  EXPECT_TRUE(result.full_frame);
+  EXPECT_EQ(gate.Process(frame.data(), kWidth, kHeight, kWidth - 1, &result), -1);
+}
+
+TEST(MotionGate, BufSurface) {
+  SyntheticScene scene;
+  std::vector<uint8_t> nv12(kStride * kHeight * 3 / 2, 128);
+  CnedkBufSurfaceParams params;
+  memset(&params, 0, sizeof(params));
+  params.width = kWidth;
+  params.height = kHeight;
+  params.pitch = kStride;
+  params.color_format = CNEDK_BUF_COLOR_FORMAT_NV12;
+  params.data_ptr = nv12.data();
+  params.plane_params.num_planes = 2;
+  params.plane_params.pitch[0] = params.plane_params.pitch[1] = kStride;
+  params.plane_params.offset[1] = kStride * kHeight;
+  CnedkBufSurface surf;
+  memset(&surf, 0, sizeof(surf));
+  surf.batch_size = 1;
+  surf.num_filled = 1;
+  surf.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  surf.surface_list = &params;
+
+  cnedk::MotionGate gate;
+  cnedk::MotionResult result;
+  memcpy(nv12.data(), scene.Static(), kStride * kHeight);
+  ASSERT_EQ(gate.Process(&surf, 0, &result), 0);
+  EXPECT_TRUE(result.full_frame);
+  memcpy(nv12.data(), scene.Render(800, 500), kStride * kHeight);
+  ASSERT_EQ(gate.Process(&surf, 0, &result), 0);
+  EXPECT_TRUE(Covers(result.rois, 800, 500, 96, 80));
+
+  EXPECT_EQ(gate.Process(&surf, 1, &result), -1);
+  surf.mem_type = CNEDK_BUF_MEM_DEVICE;
+  EXPECT_EQ(gate.Process(&surf, 0, &result), -1);
+  surf.mem_type = CNEDK_BUF_MEM_SYSTEM;
+  params.color_format = CNEDK_BUF_COLOR_FORMAT_BGR;
+  EXPECT_EQ(gate.Process(&surf, 0, &result), -1);
+}
+
+TEST(MotionGate, Benchmark) {
+  // 10 seconds of a fixed camera, something moves through the scene for 2 seconds
+  constexpr int kFrameNum = 250;
+  SyntheticScene scene;
+  std::vector<std::vector<uint8_t>> frames;
+  for (int i = 0; i < kFrameNum; ++i) {
+    const uint8_t *frame = (i >= 100 && i < 150) ? scene.Render(100 + (i - 100) * 30, 400) : scene.Static();
+    frames.emplace_back(frame, frame + kStride * kHeight);
+  }
+
+  cnedk::MotionGate gate;
+  cnedk::MotionResult result;
+  int inferred = 0;
+  uint64_t inferred_pixels = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const auto &frame : frames) {
+    ASSERT_EQ(gate.Process(frame.data(), kWidth, kHeight, kStride, &result), 0);
+    if (result.skip) continue;
+    ++inferred;
+    if (result.full_frame) {
+      inferred_pixels += kWidth * kHeight;
+    } else {
+      for (const auto &roi : result.rois) inferred_pixels += roi.width * roi.height;
+    }
+  }
+  std::chrono::duration<double, std::milli> dura = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(inferred, kFrameNum / 2);
+  LOG(INFO) << "[EasyDK Tests] [MotionGate] " << kWidth << "x" << kHeight << ", " << dura.count() / kFrameNum
+            << " ms per frame. Frames to infer: " << inferred << " of " << kFrameNum << " (full inference baseline), "
+            << "pixels to infer: " << 100.0 * inferred_pixels / (static_cast<uint64_t>(kFrameNum) * kWidth * kHeight)
+            << "% of baseline";
+}
@@ -0,0 +1,209 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "cnedk_muxer.h"
+
+#include "ffmpeg_demuxer.h"
+
+static const char *test_h264 = "../../unitest/data/1080p.h264";
+static const char *test_hevc = "../../unitest/data/img.hevc";
+
+namespace {
+
+// Feeds the elementary stream `loops` times to a muxer, returns the number of frames written
+int MuxFile(const char *input, CnedkMuxerCreateParams *params, int loops) {
+  void *muxer = nullptr;
+  if (CnedkMuxerCreate(&muxer, params) < 0) return -1;
+  int frame_count = 0;
+  for (int i = 0; i < loops; ++i) {
+    FFmpegDemuxer demuxer(input);
+    uint8_t *data = nullptr;
+    int size = 0;
+    while (demuxer.ReadFrame(&data, &size)) {
+      CnedkVEncFrameBits frame_bits;
+      memset(&frame_bits, 0, sizeof(frame_bits));
+      frame_bits.bits = data;
+      frame_bits.len = size;
+      frame_bits.pts = frame_count * 3600;  // 25 fps
+      frame_bits.pkt_type = CNEDK_VENC_PACKAGE_TYPE_FRAME;
+      if (CnedkMuxerWrite(muxer, &frame_bits) < 0) {
+        CnedkMuxerDestroy(muxer);
+        return -1;
+      }
+      frame_count++;
+    }
+  }
+  if (CnedkMuxerDestroy(muxer) < 0) return -1;
+  return frame_count;
+}
+
+std::vector<uint8_t> ReadFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+}
+
+bool CheckTs(const std::vector<uint8_t> &data) {
+  if (data.empty() || data.size() % 188) return false;
+  for (size_t i = 0; i < data.size(); i += 188) {
+    if (data[i] != 0x47) return false;
+  }
+  return true;
+}
+
+// Walks top level boxes, returns box types in order
+std::vector<std::string> Mp4Boxes(const std::vector<uint8_t> &data) {
+  std::vector<std::string> boxes;
+  size_t offset = 0;
+  while (offset + 8 <= data.size()) {
+    uint32_t size = (data[offset] << 24) | (data[offset + 1] << 16) | (data[offset + 2] << 8) | data[offset + 3];
+    if (size < 8 || offset + size > data.size()) return {};
+    boxes.emplace_back(reinterpret_cast<const char *>(data.data() + offset + 4), 4);
+    offset += size;
+  }
+  return offset == data.size() ? boxes : std::vector<std::string>();
+}
+
+// Demuxes the output with FFmpeg as a reference parser
+int CountFrames(const std::string &path, int width, int height) {
+  FFmpegDemuxer demuxer(path.c_str());
+  if (demuxer.GetWidth() != width || demuxer.GetHeight() != height) return -1;
+  uint8_t *data = nullptr;
+  int size = 0;
+  int frame_count = 0;
+  while (demuxer.ReadFrame(&data, &size)) frame_count++;
+  return frame_count;
+}
+
+CnedkMuxerCreateParams DefaultParams(CnedkMuxerFormat format, CnedkVencType codec_type, const char *path) {
+  CnedkMuxerCreateParams params;
+  memset(&params, 0, sizeof(params));
+  params.format = format;
+  params.codec_type = codec_type;
+  params.width = codec_type == CNEDK_VENC_TYPE_H264 ? 1920 : 256;
+  params.height = codec_type == CNEDK_VENC_TYPE_H264 ? 1080 : 256;
+  params.frame_rate = 25;
+  params.file_path = path;
+  return params;
+}
+
+}  // namespace
+
+TEST(Muxer, MpegTs) {
+  const char *path = "muxer_test.ts";
+  CnedkMuxerCreateParams params = DefaultParams(CNEDK_MUXER_FORMAT_MPEGTS, CNEDK_VENC_TYPE_H264, path);
+  int frame_count = MuxFile(test_h264, &params, 1);
+  ASSERT_GT(frame_count, 0);
+  EXPECT_TRUE(CheckTs(ReadFile(path)));
+  EXPECT_EQ(CountFrames(path, 1920, 1080), frame_count);
+  remove(path);
+}
+
+TEST(Muxer, Fmp4) {
+  const char *path = "muxer_test.mp4";
+  CnedkMuxerCreateParams params = DefaultParams(CNEDK_MUXER_FORMAT_FMP4, CNEDK_VENC_TYPE_H264, path);
+  int frame_count = MuxFile(test_h264, &params, 1);
+  ASSERT_GT(frame_count, 0);
+  std::vector<std::string> boxes = Mp4Boxes(ReadFile(path));
+  ASSERT_GE(boxes.size(), 4u);
+  EXPECT_EQ(boxes[0], "ftyp");
+  EXPECT_EQ(boxes[1], "moov");
+  EXPECT_EQ(boxes[2], "moof");
+  EXPECT_EQ(boxes[3], "mdat");
+  EXPECT_EQ(CountFrames(path, 1920, 1080), frame_count);
+  remove(path);
+}
+
+TEST(Muxer, Hevc) {
+  for (auto format : {CNEDK_MUXER_FORMAT_MPEGTS, CNEDK_MUXER_FORMAT_FMP4}) {
+    const char *path = format == CNEDK_MUXER_FORMAT_MPEGTS ? "muxer_test_hevc.ts" : "muxer_test_hevc.mp4";
+    CnedkMuxerCreateParams params = DefaultParams(format, CNEDK_VENC_TYPE_H265, path);
+    int frame_count = MuxFile(test_hevc, &params, 1);
+    ASSERT_GT(frame_count, 0);
+    EXPECT_EQ(CountFrames(path, 256, 256), frame_count);
+    remove(path);
+  }
+}
+
+TEST(Muxer, Rotation) {
+  constexpr int kLoops = 4;
+  for (auto format : {CNEDK_MUXER_FORMAT_MPEGTS, CNEDK_MUXER_FORMAT_FMP4}) {
+    const char *pattern = format == CNEDK_MUXER_FORMAT_MPEGTS ? "muxer_test_%d.ts" : "muxer_test_%d.mp4";
+    CnedkMuxerCreateParams params = DefaultParams(format, CNEDK_VENC_TYPE_H264, pattern);
+    // each loop of the test stream is one GOP, so a segment ends at the first key frame after 1ms
+    params.segment_duration_ms = 1;
+    int frame_count = MuxFile(test_h264, &params, kLoops);
+    ASSERT_GT(frame_count, 0);
+
+    int total = 0;
+    for (int i = 0; i < kLoops; ++i) {
+      char path[64];
+      snprintf(path, sizeof(path), pattern, i);
+      // every segment starts with a key frame and is playable on its own
+      int count = CountFrames(path, 1920, 1080);
+      EXPECT_EQ(count, frame_count / kLoops);
+      total += count;
+      remove(path);
+    }
+    EXPECT_EQ(total, frame_count);
+    char path[64];
+    snprintf(path, sizeof(path), pattern, kLoops);
+    EXPECT_FALSE(std::ifstream(path).good());
+  }
+}
+
+TEST(Muxer, PathWithoutRotation) {
+  // path is not formatted if segments are not rotated
+  const char *path = "muxer_test_100%_%s.ts";
+  CnedkMuxerCreateParams params = DefaultParams(CNEDK_MUXER_FORMAT_MPEGTS, CNEDK_VENC_TYPE_H264, path);
+  int frame_count = MuxFile(test_h264, &params, 1);
+  ASSERT_GT(frame_count, 0);
+  EXPECT_TRUE(CheckTs(ReadFile(path)));
+  remove(path);
+}
+
+TEST(Muxer, InvalidParams) {
+  void *muxer = nullptr;
+  CnedkMuxerCreateParams params = DefaultParams(CNEDK_MUXER_FORMAT_MPEGTS, CNEDK_VENC_TYPE_JPEG, "muxer_test.ts");
+  EXPECT_EQ(CnedkMuxerCreate(&muxer, &params), -1);
+  params = DefaultParams(CNEDK_MUXER_FORMAT_INVALID, CNEDK_VENC_TYPE_H264, "muxer_test.ts");
+  EXPECT_EQ(CnedkMuxerCreate(&muxer, &params), -1);
+  // rotation without segment index in path
+  params = DefaultParams(CNEDK_MUXER_FORMAT_MPEGTS, CNEDK_VENC_TYPE_H264, "muxer_test.ts");
+  params.segment_size = 1 << 20;
+  EXPECT_EQ(CnedkMuxerCreate(&muxer, &params), -1);
+  // path is not a safe format of one index
+  for (const char *path : {"muxer_test_%s.ts", "muxer_test_%d_%d.ts", "muxer_100%_%d.ts", "muxer_test_%ld.ts"}) {
+    params.file_path = path;
+    EXPECT_EQ(CnedkMuxerCreate(&muxer, &params), -1) << path;
+  }
+  EXPECT_EQ(CnedkMuxerWrite(nullptr, nullptr), -1);
+  EXPECT_EQ(CnedkMuxerDestroy(nullptr), -1);
+}
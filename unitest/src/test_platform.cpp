@@ -20,13 +20,18 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "cnrt.h"
 
+#include "cnedk_buf_surface.h"
 #include "cnedk_platform.h"
+#include "cnedk_platform_caps.hpp"
 
 #include "test_base.h"
 
@@ -66,3 +71,121 @@ TEST(Platform, GetInfo) {
   CnedkPlatformInfo platform_info;
   ASSERT_EQ(CnedkPlatformGetInfo(device_id, &platform_info), 0);
 }
+
+TEST(Platform, DeviceCaps) {
+  cnedk::DeviceCaps cloud = cnedk::DeviceCaps::Make(0, "MLU370", false, false);
+  EXPECT_EQ(cloud.DefaultMemType(), CNEDK_BUF_MEM_DEVICE);
+  EXPECT_TRUE(cloud.SupportMemType(CNEDK_BUF_MEM_DEFAULT));
+  EXPECT_TRUE(cloud.SupportMemType(CNEDK_BUF_MEM_DEVICE));
+  EXPECT_TRUE(cloud.SupportMemType(CNEDK_BUF_MEM_SYSTEM));
+  EXPECT_FALSE(cloud.SupportMemType(CNEDK_BUF_MEM_PINNED));
+  EXPECT_FALSE(cloud.SupportMemType(CNEDK_BUF_MEM_UNIFIED));
+  EXPECT_FALSE(cloud.SupportMemType(CNEDK_BUF_MEM_VB));
+  EXPECT_EQ(cloud.decode.max_width, 7680u);
+  EXPECT_EQ(cloud.decode.max_height, 4320u);
+  EXPECT_TRUE(cnedk::DeviceCaps::Make(0, "MLU370", false, true).SupportMemType(CNEDK_BUF_MEM_PINNED));
+
+  cnedk::DeviceCaps edge = cnedk::DeviceCaps::Make(0, "CE3226", true, true);
+  EXPECT_EQ(edge.DefaultMemType(), CNEDK_BUF_MEM_UNIFIED);
+  EXPECT_TRUE(edge.SupportMemType(CNEDK_BUF_MEM_UNIFIED_CACHED));
+  EXPECT_TRUE(edge.SupportMemType(CNEDK_BUF_MEM_VB));
+  EXPECT_FALSE(edge.SupportMemType(CNEDK_BUF_MEM_PINNED));
+  EXPECT_EQ(edge.decode.max_instances, 16u);
+  EXPECT_EQ(edge.encode.max_instances, 16u);
+}
+
+TEST(Platform, Topology) {
+  cnedk::CpuTopology topology = cnedk::PlatformCaps::Instance().Topology();
+  EXPECT_GT(topology.logical_cores, 0);
+  EXPECT_GT(topology.physical_cores, 0);
+  EXPECT_LE(topology.physical_cores, topology.logical_cores);
+  ASSERT_FALSE(topology.numa_nodes.empty());
+  size_t cpu_num = 0;
+  for (const cnedk::NumaNode &node : topology.numa_nodes) cpu_num += node.cpus.size();
+  EXPECT_EQ(cpu_num, static_cast<size_t>(topology.logical_cores));
+  EXPECT_FALSE(cnedk::PlatformCaps::Instance().DeviceCpus(device_id).empty());
+}
+
+static cnedk::CpuTopology FakeTopology() {
+  cnedk::CpuTopology topology;
+  topology.logical_cores = 8;
+  topology.physical_cores = 4;
+  topology.numa_nodes.resize(2);
+  topology.numa_nodes[0].id = 0;
+  topology.numa_nodes[0].cpus = {0, 1, 2, 3};
+  topology.numa_nodes[1].id = 1;
+  topology.numa_nodes[1].cpus = {4, 5, 6, 7};
+  return topology;
+}
+
+TEST(Platform, InjectFakeDevices) {
+  cnedk::PlatformCaps &caps = cnedk::PlatformCaps::Instance();
+  std::vector<cnedk::DeviceCaps> devices = {cnedk::DeviceCaps::Make(0, "MLU370", false, false),
+                                            cnedk::DeviceCaps::Make(1, "CE3226", true, true)};
+  devices[0].numa_node = 1;
+  caps.Inject(devices, FakeTopology());
+
+  EXPECT_EQ(caps.DeviceCount(), 2);
+  EXPECT_EQ(caps.GetDevice(2), nullptr);
+  EXPECT_EQ(caps.GetDevice(-1), nullptr);
+
+  CnedkPlatformInfo info;
+  ASSERT_EQ(CnedkPlatformGetInfo(1, &info), 0);
+  EXPECT_STREQ(info.name, "CE3226");
+  EXPECT_EQ(info.support_unified_addr, 1);
+  EXPECT_EQ(info.can_map_host_memory, 1);
+  EXPECT_EQ(CnedkPlatformGetInfo(2, &info), -1);
+  EXPECT_TRUE(cnedk::IsCloudPlatform(0));
+  EXPECT_TRUE(cnedk::IsEdgePlatform(1));
+  EXPECT_FALSE(cnedk::IsEdgePlatform(2));
+
+  EXPECT_EQ(caps.Topology().physical_cores, 4);
+  EXPECT_EQ(caps.DeviceCpus(0), std::vector<int>({4, 5, 6, 7}));
+  EXPECT_EQ(caps.DeviceCpus(1), std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7}));
+
+  // rejected by the capabilities before touching the device
+  CnedkBufSurfaceCreateParams params;
+  memset(&params, 0, sizeof(params));
+  params.device_id = 0;
+  params.width = 64;
+  params.height = 64;
+  params.batch_size = 1;
+  params.color_format = CNEDK_BUF_COLOR_FORMAT_NV12;
+  params.mem_type = CNEDK_BUF_MEM_PINNED;
+  CnedkBufSurface *surf = nullptr;
+  EXPECT_EQ(CnedkBufSurfaceCreate(&surf, &params), -1);
+  params.device_id = 2;
+  params.mem_type = CNEDK_BUF_MEM_DEVICE;
+  EXPECT_EQ(CnedkBufSurfaceCreate(&surf, &params), -1);
+
+  caps.Reset();
+}
+
+TEST(Platform, InjectWhileQuerying) {
+  cnedk::PlatformCaps &caps = cnedk::PlatformCaps::Instance();
+  std::vector<cnedk::DeviceCaps> cloud = {cnedk::DeviceCaps::Make(0, "MLU370", false, false)};
+  std::vector<cnedk::DeviceCaps> edge = {cnedk::DeviceCaps::Make(0, "CE3226", true, true)};
+  caps.Inject(cloud, FakeTopology());
+
+  std::atomic<bool> running{true};
+  std::atomic<int> failed{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      while (running.load()) {
+        const cnedk::DeviceCaps *dev = caps.GetDevice(0);
+        CnedkPlatformInfo info;
+        if (!dev || (dev->name != "MLU370" && dev->name != "CE3226") || CnedkPlatformGetInfo(0, &info) != 0 ||
+            (info.support_unified_addr != 0) != cnedk::IsEdgePlatform(std::string(info.name))) {
+          ++failed;
+        }
+      }
+    });
+  }
+  for (int i = 0; i < 1000; ++i) caps.Inject(i % 2 ? cloud : edge, FakeTopology());
+  running = false;
+  for (auto &reader : readers) reader.join();
+  EXPECT_EQ(failed.load(), 0);
+
+  caps.Reset();
+}
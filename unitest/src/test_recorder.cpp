@@ -0,0 +1,197 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "cnedk_recorder.h"
+
+#include "ffmpeg_demuxer.h"
+
+static const char *test_h264 = "../../unitest/data/img.h264";
+
+namespace {
+
+// the test stream is one GOP of 5 frames, 200ms at 25 fps
+constexpr int kGopLength = 5;
+constexpr uint64_t kFrameDuration = 3600;  // 90kHz
+
+std::vector<std::vector<uint8_t>> LoadPackets(const char *path) {
+  std::vector<std::vector<uint8_t>> packets;
+  FFmpegDemuxer demuxer(path);
+  uint8_t *data = nullptr;
+  int size = 0;
+  while (demuxer.ReadFrame(&data, &size)) packets.emplace_back(data, data + size);
+  return packets;
+}
+
+int CountFrames(const std::string &path) {
+  FFmpegDemuxer demuxer(path.c_str());
+  uint8_t *data = nullptr;
+  int size = 0;
+  int frame_count = 0;
+  while (demuxer.ReadFrame(&data, &size)) frame_count++;
+  return frame_count;
+}
+
+void OnClipDone(const char *file_path, void *userdata) {
+  static_cast<std::vector<std::string> *>(userdata)->push_back(file_path);
+}
+
+class RecorderTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    packets_ = LoadPackets(test_h264);
+    ASSERT_EQ(packets_.size(), static_cast<size_t>(kGopLength));
+  }
+  void TearDown() override {
+    for (const auto &path : clips_) remove(path.c_str());
+  }
+
+  CnedkRecorderCreateParams Params(const char *path, uint32_t pre_ms, uint32_t post_ms) {
+    CnedkRecorderCreateParams params;
+    memset(&params, 0, sizeof(params));
+    params.muxer_params.format = strstr(path, ".ts") ? CNEDK_MUXER_FORMAT_MPEGTS : CNEDK_MUXER_FORMAT_FMP4;
+    params.muxer_params.codec_type = CNEDK_VENC_TYPE_H264;
+    params.muxer_params.width = 1920;
+    params.muxer_params.height = 1080;
+    params.muxer_params.frame_rate = 25;
+    params.muxer_params.file_path = path;
+    params.pre_record_ms = pre_ms;
+    params.post_record_ms = post_ms;
+    params.OnClipDone = OnClipDone;
+    params.userdata = &clips_;
+    return params;
+  }
+
+  // Writes frame `index` of a stream made by repeating the test GOP
+  int WriteFrame(void *recorder, int index) {
+    auto &packet = packets_[index % kGopLength];
+    CnedkVEncFrameBits frame_bits;
+    memset(&frame_bits, 0, sizeof(frame_bits));
+    frame_bits.bits = packet.data();
+    frame_bits.len = packet.size();
+    frame_bits.pts = index * kFrameDuration;
+    frame_bits.pkt_type = index % kGopLength ? CNEDK_VENC_PACKAGE_TYPE_FRAME : CNEDK_VENC_PACKAGE_TYPE_KEY_FRAME;
+    return CnedkRecorderWrite(recorder, &frame_bits);
+  }
+
+  std::vector<std::vector<uint8_t>> packets_;
+  std::vector<std::string> clips_;
+};
+
+}  // namespace
+
+TEST_F(RecorderTest, PreAndPostRoll) {
+  CnedkRecorderCreateParams params = Params("recorder_test_%d.mp4", 400, 400);
+  void *recorder = nullptr;
+  ASSERT_EQ(CnedkRecorderCreate(&recorder, &params), 0);
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(WriteFrame(recorder, i), 0);
+    // trigger at 2000ms, the clip is from the key frame at 1600ms to the frame at 2400ms
+    if (i == 50) {
+      ASSERT_EQ(CnedkRecorderTrigger(recorder), 0);
+    }
+  }
+  // clips are closed in background, all of them are done after destroy
+  EXPECT_EQ(CnedkRecorderDestroy(recorder), 0);
+  ASSERT_EQ(clips_.size(), 1u);
+  EXPECT_EQ(CountFrames(clips_[0]), 21);
+}
+
+TEST_F(RecorderTest, TriggerSchedule) {
+  CnedkRecorderCreateParams params = Params("recorder_test_%d.ts", 400, 400);
+  void *recorder = nullptr;
+  ASSERT_EQ(CnedkRecorderCreate(&recorder, &params), 0);
+  const std::vector<int> triggers = {51, 58, 92};
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(WriteFrame(recorder, i), 0);
+    for (int it : triggers) {
+      if (i == it) {
+        ASSERT_EQ(CnedkRecorderTrigger(recorder), 0);
+      }
+    }
+  }
+  EXPECT_EQ(CnedkRecorderDestroy(recorder), 0);
+  ASSERT_EQ(clips_.size(), 2u);
+  // the second trigger extends the first clip to 2720ms: frames 40 to 68
+  EXPECT_EQ(CountFrames(clips_[0]), 29);
+  // the last clip starts at 3200ms and is finished by destroy
+  EXPECT_EQ(CountFrames(clips_[1]), 20);
+}
+
+TEST_F(RecorderTest, TriggerBeforeKeyFrame) {
+  CnedkRecorderCreateParams params = Params("recorder_test_%d.mp4", 400, 400);
+  void *recorder = nullptr;
+  ASSERT_EQ(CnedkRecorderCreate(&recorder, &params), 0);
+  ASSERT_EQ(CnedkRecorderTrigger(recorder), 0);
+  // the clip starts at the first key frame at 200ms, and ends at 400ms after the trigger
+  for (int i = 3; i < 40; ++i) ASSERT_EQ(WriteFrame(recorder, i), 0);
+  EXPECT_EQ(CnedkRecorderDestroy(recorder), 0);
+  ASSERT_EQ(clips_.size(), 1u);
+  EXPECT_EQ(CountFrames(clips_[0]), 6);
+}
+
+TEST_F(RecorderTest, InvalidPath) {
+  void *recorder = nullptr;
+  for (const char *path : {"recorder_test.mp4", "recorder_test_%s.mp4", "recorder_test_%d_%d.mp4",
+                           "recorder_100%_%d.mp4"}) {
+    CnedkRecorderCreateParams params = Params(path, 400, 400);
+    EXPECT_EQ(CnedkRecorderCreate(&recorder, &params), -1) << path;
+  }
+}
+
+TEST_F(RecorderTest, MemoryLimit) {
+  uint64_t gop_size = 0;
+  for (const auto &packet : packets_) gop_size += packet.size();
+  const uint64_t limit = gop_size * 3;
+  ASSERT_EQ(CnedkRecorderSetMemoryLimit(limit), 0);
+
+  CnedkRecorderCreateParams params_a = Params("recorder_test_a_%d.mp4", 10000, 0);
+  CnedkRecorderCreateParams params_b = Params("recorder_test_b_%d.mp4", 10000, 0);
+  void *recorder_a = nullptr, *recorder_b = nullptr;
+  ASSERT_EQ(CnedkRecorderCreate(&recorder_a, &params_a), 0);
+  ASSERT_EQ(CnedkRecorderCreate(&recorder_b, &params_b), 0);
+  uint64_t usage = 0;
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(WriteFrame(recorder_a, i), 0);
+    ASSERT_EQ(WriteFrame(recorder_b, i), 0);
+    ASSERT_EQ(CnedkRecorderGetMemoryUsage(&usage), 0);
+    EXPECT_LE(usage, limit);
+  }
+  ASSERT_EQ(CnedkRecorderTrigger(recorder_a), 0);
+  EXPECT_EQ(CnedkRecorderDestroy(recorder_a), 0);
+  EXPECT_EQ(CnedkRecorderDestroy(recorder_b), 0);
+  ASSERT_EQ(CnedkRecorderGetMemoryUsage(&usage), 0);
+  EXPECT_EQ(usage, 0u);
+
+  // the clip holds whole GOPs kept within the share of the recorder
+  ASSERT_EQ(clips_.size(), 1u);
+  int frame_count = CountFrames(clips_[0]);
+  EXPECT_GT(frame_count, 0);
+  EXPECT_EQ(frame_count % kGopLength, 0);
+  EXPECT_LE(frame_count, 2 * kGopLength);
+  CnedkRecorderSetMemoryLimit(256ull << 20);
+}
@@ -0,0 +1,336 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+#include "cnedk_stream_supervisor.hpp"
+
+#include "ffmpeg_demuxer.h"
+
+static const char *test_h264 = "../../unitest/data/img.h264";
+
+namespace {
+
+using cnedk::StreamHealth;
+
+// the test stream is one GOP of 5 frames
+constexpr uint32_t kGopLength = 5;
+
+std::vector<std::vector<uint8_t>> LoadPackets(const char *path) {
+  std::vector<std::vector<uint8_t>> packets;
+  FFmpegDemuxer demuxer(path);
+  uint8_t *data = nullptr;
+  int size = 0;
+  while (demuxer.ReadFrame(&data, &size)) packets.emplace_back(data, data + size);
+  return packets;
+}
+
+// Serves the test GOP repeatedly, every connection starts from a key frame and ends after a number of packets.
+// Faults are injected at scheduled packets, which are counted over all connections.
+class FaultSource : public cnedk::StreamSource {
+ public:
+  enum class Fault {
+    // blocks before the packet is returned
+    STALL,
+    // the connection is lost
+    DROP,
+    // the packet is cut in half
+    TRUNCATE,
+    // bytes of the packet are flipped
+    CORRUPT
+  };
+
+  FaultSource(const std::vector<std::vector<uint8_t>> &gop, uint32_t packets_per_connection)
+      : gop_(gop), packets_per_connection_(packets_per_connection) {}
+
+  void Schedule(uint32_t packet_index, Fault fault, uint32_t stall_ms = 0) {
+    faults_[packet_index] = std::make_pair(fault, stall_ms);
+  }
+  // Open with index in [first, first + count) fails
+  void FailOpens(uint32_t first, uint32_t count) {
+    fail_open_first_ = first;
+    fail_open_count_ = count;
+  }
+
+  bool Open() override {
+    std::lock_guard<std::mutex> lk(mutex_);
+    uint32_t index = open_count_++;
+    if (index >= fail_open_first_ && index - fail_open_first_ < fail_open_count_) return false;
+    index_ = 0;
+    return !interrupted_;
+  }
+
+  cnedk::StreamReadStatus Read(cnedk::StreamPacket *packet) override {
+    std::unique_lock<std::mutex> lk(mutex_);
+    if (interrupted_) return cnedk::StreamReadStatus::ERROR;
+    if (index_ >= packets_per_connection_) return cnedk::StreamReadStatus::EOS;
+    data_ = gop_[index_ % kGopLength];
+    packet->key_frame = index_ % kGopLength == 0;
+    packet->pts = total_ * 3600;
+    index_++;
+    auto it = faults_.find(total_++);
+    if (it != faults_.end()) {
+      switch (it->second.first) {
+        case Fault::STALL:
+          if (cond_.wait_for(lk, std::chrono::milliseconds(it->second.second), [this] { return interrupted_; })) {
+            return cnedk::StreamReadStatus::ERROR;
+          }
+          break;
+        case Fault::DROP:
+          return cnedk::StreamReadStatus::ERROR;
+        case Fault::TRUNCATE:
+          data_.resize(data_.size() / 2);
+          break;
+        case Fault::CORRUPT:
+          for (size_t i = 8; i < data_.size(); i += 16) data_[i] ^= 0xa5;
+          break;
+      }
+    }
+    packet->data = data_.data();
+    packet->size = data_.size();
+    return cnedk::StreamReadStatus::OK;
+  }
+
+  void Close() override {
+    std::lock_guard<std::mutex> lk(mutex_);
+    interrupted_ = false;
+  }
+
+  void Interrupt() override {
+    std::lock_guard<std::mutex> lk(mutex_);
+    interrupted_ = true;
+    cond_.notify_all();
+  }
+
+ private:
+  const std::vector<std::vector<uint8_t>> &gop_;
+  uint32_t packets_per_connection_;
+  std::map<uint32_t, std::pair<Fault, uint32_t>> faults_;
+  uint32_t fail_open_first_ = 0;
+  uint32_t fail_open_count_ = 0;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool interrupted_ = false;
+  uint32_t open_count_ = 0;
+  uint32_t index_ = 0;
+  uint32_t total_ = 0;
+  std::vector<uint8_t> data_;
+};
+
+// Acts as a decoder, which fails on packets different from the test GOP
+class CheckingSink : public cnedk::StreamSink {
+ public:
+  explicit CheckingSink(const std::vector<std::vector<uint8_t>> &gop) : gop_(gop) {}
+
+  bool OnPacket(const cnedk::StreamPacket &packet) override {
+    if (wait_key_frame_) {
+      EXPECT_TRUE(packet.key_frame);
+      wait_key_frame_ = false;
+    }
+    for (const auto &expected : gop_) {
+      if (expected.size() == packet.size && std::equal(expected.begin(), expected.end(), packet.data)) {
+        accepted_++;
+        return true;
+      }
+    }
+    return false;
+  }
+  void OnReset() override {
+    reset_count_++;
+    wait_key_frame_ = true;
+  }
+  void OnEos() override { eos_count_++; }
+
+  uint32_t accepted_ = 0;
+  uint32_t reset_count_ = 0;
+  uint32_t eos_count_ = 0;
+
+ private:
+  const std::vector<std::vector<uint8_t>> &gop_;
+  bool wait_key_frame_ = true;
+};
+
+class StreamSupervisorTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    gop_ = LoadPackets(test_h264);
+    ASSERT_EQ(gop_.size(), kGopLength);
+    params_.stall_timeout_ms = 50;
+    params_.reconnect_timeout_ms = 300;
+    params_.connect_timeout_ms = 300;
+    params_.initial_backoff_ms = 10;
+    params_.max_backoff_ms = 40;
+    params_.backoff_multiplier = 2;
+    params_.max_packet_errors = 3;
+    params_.reconnect_on_eos = false;
+    params_.on_event = [this](const cnedk::StreamHealthEvent &event) {
+      std::lock_guard<std::mutex> lk(mutex_);
+      events_.push_back(event);
+    };
+  }
+
+  std::vector<StreamHealth> States() {
+    std::lock_guard<std::mutex> lk(mutex_);
+    std::vector<StreamHealth> states;
+    for (const auto &event : events_) states.push_back(event.to);
+    return states;
+  }
+
+  std::vector<std::vector<uint8_t>> gop_;
+  cnedk::StreamSupervisorParams params_;
+  std::mutex mutex_;
+  std::vector<cnedk::StreamHealthEvent> events_;
+};
+
+}  // namespace
+
+TEST_F(StreamSupervisorTest, StallAndRecover) {
+  FaultSource source(gop_, 20);
+  source.Schedule(7, FaultSource::Fault::STALL, 150);
+  CheckingSink sink(gop_);
+  cnedk::StreamSupervisor supervisor(&source, &sink, params_);
+  supervisor.Start();
+  ASSERT_TRUE(supervisor.Wait(5000));
+
+  std::vector<StreamHealth> expected = {StreamHealth::LIVE, StreamHealth::STALLED, StreamHealth::LIVE};
+  EXPECT_EQ(States(), expected);
+  EXPECT_EQ(events_[2].reason, "packets resumed");
+  EXPECT_EQ(supervisor.GetReconnectCount(), 0u);
+  EXPECT_EQ(sink.accepted_, 20u);
+  EXPECT_EQ(sink.reset_count_, 0u);
+  EXPECT_EQ(sink.eos_count_, 1u);
+}
+
+TEST_F(StreamSupervisorTest, StallTimeoutReconnects) {
+  FaultSource source(gop_, 20);
+  source.Schedule(7, FaultSource::Fault::STALL, 60000);
+  CheckingSink sink(gop_);
+  cnedk::StreamSupervisor supervisor(&source, &sink, params_);
+  auto start = std::chrono::steady_clock::now();
+  supervisor.Start();
+  ASSERT_TRUE(supervisor.Wait(5000));
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  std::vector<StreamHealth> expected = {StreamHealth::LIVE, StreamHealth::STALLED, StreamHealth::RECONNECTING,
+                                        StreamHealth::LIVE};
+  EXPECT_EQ(States(), expected);
+  EXPECT_EQ(events_[2].reason, "no packet received before timeout");
+  EXPECT_GE(elapsed, std::chrono::milliseconds(params_.reconnect_timeout_ms));
+  EXPECT_EQ(supervisor.GetReconnectCount(), 1u);
+  // the stalled packet is lost with the first connection
+  EXPECT_EQ(sink.accepted_, 27u);
+  EXPECT_EQ(sink.reset_count_, 1u);
+  EXPECT_EQ(sink.eos_count_, 1u);
+}
+
+TEST_F(StreamSupervisorTest, ExponentialBackoff) {
+  FaultSource source(gop_, 20);
+  source.Schedule(5, FaultSource::Fault::DROP);
+  source.FailOpens(1, 3);
+  CheckingSink sink(gop_);
+  cnedk::StreamSupervisor supervisor(&source, &sink, params_);
+  supervisor.Start();
+  ASSERT_TRUE(supervisor.Wait(5000));
+
+  std::vector<StreamHealth> expected = {StreamHealth::LIVE, StreamHealth::RECONNECTING, StreamHealth::RECONNECTING,
+                                        StreamHealth::RECONNECTING, StreamHealth::RECONNECTING, StreamHealth::LIVE};
+  ASSERT_EQ(States(), expected);
+  EXPECT_EQ(events_[1].reason, "read failed");
+  EXPECT_EQ(events_[2].reason, "open failed");
+  const std::vector<uint32_t> backoffs = {10, 20, 40, 40};
+  for (size_t i = 0; i < backoffs.size(); ++i) {
+    EXPECT_EQ(events_[i + 1].retry_count, i + 1);
+    EXPECT_EQ(events_[i + 1].backoff_ms, backoffs[i]);
+  }
+  EXPECT_EQ(events_[5].retry_count, 0u);
+  EXPECT_EQ(supervisor.GetReconnectCount(), 4u);
+  // the decoder is reset only if the connection has been made
+  EXPECT_EQ(sink.reset_count_, 1u);
+  EXPECT_EQ(sink.accepted_, 25u);
+  EXPECT_EQ(sink.eos_count_, 1u);
+}
+
+TEST_F(StreamSupervisorTest, CorruptPackets) {
+  FaultSource source(gop_, 30);
+  // a single bad packet is tolerated, three in a row drop the connection
+  source.Schedule(3, FaultSource::Fault::CORRUPT);
+  source.Schedule(10, FaultSource::Fault::TRUNCATE);
+  source.Schedule(11, FaultSource::Fault::TRUNCATE);
+  source.Schedule(12, FaultSource::Fault::CORRUPT);
+  CheckingSink sink(gop_);
+  cnedk::StreamSupervisor supervisor(&source, &sink, params_);
+  supervisor.Start();
+  ASSERT_TRUE(supervisor.Wait(5000));
+
+  std::vector<StreamHealth> expected = {StreamHealth::LIVE, StreamHealth::RECONNECTING, StreamHealth::LIVE};
+  ASSERT_EQ(States(), expected);
+  EXPECT_EQ(events_[1].reason, "3 packets failed in a row");
+  EXPECT_EQ(sink.accepted_, 9u + 30u);
+  EXPECT_EQ(sink.reset_count_, 1u);
+  EXPECT_EQ(sink.eos_count_, 1u);
+}
+
+TEST_F(StreamSupervisorTest, FailAfterMaxRetries) {
+  FaultSource source(gop_, 20);
+  source.FailOpens(0, 100);
+  CheckingSink sink(gop_);
+  params_.max_retries = 2;
+  cnedk::StreamSupervisor supervisor(&source, &sink, params_);
+  supervisor.Start();
+  ASSERT_TRUE(supervisor.Wait(5000));
+
+  std::vector<StreamHealth> expected = {StreamHealth::RECONNECTING, StreamHealth::RECONNECTING, StreamHealth::FAILED};
+  ASSERT_EQ(States(), expected);
+  EXPECT_EQ(events_[0].from, StreamHealth::CONNECTING);
+  EXPECT_EQ(events_[2].retry_count, 3u);
+  EXPECT_EQ(supervisor.GetHealth(), StreamHealth::FAILED);
+  EXPECT_EQ(sink.reset_count_, 0u);
+  EXPECT_EQ(sink.eos_count_, 1u);
+}
+
+TEST_F(StreamSupervisorTest, LiveStreamAndStop) {
+  FaultSource source(gop_, 10);
+  source.Schedule(25, FaultSource::Fault::STALL, 60000);
+  CheckingSink sink(gop_);
+  params_.reconnect_on_eos = true;
+  params_.reconnect_timeout_ms = 60000;
+  cnedk::StreamSupervisor supervisor(&source, &sink, params_);
+  supervisor.Start();
+  // end of stream is a lost connection for live streams
+  EXPECT_FALSE(supervisor.Wait(500));
+  EXPECT_EQ(supervisor.GetHealth(), StreamHealth::STALLED);
+  EXPECT_EQ(supervisor.GetReconnectCount(), 2u);
+  // the stalled read is interrupted
+  auto start = std::chrono::steady_clock::now();
+  supervisor.Stop();
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+  EXPECT_EQ(sink.accepted_, 25u);
+  EXPECT_EQ(sink.reset_count_, 2u);
+  EXPECT_EQ(sink.eos_count_, 0u);
+}
@@ -0,0 +1,198 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <vector>
+
+#include "cnedk_stream_timing.hpp"
+
+namespace {
+
+using cnedk::kNoPts;
+using cnedk::StreamTiming;
+using cnedk::StreamTimingParams;
+
+constexpr int64_t kFrame = 3600;  // 25 fps in 90 kHz
+
+std::vector<int64_t> Convert(StreamTiming *timing, const std::vector<int64_t> &pts) {
+  std::vector<int64_t> media_times;
+  for (int64_t p : pts) media_times.push_back(timing->ToMediaTime(p));
+  return media_times;
+}
+
+}  // namespace
+
+TEST(StreamTiming, TimeBase) {
+  StreamTimingParams params;
+  params.time_base_den = 1000;
+  StreamTiming timing(params);
+  // the media clock starts from 0
+  EXPECT_EQ(Convert(&timing, {5000, 5040, 5080, 5120}), std::vector<int64_t>({0, 3600, 7200, 10800}));
+
+  params.time_base_num = 1001;
+  params.time_base_den = 30000;
+  params.frame_rate = 30000.0 / 1001;
+  StreamTiming ntsc(params);
+  EXPECT_EQ(Convert(&ntsc, {0, 1, 2, 3}), std::vector<int64_t>({0, 3003, 6006, 9009}));
+}
+
+TEST(StreamTiming, Wraparound) {
+  StreamTimingParams params;
+  params.pts_wrap_bits = 33;
+  StreamTiming timing(params);
+  const int64_t range = int64_t(1) << 33;
+  std::vector<int64_t> pts;
+  for (int i = -3; i < 3; ++i) pts.push_back((range + i * kFrame) % range);
+  EXPECT_EQ(Convert(&timing, pts), std::vector<int64_t>({0, 3600, 7200, 10800, 14400, 18000}));
+  EXPECT_EQ(timing.GetWrapCount(), 1u);
+  EXPECT_EQ(timing.GetDiscontinuityCount(), 0u);
+
+  // a reordered frame from before the wraparound
+  EXPECT_EQ(timing.ToMediaTime(range - kFrame), 7200);
+  EXPECT_EQ(timing.ToMediaTime(3 * kFrame), 21600);
+}
+
+TEST(StreamTiming, Reorder) {
+  StreamTiming timing;
+  // I P B B P B B in decoding order
+  std::vector<int64_t> pts = {0, 3, 1, 2, 6, 4, 5};
+  for (auto &p : pts) p = p * kFrame + 1000;
+  std::vector<int64_t> expected = {0, 3, 1, 2, 6, 4, 5};
+  for (auto &e : expected) e *= kFrame;
+  EXPECT_EQ(Convert(&timing, pts), expected);
+  EXPECT_EQ(timing.GetDiscontinuityCount(), 0u);
+}
+
+TEST(StreamTiming, MissingPts) {
+  StreamTiming timing;
+  EXPECT_EQ(Convert(&timing, {kNoPts, kNoPts, 900000, kNoPts, 900000 + 2 * kFrame}),
+            std::vector<int64_t>({0, 3600, 7200, 10800, 14400}));
+}
+
+TEST(StreamTiming, Discontinuity) {
+  StreamTiming timing;
+  // jumps forward, then backward as the source is looped
+  std::vector<int64_t> pts = {0, kFrame, 2 * kFrame, 90000000, 90000000 + kFrame, 0, kFrame};
+  EXPECT_EQ(Convert(&timing, pts), std::vector<int64_t>({0, 3600, 7200, 10800, 14400, 18000, 21600}));
+  EXPECT_EQ(timing.GetDiscontinuityCount(), 2u);
+
+  // small gaps are kept
+  EXPECT_EQ(timing.ToMediaTime(kFrame + 90000), 111600);
+  EXPECT_EQ(timing.GetDiscontinuityCount(), 2u);
+}
+
+TEST(StreamTiming, Rebase) {
+  StreamTiming timing;
+  EXPECT_EQ(Convert(&timing, {1000, 1000 + kFrame}), std::vector<int64_t>({0, 3600}));
+  // the source is reopened with another time base, pts starts over
+  StreamTimingParams params;
+  params.time_base_den = 1000;
+  timing.Rebase(params);
+  EXPECT_EQ(Convert(&timing, {40, 80}), std::vector<int64_t>({7200, 10800}));
+
+  timing.Reset();
+  EXPECT_EQ(timing.ToMediaTime(5000), 0);
+}
+
+TEST(StreamTiming, CaptureTime) {
+  StreamTiming timing;
+  for (int64_t media_time : {0, 3, 1, 2}) timing.RecordCapture(media_time * kFrame, 1000 + media_time);
+
+  CnedkBufSurface surf;
+  memset(&surf, 0, sizeof(surf));
+  // frames come out in presentation order, the one of media time 1 is dropped by decoder
+  surf.pts = 0;
+  EXPECT_TRUE(timing.Stamp(&surf));
+  EXPECT_EQ(CnedkBufSurfaceGetCaptureTime(&surf), 1000u);
+  surf.pts = 2 * kFrame;
+  EXPECT_TRUE(timing.Stamp(&surf));
+  EXPECT_EQ(CnedkBufSurfaceGetCaptureTime(&surf), 1002u);
+  surf.pts = kFrame;
+  EXPECT_FALSE(timing.Stamp(&surf));
+  EXPECT_EQ(CnedkBufSurfaceGetCaptureTime(&surf), 0u);
+  surf.pts = 3 * kFrame;
+  EXPECT_TRUE(timing.Stamp(&surf));
+  EXPECT_EQ(CnedkBufSurfaceGetCaptureTime(&surf), 1003u);
+}
+
+TEST(PlaybackPacer, Pace) {
+  cnedk::VirtualClock clock(1000000);
+  cnedk::PlaybackPacer pacer(&clock, 1000);
+  EXPECT_EQ(pacer.Pace(0), 0);
+  EXPECT_EQ(clock.NowUs(), 1000000);
+
+  // 10 ms of work for each frame, sleeps the rest of 40 ms
+  for (int i = 1; i <= 25; ++i) {
+    clock.AdvanceUs(10000);
+    EXPECT_EQ(pacer.Pace(i * kFrame), 0);
+    EXPECT_EQ(clock.NowUs(), 1000000 + i * 40000);
+  }
+  EXPECT_EQ(clock.GetSleptUs(), 25 * 30000);
+
+  // 50 ms late, frames are sent at once until caught up
+  clock.AdvanceUs(90000);
+  EXPECT_EQ(pacer.Pace(26 * kFrame), 50000);
+  EXPECT_EQ(pacer.Pace(27 * kFrame), 10000);
+  EXPECT_EQ(pacer.Pace(28 * kFrame), 0);
+  EXPECT_EQ(clock.NowUs(), 1000000 + 28 * 40000);
+
+  // falls behind too much, anchors again
+  clock.AdvanceUs(5000000);
+  EXPECT_GT(pacer.Pace(29 * kFrame), 1000000);
+  int64_t now = clock.NowUs();
+  EXPECT_EQ(pacer.Pace(30 * kFrame), 0);
+  EXPECT_EQ(clock.NowUs(), now + 40000);
+}
+
+TEST(PlaybackPacer, LiveSimulation) {
+  // a looped MPEG-TS source near the pts wraparound is played as a live stream, decoding takes 5 ms
+  cnedk::VirtualClock clock;
+  cnedk::PlaybackPacer pacer(&clock);
+  StreamTimingParams params;
+  params.pts_wrap_bits = 33;
+  StreamTiming timing(params);
+  const int64_t start = (int64_t(1) << 33) - 10 * kFrame;
+
+  int64_t begin = clock.NowUs();
+  int frames = 0;
+  for (int loop = 0; loop < 3; ++loop) {
+    // the source is reopened
+    timing.Rebase(params);
+    for (int i = 0; i < 25; ++i, ++frames) {
+      int64_t pts = (start + i * kFrame) & ((int64_t(1) << 33) - 1);
+      int64_t media_time = timing.ToMediaTime(pts);
+      EXPECT_EQ(media_time, frames * kFrame);
+      pacer.Pace(media_time);
+      timing.RecordCapture(media_time, clock.NowUs());
+
+      clock.AdvanceUs(5000);
+      CnedkBufSurface surf;
+      memset(&surf, 0, sizeof(surf));
+      surf.pts = media_time;
+      ASSERT_TRUE(timing.Stamp(&surf));
+      EXPECT_EQ(clock.NowUs() - static_cast<int64_t>(CnedkBufSurfaceGetCaptureTime(&surf)), 5000);
+    }
+  }
+  EXPECT_EQ(timing.GetWrapCount(), 1u);
+  // a frame every 40 ms across loops
+  EXPECT_EQ(clock.NowUs() - begin, (frames - 1) * 40000 + 5000);
+}
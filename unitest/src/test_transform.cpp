@@ -385,3 +385,67 @@ TEST(Transform, KeepAspectRatio) {
     EXPECT_NE(TestFun(CNEDK_BUF_COLOR_FORMAT_NV21, CNEDK_BUF_COLOR_FORMAT_NV12, 1920, 1080, 224, 224, &params), 0);
   }
 }
+
+TEST(Transform, Host) {
+  auto create = [](CnedkBufSurfaceColorFormat format, uint32_t width, uint32_t height) {
+    CnedkBufSurfaceCreateParams params;
+    memset(&params, 0, sizeof(params));
+    params.mem_type = CNEDK_BUF_MEM_SYSTEM;
+    params.width = width;
+    params.height = height;
+    params.color_format = format;
+    params.batch_size = 1;
+    CnedkBufSurface *surf = nullptr;
+    EXPECT_EQ(CnedkBufSurfaceCreate(&surf, &params), 0);
+    if (surf) surf->num_filled = 1;
+    return surf;
+  };
+  CnedkBufSurface *nv12 = create(CNEDK_BUF_COLOR_FORMAT_NV12, 1920, 1080);
+  CnedkBufSurface *bgr = create(CNEDK_BUF_COLOR_FORMAT_BGR, 300, 200);
+  CnedkBufSurface *nv21 = create(CNEDK_BUF_COLOR_FORMAT_NV21, 64, 64);
+  ASSERT_TRUE(nv12 && bgr && nv21);
+  // pure red in BT.601 video range
+  CnedkBufSurfaceParams &src = nv12->surface_list[0];
+  uint8_t *luma = reinterpret_cast<uint8_t *>(src.data_ptr) + src.plane_params.offset[0];
+  uint8_t *uv = reinterpret_cast<uint8_t *>(src.data_ptr) + src.plane_params.offset[1];
+  memset(luma, 81, src.plane_params.psize[0]);
+  for (uint32_t i = 0; i < src.plane_params.psize[1]; i += 2) {
+    uv[i] = 90;
+    uv[i + 1] = 240;
+  }
+
+  CnedkTransformParams params;
+  memset(&params, 0, sizeof(params));
+  CnedkTransformRect src_rect = {100, 200, 640, 480};
+  params.transform_flag = CNEDK_TRANSFORM_CROP_SRC;
+  params.src_rect = &src_rect;
+  ASSERT_EQ(CnedkTransform(nv12, bgr, &params), 0);
+  CnedkBufSurfaceParams &dst = bgr->surface_list[0];
+  for (uint32_t y = 0; y < dst.height; ++y) {
+    uint8_t *pix = reinterpret_cast<uint8_t *>(dst.data_ptr) + y * dst.plane_params.pitch[0];
+    for (uint32_t x = 0; x < dst.width; ++x, pix += 3) {
+      ASSERT_LE(pix[0], 2);
+      ASSERT_LE(pix[1], 2);
+      ASSERT_GE(pix[2], 253);
+    }
+  }
+
+  params.transform_flag = 0;
+  ASSERT_EQ(CnedkTransform(bgr, nv21, &params), 0);
+  CnedkBufSurfaceParams &yuv = nv21->surface_list[0];
+  uint8_t *vu = reinterpret_cast<uint8_t *>(yuv.data_ptr) + yuv.plane_params.offset[1];
+  EXPECT_NEAR(reinterpret_cast<uint8_t *>(yuv.data_ptr)[yuv.plane_params.offset[0]], 81, 2);
+  EXPECT_NEAR(vu[0], 240, 2);
+  EXPECT_NEAR(vu[1], 90, 2);
+
+  // normalization and rects out of the frame are not supported
+  params.transform_flag = CNEDK_TRANSFORM_MEAN_STD;
+  EXPECT_NE(CnedkTransform(nv12, bgr, &params), 0);
+  src_rect = {1060, 0, 64, 64};
+  params.transform_flag = CNEDK_TRANSFORM_CROP_SRC;
+  EXPECT_NE(CnedkTransform(nv12, bgr, &params), 0);
+
+  CnedkBufSurfaceDestroy(nv12);
+  CnedkBufSurfaceDestroy(bgr);
+  CnedkBufSurfaceDestroy(nv21);
+}
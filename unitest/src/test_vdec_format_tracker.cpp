@@ -0,0 +1,257 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "cnedk_decode.h"
+
+#include "bitstream_parser.hpp"
+#include "vdec_format_tracker.hpp"
+
+namespace {
+
+std::vector<uint8_t> ReadFile(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+struct DecodedFrame {
+  uint32_t width;
+  uint32_t height;
+  uint32_t generation;
+};
+
+// Buffers are allocated in the size of pool, the pool is reallocated when format changes
+struct Consumer {
+  uint32_t pool_width = 0;
+  uint32_t pool_height = 0;
+  bool fail_format_change = false;
+  std::vector<CnedkVdecFormatInfo> format_changes;
+  std::vector<DecodedFrame> frames;
+  int errors = 0;
+
+  static int GetBufSurf(CnedkBufSurface **surf, int width, int height, CnedkBufSurfaceColorFormat fmt,
+                        int timeout_ms, void *userdata) {
+    Consumer *consumer = static_cast<Consumer *>(userdata);
+    *surf = new CnedkBufSurface;
+    memset(*surf, 0, sizeof(CnedkBufSurface));
+    (*surf)->batch_size = 1;
+    (*surf)->num_filled = 1;
+    (*surf)->mem_type = CNEDK_BUF_MEM_SYSTEM;
+    (*surf)->surface_list = new CnedkBufSurfaceParams;
+    memset((*surf)->surface_list, 0, sizeof(CnedkBufSurfaceParams));
+    (*surf)->surface_list[0].width = consumer->pool_width;
+    (*surf)->surface_list[0].height = consumer->pool_height;
+    (*surf)->surface_list[0].color_format = fmt;
+    return 0;
+  }
+  static int OnFrame(CnedkBufSurface *surf, void *userdata) {
+    Consumer *consumer = static_cast<Consumer *>(userdata);
+    consumer->frames.push_back({surf->surface_list[0].width, surf->surface_list[0].height,
+                                CnedkBufSurfaceGetGeneration(surf)});
+    delete surf->surface_list;
+    delete surf;
+    return 0;
+  }
+  static int OnFormatChange(const CnedkVdecFormatInfo *info, void *userdata) {
+    Consumer *consumer = static_cast<Consumer *>(userdata);
+    if (consumer->fail_format_change) return -1;
+    consumer->format_changes.push_back(*info);
+    consumer->pool_width = info->width;
+    consumer->pool_height = info->height;
+    return 0;
+  }
+  static int OnError(int errcode, void *userdata) {
+    static_cast<Consumer *>(userdata)->errors++;
+    return 0;
+  }
+  static int OnEos(void *userdata) { return 0; }
+};
+
+// Decoder backend on CPU. Pictures are not reconstructed, frames in the size of active SPS are output with a delay
+// like hardware decoders do.
+class CpuDecoder {
+ public:
+  CpuDecoder(const CnedkVdecCreateParams &params, size_t delay)
+      : params_(params), parser_(params.type == CNEDK_VDEC_TYPE_H265), delay_(delay) {
+    tracker_.Reset();
+  }
+
+  void SendStream(const std::vector<uint8_t> &stream) {
+    std::vector<cnedk::NalUnit> nalus;
+    cnedk::SplitAnnexB(stream.data(), stream.size(), &nalus);
+    bool hevc = parser_.IsHevc();
+    for (const auto &nalu : nalus) {
+      cnedk::AccessUnitInfo info;
+      std::vector<uint8_t> data = {0, 0, 0, 1};
+      data.insert(data.end(), nalu.data, nalu.data + nalu.size);
+      ASSERT_TRUE(parser_.Parse(data.data(), data.size(), &info));
+      // first_mb_in_slice is 0 or first_slice_segment_in_pic_flag is set
+      if (!cnedk::IsSliceNal(nalu, hevc) || !(nalu.data[hevc ? 2 : 1] & 0x80)) continue;
+      pending_.push_back(*parser_.GetSps());
+      if (pending_.size() > delay_) Output();
+    }
+  }
+
+  void SendEos() {
+    while (!pending_.empty()) Output();
+    params_.OnEos(params_.userdata);
+  }
+
+ private:
+  void Output() {
+    cnedk::SpsInfo sps = pending_.front();
+    pending_.pop_front();
+    if (tracker_.Update(params_, sps.width, sps.height, params_.color_format) < 0) {
+      params_.OnError(-1, params_.userdata);
+      return;
+    }
+    CnedkBufSurface *surf = nullptr;
+    ASSERT_EQ(params_.GetBufSurf(&surf, sps.width, sps.height, params_.color_format, params_.surf_timeout_ms,
+                                 params_.userdata), 0);
+    tracker_.Stamp(surf);
+    params_.OnFrame(surf, params_.userdata);
+  }
+
+  CnedkVdecCreateParams params_;
+  cnedk::BitstreamParser parser_;
+  cnedk::VdecFormatTracker tracker_;
+  std::deque<cnedk::SpsInfo> pending_;
+  size_t delay_;
+};
+
+CnedkVdecCreateParams MakeParams(Consumer *consumer) {
+  CnedkVdecCreateParams params{};
+  params.type = CNEDK_VDEC_TYPE_H264;
+  params.color_format = CNEDK_BUF_COLOR_FORMAT_NV12;
+  params.max_width = 256;
+  params.max_height = 256;
+  params.surf_timeout_ms = 5000;
+  params.GetBufSurf = &Consumer::GetBufSurf;
+  params.OnFrame = &Consumer::OnFrame;
+  params.OnEos = &Consumer::OnEos;
+  params.OnError = &Consumer::OnError;
+  params.OnFormatChange = &Consumer::OnFormatChange;
+  params.userdata = consumer;
+  consumer->pool_width = params.max_width;
+  consumer->pool_height = params.max_height;
+  return params;
+}
+
+}  // namespace
+
+TEST(VdecFormatTracker, Update) {
+  Consumer consumer;
+  CnedkVdecCreateParams params = MakeParams(&consumer);
+  cnedk::VdecFormatTracker tracker;
+  EXPECT_EQ(tracker.Update(params, 256, 256, CNEDK_BUF_COLOR_FORMAT_NV12), 0);
+  EXPECT_EQ(tracker.Update(params, 256, 256, CNEDK_BUF_COLOR_FORMAT_NV12), 0);
+  EXPECT_EQ(tracker.Generation(), 0u);
+  EXPECT_TRUE(consumer.format_changes.empty());
+
+  EXPECT_EQ(tracker.Update(params, 256, 256, CNEDK_BUF_COLOR_FORMAT_NV21), 1);
+  EXPECT_EQ(tracker.Update(params, 1920, 1080, CNEDK_BUF_COLOR_FORMAT_NV21), 1);
+  EXPECT_EQ(tracker.Generation(), 2u);
+  ASSERT_EQ(consumer.format_changes.size(), 2u);
+  EXPECT_EQ(consumer.format_changes[1].width, 1920u);
+  EXPECT_EQ(consumer.format_changes[1].height, 1080u);
+  EXPECT_EQ(consumer.format_changes[1].color_format, CNEDK_BUF_COLOR_FORMAT_NV21);
+  EXPECT_EQ(consumer.format_changes[1].generation, 2u);
+
+  CnedkBufSurface surf;
+  memset(&surf, 0, sizeof(surf));
+  tracker.Stamp(&surf);
+  EXPECT_EQ(CnedkBufSurfaceGetGeneration(&surf), 2u);
+
+  // rejected format is not committed, it is reported again
+  consumer.fail_format_change = true;
+  EXPECT_EQ(tracker.Update(params, 256, 256, CNEDK_BUF_COLOR_FORMAT_NV21), -1);
+  EXPECT_EQ(tracker.Generation(), 2u);
+  EXPECT_EQ(tracker.Update(params, 256, 256, CNEDK_BUF_COLOR_FORMAT_NV21), -1);
+  EXPECT_EQ(tracker.Update(params, 1920, 1080, CNEDK_BUF_COLOR_FORMAT_NV21), 0);
+  EXPECT_EQ(tracker.Generation(), 2u);
+
+  // without OnFormatChange, the generation is still counted
+  params.OnFormatChange = nullptr;
+  EXPECT_EQ(tracker.Update(params, 256, 256, CNEDK_BUF_COLOR_FORMAT_NV21), 1);
+  EXPECT_EQ(tracker.Generation(), 3u);
+
+  tracker.Reset();
+  EXPECT_EQ(tracker.Update(params, 1920, 1080, CNEDK_BUF_COLOR_FORMAT_NV21), 0);
+  EXPECT_EQ(tracker.Generation(), 0u);
+}
+
+TEST(VdecFormatTracker, ResolutionChange) {
+  // 256x256, 1920x1080 and 256x256 clips are concatenated, each one has 5 frames
+  std::vector<uint8_t> small = ReadFile("../../unitest/data/img.h264");
+  std::vector<uint8_t> large = ReadFile("../../unitest/data/1080p.h264");
+  ASSERT_FALSE(small.empty());
+  ASSERT_FALSE(large.empty());
+
+  Consumer consumer;
+  CpuDecoder decoder(MakeParams(&consumer), 3);
+  decoder.SendStream(small);
+  decoder.SendStream(large);
+  decoder.SendStream(small);
+  decoder.SendEos();
+
+  EXPECT_EQ(consumer.errors, 0);
+  ASSERT_EQ(consumer.format_changes.size(), 2u);
+  EXPECT_EQ(consumer.format_changes[0].width, 1920u);
+  EXPECT_EQ(consumer.format_changes[0].height, 1080u);
+  EXPECT_EQ(consumer.format_changes[0].generation, 1u);
+  EXPECT_EQ(consumer.format_changes[1].width, 256u);
+  EXPECT_EQ(consumer.format_changes[1].height, 256u);
+  EXPECT_EQ(consumer.format_changes[1].generation, 2u);
+
+  // every frame is in a buffer of its own size, no frame of the previous format comes after the change
+  ASSERT_EQ(consumer.frames.size(), 15u);
+  for (size_t i = 0; i < consumer.frames.size(); ++i) {
+    const DecodedFrame &frame = consumer.frames[i];
+    EXPECT_EQ(frame.generation, i / 5) << "frame " << i;
+    EXPECT_EQ(frame.width, frame.generation == 1 ? 1920u : 256u) << "frame " << i;
+    EXPECT_EQ(frame.height, frame.generation == 1 ? 1080u : 256u) << "frame " << i;
+  }
+}
+
+TEST(VdecFormatTracker, FormatChangeFailed) {
+  std::vector<uint8_t> small = ReadFile("../../unitest/data/img.h264");
+  std::vector<uint8_t> large = ReadFile("../../unitest/data/1080p.h264");
+  Consumer consumer;
+  consumer.fail_format_change = true;
+  CpuDecoder decoder(MakeParams(&consumer), 0);
+  decoder.SendStream(small);
+  decoder.SendStream(large);
+  decoder.SendEos();
+  // every frame of the rejected format reports the error and is dropped, no frame is output in a new generation
+  EXPECT_EQ(consumer.errors, 5);
+  ASSERT_EQ(consumer.frames.size(), 5u);
+  for (const auto &frame : consumer.frames) {
+    EXPECT_EQ(frame.generation, 0u);
+    EXPECT_EQ(frame.width, 256u);
+  }
+}
@@ -0,0 +1,181 @@
+/*************************************************************************
+ * Copyright (C) [2022] by Cambricon, Inc. All rights reserved
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *************************************************************************/
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "cnedk_decode.h"
+
+#include "bitstream_parser.hpp"
+#include "vdec_packet_filter.hpp"
+
+namespace {
+
+using cnedk::NalUnit;
+using cnedk::VdecPacketFilter;
+
+using Packet = std::vector<uint8_t>;
+
+// Splits stream into access units, as demuxer outputs
+std::vector<Packet> ReadPackets(const std::string &path, bool hevc) {
+  std::ifstream file(path, std::ios::binary);
+  std::vector<uint8_t> stream((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  std::vector<NalUnit> nalus;
+  cnedk::SplitAnnexB(stream.data(), stream.size(), &nalus);
+  std::vector<Packet> packets;
+  bool has_slice = false;
+  for (const auto &nalu : nalus) {
+    bool slice = cnedk::IsSliceNal(nalu, hevc);
+    if (packets.empty() || (has_slice && (!slice || (nalu.data[hevc ? 2 : 1] & 0x80)))) {
+      packets.emplace_back();
+      has_slice = false;
+    }
+    packets.back().insert(packets.back().end(), {0, 0, 0, 1});
+    packets.back().insert(packets.back().end(), nalu.data, nalu.data + nalu.size);
+    has_slice = has_slice || slice;
+  }
+  return packets;
+}
+
+// Sends packets through the filter, returns packets which reach the decoder
+std::vector<Packet> Filter(VdecPacketFilter *filter, const std::vector<Packet> &packets, int repeat) {
+  std::vector<Packet> decoded;
+  for (int i = 0; i < repeat; ++i) {
+    for (auto packet : packets) {
+      CnedkVdecStream stream{packet.data(), static_cast<uint32_t>(packet.size()), 0, 0};
+      const CnedkVdecStream *out = filter->Filter(&stream);
+      if (out) decoded.emplace_back(out->bits, out->bits + out->len);
+    }
+  }
+  return decoded;
+}
+
+int CountNal(const Packet &packet, bool hevc, int type) {
+  std::vector<NalUnit> nalus;
+  cnedk::SplitAnnexB(packet.data(), packet.size(), &nalus);
+  int count = 0;
+  for (const auto &nalu : nalus) count += cnedk::GetNalType(nalu, hevc) == type;
+  return count;
+}
+
+}  // namespace
+
+TEST(VdecPacketFilter, NalTypes) {
+  auto packets = ReadPackets("../../unitest/data/img.hevc", true);
+  ASSERT_EQ(packets.size(), 5u);
+  std::vector<bool> references;
+  for (const auto &packet : packets) {
+    std::vector<NalUnit> nalus;
+    cnedk::SplitAnnexB(packet.data(), packet.size(), &nalus);
+    ASSERT_TRUE(cnedk::IsSliceNal(nalus.back(), true));
+    references.push_back(cnedk::IsReferenceNal(nalus.back(), true));
+  }
+  // the 4th picture is TRAIL_N
+  EXPECT_EQ(references, std::vector<bool>({true, true, true, false, true}));
+}
+
+TEST(VdecPacketFilter, All) {
+  auto packets = ReadPackets("../../unitest/data/img.h264", false);
+  VdecPacketFilter filter;
+  filter.Init(CNEDK_VDEC_TYPE_H264, CNEDK_VDEC_DECODE_MODE_ALL, 0);
+  std::vector<Packet> all(packets);
+  all.insert(all.end(), packets.begin(), packets.end());
+  EXPECT_EQ(Filter(&filter, packets, 2), all);
+
+  // JPEG is not filtered
+  filter.Init(CNEDK_VDEC_TYPE_JPEG, CNEDK_VDEC_DECODE_MODE_KEY_FRAME, 0);
+  EXPECT_EQ(Filter(&filter, packets, 1), packets);
+  EXPECT_EQ(filter.GetStats().frames, 0u);
+}
+
+TEST(VdecPacketFilter, KeyFrame) {
+  // 4 GOPs of 5 frames, 1 key frame each
+  auto packets = ReadPackets("../../unitest/data/img.h264", false);
+  VdecPacketFilter filter;
+  filter.Init(CNEDK_VDEC_TYPE_H264, CNEDK_VDEC_DECODE_MODE_KEY_FRAME, 0);
+  auto decoded = Filter(&filter, packets, 4);
+  ASSERT_EQ(decoded.size(), 4u);
+  for (const auto &packet : decoded) EXPECT_EQ(CountNal(packet, false, 5), 1);
+  EXPECT_EQ(filter.GetStats().frames, 20u);
+  EXPECT_EQ(filter.GetStats().dropped_frames, 16u);
+
+  // every second key frame, parameter sets are in the key frame packets
+  filter.Init(CNEDK_VDEC_TYPE_H264, CNEDK_VDEC_DECODE_MODE_KEY_FRAME, 2);
+  decoded = Filter(&filter, packets, 4);
+  ASSERT_EQ(decoded.size(), 2u);
+  for (const auto &packet : decoded) {
+    EXPECT_EQ(CountNal(packet, false, 7), 1);
+    EXPECT_EQ(CountNal(packet, false, 5), 1);
+  }
+  EXPECT_EQ(filter.GetStats().dropped_frames, 18u);
+}
+
+TEST(VdecPacketFilter, KeepParamSets) {
+  auto packets = ReadPackets("../../unitest/data/img.hevc", true);
+  VdecPacketFilter filter;
+  filter.Init(CNEDK_VDEC_TYPE_H265, CNEDK_VDEC_DECODE_MODE_KEY_FRAME, 3);
+  auto decoded = Filter(&filter, packets, 4);
+  ASSERT_EQ(decoded.size(), 2u);
+  EXPECT_EQ(decoded[0], packets[0]);
+  EXPECT_EQ(decoded[1], packets[0]);
+
+  // the key frame without parameter sets
+  Packet key_frame;
+  std::vector<NalUnit> nalus;
+  cnedk::SplitAnnexB(packets[0].data(), packets[0].size(), &nalus);
+  for (const auto &nalu : nalus) {
+    if (cnedk::IsParamSetNal(nalu, true)) continue;
+    key_frame.insert(key_frame.end(), {0, 0, 0, 1});
+    key_frame.insert(key_frame.end(), nalu.data, nalu.data + nalu.size);
+  }
+
+  // parameter sets of the dropped key frame are sent with the next accepted one
+  filter.Init(CNEDK_VDEC_TYPE_H265, CNEDK_VDEC_DECODE_MODE_KEY_FRAME, 2);
+  decoded = Filter(&filter, {packets[0], packets[1], packets[0], packets[1], key_frame}, 1);
+  ASSERT_EQ(decoded.size(), 2u);
+  EXPECT_EQ(decoded[0], packets[0]);
+  EXPECT_EQ(decoded[1], packets[0]);
+
+  filter.Init(CNEDK_VDEC_TYPE_H265, CNEDK_VDEC_DECODE_MODE_KEY_FRAME, 2);
+  decoded = Filter(&filter, {packets[0], key_frame, key_frame}, 1);
+  ASSERT_EQ(decoded.size(), 2u);
+  EXPECT_EQ(decoded[1], key_frame);
+}
+
+TEST(VdecPacketFilter, Reference) {
+  auto packets = ReadPackets("../../unitest/data/img.hevc", true);
+  VdecPacketFilter filter;
+  filter.Init(CNEDK_VDEC_TYPE_H265, CNEDK_VDEC_DECODE_MODE_REFERENCE, 0);
+  auto decoded = Filter(&filter, packets, 4);
+  EXPECT_EQ(decoded.size(), 16u);
+  for (const auto &packet : decoded) EXPECT_EQ(CountNal(packet, true, 0), 0);
+
+  // frames before the first key frame are dropped
+  std::vector<Packet> stream(packets.begin() + 1, packets.end());
+  stream.insert(stream.end(), packets.begin(), packets.end());
+  filter.Init(CNEDK_VDEC_TYPE_H265, CNEDK_VDEC_DECODE_MODE_REFERENCE, 0);
+  decoded = Filter(&filter, stream, 1);
+  ASSERT_EQ(decoded.size(), 4u);
+  EXPECT_EQ(decoded[0], packets[0]);
+}